@@ -0,0 +1,179 @@
+//--------------------------------------------------------------------------------------
+// Entry point for headless runs
+// Loads a scene with a backend that needs no window or device, runs a number of frames
+// and reports how long they took. Builds on any platform (see CMakeLists.txt)
+//--------------------------------------------------------------------------------------
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "Source/FactoryEngine.h"
+#include "Source/Window.h"
+
+// The engine members are destroyed here, they need to be complete
+#include "Source/Common/CGameObjectManager.h"
+#include "Source/Common/CGui.h"
+#include "Source/Common/CScene.h"
+
+namespace
+{
+	struct SArguments
+	{
+		EApiType     backend = ENull;
+		std::string  scene;  // Empty for the default scene
+		std::string  mediaFolder;
+		std::string  output; // Image of the last frame, software backend only
+		unsigned int frames   = 1;
+		UINT         width    = 1920;
+		UINT         height   = 1080;
+		bool         rayTrace = false;
+	};
+
+	void PrintUsage()
+	{
+		std::printf(
+			"Usage: Headless [options]\n"
+			"  --backend null|software  Backend to run, null by default\n"
+			"  --scene <file.xml>       Scene to load, the default scene if not given\n"
+			"  --media <folder>         Media folder, Media next to the executable by default\n"
+			"  --frames <n>             Frames to run, 1 by default\n"
+			"  --size <width>x<height>  Size of the frames, 1920x1080 by default\n"
+			"  --raytrace               Render with the CPU ray tracer instead of the rasterizer (software)\n"
+			"  --output <file.ppm>      Write the last frame (software)\n"
+			"Frames advance by a fixed 1/60 s so runs are repeatable\n");
+	}
+
+	// Will throw a std::invalid_argument exception on unknown or incomplete arguments
+	SArguments ParseArguments(int argc, char* argv[])
+	{
+		SArguments arguments;
+		arguments.mediaFolder = (std::filesystem::absolute(argv[0]).parent_path() / "Media").string();
+
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string option = argv[i];
+
+			if (option == "--raytrace")
+			{
+				arguments.rayTrace = true;
+				continue;
+			}
+
+			if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + option);
+
+			const std::string value = argv[++i];
+
+			if (option == "--backend")
+			{
+				if (value == "null") arguments.backend = ENull;
+				else if (value == "software") arguments.backend = ESoftware;
+				else throw std::invalid_argument("Unknown backend " + value);
+			}
+			else if (option == "--scene")
+			{
+				arguments.scene = value;
+			}
+			else if (option == "--media")
+			{
+				arguments.mediaFolder = value;
+			}
+			else if (option == "--frames")
+			{
+				arguments.frames = static_cast<unsigned int>(std::stoul(value));
+			}
+			else if (option == "--size")
+			{
+				const auto x = value.find('x');
+				if (x == std::string::npos) throw std::invalid_argument("Size must be <width>x<height>");
+
+				arguments.width = static_cast<UINT>(std::stoul(value.substr(0, x)));
+				arguments.height = static_cast<UINT>(std::stoul(value.substr(x + 1)));
+			}
+			else if (option == "--output")
+			{
+				arguments.output = value;
+			}
+			else
+			{
+				throw std::invalid_argument("Unknown option " + option);
+			}
+		}
+
+		if (arguments.frames == 0) throw std::invalid_argument("At least one frame has to run");
+
+		if (arguments.backend != ESoftware && (arguments.rayTrace || !arguments.output.empty()))
+		{
+			throw std::invalid_argument("--raytrace and --output need the software backend");
+		}
+
+		return arguments;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	SArguments arguments;
+
+	try
+	{
+		arguments = ParseArguments(argc, argv);
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf(stderr, "%s\n", e.what());
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		auto engine = NewEngine(arguments.backend, arguments.mediaFolder);
+
+		// The headless backends are the null engine or derive from it
+		const auto nullEngine = static_cast<Null::CNullEngine*>(engine.get());
+		nullEngine->SetFixedFrameTime(1.0f / 60.0f);
+		nullEngine->Resize(arguments.width, arguments.height);
+
+		const auto softEngine = dynamic_cast<Software::CSoftEngine*>(engine.get());
+		if (softEngine && arguments.rayTrace) softEngine->SetRenderMode(Software::ESoftRenderMode::RayTrace);
+
+		const auto loadStart = std::chrono::steady_clock::now();
+
+		engine->CreateScene(arguments.scene);
+
+		const auto frameStart = std::chrono::steady_clock::now();
+
+		for (unsigned int i = 0; i < arguments.frames; ++i)
+		{
+			engine->Update();
+		}
+
+		const auto end = std::chrono::steady_clock::now();
+
+		const auto loadMs = std::chrono::duration<double, std::milli>(frameStart - loadStart).count();
+		const auto frameMs = std::chrono::duration<double, std::milli>(end - frameStart).count() / arguments.frames;
+
+		std::printf("Scene:      %s\n", arguments.scene.empty() ? "default" : arguments.scene.c_str());
+		std::printf("Load:       %.2f ms\n", loadMs);
+		std::printf("Frames:     %u, %.3f ms per frame\n", arguments.frames, frameMs);
+		std::printf("Draws:      %zu in the last frame\n", nullEngine->DrawCommands().size());
+
+		if (!arguments.output.empty())
+		{
+			softEngine->WriteImage(arguments.output);
+			std::printf("Image:      %s\n", arguments.output.c_str());
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf(stderr, "%s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
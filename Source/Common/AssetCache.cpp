@@ -0,0 +1,224 @@
+#include "AssetCache.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include "DirectXTex.h"
+
+#include "MaterialMaps.h"
+#include "TextureCooker.h"
+#include "../Utility/HelperFunctions.h"
+#include "../Utility/LoadProfiler.h"
+
+//--------------------------------------------------------------------------------------
+// Loading stages
+//--------------------------------------------------------------------------------------
+
+bool HasExtension(const std::string& fileName, const std::string& extension)
+{
+	// Case insensitive compare of the end of the file name
+	return fileName.size() >= extension.size() && std::equal(extension.rbegin(), extension.rend(), fileName.rbegin(),
+		[](unsigned char a, unsigned char b) { return std::tolower(a) == std::tolower(b); });
+}
+
+FileBytes ReadFileBytes(const std::string& fileName)
+{
+	CLoadScope scope("Read", "io", fileName);
+
+	std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+
+	if (!file.good()) throw std::runtime_error("Cannot open file " + fileName);
+
+	const auto size = static_cast<size_t>(file.tellg());
+
+	auto bytes = std::make_shared<std::vector<char>>(size);
+
+	file.seekg(0);
+	file.read(bytes->data(), size);
+
+	CLoadProfiler::Instance().AddBytesRead(fileName, size);
+
+	return bytes;
+}
+
+std::shared_ptr<Assimp::Importer> DecodeMesh(const std::string& fileName, const SMeshImportSettings& settings, const FileBytes& data)
+{
+	CLoadScope scope("Decode Mesh", "decode", fileName);
+
+	auto importer = std::make_shared<Assimp::Importer>();
+
+	// Other miscellaneous settings
+	importer->SetPropertyFloat(AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE, 80.0f); // Smoothing angle for normals
+	importer->SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);  // Remove points and lines (keep triangles only)
+	importer->SetPropertyBool(AI_CONFIG_PP_FD_REMOVE, true);                 // Remove degenerate triangles
+	importer->SetPropertyBool(AI_CONFIG_PP_DB_ALL_OR_NONE, true);            // Default to removing bones/weights from meshes that don't need skinning
+
+	// Set maximum bones that can affect one vertex, and also maximum bones affecting a single mesh
+	unsigned int maxBonesPerVertex = 4; // The shaders support 4 bones per verted (null bones are added if necessary)
+	unsigned int maxBonesPerMesh = 256; // Bone indexes are stored in a byte, so no more than 256
+	importer->SetPropertyInteger(AI_CONFIG_PP_LBW_MAX_WEIGHTS, maxBonesPerVertex);
+	importer->SetPropertyInteger(AI_CONFIG_PP_SBBC_MAX_BONES, maxBonesPerMesh);
+
+	importer->SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, settings.removeComponents);
+
+	// No DefaultLogger here, it is a global and this runs on several threads at once
+	const aiScene* scene = nullptr;
+	if (data)
+	{
+		// Assimp picks the loader from the extension hint
+		const auto dot = fileName.find_last_of('.');
+		const auto hint = dot == std::string::npos ? std::string() : fileName.substr(dot + 1);
+
+		scene = importer->ReadFileFromMemory(data->data(), data->size(), settings.flags, hint.c_str());
+	}
+
+	// Formats that reference other files (e.g. obj + mtl) can't be read from memory
+	if (scene == nullptr) scene = importer->ReadFile(fileName, settings.flags);
+
+	if (scene == nullptr)  throw std::runtime_error("Error loading mesh (" + fileName + "). " + importer->GetErrorString());
+	if (scene->mNumMeshes == 0)  throw std::runtime_error("No usable geometry in mesh: " + fileName);
+
+	return importer;
+}
+
+std::shared_ptr<DirectX::ScratchImage> DecodeTexture(const std::string& fileName, const FileBytes& data)
+{
+	const auto bytes = data ? data : ReadFileBytes(fileName);
+
+	CLoadScope scope("Decode Texture", "decode", fileName);
+
+#ifdef _WIN32
+	// WIC needs COM on the calling thread and decoding runs on pool threads
+	const auto coInit = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+
+	auto image = std::make_shared<DirectX::ScratchImage>();
+
+	HRESULT hr;
+
+	// DDS files need a different function from other files
+	if (HasExtension(fileName, ".dds"))
+	{
+		hr = DirectX::LoadFromDDSMemory(bytes->data(), bytes->size(), DirectX::DDS_FLAGS_NONE, nullptr, *image);
+	}
+	else
+	{
+#ifdef _WIN32
+		hr = DirectX::LoadFromWICMemory(bytes->data(), bytes->size(), DirectX::WIC_FLAGS_NONE, nullptr, *image);
+#else
+		// There is no WIC, the cooker's decoder throws with the reason
+		*image = DecodeImage(fileName, reinterpret_cast<const uint8_t*>(bytes->data()), bytes->size());
+		hr = S_OK;
+#endif
+	}
+
+	// Build the mip chain here rather than with a compute pass at upload time
+	if (SUCCEEDED(hr))
+	{
+		const auto& metadata = image->GetMetadata();
+
+		if (metadata.mipLevels == 1 && metadata.dimension == DirectX::TEX_DIMENSION_TEXTURE2D && !DirectX::IsCompressed(metadata.format))
+		{
+			DirectX::ScratchImage mipChain;
+			if (SUCCEEDED(DirectX::GenerateMipMaps(image->GetImages(), image->GetImageCount(), metadata, DirectX::TEX_FILTER_DEFAULT, 0, mipChain)))
+			{
+				*image = std::move(mipChain);
+			}
+		}
+	}
+
+#ifdef _WIN32
+	if (SUCCEEDED(coInit)) CoUninitialize();
+#endif
+
+	if (FAILED(hr)) throw std::runtime_error("Failed to load image: " + fileName);
+
+	return image;
+}
+
+//--------------------------------------------------------------------------------------
+// Cache
+//--------------------------------------------------------------------------------------
+
+CAssetCache& CAssetCache::Instance()
+{
+	static CAssetCache cache;
+	return cache;
+}
+
+std::string CAssetCache::MeshKey(const std::string& fileName, const SMeshImportSettings& settings)
+{
+	return fileName + '|' + std::to_string(settings.flags) + '|' + std::to_string(settings.removeComponents);
+}
+
+void CAssetCache::StoreMesh(const std::string& fileName, const SMeshImportSettings& settings, std::shared_ptr<Assimp::Importer> importer)
+{
+	std::unique_lock l(mMutex);
+	mMeshes[MeshKey(fileName, settings)] = std::move(importer);
+}
+
+void CAssetCache::StoreTexture(const std::string& fileName, std::shared_ptr<DirectX::ScratchImage> image)
+{
+	std::unique_lock l(mMutex);
+	mTextures[fileName] = std::move(image);
+}
+
+std::shared_ptr<Assimp::Importer> CAssetCache::Mesh(const std::string& fileName, const SMeshImportSettings& settings)
+{
+	{
+		std::unique_lock l(mMutex);
+		if (const auto it = mMeshes.find(MeshKey(fileName, settings)); it != mMeshes.end()) return it->second;
+	}
+
+	return DecodeMesh(fileName, settings, ReadFileBytes(fileName));
+}
+
+std::shared_ptr<DirectX::ScratchImage> CAssetCache::Texture(const std::string& fileName)
+{
+	{
+		std::unique_lock l(mMutex);
+		if (const auto it = mTextures.find(fileName); it != mTextures.end()) return it->second;
+	}
+
+	return DecodeTexture(fileName, ReadFileBytes(fileName));
+}
+
+std::shared_ptr<DirectX::ScratchImage> CAssetCache::Orm(const SOrmMaps& maps)
+{
+	if (!maps.packed.empty()) return Texture(CookedTextureName(maps.packed));
+
+	if (const auto cooked = CookedOrmName(maps); !cooked.empty()) return Texture(cooked);
+
+	const auto fileName = OrmFileName(maps);
+
+	{
+		std::unique_lock l(mMutex);
+		if (const auto it = mTextures.find(fileName); it != mTextures.end()) return it->second;
+	}
+
+	const auto map = [this](const std::string& name) { return name.empty() ? nullptr : Texture(CookedTextureName(name)); };
+
+	const auto ao = map(maps.ao);
+	const auto roughness = map(maps.roughness);
+	const auto metalness = map(maps.metalness);
+
+	CLoadScope scope("Pack ORM", "decode", fileName);
+
+	return PackOrm(ao.get(), roughness.get(), metalness.get());
+}
+
+void CAssetCache::Clear()
+{
+	std::unique_lock l(mMutex);
+	mMeshes.clear();
+	mTextures.clear();
+}
@@ -0,0 +1,84 @@
+//--------------------------------------------------------------------------------------
+// Decoded asset cache
+//--------------------------------------------------------------------------------------
+// Holds imported meshes and decoded textures produced by the scene
+// loading pipeline on worker threads, so the backend constructors that run on the
+// upload thread only have to create GPU resources.
+// Nothing in here touches the GPU.
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Assimp { class Importer; }
+namespace DirectX { class ScratchImage; }
+
+struct SOrmMaps;
+
+// Assimp post-processing flags and removed components a backend imports its meshes with
+struct SMeshImportSettings
+{
+	unsigned int flags            = 0;
+	int          removeComponents = 0;
+};
+
+using FileBytes = std::shared_ptr<const std::vector<char>>;
+
+//--------------------------------------------------------------------------------------
+// Loading stages
+//--------------------------------------------------------------------------------------
+// All of them throw a std::runtime_error on failure and are safe to call from any thread
+
+FileBytes ReadFileBytes(const std::string& fileName);
+
+// Import a mesh from memory (or from disk if data is null or the format needs other files)
+std::shared_ptr<Assimp::Importer> DecodeMesh(const std::string& fileName, const SMeshImportSettings& settings, const FileBytes& data = nullptr);
+
+// Decode an image and build its mip chain on the CPU
+std::shared_ptr<DirectX::ScratchImage> DecodeTexture(const std::string& fileName, const FileBytes& data = nullptr);
+
+bool HasExtension(const std::string& fileName, const std::string& extension);
+
+
+class CAssetCache
+{
+public:
+
+	CAssetCache(const CAssetCache&) = delete;
+	CAssetCache(const CAssetCache&&) = delete;
+	CAssetCache& operator=(const CAssetCache&) = delete;
+	CAssetCache& operator=(const CAssetCache&&) = delete;
+
+	static CAssetCache& Instance();
+
+	void StoreMesh(const std::string& fileName, const SMeshImportSettings& settings, std::shared_ptr<Assimp::Importer> importer);
+
+	void StoreTexture(const std::string& fileName, std::shared_ptr<DirectX::ScratchImage> image);
+
+	// Return the cached asset, or load it on the calling thread without caching it
+	std::shared_ptr<Assimp::Importer> Mesh(const std::string& fileName, const SMeshImportSettings& settings);
+
+	std::shared_ptr<DirectX::ScratchImage> Texture(const std::string& fileName);
+
+	// The cooked ORM texture of the maps if it is current, else the one packed by the pipeline
+	// (stored with their OrmFileName), else they are packed from their cached textures
+	std::shared_ptr<DirectX::ScratchImage> Orm(const SOrmMaps& maps);
+
+	// Release everything, called once a scene finished loading
+	void Clear();
+
+private:
+
+	CAssetCache() = default;
+
+	static std::string MeshKey(const std::string& fileName, const SMeshImportSettings& settings);
+
+	std::mutex mMutex;
+
+	std::unordered_map<std::string, std::shared_ptr<Assimp::Importer>>      mMeshes;
+	std::unordered_map<std::string, std::shared_ptr<DirectX::ScratchImage>> mTextures;
+};
@@ -3,6 +3,7 @@
 #include <system_error>
 #include <filesystem>
 
+#include "../Source/Utility/HelperFunctions.h"
 #include "../Source/Utility/Input.h"
 #include "../Engine.h"
 #include "../Math/CVector3.h"
@@ -22,7 +23,7 @@ void CGameObject::GetFilesInFolder(IEngine* engine, std::string& dirPath, std::v
 
 	while (iter != end)
 	{
-		if (!is_directory(iter->path()))
+		if (!is_directory(iter->path()) && !IsCookedTexture(iter->path()))
 		{
 			fileNames.push_back(dirPath + iter->path().filename().string());
 			iter.disable_recursion_pending();
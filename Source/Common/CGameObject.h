@@ -4,7 +4,7 @@
 #include <vector>
 #include "../Math/CMatrix4x4.h"
 
-enum KeyCode;
+enum KeyCode : int;
 class IEngine;
 
 class CGameObject
@@ -59,6 +59,7 @@ public:
 	CVector3                  Rotation(int node = 0); // Getting angles from a matrix is complex - see .cpp file
 	CVector3                  Scale(int node = 0);    // Scale is length of rows 0-2 in matrix
 	CMatrix4x4&               WorldMatrix(int node = 0);
+	const std::vector<CMatrix4x4>& WorldMatrices() const { return mWorldMatrices; } // Of every node, relative to its parent
 	std::string               Name();
 	void                      SetName(std::string n);
 	float&                    ParallaxDepth();
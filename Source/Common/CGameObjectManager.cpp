@@ -1,5 +1,7 @@
 #include "CGameObjectManager.h"
 
+#include <algorithm>
+
 #include "CLight.h"
 
 CGameObjectManager::CGameObjectManager(IEngine* engine)
@@ -56,34 +58,53 @@ void CGameObjectManager::UpdateObjects(float updateTime) const
 
 void CGameObjectManager::RenderAllObjects() const
 {
-	// Firstly render the sky (if any)
-	if (mSky) mSky->Render();
+	RenderObjects(0, NumRenderables());
+}
 
-	// Render the objects
-	for (const auto it : mObjects)
-	{
-		// Render the objects
-		it->Render();
-	}
+size_t CGameObjectManager::NumRenderables() const
+{
+	return (mSky ? 1 : 0) + mObjects.size() + mLights.size() + mSpotLights.size() + mDirLights.size() + mPointLights.size();
+}
 
-	// Render the lights 
-	for (const auto& it : mLights)
-	{
-		it->Render();
-	}
+std::deque<CGameObject*> CGameObjectManager::Renderables() const
+{
+	std::deque<CGameObject*> renderables(mObjects.begin(), mObjects.end());
+	renderables.insert(renderables.end(), mLights.begin(), mLights.end());
+	renderables.insert(renderables.end(), mSpotLights.begin(), mSpotLights.end());
+	renderables.insert(renderables.end(), mDirLights.begin(), mDirLights.end());
+	renderables.insert(renderables.end(), mPointLights.begin(), mPointLights.end());
+	return renderables;
+}
 
-	for (const auto& it : mSpotLights)
-	{
-		it->Render();
-	}
+void CGameObjectManager::RenderObjects(size_t begin, size_t end) const
+{
+	size_t index = 0;
 
-	for (const auto& it : mDirLights)
+	// Skips whole containers before the range, renders the part of each container inside it
+	const auto renderRange = [&](const auto& objects)
 	{
-		it->Render();
-	}
+		const auto first = std::max(begin, index) - index;
+		const auto last = std::min(end - std::min(end, index), objects.size());
+		for (auto i = first; i < last; ++i)
+		{
+			objects[i]->Render();
+		}
+		index += objects.size();
+	};
 
-	for (const auto& it : mPointLights)
+	// Firstly render the sky (if any)
+	if (mSky)
 	{
-		it->Render();
+		if (begin == 0 && end > 0) mSky->Render();
+		index = 1;
 	}
+
+	// Render the objects
+	renderRange(mObjects);
+
+	// Render the lights 
+	renderRange(mLights);
+	renderRange(mSpotLights);
+	renderRange(mDirLights);
+	renderRange(mPointLights);
 }
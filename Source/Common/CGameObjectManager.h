@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef>
 #include <deque>
 
 class CGameObject;
@@ -32,6 +33,14 @@ class CGameObjectManager
 		void AddPlant		(CPlant* obj);
 
 		void RenderAllObjects() const;
+
+		// The sky, the objects and the lights in the order RenderAllObjects draws them, counted as one list.
+		// Renders [begin, end) of that list, so parts of it can be recorded by different threads
+		size_t NumRenderables() const;
+		void   RenderObjects(size_t begin, size_t end) const;
+
+		// The objects and the lights, every game object RenderObjects draws but the sky
+		std::deque<CGameObject*> Renderables() const;
 		void UpdateObjects(float updateTime) const;
 
 		std::deque<CGameObject*> mObjects {};
@@ -12,8 +12,10 @@
 #include "../Window.h"
 #include "../Common/CLight.h"
 
+#ifdef _WIN32
 #include "../DX11/DX11Engine.h"
 #include "../DX12/DX12Engine.h"
+#endif
 
 CScene::CScene(IEngine* engine, const std::string& fileName)
 {
@@ -90,6 +92,7 @@ void CScene::UpdateScene(float& frameTime)
 
 	mCamera->Control(frameTime);
 	
+#ifdef _WIN32
 
 	// Show frame time / FPS in the window title //
 	const auto   fpsUpdateTime = 0.5f; // How long between updates (in seconds)
@@ -121,6 +124,7 @@ void CScene::UpdateScene(float& frameTime)
 		totalFrameTime = 0;
 		frameCount = 0;
 	}
+#endif
 }
 
 void CScene::Save(std::string fileName)
@@ -7,12 +7,11 @@
 
 #pragma once
 
-#include <intsafe.h>
-
-
-#include "..\Utility/ColourRGBA.h"
 #include <memory>
 
+#include "../Utility/ColourRGBA.h"
+#include "../Utility/Platform.h"
+
 #include "Camera.h"
 #include "CPostProcess.h"
 #include "imgui.h"
@@ -69,6 +68,7 @@ class CScene
 		void SetCamera(CCamera* c) { mCamera.reset(c);}
 		auto& GetLockFps() { return mLockFPS; }
 		auto& GetBackgroundCol() { return mBackgroundColor; }
+		auto& GetAmbientColour() { return gAmbientColour; }
 
 	private:
 		IEngine* mEngine;
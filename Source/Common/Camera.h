@@ -6,10 +6,10 @@
 #pragma once
 
 #include "../Math/MathHelpers.h"
-#include "..\Math\CMatrix4x4.h"
-#include "..\Math\CVector2.h"
-#include "..\Math\CVector3.h"
-#include "..\Utility/Input.h"
+#include "../Math/CMatrix4x4.h"
+#include "../Math/CVector2.h"
+#include "../Math/CVector3.h"
+#include "../Utility/Input.h"
 
 class CCamera
 {
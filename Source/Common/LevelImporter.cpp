@@ -1,54 +1,136 @@
 
 #include "LevelImporter.h"
 
+#include <cstdlib>
+#include <filesystem>
 #include <stdexcept>
 
 #include "../Engine.h"
-#include "..\Common/Camera.h"
-#include "..\Common/CScene.h"
+#include "../Common/Camera.h"
+#include "../Common/CScene.h"
 
 #include "../Common/CLight.h"
 #include "../Common/CPostProcess.h"
+#ifdef _WIN32
 #include "../DX11/DX11Engine.h"
+#endif
 #include "CGameObjectManager.h"
+#include "SceneLoadPipeline.h"
+#include "../Utility/LoadProfiler.h"
 
-#include <thread_pool.hpp>
+#include <mutex>
 
 IEngine* mEngine;
 
+namespace
+{
+	std::mutex                              gLoadMutex;
+	CSceneLoadPipeline*                     gActivePipeline = nullptr;
+	CSceneLoadPipeline::ProgressCallback    gProgressCallback;
+}
+
 bool CLevelImporter::LoadScene(const std::string& level, IEngine* engine)
 {
 
 	mEngine = engine;
 
-	tinyxml2::XMLDocument doc;
+	CSceneLoadPipeline pipeline(engine->GetMediaFolder(), engine->MeshImportSettings());
+
+	CSceneLoadPipeline::ProgressCallback progress;
 
-	if (doc.LoadFile(level.c_str()) != tinyxml2::XMLError::XML_SUCCESS)
 	{
-		throw std::runtime_error("Error opening file");
+		std::unique_lock l(gLoadMutex);
+		progress = gProgressCallback;
+		pipeline.SetProgressCallback(progress);
+		gActivePipeline = &pipeline;
 	}
 
-	auto element = doc.FirstChildElement();
+	auto& profiler = CLoadProfiler::Instance();
 
-	while (element != nullptr)
+	// The reports are only written when LOAD_REPORT_DIR is set, Scene1.xml gives <dir>/Scene1.load.json and <dir>/Scene1.load.trace.json
+	std::string reportPath;
+	if (const auto reportDir = std::getenv("LOAD_REPORT_DIR"); reportDir && *reportDir)
+	{
+		std::filesystem::create_directories(reportDir);
+		reportPath = (std::filesystem::path(reportDir) / std::filesystem::path(level).filename().replace_extension("load")).string();
+	}
+	profiler.SetOutputPath(reportPath);
+	profiler.BeginSession(level);
+
+	CLoadScope loadScope("LoadScene", "scene", level);
+
+	const auto setInactive = [&]
 	{
-		std::string elementName = element->Name();
-		if (elementName == "Scene")
 		{
-			try
-			{
-				ParseScene(element);
-			}
-			catch (const std::exception& e)
+			std::unique_lock l(gLoadMutex);
+			gActivePipeline = nullptr;
+		}
+
+		loadScope.End();
+		profiler.EndSession();
+	};
+
+	try
+	{
+		if (progress) progress({ ELoadStage::Parse, 0, 1 });
+
+		CLoadScope parseScope("Parse", "stage", level);
+
+		tinyxml2::XMLDocument doc;
+
+		if (doc.LoadFile(level.c_str()) != tinyxml2::XMLError::XML_SUCCESS)
+		{
+			throw std::runtime_error("Error opening file");
+		}
+
+		auto element = doc.FirstChildElement();
+
+		while (element != nullptr)
+		{
+			std::string elementName = element->Name();
+			if (elementName == "Scene")
 			{
-				throw std::runtime_error(e.what());
+				try
+				{
+					ParseScene(element, pipeline);
+				}
+				catch (const std::exception& e)
+				{
+					throw std::runtime_error(e.what());
+				}
 			}
+
+			element = element->NextSiblingElement();
 		}
 
-		element = element->NextSiblingElement();
+		parseScope.End();
+
+		if (progress) progress({ ELoadStage::Parse, 1, 1 });
+
+		// Resolve, read and decode every asset on all cores, then create the objects here
+		const auto loaded = pipeline.Run(CreateEntity);
+
+		setInactive();
+
+		return loaded;
 	}
+	catch (...)
+	{
+		setInactive();
+		throw;
+	}
+}
 
-	return true;
+void CLevelImporter::SetProgressCallback(std::function<void(const SLoadProgress&)> callback)
+{
+	std::unique_lock l(gLoadMutex);
+	gProgressCallback = std::move(callback);
+}
+
+void CLevelImporter::CancelLoad()
+{
+	std::unique_lock l(gLoadMutex);
+	if (gActivePipeline) gActivePipeline->Cancel();
 }
 
 void  CLevelImporter::SaveScene(std::string& fileName /* ="" */)
@@ -298,7 +380,7 @@ void  SaveVector3(CVector3              v,
 	el->SetAttribute("Z", v.z);
 }
 
-bool  ParseScene(tinyxml2::XMLElement* sceneEl)
+bool  ParseScene(tinyxml2::XMLElement* sceneEl, CSceneLoadPipeline& pipeline)
 {
 	auto element = sceneEl->FirstChildElement();
 
@@ -310,7 +392,7 @@ bool  ParseScene(tinyxml2::XMLElement* sceneEl)
 		{
 			try
 			{
-				ParseEntities(element);
+				ParseEntities(element, pipeline);
 			}
 			catch (const std::exception& e)
 			{
@@ -336,366 +418,138 @@ CVector3 LoadVector3(tinyxml2::XMLElement* el)
 	};
 }
 
-void  LoadObject(tinyxml2::XMLElement* currEntity)
+SEntityDesc ParseEntity(tinyxml2::XMLElement* currEntity, EEntityType type)
 {
-	std::string ID;
-	std::string mesh;
-	std::string name;
-	std::string diffuse;
+	SEntityDesc entity;
 
-	CVector3 pos = { 0,0,0 };
-	CVector3 rot = { 0,0,0 };
-	auto     scale = 1.0f;
+	entity.type = type;
 
 	const auto entityNameAttr = currEntity->FindAttribute("Name");
-	if (entityNameAttr)
-		name = entityNameAttr->Value();
-
-	const auto geometry = currEntity->FirstChildElement("Geometry");
+	if (entityNameAttr) entity.name = entityNameAttr->Value();
 
-	if (geometry)
+	if (const auto geometry = currEntity->FirstChildElement("Geometry"))
 	{
 		const auto idAttr = geometry->FindAttribute("ID");
-		if (idAttr) ID = idAttr->Value();
+		if (idAttr) entity.ID = idAttr->Value();
 
 		const auto meshAttr = geometry->FindAttribute("Mesh");
-		if (meshAttr) mesh = meshAttr->Value();
+		if (meshAttr) entity.mesh = meshAttr->Value();
 
 		const auto diffuseAttr = geometry->FindAttribute("Diffuse");
-		if (diffuseAttr) diffuse = diffuseAttr->Value();
+		if (diffuseAttr) entity.diffuse = diffuseAttr->Value();
 	}
 
 	if (const auto positionEl = currEntity->FirstChildElement("Position"))
 	{
-		pos = LoadVector3(positionEl);
+		entity.position = LoadVector3(positionEl);
 	}
 
 	if (const auto rotationEl = currEntity->FirstChildElement("Rotation"))
 	{
-		rot = ToRadians(LoadVector3(rotationEl));
-	}
+		entity.rotation = LoadVector3(rotationEl);
 
-	if (const auto scaleEl = currEntity->FirstChildElement("Scale"))
-	{
-		scale = scaleEl->FindAttribute("X")->FloatValue();
-	}
-
-	const auto ambientMapEl = currEntity->FirstChildElement("AmbientMap");
-
-	bool enabled = false;
-	int  size = 1;
-
-	if (ambientMapEl)
-	{
-		enabled = ambientMapEl->FindAttribute("Enabled")->BoolValue();
-		size = ambientMapEl->FindAttribute("Size")->IntValue();
-	}
-
-	// Create objects
-	CGameObject* obj = nullptr;
-
-	if(diffuse.empty() && ID.empty())
-	{
-		obj = mEngine->CreateObject(mesh, name, pos, rot, scale);
-	}
-	else if (ID.empty())
-	{
-		obj = mEngine->CreateObject(mesh, name, diffuse, pos, rot, scale);
-	}
-	else
-	{
-		obj = mEngine->CreateObject(ID, name, pos, rot, scale);
-	}
-
-
-	// Set ambient map values
-	//obj->AmbientMapEnabled() = enabled;
-	//obj->AmbientMap()->SetSize(size);
-
-}
-
-void  LoadPointLight(tinyxml2::XMLElement* currEntity)
-{
-	std::string mesh;
-	std::string name;
-	std::string diffuse;
-
-	CVector3 colour = { 0,0,0 };
-	float    strength = 0;
-	CVector3 pos = { 0,0,0 };
-	CVector3 rot = { 0,0,0 };
-	auto     scale = 1.0f;
-
-	const auto entityNameAttr = currEntity->FindAttribute("Name");
-	if (entityNameAttr) name = entityNameAttr->Value();
-
-	const auto geometry = currEntity->FirstChildElement("Geometry");
-	if (geometry)
-	{
-		const auto meshAttr = geometry->FindAttribute("Mesh");
-		if (meshAttr) mesh = meshAttr->Value();
-
-		const auto diffuseAttr = geometry->FindAttribute("Diffuse");
-		if (diffuseAttr) diffuse = diffuseAttr->Value();
-	}
-
-	const auto positionEl = currEntity->FirstChildElement("Position");
-	if (positionEl)
-	{
-		pos = LoadVector3(positionEl);
-	}
-
-	const auto rotationEl = currEntity->FirstChildElement("Rotation");
-	if (rotationEl)
-	{
-		rot = ToRadians(LoadVector3(rotationEl));
-	}
-
-	const auto scaleEl = currEntity->FirstChildElement("Scale");
-	if (scaleEl)
-	{
-		scale = scaleEl->FindAttribute("X")->FloatValue();
-	}
-
-	const auto strengthEl = currEntity->FirstChildElement("Strength");
-	if (strengthEl)
-	{
-		strength = strengthEl->FindAttribute("S")->FloatValue();
-	}
-
-	const auto colourEl = currEntity->FirstChildElement("Colour");
-	if (colourEl)
-	{
-		colour = LoadVector3(colourEl);
-	}
-
-	auto obj = mEngine->CreatePointLight(mesh, name, diffuse, colour, strength, pos, rot, scale);
-}
-
-void  LoadLight(tinyxml2::XMLElement* currEntity)
-{
-	std::string mesh;
-	std::string name;
-	std::string diffuse;
-
-	CVector3 colour = { 0,0,0 };
-	float    strength = 0;
-	CVector3 pos = { 0,0,0 };
-	CVector3 rot = { 0,0,0 };
-	auto     scale = 1.0f;
-
-	const auto entityNameAttr = currEntity->FindAttribute("Name");
-	if (entityNameAttr) name = entityNameAttr->Value();
-
-	const auto geometry = currEntity->FirstChildElement("Geometry");
-	if (geometry)
-	{
-		const auto meshAttr = geometry->FindAttribute("Mesh");
-		if (meshAttr) mesh = meshAttr->Value();
-
-		const auto diffuseAttr = geometry->FindAttribute("Diffuse");
-		if (diffuseAttr) diffuse = diffuseAttr->Value();
-	}
-
-	const auto positionEl = currEntity->FirstChildElement("Position");
-	if (positionEl)
-	{
-		pos = LoadVector3(positionEl);
-	}
-
-	const auto rotationEl = currEntity->FirstChildElement("Rotation");
-	if (rotationEl)
-	{
-		rot = LoadVector3(rotationEl);
-	}
-
-	const auto scaleEl = currEntity->FirstChildElement("Scale");
-	if (scaleEl)
-	{
-		scale = scaleEl->FindAttribute("X")->FloatValue();
-	}
-
-	const auto strengthEl = currEntity->FirstChildElement("Strength");
-	if (strengthEl)
-	{
-		strength = strengthEl->FindAttribute("S")->FloatValue();
-	}
-
-	const auto colourEl = currEntity->FirstChildElement("Colour");
-	if (colourEl)
-	{
-		colour = LoadVector3(colourEl);
-	}
-
-	auto obj = mEngine->CreateLight(mesh, name, diffuse, colour, strength, pos, rot, scale);
-}
-
-
-void  LoadSpotLight(tinyxml2::XMLElement* currEntity)
-{
-	std::string mesh;
-	std::string name;
-	std::string diffuse;
-
-	CVector3 colour = { 0,0,0 };
-	float    strength = 0;
-	CVector3 pos = { 0,0,0 };
-	CVector3 rot = { 0,0,0 };
-	auto     scale = 1.0f;
-
-	const auto entityNameAttr = currEntity->FindAttribute("Name");
-	if (entityNameAttr) name = entityNameAttr->Value();
-
-	const auto geometry = currEntity->FirstChildElement("Geometry");
-	if (geometry)
-	{
-		const auto meshAttr = geometry->FindAttribute("Mesh");
-		if (meshAttr) mesh = meshAttr->Value();
-
-		const auto diffuseAttr = geometry->FindAttribute("Diffuse");
-		if (diffuseAttr) diffuse = diffuseAttr->Value();
-	}
-
-	const auto positionEl = currEntity->FirstChildElement("Position");
-	if (positionEl)
-	{
-		pos = LoadVector3(positionEl);
-	}
-
-	const auto rotationEl = currEntity->FirstChildElement("Rotation");
-	if (rotationEl)
-	{
-		rot = LoadVector3(rotationEl);
+		// Simple, spot and directional lights have always been loaded without the conversion
+		if (type != EEntityType::Light && type != EEntityType::SpotLight && type != EEntityType::DirectionalLight)
+		{
+			entity.rotation = ToRadians(entity.rotation);
+		}
 	}
 
-	const auto scaleEl = currEntity->FirstChildElement("Scale");
-	if (scaleEl)
+	if (const auto scaleEl = currEntity->FirstChildElement("Scale"))
 	{
-		scale = scaleEl->FindAttribute("X")->FloatValue();
+		entity.scale = scaleEl->FindAttribute("X")->FloatValue();
 	}
 
-	const auto strengthEl = currEntity->FirstChildElement("Strength");
-	if (strengthEl)
+	if (const auto strengthEl = currEntity->FirstChildElement("Strength"))
 	{
-		strength = strengthEl->FindAttribute("S")->FloatValue();
+		entity.strength = strengthEl->FindAttribute("S")->FloatValue();
 	}
 
-	const auto colourEl = currEntity->FirstChildElement("Colour");
-	if (colourEl)
+	if (const auto colourEl = currEntity->FirstChildElement("Colour"))
 	{
-		colour = LoadVector3(colourEl);
+		entity.colour = LoadVector3(colourEl);
 	}
 
-	auto obj = mEngine->CreateSpotLight(mesh, name, diffuse, colour, strength, pos, rot, scale);
+	return entity;
 }
 
-
-void  LoadDirLight(tinyxml2::XMLElement* currEntity)
+void  CreateEntity(const SEntityDesc& entity)
 {
-	std::string mesh;
-	std::string name;
-	std::string diffuse;
-
-	CVector3 colour = { 0,0,0 };
-	float    strength = 0;
-	CVector3 pos = { 0,0,0 };
-	CVector3 rot = { 0,0,0 };
-	auto     scale = 1.0f;
-
-	const auto entityNameAttr = currEntity->FindAttribute("Name");
-	if (entityNameAttr) name = entityNameAttr->Value();
-
-	const auto geometry = currEntity->FirstChildElement("Geometry");
-	if (geometry)
-	{
-		const auto meshAttr = geometry->FindAttribute("Mesh");
-		if (meshAttr) mesh = meshAttr->Value();
-
-		const auto diffuseAttr = geometry->FindAttribute("Diffuse");
-		if (diffuseAttr) diffuse = diffuseAttr->Value();
-	}
-
-	const auto positionEl = currEntity->FirstChildElement("Position");
-	if (positionEl)
-	{
-		pos = LoadVector3(positionEl);
-	}
-
-	const auto rotationEl = currEntity->FirstChildElement("Rotation");
-	if (rotationEl)
-	{
-		rot = LoadVector3(rotationEl);
-	}
+	static const char* scopeNames[] =
+	{
+		"Create GameObject",
+		"Create Light",
+		"Create PointLight",
+		"Create DirectionalLight",
+		"Create SpotLight",
+		"Create Sky",
+		"Create Plant",
+		"Create Camera"
+	};
 
-	const auto scaleEl = currEntity->FirstChildElement("Scale");
-	if (scaleEl)
-	{
-		scale = scaleEl->FindAttribute("X")->FloatValue();
-	}
+	CLoadScope scope(scopeNames[static_cast<int>(entity.type)], "create");
 
-	const auto strengthEl = currEntity->FirstChildElement("Strength");
-	if (strengthEl)
+	switch (entity.type)
 	{
-		strength = strengthEl->FindAttribute("S")->FloatValue();
-	}
-
-	const auto colourEl = currEntity->FirstChildElement("Colour");
-	if (colourEl)
+	case EEntityType::GameObject:
 	{
-		colour = LoadVector3(colourEl);
+		if (entity.diffuse.empty() && entity.ID.empty())
+		{
+			mEngine->CreateObject(entity.mesh, entity.name, entity.position, entity.rotation, entity.scale);
+		}
+		else if (entity.ID.empty())
+		{
+			mEngine->CreateObject(entity.mesh, entity.name, entity.diffuse, entity.position, entity.rotation, entity.scale);
+		}
+		else
+		{
+			mEngine->CreateObject(entity.ID, entity.name, entity.position, entity.rotation, entity.scale);
+		}
+		break;
 	}
+	case EEntityType::Light:
+		mEngine->CreateLight(entity.mesh, entity.name, entity.diffuse, entity.colour, entity.strength, entity.position, entity.rotation, entity.scale);
+		break;
 
-	auto obj = mEngine->CreateDirectionalLight(mesh, name, diffuse, colour, strength, pos, rot, scale);
-}
-
-
-void  LoadSky(tinyxml2::XMLElement* currEntity)
-{
-	std::string mesh;
-	std::string name;
-	std::string diffuse;
-
-	CVector3 pos = { 0,0,0 };
-	CVector3 rot = { 0,0,0 };
-	auto     scale = 1.0f;
-
-	const auto entityNameAttr = currEntity->FindAttribute("Name");
-	if (entityNameAttr)
-		name = entityNameAttr->Value();
+	case EEntityType::PointLight:
+		mEngine->CreatePointLight(entity.mesh, entity.name, entity.diffuse, entity.colour, entity.strength, entity.position, entity.rotation, entity.scale);
+		break;
 
-	const auto geometry = currEntity->FirstChildElement("Geometry");
+	case EEntityType::DirectionalLight:
+		mEngine->CreateDirectionalLight(entity.mesh, entity.name, entity.diffuse, entity.colour, entity.strength, entity.position, entity.rotation, entity.scale);
+		break;
 
-	if (geometry)
-	{
-		const auto meshAttr = geometry->FindAttribute("Mesh");
-		if (meshAttr) mesh = meshAttr->Value();
+	case EEntityType::SpotLight:
+		mEngine->CreateSpotLight(entity.mesh, entity.name, entity.diffuse, entity.colour, entity.strength, entity.position, entity.rotation, entity.scale);
+		break;
 
-		const auto diffuseAttr = geometry->FindAttribute("Diffuse");
-		if (diffuseAttr) diffuse = diffuseAttr->Value();
-	}
+	case EEntityType::Sky:
+		// No ambient map for the sky object
+		mEngine->CreateSky(entity.mesh, entity.name, entity.diffuse, entity.position, entity.rotation, entity.scale);
+		break;
 
-	const auto positionEl = currEntity->FirstChildElement("Position");
-	if (positionEl)
+	case EEntityType::Plant:
 	{
-		pos = LoadVector3(positionEl);
-	}
+		try
+		{
+			CPlant* obj;
+			if (!entity.ID.empty())
+				obj = mEngine->CreatePlant(entity.ID, entity.name, entity.position, entity.rotation, entity.scale);
+			else
+				obj = mEngine->CreatePlant(entity.mesh, entity.name, entity.position, entity.rotation, entity.scale);
 
-	const auto rotationEl = currEntity->FirstChildElement("Rotation");
-	if (rotationEl)
-	{
-		rot = ToRadians(LoadVector3(rotationEl));
+			mEngine->GetObjManager()->AddPlant(obj);
+		}
+		catch (const std::exception& e)
+		{
+			throw std::runtime_error(std::string(e.what()) + " of object " + entity.name);
+		}
+		break;
 	}
-
-	const auto scaleEl = currEntity->FirstChildElement("Scale");
-	if (scaleEl)
-	{
-		scale = scaleEl->FindAttribute("X")->FloatValue();
+	case EEntityType::Camera:
+		//LoadCamera(currEntity);
+		break;
 	}
-
-	// No ambient map for the sky object
-
-	CSky* obj = mEngine->CreateSky(mesh, name, diffuse, pos, rot, scale);
-
 }
 
 void  LoadCamera(tinyxml2::XMLElement* currEntity)
@@ -724,65 +578,6 @@ void  LoadCamera(tinyxml2::XMLElement* currEntity)
 	mEngine->GetScene()->SetCamera(c);
 }
 
-void  LoadPlant(tinyxml2::XMLElement* currEntity)
-{
-	std::string ID;
-	std::string name;
-	std::string mesh;
-
-	CVector3 pos = { 0,0,0 };
-	CVector3 rot = { 0,0,0 };
-	auto     scale = 1.0f;
-
-	const auto entityNameAttr = currEntity->FindAttribute("Name");
-	if (entityNameAttr)
-		name = entityNameAttr->Value();
-
-	if (const auto geometry = currEntity->FirstChildElement("Geometry"))
-	{
-		const auto idAttr = geometry->FindAttribute("ID");
-		if (idAttr) ID = idAttr->Value();
-		else
-		{
-			const auto meshAttr = geometry->FindAttribute("Mesh");
-			if (meshAttr) mesh = meshAttr->Value();
-
-		}
-	}
-
-	if (const auto positionEl = currEntity->FirstChildElement("Position"))
-	{
-		pos = LoadVector3(positionEl);
-	}
-
-	if (const auto rotationEl = currEntity->FirstChildElement("Rotation"))
-	{
-		rot = ToRadians(LoadVector3(rotationEl));
-	}
-
-	if (const auto scaleEl = currEntity->FirstChildElement("Scale"))
-	{
-		scale = scaleEl->FindAttribute("X")->FloatValue();
-	}
-
-	try
-	{
-
-		CPlant* obj;
-		if(!ID.empty())
-			obj = mEngine->CreatePlant(ID, name, pos, rot, scale);
-		else
-			obj = mEngine->CreatePlant(mesh, name, pos, rot, scale);
-
-
-		mEngine->GetObjManager()->AddPlant(obj);
-	}
-	catch (const std::exception& e)
-	{
-		throw std::runtime_error(std::string(e.what()) + " of object " + name);
-	}
-}
-
 void  SavePostProcessingEffect(tinyxml2::XMLElement* curr)
 {
 
@@ -797,7 +592,8 @@ void  SavePostProcessingEffect(tinyxml2::XMLElement* curr)
 		ppEl->SetAttribute("Mode", mPostProcessModeStrings[(int)pp.mode].c_str());
 	}
 
-	// Save settings
+#ifdef _WIN32
+	// Save settings, they are the constants of the DX11 post-processes
 	// Create an array of floats
 	float settings[sizeof(DX11::PostProcessingConstants) / sizeof(float)];
 
@@ -808,7 +604,7 @@ void  SavePostProcessingEffect(tinyxml2::XMLElement* curr)
 	const auto settingsEl = curr->InsertNewChildElement("Settings");
 
 	// For every setting 
-	for (unsigned long long int i = 0; i < ARRAYSIZE(settings); ++i)
+	for (unsigned long long int i = 0; i < std::size(settings); ++i)
 	{
 		// create a different name for each setting
 		std::string name = "setting";
@@ -817,6 +613,7 @@ void  SavePostProcessingEffect(tinyxml2::XMLElement* curr)
 		// set the attribute 
 		settingsEl->SetAttribute(name.c_str(), settings[i]);
 	}
+#endif
 }
 
 void  ParsePostProcessingEffects(tinyxml2::XMLElement* curr)
@@ -846,17 +643,17 @@ void  ParsePostProcessingEffects(tinyxml2::XMLElement* curr)
 			PostProcessFilter filter;
 
 
-			for (unsigned long long int i = 0; i < ARRAYSIZE(mPostProcessModeStrings); ++i)
+			for (unsigned long long int i = 0; i < std::size(mPostProcessModeStrings); ++i)
 			{
-				if (modeValue._Equal(mPostProcessModeStrings[i]))
+				if (modeValue == mPostProcessModeStrings[i])
 				{
 					filter.mode = (PostProcessMode)i;
 				}
 			}
 
-			for (int i = 0; i < ARRAYSIZE(mPostProcessStrings); ++i)
+			for (int i = 0; i < static_cast<int>(std::size(mPostProcessStrings)); ++i)
 			{
-				if (typeValue._Equal(mPostProcessStrings[i]))
+				if (typeValue == mPostProcessStrings[i])
 				{
 					filter.type = (PostProcess)i;
 				}
@@ -864,8 +661,9 @@ void  ParsePostProcessingEffects(tinyxml2::XMLElement* curr)
 
 			mPostProcessingFilters.push_back(filter);
 		}
+#ifdef _WIN32
 		// After Loading all the effects
-		// Load the settings
+		// Load the settings, only the DX11 post-processes have them
 		else if (item == "Settings")
 		{
 			float values[sizeof(DX11::gPostProcessingConstants) / sizeof(float)];
@@ -883,15 +681,26 @@ void  ParsePostProcessingEffects(tinyxml2::XMLElement* curr)
 
 			memcpy(&DX11::gPostProcessingConstants, values, sizeof(values));
 		}
+#endif
 		currEffect = currEffect->NextSiblingElement();
 	}
 }
 
-bool  ParseEntities(tinyxml2::XMLElement* entitiesEl)
+bool  ParseEntities(tinyxml2::XMLElement* entitiesEl, CSceneLoadPipeline& pipeline)
 {
-	auto currEntity = entitiesEl->FirstChildElement();
+	static const std::pair<const char*, EEntityType> types[] =
+	{
+		{ "GameObject",       EEntityType::GameObject },
+		{ "Light",            EEntityType::Light },
+		{ "PointLight",       EEntityType::PointLight },
+		{ "DirectionalLight", EEntityType::DirectionalLight },
+		{ "SpotLight",        EEntityType::SpotLight },
+		{ "Sky",              EEntityType::Sky },
+		{ "Plant",            EEntityType::Plant },
+		{ "Camera",           EEntityType::Camera },
+	};
 
-	thread_pool TPool(2);
+	auto currEntity = entitiesEl->FirstChildElement();
 
 	while (currEntity)
 	{
@@ -905,45 +714,18 @@ bool  ParseEntities(tinyxml2::XMLElement* entitiesEl)
 			{
 				std::string typeValue = type->Value();
 
-				if (typeValue == "GameObject")
-				{
-					TPool.push_task(LoadObject, currEntity);
-				}
-				else if (typeValue == "Light")
-				{
-					TPool.push_task(LoadLight,currEntity);
-				}
-				else if (typeValue == "PointLight")
-				{
-					TPool.push_task(LoadPointLight,currEntity);
-				}
-				else if (typeValue == "DirectionalLight")
+				for (const auto& [typeName, entityType] : types)
 				{
-					TPool.push_task(LoadDirLight,currEntity);
-				}
-				else if (typeValue == "SpotLight")
-				{
-					TPool.push_task(LoadSpotLight,currEntity);
-				}
-				else if (typeValue == "Sky")
-				{
-					TPool.push_task(LoadSky,currEntity);
-				}
-				else if (typeValue == "Plant")
-				{
-					TPool.push_task(LoadPlant,currEntity);
-				}
-				else if (typeValue == "Camera")
-				{
-					TPool.wait_for_tasks();
-					//LoadCamera(currEntity);
+					if (typeValue == typeName)
+					{
+						pipeline.Add(ParseEntity(currEntity, entityType));
+						break;
+					}
 				}
 			}
 		}
 		currEntity = currEntity->NextSiblingElement();
 	}
 
-	TPool.wait_for_tasks();
-
 	return true;
 }
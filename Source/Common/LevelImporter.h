@@ -1,9 +1,12 @@
 #pragma once
 
-#include "..\External/tinyxml2/tinyxml2.h"
+#include "../External/tinyxml2/tinyxml2.h"
 
+#include <functional>
 #include <string>
 
+#include "SceneLoadPipeline.h"
+
 class CGameObject;
 class IEngine;
 class CVector3;
@@ -17,8 +20,15 @@ public:
 	// Scene Parser
 	//--------------------------------------------------------------------------------------
 
+	// Returns false if the load was cancelled
 	static bool LoadScene(const std::string& level, IEngine* engine);
 
+	// Progress of the next scenes loaded, called from the loading threads as well
+	static void SetProgressCallback(std::function<void(const SLoadProgress&)> callback);
+
+	// Stop the scene currently loading, can be called from any thread
+	static void CancelLoad();
+
 	static void SaveScene(std::string& fileName);
 
 };
@@ -33,22 +43,12 @@ public:
 
 	void SaveVector3(CVector3 v, tinyxml2::XMLElement* el);
 
-	bool ParseScene(tinyxml2::XMLElement* sceneEl);
-
-	void LoadObject(tinyxml2::XMLElement* currEntity);
+	bool ParseScene(tinyxml2::XMLElement* sceneEl, CSceneLoadPipeline& pipeline);
 
-	void LoadPointLight(tinyxml2::XMLElement* currEntity);
+	SEntityDesc ParseEntity(tinyxml2::XMLElement* currEntity, EEntityType type);
 
-	void LoadLight(tinyxml2::XMLElement* currEntity);
-
-	void LoadSpotLight(tinyxml2::XMLElement* currEntity);
-
-	void LoadDirLight(tinyxml2::XMLElement* currEntity);
-
-	void LoadSky(tinyxml2::XMLElement* currEntity);
+	void CreateEntity(const SEntityDesc& entity);
 
 	void LoadCamera(tinyxml2::XMLElement* currEntity);
 
-	void LoadPlant(tinyxml2::XMLElement* currEntity);
-
-	bool ParseEntities(tinyxml2::XMLElement* entitiesEl);
\ No newline at end of file
+	bool ParseEntities(tinyxml2::XMLElement* entitiesEl, CSceneLoadPipeline& pipeline);
\ No newline at end of file
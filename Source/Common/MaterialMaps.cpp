@@ -0,0 +1,189 @@
+#include "MaterialMaps.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+
+#include "DirectXTex.h"
+
+namespace
+{
+	struct SOrmChannel
+	{
+		EMaterialMap map;
+		const char*  name;
+	};
+
+	// In the order of the channels
+	constexpr SOrmChannel OrmChannels[] = { { EMaterialMap::AO, "AO" }, { EMaterialMap::Roughness, "Roughness" }, { EMaterialMap::Metalness, "Metalness" } };
+
+	// The largest mip of a map as RGBA8 of the given size
+	DirectX::ScratchImage Channels(const DirectX::ScratchImage& map, size_t width, size_t height)
+	{
+		const auto top = map.GetImage(0, 0, 0);
+		if (!top) throw std::runtime_error("Empty map packing an ORM texture");
+
+		DirectX::ScratchImage rgba;
+
+		HRESULT hr;
+		if (DirectX::IsCompressed(top->format))
+		{
+			hr = DirectX::Decompress(*top, DXGI_FORMAT_R8G8B8A8_UNORM, rgba);
+		}
+		else if (top->format != DXGI_FORMAT_R8G8B8A8_UNORM)
+		{
+			// Single channel maps are loaded as they are stored, the value ends up in red
+			hr = DirectX::Convert(*top, DXGI_FORMAT_R8G8B8A8_UNORM, DirectX::TEX_FILTER_FORCE_NON_WIC, DirectX::TEX_THRESHOLD_DEFAULT, rgba);
+		}
+		else
+		{
+			hr = rgba.InitializeFromImage(*top);
+		}
+
+		if (FAILED(hr)) throw std::runtime_error("Failed to convert a map packing an ORM texture");
+
+		if (top->width == width && top->height == height) return rgba;
+
+		DirectX::ScratchImage resized;
+		if (FAILED(DirectX::Resize(*rgba.GetImage(0, 0, 0), width, height, DirectX::TEX_FILTER_LINEAR | DirectX::TEX_FILTER_FORCE_NON_WIC, resized)))
+		{
+			throw std::runtime_error("Failed to resize a map packing an ORM texture");
+		}
+
+		return resized;
+	}
+}
+
+EMaterialMap MaterialMap(const std::string& fileName)
+{
+	const auto name = std::filesystem::path(fileName).filename().string();
+
+	const auto has = [&name](const char* map) { return name.find(map) != std::string::npos; };
+
+	// ORM on its own, names may have those letters anywhere
+	if (has("_ORM.") || has("_ORM_")) return EMaterialMap::ORM;
+
+	if (has("Albedo"))       return EMaterialMap::Albedo;
+	if (has("Roughness"))    return EMaterialMap::Roughness;
+	if (has("AO"))           return EMaterialMap::AO;
+	if (has("Displacement")) return EMaterialMap::Displacement;
+	if (has("Normal"))       return EMaterialMap::Normal;
+	if (has("Metalness"))    return EMaterialMap::Metalness;
+
+	return EMaterialMap::None;
+}
+
+bool FindOrmMaps(const std::vector<std::string>& fileNames, SOrmMaps& maps)
+{
+	maps = {};
+
+	for (const auto& fileName : fileNames)
+	{
+		switch (MaterialMap(fileName))
+		{
+		case EMaterialMap::AO:        maps.ao = fileName;        break;
+		case EMaterialMap::Roughness: maps.roughness = fileName; break;
+		case EMaterialMap::Metalness: maps.metalness = fileName; break;
+		case EMaterialMap::ORM:       maps.packed = fileName;    break;
+		default:                                                 break;
+		}
+	}
+
+	// Next to separate maps it is the one cooked from them
+	if (!maps.ao.empty() || !maps.roughness.empty() || !maps.metalness.empty()) maps.packed.clear();
+
+	return !maps.Empty();
+}
+
+std::string OrmFileName(const SOrmMaps& maps)
+{
+	if (!maps.packed.empty()) return maps.packed;
+
+	for (const auto& [map, name] : OrmChannels)
+	{
+		const auto& fileName = map == EMaterialMap::AO ? maps.ao : map == EMaterialMap::Roughness ? maps.roughness : maps.metalness;
+		if (fileName.empty()) continue;
+
+		// The three maps only differ by that word, any of them gives the same name
+		std::filesystem::path path(fileName);
+		auto stem = path.stem().string();
+		stem.replace(stem.find(name), std::char_traits<char>::length(name), "ORM");
+
+		return path.replace_filename(stem + ".dds").string();
+	}
+
+	return {};
+}
+
+std::string CookedOrmName(const SOrmMaps& maps)
+{
+	const auto cooked = OrmFileName(maps);
+	if (cooked.empty() || !maps.packed.empty()) return {};
+
+	std::error_code ec;
+	const auto cookedTime = std::filesystem::last_write_time(cooked, ec);
+	if (ec) return {};
+
+	for (const auto fileName : { &maps.ao, &maps.roughness, &maps.metalness })
+	{
+		if (fileName->empty()) continue;
+
+		const auto sourceTime = std::filesystem::last_write_time(*fileName, ec);
+		if (ec || cookedTime < sourceTime) return {};
+	}
+
+	return cooked;
+}
+
+std::shared_ptr<DirectX::ScratchImage> PackOrm(const DirectX::ScratchImage* ao, const DirectX::ScratchImage* roughness, const DirectX::ScratchImage* metalness)
+{
+	const DirectX::ScratchImage* maps[] = { ao, roughness, metalness };
+
+	size_t width = 0, height = 0;
+	for (const auto map : maps)
+	{
+		if (!map) continue;
+		width = std::max(width, map->GetMetadata().width);
+		height = std::max(height, map->GetMetadata().height);
+	}
+
+	if (!width || !height) throw std::runtime_error("No maps to pack to an ORM texture");
+
+	DirectX::ScratchImage orm;
+	if (FAILED(orm.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, width, height, 1, 1))) throw std::runtime_error("Out of memory packing an ORM texture");
+
+	const auto dst = orm.GetImage(0, 0, 0);
+	for (size_t y = 0; y < height; ++y)
+	{
+		auto row = dst->pixels + y * dst->rowPitch;
+		for (size_t x = 0; x < width; ++x, row += 4)
+		{
+			row[0] = static_cast<uint8_t>(OrmDefault >> 24);
+			row[1] = static_cast<uint8_t>(OrmDefault >> 16);
+			row[2] = static_cast<uint8_t>(OrmDefault >> 8);
+			row[3] = static_cast<uint8_t>(OrmDefault);
+		}
+	}
+
+	for (size_t channel = 0; channel < 3; ++channel)
+	{
+		if (!maps[channel]) continue;
+
+		const auto rgba = Channels(*maps[channel], width, height);
+		const auto src = rgba.GetImage(0, 0, 0);
+
+		for (size_t y = 0; y < height; ++y)
+		{
+			const auto from = src->pixels + y * src->rowPitch;
+			const auto to = dst->pixels + y * dst->rowPitch;
+			for (size_t x = 0; x < width; ++x) to[x * 4 + channel] = from[x * 4];
+		}
+	}
+
+	// Linear data, averaged as it is
+	auto mips = std::make_shared<DirectX::ScratchImage>();
+	if (FAILED(DirectX::GenerateMipMaps(*dst, DirectX::TEX_FILTER_FORCE_NON_WIC, 0, *mips))) throw std::runtime_error("Failed to generate the mips of an ORM texture");
+
+	return mips;
+}
@@ -0,0 +1,65 @@
+//--------------------------------------------------------------------------------------
+// Material maps and ORM packing
+//--------------------------------------------------------------------------------------
+// The maps of a material are told apart by their file names (NAME_RESOLUTION_TYPE.EXTENSION).
+// The ambient occlusion, roughness and metalness maps are single channel, so they are packed
+// into the red, green and blue of one ORM texture: one descriptor and one sample instead of
+// three. The texture cooker packs them to a DDS file next to the maps (the name of the maps
+// with the type replaced by ORM), anything not cooked is packed when it is loaded.
+// A map that is missing leaves its channel at the default the shaders use without it.
+// Materials may also come with a packed map of their own (NAME_ORM.EXTENSION).
+// Nothing in here touches the GPU or Windows.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace DirectX { class ScratchImage; }
+
+enum class EMaterialMap
+{
+	Albedo,
+	Roughness,
+	AO,
+	Displacement,
+	Normal,
+	Metalness,
+	ORM,
+	None
+};
+
+// Which map a file is, with the names tested in the order the materials always did
+EMaterialMap MaterialMap(const std::string& fileName);
+
+// RGBA with red in the high byte: no occlusion, half rough, not metallic
+constexpr uint32_t OrmDefault = 0xFF8000FF;
+
+struct SOrmMaps
+{
+	std::string ao;
+	std::string roughness;
+	std::string metalness;
+	std::string packed; // A map that is already ORM, used when there are no separate maps
+
+	bool Empty() const { return ao.empty() && roughness.empty() && metalness.empty() && packed.empty(); }
+
+	bool HasAo()        const { return !ao.empty() || !packed.empty(); }
+	bool HasRoughness() const { return !roughness.empty() || !packed.empty(); }
+	bool HasMetalness() const { return !metalness.empty() || !packed.empty(); }
+};
+
+// Returns false if the material has none of them
+bool FindOrmMaps(const std::vector<std::string>& fileNames, SOrmMaps& maps);
+
+// The DDS file the separate maps are cooked to, next to them
+std::string OrmFileName(const SOrmMaps& maps);
+
+// That file if it is at least as recent as all the maps, an empty string otherwise
+std::string CookedOrmName(const SOrmMaps& maps);
+
+// Packs the maps that are not null, resized to the largest of them, with a mip chain
+// Will throw a std::runtime_error exception if a map cannot be converted
+std::shared_ptr<DirectX::ScratchImage> PackOrm(const DirectX::ScratchImage* ao, const DirectX::ScratchImage* roughness, const DirectX::ScratchImage* metalness);
@@ -0,0 +1,133 @@
+#include "RangeAllocator.h"
+
+#include <iterator>
+#include <stdexcept>
+
+CRangeAllocator::CRangeAllocator(uint64_t capacity) :
+	mCapacity(capacity)
+{
+}
+
+uint64_t CRangeAllocator::Allocate(uint64_t size)
+{
+	if (size == 0) throw std::logic_error("Empty range allocation");
+
+	// The smallest free range it fits in
+	const auto best = mFreeBySize.lower_bound(size);
+	if (best != mFreeBySize.end())
+	{
+		const auto offset = best->second;
+		const auto free = best->first;
+		RemoveFree(mFree.find(offset));
+		if (free > size) AddFree(offset + size, free - size);
+
+		mRanges[offset] = size;
+		mAllocated += size;
+		return offset;
+	}
+
+	if (mCapacity && size > mCapacity - mEnd) return InvalidOffset;
+
+	const auto offset = mEnd;
+	mEnd += size;
+	mRanges[offset] = size;
+	mAllocated += size;
+	return offset;
+}
+
+void CRangeAllocator::Free(uint64_t offset)
+{
+	const auto range = mRanges.find(offset);
+	if (range == mRanges.end()) throw std::logic_error("Freeing a range that was not allocated");
+
+	auto first = offset;
+	auto size = range->second;
+	mRanges.erase(range);
+	mAllocated -= size;
+
+	// Merged with the free ranges on both sides
+	const auto next = mFree.find(first + size);
+	if (next != mFree.end())
+	{
+		size += next->second;
+		RemoveFree(next);
+	}
+
+	const auto after = mFree.lower_bound(first);
+	if (after != mFree.begin())
+	{
+		const auto previous = std::prev(after);
+		if (previous->first + previous->second == first)
+		{
+			first = previous->first;
+			size += previous->second;
+			RemoveFree(previous);
+		}
+	}
+
+	if (first + size == mEnd) mEnd = first;
+	else AddFree(first, size);
+}
+
+uint64_t CRangeAllocator::Size(uint64_t offset) const
+{
+	const auto range = mRanges.find(offset);
+	return range == mRanges.end() ? 0 : range->second;
+}
+
+void CRangeAllocator::SetCapacity(uint64_t capacity)
+{
+	if (capacity && capacity < mEnd) throw std::logic_error("Range allocator capacity below the ranges in use");
+
+	mCapacity = capacity;
+}
+
+void CRangeAllocator::Validate() const
+{
+	if (mFree.size() != mFreeBySize.size()) throw std::logic_error("Range allocator free lists differ");
+
+	// Every unit up to the end is in one allocation or one free range, in order
+	std::map<uint64_t, std::pair<uint64_t, bool>> all;
+	for (const auto& [offset, size] : mRanges) all[offset] = { size, false };
+	for (const auto& [offset, size] : mFree)
+	{
+		if (!all.emplace(offset, std::make_pair(size, true)).second) throw std::logic_error("Range allocator free range on an allocation");
+	}
+
+	uint64_t expected = 0, allocated = 0;
+	auto previousFree = false;
+	for (const auto& [offset, range] : all)
+	{
+		const auto [size, free] = range;
+		if (offset != expected) throw std::logic_error("Range allocator ranges overlap or leave a gap");
+		if (free && previousFree) throw std::logic_error("Range allocator free ranges not merged");
+		if (!free) allocated += size;
+
+		expected = offset + size;
+		previousFree = free;
+	}
+
+	if (expected != mEnd || previousFree) throw std::logic_error("Range allocator end does not follow the last allocation");
+	if (allocated != mAllocated) throw std::logic_error("Range allocator count of allocated units is wrong");
+	if (mCapacity && mEnd > mCapacity) throw std::logic_error("Range allocator past its capacity");
+}
+
+void CRangeAllocator::AddFree(uint64_t offset, uint64_t size)
+{
+	mFree[offset] = size;
+	mFreeBySize.emplace(size, offset);
+}
+
+void CRangeAllocator::RemoveFree(std::map<uint64_t, uint64_t>::iterator free)
+{
+	auto [first, last] = mFreeBySize.equal_range(free->second);
+	for (; first != last; ++first)
+	{
+		if (first->second != free->first) continue;
+
+		mFreeBySize.erase(first);
+		break;
+	}
+
+	mFree.erase(free);
+}
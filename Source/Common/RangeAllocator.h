@@ -0,0 +1,72 @@
+//--------------------------------------------------------------------------------------
+// Range allocator
+//--------------------------------------------------------------------------------------
+// Hands out contiguous ranges of a linear space of units (records of a buffer, vertices or
+// indices of a pool...), the caller decides what a unit is. An allocation takes the smallest
+// free range it fits in, found through the free ranges ordered by size, and what is left of
+// that range stays free. Freed ranges are merged with the free ranges next to them, a free
+// range that reaches the end is given back to the end instead.
+// Past the free ranges the allocations take the units after the last one in use, up to the
+// capacity if there is one.
+// Nothing here depends on the GPU, the units are only numbers.
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+class CRangeAllocator
+{
+public:
+
+	static constexpr uint64_t InvalidOffset = ~0ull;
+
+	CRangeAllocator(const CRangeAllocator&) = delete;
+	CRangeAllocator(const CRangeAllocator&&) = delete;
+	CRangeAllocator& operator=(const CRangeAllocator&) = delete;
+	CRangeAllocator& operator=(const CRangeAllocator&&) = delete;
+
+	// A capacity of 0 lets the ranges grow without limit
+	explicit CRangeAllocator(uint64_t capacity = 0);
+
+	// Returns the first of size contiguous units, InvalidOffset if they do not fit in the capacity
+	// Will throw a std::logic_error exception if size is 0
+	uint64_t Allocate(uint64_t size);
+
+	// Will throw a std::logic_error exception if offset is not the first unit of an allocation
+	void Free(uint64_t offset);
+
+	// The units of the allocation starting at offset, 0 if there is none
+	uint64_t Size(uint64_t offset) const;
+
+	// Up to the last unit in use, free ranges in between included
+	uint64_t End() const { return mEnd; }
+
+	uint64_t Capacity() const { return mCapacity; }
+
+	// Allows more units, the allocations stay where they are. Will throw a std::logic_error exception below End
+	void SetCapacity(uint64_t capacity);
+
+	uint32_t Allocations() const { return static_cast<uint32_t>(mRanges.size()); }
+	uint64_t Allocated() const { return mAllocated; }
+
+	// Free units before the end, and the largest range of them
+	uint64_t FreeUnits() const { return mEnd - mAllocated; }
+	uint64_t LargestFree() const { return mFreeBySize.empty() ? 0 : mFreeBySize.rbegin()->first; }
+
+	// Will throw a std::logic_error exception if the ranges overlap or leave units unaccounted for
+	void Validate() const;
+
+private:
+
+	void AddFree(uint64_t offset, uint64_t size);
+	void RemoveFree(std::map<uint64_t, uint64_t>::iterator free);
+
+	uint64_t mCapacity;
+	uint64_t mEnd       = 0;
+	uint64_t mAllocated = 0;
+
+	std::map<uint64_t, uint64_t>      mRanges;     // First unit to size, of the allocations
+	std::map<uint64_t, uint64_t>      mFree;       // First unit to size, never touching each other or the end
+	std::multimap<uint64_t, uint64_t> mFreeBySize; // Size to first unit, of the same ranges
+};
@@ -0,0 +1,314 @@
+#include "SceneLoadPipeline.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+#include <unordered_set>
+
+#include "../Utility/HelperFunctions.h"
+#include "../Utility/LoadProfiler.h"
+
+//--------------------------------------------------------------------------------------
+// Asset path resolution
+//--------------------------------------------------------------------------------------
+
+namespace
+{
+	// Same listing the game objects do with GetFilesInFolder, names relative to the media folder
+	void ListFolder(const std::string& mediaFolder, std::string folder, std::vector<std::string>& fileNames)
+	{
+		std::filesystem::recursive_directory_iterator iter(mediaFolder + folder);
+
+		if (folder.empty() || folder.back() != '/') folder.push_back('/');
+
+		std::filesystem::recursive_directory_iterator end;
+
+		while (iter != end)
+		{
+			if (!is_directory(iter->path()) && !IsCookedTexture(iter->path()))
+			{
+				fileNames.push_back(folder + iter->path().filename().string());
+				iter.disable_recursion_pending();
+			}
+			std::error_code ec;
+			iter.increment(ec);
+			if (ec) { throw std::runtime_error("Error accessing " + ec.message()); }
+		}
+	}
+
+	// Mirrors the ID lookup of the game object constructors
+	void ResolveID(const std::string& mediaFolder, std::string id, std::vector<std::string>& fileNames)
+	{
+		//	If the id has a dot, this means it has an extention, so we are dealing with a file
+		if (id.find_last_of('.') == std::string::npos)
+		{
+			ListFolder(mediaFolder, id, fileNames);
+		}
+		else if (const auto slashPos = id.find_last_of('/'); slashPos != std::string::npos)
+		{
+			ListFolder(mediaFolder, id.substr(0, slashPos), fileNames);
+		}
+		else
+		{
+			id = id.substr(0, id.find_first_of('_'));
+
+			GetFilesWithID(mediaFolder, fileNames, id);
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// Construction
+//--------------------------------------------------------------------------------------
+
+CSceneLoadPipeline::CSceneLoadPipeline(std::string mediaFolder, const SMeshImportSettings& meshSettings, unsigned int numThreads) :
+	mMediaFolder(std::move(mediaFolder)),
+	mMeshSettings(meshSettings),
+	mPool(numThreads)
+{
+}
+
+CSceneLoadPipeline::~CSceneLoadPipeline()
+{
+	// Don't leave decoded assets of a cancelled or failed load behind
+	mPool.wait_for_tasks();
+	CAssetCache::Instance().Clear();
+}
+
+void CSceneLoadPipeline::Add(SEntityDesc entity)
+{
+	mEntities.push_back(std::move(entity));
+}
+
+bool CSceneLoadPipeline::Run(const UploadFunction& upload)
+{
+	const auto done = Resolve() && Read() && Decode() && Upload(upload);
+
+	CAssetCache::Instance().Clear();
+
+	if (done) Report(ELoadStage::Done, mEntities.size(), mEntities.size());
+
+	return done;
+}
+
+template <typename F>
+bool CSceneLoadPipeline::ParallelFor(ELoadStage stage, size_t count, F&& job)
+{
+	std::atomic<size_t> completed = 0;
+
+	Report(stage, 0, count);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		mPool.push_task([this, &job, &completed, stage, count, i]
+			{
+				if (!mCancelled)
+				{
+					try
+					{
+						job(i);
+					}
+					catch (const std::exception&)
+					{
+						// Not fatal, see the header
+					}
+				}
+
+				Report(stage, ++completed, count);
+			});
+	}
+
+	mPool.wait_for_tasks();
+
+	return !mCancelled;
+}
+
+//--------------------------------------------------------------------------------------
+// Stages
+//--------------------------------------------------------------------------------------
+
+bool CSceneLoadPipeline::Resolve()
+{
+	CLoadScope stageScope("Resolve Stage", "stage");
+
+	const auto resolved = ParallelFor(ELoadStage::Resolve, mEntities.size(), [this](size_t i)
+		{
+			auto& entity = mEntities[i];
+
+			CLoadEntityScope entityScope(entity.name);
+			CLoadScope       scope("Resolve", "entity");
+
+			if (entity.type == EEntityType::Camera) return;
+
+			if (!entity.ID.empty())
+			{
+				std::vector<std::string> files;
+				ResolveID(mMediaFolder, entity.ID, files);
+
+				for (const auto& st : files)
+				{
+					if (st.find(".fbx") != std::string::npos) entity.meshFiles.push_back(mMediaFolder + st);
+					else if (st.find(".x") != std::string::npos)  entity.meshFiles.push_back(mMediaFolder + st);
+					else if (st.find(".png") != std::string::npos) entity.textureFiles.push_back(CookedTextureName(mMediaFolder + st));
+					else if (st.find(".dds") != std::string::npos) entity.textureFiles.push_back(mMediaFolder + st);
+					else if (st.find(".jpg") != std::string::npos) entity.textureFiles.push_back(CookedTextureName(mMediaFolder + st));
+				}
+
+				// Only the first mesh is loaded with the object, the other LODs are loaded on demand
+				if (entity.meshFiles.size() > 1) entity.meshFiles.resize(1);
+
+				// The materials sample these maps packed to one texture
+				if (FindOrmMaps(entity.textureFiles, entity.ormMaps) && entity.ormMaps.packed.empty())
+				{
+					entity.textureFiles.erase(std::remove_if(entity.textureFiles.begin(), entity.textureFiles.end(), [](const std::string& file)
+						{
+							const auto map = MaterialMap(file);
+							return map == EMaterialMap::AO || map == EMaterialMap::Roughness || map == EMaterialMap::Metalness || map == EMaterialMap::ORM;
+						}), entity.textureFiles.end());
+				}
+				else
+				{
+					entity.ormMaps = {};
+				}
+			}
+			else
+			{
+				if (!entity.mesh.empty())    entity.meshFiles.push_back(mMediaFolder + entity.mesh);
+				if (!entity.diffuse.empty()) entity.textureFiles.push_back(CookedTextureName(mMediaFolder + entity.diffuse));
+			}
+		});
+
+	if (!resolved) return false;
+
+	// Gather the unique files, several entities usually share the same light mesh or texture
+	std::unordered_set<std::string> seen;
+	std::vector<std::string>        textures;
+
+	mFiles.clear();
+	mOrmMaps.clear();
+	for (const auto& entity : mEntities)
+	{
+		for (const auto& file : entity.meshFiles)
+			if (seen.insert(file).second) mFiles.push_back(file);
+
+		for (const auto& file : entity.textureFiles)
+			if (seen.insert(file).second) textures.push_back(file);
+
+		if (entity.ormMaps.Empty()) continue;
+
+		// The cooked ORM texture is read like any other, otherwise the maps are read to be packed
+		if (const auto cooked = CookedOrmName(entity.ormMaps); !cooked.empty())
+		{
+			if (seen.insert(cooked).second) textures.push_back(cooked);
+			continue;
+		}
+
+		if (!seen.insert(OrmFileName(entity.ormMaps)).second) continue;
+
+		mOrmMaps.push_back(entity.ormMaps);
+		for (const auto file : { &entity.ormMaps.ao, &entity.ormMaps.roughness, &entity.ormMaps.metalness })
+			if (!file->empty() && seen.insert(*file).second) textures.push_back(*file);
+	}
+
+	mNumMeshFiles = mFiles.size();
+	mFiles.insert(mFiles.end(), textures.begin(), textures.end());
+
+	return true;
+}
+
+bool CSceneLoadPipeline::Read()
+{
+	CLoadScope stageScope("Read Stage", "stage");
+
+	mFileData.assign(mFiles.size(), nullptr);
+
+	return ParallelFor(ELoadStage::Read, mFiles.size(), [this](size_t i)
+		{
+			mFileData[i] = ReadFileBytes(mFiles[i]);
+		});
+}
+
+bool CSceneLoadPipeline::Decode()
+{
+	CLoadScope stageScope("Decode Stage", "stage");
+
+	const auto decoded = ParallelFor(ELoadStage::Decode, mFiles.size(), [this](size_t i)
+		{
+			// Release the file contents as soon as they are decoded
+			const auto data = std::move(mFileData[i]);
+
+			if (i < mNumMeshFiles)
+			{
+				CAssetCache::Instance().StoreMesh(mFiles[i], mMeshSettings, DecodeMesh(mFiles[i], mMeshSettings, data));
+			}
+			else
+			{
+				CAssetCache::Instance().StoreTexture(mFiles[i], DecodeTexture(mFiles[i], data));
+			}
+		});
+
+	mFileData.clear();
+
+	if (!decoded) return false;
+
+	// Their maps are all in the cache now
+	return ParallelFor(ELoadStage::Decode, mOrmMaps.size(), [this](size_t i)
+		{
+			CAssetCache::Instance().StoreTexture(OrmFileName(mOrmMaps[i]), CAssetCache::Instance().Orm(mOrmMaps[i]));
+		});
+}
+
+bool CSceneLoadPipeline::Upload(const UploadFunction& upload)
+{
+	CLoadScope stageScope("Upload Stage", "stage");
+
+	// The backends create their resources under the engine mutex anyway, so do it on this thread only
+	Report(ELoadStage::Upload, 0, mEntities.size());
+
+	for (size_t i = 0; i < mEntities.size(); ++i)
+	{
+		if (mCancelled) return false;
+
+		{
+			CLoadEntityScope entityScope(mEntities[i].name);
+			CLoadScope       scope("Upload", "entity");
+
+			upload(mEntities[i]);
+		}
+
+		Report(ELoadStage::Upload, i + 1, mEntities.size());
+	}
+
+	return !mCancelled;
+}
+
+//--------------------------------------------------------------------------------------
+// Control
+//--------------------------------------------------------------------------------------
+
+void CSceneLoadPipeline::Cancel()
+{
+	mCancelled = true;
+}
+
+bool CSceneLoadPipeline::Cancelled() const
+{
+	return mCancelled;
+}
+
+void CSceneLoadPipeline::SetProgressCallback(ProgressCallback callback)
+{
+	std::unique_lock l(mProgressMutex);
+	mProgressCallback = std::move(callback);
+}
+
+unsigned int CSceneLoadPipeline::NumThreads() const
+{
+	return static_cast<unsigned int>(mPool.get_thread_count());
+}
+
+void CSceneLoadPipeline::Report(ELoadStage stage, size_t completed, size_t total)
+{
+	std::unique_lock l(mProgressMutex);
+	if (mProgressCallback) mProgressCallback({ stage, completed, total });
+}
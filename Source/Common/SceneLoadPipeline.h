@@ -0,0 +1,157 @@
+//--------------------------------------------------------------------------------------
+// Staged scene loading
+//--------------------------------------------------------------------------------------
+// XML parse -> asset path resolution -> parallel file reads -> parallel mesh / texture
+// decode -> GPU upload on the calling thread.
+// The parse is done by the level importer, which then hands the entities over.
+// Resolve, Read and Decode run on every core and never touch the GPU, the decoded
+// assets are left in the CAssetCache for the backend constructors called by Upload.
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <thread_pool.hpp>
+
+#include "AssetCache.h"
+#include "MaterialMaps.h"
+#include "../Math/CVector3.h"
+
+enum class EEntityType
+{
+	GameObject,
+	Light,
+	PointLight,
+	DirectionalLight,
+	SpotLight,
+	Sky,
+	Plant,
+	Camera
+};
+
+// Everything the importer reads from an <Entity> element
+struct SEntityDesc
+{
+	EEntityType type = EEntityType::GameObject;
+
+	std::string name;
+	std::string ID;
+	std::string mesh;
+	std::string diffuse;
+
+	CVector3 position = { 0,0,0 };
+	CVector3 rotation = { 0,0,0 };
+	float    scale    = 1.0f;
+
+	CVector3 colour   = { 0,0,0 };
+	float    strength = 0;
+
+	// Filled by the resolve stage, full paths
+	std::vector<std::string> meshFiles;
+	std::vector<std::string> textureFiles;
+	SOrmMaps                 ormMaps; // Taken out of the texture files, loaded as one ORM texture
+};
+
+enum class ELoadStage
+{
+	Parse,
+	Resolve,
+	Read,
+	Decode,
+	Upload,
+	Done
+};
+
+struct SLoadProgress
+{
+	ELoadStage stage;
+	size_t     completed;
+	size_t     total;
+};
+
+class CSceneLoadPipeline
+{
+public:
+
+	// Called from the worker threads as well, calls are serialised
+	using ProgressCallback = std::function<void(const SLoadProgress&)>;
+
+	using UploadFunction = std::function<void(const SEntityDesc&)>;
+
+	// numThreads = 0 uses every hardware thread
+	CSceneLoadPipeline(std::string mediaFolder, const SMeshImportSettings& meshSettings, unsigned int numThreads = 0);
+
+	CSceneLoadPipeline(const CSceneLoadPipeline&) = delete;
+	CSceneLoadPipeline(const CSceneLoadPipeline&&) = delete;
+	CSceneLoadPipeline& operator=(const CSceneLoadPipeline&) = delete;
+	CSceneLoadPipeline& operator=(const CSceneLoadPipeline&&) = delete;
+
+	~CSceneLoadPipeline();
+
+	void Add(SEntityDesc entity);
+
+	// Run all the stages in order. Returns false if the load was cancelled,
+	// entities uploaded before the cancellation stay in the scene
+	bool Run(const UploadFunction& upload);
+
+	//--------------------------------------------------------------------------------------
+	// Single stages
+	//--------------------------------------------------------------------------------------
+	// A failure to resolve, read or decode an asset is not fatal, the backend constructor
+	// loads it again during the upload and reports the error the same way it always did
+
+	bool Resolve();
+
+	bool Read();
+
+	bool Decode();
+
+	bool Upload(const UploadFunction& upload);
+
+	//--------------------------------------------------------------------------------------
+	// Control
+	//--------------------------------------------------------------------------------------
+
+	// Can be called from any thread, the running stage stops as soon as its current tasks end
+	void Cancel();
+
+	bool Cancelled() const;
+
+	void SetProgressCallback(ProgressCallback callback);
+
+	const std::vector<SEntityDesc>& Entities() const { return mEntities; }
+
+	unsigned int NumThreads() const;
+
+private:
+
+	void Report(ELoadStage stage, size_t completed, size_t total);
+
+	// Run job(i) for every i in [0, count) on the pool and wait for all of them
+	template <typename F>
+	bool ParallelFor(ELoadStage stage, size_t count, F&& job);
+
+	std::string         mMediaFolder;
+	SMeshImportSettings mMeshSettings;
+
+	std::vector<SEntityDesc> mEntities;
+
+	// Unique files referenced by the entities, meshes first
+	std::vector<std::string> mFiles;
+	std::vector<FileBytes>   mFileData;
+	size_t                   mNumMeshFiles = 0;
+
+	// Maps without a current cooked ORM texture, packed once they are decoded
+	std::vector<SOrmMaps> mOrmMaps;
+
+	std::atomic<bool> mCancelled = false;
+
+	std::mutex       mProgressMutex;
+	ProgressCallback mProgressCallback;
+
+	thread_pool mPool;
+};
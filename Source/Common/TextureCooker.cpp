@@ -0,0 +1,380 @@
+#include "TextureCooker.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+#include "DirectXTex.h"
+
+#include "MaterialMaps.h"
+#include "../Utility/HelperFunctions.h"
+
+// Only this file decodes with stb_image, keep its functions to it
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+namespace
+{
+	// Changing how the textures are cooked makes every manifest entry out of date
+	constexpr int CookVersion = 1;
+
+	std::vector<uint8_t> ReadSource(const std::string& fileName)
+	{
+		std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+		if (!file) throw std::runtime_error("Cannot open the texture " + fileName);
+
+		std::vector<uint8_t> data(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+
+		if (!file) throw std::runtime_error("Cannot read the texture " + fileName);
+
+		return data;
+	}
+
+	std::string& OrmChannel(SOrmMaps& maps, EMaterialMap map)
+	{
+		return map == EMaterialMap::AO ? maps.ao : map == EMaterialMap::Roughness ? maps.roughness : maps.metalness;
+	}
+
+	DXGI_FORMAT CookedFormat(ETextureKind kind, bool fast, bool opaque)
+	{
+		switch (kind)
+		{
+		case ETextureKind::Normal:     return DXGI_FORMAT_BC5_UNORM;
+		case ETextureKind::Mask:       return DXGI_FORMAT_BC4_UNORM;
+		case ETextureKind::PackedMask: return DXGI_FORMAT_BC7_UNORM;
+		default:                       return fast && opaque ? DXGI_FORMAT_BC1_UNORM : DXGI_FORMAT_BC7_UNORM;
+		}
+	}
+
+	// Compresses the mips if they are made of whole blocks and writes them, returns the size of the file
+	uint64_t Save(const DirectX::ScratchImage& mips, ETextureKind kind, bool fast, const std::filesystem::path& ddsName)
+	{
+		const auto& metadata = mips.GetMetadata();
+
+		// D3D needs the largest mip of a block compressed texture made of whole blocks
+		const auto* cooked = &mips;
+		DirectX::ScratchImage compressed;
+		if (metadata.width % 4 == 0 && metadata.height % 4 == 0)
+		{
+			const auto format = CookedFormat(kind, fast, mips.IsAlphaAllOpaque());
+
+			auto flags = DirectX::TEX_COMPRESS_PARALLEL;
+			if (fast) flags |= DirectX::TEX_COMPRESS_BC7_QUICK;
+
+			if (FAILED(DirectX::Compress(mips.GetImages(), mips.GetImageCount(), metadata, format, flags, DirectX::TEX_THRESHOLD_DEFAULT, compressed)))
+			{
+				throw std::runtime_error("Failed to compress " + ddsName.string());
+			}
+
+			cooked = &compressed;
+		}
+
+		DirectX::Blob dds;
+		if (FAILED(DirectX::SaveToDDSMemory(cooked->GetImages(), cooked->GetImageCount(), cooked->GetMetadata(), DirectX::DDS_FLAGS_NONE, dds)))
+		{
+			throw std::runtime_error("Failed to write " + ddsName.string());
+		}
+
+		// Written aside then renamed, a loader never sees half a file
+		auto temporary = ddsName;
+		temporary += ".tmp";
+
+		{
+			std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+			file.write(static_cast<const char*>(dds.GetBufferPointer()), static_cast<std::streamsize>(dds.GetBufferSize()));
+			if (!file) throw std::runtime_error("Cannot write " + ddsName.string());
+		}
+
+		std::error_code ec;
+		std::filesystem::rename(temporary, ddsName, ec);
+		if (ec) throw std::runtime_error("Cannot write " + ddsName.string() + ": " + ec.message());
+
+		return dds.GetBufferSize();
+	}
+}
+
+ETextureKind TextureKind(const std::string& fileName)
+{
+	switch (MaterialMap(fileName))
+	{
+	case EMaterialMap::ORM:          return ETextureKind::PackedMask;
+	case EMaterialMap::Normal:       return ETextureKind::Normal;
+	case EMaterialMap::Roughness:
+	case EMaterialMap::AO:
+	case EMaterialMap::Displacement:
+	case EMaterialMap::Metalness:    return ETextureKind::Mask;
+
+	// Albedo and diffuse maps, skies and sprites
+	default:                         return ETextureKind::Albedo;
+	}
+}
+
+DirectX::ScratchImage DecodeImage(const std::string& fileName, const uint8_t* data, size_t size)
+{
+	int width, height, channels;
+	const std::unique_ptr<stbi_uc, decltype(&stbi_image_free)> pixels(
+		stbi_load_from_memory(data, static_cast<int>(size), &width, &height, &channels, 4), &stbi_image_free);
+
+	if (!pixels) throw std::runtime_error("Failed to decode the texture " + fileName + ": " + stbi_failure_reason());
+
+	DirectX::ScratchImage image;
+	if (FAILED(image.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, width, height, 1, 1))) throw std::runtime_error("Out of memory decoding " + fileName);
+
+	const auto top = image.GetImage(0, 0, 0);
+	for (int y = 0; y < height; ++y)
+	{
+		std::memcpy(top->pixels + y * top->rowPitch, pixels.get() + static_cast<size_t>(y) * width * 4, static_cast<size_t>(width) * 4);
+	}
+
+	return image;
+}
+
+CTextureCooker::CTextureCooker(const STextureCookSettings& settings) :
+	mSettings(settings),
+	mPool(settings.numThreads)
+{
+}
+
+STextureCookStats CTextureCooker::CookFolder(const std::string& folder)
+{
+	std::vector<std::string> fileNames;
+
+	std::error_code ec;
+	for (auto iter = std::filesystem::recursive_directory_iterator(folder, ec); !ec && iter != std::filesystem::recursive_directory_iterator(); iter.increment(ec))
+	{
+		if (iter->is_regular_file() && IsSource(iter->path().string())) fileNames.push_back(iter->path().generic_string());
+	}
+
+	if (ec) throw std::runtime_error("Error accessing " + folder + ": " + ec.message());
+
+	return Cook(fileNames);
+}
+
+STextureCookStats CTextureCooker::Cook(const std::vector<std::string>& fileNames)
+{
+	// One cooked texture: a source, or the maps of a material packed together
+	struct STask
+	{
+		std::string folder;
+		std::string name; // In the manifest
+		std::string source;
+		SOrmMaps    orm;
+	};
+
+	struct SResult
+	{
+		bool        cooked   = false;
+		uint64_t    source   = 0;
+		uint64_t    dds      = 0;
+		std::string entry;
+		std::string error;
+	};
+
+	std::vector<STask> tasks;
+	std::unordered_map<std::string, size_t> ormTasks; // By the name of the ORM texture
+	for (const auto& fileName : fileNames)
+	{
+		const auto path = std::filesystem::path(fileName);
+		const auto map = MaterialMap(fileName);
+
+		if (map != EMaterialMap::AO && map != EMaterialMap::Roughness && map != EMaterialMap::Metalness)
+		{
+			tasks.push_back({ path.parent_path().string(), path.filename().string(), fileName, {} });
+			continue;
+		}
+
+		// The maps of a material all give the same ORM name
+		SOrmMaps maps;
+		OrmChannel(maps, map) = fileName;
+		const auto ormName = OrmFileName(maps);
+
+		const auto [task, added] = ormTasks.try_emplace(ormName, tasks.size());
+		if (added) tasks.push_back({ path.parent_path().string(), std::filesystem::path(ormName).filename().string(), {}, {} });
+
+		OrmChannel(tasks[task->second].orm, map) = fileName;
+	}
+
+	// Read before the jobs start, they only look them up
+	std::unordered_map<std::string, Manifest> manifests;
+	for (const auto& task : tasks)
+	{
+		if (!manifests.count(task.folder)) manifests[task.folder] = ReadManifest(task.folder);
+	}
+
+	std::vector<std::future<SResult>> jobs;
+	for (const auto& task : tasks)
+	{
+		const auto& manifest = manifests[task.folder];
+		const auto  listed = manifest.find(task.name);
+		const auto  previous = listed == manifest.end() ? std::string() : listed->second;
+
+		jobs.push_back(mPool.submit([this, task, previous]
+		{
+			SResult result;
+			try
+			{
+				const auto packed = !task.orm.Empty();
+				const auto sources = packed ? std::vector<std::string>{ task.orm.ao, task.orm.roughness, task.orm.metalness } : std::vector<std::string>{ task.source };
+
+				// A missing map changes the hash as much as a different one
+				std::vector<std::vector<uint8_t>> data;
+				auto hash = Hash({});
+				for (size_t i = 0; i < sources.size(); ++i)
+				{
+					data.push_back(sources[i].empty() ? std::vector<uint8_t>() : ReadSource(sources[i]));
+					hash = sources[i].empty() ? Hash({ static_cast<uint8_t>(i) }, hash) : Hash(data.back(), hash);
+				}
+
+				result.entry = Entry(hash);
+
+				std::error_code ec;
+				const auto ddsName = packed ? std::filesystem::path(OrmFileName(task.orm)) : CookedTexturePath(task.source);
+				if (!mSettings.force && result.entry == previous && std::filesystem::exists(ddsName, ec)) return result;
+
+				result.dds = packed ? CookOrm(task.orm, data, mSettings.fast) : CookFile(task.source, data[0], mSettings.fast);
+				for (const auto& bytes : data) result.source += bytes.size();
+				result.cooked = true;
+			}
+			catch (const std::exception& e)
+			{
+				result.entry.clear();
+				result.error = e.what();
+			}
+			return result;
+		}));
+	}
+
+	STextureCookStats stats;
+	for (size_t i = 0; i < jobs.size(); ++i)
+	{
+		const auto result = jobs[i].get();
+		auto&      manifest = manifests[tasks[i].folder];
+
+		if (!result.error.empty())
+		{
+			// Cooked again next time
+			manifest.erase(tasks[i].name);
+			stats.errors.push_back(result.error);
+			++stats.failed;
+			continue;
+		}
+
+		manifest[tasks[i].name] = result.entry;
+
+		if (result.cooked)
+		{
+			++stats.cooked;
+			stats.sourceBytes += result.source;
+			stats.cookedBytes += result.dds;
+		}
+		else
+		{
+			++stats.upToDate;
+		}
+	}
+
+	for (const auto& [folder, manifest] : manifests)
+	{
+		try
+		{
+			WriteManifest(folder, manifest);
+		}
+		catch (const std::exception& e)
+		{
+			stats.errors.push_back(e.what());
+		}
+	}
+
+	return stats;
+}
+
+uint64_t CTextureCooker::CookFile(const std::string& fileName, const std::vector<uint8_t>& data, bool fast)
+{
+	const auto image = DecodeImage(fileName, data.data(), data.size());
+	const auto kind = TextureKind(fileName);
+
+	// Colours are stored in sRGB but the shaders read them as they are, average them in linear space only
+	auto filter = DirectX::TEX_FILTER_FORCE_NON_WIC;
+	if (kind == ETextureKind::Albedo) filter |= DirectX::TEX_FILTER_SRGB;
+
+	DirectX::ScratchImage mips;
+	if (FAILED(DirectX::GenerateMipMaps(*image.GetImage(0, 0, 0), filter, 0, mips))) throw std::runtime_error("Failed to generate the mips of " + fileName);
+
+	return Save(mips, kind, fast, CookedTexturePath(fileName));
+}
+
+uint64_t CTextureCooker::CookOrm(const SOrmMaps& maps, const std::vector<std::vector<uint8_t>>& data, bool fast)
+{
+	const std::string* fileNames[] = { &maps.ao, &maps.roughness, &maps.metalness };
+
+	DirectX::ScratchImage images[3];
+	for (size_t i = 0; i < 3; ++i)
+	{
+		if (!fileNames[i]->empty()) images[i] = DecodeImage(*fileNames[i], data[i].data(), data[i].size());
+	}
+
+	const auto image = [&images](size_t i) { return images[i].GetImageCount() ? &images[i] : nullptr; };
+
+	return Save(*PackOrm(image(0), image(1), image(2)), ETextureKind::PackedMask, fast, OrmFileName(maps));
+}
+
+bool CTextureCooker::IsSource(const std::string& fileName)
+{
+	return IsTextureSource(fileName);
+}
+
+uint64_t CTextureCooker::Hash(const std::vector<uint8_t>& data, uint64_t hash)
+{
+	for (const auto byte : data)
+	{
+		hash ^= byte;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+CTextureCooker::Manifest CTextureCooker::ReadManifest(const std::string& folder)
+{
+	Manifest manifest;
+
+	// No manifest yet, everything gets cooked
+	std::ifstream file(std::filesystem::path(folder) / ManifestName);
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		// <hash> <settings> <file name>, the name last since it may have spaces
+		std::istringstream fields(line);
+		std::string hash, settings, name;
+		if (!(fields >> hash >> settings)) continue;
+
+		std::getline(fields >> std::ws, name);
+		if (!name.empty()) manifest[name] = hash + ' ' + settings;
+	}
+
+	return manifest;
+}
+
+void CTextureCooker::WriteManifest(const std::string& folder, const Manifest& manifest)
+{
+	const auto fileName = std::filesystem::path(folder) / ManifestName;
+
+	std::ofstream file(fileName, std::ios::trunc);
+	for (const auto& [name, entry] : manifest) file << entry << ' ' << name << '\n';
+
+	if (!file) throw std::runtime_error("Cannot write the texture manifest " + fileName.string());
+}
+
+std::string CTextureCooker::Entry(uint64_t hash) const
+{
+	std::ostringstream entry;
+	entry << std::hex << hash << std::dec << " v" << CookVersion << (mSettings.fast ? "-fast" : "-best");
+	return entry.str();
+}
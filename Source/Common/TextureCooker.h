@@ -0,0 +1,114 @@
+//--------------------------------------------------------------------------------------
+// Offline texture cooker
+//--------------------------------------------------------------------------------------
+// Turns the PNG / JPG / TGA / BMP textures of the media folder into DDS files written next
+// to them (same name, .dds extension), with their whole mip chain and block compressed:
+//  - albedo and single colour textures: BC7, or BC1 when cooking fast and they are opaque,
+//    with the mips filtered in linear space since they hold sRGB colours
+//  - normal maps: BC5, x and y only, the shaders rebuild z
+//  - displacement maps: BC4
+//  - the AO, roughness and metalness maps of a material, packed to one ORM texture (see
+//    MaterialMaps.h), and packed masks that come as they are: BC7
+// Textures whose size is not made of whole 4x4 blocks keep RGBA8 and only get their mips.
+// Every folder has a manifest with the hash of the contents of each source (of all the maps
+// for an ORM texture) and the settings it was cooked with, so only the textures that changed
+// are cooked again.
+// The loaders prefer the cooked file when there is one (see CookedTextureName).
+// Nothing here depends on Windows or the GPU: the images are decoded with stb_image and
+// compressed with the CPU codecs of DirectXTex, several files at once on a thread pool.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <thread_pool.hpp>
+
+#include "MaterialMaps.h"
+
+namespace DirectX
+{
+	class ScratchImage;
+}
+
+enum class ETextureKind
+{
+	Albedo,
+	Normal,
+	Mask,
+	PackedMask
+};
+
+// From the file name, with the same names the materials pick their maps by
+ETextureKind TextureKind(const std::string& fileName);
+
+// The whole image as RGBA8, without mips. Also how the loaders decode textures where there is no WIC
+// Will throw a std::runtime_error exception if the image cannot be decoded
+DirectX::ScratchImage DecodeImage(const std::string& fileName, const uint8_t* data, size_t size);
+
+struct STextureCookSettings
+{
+	bool         fast       = false; // BC1 for opaque albedo, quicker BC7
+	bool         force      = false; // Cook even the textures the manifest says are up to date
+	unsigned int numThreads = 0;     // 0 uses every hardware thread
+};
+
+struct STextureCookStats
+{
+	uint32_t cooked      = 0;
+	uint32_t upToDate    = 0;
+	uint32_t failed      = 0;
+	uint64_t sourceBytes = 0; // Of the textures cooked
+	uint64_t cookedBytes = 0;
+
+	std::vector<std::string> errors;
+};
+
+class CTextureCooker
+{
+public:
+
+	static constexpr const char* ManifestName = "CookedTextures.manifest";
+
+	CTextureCooker(const CTextureCooker&) = delete;
+	CTextureCooker(const CTextureCooker&&) = delete;
+	CTextureCooker& operator=(const CTextureCooker&) = delete;
+	CTextureCooker& operator=(const CTextureCooker&&) = delete;
+
+	explicit CTextureCooker(const STextureCookSettings& settings = {});
+
+	// Cooks every source texture in the folder and its sub folders
+	STextureCookStats CookFolder(const std::string& folder);
+
+	// A file that fails does not stop the others, its error is in the stats
+	STextureCookStats Cook(const std::vector<std::string>& fileNames);
+
+	// Will throw a std::runtime_error exception if the file cannot be decoded, compressed or written
+	// Returns the size of the DDS file
+	static uint64_t CookFile(const std::string& fileName, const std::vector<uint8_t>& data, bool fast);
+
+	// Packs the maps to OrmFileName, the data of the missing ones is ignored
+	// data is in the order of the channels: AO, roughness and metalness
+	static uint64_t CookOrm(const SOrmMaps& maps, const std::vector<std::vector<uint8_t>>& data, bool fast);
+
+	static bool IsSource(const std::string& fileName);
+
+	// 64 bit FNV-1a, carried on from hash to cover several files
+	static uint64_t Hash(const std::vector<uint8_t>& data, uint64_t hash = 14695981039346656037ull);
+
+private:
+
+	// Source file name (without the folder) to its manifest line
+	using Manifest = std::unordered_map<std::string, std::string>;
+
+	static Manifest ReadManifest(const std::string& folder);
+	static void     WriteManifest(const std::string& folder, const Manifest& manifest);
+
+	// What a manifest line holds: the hash of the source and the settings that change the output
+	std::string Entry(uint64_t hash) const;
+
+	STextureCookSettings mSettings;
+	thread_pool          mPool;
+};
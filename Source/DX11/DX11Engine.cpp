@@ -7,6 +7,7 @@
 #include "DX11Gui.h"
 #include "../Utility/Input.h"
 
+#include "../Common/AssetCache.h"
 #include "../Common/CGameObjectManager.h"
 #include "DX11Scene.h"
 #include "Objects/DX11DirLight.h"
@@ -467,4 +468,9 @@ namespace DX11
 		mObjManager->AddPointLight(p);
 		return p;
 	}
+
+	SMeshImportSettings CDX11Engine::MeshImportSettings() const
+	{
+		return CDX11Mesh::ImportSettings();
+	}
 }
@@ -5,6 +5,7 @@
 #include <d3d11_1.h>
 #include <mutex>
 
+struct SOrmMaps;
 
 namespace DX11
 {
@@ -172,6 +173,10 @@ class CDX11Gui;
 
 			bool LoadTexture(std::string filename, ID3D11Resource** texture, ID3D11ShaderResourceView** textureSRV);
 
+			// The AO, roughness and metalness maps packed in one texture (names in the media folder), from the
+			// cooked file if it is current
+			bool LoadOrmTexture(SOrmMaps maps, ID3D11Resource** texture, ID3D11ShaderResourceView** textureSRV);
+
 			bool SaveTextureToFile(ID3D11Resource* tex, std::string& fileName);
 
 			//--------------------------------------------------------------------------------------
@@ -236,6 +241,8 @@ class CDX11Gui;
 					CVector3 position,
 					CVector3 rotation,
 					float scale) override;
+
+			SMeshImportSettings MeshImportSettings() const override;
 	};
 	
 }
@@ -13,14 +13,12 @@ namespace DX11
 
 		mPbrMaps.Albedo = nullptr;
 		mPbrMaps.AlbedoSRV = nullptr;
-		mPbrMaps.AO = nullptr;
-		mPbrMaps.AoSRV = nullptr;
+		mPbrMaps.ORM = nullptr;
+		mPbrMaps.OrmSRV = nullptr;
 		mPbrMaps.Displacement = nullptr;
 		mPbrMaps.DisplacementSRV = nullptr;
 		mPbrMaps.Normal = nullptr;
 		mPbrMaps.NormalSRV = nullptr;
-		mPbrMaps.Roughness = nullptr;
-		mPbrMaps.RoughnessSRV = nullptr;
 
 		mMapsStr = fileMaps;
 
@@ -58,16 +56,12 @@ namespace DX11
 
 		mPbrMaps.Albedo = nullptr;
 		mPbrMaps.AlbedoSRV = nullptr;
-		mPbrMaps.AO = nullptr;
-		mPbrMaps.AoSRV = nullptr;
+		mPbrMaps.ORM = nullptr;
+		mPbrMaps.OrmSRV = nullptr;
 		mPbrMaps.Displacement = nullptr;
 		mPbrMaps.DisplacementSRV = nullptr;
 		mPbrMaps.Normal = nullptr;
 		mPbrMaps.NormalSRV = nullptr;
-		mPbrMaps.Roughness = nullptr;
-		mPbrMaps.RoughnessSRV = nullptr;
-		mPbrMaps.Metalness = nullptr;
-		mPbrMaps.MetalnessSRV = nullptr;
 
 		mMapsStr = m.mMapsStr;
 
@@ -119,17 +113,20 @@ namespace DX11
 			// Send PBR Maps
 			//************************
 
-			if (mPbrMaps.AO)
+			// AO, roughness and metalness in one texture, the maps it was packed from say which values are used
+			if (mPbrMaps.ORM)
 			{
-				mEngine->GetContext()->PSSetShaderResources(1, 1, mPbrMaps.AoSRV.GetAddressOf());
-				gPerModelConstants.hasAoMap = 1.0f;
+				mEngine->GetContext()->PSSetShaderResources(1, 1, mPbrMaps.OrmSRV.GetAddressOf());
 			}
 			else
 			{
 				mEngine->GetContext()->PSSetShaderResources(1, 1, &nullSRV);
-				gPerModelConstants.hasAoMap = 0.0f;
 			}
 
+			gPerModelConstants.hasAoMap = mOrmMaps.HasAo() ? 1.0f : 0.0f;
+			gPerModelConstants.hasRoughnessMap = mOrmMaps.HasRoughness() ? 1.0f : 0.0f;
+			gPerModelConstants.hasMetallnessMap = mOrmMaps.HasMetalness() ? 1.0f : 0.0f;
+
 			if (mPbrMaps.Displacement)
 			{
 				mEngine->GetContext()->PSSetShaderResources(2, 1, mPbrMaps.DisplacementSRV.GetAddressOf());
@@ -148,29 +145,6 @@ namespace DX11
 				mEngine->GetContext()->PSSetShaderResources(3, 1, &nullSRV);
 			}
 
-			if (mPbrMaps.Roughness)
-			{
-				mEngine->GetContext()->PSSetShaderResources(4, 1, mPbrMaps.RoughnessSRV.GetAddressOf());
-				gPerModelConstants.hasRoughnessMap = 1.0f;
-			}
-			else
-			{
-				mEngine->GetContext()->PSSetShaderResources(4, 1, &nullSRV);
-				gPerModelConstants.hasRoughnessMap = 0.0f;
-			}
-
-			if (mPbrMaps.Metalness)
-			{
-				mEngine->GetContext()->PSSetShaderResources(5, 1, mPbrMaps.MetalnessSRV.GetAddressOf());
-				gPerModelConstants.hasMetallnessMap = 1.0f;
-			}
-			else
-			{
-
-				mEngine->GetContext()->PSSetShaderResources(5, 1, &nullSRV);
-				gPerModelConstants.hasMetallnessMap = 0.0f;
-			}
-
 		}
 	}
 
@@ -210,40 +184,25 @@ namespace DX11
 
 				//load it
 
-				if (fileName.find("Albedo") != std::string::npos)
+				switch (MaterialMap(fileName))
 				{
+				case EMaterialMap::Albedo:
 					//found albedo map
 					if (!mEngine->LoadTexture(originalFileName, mPbrMaps.Albedo.GetAddressOf(), mPbrMaps.AlbedoSRV.GetAddressOf()))
 					{
 						throw std::runtime_error("Error Loading: " + fileName);
 					}
-				}
-				else if (fileName.find("Roughness") != std::string::npos)
-				{
-					//roughness map
-					if (!mEngine->LoadTexture(originalFileName, mPbrMaps.Roughness.GetAddressOf(), mPbrMaps.RoughnessSRV.GetAddressOf()))
-					{
-						throw std::runtime_error("Error Loading: " + fileName);
-					}
-				}
-				else if (fileName.find("AO") != std::string::npos)
-				{
-					//ambient occlusion map
-					if (!mEngine->LoadTexture(originalFileName, mPbrMaps.AO.GetAddressOf(), mPbrMaps.AoSRV.GetAddressOf()))
-					{
-						throw std::runtime_error("Error Loading: " + fileName);
-					}
-				}
-				else if (fileName.find("Displacement") != std::string::npos)
-				{
+					break;
+
+				case EMaterialMap::Displacement:
 					//found displacement map
 					if (!mEngine->LoadTexture(originalFileName, mPbrMaps.Displacement.GetAddressOf(), mPbrMaps.DisplacementSRV.GetAddressOf()))
 					{
 						throw std::runtime_error("Error Loading: " + fileName);
 					}
-				}
-				else if (fileName.find("Normal") != std::string::npos)
-				{
+					break;
+
+				case EMaterialMap::Normal:
 					//TODO include LOD
 					//
 					//normal map
@@ -253,14 +212,19 @@ namespace DX11
 					}
 
 					mHasNormals = true;
+					break;
+
+				default:
+					// Roughness, AO and metalness are loaded together below
+					break;
 				}
-				else if (fileName.find("Metalness") != std::string::npos)
+			}
+
+			if (FindOrmMaps(fileMaps, mOrmMaps))
+			{
+				if (!mEngine->LoadOrmTexture(mOrmMaps, mPbrMaps.ORM.GetAddressOf(), mPbrMaps.OrmSRV.GetAddressOf()))
 				{
-					// Metallness Map
-					if (!mEngine->LoadTexture(originalFileName, mPbrMaps.Metalness.GetAddressOf(), mPbrMaps.MetalnessSRV.GetAddressOf()))
-					{
-						throw std::runtime_error("Error Loading: " + fileName);
-					}
+					throw std::runtime_error("Error Loading: " + OrmFileName(mOrmMaps));
 				}
 			}
 		}
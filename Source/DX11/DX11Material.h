@@ -5,6 +5,7 @@
 #include "d3d11.h"
 
 #include "DX11Engine.h"
+#include "../Common/MaterialMaps.h"
 
 
 namespace DX11
@@ -19,7 +20,8 @@ namespace DX11
 
 		// Requires a vector of filemaps
 		// Formats: NAME_RESOLUTION_TYPE.EXTENTION
-		// Types supported: Albedo,AmbientOccusion,Displacement,Roughness,Metallness
+		// Types supported: Albedo,AmbientOccusion,Displacement,Roughness,Metallness,ORM
+		// The AO, roughness and metalness maps are used packed to one ORM texture
 		// It will set automatically the correct shaders depending on the use (Normals = PBR / No Normals = PBRNoNormals)
 		CDX11Material(std::vector<std::string> fileMaps, CDX11Engine* engine);
 
@@ -56,6 +58,8 @@ namespace DX11
 
 		bool mHasNormals;
 
+		SOrmMaps mOrmMaps;
+
 		//for regular models
 		ComPtr<ID3D11VertexShader> mVertexShader;
 		ComPtr<ID3D11PixelShader> mPixelShader;
@@ -65,16 +69,12 @@ namespace DX11
 		{
 			ComPtr<ID3D11Resource>           Albedo;
 			ComPtr<ID3D11ShaderResourceView> AlbedoSRV;
-			ComPtr<ID3D11Resource>           AO;
-			ComPtr<ID3D11ShaderResourceView> AoSRV;
+			ComPtr<ID3D11Resource>           ORM;
+			ComPtr<ID3D11ShaderResourceView> OrmSRV;
 			ComPtr<ID3D11Resource>           Displacement;
 			ComPtr<ID3D11ShaderResourceView> DisplacementSRV;
 			ComPtr<ID3D11Resource>           Normal;
 			ComPtr<ID3D11ShaderResourceView> NormalSRV;
-			ComPtr<ID3D11Resource>           Roughness;
-			ComPtr<ID3D11ShaderResourceView> RoughnessSRV;
-			ComPtr<ID3D11Resource>           Metalness;
-			ComPtr<ID3D11ShaderResourceView> MetalnessSRV;
 		};
 
 		sPbrMaps mPbrMaps;
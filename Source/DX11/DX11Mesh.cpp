@@ -19,23 +19,13 @@
 #include <memory>
 #include <stdexcept>
 
+#include "../Common/AssetCache.h"
+#include "../Utility/LoadProfiler.h"
+
 namespace DX11
 {
-	// Pass the name of the mesh file to load. Uses assimp (http://www.assimp.org/) to support many file types
-	// Optionally request tangents to be calculated (for normal and parallax mapping - see later lab)
-	// Will throw a std::runtime_error exception on failure (since constructors can't return errors).
-	CDX11Mesh::CDX11Mesh(CDX11Engine* engine, const std::string& fileNameN, bool requireTangents /*= false*/)
+	SMeshImportSettings CDX11Mesh::ImportSettings()
 	{
-
-		mEngine = engine;
-
-		mFileName = fileNameN;
-		hasTangents = requireTangents;
-
-		auto fileName = engine->GetMediaFolder() + fileNameN;
-
-		Assimp::Importer importer;
-
 		// Flags for processing the mesh. Assimp provides a huge amount of control - right click any of these
 		// and "Peek Definition" to see documention above each constant
 		unsigned int assimpFlags = aiProcess_MakeLeftHanded |
@@ -58,42 +48,35 @@ namespace DX11
 			aiProcess_SplitByBoneCount |
 			aiProcess_LimitBoneWeights |
 			aiProcess_RemoveComponent |
-			aiProcess_OptimizeGraph;
+			aiProcess_OptimizeGraph |
+			aiProcess_CalcTangentSpace;
 
 		// Flags to specify what mesh data to ignore
+		// Tangents are always calculated so the same import serves meshes with and without normal maps
 		auto removeComponents = aiComponent_LIGHTS | aiComponent_CAMERAS | aiComponent_TEXTURES | aiComponent_COLORS |
 			aiComponent_ANIMATIONS | aiComponent_MATERIALS;
 
-		// Add / remove tangents as required by user
-		if (requireTangents)
-		{
-			assimpFlags |= aiProcess_CalcTangentSpace;
-		}
-		else
-		{
-			removeComponents |= aiComponent_TANGENTS_AND_BITANGENTS;
-		}
+		return { assimpFlags, removeComponents };
+	}
+
+	// Pass the name of the mesh file to load. Uses assimp (http://www.assimp.org/) to support many file types
+	// Optionally request tangents to be calculated (for normal and parallax mapping - see later lab)
+	// Will throw a std::runtime_error exception on failure (since constructors can't return errors).
+	CDX11Mesh::CDX11Mesh(CDX11Engine* engine, const std::string& fileNameN, bool requireTangents /*= false*/)
+	{
 
-		// Other miscellaneous settings
-		importer.SetPropertyFloat(AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE, 80.0f); // Smoothing angle for normals
-		importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);  // Remove points and lines (keep triangles only)
-		importer.SetPropertyBool(AI_CONFIG_PP_FD_REMOVE, true);                 // Remove degenerate triangles
-		importer.SetPropertyBool(AI_CONFIG_PP_DB_ALL_OR_NONE, true);            // Default to removing bones/weights from meshes that don't need skinning
+		mEngine = engine;
 
-		// Set maximum bones that can affect one vertex, and also maximum bones affecting a single mesh
-		unsigned int maxBonesPerVertex = 4; // The shaders support 4 bones per verted (null bones are added if necessary)
-		unsigned int maxBonesPerMesh = 256; // Bone indexes are stored in a byte, so no more than 256
-		importer.SetPropertyInteger(AI_CONFIG_PP_LBW_MAX_WEIGHTS, maxBonesPerVertex);
-		importer.SetPropertyInteger(AI_CONFIG_PP_SBBC_MAX_BONES, maxBonesPerMesh);
+		mFileName = fileNameN;
+		hasTangents = requireTangents;
 
-		importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, removeComponents);
+		auto fileName = engine->GetMediaFolder() + fileNameN;
 
-		// Import mesh with assimp given above requirements - log output
-		Assimp::DefaultLogger::create("", Assimp::DefaultLogger::VERBOSE);
-		auto scene = importer.ReadFile(fileName, assimpFlags);
-		Assimp::DefaultLogger::kill();
-		if (scene == nullptr)  throw std::runtime_error("Error loading mesh (" + fileName + "). " + importer.GetErrorString());
-		if (scene->mNumMeshes == 0)  throw std::runtime_error("No usable geometry in mesh: " + fileName);
+		// The scene loader imports meshes ahead of time on worker threads, anything else is imported here
+		CLoadScope importScope("Mesh Import", "mesh", fileName);
+		const auto importer = CAssetCache::Instance().Mesh(fileName, ImportSettings());
+		const auto scene = importer->GetScene();
+		importScope.End();
 
 		//-----------------------------------
 
@@ -116,6 +99,8 @@ namespace DX11
 		mSubMeshes.resize(scene->mNumMeshes);
 		for (unsigned int m = 0; m < scene->mNumMeshes; ++m)
 		{
+			CLoadScope interleaveScope("Mesh Interleave", "mesh", fileName);
+
 			auto assimpMesh = scene->mMeshes[m];
 			std::string subMeshName = assimpMesh->mName.C_Str();
 			auto& subMesh = mSubMeshes[m]; // Short name for the submesh we're currently preparing - makes code below more readable
@@ -326,8 +311,12 @@ namespace DX11
 				*index++ = assimpMesh->mFaces[face].mIndices[2];
 			}
 
+			interleaveScope.End();
+
 			//-----------------------------------
 
+			CLoadScope buffersScope("Mesh Buffers", "mesh", fileName);
+
 			D3D11_BUFFER_DESC bufferDesc;
 			D3D11_SUBRESOURCE_DATA initData;
 
@@ -3,10 +3,12 @@
 //--------------------------------------------------------------------------------------
 
 #include "GraphicsHelpers.h"
-#include "DDSTextureLoader\DDSTextureLoader11.h"
-#include "WICTextureLoader\WICTextureLoader11.h"
 #include "DirectXTex.h"
 #include "ScreenGrab.h"
+#include "../Common/AssetCache.h"
+#include "../Common/MaterialMaps.h"
+#include "../Utility/HelperFunctions.h"
+#include "../Utility/LoadProfiler.h"
 
 namespace DX11
 {
@@ -16,7 +18,7 @@ namespace DX11
 	// Texture Loading
 	//--------------------------------------------------------------------------------------
 
-	// Using Microsoft's open source DirectX Tool Kit (DirectXTK) to simplify texture loading
+	// Using Microsoft's open source DirectXTex library to simplify texture loading
 	// This function requires you to pass a ID3D11Resource* (e.g. &gTilesDiffuseMap), which manages the GPU memory for the
 	// texture and also a ID3D11ShaderResourceView* (e.g. &gTilesDiffuseMapSRV), which allows us to use the texture in shaders
 	// The function will fill in these pointers with usable data. Returns false on failure
@@ -25,20 +27,55 @@ namespace DX11
 
 		HRESULT res = false;
 
-		filename = mMediaFolder + filename;
+		// The DDS file of the texture cooker if there is one, with its mips and block compressed
+		filename = CookedTextureName(mMediaFolder + filename);
 
-		std::unique_lock l(mMutex);
+		CLoadScope scope("Texture Upload", "texture", filename);
 
-		// DDS files need a different function from other files
-		std::string dds = ".dds"; // So check the filename extension (case insensitive)
-		if (filename.size() >= 4 &&
-			std::equal(dds.rbegin(), dds.rend(), filename.rbegin(), [](unsigned char a, unsigned char b) { return std::tolower(a) == std::tolower(b); }))
+		try
 		{
-			res = DirectX::CreateDDSTextureFromFile(mD3DDevice.Get(), std::wstring(filename.begin(), filename.end()).c_str(), texture, textureSRV);
+			// The scene loader decodes the image and its mips on a worker thread, anything else is decoded here
+			const auto image = CAssetCache::Instance().Texture(filename);
+
+			std::unique_lock l(mMutex);
+
+			res = DirectX::CreateShaderResourceView(mD3DDevice.Get(), image->GetImages(), image->GetImageCount(), image->GetMetadata(), textureSRV);
+
+			if (SUCCEEDED(res)) (*textureSRV)->GetResource(texture);
+		}
+		catch (const std::exception&)
+		{
+			return false;
+		}
+
+		return SUCCEEDED(res);
+	}
+
+	bool CDX11Engine::LoadOrmTexture(SOrmMaps maps, ID3D11Resource** texture, ID3D11ShaderResourceView** textureSRV)
+	{
+		HRESULT res = false;
+
+		for (const auto fileName : { &maps.ao, &maps.roughness, &maps.metalness, &maps.packed })
+		{
+			if (!fileName->empty()) *fileName = mMediaFolder + *fileName;
+		}
+
+		CLoadScope scope("Texture Upload", "texture", OrmFileName(maps));
+
+		try
+		{
+			// The cooked file, the one packed by the scene loader, or packed here
+			const auto image = CAssetCache::Instance().Orm(maps);
+
+			std::unique_lock l(mMutex);
+
+			res = DirectX::CreateShaderResourceView(mD3DDevice.Get(), image->GetImages(), image->GetImageCount(), image->GetMetadata(), textureSRV);
+
+			if (SUCCEEDED(res)) (*textureSRV)->GetResource(texture);
 		}
-		else
+		catch (const std::exception&)
 		{
-			res = DirectX::CreateWICTextureFromFile(mD3DDevice.Get(), mD3DContext.Get(), std::wstring(filename.begin(), filename.end()).c_str(), texture, textureSRV);
+			return false;
 		}
 
 		return SUCCEEDED(res);
@@ -15,6 +15,7 @@
 #include "DX11Engine.h"
 
 struct aiNode;
+struct SMeshImportSettings;
 
 namespace DX11
 {
@@ -73,6 +74,9 @@ namespace DX11
 
 		CDX11Mesh(const CDX11Mesh&);
 
+		// Assimp settings every DX11 mesh is imported with
+		static SMeshImportSettings ImportSettings();
+
 		~CDX11Mesh();
 
 		// How many nodes are in the hierarchy for this mesh. Nodes can control individual parts (rigid body animation),
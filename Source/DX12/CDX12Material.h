@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../Common/MaterialMaps.h"
 
 namespace DX12
 {
@@ -25,7 +26,8 @@ namespace DX12
 		// Main Constructor
 		// Requires a vector of filemaps
 		// Formats: NAME_RESOLUTION_TYPE.EXTENTION
-		// Types supported: Albedo,AmbientOccusion,Displacement,Roughness,Metallness
+		// Types supported: Albedo,AmbientOccusion,Displacement,Roughness,Metallness,ORM
+		// The AO, roughness and metalness maps are used packed to one ORM texture
 		// It will set automatically the correct shaders depending on the use (Normals = PBR / No Normals = PBRNoNormals)
 		CDX12Material(std::vector<std::string>& fileMaps, CDX12Engine* engine);
 
@@ -38,16 +40,23 @@ namespace DX12
 		// Return if the material has a normal map
 		bool HasNormals() const { return mHasNormals; }
 
-		// Set the shaders
-		// Set the maps to the shader
-		// Optionally decide to set depth only shaders
+		// Set the maps to the shader, for the pipelines that do not read the material table (the sky)
 		void               RenderMaterial() const;
 		std::vector<void*> GetTextureSRV() const;
 		auto&              TextureFileNames() { return mMapsStr; }
 
-		std::unique_ptr<CDX12Texture> mAlbedo, mDisplacement, mRoughness, mAo, mNormal, mMetalness;
+		// The maps packed in mOrm, full paths
+		const SOrmMaps&    OrmMaps() const { return mOrmMaps; }
 
-		// Used for raytracing
+		// The maps as one descriptor table, for the raytracing hit group
+		D3D12_GPU_DESCRIPTOR_HANDLE TextureTable() const;
+
+		// Counts the new views of the maps, the heap indices of the maps change with them
+		uint64_t           ViewChanges() const { return mViewChanges; }
+
+		std::unique_ptr<CDX12Texture> mAlbedo, mDisplacement, mNormal, mOrm;
+
+		// Used for raytracing, a new buffer every time the sizes change
 		std::unique_ptr<CDX12ConstantBuffer> mMaterialCB;
 
 	private:
@@ -58,10 +67,25 @@ namespace DX12
 
 		bool mHasNormals;
 
+		SOrmMaps mOrmMaps;
+
 		
 		void               LoadMaps(std::vector<std::string>& fileMaps);
+		void               CreateTextureTable();
+
+		// Copies the views of the maps to a new table, the frames in flight keep reading the old one
+		void               WriteTextureTable();
+
+		// The sizes of the maps for the raytracing constants, which change with the streamed mips
+		// Written to a new buffer, the frames in flight keep reading the old one
+		void               CopyMapSizes();
+
+		static constexpr UINT NumMaps = 4;
 
 		CDX12DescriptorHeap* mMapsDescriptorHeap;
+		uint32_t             mTextureTable = 0;
+		bool                 mHasTextureTable = false;
+		uint64_t             mViewChanges = 0;
 		
 	};
 
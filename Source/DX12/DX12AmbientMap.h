@@ -4,8 +4,6 @@
 
 namespace DX12
 {
-	class CDX12ConstantBuffer;
-
 	class CDX12AmbientMap
 	{
 		public:
@@ -15,23 +13,24 @@ namespace DX12
 			CDX12AmbientMap() = delete;
 			CDX12AmbientMap(CDX12Engine* e, int size, CDX12DescriptorHeap* srvHeap);
 
-			void* RenderFromThis(CMatrix4x4* mat);
+			// Records one face, the faces can be recorded in parallel as long as they are submitted in order
+			// The cube map has to be in the render target state and the depth buffer in the depth write state
+			void RenderFace(int face, const CVector3& position);
 
-			void PrepareToRender();
-			void PrepareToShow();
+			// The depth buffer is a transient texture of the render graph, its view is written every frame before recording
+			void SetDepthBuffer(ID3D12Resource* depthBuffer);
 
 
 			bool mEnable;
 
 			CDX12Engine*           mEngine;
 			ComPtr<ID3D12Resource> mResource;
+			D3D12_RESOURCE_STATES  mState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
 
 			std::unique_ptr<CDX12DescriptorHeap> mDsvHeap;
 			std::unique_ptr<CDX12DescriptorHeap> mRtvHeap;
 
-			std::unique_ptr<CDX12ConstantBuffer> mConstantBuffers[6];
-
-			ComPtr<ID3D12Resource>               mDepthBufferResource;
+			D3D12_RESOURCE_DESC                  mDepthBufferDesc;
 			uint32_t                             mSrvHandle;
 			uint32_t                             mRtvHandle[6];
 			uint32_t                             mDsvHandle;
@@ -0,0 +1,192 @@
+#include "DX12BlasCache.h"
+
+#include <algorithm>
+
+#include "DX12Engine.h"
+#include "DX12Mesh.h"
+#include "DX12ResourceAllocator.h"
+
+namespace DX12
+{
+	namespace
+	{
+		void UavBarrier(ID3D12GraphicsCommandList4* commandList)
+		{
+			const auto barrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
+			commandList->ResourceBarrier(1, &barrier);
+		}
+	}
+
+	CDX12BlasCache::CDX12BlasCache(CDX12Engine* engine, uint64_t scratchSize) :
+		mEngine(engine),
+		mScratchSize(ROUND_UP(scratchSize, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT))
+	{
+	}
+
+	uint32_t CDX12BlasCache::Request(CDX12Mesh* mesh)
+	{
+		++mStats.requests;
+
+		if (const auto found = mHandles.find(mesh->mFileName); found != mHandles.end()) return found->second;
+
+		SStructure structure;
+		for (const auto& subMesh : mesh->mSubMeshes)
+		{
+			D3D12_RAYTRACING_GEOMETRY_DESC geometry = {};
+			geometry.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
+			geometry.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
+			geometry.Triangles.VertexBuffer.StartAddress = subMesh.geometry.VertexAddress();
+			geometry.Triangles.VertexBuffer.StrideInBytes = subMesh.vertexSize;
+			geometry.Triangles.VertexCount = subMesh.numVertices;
+			geometry.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+			geometry.Triangles.IndexBuffer = subMesh.geometry.IndexAddress();
+			geometry.Triangles.IndexCount = subMesh.numIndices;
+			geometry.Triangles.IndexFormat = DXGI_FORMAT_R32_UINT;
+			structure.geometries.push_back(geometry);
+		}
+
+		D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs = {};
+		inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+		inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+		inputs.NumDescs = static_cast<UINT>(structure.geometries.size());
+		inputs.pGeometryDescs = structure.geometries.data();
+		inputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_COMPACTION | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
+
+		D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO info = {};
+		mEngine->mDevice->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &info);
+
+		structure.scratchSize = ROUND_UP(info.ScratchDataSizeInBytes, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
+		structure.resultSize = ROUND_UP(info.ResultDataMaxSizeInBytes, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
+
+		const auto handle = static_cast<uint32_t>(mStructures.size());
+		mStructures.push_back(std::move(structure));
+		mHandles[mesh->mFileName] = handle;
+		mPending.push_back(handle);
+
+		++mStats.structures;
+		return handle;
+	}
+
+	void CDX12BlasCache::Build(ID3D12GraphicsCommandList4* commandList)
+	{
+		if (mPending.empty()) return;
+		if (!mBuilt.empty()) throw std::logic_error("The built acceleration structures have to be compacted before the next build");
+
+		// The scratch is kept for the next builds, and only grows for a structure bigger than it
+		auto scratchSize = mScratchSize;
+		for (const auto handle : mPending) scratchSize = std::max(scratchSize, mStructures[handle].scratchSize);
+
+		if (!mScratch || mScratch->GetDesc().Width < scratchSize)
+		{
+			// The builds of the last batch may still be using the old one
+			mEngine->mResourceAllocator->Retire(std::move(mScratch));
+			mScratch = mEngine->mResourceAllocator->CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, scratchSize,
+				D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+			NAME_D3D12_OBJECT(mScratch);
+
+			mStats.scratchBytes = scratchSize;
+		}
+		scratchSize = mScratch->GetDesc().Width;
+
+		const auto sizesBytes = mPending.size() * sizeof(uint64_t);
+		mCompactedSizes = mEngine->mResourceAllocator->CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, sizesBytes,
+			D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+		mReadback = mEngine->mResourceAllocator->CreateBuffer(D3D12_HEAP_TYPE_READBACK, sizesBytes, D3D12_RESOURCE_STATE_COPY_DEST);
+		NAME_D3D12_OBJECT(mCompactedSizes);
+		NAME_D3D12_OBJECT(mReadback);
+
+		uint64_t scratchOffset = 0;
+		++mStats.batches;
+
+		for (size_t i = 0; i < mPending.size(); ++i)
+		{
+			const auto handle = mPending[i];
+			auto& structure = mStructures[handle];
+
+			structure.resource = mEngine->mResourceAllocator->CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, structure.resultSize,
+				D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+			SetNameIndexed(structure.resource.Get(), L"BottomLevelAS", handle);
+
+			mStats.builtBytes += structure.resultSize;
+
+			// A full scratch starts a new batch, once the builds of the last one are done with it
+			if (scratchOffset + structure.scratchSize > scratchSize)
+			{
+				UavBarrier(commandList);
+				scratchOffset = 0;
+				++mStats.batches;
+			}
+
+			D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC desc = {};
+			desc.Inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+			desc.Inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+			desc.Inputs.NumDescs = static_cast<UINT>(structure.geometries.size());
+			desc.Inputs.pGeometryDescs = structure.geometries.data();
+			desc.Inputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_COMPACTION | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
+			desc.DestAccelerationStructureData = structure.resource->GetGPUVirtualAddress();
+			desc.ScratchAccelerationStructureData = mScratch->GetGPUVirtualAddress() + scratchOffset;
+
+			D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC postbuild = {};
+			postbuild.InfoType = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE;
+			postbuild.DestBuffer = mCompactedSizes->GetGPUVirtualAddress() + i * sizeof(uint64_t);
+
+			commandList->BuildRaytracingAccelerationStructure(&desc, 1, &postbuild);
+
+			scratchOffset += structure.scratchSize;
+		}
+
+		// The structures are complete for the top level build or the compaction
+		UavBarrier(commandList);
+
+		const auto toCopy = CD3DX12_RESOURCE_BARRIER::Transition(mCompactedSizes.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+		commandList->ResourceBarrier(1, &toCopy);
+		commandList->CopyBufferRegion(mReadback.Get(), 0, mCompactedSizes.Get(), 0, sizesBytes);
+
+		mBuilt = std::move(mPending);
+		mPending.clear();
+	}
+
+	void CDX12BlasCache::Compact(ID3D12GraphicsCommandList4* commandList)
+	{
+		if (mBuilt.empty()) return;
+
+		const D3D12_RANGE readRange = { 0, mBuilt.size() * sizeof(uint64_t) };
+		void* data = nullptr;
+		ThrowIfFailed(mReadback->Map(0, &readRange, &data));
+		const auto compactedSizes = static_cast<const uint64_t*>(data);
+
+		for (size_t i = 0; i < mBuilt.size(); ++i)
+		{
+			const auto handle = mBuilt[i];
+			auto& structure = mStructures[handle];
+
+			const auto size = ROUND_UP(compactedSizes[i], D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
+			if (size == 0 || size >= structure.resultSize)
+			{
+				mStats.compactedBytes += structure.resultSize;
+				continue;
+			}
+
+			auto compacted = mEngine->mResourceAllocator->CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, size,
+				D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+			SetNameIndexed(compacted.Get(), L"BottomLevelASCompacted", handle);
+
+			commandList->CopyRaytracingAccelerationStructure(compacted->GetGPUVirtualAddress(), structure.resource->GetGPUVirtualAddress(),
+				D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE_COMPACT);
+
+			// The copy reads the built structure, it is kept until the frame fence passes it
+			mEngine->mResourceAllocator->Retire(std::move(structure.resource));
+			structure.resource = compacted;
+			mStats.compactedBytes += size;
+		}
+
+		const D3D12_RANGE writtenRange = { 0, 0 };
+		mReadback->Unmap(0, &writtenRange);
+
+		UavBarrier(commandList);
+
+		mBuilt.clear();
+		mEngine->mResourceAllocator->Retire(std::move(mCompactedSizes));
+		mEngine->mResourceAllocator->Retire(std::move(mReadback));
+	}
+}
@@ -0,0 +1,96 @@
+//--------------------------------------------------------------------------------------
+// Bottom level acceleration structure cache
+//--------------------------------------------------------------------------------------
+// A bottom level acceleration structure is built once per mesh file, with a geometry per
+// sub-mesh, and shared by every instance of the mesh in the top level structure (objects
+// load their own CDX12Mesh, but the geometry of a file is the same for all of them).
+// The requested structures are built together: the builds of a batch run at the same time
+// in ranges of one scratch buffer, kept and reused by the next batch after a UAV barrier.
+// Every build also writes its compacted size; once the GPU is done the structures are
+// copied into buffers of that size, usually much smaller than the built ones, which are
+// then released.
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "DX12Common.h"
+
+namespace DX12
+{
+	class CDX12Engine;
+	class CDX12Mesh;
+
+	struct SBlasCacheStats
+	{
+		uint32_t structures     = 0;
+		uint32_t requests       = 0;
+		uint32_t batches        = 0;
+		uint64_t builtBytes     = 0; // Before compaction
+		uint64_t compactedBytes = 0;
+		uint64_t scratchBytes   = 0;
+	};
+
+	class CDX12BlasCache
+	{
+	public:
+
+		static constexpr uint32_t InvalidHandle = 0xFFFFFFFF;
+
+		CDX12BlasCache() = delete;
+		CDX12BlasCache(const CDX12BlasCache&) = delete;
+		CDX12BlasCache(const CDX12BlasCache&&) = delete;
+		CDX12BlasCache& operator=(const CDX12BlasCache&) = delete;
+		CDX12BlasCache& operator=(const CDX12BlasCache&&) = delete;
+
+		// The scratch buffer holds as many builds as fit in its size, and grows for a bigger one
+		explicit CDX12BlasCache(CDX12Engine* engine, uint64_t scratchSize = 32 * 1024 * 1024);
+
+		// The structure of the mesh, built by the next Build if no mesh of the same file was requested before.
+		// The buffers of the mesh have to live until Build has run
+		uint32_t Request(CDX12Mesh* mesh);
+
+		// Records the builds of the new requests. The vertex and index buffers have to be uploaded when it runs
+		void Build(ID3D12GraphicsCommandList4* commandList);
+
+		// Records the copies of the built structures to their compacted size, after the GPU ran Build
+		void Compact(ID3D12GraphicsCommandList4* commandList);
+
+		// The built structure until it is compacted, then the compacted one
+		ID3D12Resource* Resource(uint32_t handle) const { return mStructures[handle].resource.Get(); }
+
+		// Requested structures waiting for Build
+		bool Pending() const { return !mPending.empty(); }
+
+		// Built structures waiting for Compact
+		bool Compacting() const { return !mBuilt.empty(); }
+
+		SBlasCacheStats Stats() const { return mStats; }
+
+	private:
+
+		struct SStructure
+		{
+			std::vector<D3D12_RAYTRACING_GEOMETRY_DESC> geometries;
+			ComPtr<ID3D12Resource>                      resource;
+			uint64_t                                    scratchSize = 0;
+			uint64_t                                    resultSize  = 0;
+		};
+
+		CDX12Engine* mEngine;
+		uint64_t     mScratchSize;
+
+		std::vector<SStructure>                   mStructures;
+		std::unordered_map<std::string, uint32_t> mHandles; // By mesh file
+		std::vector<uint32_t>                     mPending; // Requested, not built
+		std::vector<uint32_t>                     mBuilt;   // Built, not compacted
+
+		ComPtr<ID3D12Resource> mScratch;
+		ComPtr<ID3D12Resource> mCompactedSizes; // Written by the builds, by index in mBuilt
+		ComPtr<ID3D12Resource> mReadback;
+
+		SBlasCacheStats mStats;
+	};
+}
@@ -0,0 +1,109 @@
+#include "DX12CommandRecorder.h"
+
+#include <chrono>
+#include <future>
+
+#include "DX12Engine.h"
+#include "DX12GeometryArena.h"
+#include "DX12GpuProfiler.h"
+
+namespace DX12
+{
+	CDX12CommandRecorder::CDX12CommandRecorder(CDX12Engine* engine, uint32_t numFrames, unsigned int numThreads) :
+		mEngine(engine),
+		mFrames(numFrames),
+		mPool(numThreads)
+	{
+	}
+
+	void CDX12CommandRecorder::BeginFrame(uint32_t frameIndex)
+	{
+		if (mRecorded != mJobs.size()) throw std::logic_error("Command list jobs added but never recorded");
+
+		mCurrentFrame = frameIndex;
+		mJobs.clear();
+		mRecorded = 0;
+		mTimings.clear();
+	}
+
+	void CDX12CommandRecorder::Add(const std::string& name, RecordFunction record)
+	{
+		mJobs.push_back({ name, std::move(record) });
+	}
+
+	void CDX12CommandRecorder::Record()
+	{
+		auto& frame = mFrames[mCurrentFrame];
+
+		// The lists are made here, before the jobs start, so the vector is not resized under them
+		while (frame.size() < mJobs.size())
+		{
+			SCommandList commandList;
+			ThrowIfFailed(mEngine->mDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&commandList.allocator)));
+
+			// Created closed, the job resets it
+			ThrowIfFailed(mEngine->mDevice->CreateCommandList1(0, D3D12_COMMAND_LIST_TYPE_DIRECT, D3D12_COMMAND_LIST_FLAG_NONE, IID_PPV_ARGS(&commandList.list)));
+
+			const auto index = static_cast<UINT>(frame.size());
+			SetNameIndexed(commandList.allocator.Get(), L"RecorderCommandAllocator", index);
+			SetNameIndexed(commandList.list.Get(), L"RecorderCommandList", index);
+
+			frame.push_back(std::move(commandList));
+		}
+
+		mTimings.resize(mJobs.size());
+
+		std::vector<std::future<bool>> jobs;
+		for (auto i = mRecorded; i < mJobs.size(); ++i)
+		{
+			jobs.push_back(mPool.submit([this, i] { RecordJob(i); }));
+		}
+
+		// Wait for all of them before rethrowing, the jobs still running use the lists
+		for (auto& job : jobs) job.wait();
+
+		mRecorded = mJobs.size();
+
+		for (auto& job : jobs) job.get();
+	}
+
+	void CDX12CommandRecorder::GetCommandLists(std::vector<ID3D12CommandList*>& commandLists) const
+	{
+		const auto& frame = mFrames[mCurrentFrame];
+		for (size_t i = 0; i < mRecorded; ++i)
+		{
+			commandLists.push_back(frame[i].list.Get());
+		}
+	}
+
+	void CDX12CommandRecorder::RecordJob(size_t index)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		const auto& job = mJobs[index];
+		const auto& commandList = mFrames[mCurrentFrame][index];
+
+		ThrowIfFailed(commandList.allocator->Reset());
+		ThrowIfFailed(commandList.list->Reset(commandList.allocator.Get(), nullptr));
+
+		// A new list has no pipeline state, and the worker may have recorded another list before
+		CDX12Engine::mCurrRecordingCommandList = commandList.list.Get();
+		CDX12Engine::mCurrSetPso = nullptr;
+		CDX12Engine::mCurrGeometryPool = SDX12Geometry::InvalidPool;
+
+		{
+			CDX12GpuScope scope(mEngine->mGpuProfiler.get(), commandList.list.Get(), job.name);
+
+			job.record();
+		}
+
+		ThrowIfFailed(commandList.list->Close());
+
+		CDX12Engine::mCurrRecordingCommandList = nullptr;
+		CDX12Engine::mCurrSetPso = nullptr;
+		CDX12Engine::mCurrGeometryPool = SDX12Geometry::InvalidPool;
+
+		const std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		mTimings[index] = { job.name, elapsed.count() };
+	}
+}
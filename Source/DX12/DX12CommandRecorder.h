@@ -0,0 +1,95 @@
+//--------------------------------------------------------------------------------------
+// Parallel command list recording
+//--------------------------------------------------------------------------------------
+// The passes of a frame (a shadow map, a face of the ambient map, a chunk of the objects of
+// the main pass) are added as jobs, recorded at the same time on the worker threads of a
+// thread pool, and submitted in the order they were added with one ExecuteCommandLists.
+// Every job gets a command list and an allocator of its own for each frame in flight, created
+// the first time a frame needs that many lists and reused afterwards. An allocator is only
+// reset when its frame comes around again, after the engine has waited for the frame fence.
+// While a job runs CDX12Engine::mCurrRecordingCommandList (thread local) is its list, so the
+// usual recording code (meshes, materials, barriers) works unchanged on any thread.
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <thread_pool.hpp>
+
+#include "DX12Common.h"
+
+namespace DX12
+{
+	class CDX12Engine;
+
+	struct SCommandListTiming
+	{
+		std::string name;
+		float       milliseconds = 0; // CPU time spent recording the list
+	};
+
+	class CDX12CommandRecorder
+	{
+	public:
+
+		using RecordFunction = std::function<void()>;
+
+		CDX12CommandRecorder() = delete;
+		CDX12CommandRecorder(const CDX12CommandRecorder&) = delete;
+		CDX12CommandRecorder(const CDX12CommandRecorder&&) = delete;
+		CDX12CommandRecorder& operator=(const CDX12CommandRecorder&) = delete;
+		CDX12CommandRecorder& operator=(const CDX12CommandRecorder&&) = delete;
+
+		// 0 threads uses one per hardware thread
+		CDX12CommandRecorder(CDX12Engine* engine, uint32_t numFrames, unsigned int numThreads = 0);
+
+		// Start a new frame, the GPU must be done with the lists last recorded for this frame index
+		void BeginFrame(uint32_t frameIndex);
+
+		// The job is recorded by the next call to Record. The name shows in PIX and in the timings
+		void Add(const std::string& name, RecordFunction record);
+
+		// Record every job added since the last call and return when all of them are done.
+		// The jobs must only write to what belongs to them, the engine state they read must not change while they run.
+		// Rethrows the exception of the first job that failed
+		void Record();
+
+		// Append the lists recorded this frame, in the order the jobs were added
+		void GetCommandLists(std::vector<ID3D12CommandList*>& commandLists) const;
+
+		// One per list of the frame, valid after Record
+		const std::vector<SCommandListTiming>& Timings() const { return mTimings; }
+
+		unsigned int ThreadCount() const { return mPool.get_thread_count(); }
+
+	private:
+
+		struct SCommandList
+		{
+			ComPtr<ID3D12CommandAllocator>     allocator;
+			ComPtr<ID3D12GraphicsCommandList4> list;
+		};
+
+		struct SJob
+		{
+			std::string    name;
+			RecordFunction record;
+		};
+
+		void RecordJob(size_t index);
+
+		CDX12Engine* mEngine;
+
+		// Lists of each frame in flight, job i of a frame uses list i
+		std::vector<std::vector<SCommandList>> mFrames;
+		uint32_t                               mCurrentFrame = 0;
+
+		std::vector<SJob>               mJobs;     // Added this frame
+		size_t                          mRecorded = 0; // Jobs already recorded this frame
+		std::vector<SCommandListTiming> mTimings;
+
+		thread_pool mPool;
+	};
+}
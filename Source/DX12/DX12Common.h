@@ -136,20 +136,8 @@ inline auto MessageHR(const std::string& fn, HRESULT hr)
 		CMatrix4x4 worldMatrix;
 
 		CVector3 objectColour = CVector3{1,1,1};  // Allows each light model to be tinted to match the light colour they cast
-		float    parallaxDepth; // Used in the geometry shader to control how much the polygons are exploded outwards
 
-		float useCustomValues;
-		float hasAoMap;
-		float hasRoughnessMap;
-		float hasAmbientMap;
-		float hasMetallnessMap;
-		float hasNormalMap;
-		float hasDisplacementMap;
-
-		float roughness;
-		float metalness;
-
-		float padding[35];
+		float padding[45];
 	};
 
 	constexpr auto s = sizeof(PerModelConstants);
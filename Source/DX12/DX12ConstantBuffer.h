@@ -1,7 +1,10 @@
 #pragma once
 
+#include <algorithm>
+
 #include "DX12Common.h"
 #include "DX12DescriptorHeap.h"
+#include "DX12ResourceAllocator.h"
 
 namespace DX12
 {
@@ -20,38 +23,35 @@ namespace DX12
 
 		CDX12ConstantBuffer(CDX12Engine* engine, CDX12DescriptorHeap* cbvHeap, size_t size);
 
+		// The buffer is a range of a shared upload buffer that stays mapped, copies go straight to the upload memory.
+		// The caller must not overwrite data the GPU has not read yet (one buffer per frame in flight)
 		template <typename T>
 		void Copy(T& data)
 		{
-			// Map and initialize the constant buffer. 
-			const CD3DX12_RANGE readRange(0, 0); // We do not intend to read from this resource on the CPU.
-			ThrowIfFailed(mResource->Map(0, &readRange, reinterpret_cast<void**>(&mCBVDataBegin)));
-			if (mCBVDataBegin)
-			{
-				memcpy(mCBVDataBegin, &data, mSize);
-				mResource->Unmap(0, nullptr);
-			}
+			memcpy(mCBVDataBegin, &data, std::min(sizeof(T), mSize));
 		}
 
 		template <typename T, typename U>
 		void Copy(T& data, size_t n)
 		{
-			// Map and initialize the constant buffer. 
-			const CD3DX12_RANGE readRange(0, 0); // We do not intend to read from this resource on the CPU.
-			ThrowIfFailed(mResource->Map(0, &readRange, reinterpret_cast<void**>(&mCBVDataBegin)));
-			memcpy(mCBVDataBegin, &data, sizeof(U) * n);
-			mResource->Unmap(0, nullptr);
+			memcpy(mCBVDataBegin, &data, std::min(sizeof(U) * n, mSize));
 		}
 
 		void Set(UINT RootParameterIndex) const;
 
-		auto Resource() const { return mResource; }
+		// Shared with other constant buffers, use GpuAddress to find this one
+		auto Resource() const { return mRange.resource; }
+
+		D3D12_GPU_VIRTUAL_ADDRESS GpuAddress() const { return mRange.gpu; }
+
+		// Of this buffer in Resource()
+		uint64_t Offset() const { return mRange.offset; }
 
 		uint32_t mHandle;
 
 	private:
 		CDX12Engine*           mEngine;
-		ComPtr<ID3D12Resource> mResource;
+		SDX12BufferRange       mRange;
 		UINT8*                 mCBVDataBegin;
 		size_t                 mSize;
 		CDX12DescriptorHeap*   mCBVHeap;
@@ -0,0 +1,355 @@
+#include "DX12DescriptorAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+namespace DX12
+{
+	//--------------------------------------------------------------------------------------
+	// Persistent descriptors
+	//--------------------------------------------------------------------------------------
+
+	CDX12DescriptorAllocator::CDX12DescriptorAllocator(uint32_t pageSize, uint32_t maxPages, PageFunction onNewPage) :
+		mPageSize(pageSize),
+		mMaxPages(maxPages),
+		mOnNewPage(std::move(onNewPage))
+	{
+		if (mPageSize == 0) throw std::logic_error("Empty descriptor page");
+	}
+
+	uint32_t CDX12DescriptorAllocator::Allocate(uint32_t count)
+	{
+		if (count == 0 || count > mPageSize) throw std::logic_error("Invalid descriptor count");
+
+		if (count > 1)
+		{
+			std::unique_lock l(mMutex);
+			return AllocateLocked(count);
+		}
+
+		// Two tries: if the pages are full the other threads' caches may still have some free descriptors
+		for (auto attempt = 0; attempt < 2; ++attempt)
+		{
+			{
+				auto& cache = ThreadCache();
+				std::unique_lock cl(cache.mutex);
+
+				if (cache.indices.empty())
+				{
+					// Refill half of the cache, so the next frees have room too
+					std::unique_lock l(mMutex);
+					for (uint32_t i = 0; i < ThreadCacheSize / 2; ++i)
+					{
+						const auto index = AllocateLocked(1);
+						if (index == InvalidIndex) break;
+						cache.indices.push_back(index);
+					}
+
+					// Lowest indices first
+					std::reverse(cache.indices.begin(), cache.indices.end());
+				}
+
+				if (!cache.indices.empty())
+				{
+					const auto index = cache.indices.back();
+					cache.indices.pop_back();
+					return index;
+				}
+			}
+
+			FlushThreadCaches();
+		}
+
+		return InvalidIndex;
+	}
+
+	void CDX12DescriptorAllocator::Free(uint32_t index, uint32_t count)
+	{
+		if (count == 1)
+		{
+			auto& cache = ThreadCache();
+			std::unique_lock cl(cache.mutex);
+			if (cache.indices.size() < ThreadCacheSize)
+			{
+				cache.indices.push_back(index);
+				return;
+			}
+		}
+
+		std::unique_lock l(mMutex);
+		FreeLocked(index, count);
+	}
+
+	void CDX12DescriptorAllocator::Free(uint32_t index, uint32_t count, uint64_t fenceValue)
+	{
+		std::unique_lock l(mMutex);
+
+		if (count == 0 || index / mPageSize >= mPages.size() || index % mPageSize + count > mPageSize)
+		{
+			throw std::logic_error("Freeing descriptors that were not allocated");
+		}
+
+		mDeferredFrees.push_back({ index, count, fenceValue });
+	}
+
+	void CDX12DescriptorAllocator::ProcessDeferredFrees(uint64_t completedFenceValue)
+	{
+		std::unique_lock l(mMutex);
+
+		const auto end = std::remove_if(mDeferredFrees.begin(), mDeferredFrees.end(), [&](const SDeferredFree& deferred)
+		{
+			if (deferred.fenceValue > completedFenceValue) return false;
+
+			FreeLocked(deferred.index, deferred.count);
+			return true;
+		});
+		mDeferredFrees.erase(end, mDeferredFrees.end());
+	}
+
+	void CDX12DescriptorAllocator::FlushThreadCaches()
+	{
+		for (auto& cache : mThreadCaches)
+		{
+			std::unique_lock cl(cache.mutex);
+			if (cache.indices.empty()) continue;
+
+			std::unique_lock l(mMutex);
+			for (const auto index : cache.indices) FreeLocked(index, 1);
+			cache.indices.clear();
+		}
+	}
+
+	SDescriptorStats CDX12DescriptorAllocator::Stats() const
+	{
+		SDescriptorStats stats;
+
+		for (auto& cache : mThreadCaches)
+		{
+			std::unique_lock cl(cache.mutex);
+			stats.cached += static_cast<uint32_t>(cache.indices.size());
+		}
+
+		std::unique_lock l(mMutex);
+
+		stats.pages = static_cast<uint32_t>(mPages.size());
+		stats.capacity = stats.pages * mPageSize;
+
+		uint32_t free = 0;
+		for (const auto& ranges : mPages)
+			for (const auto& range : ranges) free += range.end - range.begin;
+
+		for (const auto& deferred : mDeferredFrees) stats.pendingFree += deferred.count;
+
+		// The descriptors waiting for the fence are still allocated
+		stats.allocated = stats.capacity - free - stats.cached;
+
+		return stats;
+	}
+
+	void CDX12DescriptorAllocator::Validate() const
+	{
+		// Every cache at once, always in the same order
+		std::vector<std::unique_lock<std::mutex>> cacheLocks;
+		for (auto& cache : mThreadCaches) cacheLocks.emplace_back(cache.mutex);
+
+		std::unique_lock l(mMutex);
+
+		const auto capacity = static_cast<uint32_t>(mPages.size()) * mPageSize;
+
+		// 0 allocated, 1 free, 2 cached, 3 waiting for the fence
+		std::vector<uint8_t> state(capacity, 0);
+
+		for (uint32_t page = 0; page < mPages.size(); ++page)
+		{
+			const auto pageBegin = page * mPageSize;
+			const auto pageEnd = pageBegin + mPageSize;
+
+			const SRange* previous = nullptr;
+			for (const auto& range : mPages[page])
+			{
+				if (range.begin >= range.end) throw std::logic_error("Empty free descriptor range");
+				if (range.begin < pageBegin || range.end > pageEnd) throw std::logic_error("Free descriptor range outside its page");
+				if (previous && range.begin <= previous->end) throw std::logic_error("Free descriptor ranges not sorted or not merged");
+
+				for (auto i = range.begin; i < range.end; ++i) state[i] = 1;
+				previous = &range;
+			}
+		}
+
+		for (const auto& cache : mThreadCaches)
+		{
+			for (const auto index : cache.indices)
+			{
+				if (index >= capacity || state[index] != 0) throw std::logic_error("Cached descriptor is not allocated");
+				state[index] = 2;
+			}
+		}
+
+		for (const auto& deferred : mDeferredFrees)
+		{
+			for (auto i = deferred.index; i < deferred.index + deferred.count; ++i)
+			{
+				if (i >= capacity || state[i] != 0) throw std::logic_error("Descriptor freed twice");
+				state[i] = 3;
+			}
+		}
+	}
+
+	CDX12DescriptorAllocator::SThreadCache& CDX12DescriptorAllocator::ThreadCache()
+	{
+		const auto hash = std::hash<std::thread::id>()(std::this_thread::get_id());
+		return mThreadCaches[hash % NumThreadCaches];
+	}
+
+	uint32_t CDX12DescriptorAllocator::AllocateLocked(uint32_t count)
+	{
+		// First fit, the lower pages fill up first
+		for (auto pageIt = mPages.begin(); ; ++pageIt)
+		{
+			if (pageIt == mPages.end())
+			{
+				if (!AddPage()) return InvalidIndex;
+				pageIt = mPages.end() - 1;
+			}
+
+			auto& ranges = *pageIt;
+			for (auto it = ranges.begin(); it != ranges.end(); ++it)
+			{
+				if (it->end - it->begin < count) continue;
+
+				const auto index = it->begin;
+				it->begin += count;
+				if (it->begin == it->end) ranges.erase(it);
+				return index;
+			}
+		}
+	}
+
+	void CDX12DescriptorAllocator::FreeLocked(uint32_t index, uint32_t count)
+	{
+		const auto page = index / mPageSize;
+		if (count == 0 || page >= mPages.size() || index % mPageSize + count > mPageSize)
+		{
+			throw std::logic_error("Freeing descriptors that were not allocated");
+		}
+
+		auto& ranges = mPages[page];
+		const auto end = index + count;
+
+		// Insert sorted, merging with the neighbours
+		auto next = std::lower_bound(ranges.begin(), ranges.end(), index, [](const SRange& range, uint32_t value) { return range.begin < value; });
+
+		const auto hasPrev = next != ranges.begin();
+		const auto prev = hasPrev ? next - 1 : ranges.end();
+
+		if ((hasPrev && prev->end > index) || (next != ranges.end() && next->begin < end))
+		{
+			throw std::logic_error("Descriptor freed twice");
+		}
+
+		const auto mergePrev = hasPrev && prev->end == index;
+		const auto mergeNext = next != ranges.end() && next->begin == end;
+
+		if (mergePrev && mergeNext)
+		{
+			prev->end = next->end;
+			ranges.erase(next);
+		}
+		else if (mergePrev)
+		{
+			prev->end = end;
+		}
+		else if (mergeNext)
+		{
+			next->begin = index;
+		}
+		else
+		{
+			ranges.insert(next, { index, end });
+		}
+	}
+
+	bool CDX12DescriptorAllocator::AddPage()
+	{
+		const auto page = static_cast<uint32_t>(mPages.size());
+		if (mMaxPages && page >= mMaxPages) return false;
+
+		// The indices have to fit in 32 bits
+		if (static_cast<uint64_t>(page + 1) * mPageSize >= InvalidIndex) return false;
+
+		// The page only exists once whoever backs it has made its descriptors
+		if (mOnNewPage) mOnNewPage(page);
+
+		mPages.push_back({ { page * mPageSize, (page + 1) * mPageSize } });
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Per frame descriptors
+	//--------------------------------------------------------------------------------------
+
+	CDX12DescriptorRing::CDX12DescriptorRing(uint32_t size) :
+		mSize(size)
+	{
+		if (mSize == 0) throw std::logic_error("Empty descriptor ring");
+	}
+
+	uint32_t CDX12DescriptorRing::Allocate(uint32_t count)
+	{
+		std::unique_lock l(mMutex);
+
+		if (count == 0 || count > mSize) return InvalidIndex;
+
+		// An empty ring starts over from the beginning to get the most contiguous space
+		if (mUsed == 0) mHead = 0;
+
+		// What is left at the end of the ring when wrapping counts as used by the frame
+		auto begin = mHead;
+		uint32_t consumed;
+		if (begin + count <= mSize)
+		{
+			consumed = count;
+		}
+		else
+		{
+			begin = 0;
+			consumed = mSize - mHead + count;
+		}
+
+		if (consumed > mSize - mUsed) return InvalidIndex;
+
+		mHead = (begin + count) % mSize;
+		mUsed += consumed;
+		mPending += consumed;
+		return begin;
+	}
+
+	void CDX12DescriptorRing::EndFrame(uint64_t fenceValue)
+	{
+		std::unique_lock l(mMutex);
+
+		if (mPending == 0) return;
+
+		mFrames.push_back({ fenceValue, mPending });
+		mPending = 0;
+	}
+
+	void CDX12DescriptorRing::Retire(uint64_t completedFenceValue)
+	{
+		std::unique_lock l(mMutex);
+
+		// Frames finish in order, so the ring is given back from its tail
+		while (!mFrames.empty() && mFrames.front().fenceValue <= completedFenceValue)
+		{
+			mUsed -= mFrames.front().count;
+			mFrames.pop_front();
+		}
+	}
+
+	uint32_t CDX12DescriptorRing::Used() const
+	{
+		std::unique_lock l(mMutex);
+		return mUsed;
+	}
+}
@@ -0,0 +1,163 @@
+//--------------------------------------------------------------------------------------
+// Descriptor index allocators
+//--------------------------------------------------------------------------------------
+// The bookkeeping of CDX12DescriptorHeap, kept apart from D3D12 so it can be driven (and
+// tested) without a device.
+// CDX12DescriptorAllocator hands out indices of persistent descriptors. The indices are
+// grouped in pages of a fixed size that are added when the existing ones are full, and an
+// allocation of several descriptors (a descriptor table) is always contiguous and inside one
+// page. Single descriptors, by far the most common, go through small caches picked by the
+// calling thread so the loading threads don't fight over the main lock. Frees can wait for
+// a fence value, as descriptors of the frames in flight can't be overwritten.
+// CDX12DescriptorRing hands out ranges of a ring for the descriptors only needed for one
+// frame, given back in order once the frame fence has passed them.
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace DX12
+{
+	struct SDescriptorStats
+	{
+		uint32_t pages       = 0;
+		uint32_t capacity    = 0;
+		uint32_t allocated   = 0;
+		uint32_t cached      = 0; // Free, but kept by the thread caches
+		uint32_t pendingFree = 0; // Freed but still waiting for the fence
+	};
+
+	class CDX12DescriptorAllocator
+	{
+	public:
+
+		static constexpr uint32_t InvalidIndex = 0xFFFFFFFF;
+
+		static constexpr uint32_t NumThreadCaches = 8;
+		static constexpr uint32_t ThreadCacheSize = 16;
+
+		// Called with the page index when a page is added, before any of its descriptors is handed out
+		using PageFunction = std::function<void(uint32_t page)>;
+
+		CDX12DescriptorAllocator() = delete;
+		CDX12DescriptorAllocator(const CDX12DescriptorAllocator&) = delete;
+		CDX12DescriptorAllocator(const CDX12DescriptorAllocator&&) = delete;
+		CDX12DescriptorAllocator& operator=(const CDX12DescriptorAllocator&) = delete;
+		CDX12DescriptorAllocator& operator=(const CDX12DescriptorAllocator&&) = delete;
+
+		// A maxPages of 0 lets the allocator grow without limit
+		// Will throw a std::logic_error exception if the page size is 0
+		CDX12DescriptorAllocator(uint32_t pageSize, uint32_t maxPages, PageFunction onNewPage = nullptr);
+
+		// Returns the first of count contiguous indices, InvalidIndex if every page allowed is full
+		// Will throw a std::logic_error exception if count is 0 or bigger than a page
+		uint32_t Allocate(uint32_t count = 1);
+
+		// Free now, the GPU must not be using the descriptors any more
+		void Free(uint32_t index, uint32_t count = 1);
+
+		// Free once the fence has reached the value
+		void Free(uint32_t index, uint32_t count, uint64_t fenceValue);
+
+		void ProcessDeferredFrees(uint64_t completedFenceValue);
+
+		// Give the descriptors kept by the thread caches back to the pages
+		void FlushThreadCaches();
+
+		uint32_t PageSize() const { return mPageSize; }
+
+		SDescriptorStats Stats() const;
+
+		// Check the free ranges and the caches are consistent, throws a std::logic_error exception if not
+		void Validate() const;
+
+	private:
+
+		struct SRange
+		{
+			uint32_t begin;
+			uint32_t end;
+		};
+
+		struct SDeferredFree
+		{
+			uint32_t index;
+			uint32_t count;
+			uint64_t fenceValue;
+		};
+
+		struct SThreadCache
+		{
+			std::mutex            mutex;
+			std::vector<uint32_t> indices;
+		};
+
+		SThreadCache& ThreadCache();
+
+		// The main mutex has to be locked
+		uint32_t AllocateLocked(uint32_t count);
+		void     FreeLocked(uint32_t index, uint32_t count);
+		bool     AddPage();
+
+		uint32_t     mPageSize;
+		uint32_t     mMaxPages;
+		PageFunction mOnNewPage;
+
+		// Free ranges of each page, sorted and never adjacent
+		std::vector<std::vector<SRange>> mPages;
+		std::vector<SDeferredFree>       mDeferredFrees;
+
+		mutable SThreadCache mThreadCaches[NumThreadCaches];
+
+		// Taken after a thread cache mutex, never before
+		mutable std::mutex mMutex;
+	};
+
+	class CDX12DescriptorRing
+	{
+	public:
+
+		static constexpr uint32_t InvalidIndex = CDX12DescriptorAllocator::InvalidIndex;
+
+		CDX12DescriptorRing() = delete;
+		CDX12DescriptorRing(const CDX12DescriptorRing&) = delete;
+		CDX12DescriptorRing(const CDX12DescriptorRing&&) = delete;
+		CDX12DescriptorRing& operator=(const CDX12DescriptorRing&) = delete;
+		CDX12DescriptorRing& operator=(const CDX12DescriptorRing&&) = delete;
+
+		// Will throw a std::logic_error exception if the size is 0
+		explicit CDX12DescriptorRing(uint32_t size);
+
+		// Returns the first of count contiguous indices, InvalidIndex if the ring is full
+		uint32_t Allocate(uint32_t count);
+
+		// The ranges allocated since the last call are released once the fence reaches the value
+		void EndFrame(uint64_t fenceValue);
+
+		void Retire(uint64_t completedFenceValue);
+
+		uint32_t Size() const { return mSize; }
+		uint32_t Used() const;
+
+	private:
+
+		struct SFrame
+		{
+			uint64_t fenceValue;
+			uint32_t count; // Including what was skipped when wrapping
+		};
+
+		uint32_t mSize;
+		uint32_t mHead    = 0;
+		uint32_t mUsed    = 0;
+		uint32_t mPending = 0; // Used by the frame being recorded
+
+		std::deque<SFrame> mFrames;
+
+		mutable std::mutex mMutex;
+	};
+}
@@ -1,101 +1,217 @@
 #include "DX12DescriptorHeap.h"
 
+#include <algorithm>
+
 #include "DX12Engine.h"
 
 namespace DX12
 {
-	CDX12DescriptorHeap::~CDX12DescriptorHeap()
+	namespace
 	{
-		// Remove all the handles
-		ZeroMemory(this, sizeof * this);
+		D3D12_DESCRIPTOR_HEAP_DESC HeapDesc(D3D12_DESCRIPTOR_HEAP_TYPE type, UINT count, D3D12_DESCRIPTOR_HEAP_FLAGS flags)
+		{
+			D3D12_DESCRIPTOR_HEAP_DESC desc = {};
+			desc.NumDescriptors = count;
+			desc.Flags = flags;
+			desc.Type = type;
+			return desc;
+		}
 	}
 
 	CDX12DescriptorHeap::CDX12DescriptorHeap(CDX12Engine* engine, D3D12_DESCRIPTOR_HEAP_DESC desc) :
-		mSize(desc.NumDescriptors),
-		mNextFree(0),
 		mEngine(engine),
-		mDesc(desc)
+		mDesc(desc),
+		mShaderVisible(desc.Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE)
 	{
-		mFreeIndexes.resize(mSize);
+		mIncrementSize = mEngine->mDevice->GetDescriptorHandleIncrementSize(mDesc.Type);
+
+		const auto count = std::max(mDesc.NumDescriptors, 1u);
 
-		for (uint32_t i = 0; i < mSize; ++i)
+		if (mShaderVisible)
 		{
-			mFreeIndexes[i] = i;
-		}
+			// The shader visible heap can't grow without moving the GPU handles, so it is made as big as it will ever be
+			mPageSize = std::min(count, PageSize);
+			const auto maxPages = (count + mPageSize - 1) / mPageSize;
+
+			const auto ringSize = mDesc.Type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV ? RingSize : 0;
+			mRingOffset = maxPages * mPageSize;
+
+			auto visibleDesc = mDesc;
+			visibleDesc.NumDescriptors = mRingOffset + ringSize;
+			if (FAILED(mEngine->mDevice->CreateDescriptorHeap(&visibleDesc, IID_PPV_ARGS(&mShaderVisibleHeap))))
+			{
+				throw std::runtime_error("Error Creating Descriptor Heap");
+			}
+
+			mShaderVisibleCpu = mShaderVisibleHeap->GetCPUDescriptorHandleForHeapStart();
+			mShaderVisibleGpu = mShaderVisibleHeap->GetGPUDescriptorHandleForHeapStart();
+
+			if (ringSize) mRing = std::make_unique<CDX12DescriptorRing>(ringSize);
 
-		if (FAILED(mEngine->mDevice->CreateDescriptorHeap(&mDesc, IID_PPV_ARGS(&mDescriptorHeap))))
+			mAllocator = std::make_unique<CDX12DescriptorAllocator>(mPageSize, maxPages, [this](uint32_t page) { CreatePage(page); });
+		}
+		else
 		{
-			throw std::runtime_error("Error Creating Descriptor Heap");
+			mPageSize = count;
+			mAllocator = std::make_unique<CDX12DescriptorAllocator>(mPageSize, 0, [this](uint32_t page) { CreatePage(page); });
 		}
-
-		mIncrementSize = mEngine->mDevice->GetDescriptorHandleIncrementSize(mDesc.Type);
 	}
 
 	CDX12DescriptorHeap::CDX12DescriptorHeap(CDX12Engine* engine,
 		D3D12_DESCRIPTOR_HEAP_TYPE type,
 		UINT count,
 		D3D12_DESCRIPTOR_HEAP_FLAGS flags) :
-		mSize(count),
-		mNextFree(0),
-		mEngine(engine)
+		CDX12DescriptorHeap(engine, HeapDesc(type, count, flags))
 	{
-		mDesc.NumDescriptors = count;
-		mDesc.Flags = flags;
-		mDesc.Type = type;
+	}
 
-		mFreeIndexes.resize(mSize);
+	D3D12_DESCRIPTOR_HEAP_DESC CDX12DescriptorHeap::GetDesc() const
+	{
+		return mDesc;
+	}
 
-		for (uint32_t i = 0; i < mSize; ++i)
+	void CDX12DescriptorHeap::SetName(const wchar_t* name)
+	{
+		std::unique_lock l(mPagesMutex);
+
+		mName = name;
+
+		if (mShaderVisibleHeap) DX12::SetName(mShaderVisibleHeap.Get(), name);
+
+		for (UINT i = 0; i < mPages.size(); ++i)
 		{
-			mFreeIndexes[i] = i;
+			SetNameIndexed(mPages[i].Get(), (mName + L"Staging").c_str(), i);
 		}
+	}
 
-		if (FAILED(mEngine->mDevice->CreateDescriptorHeap(&mDesc, IID_PPV_ARGS(&mDescriptorHeap))))
+	uint32_t CDX12DescriptorHeap::Add(UINT count)
+	{
+		auto index = mAllocator->Allocate(count);
+
+		if (index == CDX12DescriptorAllocator::InvalidIndex)
 		{
-			throw std::runtime_error("Error Creating Descriptor Heap");
+			// The frees waiting for the fence may be done by now
+			mAllocator->ProcessDeferredFrees(mEngine->mFence->GetCompletedValue());
+			index = mAllocator->Allocate(count);
+
+			if (index == CDX12DescriptorAllocator::InvalidIndex) throw std::bad_alloc();
 		}
 
-		mIncrementSize = mEngine->mDevice->GetDescriptorHandleIncrementSize(mDesc.Type);
+		return index;
 	}
 
-	D3D12_DESCRIPTOR_HEAP_DESC CDX12DescriptorHeap::GetDesc() const
+	SHandle CDX12DescriptorHeap::Get(UINT pos)
 	{
-		return mDesc;
+		SHandle newHandle;
+		newHandle.mIndexInDescriptor = pos;
+		newHandle.mCpu = CD3DX12_CPU_DESCRIPTOR_HANDLE(StagingCpu(pos));
+		newHandle.mGpu = mShaderVisible ?
+			CD3DX12_GPU_DESCRIPTOR_HANDLE(mShaderVisibleGpu, pos, mIncrementSize) :
+			CD3DX12_GPU_DESCRIPTOR_HANDLE(D3D12_DEFAULT);
+		return newHandle;
 	}
 
-	uint32_t CDX12DescriptorHeap::Add()
+	void CDX12DescriptorHeap::Commit(UINT pos, UINT count)
 	{
-		if (mNextFree == mSize) throw std::bad_alloc();
+		if (!mShaderVisible) return;
 
-		auto freeIndex = mFreeIndexes[mNextFree];
-		mNextFree++;
+		// The range is inside one page, so the staging descriptors are contiguous too
+		mEngine->mDevice->CopyDescriptorsSimple(count, GetShaderVisibleCpu(pos), StagingCpu(pos), mDesc.Type);
+	}
 
-		return freeIndex;
+	D3D12_CPU_DESCRIPTOR_HANDLE CDX12DescriptorHeap::GetShaderVisibleCpu(UINT pos) const
+	{
+		if (!mShaderVisible || pos >= mRingOffset) throw std::out_of_range("Out of range");
+
+		return CD3DX12_CPU_DESCRIPTOR_HANDLE(mShaderVisibleCpu, pos, mIncrementSize);
 	}
 
-	SHandle CDX12DescriptorHeap::Get(UINT pos)
+	void CDX12DescriptorHeap::Remove(UINT pos, UINT count)
+	{
+		if (mShaderVisible)
+		{
+			// Still read by the frames in flight until the frame being recorded is done
+			mAllocator->Free(pos, count, mEngine->mFenceValue + 1);
+		}
+		else
+		{
+			mAllocator->Free(pos, count);
+		}
+	}
+
+	SHandle CDX12DescriptorHeap::AllocateTable(const UINT* positions, UINT count)
 	{
-		if (pos == mSize) throw std::out_of_range("Out of range");
+		if (!mRing) throw std::runtime_error("The descriptor heap has no ring");
+
+		auto slot = mRing->Allocate(count);
+		if (slot == CDX12DescriptorRing::InvalidIndex)
+		{
+			mRing->Retire(mEngine->mFence->GetCompletedValue());
+			slot = mRing->Allocate(count);
+
+			if (slot == CDX12DescriptorRing::InvalidIndex) throw std::runtime_error("The descriptor ring is full");
+		}
+
+		const auto first = mRingOffset + slot;
+		for (UINT i = 0; i < count; ++i)
+		{
+			const CD3DX12_CPU_DESCRIPTOR_HANDLE destination(mShaderVisibleCpu, first + i, mIncrementSize);
+			mEngine->mDevice->CopyDescriptorsSimple(1, destination, StagingCpu(positions[i]), mDesc.Type);
+		}
 
 		SHandle newHandle;
-		newHandle.mIndexInDescriptor = pos;
-		newHandle.mCpu = CD3DX12_CPU_DESCRIPTOR_HANDLE(mDescriptorHeap->GetCPUDescriptorHandleForHeapStart(), newHandle.mIndexInDescriptor, mIncrementSize);
-		newHandle.mGpu = mDesc.Flags == D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE ?
-			CD3DX12_GPU_DESCRIPTOR_HANDLE(mDescriptorHeap->GetGPUDescriptorHandleForHeapStart(), newHandle.mIndexInDescriptor, mIncrementSize) :
-			CD3DX12_GPU_DESCRIPTOR_HANDLE();
+		newHandle.mIndexInDescriptor = first;
+		newHandle.mCpu = CD3DX12_CPU_DESCRIPTOR_HANDLE(mShaderVisibleCpu, first, mIncrementSize);
+		newHandle.mGpu = CD3DX12_GPU_DESCRIPTOR_HANDLE(mShaderVisibleGpu, first, mIncrementSize);
 		return newHandle;
 	}
 
-	void CDX12DescriptorHeap::Remove(UINT pos)
+	void CDX12DescriptorHeap::EndFrame(uint64_t fenceValue)
 	{
-		if (pos == mSize) throw std::out_of_range("Out of range");
-		--mNextFree;
-		mFreeIndexes[mNextFree] = pos;
+		const auto completedValue = mEngine->mFence->GetCompletedValue();
+
+		if (mRing)
+		{
+			mRing->EndFrame(fenceValue);
+			mRing->Retire(completedValue);
+		}
+
+		mAllocator->ProcessDeferredFrees(completedValue);
 	}
 
 	void CDX12DescriptorHeap::Set() const
 	{
-		ID3D12DescriptorHeap* const pheap[] = { mDescriptorHeap.Get() };
+		ID3D12DescriptorHeap* const pheap[] = { mShaderVisibleHeap.Get() };
 		mEngine->mCurrRecordingCommandList->SetDescriptorHeaps(1, pheap);
 	}
-}
\ No newline at end of file
+
+	void CDX12DescriptorHeap::CreatePage(uint32_t page)
+	{
+		auto desc = mDesc;
+		desc.NumDescriptors = mPageSize;
+		desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+
+		ComPtr<ID3D12DescriptorHeap> heap;
+		if (FAILED(mEngine->mDevice->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&heap))))
+		{
+			throw std::runtime_error("Error Creating Descriptor Heap");
+		}
+
+		std::unique_lock l(mPagesMutex);
+
+		if (!mName.empty()) SetNameIndexed(heap.Get(), (mName + L"Staging").c_str(), page);
+
+		mPageStarts.push_back(heap->GetCPUDescriptorHandleForHeapStart());
+		mPages.push_back(std::move(heap));
+	}
+
+	D3D12_CPU_DESCRIPTOR_HANDLE CDX12DescriptorHeap::StagingCpu(UINT pos) const
+	{
+		std::unique_lock l(mPagesMutex);
+
+		const auto page = pos / mPageSize;
+		if (page >= mPageStarts.size()) throw std::out_of_range("Out of range");
+
+		return CD3DX12_CPU_DESCRIPTOR_HANDLE(mPageStarts[page], pos % mPageSize, mIncrementSize);
+	}
+}
@@ -1,5 +1,25 @@
+//--------------------------------------------------------------------------------------
+// Descriptor heap
+//--------------------------------------------------------------------------------------
+// Descriptors are written on the CPU into staging pages (non shader visible descriptor
+// heaps), added when the previous pages are full. For shader visible heaps every staging
+// descriptor has a copy at the same position in one shader visible heap, so its GPU handle
+// never changes: Commit copies the descriptors there once they have been written. The end of
+// the shader visible heap is a ring for the descriptor tables only needed for one frame,
+// gathered from the staging descriptors by AllocateTable.
+// The indices come from CDX12DescriptorAllocator and are safe to use from several threads.
+// Shader visible descriptors are only given back once the frames in flight are done with
+// them; RTVs and DSVs are read when the command is recorded, so they are freed at once.
+
 #pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
 #include "DX12Common.h"
+#include "DX12DescriptorAllocator.h"
 
 namespace DX12
 {
@@ -10,8 +30,16 @@ namespace DX12
 
 	public:
 
-		virtual ~CDX12DescriptorHeap();
+		// Staging descriptors per page of the shader visible heaps
+		static constexpr UINT PageSize = 256;
+
+		// Per frame descriptors at the end of the shader visible CBV SRV UAV heaps
+		static constexpr UINT RingSize = 4096;
 
+		virtual ~CDX12DescriptorHeap() = default;
+
+		// The number of descriptors is the maximum for shader visible heaps, the page size for the others
+		// Will throw a std::runtime_error exception on failure
 		CDX12DescriptorHeap(CDX12Engine* engine, D3D12_DESCRIPTOR_HEAP_DESC desc);
 
 		explicit CDX12DescriptorHeap(CDX12Engine* engine,
@@ -25,29 +53,66 @@ namespace DX12
 		CDX12DescriptorHeap& operator=(const CDX12DescriptorHeap&) = delete;
 		CDX12DescriptorHeap& operator=(const CDX12DescriptorHeap&&) = delete;
 
-		ComPtr<ID3D12DescriptorHeap> mDescriptorHeap;
-
 		D3D12_DESCRIPTOR_HEAP_DESC GetDesc() const;
 
-		uint32_t Add();
+		// The shader visible heap, nullptr for the other heaps
+		ID3D12DescriptorHeap* Heap() const { return mShaderVisibleHeap.Get(); }
+
+		void SetName(const wchar_t* name);
 
+		// Returns the index of a new descriptor, or of the first of count contiguous ones for a descriptor table
+		// Will throw a std::bad_alloc exception if a shader visible heap is full
+		uint32_t Add(UINT count = 1);
+
+		// mCpu is where the descriptor is written, mGpu where the shaders read it
 		SHandle Get(UINT pos);
 
-		void Remove(UINT pos);
+		// Copy descriptors written through Get(pos).mCpu to the shader visible heap. Nothing to do for the other heaps
+		void Commit(UINT pos, UINT count = 1);
+
+		// Where to write a descriptor straight into the shader visible heap, for code that writes its descriptors itself
+		D3D12_CPU_DESCRIPTOR_HANDLE GetShaderVisibleCpu(UINT pos) const;
+
+		void Remove(UINT pos, UINT count = 1);
+
+		// Gather descriptors into consecutive slots of the ring, for a table only used by the frame being recorded
+		// Returns the handle of the first slot. Will throw a std::runtime_error exception if the ring is full
+		SHandle AllocateTable(const UINT* positions, UINT count);
+
+		// Called after the frame has been submitted with the fence value signalled at its end
+		void EndFrame(uint64_t fenceValue);
 
 		void Set() const;
 
+		SDescriptorStats Stats() const { return mAllocator->Stats(); }
+
 	private:
 
-		uint32_t mSize;
+		// Called by the allocator when it needs a new page
+		void CreatePage(uint32_t page);
 
-		uint32_t  mNextFree;
-		std::vector<uint32_t> mFreeIndexes;
+		D3D12_CPU_DESCRIPTOR_HANDLE StagingCpu(UINT pos) const;
 
-		CDX12Engine* mEngine;
+		CDX12Engine*               mEngine;
 		D3D12_DESCRIPTOR_HEAP_DESC mDesc;
-		UINT mIncrementSize;
-
+		UINT                       mIncrementSize;
+		UINT                       mPageSize;
+		bool                       mShaderVisible;
+		std::wstring               mName;
+
+		// Staging pages
+		std::vector<ComPtr<ID3D12DescriptorHeap>>  mPages;
+		std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>   mPageStarts;
+		mutable std::mutex                         mPagesMutex;
+
+		// Persistent descriptors first, then the ring
+		ComPtr<ID3D12DescriptorHeap> mShaderVisibleHeap;
+		D3D12_CPU_DESCRIPTOR_HANDLE  mShaderVisibleCpu = {};
+		D3D12_GPU_DESCRIPTOR_HANDLE  mShaderVisibleGpu = {};
+		UINT                         mRingOffset       = 0;
+
+		std::unique_ptr<CDX12DescriptorAllocator> mAllocator;
+		std::unique_ptr<CDX12DescriptorRing>      mRing;
 	};
 
-}
\ No newline at end of file
+}
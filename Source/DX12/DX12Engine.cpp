@@ -3,14 +3,32 @@
 #include <filesystem>
 
 #include "D3D12Helpers.h"
+#include "DX12CommandRecorder.h"
 #include "DX12ConstantBuffer.h"
 #include "DX12DescriptorHeap.h"
+#include "DX12FramePacer.h"
+#include "DX12GeometryArena.h"
+#include "DX12GpuProfiler.h"
+#include "DX12BlasCache.h"
+#include "DX12ShaderTable.h"
+#include "DX12Tlas.h"
 #include "DX12Gui.h"
+#include "DX12InstanceTable.h"
+#include "DX12MaterialTable.h"
+#include "DX12Mesh.h"
+#include "DX12PipelineCache.h"
 #include "DX12PipelineObject.h"
+#include "DX12RenderGraph.h"
+#include "DX12ResourceAllocator.h"
 #include "DX12Scene.h"
 #include "DX12Shader.h"
+#include "DX12ShaderCache.h"
 #include "DX12Texture.h"
+#include "DX12TextureStreamer.h"
+#include "DX12UploadHeap.h"
+#include "DX12UploadQueue.h"
 #include "../Window.h"
+#include "../Common/AssetCache.h"
 #include "../Common/CGameObjectManager.h"
 #include "Objects/CDX12Sky.h"
 #include "Objects/DX12DirectionalLight.h"
@@ -27,6 +45,10 @@
 
 namespace DX12
 {
+	thread_local ID3D12GraphicsCommandList4* CDX12Engine::mCurrRecordingCommandList = nullptr;
+	thread_local CDX12PSO*                   CDX12Engine::mCurrSetPso = nullptr;
+	thread_local uint32_t                    CDX12Engine::mCurrGeometryPool = SDX12Geometry::InvalidPool;
+
 	CDX12Engine::CDX12Engine(HINSTANCE hInstance,
 		int       nCmdShow)
 	{
@@ -55,11 +77,16 @@ namespace DX12
 			// Create a window 
 			mWindow = std::make_unique<CWindow>(hInstance, nCmdShow);
 
+			// Load Shaders, they compile on the threads of the cache while the device is created
+			mShaderCache = std::make_unique<CDX12ShaderCache>(mShaderFolder);
+
+			LoadDefaultShaders();
+
 			// Initialise Direct3D
 			InitD3D();
 
-			// Load Shaders
-			LoadDefaultShaders();
+			// Next to the shader cache, the library is only valid for the driver that wrote it
+			mPipelineCache = std::make_unique<CDX12PipelineCache>(this, mShaderFolder + "Cache/Pipelines.bin");
 
 			CreatePipelineStateObjects();
 
@@ -105,6 +132,10 @@ namespace DX12
 			}
 			else // When no windows messages left to process then render & update our scene
 			{
+				// Wait at the start of the frame rather than after Present, then read the input that came meanwhile
+				WaitForFrame();
+				if (!ProcessMessages(msg)) break;
+
 				// Update the scene by the amount of time since the last frame
 				auto frameTime = mTimer.GetLapTime();
 
@@ -112,15 +143,22 @@ namespace DX12
 				{
 					InitializeFrame();
 					MidFrame();
-					RaytracingFrame();
-					
+					{
+						CDX12GpuScope scope(mGpuProfiler.get(), mCommandList.Get(), "Raytracing");
+						RaytracingFrame();
+					}
+
 					mScene->UpdateScene(frameTime);
 
-					mGui->Begin();
+					{
+						CDX12GpuScope scope(mGpuProfiler.get(), mCommandList.Get(), "GUI Rendering");
+
+						mGui->Begin();
 
-					mGui->Show(frameTime);
+						mGui->Show(frameTime);
 
-					mGui->End();
+						mGui->End();
+					}
 
 					FinalizeFrame();
 					Present();
@@ -138,16 +176,16 @@ namespace DX12
 
 					MidFrame();
 
-					PIXBeginEvent(mCommandList.Get(), 0, L"GUI Rendering");
+					{
+						CDX12GpuScope scope(mGpuProfiler.get(), mCommandList.Get(), "GUI Rendering");
 
-					mGui->Begin();
+						mGui->Begin();
 
-					//mGui
-					mGui->Show(frameTime);
+						//mGui
+						mGui->Show(frameTime);
 
-					mGui->End();
-
-					PIXEndEvent(mCommandList.Get());
+						mGui->End();
+					}
 
 					FinalizeFrame();
 
@@ -165,6 +203,7 @@ namespace DX12
 					Flush();
 
 					CloseHandle(mFenceEvent);
+					CloseHandle(mFrameLatencyWaitable);
 
 					return false;
 				}
@@ -174,6 +213,7 @@ namespace DX12
 		Flush();
 
 		CloseHandle(mFenceEvent);
+		CloseHandle(mFrameLatencyWaitable);
 
 		return (int)msg.wParam;
 	}
@@ -199,16 +239,103 @@ namespace DX12
 		mCurrRecordingCommandList->ClearRenderTargetView(rtv, clearColor, 0, nullptr);
 	}
 
+	void CDX12Engine::WaitForFrame()
+	{
+		mFramePacer->BeginWait();
+
+		if (mFrameLatencyWaitable) std::ignore = WaitForSingleObjectEx(mFrameLatencyWaitable, 1000, TRUE);
+
+		mFramePacer->Completed(mFence->GetCompletedValue());
+
+		// The frame that last used this back buffer has to be done too, its allocators and constants are reused
+		const auto backBufferFence = mFrameFenceValues[mSwapChain->GetCurrentBackBufferIndex()];
+		WaitForFenceValue(mFence, std::max(mFramePacer->FenceToWait(), backBufferFence), mFenceEvent);
+
+		mFramePacer->Completed(mFence->GetCompletedValue());
+
+#if defined(_DEBUG)
+		mFramePacer->Validate();
+#endif
+
+		mFramePacer->BeginFrame();
+	}
+
+	bool CDX12Engine::ProcessMessages(MSG& msg)
+	{
+		while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+		{
+			TranslateMessage(&msg);
+			DispatchMessage(&msg);
+
+			if (msg.message == WM_QUIT) return false;
+		}
+		return true;
+	}
+
+	void CDX12Engine::SetMaxFramesInFlight(uint32_t frames)
+	{
+		frames = std::clamp(frames, 1u, mNumFrames);
+
+		mFramePacer->SetMaxFramesInFlight(frames);
+		ThrowIfFailed(mSwapChain->SetMaximumFrameLatency(frames));
+	}
+
+	CDX12Texture* CDX12Engine::Placeholder(uint32_t colour)
+	{
+		auto& placeholder = mPlaceholders[colour];
+		if (!placeholder) placeholder = std::make_unique<CDX12Texture>(this, colour, mSRVDescriptorHeap.get());
+
+		return placeholder.get();
+	}
+
 	void CDX12Engine::InitializeFrame()
 	{
+		// Before anything of the frame is recorded with the old pipelines
+		if (mShaderCache->Poll()) ReloadShaders();
+
 		mCurrentBackBufferIndex = mSwapChain->GetCurrentBackBufferIndex();
 
+		mUploadAllocator->BeginFrame(mCurrentBackBufferIndex);
+
+		mUploadQueue->ProcessCompletions();
+
+		// The streamed mips copied by now are in the views, then the objects ask for the mips they need this frame
+		if (mScene) mTextureStreamer->Update(mScene->GetCamera(), GetObjManager()->mObjects, mViewport.Width);
+
+		// The objects added since the last frame get their records, the records of the frame that changed are written.
+		// The lights are drawn with the objects, they need records too
+		if (mScene)
+		{
+			const auto renderables = GetObjManager()->Renderables();
+
+			mMaterialTable->Sync(renderables);
+			mMaterialTable->Update();
+
+			// With the material records of this frame
+			mInstanceTable->Sync(renderables);
+			mInstanceTable->Update();
+		}
+
+		mResourceAllocator->ProcessDeferredFrees();
+
+		// The ranges of the meshes destroyed before the frames that completed since go back to their pools
+		mGeometryArena->BeginFrame(mFence->GetCompletedValue());
+
+		// WaitForFrame waited for the fence of this frame, its recorded lists can be reused
+		mCommandRecorder->BeginFrame(mCurrentBackBufferIndex);
+
+		// Reads back the timestamps of the frame that used this index
+		mGpuProfiler->BeginFrame(mCurrentBackBufferIndex);
+
+		mRenderGraph->BeginFrame();
+
 		// Reset the main command allocator and the command list
 		mCommandAllocators[mCurrentBackBufferIndex]->Reset();
  		ThrowIfFailed(mCommandList->Reset(mCommandAllocators[mCurrentBackBufferIndex].Get(), nullptr));
 
-
-
+		mCurrRecordingCommandList = mCommandList.Get();
+		mCurrSetPso = nullptr;
+		mCurrGeometryPool = SDX12Geometry::InvalidPool;
 	}
 
 	void CDX12Engine::FinalizeFrame()
@@ -217,10 +344,18 @@ namespace DX12
 		{
 			mBackBuffers[mCurrentBackBufferIndex]->Barrier(D3D12_RESOURCE_STATE_PRESENT);
 
+			// The main list is executed last, after the scopes of every list
+			mGpuProfiler->EndFrame(mCommandList.Get());
+
 			mCommandList->Close();
 			
+			// The passes recorded on the worker threads come first, in the order they were added
 			std::vector<ID3D12CommandList*> commandLists;
+			mCommandRecorder->GetCommandLists(commandLists);
 			commandLists.push_back(mCommandList.Get());
+
+			// Meshes created during the frame are still being copied
+			mUploadQueue->WaitOnQueue(mCommandQueue.Get());
 			mCommandQueue->ExecuteCommandLists(commandLists.size(), commandLists.data());
 		}
 	}
@@ -229,6 +364,12 @@ namespace DX12
 	{
 		mFrameFenceValues[mCurrentBackBufferIndex] = Signal();
 
+		mFramePacer->Submit(mFrameFenceValues[mCurrentBackBufferIndex]);
+
+		mUploadAllocator->EndFrame(mFrameFenceValues[mCurrentBackBufferIndex]);
+
+		mSRVDescriptorHeap->EndFrame(mFrameFenceValues[mCurrentBackBufferIndex]);
+
 		DXGI_FRAME_STATISTICS o;
 		mSwapChain->GetFrameStatistics(&o);
 
@@ -277,10 +418,10 @@ namespace DX12
 			throw std::runtime_error("Error presenting");
 		}
 
+		mFramePacer->Presented();
 
+		// The next frame waits for its back buffer in WaitForFrame
 		mCurrentBackBufferIndex = mSwapChain->GetCurrentBackBufferIndex();
-
-		WaitForFenceValue(mFence.Get(), mFrameFenceValues[mCurrentBackBufferIndex], mFenceEvent);
 	}
 
 
@@ -292,8 +433,6 @@ namespace DX12
 	{
 		auto i = mCurrentBackBufferIndex;
 
-		mPerFrameConstantBuffer[i]->Copy(mPerFrameConstants[i]);
-
 		mPerFrameLightsConstantBuffer[i]->Copy<PerFrameLights, sLight>(mPerFrameLights[i], mObjManager->mLights.size());
 		mPerFrameSpotLightsConstantBuffer[i]->Copy<PerFrameSpotLights, sSpotLight>(mPerFrameSpotLights[i], mObjManager->mLights.size());
 		mPerFrameDirLightsConstantBuffer[i]->Copy<PerFrameDirLights, sDirLight>(mPerFrameDirLights[i], mObjManager->mLights.size());
@@ -420,6 +559,7 @@ namespace DX12
 
 		ID3D12CommandList* const ppCommandLists[] = { commandList };
 
+		mUploadQueue->WaitOnQueue(mCommandQueue.Get());
 		mCommandQueue->ExecuteCommandLists(1, ppCommandLists);
 		const uint64_t fenceValue = Signal();
 
@@ -556,6 +696,11 @@ namespace DX12
 		return p;
 	}
 
+	SMeshImportSettings CDX12Engine::MeshImportSettings() const
+	{
+		return CDX12Mesh::ImportSettings();
+	}
+
 	void CDX12Engine::Flush()
 	{
 		const uint64_t fenceValueForSignal = Signal();
@@ -615,10 +760,13 @@ namespace DX12
 	{
 		try
 		{
-			mPbrPso = std::make_unique<CDX12PBRPSO>(this);
-			mSkyPso = std::make_unique<CDX12SkyPSO>(this);
-			mDepthOnlyPso = std::make_unique<CDX12DepthOnlyPSO>(this, false);
-			mDepthOnlyTangentPso = std::make_unique<CDX12DepthOnlyPSO>(this, true);
+			// On a reload the pipelines replaced are used until the new ones are created
+			const auto previous = [](const auto& pso) { return pso ? pso->mPipeline : CDX12PipelineCache::InvalidHandle; };
+
+			mPbrPso = std::make_unique<CDX12PBRPSO>(this, previous(mPbrPso));
+			mSkyPso = std::make_unique<CDX12SkyPSO>(this, previous(mSkyPso));
+			mDepthOnlyPso = std::make_unique<CDX12DepthOnlyPSO>(this, false, previous(mDepthOnlyPso));
+			mDepthOnlyTangentPso = std::make_unique<CDX12DepthOnlyPSO>(this, true, previous(mDepthOnlyTangentPso));
 		}
 		catch (const std::exception& e)
 		{
@@ -645,6 +793,12 @@ namespace DX12
 
 			if (!vs || !ps) throw std::runtime_error("Error loading default shaders");
 
+			// Only used once the raytracing pipeline is made, started now with the others
+			for (const auto library : { "RayGen.hlsl", "Miss.hlsl", "Hit.hlsl", "ShadowRay.hlsl" })
+			{
+				mShaderCache->Request({ library, "", "lib_6_3" });
+			}
+
 
 			// I have disabled those because they are not used at the moment and they take a while to compile
 
@@ -660,6 +814,17 @@ namespace DX12
 	}
 
 
+	void CDX12Engine::ReloadShaders()
+	{
+		// The frames in flight still use the root signatures of the pipeline objects
+		Flush();
+
+		// The raytracing pipeline keeps the libraries it was made with. The new pipeline
+		// states are created in the background, the old ones are set until they are ready
+		LoadDefaultShaders();
+		CreatePipelineStateObjects();
+	}
+
 	void CDX12Engine::CheckRayTracingSupport() const
 	{
 		D3D12_FEATURE_DATA_D3D12_OPTIONS5 options5 = {};
@@ -988,7 +1153,11 @@ namespace DX12
 				throw std::runtime_error("Error casting swap chain");
 			}
 
-			mSwapChain->SetMaximumFrameLatency(3);
+			// Frames are paced at their start on this object instead of waiting after Present
+			ThrowIfFailed(mSwapChain->SetMaximumFrameLatency(mNumFrames));
+			mFrameLatencyWaitable = mSwapChain->GetFrameLatencyWaitableObject();
+
+			mFramePacer = std::make_unique<CDX12FramePacer>(mNumFrames, std::make_unique<CThroughputPacing>());
 
 		}
 
@@ -1005,17 +1174,18 @@ namespace DX12
 
 			mRTVDescriptorHeap = std::make_unique<CDX12DescriptorHeap>(this, desc);
 
-			NAME_D3D12_OBJECT(mRTVDescriptorHeap->mDescriptorHeap);
+			mRTVDescriptorHeap->SetName(L"mRTVDescriptorHeap");
 
 			//Describe and create a shader resource view (SRV) descriptor heap.
+			// Only the staging pages in use are created, but the shader visible heap is made this big at once
 
-			desc.NumDescriptors = 1000;
+			desc.NumDescriptors = 16384;
 			desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
 			desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 
 			mSRVDescriptorHeap = std::make_unique<CDX12DescriptorHeap>(this, desc);
 
-			NAME_D3D12_OBJECT(mSRVDescriptorHeap->mDescriptorHeap);
+			mSRVDescriptorHeap->SetName(L"mSRVDescriptorHeap");
 
 			// Describe and create a sampler descriptor heap
 			desc.NumDescriptors = 1;
@@ -1023,7 +1193,7 @@ namespace DX12
 			desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER;
 
 			mSamplerDescriptorHeap = std::make_unique<CDX12DescriptorHeap>(this, desc);
-			NAME_D3D12_OBJECT(mSamplerDescriptorHeap->mDescriptorHeap);
+			mSamplerDescriptorHeap->SetName(L"mSamplerDescriptorHeap");
 		}
 		catch (const std::exception& e)
 		{
@@ -1045,13 +1215,6 @@ namespace DX12
 
 				NAME_D3D12_OBJECT_INDEXED(mCommandAllocators, i);
 			}
-
-			for (size_t i = 0; i < ARRAYSIZE(mAmbientMapCommandAllocators); ++i)
-			{
-				auto commandAllocator = mAmbientMapCommandAllocators[i].GetAddressOf();
-				ThrowIfFailed(mDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(commandAllocator)))
-					NAME_D3D12_OBJECT_INDEXED(mAmbientMapCommandAllocators, i);
-			}
 		}
 
 		// Create command list 
@@ -1063,24 +1226,11 @@ namespace DX12
 
 			mCurrRecordingCommandList = mCommandList.Get();
 
+			NAME_D3D12_OBJECT(mCommandList);
 
-			for (size_t i = 0; i < ARRAYSIZE(mAmbientMapCommandLists); ++i)
-			{
-				auto j = i * mNumFrames;
-
-				ThrowIfFailed(
-					mDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT,
-						mAmbientMapCommandAllocators[i * mNumFrames].Get(),
-						nullptr,
-						IID_PPV_ARGS(&mAmbientMapCommandLists[i])));
-
-				mAmbientMapCommandLists[i]->Close();
-
-				NAME_D3D12_OBJECT_INDEXED(mAmbientMapCommandLists, i);
-
-			}
+			mCommandRecorder = std::make_unique<CDX12CommandRecorder>(this, mNumFrames);
 
-			NAME_D3D12_OBJECT(mCommandList);
+			mRenderGraph = std::make_unique<CDX12RenderGraph>(this);
 		}
 
 		// Create fence
@@ -1095,30 +1245,39 @@ namespace DX12
 			mFenceEvent = CreateEventHandle();
 		}
 
+		mResourceAllocator = std::make_shared<CDX12ResourceAllocator>(this);
+
+		// Per draw constants, one set of pages per frame in flight
+		mUploadHeap = std::make_unique<CDX12UploadHeap>(this);
+		mUploadAllocator = std::make_unique<CDX12UploadAllocator>(mUploadHeap.get(), mNumFrames);
+
+		mUploadQueue = std::make_unique<CDX12UploadQueue>(this);
+
+		mGeometryArena = std::make_unique<CDX12GeometryArena>(this);
+
+		mTextureStreamer = std::make_unique<CDX12TextureStreamer>(this);
+
+		mMaterialTable = std::make_unique<CDX12MaterialTable>(this);
+		mInstanceTable = std::make_unique<CDX12InstanceTable>(this);
+
+		mGpuProfiler = std::make_unique<CDX12GpuProfiler>(this, mNumFrames);
+
 		// Create the constant buffers.
 		try
 		{
 			for (auto i = 0; i < 3; ++i)
 			{
-				mPerFrameConstantBuffer[i] = std::make_unique<CDX12ConstantBuffer>(this, mSRVDescriptorHeap.get(), sizeof(PerFrameConstants));
-				mPerFrameConstantBuffer[i]->Copy(mPerFrameConstants[i]);
-				NAME_D3D12_OBJECT(mPerFrameConstantBuffer[i]->Resource());
-
 				mPerFrameLightsConstantBuffer[i] = std::make_unique<CDX12ConstantBuffer>(this, mSRVDescriptorHeap.get(), sizeof(PerFrameLights));
 				mPerFrameLightsConstantBuffer[i]->Copy(mPerFrameLights[i]);
-				NAME_D3D12_OBJECT(mPerFrameLightsConstantBuffer[i]->Resource());
 
 				mPerFrameSpotLightsConstantBuffer[i] = std::make_unique<CDX12ConstantBuffer>(this, mSRVDescriptorHeap.get(), sizeof(PerFrameSpotLights));
 				mPerFrameSpotLightsConstantBuffer[i]->Copy(mPerFrameSpotLights[i]);
-				NAME_D3D12_OBJECT(mPerFrameSpotLightsConstantBuffer[i]->Resource());
 
 				mPerFrameDirLightsConstantBuffer[i] = std::make_unique<CDX12ConstantBuffer>(this, mSRVDescriptorHeap.get(), sizeof(PerFrameDirLights));
 				mPerFrameDirLightsConstantBuffer[i]->Copy(mPerFrameDirLights[i]);
-				NAME_D3D12_OBJECT(mPerFrameDirLightsConstantBuffer[i]->Resource());
 
 				mPerFramePointLightsConstantBuffer[i] = std::make_unique<CDX12ConstantBuffer>(this, mSRVDescriptorHeap.get(), sizeof(PerFramePointLights));
 				mPerFramePointLightsConstantBuffer[i]->Copy(mPerFramePointLights[i]);
-				NAME_D3D12_OBJECT(mPerFramePointLightsConstantBuffer[i]->Resource());
 			}
 		}
 		catch (const std::exception& e)
@@ -1155,11 +1314,11 @@ namespace DX12
 	}
 
 
-	void CDX12Engine::SetConstantBuffers()
+	void CDX12Engine::SetConstantBuffers(D3D12_GPU_VIRTUAL_ADDRESS perFrameConstants)
 	{
 		mSRVDescriptorHeap->Set();
 
-		mPerFrameConstantBuffer[mCurrentBackBufferIndex]->Set(1);
+		mCurrRecordingCommandList->SetGraphicsRootConstantBufferView(1, perFrameConstants);
 		mPerFrameLightsConstantBuffer[mCurrentBackBufferIndex]->Set(2);
 		mPerFrameSpotLightsConstantBuffer[mCurrentBackBufferIndex]->Set(3);
 		mPerFrameDirLightsConstantBuffer[mCurrentBackBufferIndex]->Set(4);
@@ -1178,13 +1337,10 @@ namespace DX12
 		 // by semantic (ray generation, hit, miss) for clarity. Any code layout can be
 		 // used.
 
-		const auto target = L"-T lib_6_3";
-
-		std::vector args{ target };
-		mRayGenLibrary = CompileShader(L"RayGen.hlsl", args);
-		mMissLibrary = CompileShader(L"Miss.hlsl", args);
-		mHitLibrary = CompileShader(L"Hit.hlsl", args);
-		mShadowLibrary = CompileShader(L"ShadowRay.hlsl", args);
+		mRayGenLibrary = mShaderCache->Get({ "RayGen.hlsl", "", "lib_6_3" });
+		mMissLibrary = mShaderCache->Get({ "Miss.hlsl", "", "lib_6_3" });
+		mHitLibrary = mShaderCache->Get({ "Hit.hlsl", "", "lib_6_3" });
+		mShadowLibrary = mShaderCache->Get({ "ShadowRay.hlsl", "", "lib_6_3" });
 
 		// In a way similar to DLLs, each library is associated with a number of
 		// exported symbols. This
@@ -1277,13 +1433,12 @@ namespace DX12
 
 	void CDX12Engine::CreateRTFrameDependentResources()
 	{
-		if (mOutputResource)
+		// The output UAV, the TLAS SRV and the camera CBV make the descriptor table of the ray generation shader
+		if (!mOutputResource)
 		{
-			mSRVDescriptorHeap->Remove(mOutputSrvIndex);
+			mOutputSrvIndex = mSRVDescriptorHeap->Add(3);
 		}
 
-		mOutputSrvIndex = mSRVDescriptorHeap->Add();
-
 		auto width = !GetScene() ? 1920 : GetScene()->GetViewportX();
 		auto height = !GetScene() ? 1080 : GetScene()->GetViewportY();
 
@@ -1303,18 +1458,21 @@ namespace DX12
 		resDesc.MipLevels = 1;
 		resDesc.SampleDesc.Count = 1;
 
-		mDevice->CreateCommittedResource(&DXR::kDefaultHeapProps, D3D12_HEAP_FLAG_NONE, &resDesc, D3D12_RESOURCE_STATE_COPY_SOURCE, nullptr, IID_PPV_ARGS(mOutputResource.GetAddressOf()));
+		mOutputResource = mResourceAllocator->CreateResource(D3D12_HEAP_TYPE_DEFAULT, resDesc, D3D12_RESOURCE_STATE_COPY_SOURCE);
 
 		D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
 		uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
 		mDevice->CreateUnorderedAccessView(mOutputResource.Get(), nullptr, &uavDesc, mSRVDescriptorHeap->Get(mOutputSrvIndex).mCpu);
+		mSRVDescriptorHeap->Commit(mOutputSrvIndex);
 	}
 
 	void CDX12Engine::InitRaytracing()
 	{
 		InitializeFrame();
 
-		mTopLevelAsGenerator = std::make_unique<DXR::TopLevelASGenerator>();
+		if (!mBlasCache) mBlasCache = std::make_unique<CDX12BlasCache>(this);
+		if (!mShaderTable) mShaderTable = std::make_unique<CDX12ShaderTable>(this);
+		if (!mTlas) mTlas = std::make_unique<CDX12Tlas>(this);
 
 		CreateAccelerationStructures(this);
 
@@ -1322,16 +1480,9 @@ namespace DX12
 
 		CreateRTFrameDependentResources();
 
-		mTopASIndex = mSRVDescriptorHeap->Add();
-
 		// Add the Top Level AS SRV right after the raytracing output buffer
-		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc;
-		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
-		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE;
-		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-		srvDesc.RaytracingAccelerationStructure.Location = mTopLevelAsBuffers.pResult->GetGPUVirtualAddress();
-		// Write the acceleration structure view in the heap
-		mDevice->CreateShaderResourceView(nullptr, &srvDesc, mSRVDescriptorHeap->Get(mTopASIndex).mCpu);
+		mTopASIndex = mOutputSrvIndex + 1;
+		CreateTopLevelASView();
 
 		// #DXR Extra: Perspective Camera
 		// Add the constant buffer for the camera after the TLAS
@@ -1342,99 +1493,66 @@ namespace DX12
 
 			mRTLightsBuffer[i] = std::make_unique<CDX12ConstantBuffer>(this, mSRVDescriptorHeap.get(), sizeof(PerFrameLights));
 			mRTLightsBuffer[i]->Copy(mPerFrameLights);
-			mRTLightsBuffer[i]->Resource()->SetName(L"RaytracingLightsBuffer");
 		}
 
-		CreateShaderBindingTable();
+		// Then the camera CBV, at the end of the table
+		const auto cameraIndex = mOutputSrvIndex + 2;
+		mDevice->CopyDescriptorsSimple(1,
+			mSRVDescriptorHeap->Get(cameraIndex).mCpu,
+			mSRVDescriptorHeap->Get(mCameraBuffer[mCurrentBackBufferIndex]->mHandle).mCpu,
+			D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		mSRVDescriptorHeap->Commit(cameraIndex);
+
+		// The records of the shader table are written by the raytraced frames, pointing at one lights buffer
+		mRTLights = mResourceAllocator->CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, ROUND_UP(sizeof(PerFrameLights), D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT),
+			D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+		NAME_D3D12_OBJECT(mRTLights);
 	}
 
-	void CDX12Engine::CreateShaderBindingTable()
+	void CDX12Engine::CreateTopLevelASView()
 	{
-		// The SBT helper class collects calls to Add*Program. If called several
-		// times, the helper must be emptied before re-adding shaders.
-
-		mSbtHelper = std::make_unique<DXR::ShaderBindingTableGenerator>();
-
-		mSbtHelper->Reset();
-
-		std::vector<void*> inputData;
-
-		inputData.push_back((void*)mSRVDescriptorHeap->Get(mOutputSrvIndex).mGpu.ptr);
-		inputData.push_back((void*)mSRVDescriptorHeap->Get(mTopASIndex).mGpu.ptr);
-		inputData.push_back((void*)mSRVDescriptorHeap->Get(mCameraBuffer[mCurrentBackBufferIndex]->mHandle).mGpu.ptr);
-
-		/*
-			We can now add the various programs used in our example : according to its root signature, the ray generation shader needs to access
-			the raytracing output bufferand the top - level acceleration structure referenced in the heap.Therefore, it
-			takes a single resource pointer towards the beginning of the heap data.The miss shaderand the hit group
-			only communicate through the ray payload, and do not require any resource, hence an empty resource array.
-			Note that the helper will group the shaders by types in the SBT, so it is possible to declare them in an
-			arbitrary order.For example, miss programs can be added before or after ray generation programs without
-			affecting the result.
-			However, within a given type(say, the hit groups), the order in which they are added
-			is important.It needs to correspond to the `InstanceContributionToHitGroupIndex` value used when adding
-			instances to the top - level acceleration structure : for example, an instance having `InstanceContributionToHitGroupIndex= = 0`
-			needs to have its hit group added first in the SBT.
-		 */
-
-		 // The ray generation only uses heap data
-		mSbtHelper->AddRayGenerationProgram(L"RayGen", inputData);
-		// The miss and hit shaders do not access any external resources: instead they
-		// communicate their results through the ray payload
-		mSbtHelper->AddMissProgram(L"Miss", {});
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc;
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE;
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.RaytracingAccelerationStructure.Location = mTlas->Resource()->GetGPUVirtualAddress();
+		// Write the acceleration structure view in the heap
+		mDevice->CreateShaderResourceView(nullptr, &srvDesc, mSRVDescriptorHeap->Get(mTopASIndex).mCpu);
+		mSRVDescriptorHeap->Commit(mTopASIndex);
+	}
 
-		mSbtHelper->AddMissProgram(L"ShadowMiss", {});
+	void CDX12Engine::MoveRayGenTable()
+	{
+		const auto previous = mOutputSrvIndex;
 
-		inputData.clear();
+		mOutputSrvIndex = mSRVDescriptorHeap->Add(3);
+		mTopASIndex = mOutputSrvIndex + 1;
 
-		for (const auto& object : GetObjManager()->mObjects)
+		// The output and the camera views stay the same
+		for (const auto offset : { 0u, 2u })
 		{
-			auto o = dynamic_cast<CDX12GameObject*>(object);
-
-			const auto mat = o->Material();
-
-			for (const auto& subMesh : o->Mesh()->mSubMeshes)
-			{
-				inputData.push_back((void*)mRTLightsBuffer[mCurrentBackBufferIndex]->Resource()->GetGPUVirtualAddress());
-				inputData.push_back((void*)mat->mMaterialCB->Resource()->GetGPUVirtualAddress());
-
-				// This has to follow the exact order of the root signature
-				inputData.push_back((void*)mSRVDescriptorHeap->Get(mTopASIndex).mGpu.ptr);
-				inputData.push_back((void*)subMesh.mVertexBuffer->GetGPUVirtualAddress());
-				inputData.push_back((void*)subMesh.mIndexBuffer->GetGPUVirtualAddress());
-
-				inputData.push_back((void*)mat->mAlbedo->GetHandle().mGpu.ptr);
-			}
+			mDevice->CopyDescriptorsSimple(1,
+				mSRVDescriptorHeap->Get(mOutputSrvIndex + offset).mCpu,
+				mSRVDescriptorHeap->Get(previous + offset).mCpu,
+				D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 		}
+		mSRVDescriptorHeap->Commit(mOutputSrvIndex, 3);
 
-		// Adding the main hit shader
-		mSbtHelper->AddHitGroup(L"HitGroup", inputData);
-
-		// Adding the shadow hit group
-		mSbtHelper->AddHitGroup(L"ShadowHitGroup", {});
-
-		// Compute the size of the SBT given the number of shaders and their
-		// parameters
-		uint32_t sbtSize = mSbtHelper->ComputeSBTSize();
+		CreateTopLevelASView();
 
-		// Create the SBT on the upload heap. This is required as the helper will use
-		// mapping to write the SBT contents. After the SBT compilation it could be
-		// copied to the default heap for performance.
-		mSbtStorage = DXR::CreateBuffer(mDevice.Get(), sbtSize, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ, DXR::kUploadHeapProps);
-
-		if (!mSbtStorage)
-		{
-			throw std::logic_error("Could not allocate the shader binding table");
-		}
-
-		// Compile the SBT from the shader and parameters info
-		mSbtHelper->Generate(mSbtStorage.Get(), mRaytracingStateObjectProps.Get());
+		// The shader table points the ray generation record at the new table, the old one is freed once the frames in flight are done with it
+		mSRVDescriptorHeap->Remove(previous, 3);
 	}
 
 	void CDX12Engine::RaytracingFrame()
 	{
+		// Objects added or removed since the last frame get or lose their hit records and their instance
+		mShaderTable->Sync(GetObjManager()->mObjects);
 
-		CreateTopLevelAS(mInstances, this, true);
+		// The frames in flight still read the table with the view of the old buffer, the new view goes to a new table
+		if (mTlas->Sync(GetObjManager()->mObjects)) MoveRayGenTable();
+
+		mTlas->Update(mCommandList.Get());
 
 		D3D12_RESOURCE_BARRIER barriers[] =
 		{
@@ -1464,35 +1582,20 @@ namespace DX12
 			UpdateLightsBuffers();
 
 			mRTLightsBuffer[mCurrentBackBufferIndex]->Copy<PerFrameLights, sLight>(mPerFrameLights[mCurrentBackBufferIndex], GetObjManager()->mLights.size());
+
+			const auto& lights = mRTLightsBuffer[mCurrentBackBufferIndex];
+			const D3D12_RESOURCE_BARRIER toCopy = CD3DX12_RESOURCE_BARRIER::Transition(mRTLights.Get(), D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, D3D12_RESOURCE_STATE_COPY_DEST);
+			const D3D12_RESOURCE_BARRIER toRead = CD3DX12_RESOURCE_BARRIER::Transition(mRTLights.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+			mCommandList->ResourceBarrier(1, &toCopy);
+			mCommandList->CopyBufferRegion(mRTLights.Get(), 0, lights->Resource(), lights->Offset(), sizeof(PerFrameLights));
+			mCommandList->ResourceBarrier(1, &toRead);
 		}
 
-		// Setup the raytracing task
+		mShaderTable->Update(mCommandList.Get());
+
+		// Setup the raytracing task, the ray generation, miss and hit tables come from the shader table
 		D3D12_DISPATCH_RAYS_DESC desc = {};
-		// The layout of the SBT is as follows: ray generation shader, miss
-		// shaders, hit groups. As described in the CreateShaderBindingTable method,
-		// all SBT entries of a given type have the same size to allow a fixed stride.
-		// The ray generation shaders are always at the beginning of the SBT.
-		uint32_t rayGenerationSectionSizeInBytes = mSbtHelper->GetRayGenSectionSize();
-		desc.RayGenerationShaderRecord.StartAddress = mSbtStorage->GetGPUVirtualAddress();
-		desc.RayGenerationShaderRecord.SizeInBytes = rayGenerationSectionSizeInBytes;
-
-		// The miss shaders are in the second SBT section, right after the ray
-		// generation shader. We have one miss shader for the camera rays and one
-		// for the shadow rays, so this section has a size of 2*m_sbtEntrySize. We
-		// also indicate the stride between the two miss shaders, which is the size
-		// of a SBT entry
-
-		uint32_t missSectionSizeInBytes = mSbtHelper->GetMissSectionSize();
-		desc.MissShaderTable.StartAddress = mSbtStorage->GetGPUVirtualAddress() + rayGenerationSectionSizeInBytes;
-		desc.MissShaderTable.SizeInBytes = missSectionSizeInBytes;
-		desc.MissShaderTable.StrideInBytes = mSbtHelper->GetMissEntrySize();
-
-		// The hit groups section start after the miss shaders. In this sample we
-		// have one 1 hit group for the triangle
-		uint32_t hitGroupsSectionSize = mSbtHelper->GetHitGroupSectionSize();
-		desc.HitGroupTable.StartAddress = mSbtStorage->GetGPUVirtualAddress() + rayGenerationSectionSizeInBytes + missSectionSizeInBytes;
-		desc.HitGroupTable.SizeInBytes = hitGroupsSectionSize;
-		desc.HitGroupTable.StrideInBytes = mSbtHelper->GetHitGroupEntrySize();
+		mShaderTable->SetTables(desc);
 
 		desc.Width = GetScene()->GetViewportX();
 		desc.Height = GetScene()->GetViewportY();
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <atomic>
+#include <unordered_map>
+
 #include "..\Engine.h"
 
 
@@ -7,8 +10,6 @@
 #include "imgui.h"
 
 #include "DXR/RaytracingPipelineGenerator.h"
-#include "DXR/ShaderBindingTableGenerator.h"
-#include "DXR/TopLevelASGenerator.h"
 
 
 class CGameObjectManager;
@@ -25,8 +26,25 @@ namespace DX12
 	class CDX12RenderTarget;
 	class CDX12DescriptorHeap;
 	class CDX12ConstantBuffer;
+	class CDX12UploadHeap;
+	class CDX12UploadAllocator;
+	class CDX12UploadQueue;
+	class CDX12GeometryArena;
+	class CDX12TextureStreamer;
+	class CDX12MaterialTable;
+	class CDX12InstanceTable;
+	class CDX12CommandRecorder;
+	class CDX12RenderGraph;
+	class CDX12ResourceAllocator;
 	class CDX12Gui;
 	class CDX12Shader;
+	class CDX12ShaderCache;
+	class CDX12PipelineCache;
+	class CDX12FramePacer;
+	class CDX12GpuProfiler;
+	class CDX12BlasCache;
+	class CDX12Tlas;
+	class CDX12ShaderTable;
 
 	class CDX12Engine final : public IEngine
 	{
@@ -78,6 +96,9 @@ namespace DX12
 
 		ComPtr<ID3D12Device5> mDevice;
 
+		// Memory of the placed resources. Declared early so it goes after the resources the engine owns
+		std::shared_ptr<CDX12ResourceAllocator> mResourceAllocator;
+
 		ComPtr<IDXGISwapChain4> mSwapChain;
 
 
@@ -103,10 +124,14 @@ namespace DX12
 
 		ComPtr<ID3D12CommandQueue> mCommandQueue;
 
-		ComPtr<ID3D12GraphicsCommandList4> mAmbientMapCommandLists[6];
-		ComPtr<ID3D12CommandAllocator> mAmbientMapCommandAllocators[6 * mNumFrames];
+		// The list the calling thread records into: mCommandList on the main thread, the list of the job on the recording threads
+		static thread_local ID3D12GraphicsCommandList4* mCurrRecordingCommandList;
+
+		// Records the passes of the frame on worker threads, submitted before mCommandList
+		std::unique_ptr<CDX12CommandRecorder> mCommandRecorder;
 
-		ID3D12GraphicsCommandList4* mCurrRecordingCommandList;
+		// The passes of the scene with the resources they use, recorded through mCommandRecorder
+		std::unique_ptr<CDX12RenderGraph> mRenderGraph;
 
 		/*
 		 * The ID3D12CommandAllocator serves as the backing memory for recording the GPU commands into a command list.
@@ -167,7 +192,8 @@ namespace DX12
 		ComPtr<ID3D12Fence> mFence;
 
 		// The next fence value to signal the command queue next is stored in the mFenceValue variable.
-		uint64_t mFenceValue = 0;
+		// Worker threads read it to pick the fence value of their deferred frees while the main thread signals
+		std::atomic<uint64_t> mFenceValue = 0;
 
 		/*
 		 * For each rendered frame that could be in-flight on the command queue,
@@ -182,17 +208,26 @@ namespace DX12
 		// The mFenceEvent variable is a handle to an OS event object that will be used to receive the notification that the fence has reached a specific value.
 		HANDLE mFenceEvent;
 
+		// Signaled by the swap chain when it can queue another frame within its maximum frame latency
+		HANDLE mFrameLatencyWaitable = nullptr;
+
+		// When a frame starts, how many are in flight, and their timings
+		std::unique_ptr<CDX12FramePacer> mFramePacer;
+
+		// At most mNumFrames, for the swap chain and the pacer
+		void SetMaxFramesInFlight(uint32_t frames);
+
 		//----------------------------------------
 		// Constant Buffers
 		//-----------------------------------------
 
+		// Shared by every view of the frame, each view copies it with its own camera to the upload allocator
 		PerFrameConstants mPerFrameConstants[mNumFrames];
 		PerFrameLights mPerFrameLights[mNumFrames];
 		PerFramePointLights mPerFramePointLights[mNumFrames];
 		PerFrameSpotLights mPerFrameSpotLights[mNumFrames];
 		PerFrameDirLights mPerFrameDirLights[mNumFrames];
 
-		std::unique_ptr<CDX12ConstantBuffer> mPerFrameConstantBuffer[mNumFrames];
 		std::unique_ptr<CDX12ConstantBuffer> mPerFrameLightsConstantBuffer[mNumFrames];
 		std::unique_ptr<CDX12ConstantBuffer> mPerFrameSpotLightsConstantBuffer[mNumFrames];
 		std::unique_ptr<CDX12ConstantBuffer> mPerFrameDirLightsConstantBuffer[mNumFrames];
@@ -200,6 +235,33 @@ namespace DX12
 		std::unique_ptr<CDX12ConstantBuffer> mCameraBuffer[mNumFrames];
 		std::unique_ptr<CDX12ConstantBuffer> mRTLightsBuffer[mNumFrames];
 
+		// Constants that change every draw, bound as root constant buffer views
+		std::unique_ptr<CDX12UploadHeap>      mUploadHeap;
+		std::unique_ptr<CDX12UploadAllocator> mUploadAllocator;
+
+		// Static geometry and textures, copied to the default heap on the copy queue
+		std::unique_ptr<CDX12UploadQueue> mUploadQueue;
+
+		// The vertices and indices of every mesh, in pools shared by the meshes of a vertex layout
+		std::unique_ptr<CDX12GeometryArena> mGeometryArena;
+
+		// The one texel texture of the colour that textures show until their copy is done, created the first time
+		CDX12Texture* Placeholder(uint32_t colour);
+
+		std::unordered_map<uint32_t, std::unique_ptr<CDX12Texture>> mPlaceholders;
+
+		// The mips of the cooked textures, within a video memory budget
+		std::unique_ptr<CDX12TextureStreamer> mTextureStreamer;
+
+		// The maps and parameters of the objects, read by the PBR draws through their index
+		std::unique_ptr<CDX12MaterialTable> mMaterialTable;
+
+		// The world matrices of the nodes of the objects with their material, read by the PBR draws through their index
+		std::unique_ptr<CDX12InstanceTable> mInstanceTable;
+
+		// GPU times of the scopes of the frame, which are also its PIX events
+		std::unique_ptr<CDX12GpuProfiler> mGpuProfiler;
+
 		void CopyBuffers();
 
 		void UpdateLightsBuffers();
@@ -219,7 +281,11 @@ namespace DX12
 
 	public:
 
-		CDX12PSO* mCurrSetPso;
+		// Per recording thread, like the command list
+		static thread_local CDX12PSO* mCurrSetPso;
+
+		// The geometry pool whose buffers are set on the command list of the thread, see CDX12GeometryArena::Draw
+		static thread_local uint32_t mCurrGeometryPool;
 
 		// This functions will avoid setting the same pso if already set
 		void SetPBRPSO();
@@ -231,6 +297,12 @@ namespace DX12
 		// Shaders
 		//-----------------------------------------
 
+		// Loads and compiles the shaders in parallel, keeps the DXIL on disk and recompiles the edited ones
+		std::unique_ptr<CDX12ShaderCache> mShaderCache;
+
+		// Creates the pipeline state objects on worker threads, and keeps them in a pipeline library on disk
+		std::unique_ptr<CDX12PipelineCache> mPipelineCache;
+
 		std::unique_ptr<CDX12Shader> mPbrPixelShader;
 		std::unique_ptr<CDX12Shader> mPbrVertexShader;
 		std::unique_ptr<CDX12Shader> mPbrNormalPixelShader;
@@ -253,10 +325,15 @@ namespace DX12
 
 		void InitFrameDependentResources();
 
-		void SetConstantBuffers();
+		// The per frame constants of the view being recorded are an address in the upload allocator
+		void SetConstantBuffers(D3D12_GPU_VIRTUAL_ADDRESS perFrameConstants);
 
+		// Only requests the shaders from the cache, the pipeline objects wait for them
 		void LoadDefaultShaders();
 
+		// Remake the pipeline objects with the shaders the cache recompiled
+		void ReloadShaders();
+
 		void EnableDebugLayer() const;
 
 		void Flush();
@@ -267,6 +344,12 @@ namespace DX12
 
 		void MidFrame();
 
+		// Waits for the swap chain and the frames in flight, then as long as the pacing policy says
+		void WaitForFrame();
+
+		// The messages that came while waiting for the frame, returns false on WM_QUIT
+		bool ProcessMessages(MSG& msg);
+
 		void InitializeFrame();
 
 		// Execute a command list.
@@ -288,15 +371,20 @@ namespace DX12
 		void CreateRTFrameDependentResources();
 
 		void CreateRaytracingPipeline();
-		void CreateShaderBindingTable();
 
 		void RaytracingFrame();
 
+		// The view of the top level structure
+		void CreateTopLevelASView();
+
+		// Copies the ray generation table to new slots with the view of the top level structure that moved to a bigger buffer
+		void MoveRayGenTable();
+
 		std::unique_ptr<DXR::RayTracingPipelineGenerator>           mRayTracingPipeline;
-		std::unique_ptr<DXR::ShaderBindingTableGenerator>           mSbtHelper;
-		std::unique_ptr<DXR::TopLevelASGenerator>                   mTopLevelAsGenerator;
-		AccelerationStructureBuffers                                mTopLevelAsBuffers;
-		std::vector<std::pair<ComPtr<ID3D12Resource>, CMatrix4x4*>> mInstances;
+		std::unique_ptr<CDX12BlasCache>                             mBlasCache;   // One compacted bottom level structure per mesh file
+		std::unique_ptr<CDX12Tlas>                                  mTlas;        // An instance per object, rebuilt or refitted when they change
+		std::unique_ptr<CDX12ShaderTable>                           mShaderTable; // Hit records per object and sub-mesh
+		ComPtr<ID3D12Resource>                                      mRTLights;    // The hit records point here, the frame's lights are copied in
 		ComPtr<IDxcBlob>                                            mRayGenLibrary;
 		ComPtr<IDxcBlob>                                            mHitLibrary;
 		ComPtr<IDxcBlob>                                            mMissLibrary;
@@ -309,7 +397,6 @@ namespace DX12
 		ComPtr<ID3D12StateObjectProperties>                         mRaytracingStateObjectProps;
 		ComPtr<ID3D12Resource>                                      mOutputResource;
 		CDX12DescriptorHeap*										mRTHeap;
-		ComPtr<ID3D12Resource>                                      mSbtStorage;
 		uint32_t													mOutputSrvIndex;
 		uint32_t													mTopASIndex;
 		D3D12_GPU_DESCRIPTOR_HANDLE									mPointSamplerHeapIndex;
@@ -391,5 +478,7 @@ namespace DX12
 			CVector3           rotation = {0, 0, 0},
 			float              scale    = 1) override;
 
+		SMeshImportSettings MeshImportSettings() const override;
+
 	};
 }
@@ -0,0 +1,203 @@
+#include "DX12FramePacer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+namespace DX12
+{
+	//--------------------------------------------------------------------------------------
+	// Clocks and policies
+	//--------------------------------------------------------------------------------------
+
+	double CSteadyFrameClock::Now()
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void CSteadyFrameClock::SleepUntil(double time)
+	{
+		const auto duration = time - Now();
+		if (duration > 0) std::this_thread::sleep_for(std::chrono::duration<double>(duration));
+	}
+
+	double CLowLatencyPacing::StartTime(const SFramePacingState& state) const
+	{
+		return std::max(state.now, state.gpuIdle - state.cpuTime - mMargin);
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Pacer
+	//--------------------------------------------------------------------------------------
+
+	CDX12FramePacer::CDX12FramePacer(uint32_t                            maxFramesInFlight,
+	                                 std::unique_ptr<IFramePacingPolicy> policy,
+	                                 std::unique_ptr<IFrameClock>        clock) :
+		mPolicy(std::move(policy)),
+		mClock(std::move(clock)),
+		mMaxFramesInFlight(std::max(maxFramesInFlight, 1u))
+	{
+		if (!mPolicy) throw std::logic_error("The frame pacer needs a policy");
+		if (!mClock) throw std::logic_error("The frame pacer needs a clock");
+
+		mLastDone = mClock->Now();
+	}
+
+	void CDX12FramePacer::SetMaxFramesInFlight(uint32_t frames)
+	{
+		mMaxFramesInFlight = std::max(frames, 1u);
+	}
+
+	void CDX12FramePacer::SetPolicy(std::unique_ptr<IFramePacingPolicy> policy)
+	{
+		if (!policy) throw std::logic_error("The frame pacer needs a policy");
+
+		mPolicy = std::move(policy);
+	}
+
+	void CDX12FramePacer::BeginWait()
+	{
+		mCurrent = {};
+		mCurrent.waitStart = mClock->Now();
+		mWaiting = true;
+	}
+
+	uint64_t CDX12FramePacer::FenceToWait() const
+	{
+		// The next frame may start when one less than the maximum is left in flight
+		if (mFrames.size() < mMaxFramesInFlight) return 0;
+
+		return mFrames[mFrames.size() - mMaxFramesInFlight].fence;
+	}
+
+	void CDX12FramePacer::Completed(uint64_t completedFence)
+	{
+		const auto now = mClock->Now();
+
+		while (!mFrames.empty() && mFrames.front().fence <= completedFence)
+		{
+			const auto& frame = mFrames.front();
+
+			// The GPU starts a frame when it is submitted or when it is done with the one before
+			SFrameTimings timings;
+			timings.wait    = static_cast<float>((frame.waitEnd - frame.waitStart) * 1000);
+			timings.sleep   = static_cast<float>((frame.begin - frame.waitEnd) * 1000);
+			timings.cpu     = static_cast<float>((frame.submit - frame.begin) * 1000);
+			timings.present = frame.present > 0 ? static_cast<float>((frame.present - frame.submit) * 1000) : 0;
+			timings.gpu     = static_cast<float>((now - std::max(frame.submit, mLastDone)) * 1000);
+			timings.latency = static_cast<float>((now - frame.begin) * 1000);
+
+			mHistory[mHistoryCount % HistorySize] = timings;
+			++mHistoryCount;
+
+			mLastDone = now;
+			mFrames.pop_front();
+		}
+	}
+
+	void CDX12FramePacer::BeginFrame()
+	{
+		if (mRecording) throw std::logic_error("A frame was started and not submitted");
+
+		const auto now = mClock->Now();
+		if (!mWaiting)
+		{
+			mCurrent = {};
+			mCurrent.waitStart = now;
+		}
+		mCurrent.waitEnd = now;
+		mWaiting = false;
+
+		const auto start = mPolicy->StartTime(State(now));
+		if (start > now) mClock->SleepUntil(start);
+
+		mCurrent.begin = mClock->Now();
+		mRecording = true;
+	}
+
+	void CDX12FramePacer::Submit(uint64_t fence)
+	{
+		if (!mRecording) throw std::logic_error("A frame was submitted and not started");
+		if (fence <= mLastFence) throw std::logic_error("The fence values of the frames have to increase");
+
+		mCurrent.fence = fence;
+		mCurrent.submit = mClock->Now();
+
+		mFrames.push_back(mCurrent);
+		mLastFence = fence;
+		mRecording = false;
+	}
+
+	void CDX12FramePacer::Presented()
+	{
+		if (!mFrames.empty()) mFrames.back().present = mClock->Now();
+	}
+
+	SFrameTimings CDX12FramePacer::Average() const
+	{
+		SFrameTimings average;
+
+		const auto count = static_cast<uint32_t>(std::min<uint64_t>(mHistoryCount, HistorySize));
+		if (count == 0) return average;
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			average.wait    += mHistory[i].wait;
+			average.sleep   += mHistory[i].sleep;
+			average.cpu     += mHistory[i].cpu;
+			average.present += mHistory[i].present;
+			average.gpu     += mHistory[i].gpu;
+			average.latency += mHistory[i].latency;
+		}
+
+		average.wait    /= count;
+		average.sleep   /= count;
+		average.cpu     /= count;
+		average.present /= count;
+		average.gpu     /= count;
+		average.latency /= count;
+		return average;
+	}
+
+	void CDX12FramePacer::Validate() const
+	{
+		if (mMaxFramesInFlight == 0) throw std::logic_error("No frame can be in flight");
+
+		uint64_t fence = 0;
+		for (const auto& frame : mFrames)
+		{
+			if (frame.fence <= fence) throw std::logic_error("The frames in flight are not in fence order");
+			fence = frame.fence;
+
+			if (frame.waitEnd < frame.waitStart || frame.begin < frame.waitEnd || frame.submit < frame.begin)
+			{
+				throw std::logic_error("The times of a frame are not in order");
+			}
+
+			if (frame.present > 0 && frame.present < frame.submit) throw std::logic_error("A frame was presented before its submission");
+		}
+
+		if (fence > mLastFence) throw std::logic_error("A frame in flight is after the last submitted one");
+	}
+
+	SFramePacingState CDX12FramePacer::State(double now) const
+	{
+		const auto average = Average();
+
+		SFramePacingState state;
+		state.now     = now;
+		state.cpuTime = average.cpu / 1000.0;
+		state.gpuTime = average.gpu / 1000.0;
+
+		// The frames in flight run one after the other, each from its submission at the earliest
+		auto idle = mLastDone;
+		for (const auto& frame : mFrames)
+		{
+			idle = std::max(idle, frame.submit) + state.gpuTime;
+		}
+		state.gpuIdle = mFrames.empty() ? now : std::max(idle, now);
+
+		return state;
+	}
+}
@@ -0,0 +1,200 @@
+//--------------------------------------------------------------------------------------
+// Frame pacing
+//--------------------------------------------------------------------------------------
+// Decides when the CPU starts a frame. The engine waits at the start of the frame, not after
+// Present: first on the frame latency waitable object of the swap chain, then on the fence of
+// the frame that would otherwise exceed the maximum of frames in flight, then for as long as
+// the pacing policy says. The input is read after that, so with fewer frames in flight or the
+// low latency policy the frame is built from newer input.
+// The pacer keeps the timings of every frame (waiting, sleeping, CPU, Present, GPU and the
+// latency from the start of the frame to the GPU finishing it). GPU times are estimated from
+// when the fence of a frame is seen completed, precise when the engine had to wait for it.
+// Time comes from an IFrameClock and the fence values are given by the engine, so the pacer
+// does not depend on D3D12 and can be driven with CSimulatedFrameClock.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+namespace DX12
+{
+	// Seconds, on a clock that does not go back
+	class IFrameClock
+	{
+	public:
+		virtual ~IFrameClock() = default;
+
+		virtual double Now() = 0;
+
+		// Returns straight away if the time has passed
+		virtual void SleepUntil(double time) = 0;
+	};
+
+	// std::chrono::steady_clock. Sleeps are as precise as the OS scheduler
+	class CSteadyFrameClock final : public IFrameClock
+	{
+	public:
+		double Now() override;
+		void   SleepUntil(double time) override;
+	};
+
+	// Only moves when told to, or when sleeping
+	class CSimulatedFrameClock final : public IFrameClock
+	{
+	public:
+		double Now() override { return mTime; }
+		void   SleepUntil(double time) override { if (time > mTime) mTime = time; }
+
+		void Advance(double seconds) { mTime += seconds; }
+
+	private:
+		double mTime = 0;
+	};
+
+	// What a policy knows when the next frame can start
+	struct SFramePacingState
+	{
+		double now     = 0;
+		double cpuTime = 0; // Average of the recent frames, seconds
+		double gpuTime = 0;
+		double gpuIdle = 0; // When the GPU is expected to be done with the frames in flight, now if it is
+	};
+
+	class IFramePacingPolicy
+	{
+	public:
+		virtual ~IFramePacingPolicy() = default;
+
+		virtual const char* Name() const = 0;
+
+		// When to start the next frame, the pacer never starts it before now
+		virtual double StartTime(const SFramePacingState& state) const = 0;
+	};
+
+	// Starts as soon as a frame is free: the most frames queued, the highest frame rate
+	class CThroughputPacing final : public IFramePacingPolicy
+	{
+	public:
+		const char* Name() const override { return "Throughput"; }
+		double      StartTime(const SFramePacingState& state) const override { return state.now; }
+	};
+
+	// Starts late enough to submit the frame as the GPU runs out of work, so the GPU does
+	// not queue frames and the input is not older than it needs to be. The margin covers the
+	// variation of the CPU time, a frame late by more than that leaves the GPU idle
+	class CLowLatencyPacing final : public IFramePacingPolicy
+	{
+	public:
+		explicit CLowLatencyPacing(double margin = 0.001) : mMargin(margin) {}
+
+		const char* Name() const override { return "Low latency"; }
+		double      StartTime(const SFramePacingState& state) const override;
+
+	private:
+		double mMargin;
+	};
+
+	// Milliseconds
+	struct SFrameTimings
+	{
+		float wait    = 0; // For the waitable object and the fence
+		float sleep   = 0; // Asked by the policy
+		float cpu     = 0; // From the start of the frame to its submission
+		float present = 0;
+		float gpu     = 0;
+		float latency = 0; // From the start of the frame to the GPU finishing it
+	};
+
+	class CDX12FramePacer
+	{
+	public:
+
+		static constexpr uint32_t HistorySize = 64;
+
+		CDX12FramePacer() = delete;
+		CDX12FramePacer(const CDX12FramePacer&) = delete;
+		CDX12FramePacer(const CDX12FramePacer&&) = delete;
+		CDX12FramePacer& operator=(const CDX12FramePacer&) = delete;
+		CDX12FramePacer& operator=(const CDX12FramePacer&&) = delete;
+
+		// Will throw a std::logic_error exception without a policy or a clock
+		CDX12FramePacer(uint32_t                            maxFramesInFlight,
+		                std::unique_ptr<IFramePacingPolicy> policy,
+		                std::unique_ptr<IFrameClock>        clock = std::make_unique<CSteadyFrameClock>());
+
+		// At least 1, the swap chain has to be told as well
+		void     SetMaxFramesInFlight(uint32_t frames);
+		uint32_t MaxFramesInFlight() const { return mMaxFramesInFlight; }
+
+		// Will throw a std::logic_error exception without a policy
+		void                      SetPolicy(std::unique_ptr<IFramePacingPolicy> policy);
+		const IFramePacingPolicy& Policy() const { return *mPolicy; }
+
+		IFrameClock& Clock() { return *mClock; }
+
+		// Before waiting for the next frame
+		void BeginWait();
+
+		// The fence value to wait for before the next frame starts, 0 if there is none
+		uint64_t FenceToWait() const;
+
+		// The frames up to the completed fence value are done by now. Call it whenever the fence is read
+		void Completed(uint64_t completedFence);
+
+		// After the waits: sleeps as long as the policy says, then the frame starts
+		// Will throw a std::logic_error exception if a frame was started and not submitted
+		void BeginFrame();
+
+		// The frame is executed and signals the fence value
+		// Will throw a std::logic_error exception without a started frame or if the fence value does not increase
+		void Submit(uint64_t fence);
+
+		// After Present
+		void Presented();
+
+		uint32_t FramesInFlight() const { return static_cast<uint32_t>(mFrames.size()); }
+
+		// Of the last frame the GPU finished
+		const SFrameTimings& Last() const { return mHistory[(mHistoryCount + HistorySize - 1) % HistorySize]; }
+
+		// Of the last HistorySize finished frames
+		SFrameTimings Average() const;
+
+		// Check the frames are in order, throws a std::logic_error exception if not
+		void Validate() const;
+
+	private:
+
+		// Seconds on the clock
+		struct SFrame
+		{
+			uint64_t fence     = 0;
+			double   waitStart = 0;
+			double   waitEnd   = 0;
+			double   begin     = 0;
+			double   submit    = 0;
+			double   present   = 0;
+		};
+
+		SFramePacingState State(double now) const;
+
+		std::unique_ptr<IFramePacingPolicy> mPolicy;
+		std::unique_ptr<IFrameClock>        mClock;
+		uint32_t                            mMaxFramesInFlight;
+
+		SFrame mCurrent;
+		bool   mWaiting   = false;
+		bool   mRecording = false;
+
+		// Submitted and not finished, oldest first
+		std::deque<SFrame> mFrames;
+		uint64_t           mLastFence = 0;
+		double             mLastDone  = 0;
+
+		std::array<SFrameTimings, HistorySize> mHistory{};
+		uint64_t                               mHistoryCount = 0;
+	};
+}
@@ -0,0 +1,180 @@
+#include "DX12GeometryArena.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "DX12Engine.h"
+#include "DX12ResourceAllocator.h"
+#include "DX12UploadQueue.h"
+
+namespace DX12
+{
+	CDX12GeometryArena::CDX12GeometryArena(CDX12Engine* engine, uint64_t vertexPoolSize, uint64_t indexPoolSize) :
+		mEngine(engine),
+		mVertexPoolSize(vertexPoolSize),
+		mIndexPoolSize(indexPoolSize)
+	{
+	}
+
+	SDX12Geometry CDX12GeometryArena::Add(uint32_t vertexSize, const void* vertices, uint32_t numVertices, const uint32_t* indices, uint32_t numIndices)
+	{
+		if (vertexSize == 0 || numVertices == 0 || numIndices == 0) throw std::logic_error("Adding empty geometry");
+
+		SDX12Geometry geometry;
+		SPool* added = nullptr;
+		geometry.vertexSize = vertexSize;
+		geometry.numVertices = numVertices;
+		geometry.numIndices = numIndices;
+
+		{
+			std::unique_lock l(mMutex);
+
+			uint64_t baseVertex = CRangeAllocator::InvalidOffset;
+			uint64_t firstIndex = CRangeAllocator::InvalidOffset;
+
+			for (uint32_t i = 0; i < mPools.size(); ++i)
+			{
+				auto& pool = *mPools[i];
+				if (pool.vertexSize != vertexSize) continue;
+
+				baseVertex = pool.vertices.Allocate(numVertices);
+				if (baseVertex == CRangeAllocator::InvalidOffset) continue;
+
+				firstIndex = pool.indices.Allocate(numIndices);
+				if (firstIndex == CRangeAllocator::InvalidOffset)
+				{
+					pool.vertices.Free(baseVertex);
+					continue;
+				}
+
+				geometry.pool = i;
+				break;
+			}
+
+			// The pools of the layout are full, or there are none yet
+			if (geometry.pool == SDX12Geometry::InvalidPool)
+			{
+				geometry.pool = AddPool(vertexSize, numVertices, numIndices);
+
+				auto& pool = *mPools[geometry.pool];
+				baseVertex = pool.vertices.Allocate(numVertices);
+				firstIndex = pool.indices.Allocate(numIndices);
+			}
+
+			// The vector of pools can grow once the lock is released, the pools stay where they are
+			added = mPools[geometry.pool].get();
+			const auto& pool = *added;
+
+			geometry.baseVertex = static_cast<uint32_t>(baseVertex);
+			geometry.firstIndex = static_cast<uint32_t>(firstIndex);
+
+			geometry.vertexBufferView.BufferLocation = pool.vertexBuffer->GetGPUVirtualAddress();
+			geometry.vertexBufferView.SizeInBytes = static_cast<UINT>(pool.vertexBuffer->GetDesc().Width);
+			geometry.vertexBufferView.StrideInBytes = vertexSize;
+
+			geometry.indexBufferView.BufferLocation = pool.indexBuffer->GetGPUVirtualAddress();
+			geometry.indexBufferView.SizeInBytes = static_cast<UINT>(pool.indexBuffer->GetDesc().Width);
+			geometry.indexBufferView.Format = DXGI_FORMAT_R32_UINT;
+		}
+
+		// The ranges are only drawn once the upload queue is done with them
+		mEngine->mUploadQueue->Copy(added->vertexBuffer.Get(), static_cast<size_t>(geometry.baseVertex) * vertexSize, vertices, static_cast<size_t>(numVertices) * vertexSize);
+		mEngine->mUploadQueue->Copy(added->indexBuffer.Get(), static_cast<size_t>(geometry.firstIndex) * sizeof(uint32_t), indices, static_cast<size_t>(numIndices) * sizeof(uint32_t));
+
+		return geometry;
+	}
+
+	void CDX12GeometryArena::Remove(const SDX12Geometry& geometry)
+	{
+		if (geometry.pool == SDX12Geometry::InvalidPool) return;
+
+		std::unique_lock l(mMutex);
+		mPendingFrees.push_back({ mEngine->mFenceValue + 1, geometry });
+	}
+
+	void CDX12GeometryArena::BeginFrame(uint64_t completedFenceValue)
+	{
+		{
+			std::unique_lock l(mMutex);
+
+			while (!mPendingFrees.empty() && mPendingFrees.front().fenceValue <= completedFenceValue)
+			{
+				FreeLocked(mPendingFrees.front().geometry);
+				mPendingFrees.pop_front();
+			}
+		}
+
+		mLastDraws = mDraws.exchange(0);
+		mLastBufferBinds = mBufferBinds.exchange(0);
+	}
+
+	void CDX12GeometryArena::Draw(ID3D12GraphicsCommandList* commandList, const SDX12Geometry& geometry)
+	{
+		++mDraws;
+
+		if (CDX12Engine::mCurrGeometryPool != geometry.pool)
+		{
+			commandList->IASetVertexBuffers(0, 1, &geometry.vertexBufferView);
+			commandList->IASetIndexBuffer(&geometry.indexBufferView);
+			commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+			CDX12Engine::mCurrGeometryPool = geometry.pool;
+			++mBufferBinds;
+		}
+
+		commandList->DrawIndexedInstanced(geometry.numIndices, 1, geometry.firstIndex, static_cast<INT>(geometry.baseVertex), 0);
+	}
+
+	SGeometryArenaStats CDX12GeometryArena::Stats() const
+	{
+		std::unique_lock l(mMutex);
+
+		SGeometryArenaStats stats;
+		stats.pools = static_cast<uint32_t>(mPools.size());
+		stats.pendingFrees = static_cast<uint32_t>(mPendingFrees.size());
+		stats.draws = mLastDraws;
+		stats.bufferBinds = mLastBufferBinds;
+
+		for (const auto& pool : mPools)
+		{
+			stats.allocations += static_cast<uint32_t>(pool->vertices.Allocations());
+			stats.vertexBytes += pool->vertices.Allocated() * pool->vertexSize;
+			stats.indexBytes += pool->indices.Allocated() * sizeof(uint32_t);
+			stats.capacity += pool->vertexBuffer->GetDesc().Width + pool->indexBuffer->GetDesc().Width;
+		}
+
+		return stats;
+	}
+
+	uint32_t CDX12GeometryArena::AddPool(uint32_t vertexSize, uint64_t numVertices, uint64_t numIndices)
+	{
+		const auto vertexCapacity = std::max(mVertexPoolSize / vertexSize, numVertices);
+		const auto indexCapacity = std::max(mIndexPoolSize / sizeof(uint32_t), numIndices);
+
+		const auto index = static_cast<uint32_t>(mPools.size());
+
+		auto pool = std::make_unique<SPool>(vertexCapacity, indexCapacity);
+		pool->vertexSize = vertexSize;
+
+		pool->vertexBuffer = mEngine->mResourceAllocator->CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, vertexCapacity * vertexSize, D3D12_RESOURCE_STATE_COMMON);
+		SetNameIndexed(pool->vertexBuffer.Get(), L"GeometryArenaVertices", index);
+
+		pool->indexBuffer = mEngine->mResourceAllocator->CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, indexCapacity * sizeof(uint32_t), D3D12_RESOURCE_STATE_COMMON);
+		SetNameIndexed(pool->indexBuffer.Get(), L"GeometryArenaIndices", index);
+
+		mPools.push_back(std::move(pool));
+		return index;
+	}
+
+	void CDX12GeometryArena::FreeLocked(const SDX12Geometry& geometry)
+	{
+		auto& pool = *mPools[geometry.pool];
+		pool.vertices.Free(geometry.baseVertex);
+		pool.indices.Free(geometry.firstIndex);
+
+#if defined(_DEBUG)
+		pool.vertices.Validate();
+		pool.indices.Validate();
+#endif
+	}
+}
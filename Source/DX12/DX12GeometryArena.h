@@ -0,0 +1,136 @@
+//--------------------------------------------------------------------------------------
+// Geometry arena
+//--------------------------------------------------------------------------------------
+// The vertices and indices of every sub-mesh, sub-allocated from large shared buffers instead
+// of a vertex and an index buffer each. Sub-meshes with the same vertex size (the same vertex
+// layout: tangents, uvs...) go to the same pools, a vertex pool and an index pool together,
+// and a pool is added when the ones of the layout are full. The ranges come from a best-fit
+// CRangeAllocator, in vertices and indices, and a draw finds its geometry with the base
+// vertex and first index of its sub-mesh. The buffers of a pool are only set when the pool
+// changes on the command list, so most draws only set their own offsets.
+// The data is copied by the upload queue into the ranges. The buffers are in the common state:
+// the queues read and write their own ranges, buffers never need the same state on all of them.
+// A removed range is given back once the frame fence has passed the frames that may draw it.
+// Meshes are loaded from worker threads, adding and removing geometry takes a lock; binding
+// does not, everything it needs is in the geometry.
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "DX12Common.h"
+#include "../Common/RangeAllocator.h"
+
+namespace DX12
+{
+	class CDX12Engine;
+
+	// Where the geometry of a sub-mesh is
+	struct SDX12Geometry
+	{
+		static constexpr uint32_t InvalidPool = 0xFFFFFFFF;
+
+		uint32_t pool        = InvalidPool;
+		uint32_t vertexSize  = 0;
+		uint32_t baseVertex  = 0;
+		uint32_t firstIndex  = 0;
+		uint32_t numVertices = 0;
+		uint32_t numIndices  = 0;
+
+		// The whole buffers of the pool
+		D3D12_VERTEX_BUFFER_VIEW vertexBufferView = {};
+		D3D12_INDEX_BUFFER_VIEW  indexBufferView  = {};
+
+		// Of the first vertex and the first index, for whatever reads the geometry without the input assembler
+		D3D12_GPU_VIRTUAL_ADDRESS VertexAddress() const { return vertexBufferView.BufferLocation + static_cast<uint64_t>(baseVertex) * vertexSize; }
+		D3D12_GPU_VIRTUAL_ADDRESS IndexAddress() const { return indexBufferView.BufferLocation + static_cast<uint64_t>(firstIndex) * sizeof(uint32_t); }
+	};
+
+	struct SGeometryArenaStats
+	{
+		uint32_t pools        = 0;
+		uint32_t allocations  = 0;
+		uint64_t vertexBytes  = 0; // In use
+		uint64_t indexBytes   = 0;
+		uint64_t capacity     = 0; // Of all the buffers
+		uint32_t pendingFrees = 0;
+		uint32_t draws        = 0; // In the last frame
+		uint32_t bufferBinds  = 0; // In the last frame
+	};
+
+	class CDX12GeometryArena
+	{
+	public:
+
+		static constexpr uint64_t DefaultVertexPoolSize = 64 * 1024 * 1024;
+		static constexpr uint64_t DefaultIndexPoolSize  = 32 * 1024 * 1024;
+
+		CDX12GeometryArena() = delete;
+		CDX12GeometryArena(const CDX12GeometryArena&) = delete;
+		CDX12GeometryArena(const CDX12GeometryArena&&) = delete;
+		CDX12GeometryArena& operator=(const CDX12GeometryArena&) = delete;
+		CDX12GeometryArena& operator=(const CDX12GeometryArena&&) = delete;
+
+		explicit CDX12GeometryArena(CDX12Engine* engine, uint64_t vertexPoolSize = DefaultVertexPoolSize, uint64_t indexPoolSize = DefaultIndexPoolSize);
+
+		// Takes ranges of a pool of the vertex size and queues the copies of the data to them
+		// Geometry bigger than a pool gets a pool of its own. Will throw a std::runtime_error exception on failure
+		SDX12Geometry Add(uint32_t vertexSize, const void* vertices, uint32_t numVertices, const uint32_t* indices, uint32_t numIndices);
+
+		// The ranges are given back once the frames that may still draw them are done
+		void Remove(const SDX12Geometry& geometry);
+
+		// Gives back the ranges the GPU is done with, and starts counting the draws of the frame
+		void BeginFrame(uint64_t completedFenceValue);
+
+		// Sets the buffers of the pool of the geometry, unless they are the ones set on the command list of this thread,
+		// and draws it
+		void Draw(ID3D12GraphicsCommandList* commandList, const SDX12Geometry& geometry);
+
+		SGeometryArenaStats Stats() const;
+
+	private:
+
+		struct SPool
+		{
+			SPool(uint64_t vertexCapacity, uint64_t indexCapacity) : vertices(vertexCapacity), indices(indexCapacity) {}
+
+			uint32_t               vertexSize = 0;
+			ComPtr<ID3D12Resource> vertexBuffer;
+			ComPtr<ID3D12Resource> indexBuffer;
+			CRangeAllocator        vertices;
+			CRangeAllocator        indices;
+		};
+
+		// Creates the buffers of a pool with room for at least that many vertices and indices, the mutex has to be locked
+		uint32_t AddPool(uint32_t vertexSize, uint64_t numVertices, uint64_t numIndices);
+
+		void FreeLocked(const SDX12Geometry& geometry);
+
+		CDX12Engine* mEngine;
+		uint64_t     mVertexPoolSize;
+		uint64_t     mIndexPoolSize;
+
+		std::vector<std::unique_ptr<SPool>> mPools;
+
+		struct SPendingFree
+		{
+			uint64_t      fenceValue;
+			SDX12Geometry geometry;
+		};
+
+		std::deque<SPendingFree> mPendingFrees;
+
+		// Counted by the recording threads
+		std::atomic<uint32_t> mDraws           { 0 };
+		std::atomic<uint32_t> mBufferBinds     { 0 };
+		uint32_t              mLastDraws       = 0;
+		uint32_t              mLastBufferBinds = 0;
+
+		mutable std::mutex mMutex;
+	};
+}
@@ -0,0 +1,112 @@
+#include "DX12GpuProfiler.h"
+
+#include <fstream>
+
+#include "DX12Engine.h"
+#include "DX12ResourceAllocator.h"
+
+namespace DX12
+{
+	thread_local uint32_t CDX12GpuProfiler::mCurrentScope = CDX12GpuProfiler::InvalidScope;
+
+	CDX12GpuProfiler::CDX12GpuProfiler(CDX12Engine* engine, uint32_t numFrames, uint32_t maxScopes) :
+		mEngine(engine),
+		mMaxScopes(maxScopes),
+		mFrames(numFrames)
+	{
+		ThrowIfFailed(mEngine->mCommandQueue->GetTimestampFrequency(&mFrequency));
+
+		// A begin and an end query per scope
+		D3D12_QUERY_HEAP_DESC desc = {};
+		desc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+		desc.Count = numFrames * mMaxScopes * 2;
+		ThrowIfFailed(mEngine->mDevice->CreateQueryHeap(&desc, IID_PPV_ARGS(&mQueryHeap)));
+		NAME_D3D12_OBJECT(mQueryHeap);
+
+		mReadback = mEngine->mResourceAllocator->CreateBuffer(D3D12_HEAP_TYPE_READBACK, desc.Count * sizeof(uint64_t), D3D12_RESOURCE_STATE_COPY_DEST);
+		NAME_D3D12_OBJECT(mReadback);
+	}
+
+	void CDX12GpuProfiler::BeginFrame(uint32_t frameIndex)
+	{
+		auto& frame = mFrames[frameIndex];
+
+		if (frame.resolved && !frame.scopes.empty())
+		{
+			const auto first = Query(frameIndex, 0);
+			const auto count = static_cast<uint32_t>(frame.scopes.size()) * 2;
+			const D3D12_RANGE readRange = { first * sizeof(uint64_t), (first + count) * sizeof(uint64_t) };
+
+			void* data = nullptr;
+			ThrowIfFailed(mReadback->Map(0, &readRange, &data));
+
+			ReadTimestamps(frame.scopes, static_cast<const uint64_t*>(data) + first);
+
+			const D3D12_RANGE writtenRange = { 0, 0 };
+			mReadback->Unmap(0, &writtenRange);
+
+			mTree.AddFrame(frame.scopes, mFrequency);
+
+#if defined(_DEBUG)
+			mTree.Validate();
+#endif
+		}
+
+		frame.scopes.clear();
+		frame.resolved = false;
+		mCurrentFrame = frameIndex;
+	}
+
+	uint32_t CDX12GpuProfiler::BeginScope(ID3D12GraphicsCommandList* commandList, const std::string& name)
+	{
+		PIXBeginEvent(commandList, 0, name.c_str());
+
+		uint32_t scope;
+		{
+			std::lock_guard lock(mMutex);
+
+			auto& scopes = mFrames[mCurrentFrame].scopes;
+			if (scopes.size() >= mMaxScopes) return InvalidScope;
+
+			scope = static_cast<uint32_t>(scopes.size());
+			scopes.push_back({ name, mCurrentScope });
+		}
+
+		commandList->EndQuery(mQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, Query(mCurrentFrame, scope));
+		mCurrentScope = scope;
+		return scope;
+	}
+
+	void CDX12GpuProfiler::EndScope(ID3D12GraphicsCommandList* commandList, uint32_t scope)
+	{
+		if (scope != InvalidScope)
+		{
+			commandList->EndQuery(mQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, Query(mCurrentFrame, scope) + 1);
+
+			std::lock_guard lock(mMutex);
+			mCurrentScope = mFrames[mCurrentFrame].scopes[scope].parent;
+		}
+
+		PIXEndEvent(commandList);
+	}
+
+	void CDX12GpuProfiler::EndFrame(ID3D12GraphicsCommandList* commandList)
+	{
+		auto& frame = mFrames[mCurrentFrame];
+		if (frame.scopes.empty()) return;
+
+		const auto first = Query(mCurrentFrame, 0);
+		const auto count = static_cast<UINT>(frame.scopes.size()) * 2;
+		commandList->ResolveQueryData(mQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, first, count, mReadback.Get(), first * sizeof(uint64_t));
+
+		frame.resolved = true;
+	}
+
+	void CDX12GpuProfiler::SaveChromeTrace(const std::string& file) const
+	{
+		std::ofstream stream(file, std::ios::trunc);
+		if (!stream.good()) throw std::runtime_error("Cannot write the GPU trace " + file);
+
+		mTree.WriteChromeTrace(stream);
+	}
+}
@@ -0,0 +1,109 @@
+//--------------------------------------------------------------------------------------
+// GPU timestamp profiler
+//--------------------------------------------------------------------------------------
+// A scope writes a timestamp query where it begins and ends, and a PIX event around the
+// same commands, so the profile and a PIX capture have the same tree. Each frame in flight
+// has its own range of a timestamp query heap and of a readback buffer: the queries of a
+// frame are resolved at the end of its main command list, and read back when the frame comes
+// around again, after the engine has waited for its fence. The scopes then go to a
+// CDX12ProfileTree, which keeps the statistics and writes the Chrome trace.
+// Scopes can be opened on any recording thread; a scope is nested in the one open on the same
+// thread, which is the one open on the same command list.
+
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "DX12Common.h"
+#include "DX12ProfileTree.h"
+
+namespace DX12
+{
+	class CDX12Engine;
+
+	class CDX12GpuProfiler
+	{
+	public:
+
+		static constexpr uint32_t InvalidScope = CDX12ProfileTree::InvalidScope;
+
+		CDX12GpuProfiler() = delete;
+		CDX12GpuProfiler(const CDX12GpuProfiler&) = delete;
+		CDX12GpuProfiler(const CDX12GpuProfiler&&) = delete;
+		CDX12GpuProfiler& operator=(const CDX12GpuProfiler&) = delete;
+		CDX12GpuProfiler& operator=(const CDX12GpuProfiler&&) = delete;
+
+		// The scopes past the maximum of a frame are only PIX events
+		CDX12GpuProfiler(CDX12Engine* engine, uint32_t numFrames, uint32_t maxScopes = 512);
+
+		// The fence of the last frame with this index has passed, its timestamps go to the tree
+		void BeginFrame(uint32_t frameIndex);
+
+		// Safe from any recording thread
+		uint32_t BeginScope(ID3D12GraphicsCommandList* commandList, const std::string& name);
+		void     EndScope(ID3D12GraphicsCommandList* commandList, uint32_t scope);
+
+		// Resolves the queries of the frame, on the list executed last after the last scope
+		void EndFrame(ID3D12GraphicsCommandList* commandList);
+
+		const CDX12ProfileTree& Tree() const { return mTree; }
+
+		// Will throw a std::runtime_error exception if the file cannot be written
+		void SaveChromeTrace(const std::string& file) const;
+
+	private:
+
+		struct SFrame
+		{
+			std::vector<SProfileScope> scopes; // The timestamps are set when read back
+			bool                       resolved = false;
+		};
+
+		// Of the scope open on this thread
+		static thread_local uint32_t mCurrentScope;
+
+		uint32_t Query(uint32_t frameIndex, uint32_t scope) const { return (frameIndex * mMaxScopes + scope) * 2; }
+
+		CDX12Engine* mEngine;
+		uint32_t     mMaxScopes;
+		uint64_t     mFrequency = 0;
+
+		ComPtr<ID3D12QueryHeap> mQueryHeap;
+		ComPtr<ID3D12Resource>  mReadback;
+
+		std::mutex          mMutex;
+		std::vector<SFrame> mFrames;
+		uint32_t            mCurrentFrame = 0;
+
+		CDX12ProfileTree mTree;
+	};
+
+	// Begins a scope, and ends it when it goes
+	class CDX12GpuScope
+	{
+	public:
+
+		CDX12GpuScope() = delete;
+		CDX12GpuScope(const CDX12GpuScope&) = delete;
+		CDX12GpuScope(const CDX12GpuScope&&) = delete;
+		CDX12GpuScope& operator=(const CDX12GpuScope&) = delete;
+		CDX12GpuScope& operator=(const CDX12GpuScope&&) = delete;
+
+		CDX12GpuScope(CDX12GpuProfiler* profiler, ID3D12GraphicsCommandList* commandList, const std::string& name) :
+			mProfiler(profiler),
+			mCommandList(commandList),
+			mScope(profiler->BeginScope(commandList, name))
+		{
+		}
+
+		~CDX12GpuScope() { mProfiler->EndScope(mCommandList, mScope); }
+
+	private:
+
+		CDX12GpuProfiler*          mProfiler;
+		ID3D12GraphicsCommandList* mCommandList;
+		uint32_t                   mScope;
+	};
+}
@@ -7,7 +7,21 @@
 #include "backends/imgui_impl_dx12.h"
 #include "backends/imgui_impl_win32.h"
 
+#include "DX12BlasCache.h"
+#include "DX12CommandRecorder.h"
 #include "DX12DescriptorHeap.h"
+#include "DX12FramePacer.h"
+#include "DX12GeometryArena.h"
+#include "DX12GpuProfiler.h"
+#include "DX12InstanceTable.h"
+#include "DX12MaterialTable.h"
+#include "DX12PipelineCache.h"
+#include "DX12RenderGraph.h"
+#include "DX12ShaderCache.h"
+#include "DX12ShaderTable.h"
+#include "DX12TextureStreamer.h"
+#include "DX12UploadAllocator.h"
+#include "DX12Tlas.h"
 #include "ImGuizmo.h"
 #include "../Common/CScene.h"
 
@@ -15,20 +29,41 @@
 
 namespace DX12
 {
+	namespace
+	{
+		void ShowProfileNode(const CDX12ProfileTree& tree, uint32_t node)
+		{
+			const auto& n = tree.Nodes()[node];
+
+			const auto flags = n.children.empty() ? ImGuiTreeNodeFlags_Leaf : ImGuiTreeNodeFlags_DefaultOpen;
+			const auto open = ImGui::TreeNodeEx(reinterpret_cast<void*>(static_cast<intptr_t>(node)), flags,
+				"%s (%u): %.3f ms, avg %.3f, min %.3f, max %.3f", n.name.c_str(), n.calls, n.last, n.average, n.minimum, n.maximum);
+
+			if (open)
+			{
+				for (const auto child : n.children) ShowProfileNode(tree, child);
+				ImGui::TreePop();
+			}
+		}
+	}
+
 	CDX12Gui::CDX12Gui(CDX12Engine* engine): CGui(engine)
 	{
 		mEngine = engine;
 
 		// Calculate offset on the srvdescriptorheap to store imgui font texture
-		auto handle = mEngine->mSRVDescriptorHeap->Get(mEngine->mSRVDescriptorHeap->Add());
+		// ImGui writes the font descriptor itself when it creates its objects, so it goes straight into the shader visible heap
+		const auto fontIndex = mEngine->mSRVDescriptorHeap->Add();
+		const auto fontCpu = mEngine->mSRVDescriptorHeap->GetShaderVisibleCpu(fontIndex);
+		const auto fontGpu = mEngine->mSRVDescriptorHeap->Get(fontIndex).mGpu;
 
 		// Setup Platform/Renderer bindings
 		if (!ImGui_ImplDX12_Init(engine->GetDevice(),
 								CDX12Engine::mNumFrames,
 								DXGI_FORMAT_R8G8B8A8_UNORM,
-								mEngine->mSRVDescriptorHeap->mDescriptorHeap.Get(),
-								handle.mCpu,
-								handle.mGpu)
+								mEngine->mSRVDescriptorHeap->Heap(),
+								fontCpu,
+								fontGpu)
 			||
 			!ImGui_ImplWin32_Init(engine->GetWindow()->GetHandle())) { throw std::runtime_error("Impossible initialize ImGui"); }
 		
@@ -43,11 +78,172 @@ namespace DX12
 		ImGuizmo::BeginFrame();
 	}
 
+	void CDX12Gui::Show(float& frameTime)
+	{
+		CGui::Show(frameTime);
+
+		if (ImGui::Begin("Command Lists", 0, ImGuiWindowFlags_NoBringToFrontOnFocus))
+		{
+			for (const auto& timing : mEngine->mCommandRecorder->Timings())
+			{
+				ImGui::Text("%s: %.3f ms", timing.name.c_str(), timing.milliseconds);
+			}
+
+			const auto& stats = mEngine->mRenderGraph->Stats();
+			ImGui::Separator();
+			ImGui::Text("Passes: %u (%u culled)", stats.passes, stats.culledPasses);
+			ImGui::Text("Barriers: %u transitions, %u aliasing in %u batches", stats.transitions, stats.aliasing, stats.batches);
+			ImGui::Text("Transient textures: %u, %.1f MB in %.1f MB", stats.transients,
+				static_cast<float>(stats.transientBytes) / (1024 * 1024), static_cast<float>(stats.heapSize) / (1024 * 1024));
+
+			const auto shaders = mEngine->mShaderCache->Stats();
+			ImGui::Separator();
+			ImGui::Text("Shaders: %u cached, %u compiled, %u failed, %u reloaded", shaders.hits, shaders.compiles, shaders.failures, shaders.reloads);
+
+			const auto pipelines = mEngine->mPipelineCache->Stats();
+			ImGui::Text("Pipelines: %u for %u requests, %u loaded, %u created, %u failed, %u pending",
+				pipelines.pipelines, pipelines.requests, pipelines.loaded, pipelines.created, pipelines.failed, pipelines.pending);
+
+			const auto materials = mEngine->mMaterialTable->Stats();
+			ImGui::Text("Material records: %u, %u free, %.1f KB per frame", materials.objects, materials.freeRecords, static_cast<float>(materials.tableBytes) / 1024);
+			ImGui::Text("Material table: %llu bytes in %u records written, %u records changed", materials.writtenBytes, materials.writes, materials.dirtyRecords);
+
+			// The records of the objects that changed against the upload memory of the per draw constants that are left
+			const auto instances = mEngine->mInstanceTable->Stats();
+			ImGui::Text("Instance records: %u for %u objects (%u changed), %u free, %.1f KB per frame", instances.records, instances.objects,
+				instances.dirtyObjects, instances.freeRecords, static_cast<float>(instances.tableBytes) / 1024);
+			ImGui::Text("Uploaded: %llu bytes in %u instance records, %.1f KB of draw constants", instances.writtenBytes, instances.writes,
+				static_cast<float>(mEngine->mUploadAllocator->FrameBytes()) / 1024);
+
+			// How many draws could reuse the pool buffers set by the draw before
+			const auto geometry = mEngine->mGeometryArena->Stats();
+			ImGui::Text("Geometry: %u ranges in %u pools, %.1f of %.1f MB, %u pending frees", geometry.allocations, geometry.pools,
+				static_cast<float>(geometry.vertexBytes + geometry.indexBytes) / (1024 * 1024), static_cast<float>(geometry.capacity) / (1024 * 1024), geometry.pendingFrees);
+			ImGui::Text("Mesh draws: %u, %u buffer binds", geometry.draws, geometry.bufferBinds);
+
+			auto& pacer = *mEngine->mFramePacer;
+			ImGui::Separator();
+
+			auto lowLatency = dynamic_cast<const CLowLatencyPacing*>(&pacer.Policy()) != nullptr;
+			if (ImGui::Checkbox("Low latency pacing", &lowLatency))
+			{
+				if (lowLatency) pacer.SetPolicy(std::make_unique<CLowLatencyPacing>());
+				else pacer.SetPolicy(std::make_unique<CThroughputPacing>());
+			}
+
+			auto frames = static_cast<int>(pacer.MaxFramesInFlight());
+			if (ImGui::SliderInt("Frames in flight", &frames, 1, static_cast<int>(CDX12Engine::mNumFrames))) mEngine->SetMaxFramesInFlight(frames);
+
+			const auto frame = pacer.Average();
+			ImGui::Text("Frame: %.2f ms wait, %.2f ms sleep, %.2f ms CPU, %.2f ms present", frame.wait, frame.sleep, frame.cpu, frame.present);
+			ImGui::Text("GPU: %.2f ms, latency %.2f ms, %u in flight", frame.gpu, frame.latency, pacer.FramesInFlight());
+
+			if (mEngine->mBlasCache)
+			{
+				const auto blas = mEngine->mBlasCache->Stats();
+				ImGui::Separator();
+				ImGui::Text("BLAS: %u for %u instances, %u batches", blas.structures, blas.requests, blas.batches);
+				ImGui::Text("BLAS memory: %.1f MB compacted from %.1f MB, %.1f MB scratch", static_cast<float>(blas.compactedBytes) / (1024 * 1024),
+					static_cast<float>(blas.builtBytes) / (1024 * 1024), static_cast<float>(blas.scratchBytes) / (1024 * 1024));
+			}
+
+			if (mEngine->mTlas)
+			{
+				const auto tlas = mEngine->mTlas->Instances().Stats();
+				ImGui::Text("TLAS: %u instances in %u slots", tlas.instances, tlas.slots);
+				ImGui::Text("TLAS builds: %u rebuilds, %u refits, %u skipped", tlas.rebuilds, tlas.refits, tlas.skipped);
+			}
+
+			if (mEngine->mShaderTable)
+			{
+				const auto sbt = mEngine->mShaderTable->Stats();
+				ImGui::Text("Hit records: %u for %u objects, %u free, stride %u", sbt.hitRecords, sbt.objects, sbt.freeRecords, mEngine->mShaderTable->Layout().Hit().stride);
+				ImGui::Text("Shader table: %.1f KB, %llu bytes in %u copies", static_cast<float>(sbt.tableBytes) / 1024, sbt.copiedBytes, sbt.copies);
+			}
+
+			if (mEngine->mTextureStreamer)
+			{
+				auto& streamer = *mEngine->mTextureStreamer;
+				ImGui::Separator();
+
+				auto budget = static_cast<int>(streamer.Budget() / (1024 * 1024));
+				if (ImGui::SliderInt("Texture budget (MB)", &budget, 16, 4096)) streamer.SetBudget(static_cast<uint64_t>(budget) * 1024 * 1024);
+				ImGui::SliderFloat("Texture mip bias", &streamer.mBias, -2.0f, 4.0f);
+
+				const auto mips = streamer.Stats();
+				ImGui::Text("Streamed textures: %u, %u streaming, %u short of the budget", mips.textures, mips.streaming, mips.denied);
+				ImGui::Text("Streamed mips: %.1f MB of %.1f MB, %u in, %u evicted", static_cast<float>(mips.committed) / (1024 * 1024),
+					static_cast<float>(mips.budget) / (1024 * 1024), mips.streamedIn, mips.evicted);
+			}
+
+			ImGui::Separator();
+
+			if (mCook.valid())
+			{
+				if (mCook.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+				{
+					try
+					{
+						mCookStats = mCook.get();
+						for (const auto& error : mCookStats.errors) OutputDebugStringA((error + '\n').c_str());
+					}
+					catch (const std::exception& e)
+					{
+						OutputDebugStringA(e.what());
+					}
+				}
+				else
+				{
+					ImGui::Text("Cooking textures...");
+				}
+			}
+			// The cooked files are picked by the scenes loaded from now on
+			else if (ImGui::Button("Cook textures"))
+			{
+				mCook = std::async(std::launch::async, [folder = mEngine->GetMediaFolder()]
+				{
+					CTextureCooker cooker;
+					return cooker.CookFolder(folder);
+				});
+			}
+
+			if (mCookStats.cooked || mCookStats.upToDate || mCookStats.failed)
+			{
+				ImGui::Text("Textures cooked: %u, %u up to date, %u failed", mCookStats.cooked, mCookStats.upToDate, mCookStats.failed);
+				ImGui::Text("Cooked size: %.1f MB from %.1f MB", static_cast<float>(mCookStats.cookedBytes) / (1024 * 1024),
+					static_cast<float>(mCookStats.sourceBytes) / (1024 * 1024));
+			}
+		}
+		ImGui::End();
+
+		if (ImGui::Begin("GPU Profiler", 0, ImGuiWindowFlags_NoBringToFrontOnFocus))
+		{
+			if (ImGui::Button("Save Chrome trace"))
+			{
+				try
+				{
+					mEngine->mGpuProfiler->SaveChromeTrace("GpuTrace.json");
+				}
+				catch (const std::exception& e)
+				{
+					OutputDebugStringA(e.what());
+				}
+			}
+
+			ShowProfileNode(mEngine->mGpuProfiler->Tree(), CDX12ProfileTree::Root);
+		}
+		ImGui::End();
+	}
+
 	void CDX12Gui::End()
 	{
 		mEngine->mSRVDescriptorHeap->Set();
 		ImGui::Render();
 		ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), mEngine->mCurrRecordingCommandList);
+
+		// ImGui set its own buffers on the list
+		CDX12Engine::mCurrGeometryPool = SDX12Geometry::InvalidPool;
+
 		ImGui::UpdatePlatformWindows();
 	}
 	
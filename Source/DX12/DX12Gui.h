@@ -1,8 +1,10 @@
 #pragma once
 
 #include <deque>
+#include <future>
 
 #include "../Common/CGui.h"
+#include "../Common/TextureCooker.h"
 #include "DX12DescriptorHeap.h"
 #include "imgui.h"
 
@@ -27,6 +29,9 @@ namespace DX12
 
 		void Begin() override;
 
+		// Adds the recording times of the command lists
+		void Show(float& frameTime) override;
+
 		void End() override;
 
 		~CDX12Gui() override;
@@ -34,5 +39,9 @@ namespace DX12
 	private:
 
 		CDX12Engine* mEngine = nullptr;
+
+		// Cooking the media folder runs on its own thread, the frames go on meanwhile
+		std::future<STextureCookStats> mCook;
+		STextureCookStats              mCookStats;
 	};
 }
@@ -0,0 +1,606 @@
+#include "DX12HeapAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace DX12
+{
+	namespace
+	{
+		uint32_t HighestBit(uint64_t v)
+		{
+			uint32_t bit = 0;
+			while (v >>= 1) ++bit;
+			return bit;
+		}
+
+		uint32_t LowestBit(uint64_t v)
+		{
+			uint32_t bit = 0;
+			while (!(v & 1)) { v >>= 1; ++bit; }
+			return bit;
+		}
+
+		bool IsPowerOf2(uint64_t v)
+		{
+			return v && !(v & (v - 1));
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// TLSF
+	//--------------------------------------------------------------------------------------
+
+	CTLSFAllocator::CTLSFAllocator(uint64_t size, uint64_t granularity) :
+		mGranularity(granularity),
+		mSize((size + granularity - 1) / std::max<uint64_t>(granularity, 1))
+	{
+		if (!IsPowerOf2(granularity)) throw std::logic_error("The TLSF granularity has to be a power of 2");
+		if (mSize == 0) throw std::logic_error("Empty TLSF range");
+
+		for (auto& lists : mFreeLists)
+			for (auto& head : lists) head = InvalidBlock;
+
+		// The whole range starts as one free block
+		const auto block = NewBlock();
+		mBlocks[block].size = mSize;
+		InsertFree(block);
+	}
+
+	void CTLSFAllocator::Mapping(uint64_t size, uint32_t& fl, uint32_t& sl)
+	{
+		if (size < SLCount)
+		{
+			fl = 0;
+			sl = static_cast<uint32_t>(size);
+		}
+		else
+		{
+			const auto msb = HighestBit(size);
+			fl = msb - SLBits + 1;
+			sl = static_cast<uint32_t>(size >> (msb - SLBits)) - SLCount;
+		}
+	}
+
+	uint32_t CTLSFAllocator::NewBlock()
+	{
+		if (mUnusedBlocks.empty())
+		{
+			mBlocks.emplace_back();
+			return static_cast<uint32_t>(mBlocks.size() - 1);
+		}
+
+		const auto block = mUnusedBlocks.back();
+		mUnusedBlocks.pop_back();
+		mBlocks[block] = {};
+		return block;
+	}
+
+	void CTLSFAllocator::ReleaseBlock(uint32_t block)
+	{
+		mBlocks[block] = {};
+		mUnusedBlocks.push_back(block);
+	}
+
+	void CTLSFAllocator::InsertFree(uint32_t block)
+	{
+		uint32_t fl, sl;
+		Mapping(mBlocks[block].size, fl, sl);
+
+		auto& b = mBlocks[block];
+		b.free = true;
+		b.prevFree = InvalidBlock;
+		b.nextFree = mFreeLists[fl][sl];
+		if (b.nextFree != InvalidBlock) mBlocks[b.nextFree].prevFree = block;
+		mFreeLists[fl][sl] = block;
+
+		mFLBitmap |= 1ull << fl;
+		mSLBitmaps[fl] |= 1u << sl;
+	}
+
+	void CTLSFAllocator::RemoveFree(uint32_t block)
+	{
+		uint32_t fl, sl;
+		Mapping(mBlocks[block].size, fl, sl);
+
+		auto& b = mBlocks[block];
+		if (b.prevFree != InvalidBlock) mBlocks[b.prevFree].nextFree = b.nextFree;
+		else                            mFreeLists[fl][sl] = b.nextFree;
+		if (b.nextFree != InvalidBlock) mBlocks[b.nextFree].prevFree = b.prevFree;
+
+		b.free = false;
+		b.prevFree = b.nextFree = InvalidBlock;
+
+		if (mFreeLists[fl][sl] == InvalidBlock)
+		{
+			mSLBitmaps[fl] &= ~(1u << sl);
+			if (!mSLBitmaps[fl]) mFLBitmap &= ~(1ull << fl);
+		}
+	}
+
+	uint32_t CTLSFAllocator::FindFree(uint64_t size) const
+	{
+		// Round up to the next list so any block of the list found is big enough
+		if (size >= SLCount) size += (1ull << (HighestBit(size) - SLBits)) - 1;
+
+		uint32_t fl, sl;
+		Mapping(size, fl, sl);
+		if (fl >= FLCount) return InvalidBlock;
+
+		auto slMap = mSLBitmaps[fl] & (~0u << sl);
+		if (!slMap)
+		{
+			const auto flMap = fl + 1 < FLCount ? mFLBitmap & (~0ull << (fl + 1)) : 0;
+			if (!flMap) return InvalidBlock;
+
+			fl = LowestBit(flMap);
+			slMap = mSLBitmaps[fl];
+		}
+
+		return mFreeLists[fl][LowestBit(slMap)];
+	}
+
+	bool CTLSFAllocator::Fits(uint32_t block, uint64_t size, uint64_t alignment) const
+	{
+		const auto& b = mBlocks[block];
+		const auto aligned = (b.offset + alignment - 1) / alignment * alignment;
+		return aligned + size <= b.offset + b.size;
+	}
+
+	void CTLSFAllocator::SplitTail(uint32_t block, uint64_t size)
+	{
+		if (mBlocks[block].size <= size) return;
+
+		const auto tail = NewBlock();
+		auto& b = mBlocks[block];
+		auto& t = mBlocks[tail];
+
+		t.offset = b.offset + size;
+		t.size = b.size - size;
+		t.prevPhys = block;
+		t.nextPhys = b.nextPhys;
+		if (t.nextPhys != InvalidBlock) mBlocks[t.nextPhys].prevPhys = tail;
+
+		b.size = size;
+		b.nextPhys = tail;
+
+		InsertFree(tail);
+	}
+
+	uint32_t CTLSFAllocator::Allocate(uint64_t size, uint64_t alignment, void* userData)
+	{
+		if (!IsPowerOf2(alignment)) throw std::logic_error("The alignment has to be a power of 2");
+
+		const auto units = std::max<uint64_t>((size + mGranularity - 1) / mGranularity, 1);
+		const auto alignUnits = std::max<uint64_t>(alignment / mGranularity, 1);
+
+		// The first block big enough is often aligned already (e.g. the start of an empty heap), if not look for one
+		// with enough room to align the start of any block found
+		auto block = FindFree(units);
+		if (block != InvalidBlock && !Fits(block, units, alignUnits)) block = FindFree(units + alignUnits - 1);
+
+		// The lists searched above only hold blocks bigger than the size rounded up, the list of the size itself may
+		// still have a block that fits (e.g. a dedicated heap of the exact size)
+		if (block == InvalidBlock)
+		{
+			uint32_t fl, sl;
+			Mapping(units, fl, sl);
+			for (block = mFreeLists[fl][sl]; block != InvalidBlock; block = mBlocks[block].nextFree)
+			{
+				if (Fits(block, units, alignUnits)) break;
+			}
+		}
+		if (block == InvalidBlock) return InvalidBlock;
+
+		RemoveFree(block);
+
+		// Padding in front of the aligned offset goes back to the free lists. The previous block can't be free
+		// (free blocks are always merged with their neighbours) so it does not need merging
+		const auto aligned = (mBlocks[block].offset + alignUnits - 1) / alignUnits * alignUnits;
+		const auto padding = aligned - mBlocks[block].offset;
+		if (padding)
+		{
+			const auto front = NewBlock();
+			auto& b = mBlocks[block];
+			auto& f = mBlocks[front];
+
+			f.offset = b.offset;
+			f.size = padding;
+			f.prevPhys = b.prevPhys;
+			f.nextPhys = block;
+			if (f.prevPhys != InvalidBlock) mBlocks[f.prevPhys].nextPhys = front;
+
+			b.offset = aligned;
+			b.size -= padding;
+			b.prevPhys = front;
+
+			InsertFree(front);
+		}
+
+		SplitTail(block, units);
+
+		mBlocks[block].alignment = alignUnits;
+		mBlocks[block].userData = userData;
+		mUsed += mBlocks[block].size;
+		++mNumAllocations;
+
+		return block;
+	}
+
+	void CTLSFAllocator::Free(uint32_t block)
+	{
+		if (block >= mBlocks.size() || mBlocks[block].free || mBlocks[block].size == 0)
+			throw std::logic_error("Freeing a TLSF block that is not allocated");
+
+		mUsed -= mBlocks[block].size;
+		--mNumAllocations;
+		mBlocks[block].userData = nullptr;
+
+		// Merge with the next block
+		const auto next = mBlocks[block].nextPhys;
+		if (next != InvalidBlock && mBlocks[next].free)
+		{
+			RemoveFree(next);
+			mBlocks[block].size += mBlocks[next].size;
+			mBlocks[block].nextPhys = mBlocks[next].nextPhys;
+			if (mBlocks[block].nextPhys != InvalidBlock) mBlocks[mBlocks[block].nextPhys].prevPhys = block;
+			ReleaseBlock(next);
+		}
+
+		// Merge into the previous block
+		const auto prev = mBlocks[block].prevPhys;
+		if (prev != InvalidBlock && mBlocks[prev].free)
+		{
+			RemoveFree(prev);
+			mBlocks[prev].size += mBlocks[block].size;
+			mBlocks[prev].nextPhys = mBlocks[block].nextPhys;
+			if (mBlocks[prev].nextPhys != InvalidBlock) mBlocks[mBlocks[prev].nextPhys].prevPhys = prev;
+			ReleaseBlock(block);
+			InsertFree(prev);
+		}
+		else
+		{
+			InsertFree(block);
+		}
+	}
+
+	void CTLSFAllocator::Allocations(std::vector<uint32_t>& blocks) const
+	{
+		for (auto block = 0u; block != InvalidBlock; block = mBlocks[block].nextPhys)
+		{
+			if (!mBlocks[block].free) blocks.push_back(block);
+		}
+	}
+
+	uint64_t CTLSFAllocator::LargestFreeBlock() const
+	{
+		if (!mFLBitmap) return 0;
+
+		// Blocks of the highest list are not sorted, so look at all of them
+		const auto fl = HighestBit(mFLBitmap);
+		const auto sl = HighestBit(mSLBitmaps[fl]);
+
+		uint64_t largest = 0;
+		for (auto block = mFreeLists[fl][sl]; block != InvalidBlock; block = mBlocks[block].nextFree)
+			largest = std::max(largest, mBlocks[block].size);
+
+		return largest * mGranularity;
+	}
+
+	void CTLSFAllocator::Validate() const
+	{
+		uint64_t offset = 0, used = 0;
+		uint32_t allocations = 0, freeBlocks = 0;
+		auto prev = InvalidBlock;
+		for (auto block = 0u; block != InvalidBlock; block = mBlocks[block].nextPhys)
+		{
+			const auto& b = mBlocks[block];
+			if (b.offset != offset || b.size == 0)       throw std::logic_error("TLSF blocks are not contiguous");
+			if (b.prevPhys != prev)                       throw std::logic_error("TLSF physical links are broken");
+			if (b.free && prev != InvalidBlock && mBlocks[prev].free) throw std::logic_error("TLSF free blocks are not merged");
+
+			if (b.free) ++freeBlocks;
+			else { used += b.size; ++allocations; }
+
+			offset += b.size;
+			prev = block;
+		}
+
+		if (offset != mSize)                                       throw std::logic_error("TLSF blocks do not cover the range");
+		if (used != mUsed || allocations != mNumAllocations)       throw std::logic_error("TLSF usage is wrong");
+
+		uint32_t listed = 0;
+		for (uint32_t fl = 0; fl < FLCount; ++fl)
+		{
+			if (!(mFLBitmap & (1ull << fl)) != !mSLBitmaps[fl])    throw std::logic_error("TLSF first level bitmap is wrong");
+
+			for (uint32_t sl = 0; sl < SLCount; ++sl)
+			{
+				const auto head = mFreeLists[fl][sl];
+				if ((head == InvalidBlock) == !!(mSLBitmaps[fl] & (1u << sl))) throw std::logic_error("TLSF second level bitmap is wrong");
+
+				for (auto block = head; block != InvalidBlock; block = mBlocks[block].nextFree)
+				{
+					uint32_t blockFL, blockSL;
+					Mapping(mBlocks[block].size, blockFL, blockSL);
+					if (!mBlocks[block].free || blockFL != fl || blockSL != sl) throw std::logic_error("TLSF block is in the wrong list");
+					++listed;
+				}
+			}
+		}
+
+		if (listed != freeBlocks) throw std::logic_error("TLSF free lists do not match the free blocks");
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Heaps
+	//--------------------------------------------------------------------------------------
+
+	struct SGpuHeapRecord
+	{
+		void*          heap = nullptr;
+		uint32_t       pool = 0;
+		bool           dedicated = false;
+		CTLSFAllocator tlsf;
+
+		SGpuHeapRecord(uint64_t size) : tlsf(size, CDX12HeapAllocator::Granularity) {}
+	};
+
+	SGpuHeapStats& SGpuHeapStats::operator+=(const SGpuHeapStats& other)
+	{
+		heaps += other.heaps;
+		dedicatedHeaps += other.dedicatedHeaps;
+		heapBytes += other.heapBytes;
+		usedBytes += other.usedBytes;
+		allocations += other.allocations;
+		largestFreeBlock = std::max(largestFreeBlock, other.largestFreeBlock);
+		pendingFreeBytes += other.pendingFreeBytes;
+		return *this;
+	}
+
+	CDX12HeapAllocator::CDX12HeapAllocator(IGpuHeapSource* source, uint64_t heapSize) :
+		mSource(source),
+		mHeapSize((heapSize + Granularity - 1) / Granularity * Granularity)
+	{
+	}
+
+	CDX12HeapAllocator::~CDX12HeapAllocator()
+	{
+		for (auto& pool : mPools)
+			for (const auto& heap : pool) mSource->DestroyHeap(heap->heap);
+	}
+
+	uint32_t CDX12HeapAllocator::PoolIndex(EGpuHeapType type, EGpuResourceCategory category)
+	{
+		return static_cast<uint32_t>(type) * static_cast<uint32_t>(EGpuResourceCategory::Count) + static_cast<uint32_t>(category);
+	}
+
+	SGpuHeapRecord* CDX12HeapAllocator::CreateHeap(uint32_t pool, uint64_t size, bool dedicated)
+	{
+		const auto type = static_cast<EGpuHeapType>(pool / static_cast<uint32_t>(EGpuResourceCategory::Count));
+		const auto category = static_cast<EGpuResourceCategory>(pool % static_cast<uint32_t>(EGpuResourceCategory::Count));
+
+		auto record = std::make_unique<SGpuHeapRecord>(size);
+		record->pool = pool;
+		record->dedicated = dedicated;
+		record->heap = mSource->CreateHeap(type, category, record->tlsf.Size());
+
+		mPools[pool].push_back(std::move(record));
+		return mPools[pool].back().get();
+	}
+
+	SGpuAllocation CDX12HeapAllocator::AllocateFrom(SGpuHeapRecord* heap, uint64_t size, uint64_t alignment, void* userData) const
+	{
+		SGpuAllocation allocation;
+
+		const auto block = heap->tlsf.Allocate(size, alignment, userData);
+		if (block == CTLSFAllocator::InvalidBlock) return allocation;
+
+		allocation.heap = heap->heap;
+		allocation.offset = heap->tlsf.Offset(block);
+		allocation.size = heap->tlsf.BlockSize(block);
+		allocation.record = heap;
+		allocation.block = block;
+		return allocation;
+	}
+
+	SGpuAllocation CDX12HeapAllocator::Allocate(EGpuHeapType type, EGpuResourceCategory category, uint64_t size, uint64_t alignment, void* userData)
+	{
+		if (!IsPowerOf2(alignment)) throw std::logic_error("The alignment has to be a power of 2");
+
+		std::unique_lock l(mMutex);
+
+		const auto pool = PoolIndex(type, category);
+
+		// Big allocations would leave most of a shared heap unusable
+		if (size + alignment > mHeapSize / 2)
+		{
+			const auto heap = CreateHeap(pool, std::max(size, Granularity), true);
+			return AllocateFrom(heap, size, alignment, userData);
+		}
+
+		for (const auto& heap : mPools[pool])
+		{
+			if (heap->dedicated) continue;
+
+			if (auto allocation = AllocateFrom(heap.get(), size, alignment, userData)) return allocation;
+		}
+
+		return AllocateFrom(CreateHeap(pool, mHeapSize, false), size, alignment, userData);
+	}
+
+	void CDX12HeapAllocator::FreeLocked(const SGpuAllocation& allocation)
+	{
+		allocation.record->tlsf.Free(allocation.block);
+		ReleaseEmptyHeaps(allocation.record->pool);
+	}
+
+	void CDX12HeapAllocator::Free(const SGpuAllocation& allocation)
+	{
+		if (!allocation) return;
+
+		std::unique_lock l(mMutex);
+		FreeLocked(allocation);
+	}
+
+	void CDX12HeapAllocator::Free(const SGpuAllocation& allocation, uint64_t fenceValue)
+	{
+		if (!allocation) return;
+
+		std::unique_lock l(mMutex);
+		mDeferredFrees.push_back({ allocation, fenceValue });
+	}
+
+	void CDX12HeapAllocator::ProcessDeferredFrees()
+	{
+		std::unique_lock l(mMutex);
+
+		const auto completed = mSource->CompletedFenceValue();
+
+		// Not sorted, frees can come from several threads with fence values read at different times
+		auto remaining = mDeferredFrees.begin();
+		for (auto it = mDeferredFrees.begin(); it != mDeferredFrees.end(); ++it)
+		{
+			if (it->fenceValue <= completed) FreeLocked(it->allocation);
+			else                             *remaining++ = *it;
+		}
+		mDeferredFrees.erase(remaining, mDeferredFrees.end());
+	}
+
+	void CDX12HeapAllocator::ReleaseEmptyHeaps(uint32_t pool)
+	{
+		auto& heaps = mPools[pool];
+
+		// Keep one empty shared heap so a pool going up and down around a heap boundary does not create and destroy heaps every frame
+		bool keptOne = false;
+		for (auto it = heaps.begin(); it != heaps.end();)
+		{
+			const auto& heap = *it;
+			if (heap->tlsf.Empty() && (heap->dedicated || keptOne))
+			{
+				mSource->DestroyHeap(heap->heap);
+				it = heaps.erase(it);
+				continue;
+			}
+
+			if (heap->tlsf.Empty()) keptOne = true;
+			++it;
+		}
+	}
+
+	uint64_t CDX12HeapAllocator::Defragment(EGpuHeapType type, EGpuResourceCategory category, uint64_t maxBytes, uint64_t fenceValue, const MoveFunction& move)
+	{
+		std::vector<std::pair<SGpuAllocation, SGpuAllocation>> moves;
+		{
+			std::unique_lock l(mMutex);
+
+			std::vector<SGpuHeapRecord*> heaps;
+			for (const auto& heap : mPools[PoolIndex(type, category)])
+			{
+				if (!heap->dedicated && !heap->tlsf.Empty()) heaps.push_back(heap.get());
+			}
+			if (heaps.size() < 2) return 0;
+
+			// Empty the least used heap into the others, fullest first so the free space ends up in as few heaps as possible
+			std::sort(heaps.begin(), heaps.end(), [](const SGpuHeapRecord* a, const SGpuHeapRecord* b)
+			{
+				return a->tlsf.UsedBytes() > b->tlsf.UsedBytes();
+			});
+			const auto source = heaps.back();
+			heaps.pop_back();
+
+			std::vector<uint32_t> blocks;
+			source->tlsf.Allocations(blocks);
+
+			uint64_t planned = 0;
+			for (const auto block : blocks)
+			{
+				if (planned >= maxBytes) break;
+
+				SGpuAllocation from;
+				from.heap = source->heap;
+				from.offset = source->tlsf.Offset(block);
+				from.size = source->tlsf.BlockSize(block);
+				from.record = source;
+				from.block = block;
+
+				SGpuAllocation to;
+				for (const auto heap : heaps)
+				{
+					if ((to = AllocateFrom(heap, from.size, source->tlsf.Alignment(block), source->tlsf.UserData(block)))) break;
+				}
+				if (!to) break;
+
+				moves.emplace_back(from, to);
+				planned += from.size;
+			}
+		}
+
+		// The callbacks run without the lock, they are likely to create resources from this allocator
+		uint64_t moved = 0;
+		for (const auto& [from, to] : moves)
+		{
+			if (move(from, to, from.record->tlsf.UserData(from.block)))
+			{
+				Free(from, fenceValue);
+				moved += from.size;
+			}
+			else
+			{
+				Free(to);
+			}
+		}
+
+		return moved;
+	}
+
+	SGpuHeapStats CDX12HeapAllocator::StatsLocked(uint32_t pool) const
+	{
+		SGpuHeapStats stats;
+		for (const auto& heap : mPools[pool])
+		{
+			++stats.heaps;
+			if (heap->dedicated) ++stats.dedicatedHeaps;
+			stats.heapBytes += heap->tlsf.Size();
+			stats.usedBytes += heap->tlsf.UsedBytes();
+			stats.allocations += heap->tlsf.NumAllocations();
+			stats.largestFreeBlock = std::max(stats.largestFreeBlock, heap->tlsf.LargestFreeBlock());
+		}
+
+		for (const auto& deferred : mDeferredFrees)
+		{
+			if (deferred.allocation.record->pool == pool) stats.pendingFreeBytes += deferred.allocation.size;
+		}
+
+		return stats;
+	}
+
+	SGpuHeapStats CDX12HeapAllocator::Stats(EGpuHeapType type, EGpuResourceCategory category) const
+	{
+		std::unique_lock l(mMutex);
+		return StatsLocked(PoolIndex(type, category));
+	}
+
+	SGpuHeapStats CDX12HeapAllocator::Stats() const
+	{
+		std::unique_lock l(mMutex);
+
+		SGpuHeapStats stats;
+		for (uint32_t pool = 0; pool < NumPools; ++pool) stats += StatsLocked(pool);
+		return stats;
+	}
+
+	void CDX12HeapAllocator::Validate() const
+	{
+		std::unique_lock l(mMutex);
+
+		for (uint32_t pool = 0; pool < NumPools; ++pool)
+		{
+			for (const auto& heap : mPools[pool])
+			{
+				if (heap->pool != pool) throw std::logic_error("Heap is in the wrong pool");
+				heap->tlsf.Validate();
+			}
+		}
+	}
+}
@@ -0,0 +1,251 @@
+//--------------------------------------------------------------------------------------
+// GPU memory sub-allocator
+//--------------------------------------------------------------------------------------
+// Resources are placed in a few large heaps instead of each one getting a committed
+// resource (and so a heap and a kernel allocation) of its own. There is a pool of heaps
+// per heap type and resource category, as heaps of resource heap tier 1 hardware can only
+// hold one category, and the heaps are shared with a TLSF allocator (two level segregated
+// fit: constant time allocation and free, low fragmentation). Allocations bigger than half
+// a heap get a dedicated heap.
+// Frees can be deferred until a fence value has completed, so memory the GPU may still
+// read is not handed out again. Defragment moves allocations out of the emptiest heap of a
+// pool through a callback, which is where the owner recreates and copies its resource.
+// The allocator only knows about heaps and fence values through IGpuHeapSource, so it does
+// not depend on D3D12 and can be driven (and fuzzed) with a fake source.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace DX12
+{
+	enum class EGpuHeapType : uint32_t
+	{
+		Default,
+		Upload,
+		Readback,
+		Count
+	};
+
+	enum class EGpuResourceCategory : uint32_t
+	{
+		Buffer,       // Placed buffers, D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS
+		Texture,      // D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES
+		RenderTarget, // D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES
+		SubBuffer,    // Ranges of a shared buffer, for buffers smaller than the placement alignment
+		Count
+	};
+
+	// Two level segregated fit allocator over a range of offsets
+	class CTLSFAllocator
+	{
+	public:
+
+		static constexpr uint32_t InvalidBlock = 0xFFFFFFFF;
+
+		CTLSFAllocator() = delete;
+		CTLSFAllocator(const CTLSFAllocator&) = delete;
+		CTLSFAllocator(const CTLSFAllocator&&) = delete;
+		CTLSFAllocator& operator=(const CTLSFAllocator&) = delete;
+		CTLSFAllocator& operator=(const CTLSFAllocator&&) = delete;
+
+		// Sizes and offsets are rounded to the granularity, which has to be a power of 2
+		// Will throw a std::logic_error exception on invalid arguments
+		CTLSFAllocator(uint64_t size, uint64_t granularity);
+
+		// Returns the allocated block, InvalidBlock if there is no free range big enough
+		// Will throw a std::logic_error exception if the alignment is not a power of 2
+		uint32_t Allocate(uint64_t size, uint64_t alignment, void* userData = nullptr);
+
+		void Free(uint32_t block);
+
+		uint64_t Offset(uint32_t block) const { return mBlocks[block].offset * mGranularity; }
+		uint64_t BlockSize(uint32_t block) const { return mBlocks[block].size * mGranularity; }
+		uint64_t Alignment(uint32_t block) const { return mBlocks[block].alignment * mGranularity; }
+		void*    UserData(uint32_t block) const { return mBlocks[block].userData; }
+
+		// Allocated blocks in address order
+		void Allocations(std::vector<uint32_t>& blocks) const;
+
+		uint64_t Size() const { return mSize * mGranularity; }
+		uint64_t UsedBytes() const { return mUsed * mGranularity; }
+		uint64_t LargestFreeBlock() const;
+		uint32_t NumAllocations() const { return mNumAllocations; }
+		bool     Empty() const { return mNumAllocations == 0; }
+
+		// Check the block lists and bitmaps are consistent, throws a std::logic_error exception if not
+		void Validate() const;
+
+	private:
+
+		static constexpr uint32_t SLBits  = 4;
+		static constexpr uint32_t SLCount = 1 << SLBits;
+		static constexpr uint32_t FLCount = 64;
+
+		// Sizes and offsets in granularity units
+		struct SBlock
+		{
+			uint64_t offset    = 0;
+			uint64_t size      = 0;
+			uint64_t alignment = 1; // Requested one, kept for moving the block
+			uint32_t prevPhys  = InvalidBlock;
+			uint32_t nextPhys  = InvalidBlock;
+			uint32_t prevFree  = InvalidBlock;
+			uint32_t nextFree  = InvalidBlock;
+			bool     free      = false;
+			void*    userData  = nullptr;
+		};
+
+		static void Mapping(uint64_t size, uint32_t& fl, uint32_t& sl);
+
+		uint32_t NewBlock();
+		void     ReleaseBlock(uint32_t block);
+
+		void     InsertFree(uint32_t block);
+		void     RemoveFree(uint32_t block);
+		uint32_t FindFree(uint64_t size) const;
+
+		bool Fits(uint32_t block, uint64_t size, uint64_t alignment) const;
+
+		// Split the end of a block from the given size into a new free block
+		void SplitTail(uint32_t block, uint64_t size);
+
+		uint64_t mGranularity;
+		uint64_t mSize;
+		uint64_t mUsed           = 0;
+		uint32_t mNumAllocations = 0;
+
+		std::vector<SBlock>   mBlocks; // Block 0 always starts at offset 0
+		std::vector<uint32_t> mUnusedBlocks;
+
+		uint64_t mFLBitmap = 0;
+		uint32_t mSLBitmaps[FLCount] = {};
+		uint32_t mFreeLists[FLCount][SLCount];
+	};
+
+	// Where the heaps come from and how the allocator knows the GPU is done with memory
+	class IGpuHeapSource
+	{
+	public:
+		virtual ~IGpuHeapSource() = default;
+
+		// Will throw a std::runtime_error exception on failure
+		virtual void* CreateHeap(EGpuHeapType type, EGpuResourceCategory category, uint64_t size) = 0;
+
+		virtual void DestroyHeap(void* heap) = 0;
+
+		virtual uint64_t CompletedFenceValue() = 0;
+	};
+
+	struct SGpuHeapRecord;
+
+	struct SGpuAllocation
+	{
+		void*    heap   = nullptr; // What the source created
+		uint64_t offset = 0;
+		uint64_t size   = 0;
+
+		SGpuHeapRecord* record = nullptr;
+		uint32_t        block  = CTLSFAllocator::InvalidBlock;
+
+		explicit operator bool() const { return record != nullptr; }
+	};
+
+	struct SGpuHeapStats
+	{
+		uint32_t heaps            = 0;
+		uint32_t dedicatedHeaps   = 0;
+		uint64_t heapBytes        = 0;
+		uint64_t usedBytes        = 0;
+		uint64_t allocations      = 0;
+		uint64_t largestFreeBlock = 0;
+		uint64_t pendingFreeBytes = 0; // Freed but still waiting for the fence
+
+		SGpuHeapStats& operator+=(const SGpuHeapStats& other);
+	};
+
+	class CDX12HeapAllocator
+	{
+	public:
+
+		static constexpr uint64_t DefaultHeapSize = 64 * 1024 * 1024;
+
+		// Smallest allocation, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT
+		static constexpr uint64_t Granularity = 256;
+
+		// Called by Defragment for every allocation it wants to move. Returns false if the allocation can't be moved
+		using MoveFunction = std::function<bool(const SGpuAllocation& from, const SGpuAllocation& to, void* userData)>;
+
+		CDX12HeapAllocator() = delete;
+		CDX12HeapAllocator(const CDX12HeapAllocator&) = delete;
+		CDX12HeapAllocator(const CDX12HeapAllocator&&) = delete;
+		CDX12HeapAllocator& operator=(const CDX12HeapAllocator&) = delete;
+		CDX12HeapAllocator& operator=(const CDX12HeapAllocator&&) = delete;
+
+		explicit CDX12HeapAllocator(IGpuHeapSource* source, uint64_t heapSize = DefaultHeapSize);
+
+		// Destroys every heap, whatever is still allocated in them
+		~CDX12HeapAllocator();
+
+		// The user data is handed back to Defragment's callback
+		// Will throw a std::logic_error exception if the alignment is not a power of 2
+		SGpuAllocation Allocate(EGpuHeapType type, EGpuResourceCategory category, uint64_t size, uint64_t alignment, void* userData = nullptr);
+
+		// Free now, the GPU must not be using the memory any more
+		void Free(const SGpuAllocation& allocation);
+
+		// Free once the fence has reached the value
+		void Free(const SGpuAllocation& allocation, uint64_t fenceValue);
+
+		// Free the deferred allocations the GPU is done with and release the empty heaps
+		void ProcessDeferredFrees();
+
+		// Move allocations out of the least used heap of a pool into the other heaps, until maxBytes have been moved.
+		// The moved allocations are freed once the fence reaches fenceValue, which has to be signalled after the copies.
+		// Returns the number of bytes moved
+		uint64_t Defragment(EGpuHeapType type, EGpuResourceCategory category, uint64_t maxBytes, uint64_t fenceValue, const MoveFunction& move);
+
+		SGpuHeapStats Stats(EGpuHeapType type, EGpuResourceCategory category) const;
+		SGpuHeapStats Stats() const;
+
+		uint64_t HeapSize() const { return mHeapSize; }
+
+		// Check every heap, throws a std::logic_error exception if something is inconsistent
+		void Validate() const;
+
+	private:
+
+		static constexpr uint32_t NumPools = static_cast<uint32_t>(EGpuHeapType::Count) * static_cast<uint32_t>(EGpuResourceCategory::Count);
+
+		struct SDeferredFree
+		{
+			SGpuAllocation allocation;
+			uint64_t       fenceValue;
+		};
+
+		static uint32_t PoolIndex(EGpuHeapType type, EGpuResourceCategory category);
+
+		SGpuHeapRecord* CreateHeap(uint32_t pool, uint64_t size, bool dedicated);
+
+		SGpuAllocation AllocateFrom(SGpuHeapRecord* heap, uint64_t size, uint64_t alignment, void* userData) const;
+
+		void FreeLocked(const SGpuAllocation& allocation);
+
+		// Destroy the dedicated heaps that are empty, and all the empty shared heaps of a pool but one
+		void ReleaseEmptyHeaps(uint32_t pool);
+
+		SGpuHeapStats StatsLocked(uint32_t pool) const;
+
+		IGpuHeapSource* mSource;
+		uint64_t        mHeapSize;
+
+		std::vector<std::unique_ptr<SGpuHeapRecord>> mPools[NumPools];
+		std::vector<SDeferredFree>                   mDeferredFrees;
+
+		mutable std::mutex mMutex;
+	};
+}
@@ -0,0 +1,215 @@
+#include "DX12InstanceTable.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "DX12Engine.h"
+#include "DX12MaterialTable.h"
+#include "DX12Mesh.h"
+#include "DX12ResourceAllocator.h"
+#include "Objects/DX12GameObject.h"
+
+namespace DX12
+{
+	static_assert(sizeof(SInstanceRecord) == 56);
+	static_assert(CDX12Engine::mNumFrames <= 8, "A byte of queued bits per record");
+
+	CDX12InstanceTable::CDX12InstanceTable(CDX12Engine* engine, uint32_t capacity) :
+		mEngine(engine),
+		mCapacity(std::max(capacity, 1u)),
+		mFrames(CDX12Engine::mNumFrames)
+	{
+	}
+
+	void CDX12InstanceTable::Sync(const std::deque<CGameObject*>& objects)
+	{
+		std::unordered_map<CGameObject*, SObject> synced;
+
+		for (const auto object : objects)
+		{
+			const auto o = dynamic_cast<CDX12GameObject*>(object);
+			if (!o || !o->Mesh() || !o->Material()) continue;
+
+			auto entry = SObject{};
+
+			const auto found = mObjects.find(object);
+			if (found != mObjects.end())
+			{
+				entry = found->second;
+				mObjects.erase(found);
+			}
+
+			if (entry.mesh != o->Mesh())
+			{
+				// A new object, or one with another mesh that may have another number of nodes
+				const auto nodes = o->Mesh()->NumberNodes();
+				if (entry.mesh && entry.nodes != nodes)
+				{
+					mRecords.Free(entry.first);
+					entry.mesh = nullptr;
+				}
+
+				if (!entry.mesh) entry.first = static_cast<uint32_t>(mRecords.Allocate(nodes));
+
+				entry.mesh = o->Mesh();
+				entry.nodes = nodes;
+
+				// The records are written again with the nodes and the flags of the mesh
+				entry.matrices.clear();
+			}
+
+			synced.emplace(object, entry);
+		}
+
+		// What is left is gone
+		for (const auto& [object, entry] : mObjects) mRecords.Free(entry.first);
+
+		mObjects.swap(synced);
+
+#if defined(_DEBUG)
+		mRecords.Validate();
+#endif
+	}
+
+	uint32_t CDX12InstanceTable::Index(CGameObject* object) const
+	{
+		const auto found = mObjects.find(object);
+		if (found == mObjects.end()) throw std::logic_error("Instance index of an object without instance records");
+
+		return found->second.first;
+	}
+
+	void CDX12InstanceTable::Update()
+	{
+		const auto count = static_cast<uint32_t>(mRecords.End());
+
+		// The free records are never read, they keep whatever they had
+		if (mCurrent.size() < count)
+		{
+			mCurrent.resize(count);
+			mQueued.resize(count, 0);
+		}
+
+		// New buffers have none of the records
+		if (Reserve(count))
+		{
+			for (const auto& [object, entry] : mObjects) Queue(entry.first, entry.nodes);
+		}
+
+		mDirtyObjects = 0;
+
+		for (auto& [object, entry] : mObjects)
+		{
+			const auto& matrices = object->WorldMatrices();
+			const auto material = mEngine->mMaterialTable->Index(object);
+
+			const auto moved = entry.matrices.size() != matrices.size() ||
+				std::memcmp(entry.matrices.data(), matrices.data(), matrices.size() * sizeof(CMatrix4x4)) != 0;
+			if (!moved && entry.material == material) continue;
+
+			Write(object, entry, material);
+		}
+
+		// The buffer of the frame is not read by the frames in flight
+		const auto frameIndex = mEngine->mCurrentBackBufferIndex;
+		auto& frame = mFrames[frameIndex];
+
+		for (const auto record : frame.dirty)
+		{
+			frame.cpu[record] = mCurrent[record];
+			mQueued[record] &= static_cast<uint8_t>(~(1u << frameIndex));
+		}
+
+		mWrites = static_cast<uint32_t>(frame.dirty.size());
+		mWrittenBytes = static_cast<uint64_t>(mWrites) * sizeof(SInstanceRecord);
+
+		frame.dirty.clear();
+	}
+
+	void CDX12InstanceTable::Set(UINT instancesParameter) const
+	{
+		mEngine->mCurrRecordingCommandList->SetGraphicsRootShaderResourceView(instancesParameter, mFrames[mEngine->mCurrentBackBufferIndex].buffer->GetGPUVirtualAddress());
+	}
+
+	SInstanceTableStats CDX12InstanceTable::Stats() const
+	{
+		SInstanceTableStats stats;
+		stats.objects = static_cast<uint32_t>(mObjects.size());
+		stats.records = static_cast<uint32_t>(mRecords.Allocated());
+		stats.freeRecords = static_cast<uint32_t>(mRecords.FreeUnits());
+		stats.dirtyObjects = mDirtyObjects;
+		stats.tableBytes = static_cast<uint64_t>(mCapacity) * sizeof(SInstanceRecord);
+		stats.writtenBytes = mWrittenBytes;
+		stats.writes = mWrites;
+		return stats;
+	}
+
+	void CDX12InstanceTable::Write(CGameObject* object, SObject& entry, uint32_t material)
+	{
+		const auto flags = entry.mesh->hasTangents ? SInstanceRecord::Tangents : 0u;
+
+		entry.mesh->AbsoluteMatrices(object->WorldMatrices(), mMatrices);
+
+		for (uint32_t node = 0; node < entry.nodes; ++node)
+		{
+			// The engine matrices have the translation in the last row, the record has it in the last column
+			auto transform = mMatrices[node];
+			transform.Transpose();
+
+			auto& record = mCurrent[entry.first + node];
+			std::memcpy(record.worldMatrix, &transform, sizeof(record.worldMatrix));
+			record.material = material;
+			record.flags = flags;
+		}
+
+		entry.material = material;
+		entry.matrices = object->WorldMatrices();
+
+		Queue(entry.first, entry.nodes);
+		++mDirtyObjects;
+	}
+
+	void CDX12InstanceTable::Queue(uint32_t first, uint32_t count)
+	{
+		for (uint32_t record = first; record < first + count; ++record)
+		{
+			for (uint32_t i = 0; i < mFrames.size(); ++i)
+			{
+				const auto bit = static_cast<uint8_t>(1u << i);
+				if (mQueued[record] & bit) continue;
+
+				mQueued[record] |= bit;
+				mFrames[i].dirty.push_back(record);
+			}
+		}
+	}
+
+	bool CDX12InstanceTable::Reserve(uint32_t records)
+	{
+		if (mFrames.front().buffer && records <= mCapacity) return false;
+
+		while (mCapacity < records) mCapacity *= 2;
+
+		const auto size = static_cast<uint64_t>(mCapacity) * sizeof(SInstanceRecord);
+
+		for (uint32_t i = 0; i < mFrames.size(); ++i)
+		{
+			auto& frame = mFrames[i];
+
+			// The frames in flight still read the old buffers, they are kept until the frame fence passes them
+			mEngine->mResourceAllocator->Retire(std::move(frame.buffer));
+
+			frame.buffer = mEngine->mResourceAllocator->CreateBuffer(D3D12_HEAP_TYPE_UPLOAD, size, D3D12_RESOURCE_STATE_GENERIC_READ);
+			SetNameIndexed(frame.buffer.Get(), L"InstanceTable", i);
+
+			// Upload buffers can stay mapped
+			const D3D12_RANGE readRange = { 0, 0 };
+			void* data = nullptr;
+			ThrowIfFailed(frame.buffer->Map(0, &readRange, &data));
+			frame.cpu = static_cast<SInstanceRecord*>(data);
+		}
+
+		return true;
+	}
+}
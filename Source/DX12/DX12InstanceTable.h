@@ -0,0 +1,129 @@
+//--------------------------------------------------------------------------------------
+// Instance table
+//--------------------------------------------------------------------------------------
+// What the PBR draws used to get in a 256 byte constant buffer copied for every node of every
+// object in every pass, as a compact record per node in a structured buffer: the world matrix
+// of the node as a 3x4, the material record of the object (see DX12MaterialTable.h) and flag
+// bits, 56 bytes. The draws only pass the index of their record as a root constant.
+// An object has a range of records, one per node of its mesh, that it keeps while its mesh
+// has the same number of nodes. The records of an object are made dirty when it moves, gets
+// another material record or another mesh; only then are they written again, and queued for
+// the upload buffer of every frame in flight, which gets them when it is recorded next. The
+// game objects hand out references to their matrices, so moves are found by checking the node
+// matrices of each object against the ones its records were written with. Like the material
+// table the buffers are read straight from the upload heap.
+// The depth only and sky pipelines share their vertex shaders with DX11, they keep the per
+// model constants.
+
+#pragma once
+
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include "DX12Common.h"
+#include "../Common/RangeAllocator.h"
+
+class CGameObject;
+
+namespace DX12
+{
+	class CDX12Engine;
+	class CDX12Mesh;
+
+	// Matches SInstance in SimpleShader.hlsl
+	struct SInstanceRecord
+	{
+		enum EFlags : uint32_t
+		{
+			Tangents = 1 << 0, // The mesh has tangents, the normal map can be used
+		};
+
+		float    worldMatrix[3][4] = {}; // Row major, the first three columns of the engine matrix as rows
+		uint32_t material = 0;
+		uint32_t flags    = 0;
+	};
+
+	struct SInstanceTableStats
+	{
+		uint32_t objects      = 0;
+		uint32_t records      = 0;
+		uint32_t freeRecords  = 0;
+		uint32_t dirtyObjects = 0; // In the last update
+		uint64_t tableBytes   = 0; // Of the buffer of a frame, with room to grow
+		uint64_t writtenBytes = 0; // In the last update
+		uint32_t writes       = 0; // Records, in the last update
+	};
+
+	class CDX12InstanceTable
+	{
+	public:
+
+		CDX12InstanceTable() = delete;
+		CDX12InstanceTable(const CDX12InstanceTable&) = delete;
+		CDX12InstanceTable(const CDX12InstanceTable&&) = delete;
+		CDX12InstanceTable& operator=(const CDX12InstanceTable&) = delete;
+		CDX12InstanceTable& operator=(const CDX12InstanceTable&&) = delete;
+
+		explicit CDX12InstanceTable(CDX12Engine* engine, uint32_t capacity = 1024);
+
+		// Gives the records to the new objects and takes them back from the ones that are gone
+		void Sync(const std::deque<CGameObject*>& objects);
+
+		// The record of the first node of the object. Will throw a std::logic_error exception if it was not synced
+		uint32_t Index(CGameObject* object) const;
+
+		// Writes the records of the frame that changed. The material table has to be synced
+		void Update();
+
+		// Sets the records of the frame being recorded to the root parameter
+		void Set(UINT instancesParameter) const;
+
+		SInstanceTableStats Stats() const;
+
+	private:
+
+		static constexpr uint32_t NoMaterial = ~0u;
+
+		struct SObject
+		{
+			CDX12Mesh*              mesh     = nullptr;    // The object can load another mesh
+			uint32_t                first    = 0;
+			uint32_t                nodes    = 0;
+			uint32_t                material = NoMaterial; // What the records were written with
+			std::vector<CMatrix4x4> matrices;              // The node matrices the records were written with, empty until then
+		};
+
+		// Grows the buffers if the records do not fit, returns true if they did not
+		bool Reserve(uint32_t records);
+
+		// Writes the records of the object and queues them for every frame
+		void Write(CGameObject* object, SObject& entry, uint32_t material);
+
+		// Queues the records for every frame that does not have them queued yet
+		void Queue(uint32_t first, uint32_t count);
+
+		CDX12Engine*    mEngine;
+		uint32_t        mCapacity; // Records
+		CRangeAllocator mRecords;
+
+		std::unordered_map<CGameObject*, SObject> mObjects;
+
+		// Mapped upload buffers, one per frame in flight, with the records written since the frame was last recorded
+		struct SFrame
+		{
+			ComPtr<ID3D12Resource> buffer;
+			SInstanceRecord*       cpu = nullptr;
+			std::vector<uint32_t>  dirty;
+		};
+
+		std::vector<SFrame>          mFrames;
+		std::vector<SInstanceRecord> mCurrent;  // The latest records
+		std::vector<uint8_t>         mQueued;   // Per record, a bit per frame it is queued for
+		std::vector<CMatrix4x4>      mMatrices; // Of the nodes of one object
+
+		uint32_t mDirtyObjects = 0;
+		uint64_t mWrittenBytes = 0;
+		uint32_t mWrites       = 0;
+	};
+}
@@ -4,6 +4,7 @@
 #include "CDX12Material.h"
 #include "DX12Engine.h"
 #include "DX12ConstantBuffer.h"
+#include "../Utility/LoadProfiler.h"
 
 namespace DX12
 {
@@ -27,25 +28,17 @@ namespace DX12
 			throw std::runtime_error(e.what());
 		}
 
+		CreateTextureTable();
 
-		std::pair<UINT64, UINT64> dims[6];
-
-		mMaterialCB = std::make_unique<CDX12ConstantBuffer>(mEngine, mMapsDescriptorHeap, sizeof(int) * 12);
-
-		if (mAlbedo)		dims[0] = { mAlbedo->mDesc.Width, mAlbedo->mDesc.Height };
-		if (mNormal)		dims[1] = { mNormal->mDesc.Width, mNormal->mDesc.Height };
-		if (mDisplacement)	dims[2] = { mDisplacement->mDesc.Width, mDisplacement->mDesc.Height };
-		if (mRoughness)		dims[3] = { mRoughness->mDesc.Width, mRoughness->mDesc.Height };
-		if (mMetalness)		dims[4] = { mMetalness->mDesc.Width, mMetalness->mDesc.Height };
-		if (mAo)			dims[5] = { mAo->mDesc.Width, mAo->mDesc.Height };
-
-		mMaterialCB->Copy(dims);
+		CopyMapSizes();
 	}
 
 	CDX12Material::CDX12Material(CDX12Material& m)
 	{
 		mEngine = m.mEngine;
 
+		mMapsDescriptorHeap = m.mMapsDescriptorHeap;
+
 		mHasNormals = false;
 
 		mMapsStr = m.mMapsStr;
@@ -58,13 +51,96 @@ namespace DX12
 		{
 			throw std::runtime_error(e.what());
 		}
+
+		CreateTextureTable();
+
+		CopyMapSizes();
 	}
 
 	CDX12Material::~CDX12Material()
 	{
+		mMapsDescriptorHeap->Remove(mTextureTable, NumMaps);
+		if (mMaterialCB) mMapsDescriptorHeap->Remove(mMaterialCB->mHandle);
 		mMapsDescriptorHeap = nullptr;
 	}
 
+	void CDX12Material::CopyMapSizes()
+	{
+		std::pair<UINT64, UINT64> dims[NumMaps];
+
+		if (mAlbedo)		dims[0] = { mAlbedo->mDesc.Width, mAlbedo->mDesc.Height };
+		if (mNormal)		dims[1] = { mNormal->mDesc.Width, mNormal->mDesc.Height };
+		if (mDisplacement)	dims[2] = { mDisplacement->mDesc.Width, mDisplacement->mDesc.Height };
+		if (mOrm)			dims[3] = { mOrm->mDesc.Width, mOrm->mDesc.Height };
+
+		// The range of the old buffer is freed once the frames in flight are done with it
+		if (mMaterialCB) mMapsDescriptorHeap->Remove(mMaterialCB->mHandle);
+
+		mMaterialCB = std::make_unique<CDX12ConstantBuffer>(mEngine, mMapsDescriptorHeap, sizeof(dims));
+		mMaterialCB->Copy(dims);
+	}
+
+	D3D12_GPU_DESCRIPTOR_HANDLE CDX12Material::TextureTable() const
+	{
+		return mMapsDescriptorHeap->Get(mTextureTable).mGpu;
+	}
+
+	void CDX12Material::CreateTextureTable()
+	{
+		WriteTextureTable();
+
+		// The table has copies of the views, made again when a map is ready or its streamed mips change
+		for (const auto map : { mAlbedo.get(), mNormal.get(), mDisplacement.get(), mOrm.get() })
+		{
+			if (!map) continue;
+
+			map->OnViewChanged([this]()
+			{
+				++mViewChanges;
+
+				WriteTextureTable();
+				CopyMapSizes();
+			});
+		}
+	}
+
+	void CDX12Material::WriteTextureTable()
+	{
+		// The raytracing hit group reads all the maps from one descriptor table, in the order of Hit.hlsl
+		const auto previous = mTextureTable;
+		const auto hadTable = mHasTextureTable;
+
+		mTextureTable = mMapsDescriptorHeap->Add(NumMaps);
+		mHasTextureTable = true;
+
+		CDX12Texture* maps[NumMaps] = { mAlbedo.get(), mNormal.get(), mDisplacement.get(), mOrm.get() };
+
+		for (UINT i = 0; i < NumMaps; ++i)
+		{
+			const auto slot = mMapsDescriptorHeap->Get(mTextureTable + i).mCpu;
+
+			if (maps[i])
+			{
+				mEngine->mDevice->CopyDescriptorsSimple(1, slot, maps[i]->GetHandle().mCpu, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+			}
+			else
+			{
+				// Missing maps still need a valid descriptor
+				D3D12_SHADER_RESOURCE_VIEW_DESC nullDesc = {};
+				nullDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+				nullDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+				nullDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+				nullDesc.Texture2D.MipLevels = 1;
+				mEngine->mDevice->CreateShaderResourceView(nullptr, &nullDesc, slot);
+			}
+		}
+
+		mMapsDescriptorHeap->Commit(mTextureTable, NumMaps);
+
+		// Given back once the frames in flight are done with it
+		if (hadTable) mMapsDescriptorHeap->Remove(previous, NumMaps);
+	}
+
 	void CDX12Material::RenderMaterial() const
 	{
 		// Set textures to the pixel shader
@@ -72,11 +148,9 @@ namespace DX12
 			// different pso will have different root parameter index
 			
 			if (mAlbedo)		mAlbedo->Set( 6);
-			if (mRoughness)		mRoughness->Set( 7);
-			if (mAo)			mAo->Set( 8);
-			if (mDisplacement)	mDisplacement->Set( 9);
-			if (mHasNormals)	mNormal->Set( 10);
-			if (mMetalness)		mMetalness->Set(11);
+			if (mOrm)			mOrm->Set( 7);
+			if (mDisplacement)	mDisplacement->Set( 8);
+			if (mHasNormals)	mNormal->Set( 9);
 		}
 	}
 
@@ -85,16 +159,16 @@ namespace DX12
 		std::vector<void*> r;
 
 		if (mAlbedo)		r.push_back((void*)(mAlbedo->mSrvHeap->Get(mAlbedo->mSrvHandle).mGpu.ptr));
-		if (mRoughness)		r.push_back((void*)(mRoughness->mSrvHeap->Get(mRoughness->mSrvHandle).mGpu.ptr));
-		if (mAo)			r.push_back((void*)(mAo->mSrvHeap->Get(mAo->mSrvHandle).mGpu.ptr));
+		if (mOrm)			r.push_back((void*)(mOrm->mSrvHeap->Get(mOrm->mSrvHandle).mGpu.ptr));
 		if (mDisplacement)	r.push_back((void*)(mDisplacement->mSrvHeap->Get(mDisplacement->mSrvHandle).mGpu.ptr));
 		if (mNormal)		r.push_back((void*)(mNormal->mSrvHeap->Get(mNormal->mSrvHandle).mGpu.ptr));
-		if (mMetalness)		r.push_back((void*)(mMetalness->mSrvHeap->Get(mMetalness->mSrvHandle).mGpu.ptr));
 		return r;
 	}
 
 	void CDX12Material::LoadMaps(std::vector<std::string>& fileMaps)
 	{
+		CLoadScope scope("Material LoadMaps", "material");
+
 		// If the vector is empty
 		if (fileMaps.empty())
 		{
@@ -109,42 +183,44 @@ namespace DX12
 		}
 		else
 		{
+			// Before the textures below put the media folder in front of their names
+			std::vector<std::string> files;
+			for (const auto& fileName : fileMaps) files.push_back(mEngine->GetMediaFolder() + fileName);
+
+			FindOrmMaps(files, mOrmMaps);
+
 			//for each file in the vector with the same name as the mesh one
 			for (std::string& fileName : fileMaps)
 			{
 				////load it
 
-				if (fileName.find("Albedo") != std::string::npos)
+				switch (MaterialMap(fileName))
 				{
+				case EMaterialMap::Albedo:
 					mAlbedo = std::make_unique<CDX12Texture>(mEngine, fileName, mMapsDescriptorHeap);
-				}
-				else if (fileName.find("Roughness") != std::string::npos)
-				{
-					//roughness map
-					mRoughness = std::make_unique<CDX12Texture>(mEngine, fileName, mMapsDescriptorHeap);
-				}
-				else if (fileName.find("AO") != std::string::npos)
-				{
-					//ambient occlusion map
-					mAo = std::make_unique<CDX12Texture>(mEngine, fileName, mMapsDescriptorHeap);
-				}
-				else if (fileName.find("Displacement") != std::string::npos)
-				{
+					break;
+
+				case EMaterialMap::Displacement:
 					//found displacement map
-					mDisplacement = std::make_unique<CDX12Texture>(mEngine, fileName, mMapsDescriptorHeap);
-				}
-				else if (fileName.find("Normal") != std::string::npos)
-				{
+					mDisplacement = std::make_unique<CDX12Texture>(mEngine, fileName, mMapsDescriptorHeap, CDX12Texture::PlaceholderBlack);
+					break;
+
+				case EMaterialMap::Normal:
 					//normal map
-					mNormal = std::make_unique<CDX12Texture>(mEngine, fileName, mMapsDescriptorHeap);
+					mNormal = std::make_unique<CDX12Texture>(mEngine, fileName, mMapsDescriptorHeap, CDX12Texture::PlaceholderFlatNormal);
 
 					mHasNormals = true;
+					break;
+
+				default:
+					// Roughness, AO and metalness are loaded together below
+					break;
 				}
-				else if (fileName.find("Metalness") != std::string::npos)
-				{
-					// Metalness Map
-					mMetalness = std::make_unique<CDX12Texture>(mEngine, fileName, mMapsDescriptorHeap);
-				}
+			}
+
+			if (!mOrmMaps.Empty())
+			{
+				mOrm = std::make_unique<CDX12Texture>(mEngine, mOrmMaps, mMapsDescriptorHeap);
 			}
 		}
 	}
@@ -0,0 +1,227 @@
+#include "DX12MaterialTable.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "CDX12Material.h"
+#include "DX12DescriptorHeap.h"
+#include "DX12Engine.h"
+#include "DX12ResourceAllocator.h"
+#include "DX12Texture.h"
+#include "Objects/DX12GameObject.h"
+
+namespace DX12
+{
+	static_assert(sizeof(SMaterialRecord) == 8 * sizeof(uint32_t));
+	static_assert(CDX12Engine::mNumFrames <= 8, "A byte of queued bits per record");
+
+	namespace
+	{
+		// The views of the other heaps are not in the texture array
+		uint32_t TextureIndex(const CDX12Texture* texture, const CDX12DescriptorHeap* heap)
+		{
+			return texture && texture->mSrvHeap == heap ? texture->mSrvHandle : SMaterialRecord::NoTexture;
+		}
+	}
+
+	CDX12MaterialTable::CDX12MaterialTable(CDX12Engine* engine, uint32_t capacity) :
+		mEngine(engine),
+		mCapacity(std::max(capacity, 1u)),
+		mFrames(CDX12Engine::mNumFrames)
+	{
+	}
+
+	void CDX12MaterialTable::Sync(const std::deque<CGameObject*>& objects)
+	{
+		std::unordered_map<CGameObject*, SObject> synced;
+
+		for (const auto object : objects)
+		{
+			const auto o = dynamic_cast<CDX12GameObject*>(object);
+			if (!o || !o->Material()) continue;
+
+			const auto found = mObjects.find(object);
+			if (found != mObjects.end())
+			{
+				synced.emplace(object, found->second);
+				mObjects.erase(found);
+				continue;
+			}
+
+			// Written by the next update
+			SObject entry;
+			if (!mFree.empty())
+			{
+				entry.record = mFree.back();
+				mFree.pop_back();
+			}
+			else
+			{
+				entry.record = mRecordCount++;
+			}
+
+			synced.emplace(object, entry);
+		}
+
+		// What is left is gone
+		for (const auto& [object, entry] : mObjects) mFree.push_back(entry.record);
+
+		mObjects.swap(synced);
+	}
+
+	uint32_t CDX12MaterialTable::Index(CGameObject* object) const
+	{
+		const auto found = mObjects.find(object);
+		if (found == mObjects.end()) throw std::logic_error("Material index of an object without a material record");
+
+		return found->second.record;
+	}
+
+	void CDX12MaterialTable::Update()
+	{
+		// The free records are never read, they keep whatever they had
+		if (mCurrent.size() < mRecordCount)
+		{
+			mCurrent.resize(mRecordCount);
+			mQueued.resize(mRecordCount, 0);
+		}
+
+		// New buffers have none of the records
+		if (Reserve(mRecordCount))
+		{
+			for (const auto& [object, entry] : mObjects) Queue(entry.record);
+		}
+
+		mDirtyRecords = 0;
+
+		for (auto& [object, entry] : mObjects)
+		{
+			const auto o = dynamic_cast<CDX12GameObject*>(object);
+			const auto material = o->Material();
+
+			const auto dirty = !entry.written ||
+				entry.material != material ||
+				entry.viewChanges != material->ViewChanges() ||
+				entry.roughness != o->Roughness() ||
+				entry.metalness != o->Metalness() ||
+				entry.parallaxDepth != o->ParallaxDepth();
+			if (!dirty) continue;
+
+			Write(o, entry);
+		}
+
+		// The buffer of the frame is not read by the frames in flight
+		const auto frameIndex = mEngine->mCurrentBackBufferIndex;
+		auto& frame = mFrames[frameIndex];
+
+		for (const auto record : frame.dirty)
+		{
+			frame.cpu[record] = mCurrent[record];
+			mQueued[record] &= static_cast<uint8_t>(~(1u << frameIndex));
+		}
+
+		mWrites = static_cast<uint32_t>(frame.dirty.size());
+		mWrittenBytes = static_cast<uint64_t>(mWrites) * sizeof(SMaterialRecord);
+
+		frame.dirty.clear();
+	}
+
+	void CDX12MaterialTable::Write(CDX12GameObject* object, SObject& entry)
+	{
+		const auto heap = mEngine->mSRVDescriptorHeap.get();
+		const auto material = object->Material();
+		const auto& orm = material->OrmMaps();
+
+		auto& record = mCurrent[entry.record];
+		record = SMaterialRecord{};
+		record.albedo = TextureIndex(material->mAlbedo.get(), heap);
+		record.orm = TextureIndex(material->mOrm.get(), heap);
+		record.displacement = TextureIndex(material->mDisplacement.get(), heap);
+		record.normal = TextureIndex(material->mNormal.get(), heap);
+
+		if (record.albedo != SMaterialRecord::NoTexture)       record.flags |= SMaterialRecord::HasAlbedo;
+		if (record.normal != SMaterialRecord::NoTexture)       record.flags |= SMaterialRecord::HasNormal;
+		if (record.displacement != SMaterialRecord::NoTexture) record.flags |= SMaterialRecord::HasDisplacement;
+		if (record.orm != SMaterialRecord::NoTexture)
+		{
+			if (orm.HasAo())        record.flags |= SMaterialRecord::HasAo;
+			if (orm.HasRoughness()) record.flags |= SMaterialRecord::HasRoughness;
+			if (orm.HasMetalness()) record.flags |= SMaterialRecord::HasMetalness;
+		}
+
+		record.roughness = object->Roughness();
+		record.metalness = object->Metalness();
+		record.parallaxDepth = object->ParallaxDepth();
+
+		entry.written = true;
+		entry.material = material;
+		entry.viewChanges = material->ViewChanges();
+		entry.roughness = record.roughness;
+		entry.metalness = record.metalness;
+		entry.parallaxDepth = record.parallaxDepth;
+
+		Queue(entry.record);
+		++mDirtyRecords;
+	}
+
+	void CDX12MaterialTable::Queue(uint32_t record)
+	{
+		for (uint32_t i = 0; i < mFrames.size(); ++i)
+		{
+			const auto bit = static_cast<uint8_t>(1u << i);
+			if (mQueued[record] & bit) continue;
+
+			mQueued[record] |= bit;
+			mFrames[i].dirty.push_back(record);
+		}
+	}
+
+	void CDX12MaterialTable::Set(UINT texturesParameter, UINT materialsParameter) const
+	{
+		const auto commandList = mEngine->mCurrRecordingCommandList;
+
+		// The whole heap, a texture is found by the index of its view
+		commandList->SetGraphicsRootDescriptorTable(texturesParameter, mEngine->mSRVDescriptorHeap->Get(0).mGpu);
+		commandList->SetGraphicsRootShaderResourceView(materialsParameter, mFrames[mEngine->mCurrentBackBufferIndex].buffer->GetGPUVirtualAddress());
+	}
+
+	SMaterialTableStats CDX12MaterialTable::Stats() const
+	{
+		SMaterialTableStats stats;
+		stats.objects = static_cast<uint32_t>(mObjects.size());
+		stats.freeRecords = static_cast<uint32_t>(mFree.size());
+		stats.dirtyRecords = mDirtyRecords;
+		stats.tableBytes = static_cast<uint64_t>(mCapacity) * sizeof(SMaterialRecord);
+		stats.writtenBytes = mWrittenBytes;
+		stats.writes = mWrites;
+		return stats;
+	}
+
+	bool CDX12MaterialTable::Reserve(uint32_t records)
+	{
+		if (mFrames.front().buffer && records <= mCapacity) return false;
+
+		while (mCapacity < records) mCapacity *= 2;
+
+		const auto size = static_cast<uint64_t>(mCapacity) * sizeof(SMaterialRecord);
+
+		for (uint32_t i = 0; i < mFrames.size(); ++i)
+		{
+			auto& frame = mFrames[i];
+
+			// The frames in flight still read the old buffers, they are kept until the frame fence passes them
+			mEngine->mResourceAllocator->Retire(std::move(frame.buffer));
+
+			frame.buffer = mEngine->mResourceAllocator->CreateBuffer(D3D12_HEAP_TYPE_UPLOAD, size, D3D12_RESOURCE_STATE_GENERIC_READ);
+			SetNameIndexed(frame.buffer.Get(), L"MaterialTable", i);
+
+			// Upload buffers can stay mapped
+			const D3D12_RANGE readRange = { 0, 0 };
+			void* data = nullptr;
+			ThrowIfFailed(frame.buffer->Map(0, &readRange, &data));
+			frame.cpu = static_cast<SMaterialRecord*>(data);
+		}
+
+		return true;
+	}
+}
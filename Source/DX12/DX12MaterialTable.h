@@ -0,0 +1,140 @@
+//--------------------------------------------------------------------------------------
+// Bindless material table
+//--------------------------------------------------------------------------------------
+// The PBR shaders see every view of the shader visible heap as one unbounded texture array
+// and read the material of a draw from a structured buffer: a record per object with the
+// heap indices of its maps and its scalar parameters (roughness, metalness, parallax depth).
+// The draws find the index of their record in their instance record (see DX12InstanceTable.h),
+// nothing is bound per object. A texture that is replaced gets its view in a new slot of the heap (the frames
+// in flight keep reading the old one), so the records change with the objects, their materials and their views.
+// A record is dirty when its object gets another material, its material gets new views of its
+// maps (CDX12Material counts the OnViewChanged callbacks of its textures) or the scalar
+// parameters of the object change. Only then is it written again, and queued for the upload
+// buffer of every frame in flight, which gets it when it is recorded next. The buffers are
+// read straight from the upload heap, the command lists recorded on the worker threads run
+// before the main list could copy anything to a default heap table.
+
+#pragma once
+
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include "DX12Common.h"
+
+class CGameObject;
+
+namespace DX12
+{
+	class CDX12Engine;
+	class CDX12GameObject;
+	class CDX12Material;
+
+	// Matches SMaterial in SimpleShader.hlsl
+	struct SMaterialRecord
+	{
+		static constexpr uint32_t NoTexture = ~0u;
+
+		enum EFlags : uint32_t
+		{
+			HasAlbedo       = 1 << 0,
+			HasNormal       = 1 << 1,
+			HasDisplacement = 1 << 2,
+			HasAo           = 1 << 3,
+			HasRoughness    = 1 << 4,
+			HasMetalness    = 1 << 5,
+		};
+
+		uint32_t albedo        = NoTexture;
+		uint32_t normal        = NoTexture;
+		uint32_t displacement  = NoTexture;
+		uint32_t orm           = NoTexture;
+		uint32_t flags         = 0;
+		float    roughness     = 0;
+		float    metalness     = 0;
+		float    parallaxDepth = 0;
+	};
+
+	struct SMaterialTableStats
+	{
+		uint32_t objects      = 0;
+		uint32_t freeRecords  = 0;
+		uint32_t dirtyRecords = 0; // In the last update
+		uint64_t tableBytes   = 0; // Of the buffer of a frame, with room to grow
+		uint64_t writtenBytes = 0; // In the last update
+		uint32_t writes       = 0; // Records, in the last update
+	};
+
+	class CDX12MaterialTable
+	{
+	public:
+
+		CDX12MaterialTable() = delete;
+		CDX12MaterialTable(const CDX12MaterialTable&) = delete;
+		CDX12MaterialTable(const CDX12MaterialTable&&) = delete;
+		CDX12MaterialTable& operator=(const CDX12MaterialTable&) = delete;
+		CDX12MaterialTable& operator=(const CDX12MaterialTable&&) = delete;
+
+		explicit CDX12MaterialTable(CDX12Engine* engine, uint32_t capacity = 256);
+
+		// Gives the records to the new objects and takes them back from the ones that are gone
+		void Sync(const std::deque<CGameObject*>& objects);
+
+		// The record of the object. Will throw a std::logic_error exception if it was not synced
+		uint32_t Index(CGameObject* object) const;
+
+		// Writes the records of the frame that changed
+		void Update();
+
+		// Sets the texture array and the records of the frame being recorded to the root parameters
+		void Set(UINT texturesParameter, UINT materialsParameter) const;
+
+		SMaterialTableStats Stats() const;
+
+	private:
+
+		// What the record of an object was written with
+		struct SObject
+		{
+			uint32_t             record        = 0;
+			bool                 written       = false;
+			const CDX12Material* material      = nullptr;
+			uint64_t             viewChanges   = 0;
+			float                roughness     = 0;
+			float                metalness     = 0;
+			float                parallaxDepth = 0;
+		};
+
+		// Grows the buffers if the records do not fit, returns true if they did not
+		bool Reserve(uint32_t records);
+
+		// Writes the record of the object and queues it for every frame
+		void Write(CDX12GameObject* object, SObject& entry);
+
+		// Queues the record for every frame that does not have it queued yet
+		void Queue(uint32_t record);
+
+		CDX12Engine* mEngine;
+		uint32_t     mCapacity; // Records
+
+		std::unordered_map<CGameObject*, SObject> mObjects;
+		std::vector<uint32_t>                     mFree;
+		uint32_t                                  mRecordCount = 0; // Given out, free ones included
+
+		// Mapped upload buffers, one per frame in flight, with the records written since the frame was last recorded
+		struct SFrame
+		{
+			ComPtr<ID3D12Resource> buffer;
+			SMaterialRecord*       cpu = nullptr;
+			std::vector<uint32_t>  dirty;
+		};
+
+		std::vector<SFrame>          mFrames;
+		std::vector<SMaterialRecord> mCurrent; // The latest records
+		std::vector<uint8_t>         mQueued;  // Per record, a bit per frame it is queued for
+
+		uint32_t mDirtyRecords = 0;
+		uint64_t mWrittenBytes = 0;
+		uint32_t mWrites       = 0;
+	};
+}
@@ -2,6 +2,7 @@
 
 #include "DX12Common.h"
 
+#include <algorithm>
 
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
@@ -10,27 +11,16 @@
 
 #include "DX12ConstantBuffer.h"
 #include "DX12Engine.h"
+#include "DX12UploadAllocator.h"
+#include "DX12UploadQueue.h"
 #include "DXR/DXR.h"
+#include "../Common/AssetCache.h"
+#include "../Utility/LoadProfiler.h"
 
 namespace DX12
 {
-	CDX12Mesh::CDX12Mesh(const CDX12Mesh& other) : CDX12Mesh(other.mEngine, other.mFileName, other.hasTangents) {}
-
-	CDX12Mesh::CDX12Mesh(CDX12Engine* engine,
-		std::string fileName,
-		bool requireTangents)
+	SMeshImportSettings CDX12Mesh::ImportSettings()
 	{
-		mEngine = engine;
-
-		fileName = mEngine->GetMediaFolder() + fileName;
-
-		mFileName = fileName;
-
-		hasTangents = requireTangents;
-
-
-		Assimp::Importer importer;
-
 		// Flags for processing the mesh. Assimp provides a huge amount of control - right click any of these
 		// and "Peek Definition" to see documention above each constant
 		unsigned int assimpFlags = aiProcess_MakeLeftHanded |
@@ -52,42 +42,45 @@ namespace DX12
 			aiProcess_Debone |
 			aiProcess_SplitByBoneCount |
 			aiProcess_LimitBoneWeights |
-			aiProcess_RemoveComponent;
+			aiProcess_RemoveComponent |
+			aiProcess_CalcTangentSpace;
 
 		// Flags to specify what mesh data to ignore
+		// Tangents are always calculated so the same import serves meshes with and without normal maps
 		auto removeComponents = aiComponent_LIGHTS | aiComponent_CAMERAS | aiComponent_COLORS |
 			aiComponent_ANIMATIONS;
 
-		// Add / remove tangents as required by user
-		if (hasTangents)
-		{
-			assimpFlags |= aiProcess_CalcTangentSpace;
-		}
-		else
-		{
-			removeComponents |= aiComponent_TANGENTS_AND_BITANGENTS;
-		}
+		return { assimpFlags, removeComponents };
+	}
+
+	CDX12Mesh::CDX12Mesh(const CDX12Mesh& other) : CDX12Mesh(other.mEngine, other.mFileName, other.hasTangents, other.mKeepGeometry) {}
 
-		// Other miscellaneous settings
-		importer.SetPropertyFloat(AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE, 80.0f); // Smoothing angle for normals
-		importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);  // Remove points and lines (keep triangles only)
-		importer.SetPropertyBool(AI_CONFIG_PP_FD_REMOVE, true);                 // Remove degenerate triangles
-		importer.SetPropertyBool(AI_CONFIG_PP_DB_ALL_OR_NONE, true);            // Default to removing bones/weights from meshes that don't need skinning
+	CDX12Mesh::~CDX12Mesh()
+	{
+		for (const auto& subMesh : mSubMeshes) mEngine->mGeometryArena->Remove(subMesh.geometry);
+	}
+
+	CDX12Mesh::CDX12Mesh(CDX12Engine* engine,
+		std::string fileName,
+		bool requireTangents,
+		bool keepGeometry)
+	{
+		mEngine = engine;
 
-		// Set maximum bones that can affect one vertex, and also maximum bones affecting a single mesh
-		unsigned int maxBonesPerVertex = 4; // The shaders support 4 bones per verted (null bones are added if necessary)
-		unsigned int maxBonesPerMesh = 256; // Bone indexes are stored in a byte, so no more than 256
-		importer.SetPropertyInteger(AI_CONFIG_PP_LBW_MAX_WEIGHTS, maxBonesPerVertex);
-		importer.SetPropertyInteger(AI_CONFIG_PP_SBBC_MAX_BONES, maxBonesPerMesh);
+		fileName = mEngine->GetMediaFolder() + fileName;
 
-		importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, removeComponents);
+		mFileName = fileName;
 
-		// Import mesh with assimp given above requirements - log output
-		Assimp::DefaultLogger::create("", Assimp::DefaultLogger::VERBOSE);
-		auto scene = importer.ReadFile(fileName, assimpFlags);
-		Assimp::DefaultLogger::kill();
-		if (scene == nullptr)  throw std::runtime_error("Error loading mesh (" + fileName + "). " + importer.GetErrorString());
-		if (scene->mNumMeshes == 0)  throw std::runtime_error("No usable geometry in mesh: " + fileName);
+		hasTangents = requireTangents;
+
+		mKeepGeometry = keepGeometry;
+
+
+		// The scene loader imports meshes ahead of time on worker threads, anything else is imported here
+		CLoadScope importScope("Mesh Import", "mesh", fileName);
+		const auto importer = CAssetCache::Instance().Mesh(fileName, ImportSettings());
+		const auto scene = importer->GetScene();
+		importScope.End();
 
 		//-----------------------------------
 
@@ -106,10 +99,12 @@ namespace DX12
 			if (scene->mMeshes[m]->HasBones())  mHasBones = true;
 
 		// A mesh is made of sub-meshes, each one can have a different material (texture)
-		// Import each sub-mesh in the file to seperate index / vertex buffer (could share buffers between sub-meshes but that would make things more complex)
+		// Each sub-mesh is interleaved on its own, then sub-allocated from the shared vertex / index pools of the geometry arena
 		mSubMeshes.resize(scene->mNumMeshes);
 		for (unsigned int m = 0; m < scene->mNumMeshes; ++m)
 		{
+			CLoadScope interleaveScope("Mesh Interleave", "mesh", fileName);
+
 			auto assimpMesh = scene->mMeshes[m];
 			std::string subMeshName = assimpMesh->mName.C_Str();
 			auto& subMesh = mSubMeshes[m]; // Short name for the submesh we're currently preparing - makes code below more readable
@@ -165,6 +160,7 @@ namespace DX12
 			while (position != positionEnd)
 			{
 				*(CVector3*)position = *assimpPosition;
+				mBoundingRadius = std::max(mBoundingRadius, Length(*assimpPosition));
 				position += subMesh.vertexSize;
 				++assimpPosition;
 			}
@@ -218,106 +214,76 @@ namespace DX12
 				*index++ = assimpMesh->mFaces[face].mIndices[2];
 			}
 
+			interleaveScope.End();
+
 			//-----------------------------------
 			//
 			// DirectX Stuff
 			//
 			//-----------------------------------
 
-			auto hProp = DXR::kUploadHeapProps;
-			auto buffer = CD3DX12_RESOURCE_DESC::Buffer(subMesh.vertexSize * subMesh.numVertices);
+			CLoadScope buffersScope("Mesh Buffers", "mesh", fileName);
 
+			// The pools live on the default heap, the copy queue fills the ranges in the background and the
+			// queues drawing or building acceleration structures wait for it (see CDX12UploadQueue)
 			std::unique_lock l(mEngine->mMutex);
-			ThrowIfFailed(mEngine->mDevice->CreateCommittedResource(
-				&hProp,
-				D3D12_HEAP_FLAG_NONE,
-				&buffer,
-				D3D12_RESOURCE_STATE_GENERIC_READ,
-				nullptr,
-				IID_PPV_ARGS(&subMesh.mVertexBuffer)));
-			NAME_D3D12_OBJECT(subMesh.mVertexBuffer);
-
-			// Copy the data to the vertex buffer.
-			UINT8* pVertexDataBegin;
-			CD3DX12_RANGE readRange(0, 0); // We do not intend to read from this resource on the CPU.
-
-			ThrowIfFailed(subMesh.mVertexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin)));
-			memcpy(pVertexDataBegin, subMesh.vertices.get(), subMesh.numVertices * subMesh.vertexSize);
-			subMesh.mVertexBuffer->Unmap(0, nullptr);
-
-			// Initialize the vertex buffer view.
-			subMesh.mVertexBufferView.BufferLocation = subMesh.mVertexBuffer->GetGPUVirtualAddress();
-			subMesh.mVertexBufferView.StrideInBytes = subMesh.vertexSize;
-			subMesh.mVertexBufferView.SizeInBytes = subMesh.vertexSize * subMesh.numVertices;
-
-			// Index Buffer
-			buffer = CD3DX12_RESOURCE_DESC::Buffer(subMesh.numIndices * sizeof(uint32_t));
-
-			ThrowIfFailed(mEngine->mDevice->CreateCommittedResource(
-				&hProp,
-				D3D12_HEAP_FLAG_NONE,
-				&buffer,
-				D3D12_RESOURCE_STATE_GENERIC_READ,
-				nullptr,
-				IID_PPV_ARGS(&subMesh.mIndexBuffer)));
-			NAME_D3D12_OBJECT(subMesh.mIndexBuffer);
-
-			// Copy the data to the index buffer.
-			UINT8* pIndexDataBegin;
-			ThrowIfFailed(subMesh.mIndexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pIndexDataBegin)));
-			memcpy(pIndexDataBegin, subMesh.indices.get(), subMesh.numIndices * sizeof(uint32_t));
-			subMesh.mIndexBuffer->Unmap(0, nullptr);
-
-			// Initialize the index buffer view.
-			subMesh.indexBufferView.BufferLocation = subMesh.mIndexBuffer->GetGPUVirtualAddress();
-			subMesh.indexBufferView.SizeInBytes = sizeof(uint32_t) * subMesh.numIndices;
-			subMesh.indexBufferView.Format = DXGI_FORMAT_R32_UINT;
+			subMesh.geometry = mEngine->mGeometryArena->Add(subMesh.vertexSize, subMesh.vertices.get(), subMesh.numVertices,
+				reinterpret_cast<const uint32_t*>(subMesh.indices.get()), subMesh.numIndices);
+
+			// The data is in the staging ring now, the CPU copies are only kept for whoever asked for them
+			if (!mKeepGeometry)
+			{
+				subMesh.vertices.reset();
+				subMesh.indices.reset();
+			}
 
 			// Create the mesh constant buffer
 			subMesh.matrixCB = std::make_unique<CDX12ConstantBuffer>(mEngine, mEngine->mSRVDescriptorHeap.get(), sizeof(CMatrix4x4));
 		}
-		
-
-		// Create the model constant buffer.
-		{
-			constexpr UINT constantBufferSize = sizeof(PerModelConstants); // CB size is required to be 256-byte aligned.
-
-			mModelConstantBuffer = std::make_unique<CDX12ConstantBuffer>(mEngine, mEngine->mSRVDescriptorHeap.get(), constantBufferSize);
-			mModelConstantBuffer->Copy(mModelConstants);
-		}
 	}
 
-	void CDX12Mesh::Render(std::vector<CMatrix4x4>& modelMatrices)
+	void CDX12Mesh::Render(std::vector<CMatrix4x4>& modelMatrices, const PerModelConstants& modelConstants)
 	{
 		// Skinning needs all matrices available in the shader at the same time, so first calculate all the absolute
 		// matrices before rendering anything
-		std::vector<CMatrix4x4> absoluteMatrices(modelMatrices.size());
-		absoluteMatrices[0] = modelMatrices[0]; // First matrix for a model is the root matrix, already in world space
-		for (unsigned int nodeIndex = 1; nodeIndex < mNodes.size(); ++nodeIndex)
-		{
-			// Multiply each model matrix by its parent's absolute world matrix (already calculated earlier in this loop)
-			// Same process as for rigid bodies, simply done prior to rendering now
-			absoluteMatrices[nodeIndex] = modelMatrices[nodeIndex] * absoluteMatrices[mNodes[nodeIndex].parentIndex];
-		}
+		std::vector<CMatrix4x4> absoluteMatrices;
+		AbsoluteMatrices(modelMatrices, absoluteMatrices);
 
 		// Render a mesh without skinning. Although slightly reorganised to use the matrices calculated
 		// above, this is basically the same code as the rigid body animation lab
+		auto nodeConstants = modelConstants;
+
 		// Iterate through each node
 		for (unsigned int nodeIndex = 0; nodeIndex < mNodes.size(); ++nodeIndex)
 		{
 			// Send this node's matrix to the GPU via a constant buffer
-			mModelConstants.worldMatrix = absoluteMatrices[nodeIndex];
-			mModelConstants.objectColour = CVector3(1.f, 1.f, 1.f);
-			mModelConstants.hasNormalMap = hasTangents;
+			nodeConstants.worldMatrix = absoluteMatrices[nodeIndex];
+			nodeConstants.objectColour = CVector3(1.f, 1.f, 1.f);
 
-			mModelConstantBuffer->Copy(mModelConstants);
+			// Every node gets its own copy in the frame upload memory, so the GPU reads the constants of
+			// this draw and not whatever the last node wrote
+			const auto constants = mEngine->mUploadAllocator->Copy(nodeConstants);
+			mEngine->mCurrRecordingCommandList->SetGraphicsRootConstantBufferView(0, constants);
 
-			// Set the model constant buffer heap and set the correct root parameter to pass to the vertex shader
+			// Render the sub-meshes attached to this node (no bones - rigid movement)
+			for (const auto& subMeshIndex : mNodes[nodeIndex].subMeshes)
 			{
-				mModelConstantBuffer->Set(0);
+				RenderSubMesh(mSubMeshes[subMeshIndex]);
 			}
+		}
+	}
+
+	void CDX12Mesh::RenderInstances(uint32_t firstInstance) const
+	{
+		const auto commandList = mEngine->mCurrRecordingCommandList;
+
+		for (unsigned int nodeIndex = 0; nodeIndex < mNodes.size(); ++nodeIndex)
+		{
+			if (mNodes[nodeIndex].subMeshes.empty()) continue;
+
+			// The matrix and the material are in the record, nothing is copied
+			commandList->SetGraphicsRoot32BitConstant(0, firstInstance + nodeIndex, 0);
 
-			// Render the sub-meshes attached to this node (no bones - rigid movement)
 			for (const auto& subMeshIndex : mNodes[nodeIndex].subMeshes)
 			{
 				RenderSubMesh(mSubMeshes[subMeshIndex]);
@@ -325,6 +291,18 @@ namespace DX12
 		}
 	}
 
+	void CDX12Mesh::AbsoluteMatrices(const std::vector<CMatrix4x4>& modelMatrices, std::vector<CMatrix4x4>& absoluteMatrices) const
+	{
+		absoluteMatrices.resize(modelMatrices.size());
+		absoluteMatrices[0] = modelMatrices[0]; // First matrix for a model is the root matrix, already in world space
+		for (unsigned int nodeIndex = 1; nodeIndex < mNodes.size(); ++nodeIndex)
+		{
+			// Multiply each model matrix by its parent's absolute world matrix (already calculated earlier in this loop)
+			// Same process as for rigid bodies, simply done prior to rendering now
+			absoluteMatrices[nodeIndex] = modelMatrices[nodeIndex] * absoluteMatrices[mNodes[nodeIndex].parentIndex];
+		}
+	}
+
 	unsigned CDX12Mesh::CountNodes(aiNode* assimpNode)
 	{
 		unsigned int count = 1;
@@ -363,19 +341,8 @@ namespace DX12
 
 	void CDX12Mesh::RenderSubMesh(const SubMesh& subMesh) const
 	{
-		auto commandList = mEngine->mCurrRecordingCommandList;
-
-		// Set vertex buffer as next data source for GPU
-		commandList->IASetVertexBuffers(0, 1, &subMesh.mVertexBufferView);
-
-		// Set index buffer as next data source for GPU, indicate it uses 32-bit integers
-		commandList->IASetIndexBuffer(&subMesh.indexBufferView);
-
-		// Using triangle lists only in this class
-		commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-		// Render mesh
-		commandList->DrawIndexedInstanced(subMesh.numIndices, 1, 0, 0, 0);
+		// The pool buffers are only set when the previous draw on the command list used another pool
+		mEngine->mGeometryArena->Draw(mEngine->mCurrRecordingCommandList, subMesh.geometry);
 	}
 
 }
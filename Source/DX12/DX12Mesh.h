@@ -10,8 +10,10 @@
 #include "DX12Common.h"
 
 #include "DX12ConstantBuffer.h"
+#include "DX12GeometryArena.h"
 
 struct aiNode;
+struct SMeshImportSettings;
 
 namespace DX12
 {
@@ -26,22 +28,20 @@ namespace DX12
 		//--------------------------------------------------------------------------------------
 
 		// A mesh is made of multiple sub-meshes. Each one uses a single material (texture).
-		// Each sub-mesh has a vertex / index buffer on the GPU. Could share buffers for performance but that would be complex.
+		// Each sub-mesh has a range of the vertex / index pools of its vertex layout on the GPU (see CDX12GeometryArena).
 		struct SubMesh
 		{
 			uint32_t       vertexSize = 0;         // Size in bytes of a single vertex (depends on what it contains, uvs, tangents etc.)
 
-			//// GPU-side vertex and index buffers
 			uint32_t       numVertices = 0;
 
 			uint32_t                         numIndices;
-			ComPtr<ID3D12Resource>           mIndexBuffer;
-			D3D12_INDEX_BUFFER_VIEW          indexBufferView;
-			std::unique_ptr<unsigned char[]> indices;
+			std::unique_ptr<unsigned char[]> indices;  // Released after the upload unless the mesh keeps its geometry
 
-			ComPtr<ID3D12Resource> mVertexBuffer;
-			D3D12_VERTEX_BUFFER_VIEW mVertexBufferView;
-			std::unique_ptr<unsigned char[]> vertices;
+			std::unique_ptr<unsigned char[]> vertices; // Released after the upload unless the mesh keeps its geometry
+
+			// GPU-side vertices and indices, in the shared pools
+			SDX12Geometry geometry;
 
 			std::unique_ptr<CDX12ConstantBuffer> matrixCB; // Constant buffer that holds the matrix of this object
 
@@ -79,11 +79,18 @@ namespace DX12
 
 		// Pass the name of the mesh file to load. Uses assimp (http://www.assimp.org/) to support many file types
 		// Optionally request tangents to be calculated (for normal and parallax mapping - see later lab)
+		// Optionally keep the CPU-side vertices and indices after the upload (for CPU raytracing or picking)
 		// Will throw a std::runtime_error exception on failure (since constructors can't return errors).
-		CDX12Mesh(CDX12Engine* engine, std::string fileName, bool requireTangents = false);
+		CDX12Mesh(CDX12Engine* engine, std::string fileName, bool requireTangents = false, bool keepGeometry = false);
 
 		CDX12Mesh(const CDX12Mesh&);
 
+		// The ranges of the sub-meshes go back to the arena once the frames in flight are done with them
+		~CDX12Mesh();
+
+		// Assimp settings every DX12 mesh is imported with
+		static SMeshImportSettings ImportSettings();
+
 		// How many nodes are in the hierarchy for this mesh. Nodes can control individual parts (rigid body animation),
 		// or bones (skinned animation), or they can be dummy nodes to create child parts in a more convenient way
 		unsigned int NumberNodes() const { return static_cast<unsigned int>(mNodes.size()); }
@@ -94,11 +101,18 @@ namespace DX12
 		// Render the mesh with the given matrices
 		// Handles rigid body meshes (including single part meshes) as well as skinned meshes
 		// LIMITATION: The mesh must use a single texture throughout
-		void Render(std::vector<CMatrix4x4>& modelMatrices);
+		// The constants are the caller's, so the same mesh can be recorded by several threads at once
+		void Render(std::vector<CMatrix4x4>& modelMatrices, const PerModelConstants& modelConstants);
+
+		// Render the mesh with the records of the instance table from the first one, one per node
+		void RenderInstances(uint32_t firstInstance) const;
+
+		// The world matrix of every node from the matrices relative to their parents
+		void AbsoluteMatrices(const std::vector<CMatrix4x4>& modelMatrices, std::vector<CMatrix4x4>& absoluteMatrices) const;
 
 		std::string MeshFileName() const { return mFileName; }
 
-		auto& ModelConstants() { return mModelConstants; }
+		const auto& ModelConstants() const { return mModelConstants; }
 
 		//--------------------------------------------------------------------------------------
 		// Private helper functions
@@ -125,14 +139,16 @@ namespace DX12
 
 		std::string mFileName;			//store the filename for the copy constructor
 		bool hasTangents;			//store if the mesh has tangents, same reason for above
+		bool mKeepGeometry;			//store if the CPU-side geometry is kept, same reason for above
 
 		std::vector<SubMesh> mSubMeshes; // The mesh geometry. Nodes refer to sub-meshes in this vector
 		std::vector<Node>    mNodes;     // The mesh hierarchy. First entry is root. remainder aree stored in depth-first order
 
 		bool mHasBones; // If any submesh has bones, then all submeshes are given bones - makes rendering easier (one shader for the whole mesh)
 
-		std::unique_ptr<CDX12ConstantBuffer> mModelConstantBuffer;
+		float mBoundingRadius = 0.0f; // Of a sphere around the origin of the mesh holding every vertex, ignoring the node matrices
 
+		// Defaults the objects start their constants from
 		PerModelConstants  mModelConstants;
 	};
 }
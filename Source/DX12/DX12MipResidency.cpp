@@ -0,0 +1,337 @@
+#include "DX12MipResidency.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace DX12
+{
+	uint32_t MipForScreenSize(uint32_t width, uint32_t mips, float pixels, float bias)
+	{
+		if (mips == 0) return 0;
+
+		// Nothing on the screen needs only the smallest mip
+		if (!(pixels > 0.0f)) return mips - 1;
+
+		// One texel per pixel
+		const auto level = std::log2(static_cast<float>(width) / pixels) + bias;
+		if (level <= 0.0f) return 0;
+
+		return std::min(static_cast<uint32_t>(level), mips - 1);
+	}
+
+	float ProjectedPixels(float radius, float distance, float fovX, float viewportWidth)
+	{
+		// The camera is inside the sphere
+		if (distance <= radius) return std::numeric_limits<float>::max();
+
+		// The diameter over the width of the view at that distance
+		return radius / (distance * std::tan(fovX * 0.5f)) * viewportWidth;
+	}
+
+	namespace
+	{
+		constexpr size_t   DdsPixelFlags     = 80; // Offsets of the pixel format flags and four CC in the file
+		constexpr size_t   DdsPixelFourCC    = 84;
+		constexpr uint32_t DdsFourCCFlag     = 0x4;
+		constexpr uint32_t DdsDx10FourCC     = 'D' | ('X' << 8) | ('1' << 16) | ('0' << 24);
+
+		uint32_t ReadUint32(const uint8_t* bytes)
+		{
+			return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+		}
+	}
+
+	size_t DdsDataOffset(const uint8_t* header)
+	{
+		const auto pixelFlags = ReadUint32(header + DdsPixelFlags);
+		const auto fourCC = ReadUint32(header + DdsPixelFourCC);
+
+		return DdsHeaderSize + ((pixelFlags & DdsFourCCFlag) && fourCC == DdsDx10FourCC ? DdsHeaderDx10Size : 0);
+	}
+
+	std::vector<size_t> MipOffsets(size_t dataOffset, const std::vector<uint64_t>& mipBytes)
+	{
+		std::vector<size_t> offsets;
+		offsets.reserve(mipBytes.size() + 1);
+
+		auto offset = dataOffset;
+		for (const auto bytes : mipBytes)
+		{
+			offsets.push_back(offset);
+			offset += static_cast<size_t>(bytes);
+		}
+		offsets.push_back(offset);
+
+		return offsets;
+	}
+
+	uint32_t TailMip(size_t width, size_t height, uint32_t mips, uint32_t tailSize)
+	{
+		if (mips == 0) return 0;
+
+		auto tail = mips - 1;
+		while (tail > 0 && std::max(MipExtent(width, tail - 1), MipExtent(height, tail - 1)) <= tailSize) --tail;
+		return tail;
+	}
+
+	bool WholeBlocks(size_t width, size_t height, uint32_t lastMip)
+	{
+		for (uint32_t mip = 0; mip <= lastMip; ++mip)
+		{
+			if (MipExtent(width, mip) % 4 || MipExtent(height, mip) % 4) return false;
+		}
+		return true;
+	}
+
+	CDX12MipResidency::CDX12MipResidency(uint64_t budget, uint32_t maxChanges) :
+		mBudget(budget),
+		mMaxChanges(std::max(maxChanges, 1u))
+	{
+	}
+
+	uint32_t CDX12MipResidency::Add(std::vector<uint64_t> mipBytes, uint32_t tail)
+	{
+		if (tail >= mipBytes.size()) throw std::logic_error("Mip tail outside of the texture");
+
+		uint32_t texture;
+		if (!mFree.empty())
+		{
+			texture = mFree.back();
+			mFree.pop_back();
+		}
+		else
+		{
+			texture = static_cast<uint32_t>(mTextures.size());
+			mTextures.emplace_back();
+		}
+
+		auto& t = mTextures[texture];
+		t.fromMip.assign(mipBytes.size() + 1, 0);
+		for (auto mip = mipBytes.size(); mip-- > 0;) t.fromMip[mip] = t.fromMip[mip + 1] + mipBytes[mip];
+
+		t.mipBytes = std::move(mipBytes);
+		t.tail = tail;
+		t.resident = tail;
+		t.pending = tail;
+		t.requested = tail;
+		t.lastSeen = 0;
+
+		mCommitted += Committed(t);
+		return texture;
+	}
+
+	void CDX12MipResidency::Remove(uint32_t texture)
+	{
+		if (!Live(texture)) throw std::logic_error("Removing a streamed texture that does not exist");
+
+		mCommitted -= Committed(mTextures[texture]);
+		mTextures[texture] = {};
+		mFree.push_back(texture);
+	}
+
+	void CDX12MipResidency::Request(uint32_t texture, uint32_t mip)
+	{
+		if (!Live(texture)) throw std::logic_error("Requesting mips of a streamed texture that does not exist");
+
+		auto& t = mTextures[texture];
+		mip = std::min(mip, t.tail);
+
+		if (t.lastSeen != mFrame)
+		{
+			t.lastSeen = mFrame;
+			t.requested = mip;
+		}
+		else
+		{
+			t.requested = std::min(t.requested, mip);
+		}
+	}
+
+	std::vector<SMipChange> CDX12MipResidency::Update()
+	{
+		std::vector<SMipChange> changes;
+		mStats.denied = 0;
+
+		std::vector<uint32_t> loads;
+		for (uint32_t texture = 0; texture < mTextures.size(); ++texture)
+		{
+			const auto& t = mTextures[texture];
+			if (Live(texture) && !Streaming(texture) && Wanted(t) < t.resident) loads.push_back(texture);
+		}
+
+		// The textures missing the most mips first, then the ones seen last
+		std::sort(loads.begin(), loads.end(), [this](uint32_t a, uint32_t b)
+		{
+			const auto& ta = mTextures[a];
+			const auto& tb = mTextures[b];
+			const auto missingA = ta.resident - Wanted(ta);
+			const auto missingB = tb.resident - Wanted(tb);
+			if (missingA != missingB) return missingA > missingB;
+			return ta.lastSeen > tb.lastSeen;
+		});
+
+		uint32_t started = 0;
+		for (const auto texture : loads)
+		{
+			// The others wait for the next updates
+			if (started == mMaxChanges) break;
+
+			const auto& t = mTextures[texture];
+			const auto wanted = Wanted(t);
+
+			const auto needed = t.fromMip[wanted] - t.fromMip[t.resident];
+			if (mCommitted + needed > mBudget) Evict(mCommitted + needed - mBudget, changes);
+
+			// The evictions only give their memory back once they are done, take the largest mips that fit now
+			auto mip = wanted;
+			while (mip < t.resident && mCommitted + t.fromMip[mip] - t.fromMip[t.resident] > mBudget) ++mip;
+
+			if (mip != wanted) ++mStats.denied;
+			if (mip == t.resident) continue;
+
+			Start(texture, mip, changes);
+			++started;
+		}
+
+		// The budget was lowered
+		if (mCommitted > mBudget) Evict(mCommitted - mBudget, changes);
+
+		++mFrame;
+		return changes;
+	}
+
+	void CDX12MipResidency::Loaded(uint32_t texture)
+	{
+		if (!Streaming(texture)) throw std::logic_error("Streamed texture loaded without a change in flight");
+
+		auto& t = mTextures[texture];
+		mCommitted -= Committed(t);
+		t.resident = t.pending;
+		mCommitted += Committed(t);
+	}
+
+	void CDX12MipResidency::Cancelled(uint32_t texture)
+	{
+		if (!Streaming(texture)) throw std::logic_error("Streamed texture cancelled without a change in flight");
+
+		auto& t = mTextures[texture];
+		mCommitted -= Committed(t);
+		t.pending = t.resident;
+		mCommitted += Committed(t);
+	}
+
+	uint32_t CDX12MipResidency::Resident(uint32_t texture) const
+	{
+		if (!Live(texture)) throw std::logic_error("Residency of a streamed texture that does not exist");
+
+		return mTextures[texture].resident;
+	}
+
+	bool CDX12MipResidency::Streaming(uint32_t texture) const
+	{
+		return Live(texture) && mTextures[texture].pending != mTextures[texture].resident;
+	}
+
+	SMipResidencyStats CDX12MipResidency::Stats() const
+	{
+		auto stats = mStats;
+		stats.textures = static_cast<uint32_t>(mTextures.size() - mFree.size());
+		stats.streaming = 0;
+		for (uint32_t texture = 0; texture < mTextures.size(); ++texture)
+		{
+			if (Streaming(texture)) ++stats.streaming;
+		}
+
+		stats.budget = mBudget;
+		stats.committed = mCommitted;
+		return stats;
+	}
+
+	void CDX12MipResidency::Validate() const
+	{
+		std::vector<bool> free(mTextures.size(), false);
+		for (const auto texture : mFree)
+		{
+			if (texture >= mTextures.size() || free[texture]) throw std::logic_error("Wrong streamed texture free list");
+			if (Live(texture)) throw std::logic_error("Live streamed texture in the free list");
+			free[texture] = true;
+		}
+
+		uint64_t committed = 0;
+		for (uint32_t texture = 0; texture < mTextures.size(); ++texture)
+		{
+			if (free[texture]) continue;
+			if (!Live(texture)) throw std::logic_error("Free streamed texture slot missing from the free list");
+
+			const auto& t = mTextures[texture];
+			if (t.fromMip.size() != t.mipBytes.size() + 1) throw std::logic_error("Wrong mip sizes of a streamed texture");
+			if (t.tail >= t.mipBytes.size() || t.resident > t.tail || t.pending > t.tail) throw std::logic_error("Streamed texture below its mip tail");
+
+			committed += Committed(t);
+		}
+
+		if (committed != mCommitted) throw std::logic_error("Wrong count of the bytes committed to streamed textures");
+	}
+
+	uint64_t CDX12MipResidency::Committed(const STexture& texture)
+	{
+		return texture.fromMip[std::min(texture.resident, texture.pending)];
+	}
+
+	uint32_t CDX12MipResidency::Wanted(const STexture& texture) const
+	{
+		return texture.lastSeen == mFrame ? texture.requested : texture.tail;
+	}
+
+	void CDX12MipResidency::Start(uint32_t texture, uint32_t mip, std::vector<SMipChange>& changes)
+	{
+		auto& t = mTextures[texture];
+
+		if (mip < t.resident) ++mStats.streamedIn;
+		else ++mStats.evicted;
+
+		mCommitted -= Committed(t);
+		t.pending = mip;
+		mCommitted += Committed(t);
+
+		changes.push_back({ texture, mip });
+	}
+
+	void CDX12MipResidency::Evict(uint64_t bytes, std::vector<SMipChange>& changes)
+	{
+		// What the evictions in flight will give back already counts
+		uint64_t freeing = 0;
+		for (const auto& t : mTextures)
+		{
+			if (!t.mipBytes.empty() && t.pending > t.resident) freeing += t.fromMip[t.resident] - t.fromMip[t.pending];
+		}
+
+		if (freeing >= bytes) return;
+
+		std::vector<uint32_t> candidates;
+		for (uint32_t texture = 0; texture < mTextures.size(); ++texture)
+		{
+			const auto& t = mTextures[texture];
+			if (Live(texture) && !Streaming(texture) && Wanted(t) > t.resident) candidates.push_back(texture);
+		}
+
+		// Least recently seen first
+		std::sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b)
+		{
+			return mTextures[a].lastSeen < mTextures[b].lastSeen;
+		});
+
+		for (const auto texture : candidates)
+		{
+			const auto& t = mTextures[texture];
+			const auto wanted = Wanted(t);
+
+			freeing += t.fromMip[t.resident] - t.fromMip[wanted];
+			Start(texture, wanted, changes);
+
+			if (freeing >= bytes) return;
+		}
+	}
+}
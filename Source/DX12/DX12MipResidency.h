@@ -0,0 +1,158 @@
+//--------------------------------------------------------------------------------------
+// Texture mip residency
+//--------------------------------------------------------------------------------------
+// Decides which mips of the streamed textures are in video memory. A texture only ever
+// has a mip and every smaller one, so its residency is the index of its largest resident
+// mip. It starts with its smallest mips (the tail), which it never goes below.
+// Every frame the textures that are seen request the largest mip they need (the finest of
+// the requests of the frame is kept, see MipForScreenSize), then Update picks the changes
+// to start:
+//  - the textures that need larger mips, those missing the most mips first, then the most
+//    recently seen, as long as they fit in the budget
+//  - when they do not fit, the least recently seen textures that hold more mips than they
+//    need (the tail for the textures not seen this frame) are brought down to what they need
+// A change is in flight until Loaded (or Cancelled) is called; meanwhile a texture counts in
+// the budget with the larger of its old and new mips, since both exist while it streams.
+// Nothing here depends on D3D12, CDX12TextureStreamer reads the mips and replaces the
+// textures, so the policy can be run on the CPU alone. The layout of the mips in a DDS file,
+// which tells the streamer what range of the file to read, is worked out here too.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace DX12
+{
+	struct SMipChange
+	{
+		uint32_t texture = 0;
+		uint32_t mip     = 0; // The new largest resident mip
+	};
+
+	struct SMipResidencyStats
+	{
+		uint32_t textures   = 0;
+		uint32_t streaming  = 0; // Textures with a change in flight
+		uint64_t budget     = 0;
+		uint64_t committed  = 0; // Bytes of the resident mips, and of the changes in flight
+		uint32_t streamedIn = 0; // Changes to larger mips, since the start
+		uint32_t evicted    = 0; // Changes to smaller mips, since the start
+		uint32_t denied     = 0; // Textures short of the mips they need for lack of budget, in the last update
+	};
+
+	// The largest mip worth having for a texture of that width covering that many pixels across the screen,
+	// assuming the texture is mapped once over the object. A positive bias gives smaller mips
+	uint32_t MipForScreenSize(uint32_t width, uint32_t mips, float pixels, float bias = 0.0f);
+
+	// How many pixels across the screen a sphere covers
+	float ProjectedPixels(float radius, float distance, float fovX, float viewportWidth);
+
+	//--------------------------------------------------------------------------------------
+	// Mips of a DDS file of one 2D image, stored from the largest to the smallest
+	//--------------------------------------------------------------------------------------
+
+	// The magic number and DDS_HEADER, the least a DDS file starts with, then a DDS_HEADER_DXT10 in some
+	constexpr size_t DdsHeaderSize     = 4 + 124;
+	constexpr size_t DdsHeaderDx10Size = 20;
+
+	// Where the first mip starts: after the header, and the DDS_HEADER_DXT10 if the pixel format says so
+	// header points to at least DdsHeaderSize bytes
+	size_t DdsDataOffset(const uint8_t* header);
+
+	// The width or height of a mip
+	inline size_t MipExtent(size_t size, uint32_t mip) { return size >> mip ? size >> mip : 1; }
+
+	// Where each mip starts in the file, then where the last one ends
+	std::vector<size_t> MipOffsets(size_t dataOffset, const std::vector<uint64_t>& mipBytes);
+
+	// The largest mip of the tail: the mips up to tailSize across, at least the smallest one
+	uint32_t TailMip(size_t width, size_t height, uint32_t mips, uint32_t tailSize);
+
+	// The mips up to lastMip are made of whole 4x4 blocks, which the largest mip of a block compressed texture needs
+	bool WholeBlocks(size_t width, size_t height, uint32_t lastMip);
+
+	class CDX12MipResidency
+	{
+	public:
+
+		static constexpr uint32_t InvalidTexture = 0xFFFFFFFF;
+
+		CDX12MipResidency(const CDX12MipResidency&) = delete;
+		CDX12MipResidency(const CDX12MipResidency&&) = delete;
+		CDX12MipResidency& operator=(const CDX12MipResidency&) = delete;
+		CDX12MipResidency& operator=(const CDX12MipResidency&&) = delete;
+
+		// At most maxChanges larger mips are started per update, evictions are not limited
+		explicit CDX12MipResidency(uint64_t budget, uint32_t maxChanges = 4);
+
+		// mipBytes[i] is the size of mip i, the largest first. The texture starts with the mips from tail on
+		// Returns the ID of the texture, the ID of the last removed one if any
+		uint32_t Add(std::vector<uint64_t> mipBytes, uint32_t tail);
+
+		// Will throw a std::logic_error exception if the texture does not exist
+		void Remove(uint32_t texture);
+
+		// The texture is seen this frame and needs the mips from mip on
+		void Request(uint32_t texture, uint32_t mip);
+
+		// Ends the requests of the frame and returns the changes to start
+		std::vector<SMipChange> Update();
+
+		// The change in flight is done, or could not be done
+		void Loaded(uint32_t texture);
+		void Cancelled(uint32_t texture);
+
+		// The largest resident mip
+		uint32_t Resident(uint32_t texture) const;
+
+		bool Streaming(uint32_t texture) const;
+
+		bool Live(uint32_t texture) const { return texture < mTextures.size() && !mTextures[texture].mipBytes.empty(); }
+
+		void     SetBudget(uint64_t budget) { mBudget = budget; }
+		uint64_t Budget() const { return mBudget; }
+
+		SMipResidencyStats Stats() const;
+
+		// Will throw a std::logic_error exception if the textures and the bytes committed disagree
+		void Validate() const;
+
+	private:
+
+		struct STexture
+		{
+			std::vector<uint64_t> mipBytes; // Empty for a free slot
+			std::vector<uint64_t> fromMip;  // Bytes of a mip and every smaller one
+			uint32_t              tail      = 0;
+			uint32_t              resident  = 0;
+			uint32_t              pending   = 0; // The same as resident when no change is in flight
+			uint32_t              requested = 0; // In the frame of lastSeen
+			uint64_t              lastSeen  = 0;
+		};
+
+		// What the texture counts for in the budget
+		static uint64_t Committed(const STexture& texture);
+
+		// The mips the texture needs this frame, the tail if it was not seen
+		uint32_t Wanted(const STexture& texture) const;
+
+		// Start a change, keeping the bytes committed up to date
+		void Start(uint32_t texture, uint32_t mip, std::vector<SMipChange>& changes);
+
+		// Bring down the least recently seen textures that hold more than they need, until bytes would be freed
+		void Evict(uint64_t bytes, std::vector<SMipChange>& changes);
+
+		uint64_t mBudget;
+		uint32_t mMaxChanges;
+
+		std::vector<STexture> mTextures;
+		std::vector<uint32_t> mFree;
+
+		uint64_t mFrame     = 1; // Of the requests being gathered
+		uint64_t mCommitted = 0;
+
+		SMipResidencyStats mStats;
+	};
+}
@@ -0,0 +1,185 @@
+#include "DX12PipelineCache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include "DX12Engine.h"
+
+namespace DX12
+{
+	CDX12PipelineCache::CDX12PipelineCache(CDX12Engine* engine, const std::string& libraryFile, unsigned int numThreads) :
+		mEngine(engine),
+		mLibraryFile(libraryFile),
+		mPool(numThreads)
+	{
+		std::ifstream stream(mLibraryFile, std::ios::binary);
+		if (stream.good())
+		{
+			mLibraryData.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+		}
+
+		// A library of another driver or adapter is refused, and started again empty
+		if (mLibraryData.empty() ||
+			FAILED(mEngine->mDevice->CreatePipelineLibrary(mLibraryData.data(), mLibraryData.size(), IID_PPV_ARGS(&mLibrary))))
+		{
+			mLibraryData.clear();
+			mLibrary = nullptr;
+
+			// Not supported by every driver (or under some debugging tools), the pipelines are then always created
+			if (FAILED(mEngine->mDevice->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&mLibrary)))) mLibrary = nullptr;
+		}
+
+		if (mLibrary) NAME_D3D12_OBJECT(mLibrary);
+	}
+
+	CDX12PipelineCache::~CDX12PipelineCache()
+	{
+		mPool.wait_for_tasks();
+
+		try
+		{
+			Save();
+		}
+		catch (const std::exception& e)
+		{
+			OutputDebugStringA(e.what());
+		}
+	}
+
+	uint32_t CDX12PipelineCache::Request(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash, uint32_t fallback)
+	{
+		const CDX12PipelineDesc pipelineDesc(desc, rootSignatureHash);
+
+		std::unique_lock lock(mMutex);
+
+		bool added = false;
+		const auto handle = mTable.Add(pipelineDesc, fallback, added);
+		if (!added) return handle;
+
+#if defined(_DEBUG)
+		mTable.Validate();
+#endif
+
+		const auto name = mTable.Name(handle);
+
+		// The description is copied in the job, the table may grow while it runs
+		mPipelines.emplace_back();
+		mPipelines.back().rootSignature = desc.pRootSignature;
+		mPipelines.back().created = mPool.submit([this, handle, pipelineDesc, name] { Create(handle, pipelineDesc, name); }).share();
+
+		return handle;
+	}
+
+	ID3D12PipelineState* CDX12PipelineCache::Get(uint32_t handle)
+	{
+		while (true)
+		{
+			std::shared_future<void> created;
+			{
+				std::shared_lock lock(mMutex);
+
+				const auto ready = mTable.Resolve(handle);
+				if (ready != InvalidHandle) return mPipelines[ready].pipelineState.Get();
+
+				// Nothing ready down the chain, wait for the first pipeline that can still be
+				auto pending = handle;
+				while (pending != InvalidHandle && mTable.State(pending) == EPipelineState::Failed) pending = mTable.Fallback(pending);
+
+				if (pending == InvalidHandle) throw std::runtime_error("Error creating the pipeline state object");
+
+				created = mPipelines[pending].created;
+			}
+
+			created.wait();
+		}
+	}
+
+	void CDX12PipelineCache::Save()
+	{
+		std::lock_guard lock(mLibraryMutex);
+
+		if (!mLibrary || !mLibraryChanged) return;
+
+		std::vector<char> data(mLibrary->GetSerializedSize());
+		ThrowIfFailed(mLibrary->Serialize(data.data(), data.size()));
+
+		// Written aside and renamed, so a crash never leaves half a library
+		const auto temporary = mLibraryFile + ".tmp";
+		{
+			std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+			if (!stream.good()) throw std::runtime_error("Cannot write the pipeline library " + temporary);
+
+			stream.write(data.data(), data.size());
+		}
+
+		std::error_code error;
+		std::filesystem::rename(temporary, mLibraryFile, error);
+		if (error) throw std::runtime_error("Cannot write the pipeline library " + mLibraryFile);
+
+		mLibraryChanged = false;
+	}
+
+	SPipelineCacheStats CDX12PipelineCache::Stats() const
+	{
+		SPipelineCacheStats stats;
+		{
+			std::shared_lock lock(mMutex);
+
+			const auto tableStats = mTable.Stats();
+			stats.requests = tableStats.requests;
+			stats.pipelines = tableStats.pipelines;
+
+			for (uint32_t handle = 0; handle < mTable.Size(); ++handle)
+			{
+				if (mTable.State(handle) == EPipelineState::Pending) ++stats.pending;
+			}
+		}
+		stats.loaded = mLoaded;
+		stats.created = mCreated;
+		stats.failed = mFailed;
+		return stats;
+	}
+
+	void CDX12PipelineCache::Create(uint32_t handle, const CDX12PipelineDesc& desc, const std::wstring& name)
+	{
+		const auto d3dDesc = desc.Desc();
+
+		ComPtr<ID3D12PipelineState> pipelineState;
+
+		// The library fails to load pipelines it does not have or that were stored with another description
+		auto loaded = false;
+		if (mLibrary)
+		{
+			std::lock_guard lock(mLibraryMutex);
+			loaded = SUCCEEDED(mLibrary->LoadGraphicsPipeline(name.c_str(), &d3dDesc, IID_PPV_ARGS(&pipelineState)));
+		}
+
+		if (loaded)
+		{
+			++mLoaded;
+		}
+		else if (SUCCEEDED(mEngine->mDevice->CreateGraphicsPipelineState(&d3dDesc, IID_PPV_ARGS(&pipelineState))))
+		{
+			++mCreated;
+
+			if (mLibrary)
+			{
+				std::lock_guard lock(mLibraryMutex);
+				if (SUCCEEDED(mLibrary->StorePipeline(name.c_str(), pipelineState.Get()))) mLibraryChanged = true;
+			}
+		}
+		else
+		{
+			++mFailed;
+			OutputDebugStringW((L"Error creating the pipeline state object " + name + L"\n").c_str());
+		}
+
+		if (pipelineState) SetName(pipelineState.Get(), name.c_str());
+
+		std::unique_lock lock(mMutex);
+		mPipelines[handle].pipelineState = pipelineState;
+		mPipelines[handle].rootSignature = nullptr;
+		mTable.SetState(handle, pipelineState ? EPipelineState::Ready : EPipelineState::Failed);
+	}
+}
@@ -0,0 +1,106 @@
+//--------------------------------------------------------------------------------------
+// Pipeline state cache
+//--------------------------------------------------------------------------------------
+// Pipeline state objects are requested with their description and created on the threads of
+// a pool; equal descriptions (see CDX12PipelineTable) share one object, so a permutation only
+// needs its description. A request can name a fallback pipeline, which is set while its own
+// is created, so new pipelines (a shader just recompiled) don't stall the frame. Without a
+// ready fallback the recording thread waits for the pipeline.
+// The pipelines are kept in an ID3D12PipelineLibrary written to disk, so the next run loads
+// them instead of compiling them again. The driver rejects the library when it changes and the
+// library is then started again empty.
+
+#pragma once
+
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include <thread_pool.hpp>
+
+#include "DX12Common.h"
+#include "DX12PipelineTable.h"
+
+namespace DX12
+{
+	class CDX12Engine;
+
+	struct SPipelineCacheStats
+	{
+		uint32_t requests  = 0;
+		uint32_t pipelines = 0; // Different ones
+		uint32_t loaded    = 0; // From the pipeline library
+		uint32_t created   = 0;
+		uint32_t failed    = 0;
+		uint32_t pending   = 0;
+	};
+
+	class CDX12PipelineCache
+	{
+	public:
+
+		static constexpr uint32_t InvalidHandle = CDX12PipelineTable::InvalidHandle;
+
+		CDX12PipelineCache() = delete;
+		CDX12PipelineCache(const CDX12PipelineCache&) = delete;
+		CDX12PipelineCache(const CDX12PipelineCache&&) = delete;
+		CDX12PipelineCache& operator=(const CDX12PipelineCache&) = delete;
+		CDX12PipelineCache& operator=(const CDX12PipelineCache&&) = delete;
+
+		// The library is read from the file if there is one. 0 threads uses one per hardware thread
+		CDX12PipelineCache(CDX12Engine* engine, const std::string& libraryFile, unsigned int numThreads = 0);
+
+		// Waits for the pipelines being created and saves the library
+		~CDX12PipelineCache();
+
+		// Returns the handle of the pipeline, created on the pool unless an equal one was requested before.
+		// The root signature hash is the one of CDX12RootSignature, the fallback has to use the same root signature
+		// and input layout
+		// Will throw a std::logic_error exception for unsupported descriptions
+		uint32_t Request(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash, uint32_t fallback = InvalidHandle);
+
+		// The pipeline, or its fallback while it is created. Waits if neither is ready. Safe from any thread
+		// Will throw a std::runtime_error exception if the pipeline and its fallbacks failed
+		ID3D12PipelineState* Get(uint32_t handle);
+
+		// Write the library to disk if pipelines were added to it
+		void Save();
+
+		SPipelineCacheStats Stats() const;
+
+	private:
+
+		struct SPipeline
+		{
+			ComPtr<ID3D12PipelineState> pipelineState; // Set before the state of the table is ready
+			ComPtr<ID3D12RootSignature> rootSignature; // Kept while the pipeline is created, its owner may go first
+			std::shared_future<void>    created;
+		};
+
+		void Create(uint32_t handle, const CDX12PipelineDesc& desc, const std::wstring& name);
+
+		CDX12Engine* mEngine;
+		std::string  mLibraryFile;
+
+		// The library points into the data it was made from
+		std::vector<char>              mLibraryData;
+		ComPtr<ID3D12PipelineLibrary>  mLibrary;
+		std::mutex                     mLibraryMutex;
+		bool                           mLibraryChanged = false;
+
+		// Request and the workers change the table under the exclusive lock, Get reads it under the shared one
+		mutable std::shared_mutex mMutex;
+		CDX12PipelineTable        mTable;
+		std::vector<SPipeline>    mPipelines; // By handle
+
+		std::atomic<uint32_t> mLoaded  = 0;
+		std::atomic<uint32_t> mCreated = 0;
+		std::atomic<uint32_t> mFailed  = 0;
+
+		// Last, so the workers stop before the rest goes
+		thread_pool mPool;
+	};
+}
@@ -9,7 +9,7 @@
 namespace DX12
 {
 
-	CDX12PBRPSO::CDX12PBRPSO(CDX12Engine* engine) : mEngine(engine)
+	CDX12PBRPSO::CDX12PBRPSO(CDX12Engine* engine, uint32_t fallback) : mEngine(engine)
 	{
 		try
 		{
@@ -29,10 +29,10 @@ namespace DX12
 			D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
 			psoDesc.InputLayout = { vertexElements.data(), static_cast<unsigned>(vertexElements.size()) };
 			psoDesc.pRootSignature = mPBRRootSignature->mRootSignature->Get();
-			psoDesc.VS.BytecodeLength = vs->mShaderBlob->GetBufferSize();
-			psoDesc.VS.pShaderBytecode = vs->mShaderBlob->GetBufferPointer();
-			psoDesc.PS.BytecodeLength = ps->mShaderBlob->GetBufferSize();
-			psoDesc.PS.pShaderBytecode = ps->mShaderBlob->GetBufferPointer();
+			psoDesc.VS.BytecodeLength = vs->Blob()->GetBufferSize();
+			psoDesc.VS.pShaderBytecode = vs->Blob()->GetBufferPointer();
+			psoDesc.PS.BytecodeLength = ps->Blob()->GetBufferSize();
+			psoDesc.PS.pShaderBytecode = ps->Blob()->GetBufferPointer();
 			psoDesc.RasterizerState = DirectX::CommonStates::CullCounterClockwise;
 			psoDesc.BlendState = DirectX::CommonStates::AlphaBlend;
 			psoDesc.DepthStencilState = DirectX::CommonStates::DepthDefault;
@@ -44,10 +44,7 @@ namespace DX12
 			psoDesc.DepthStencilState.StencilEnable = FALSE;
 			psoDesc.SampleDesc.Count = 1;
 
-			ThrowIfFailed(engine->mDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(mPipelineState.GetAddressOf())));
-			
-			NAME_D3D12_OBJECT(mPipelineState);
-
+			mPipeline = engine->mPipelineCache->Request(psoDesc, mPBRRootSignature->mRootSignature->Hash(), fallback);
 		}
 		catch (const std::exception& e)
 		{
@@ -59,10 +56,10 @@ namespace DX12
 	{
 		auto commandList = mEngine->mCurrRecordingCommandList;
 		commandList->SetGraphicsRootSignature(mPBRRootSignature->mRootSignature->Get());
-		commandList->SetPipelineState(mPipelineState.Get());
+		commandList->SetPipelineState(mEngine->mPipelineCache->Get(mPipeline));
 	}
 
-	CDX12SkyPSO::CDX12SkyPSO(CDX12Engine* engine) : mEngine(engine)
+	CDX12SkyPSO::CDX12SkyPSO(CDX12Engine* engine, uint32_t fallback) : mEngine(engine)
 	{
 		try
 		{
@@ -81,8 +78,8 @@ namespace DX12
 			D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
 			psoDesc.InputLayout = { vertexElements.data(), static_cast<unsigned>(vertexElements.size()) };
 			psoDesc.pRootSignature = mRootSignature->mRootSignature->Get();
-			psoDesc.VS = CD3DX12_SHADER_BYTECODE(vs->mShaderBlob->GetBufferPointer(), vs->mShaderBlob->GetBufferSize());
-			psoDesc.PS = CD3DX12_SHADER_BYTECODE(ps->mShaderBlob->GetBufferPointer(), ps->mShaderBlob->GetBufferSize());
+			psoDesc.VS = CD3DX12_SHADER_BYTECODE(vs->Blob()->GetBufferPointer(), vs->Blob()->GetBufferSize());
+			psoDesc.PS = CD3DX12_SHADER_BYTECODE(ps->Blob()->GetBufferPointer(), ps->Blob()->GetBufferSize());
 			psoDesc.RasterizerState = DirectX::CommonStates::CullNone;
 			psoDesc.BlendState = DirectX::CommonStates::Opaque;
 			psoDesc.DepthStencilState = DirectX::CommonStates::DepthNone;
@@ -94,9 +91,7 @@ namespace DX12
 			psoDesc.DepthStencilState.StencilEnable = FALSE;
 			psoDesc.SampleDesc.Count = 1;
 
-			ThrowIfFailed(engine->mDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(mPipelineState.GetAddressOf())));
-
-			NAME_D3D12_OBJECT(mPipelineState);
+			mPipeline = engine->mPipelineCache->Request(psoDesc, mRootSignature->mRootSignature->Hash(), fallback);
 		}
 		catch (const std::exception& e)
 		{
@@ -109,10 +104,10 @@ namespace DX12
 	{
 		auto commandList = mEngine->mCurrRecordingCommandList;
 		commandList->SetGraphicsRootSignature(mRootSignature->mRootSignature->Get());
-		commandList->SetPipelineState(mPipelineState.Get());
+		commandList->SetPipelineState(mEngine->mPipelineCache->Get(mPipeline));
 	}
 
-	CDX12DepthOnlyPSO::CDX12DepthOnlyPSO(CDX12Engine* engine, bool requireTangents) : mEngine(engine)
+	CDX12DepthOnlyPSO::CDX12DepthOnlyPSO(CDX12Engine* engine, bool requireTangents, uint32_t fallback) : mEngine(engine)
 	{
 		try
 		{
@@ -136,8 +131,8 @@ namespace DX12
 			D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
 			psoDesc.InputLayout = { vertexElements.data(), static_cast<unsigned>(vertexElements.size()) };
 			psoDesc.pRootSignature = mRootSignature->mRootSignature->Get();
-			psoDesc.VS = CD3DX12_SHADER_BYTECODE(vs->mShaderBlob->GetBufferPointer(), vs->mShaderBlob->GetBufferSize());
-			psoDesc.PS = CD3DX12_SHADER_BYTECODE(ps->mShaderBlob->GetBufferPointer(), ps->mShaderBlob->GetBufferSize());
+			psoDesc.VS = CD3DX12_SHADER_BYTECODE(vs->Blob()->GetBufferPointer(), vs->Blob()->GetBufferSize());
+			psoDesc.PS = CD3DX12_SHADER_BYTECODE(ps->Blob()->GetBufferPointer(), ps->Blob()->GetBufferSize());
 			psoDesc.RasterizerState = DirectX::CommonStates::CullNone;
 			psoDesc.BlendState = DirectX::CommonStates::AlphaBlend;
 			psoDesc.DepthStencilState = DirectX::CommonStates::DepthDefault;
@@ -152,9 +147,7 @@ namespace DX12
 			psoDesc.DepthStencilState.StencilEnable = FALSE;
 			psoDesc.SampleDesc.Count = 1;
 
-			ThrowIfFailed(engine->mDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(mPipelineState.GetAddressOf())));
-
-			NAME_D3D12_OBJECT(mPipelineState);
+			mPipeline = engine->mPipelineCache->Request(psoDesc, mRootSignature->mRootSignature->Hash(), fallback);
 		}
 		catch(const std::exception& e)
 		{
@@ -166,6 +159,6 @@ namespace DX12
 	{
 		auto commandList = mEngine->mCurrRecordingCommandList;
 		commandList->SetGraphicsRootSignature(mRootSignature->mRootSignature->Get());
-		commandList->SetPipelineState(mPipelineState.Get());
+		commandList->SetPipelineState(mEngine->mPipelineCache->Get(mPipeline));
 	}
 }
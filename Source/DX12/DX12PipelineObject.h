@@ -2,6 +2,7 @@
 
 #include "DX12Common.h"
 
+#include "DX12PipelineCache.h"
 #include "DX12RootSignature.h"
 
 namespace DX12
@@ -17,38 +18,41 @@ namespace DX12
 	class CDX12PBRPSO : public CDX12PSO
 	{
 	public:
-		CDX12PBRPSO(CDX12Engine* engine);
+		// The fallback is used until the pipeline is created
+		CDX12PBRPSO(CDX12Engine* engine, uint32_t fallback = CDX12PipelineCache::InvalidHandle);
 
 		void Set();
 
 		CDX12Engine* mEngine;
 		std::unique_ptr<CDX12PBRRootSignature> mPBRRootSignature;
-		ComPtr<ID3D12PipelineState> mPipelineState;
+		uint32_t mPipeline; // In the pipeline cache of the engine
 	};
 
 	class CDX12SkyPSO : public CDX12PSO
 	{
 	public:
-		CDX12SkyPSO(CDX12Engine* engine);
+		// The fallback is used until the pipeline is created
+		CDX12SkyPSO(CDX12Engine* engine, uint32_t fallback = CDX12PipelineCache::InvalidHandle);
 
 		void Set();
 
 		CDX12Engine* mEngine;
 		std::unique_ptr<CDX12SkyRootSignature> mRootSignature;
-		ComPtr<ID3D12PipelineState> mPipelineState;
+		uint32_t mPipeline; // In the pipeline cache of the engine
 	};
 
 	class CDX12DepthOnlyPSO : public CDX12PSO
 	{
 		public:
 
-		CDX12DepthOnlyPSO(CDX12Engine* engine, bool requireTangents);
+		// The fallback is used until the pipeline is created
+		CDX12DepthOnlyPSO(CDX12Engine* engine, bool requireTangents, uint32_t fallback = CDX12PipelineCache::InvalidHandle);
 
 		void Set();
 
 		CDX12Engine* mEngine;
 		std::unique_ptr<CDX12DepthOnlyRootSignature> mRootSignature;
-		ComPtr<ID3D12PipelineState> mPipelineState;
+		uint32_t mPipeline; // In the pipeline cache of the engine
 	};
 
 }
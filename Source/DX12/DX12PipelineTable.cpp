@@ -0,0 +1,378 @@
+#include "DX12PipelineTable.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cwchar>
+#include <stdexcept>
+#include <type_traits>
+
+namespace DX12
+{
+	namespace
+	{
+		// Appends values to a key one field at a time
+		class CKeyWriter
+		{
+		public:
+
+			explicit CKeyWriter(std::vector<uint8_t>& key) : mKey(key) {}
+
+			template <typename T>
+			void Add(const T& value)
+			{
+				static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "Add the fields one by one");
+
+				const auto bytes = reinterpret_cast<const uint8_t*>(&value);
+				mKey.insert(mKey.end(), bytes, bytes + sizeof(T));
+			}
+
+			void Add(const std::string& string)
+			{
+				Add(static_cast<uint64_t>(string.size()));
+				mKey.insert(mKey.end(), string.begin(), string.end());
+			}
+
+		private:
+
+			std::vector<uint8_t>& mKey;
+		};
+
+		const D3D12_DEPTH_STENCILOP_DESC DefaultStencilOp =
+		{
+			D3D12_STENCIL_OP_KEEP,
+			D3D12_STENCIL_OP_KEEP,
+			D3D12_STENCIL_OP_KEEP,
+			D3D12_COMPARISON_FUNC_ALWAYS
+		};
+	}
+
+	uint64_t HashBytes(const void* data, size_t size, uint64_t hash)
+	{
+		const auto bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	//--------------------------------------------------------------------------------------
+	// CDX12PipelineDesc
+	//--------------------------------------------------------------------------------------
+
+	CDX12PipelineDesc::CDX12PipelineDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash) :
+		mDesc(desc),
+		mRootSignatureHash(rootSignatureHash)
+	{
+		if (desc.StreamOutput.NumEntries != 0) throw std::logic_error("Stream output pipelines are not supported");
+
+		auto data = std::make_shared<SData>();
+
+		const D3D12_SHADER_BYTECODE* stages[NumStages] = { &desc.VS, &desc.PS, &desc.DS, &desc.HS, &desc.GS };
+		for (uint32_t s = 0; s < NumStages; ++s)
+		{
+			const auto bytes = static_cast<const uint8_t*>(stages[s]->pShaderBytecode);
+			if (bytes) data->shaders[s].assign(bytes, bytes + stages[s]->BytecodeLength);
+		}
+
+		for (UINT e = 0; e < desc.InputLayout.NumElements; ++e)
+		{
+			data->inputElements.push_back(desc.InputLayout.pInputElementDescs[e]);
+
+			// Semantics are not case sensitive
+			std::string name = desc.InputLayout.pInputElementDescs[e].SemanticName;
+			std::transform(name.begin(), name.end(), name.begin(), [](char c) { return static_cast<char>(std::toupper(static_cast<unsigned char>(c))); });
+			data->semanticNames.push_back(std::move(name));
+		}
+
+		// Once all the names are in, the strings don't move anymore
+		for (size_t e = 0; e < data->inputElements.size(); ++e)
+		{
+			data->inputElements[e].SemanticName = data->semanticNames[e].c_str();
+		}
+
+		mData = std::move(data);
+
+		Normalise();
+		BuildKey();
+	}
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC CDX12PipelineDesc::Desc() const
+	{
+		auto desc = mDesc;
+		if (!mData) return desc;
+
+		D3D12_SHADER_BYTECODE* stages[NumStages] = { &desc.VS, &desc.PS, &desc.DS, &desc.HS, &desc.GS };
+		for (uint32_t s = 0; s < NumStages; ++s)
+		{
+			const auto& shader = mData->shaders[s];
+			*stages[s] = { shader.empty() ? nullptr : shader.data(), shader.size() };
+		}
+
+		const auto& elements = mData->inputElements;
+		desc.InputLayout = { elements.empty() ? nullptr : elements.data(), static_cast<UINT>(elements.size()) };
+
+		return desc;
+	}
+
+	bool CDX12PipelineDesc::operator==(const CDX12PipelineDesc& other) const
+	{
+		if (mHash != other.mHash || mKey != other.mKey) return false;
+		if (mData == other.mData) return true;
+		if (!mData || !other.mData) return false;
+
+		for (uint32_t s = 0; s < NumStages; ++s)
+		{
+			if (mData->shaders[s] != other.mData->shaders[s]) return false;
+		}
+
+		return true;
+	}
+
+	void CDX12PipelineDesc::Normalise()
+	{
+		// What points outside is copied, or not part of the pipeline
+		mDesc.VS = mDesc.PS = mDesc.DS = mDesc.HS = mDesc.GS = {};
+		mDesc.InputLayout = {};
+		mDesc.StreamOutput = {};
+		mDesc.CachedPSO = {};
+
+		const auto numTargets = std::min<UINT>(mDesc.NumRenderTargets, D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT);
+
+		for (UINT rt = numTargets; rt < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++rt)
+		{
+			mDesc.RTVFormats[rt] = DXGI_FORMAT_UNKNOWN;
+		}
+
+		// Without independent blending only the first target state is used
+		auto& blend = mDesc.BlendState;
+		const auto numBlends = blend.IndependentBlendEnable ? numTargets : std::min<UINT>(numTargets, 1);
+
+		for (UINT rt = 0; rt < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++rt)
+		{
+			auto& target = blend.RenderTarget[rt];
+
+			if (rt >= numBlends)
+			{
+				target = {};
+				continue;
+			}
+
+			if (!target.BlendEnable)
+			{
+				target.SrcBlend = target.SrcBlendAlpha = D3D12_BLEND_ONE;
+				target.DestBlend = target.DestBlendAlpha = D3D12_BLEND_ZERO;
+				target.BlendOp = target.BlendOpAlpha = D3D12_BLEND_OP_ADD;
+			}
+
+			if (!target.LogicOpEnable) target.LogicOp = D3D12_LOGIC_OP_NOOP;
+		}
+
+		// The write mask and the function mean nothing without the depth test, as do the stencil fields without stencil
+		auto& depthStencil = mDesc.DepthStencilState;
+		if (!depthStencil.DepthEnable)
+		{
+			depthStencil.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+			depthStencil.DepthFunc = D3D12_COMPARISON_FUNC_ALWAYS;
+		}
+
+		if (!depthStencil.StencilEnable)
+		{
+			depthStencil.StencilReadMask = D3D12_DEFAULT_STENCIL_READ_MASK;
+			depthStencil.StencilWriteMask = D3D12_DEFAULT_STENCIL_WRITE_MASK;
+			depthStencil.FrontFace = DefaultStencilOp;
+			depthStencil.BackFace = DefaultStencilOp;
+		}
+
+		// Without a depth buffer the depth bias does nothing
+		if (mDesc.DSVFormat == DXGI_FORMAT_UNKNOWN && !depthStencil.DepthEnable && !depthStencil.StencilEnable)
+		{
+			mDesc.RasterizerState.DepthBias = 0;
+			mDesc.RasterizerState.DepthBiasClamp = 0;
+			mDesc.RasterizerState.SlopeScaledDepthBias = 0;
+		}
+	}
+
+	void CDX12PipelineDesc::BuildKey()
+	{
+		mKey.clear();
+		CKeyWriter key(mKey);
+
+		key.Add(mRootSignatureHash);
+
+		for (const auto& shader : mData->shaders)
+		{
+			key.Add(static_cast<uint64_t>(shader.size()));
+			key.Add(HashBytes(shader.data(), shader.size()));
+		}
+
+		const auto& blend = mDesc.BlendState;
+		key.Add(blend.AlphaToCoverageEnable);
+		key.Add(blend.IndependentBlendEnable);
+		for (const auto& target : blend.RenderTarget)
+		{
+			key.Add(target.BlendEnable);
+			key.Add(target.LogicOpEnable);
+			key.Add(target.SrcBlend);
+			key.Add(target.DestBlend);
+			key.Add(target.BlendOp);
+			key.Add(target.SrcBlendAlpha);
+			key.Add(target.DestBlendAlpha);
+			key.Add(target.BlendOpAlpha);
+			key.Add(target.LogicOp);
+			key.Add(target.RenderTargetWriteMask);
+		}
+
+		key.Add(mDesc.SampleMask);
+
+		const auto& rasterizer = mDesc.RasterizerState;
+		key.Add(rasterizer.FillMode);
+		key.Add(rasterizer.CullMode);
+		key.Add(rasterizer.FrontCounterClockwise);
+		key.Add(rasterizer.DepthBias);
+		key.Add(rasterizer.DepthBiasClamp);
+		key.Add(rasterizer.SlopeScaledDepthBias);
+		key.Add(rasterizer.DepthClipEnable);
+		key.Add(rasterizer.MultisampleEnable);
+		key.Add(rasterizer.AntialiasedLineEnable);
+		key.Add(rasterizer.ForcedSampleCount);
+		key.Add(rasterizer.ConservativeRaster);
+
+		const auto& depthStencil = mDesc.DepthStencilState;
+		key.Add(depthStencil.DepthEnable);
+		key.Add(depthStencil.DepthWriteMask);
+		key.Add(depthStencil.DepthFunc);
+		key.Add(depthStencil.StencilEnable);
+		key.Add(depthStencil.StencilReadMask);
+		key.Add(depthStencil.StencilWriteMask);
+		for (const auto& face : { depthStencil.FrontFace, depthStencil.BackFace })
+		{
+			key.Add(face.StencilFailOp);
+			key.Add(face.StencilDepthFailOp);
+			key.Add(face.StencilPassOp);
+			key.Add(face.StencilFunc);
+		}
+
+		const auto& elements = mData->inputElements;
+		key.Add(static_cast<uint32_t>(elements.size()));
+		for (size_t e = 0; e < elements.size(); ++e)
+		{
+			const auto& element = elements[e];
+			key.Add(mData->semanticNames[e]);
+			key.Add(element.SemanticIndex);
+			key.Add(element.Format);
+			key.Add(element.InputSlot);
+			key.Add(element.AlignedByteOffset);
+			key.Add(element.InputSlotClass);
+			key.Add(element.InstanceDataStepRate);
+		}
+
+		key.Add(mDesc.IBStripCutValue);
+		key.Add(mDesc.PrimitiveTopologyType);
+		key.Add(mDesc.NumRenderTargets);
+		for (const auto format : mDesc.RTVFormats) key.Add(format);
+		key.Add(mDesc.DSVFormat);
+		key.Add(mDesc.SampleDesc.Count);
+		key.Add(mDesc.SampleDesc.Quality);
+		key.Add(mDesc.NodeMask);
+		key.Add(mDesc.Flags);
+
+		mHash = HashBytes(mKey.data(), mKey.size());
+	}
+
+	//--------------------------------------------------------------------------------------
+	// CDX12PipelineTable
+	//--------------------------------------------------------------------------------------
+
+	uint32_t CDX12PipelineTable::Add(const CDX12PipelineDesc& desc, uint32_t fallback, bool& added)
+	{
+		++mRequests;
+
+		auto& bucket = mBuckets[desc.Hash()];
+		for (const auto handle : bucket)
+		{
+			if (mEntries[handle].desc == desc)
+			{
+				added = false;
+				return handle;
+			}
+		}
+
+		if (fallback != InvalidHandle && fallback >= mEntries.size()) throw std::logic_error("Invalid fallback pipeline");
+
+		if (!bucket.empty()) ++mCollisions;
+
+		SEntry entry;
+		entry.desc = desc;
+		entry.fallback = fallback;
+		entry.collision = static_cast<uint32_t>(bucket.size());
+		mEntries.push_back(std::move(entry));
+
+		const auto handle = static_cast<uint32_t>(mEntries.size() - 1);
+		bucket.push_back(handle);
+
+		added = true;
+		return handle;
+	}
+
+	uint32_t CDX12PipelineTable::Resolve(uint32_t handle) const
+	{
+		// The fallbacks are earlier handles, so the chain ends
+		while (handle != InvalidHandle)
+		{
+			const auto& entry = mEntries[handle];
+			if (entry.state == EPipelineState::Ready) return handle;
+			handle = entry.fallback;
+		}
+		return InvalidHandle;
+	}
+
+	std::wstring CDX12PipelineTable::Name(uint32_t handle) const
+	{
+		const auto& entry = mEntries[handle];
+
+		wchar_t name[64];
+		swprintf(name, 64, L"Pipeline_%016llx_%u", static_cast<unsigned long long>(entry.desc.Hash()), entry.collision);
+		return name;
+	}
+
+	SPipelineTableStats CDX12PipelineTable::Stats() const
+	{
+		SPipelineTableStats stats;
+		stats.requests = mRequests;
+		stats.pipelines = Size();
+		stats.collisions = mCollisions;
+		return stats;
+	}
+
+	void CDX12PipelineTable::Validate() const
+	{
+		size_t inBuckets = 0;
+
+		for (const auto& [hash, bucket] : mBuckets)
+		{
+			inBuckets += bucket.size();
+
+			for (size_t i = 0; i < bucket.size(); ++i)
+			{
+				const auto& entry = mEntries[bucket[i]];
+				if (entry.desc.Hash() != hash) throw std::logic_error("Pipeline in the bucket of another hash");
+				if (entry.collision != i) throw std::logic_error("Pipeline collision index out of order");
+
+				for (size_t j = i + 1; j < bucket.size(); ++j)
+				{
+					if (entry.desc == mEntries[bucket[j]].desc) throw std::logic_error("Equal pipelines with different handles");
+				}
+			}
+		}
+
+		if (inBuckets != mEntries.size()) throw std::logic_error("Pipelines missing from the buckets");
+
+		for (uint32_t handle = 0; handle < mEntries.size(); ++handle)
+		{
+			const auto fallback = mEntries[handle].fallback;
+			if (fallback != InvalidHandle && fallback >= handle) throw std::logic_error("Pipeline fallback is not an earlier handle");
+		}
+	}
+}
@@ -0,0 +1,153 @@
+//--------------------------------------------------------------------------------------
+// Pipeline state descriptions and table
+//--------------------------------------------------------------------------------------
+// The bookkeeping of CDX12PipelineCache, kept apart from the device so it can be driven (and
+// tested) without one; only the description structures of d3d12.h are used.
+// CDX12PipelineDesc is a copy of a graphics pipeline description that owns what it points to
+// (the shaders, the input layout) and is normalised: the state D3D12 ignores is reset, like the
+// blend factors of a target without blending, the stencil operations without stencil or the
+// formats past the render target count, and semantic names are upper case as they are not case
+// sensitive. Two descriptions giving the same pipeline then compare and hash the same. The root
+// signature is identified by a hash of its serialised blob, and the hash of a description
+// is the same from a run to the next, so it can name the pipeline in a pipeline library.
+// CDX12PipelineTable gives the same handle to equal descriptions and keeps the state of each
+// pipeline, with a fallback handle to use while it is not ready. It is not thread safe, the
+// cache locks it.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <d3d12.h>
+
+namespace DX12
+{
+	// FNV-1a, the same on every run
+	uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+	class CDX12PipelineDesc
+	{
+	public:
+
+		CDX12PipelineDesc() = default;
+
+		// Copies the shaders and the input layout, shared by the copies of this description
+		// Will throw a std::logic_error exception for stream output, which is not supported
+		CDX12PipelineDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash);
+
+		// Points into this object, valid while it or a copy lives
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC Desc() const;
+
+		uint64_t Hash() const { return mHash; }
+
+		uint64_t RootSignatureHash() const { return mRootSignatureHash; }
+
+		bool operator==(const CDX12PipelineDesc& other) const;
+		bool operator!=(const CDX12PipelineDesc& other) const { return !(*this == other); }
+
+	private:
+
+		enum EStage : uint32_t
+		{
+			VS,
+			PS,
+			DS,
+			HS,
+			GS,
+			NumStages
+		};
+
+		// What the description points to, never changed once made
+		struct SData
+		{
+			std::vector<uint8_t>                  shaders[NumStages];
+			std::vector<D3D12_INPUT_ELEMENT_DESC> inputElements; // Their names point into semanticNames
+			std::vector<std::string>              semanticNames;
+		};
+
+		void Normalise();
+
+		// The normalised state field by field, the padding of the structures left out
+		void BuildKey();
+
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC mDesc = {}; // The pointers are only set by Desc
+		std::shared_ptr<const SData>       mData;
+		uint64_t                           mRootSignatureHash = 0;
+
+		std::vector<uint8_t> mKey; // The shaders are in it by hash, and compared on their own
+		uint64_t             mHash = 0;
+	};
+
+	enum class EPipelineState : uint32_t
+	{
+		Pending,
+		Ready,
+		Failed
+	};
+
+	struct SPipelineTableStats
+	{
+		uint32_t requests   = 0; // Calls to Add
+		uint32_t pipelines  = 0; // Different descriptions
+		uint32_t collisions = 0; // Different descriptions with the same hash
+	};
+
+	class CDX12PipelineTable
+	{
+	public:
+
+		static constexpr uint32_t InvalidHandle = 0xFFFFFFFF;
+
+		CDX12PipelineTable() = default;
+		CDX12PipelineTable(const CDX12PipelineTable&) = delete;
+		CDX12PipelineTable(const CDX12PipelineTable&&) = delete;
+		CDX12PipelineTable& operator=(const CDX12PipelineTable&) = delete;
+		CDX12PipelineTable& operator=(const CDX12PipelineTable&&) = delete;
+
+		// Returns the handle of an equal description if there is one, added is then false and the fallback is ignored.
+		// New pipelines are pending
+		// Will throw a std::logic_error exception if the fallback is not a valid handle
+		uint32_t Add(const CDX12PipelineDesc& desc, uint32_t fallback, bool& added);
+
+		uint32_t                 Size() const { return static_cast<uint32_t>(mEntries.size()); }
+		const CDX12PipelineDesc& Desc(uint32_t handle) const { return mEntries[handle].desc; }
+		uint32_t                 Fallback(uint32_t handle) const { return mEntries[handle].fallback; }
+		EPipelineState           State(uint32_t handle) const { return mEntries[handle].state; }
+
+		void SetState(uint32_t handle, EPipelineState state) { mEntries[handle].state = state; }
+
+		// The handle to use now: the pipeline once it is ready, else the first fallback ready down
+		// the chain, InvalidHandle if none is
+		uint32_t Resolve(uint32_t handle) const;
+
+		// The name of the pipeline in a pipeline library, the same from a run to the next
+		// unless there are hash collisions
+		std::wstring Name(uint32_t handle) const;
+
+		SPipelineTableStats Stats() const;
+
+		// Check every handle is in the bucket of its hash, no two descriptions are equal and
+		// the fallbacks are earlier handles. Throws a std::logic_error exception if not
+		void Validate() const;
+
+	private:
+
+		struct SEntry
+		{
+			CDX12PipelineDesc desc;
+			uint32_t          fallback  = InvalidHandle;
+			uint32_t          collision = 0; // Index among the descriptions with the same hash
+			EPipelineState    state     = EPipelineState::Pending;
+		};
+
+		std::vector<SEntry>                                  mEntries;
+		std::unordered_map<uint64_t, std::vector<uint32_t>> mBuckets;
+
+		uint32_t mRequests   = 0;
+		uint32_t mCollisions = 0;
+	};
+}
@@ -0,0 +1,218 @@
+#include "DX12ProfileTree.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <stdexcept>
+
+namespace DX12
+{
+	namespace
+	{
+		uint64_t Duration(const SProfileScope& scope)
+		{
+			return scope.end > scope.begin ? scope.end - scope.begin : 0;
+		}
+
+		std::string EscapeJson(const std::string& text)
+		{
+			std::string escaped;
+			for (const auto c : text)
+			{
+				if (c == '"' || c == '\\')
+				{
+					escaped += '\\';
+					escaped += c;
+				}
+				else if (static_cast<unsigned char>(c) < 0x20)
+				{
+					char code[8];
+					std::snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned>(c));
+					escaped += code;
+				}
+				else
+				{
+					escaped += c;
+				}
+			}
+			return escaped;
+		}
+	}
+
+	void ReadTimestamps(std::vector<SProfileScope>& scopes, const uint64_t* timestamps)
+	{
+		for (size_t i = 0; i < scopes.size(); ++i)
+		{
+			scopes[i].begin = timestamps[i * 2];
+			scopes[i].end = timestamps[i * 2 + 1];
+		}
+	}
+
+	CDX12ProfileTree::CDX12ProfileTree()
+	{
+		mNodes.emplace_back();
+		mNodes.back().name = "Frame";
+		mHistory.emplace_back();
+		mHistory.back().fill(0);
+	}
+
+	void CDX12ProfileTree::AddFrame(const std::vector<SProfileScope>& scopes, uint64_t frequency)
+	{
+		if (frequency == 0) throw std::logic_error("Profile frame without a timestamp frequency");
+
+		// The node of every scope, a parent always comes first
+		std::vector<uint32_t> scopeNodes(scopes.size());
+		for (uint32_t i = 0; i < scopes.size(); ++i)
+		{
+			const auto parent = scopes[i].parent;
+			if (parent != InvalidScope && parent >= i) throw std::logic_error("Profile scope nested in a later scope");
+
+			scopeNodes[i] = Child(parent == InvalidScope ? Root : scopeNodes[parent], scopes[i].name);
+		}
+
+		std::vector<uint64_t> ticks(mNodes.size(), 0);
+		std::vector<uint32_t> calls(mNodes.size(), 0);
+
+		auto first = std::numeric_limits<uint64_t>::max();
+		uint64_t last = 0;
+		for (uint32_t i = 0; i < scopes.size(); ++i)
+		{
+			ticks[scopeNodes[i]] += Duration(scopes[i]);
+			++calls[scopeNodes[i]];
+
+			if (Duration(scopes[i]) == 0) continue;
+			first = std::min(first, scopes[i].begin);
+			last = std::max(last, scopes[i].end);
+		}
+		ticks[Root] = last > first ? last - first : 0;
+		calls[Root] = 1;
+
+		const auto slot = mFrames % HistorySize;
+		++mFrames;
+		const auto count = static_cast<uint32_t>(std::min<uint64_t>(mFrames, HistorySize));
+
+		for (uint32_t node = 0; node < mNodes.size(); ++node)
+		{
+			auto& history = mHistory[node];
+			history[slot] = static_cast<float>(static_cast<double>(ticks[node]) * 1000.0 / static_cast<double>(frequency));
+
+			auto& n = mNodes[node];
+			n.calls = calls[node];
+			n.last = history[slot];
+			n.average = 0;
+			n.minimum = std::numeric_limits<float>::max();
+			n.maximum = 0;
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				n.average += history[i];
+				n.minimum = std::min(n.minimum, history[i]);
+				n.maximum = std::max(n.maximum, history[i]);
+			}
+			n.average /= count;
+		}
+
+		mTrace.push_back({ scopes, frequency });
+		if (mTrace.size() > TraceFrames) mTrace.pop_front();
+	}
+
+	void CDX12ProfileTree::WriteChromeTrace(std::ostream& stream) const
+	{
+		// Microseconds from the first timestamp of the oldest frame
+		auto base = std::numeric_limits<uint64_t>::max();
+		if (!mTrace.empty())
+		{
+			for (const auto& scope : mTrace.front().scopes)
+			{
+				if (Duration(scope)) base = std::min(base, scope.begin);
+			}
+		}
+
+		stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"GPU\"}}";
+
+		const auto writeEvent = [&](const std::string& name, uint64_t begin, uint64_t end, uint64_t frequency, uint64_t frame)
+		{
+			const auto ts = begin >= base ? static_cast<double>(begin - base) * 1e6 / static_cast<double>(frequency) : 0.0;
+			const auto dur = static_cast<double>(end - begin) * 1e6 / static_cast<double>(frequency);
+
+			char times[96];
+			std::snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f", ts, dur);
+
+			stream << ",\n{\"name\":\"" << EscapeJson(name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1," << times
+				<< ",\"args\":{\"frame\":" << frame << "}}";
+		};
+
+		auto frame = mFrames - mTrace.size();
+		for (const auto& traceFrame : mTrace)
+		{
+			auto first = std::numeric_limits<uint64_t>::max();
+			uint64_t last = 0;
+			for (const auto& scope : traceFrame.scopes)
+			{
+				if (!Duration(scope)) continue;
+				first = std::min(first, scope.begin);
+				last = std::max(last, scope.end);
+			}
+
+			if (last > first) writeEvent(mNodes[Root].name, first, last, traceFrame.frequency, frame);
+
+			for (const auto& scope : traceFrame.scopes)
+			{
+				if (Duration(scope)) writeEvent(scope.name, scope.begin, scope.end, traceFrame.frequency, frame);
+			}
+
+			++frame;
+		}
+
+		stream << "\n]}\n";
+	}
+
+	void CDX12ProfileTree::Validate() const
+	{
+		if (mNodes.empty() || mNodes[Root].parent != InvalidScope) throw std::logic_error("The profile tree has no root");
+		if (mHistory.size() != mNodes.size()) throw std::logic_error("Profile node without a history");
+		if (mTrace.size() > TraceFrames) throw std::logic_error("Too many profile frames kept for the trace");
+
+		for (uint32_t node = 0; node < mNodes.size(); ++node)
+		{
+			for (const auto child : mNodes[node].children)
+			{
+				if (child <= node || child >= mNodes.size() || mNodes[child].parent != node)
+				{
+					throw std::logic_error("Profile node with a wrong child");
+				}
+
+				for (const auto sibling : mNodes[node].children)
+				{
+					if (sibling != child && mNodes[sibling].name == mNodes[child].name) throw std::logic_error("Profile nodes with the same name and parent");
+				}
+			}
+
+			if (node != Root)
+			{
+				const auto& siblings = mNodes[mNodes[node].parent].children;
+				if (std::find(siblings.begin(), siblings.end(), node) == siblings.end()) throw std::logic_error("Profile node missing from its parent");
+			}
+		}
+	}
+
+	uint32_t CDX12ProfileTree::Child(uint32_t parent, const std::string& name)
+	{
+		for (const auto child : mNodes[parent].children)
+		{
+			if (mNodes[child].name == name) return child;
+		}
+
+		const auto node = static_cast<uint32_t>(mNodes.size());
+		mNodes.emplace_back();
+		mNodes.back().name = name;
+		mNodes.back().parent = parent;
+		mNodes[parent].children.push_back(node);
+
+		// A new node took no time in the frames before
+		mHistory.emplace_back();
+		mHistory.back().fill(0);
+
+		return node;
+	}
+}
@@ -0,0 +1,97 @@
+//--------------------------------------------------------------------------------------
+// GPU profile aggregation
+//--------------------------------------------------------------------------------------
+// Turns the timed scopes of each frame into a tree of named nodes with rolling statistics.
+// A scope is nested in the scope that was open on its command list when it began, so the tree
+// follows the PIX events; scopes with the same name under the same parent (the faces of a
+// shadow map, the chunks of the object passes) are one node, with their times added up and
+// their number kept as the calls. The root is the whole frame, from the first timestamp to
+// the last. The last frames are also kept as they were, to be written in the Chrome trace
+// event format (chrome://tracing or Perfetto).
+// Timestamps are plain ticks at a given frequency, so the tree does not depend on D3D12 and
+// can be fed synthetic frames.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace DX12
+{
+	struct SProfileScope
+	{
+		std::string name;
+		uint32_t    parent = 0xFFFFFFFF; // Earlier scope of the frame it is nested in
+		uint64_t    begin  = 0;          // Timestamps, a scope ending before it began takes no time
+		uint64_t    end    = 0;
+	};
+
+	// Milliseconds
+	struct SProfileNode
+	{
+		std::string           name;
+		uint32_t              parent = 0xFFFFFFFF;
+		std::vector<uint32_t> children;
+		uint32_t              calls   = 0; // In the last frame
+		float                 last    = 0;
+		float                 average = 0; // Of the last HistorySize frames
+		float                 minimum = 0;
+		float                 maximum = 0;
+	};
+
+	// Sets the times of the scopes of a frame from its resolved timestamp queries, the begin and end of scope i at 2i and 2i + 1
+	void ReadTimestamps(std::vector<SProfileScope>& scopes, const uint64_t* timestamps);
+
+	class CDX12ProfileTree
+	{
+	public:
+
+		static constexpr uint32_t InvalidScope = 0xFFFFFFFF;
+		static constexpr uint32_t Root         = 0;
+		static constexpr uint32_t HistorySize  = 120;
+		static constexpr uint32_t TraceFrames  = 8;
+
+		CDX12ProfileTree(const CDX12ProfileTree&) = delete;
+		CDX12ProfileTree(const CDX12ProfileTree&&) = delete;
+		CDX12ProfileTree& operator=(const CDX12ProfileTree&) = delete;
+		CDX12ProfileTree& operator=(const CDX12ProfileTree&&) = delete;
+
+		CDX12ProfileTree();
+
+		// The frequency is in ticks per second
+		// Will throw a std::logic_error exception if a scope is nested in a later one or without a frequency
+		void AddFrame(const std::vector<SProfileScope>& scopes, uint64_t frequency);
+
+		// The root first, a node after its parent
+		const std::vector<SProfileNode>& Nodes() const { return mNodes; }
+
+		uint64_t Frames() const { return mFrames; }
+
+		// The last TraceFrames frames, all on one track as the scopes of a queue run one after the other
+		void WriteChromeTrace(std::ostream& stream) const;
+
+		// Check the nodes and their histories are consistent, throws a std::logic_error exception if not
+		void Validate() const;
+
+	private:
+
+		struct STraceFrame
+		{
+			std::vector<SProfileScope> scopes;
+			uint64_t                   frequency = 0;
+		};
+
+		// The child of the parent with the name, added if there is none
+		uint32_t Child(uint32_t parent, const std::string& name);
+
+		std::vector<SProfileNode>                   mNodes;
+		std::vector<std::array<float, HistorySize>> mHistory; // By node, milliseconds
+		uint64_t                                    mFrames = 0;
+
+		std::deque<STraceFrame> mTrace;
+	};
+}
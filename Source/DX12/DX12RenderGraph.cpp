@@ -0,0 +1,273 @@
+#include "DX12RenderGraph.h"
+
+#include <algorithm>
+
+#include "DX12CommandRecorder.h"
+#include "DX12Engine.h"
+#include "DX12Texture.h"
+
+namespace DX12
+{
+	namespace
+	{
+		bool SameDesc(const D3D12_RESOURCE_DESC& a, const D3D12_RESOURCE_DESC& b)
+		{
+			return a.Dimension == b.Dimension &&
+				a.Alignment == b.Alignment &&
+				a.Width == b.Width &&
+				a.Height == b.Height &&
+				a.DepthOrArraySize == b.DepthOrArraySize &&
+				a.MipLevels == b.MipLevels &&
+				a.Format == b.Format &&
+				a.SampleDesc.Count == b.SampleDesc.Count &&
+				a.SampleDesc.Quality == b.SampleDesc.Quality &&
+				a.Layout == b.Layout &&
+				a.Flags == b.Flags;
+		}
+	}
+
+	CDX12RenderGraph::CDX12RenderGraph(CDX12Engine* engine) :
+		mEngine(engine)
+	{
+	}
+
+	void CDX12RenderGraph::BeginFrame()
+	{
+		const auto completedValue = mEngine->mFence->GetCompletedValue();
+
+		const auto end = std::remove_if(mRetired.begin(), mRetired.end(), [&](const SRetired& retired) { return retired.fenceValue <= completedValue; });
+		mRetired.erase(end, mRetired.end());
+
+		mCompiler.Reset();
+		mResources.clear();
+		mStates.clear();
+		mTransients.clear();
+		mExecute.clear();
+	}
+
+	uint32_t CDX12RenderGraph::Import(const std::string& name, ID3D12Resource* resource, D3D12_RESOURCE_STATES& state)
+	{
+		mResources.push_back(resource);
+		mStates.push_back(&state);
+		mTransients.emplace_back();
+
+		return mCompiler.AddImported(name, state);
+	}
+
+	uint32_t CDX12RenderGraph::Import(const std::string& name, ID3D12Resource* resource, D3D12_RESOURCE_STATES& state, D3D12_RESOURCE_STATES finalState)
+	{
+		mResources.push_back(resource);
+		mStates.push_back(&state);
+		mTransients.emplace_back();
+
+		return mCompiler.AddImported(name, state, true, finalState);
+	}
+
+	uint32_t CDX12RenderGraph::Import(const std::string& name, CDX12Resource* resource)
+	{
+		return Import(name, resource->mResource.Get(), resource->mCurrentResourceState);
+	}
+
+	uint32_t CDX12RenderGraph::Import(const std::string& name, CDX12Resource* resource, D3D12_RESOURCE_STATES finalState)
+	{
+		return Import(name, resource->mResource.Get(), resource->mCurrentResourceState, finalState);
+	}
+
+	uint32_t CDX12RenderGraph::CreateTexture(const std::string& name, const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue)
+	{
+		// The heap only takes render targets and depth buffers, as on resource heap tier 1 hardware
+		if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER ||
+			!(desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)))
+		{
+			throw std::logic_error("Transient resources have to be render targets or depth buffers");
+		}
+
+		STransient transient;
+		transient.desc = desc;
+		transient.desc.Alignment = 0;
+		if (clearValue)
+		{
+			transient.clearValue = *clearValue;
+			transient.hasClearValue = true;
+		}
+
+		const auto info = mEngine->mDevice->GetResourceAllocationInfo(0, 1, &transient.desc);
+		if (info.SizeInBytes == UINT64_MAX) throw std::runtime_error("Invalid resource description");
+
+		mResources.push_back(nullptr);
+		mStates.push_back(nullptr);
+		mTransients.push_back(transient);
+
+		return mCompiler.AddTransient(name, info.SizeInBytes, info.Alignment);
+	}
+
+	uint32_t CDX12RenderGraph::AddPass(const std::string& name, ExecuteFunction execute, bool sideEffects)
+	{
+		mExecute.push_back(std::move(execute));
+		return mCompiler.AddPass(name, sideEffects);
+	}
+
+	void CDX12RenderGraph::Compile()
+	{
+		for (auto& texture : mTextures) texture.used = false;
+
+		mCompiler.Compile([this](uint32_t resource, uint64_t offset) { return Place(resource, offset); });
+
+#if defined(_DEBUG)
+		mCompiler.Validate();
+#endif
+
+		// The textures this frame does not use may still be used by the frames in flight
+		for (auto& texture : mTextures)
+		{
+			if (!texture.used) Retire(texture.resource);
+		}
+
+		const auto end = std::remove_if(mTextures.begin(), mTextures.end(), [](const STexture& texture) { return !texture.used; });
+		mTextures.erase(end, mTextures.end());
+
+		// The states after this frame, for the next one and the code outside the graph
+		for (uint32_t r = 0; r < mCompiler.NumResources(); ++r)
+		{
+			const auto state = static_cast<D3D12_RESOURCE_STATES>(mCompiler.EndState(r));
+
+			if (!mCompiler.Transient(r))
+			{
+				*mStates[r] = state;
+				continue;
+			}
+
+			for (auto& texture : mTextures)
+			{
+				if (texture.resource.Get() == mResources[r]) texture.state = state;
+			}
+		}
+	}
+
+	void CDX12RenderGraph::Execute(CDX12CommandRecorder* recorder)
+	{
+		for (uint32_t p = 0; p < mCompiler.NumPasses(); ++p)
+		{
+			if (mCompiler.Culled(p)) continue;
+
+			recorder->Add(mCompiler.PassName(p), [this, p]
+			{
+				RecordBarriers(mCompiler.Barriers(p));
+
+				// The memory was someone else's, a discard is cheaper than the clear the pass would need without it
+				for (const auto r : mCompiler.Activated(p))
+				{
+					const auto state = mCompiler.FirstState(r);
+					if (state == D3D12_RESOURCE_STATE_RENDER_TARGET || state == D3D12_RESOURCE_STATE_DEPTH_WRITE)
+					{
+						mEngine->mCurrRecordingCommandList->DiscardResource(mResources[r], nullptr);
+					}
+				}
+
+				if (mExecute[p]) mExecute[p]();
+			});
+		}
+
+		recorder->Record();
+
+		RecordBarriers(mCompiler.FinalBarriers());
+	}
+
+	RenderGraphState CDX12RenderGraph::Place(uint32_t resource, uint64_t offset)
+	{
+		if (!mHeap || mCompiler.HeapSize() > mHeapSize)
+		{
+			ResizeHeap(mCompiler.HeapSize(), mCompiler.HeapAlignment());
+		}
+
+		auto& transient = mTransients[resource];
+
+		// The same texture at the same place in the last frames
+		for (auto& texture : mTextures)
+		{
+			if (texture.used || texture.offset != offset || !SameDesc(texture.desc, transient.desc)) continue;
+
+			texture.used = true;
+			mResources[resource] = texture.resource.Get();
+			return texture.state;
+		}
+
+		STexture texture;
+		texture.desc = transient.desc;
+		texture.offset = offset;
+		texture.state = static_cast<D3D12_RESOURCE_STATES>(mCompiler.FirstState(resource));
+		texture.used = true;
+
+		if (FAILED(mEngine->mDevice->CreatePlacedResource(
+			mHeap.Get(),
+			offset,
+			&texture.desc,
+			texture.state,
+			transient.hasClearValue ? &transient.clearValue : nullptr,
+			IID_PPV_ARGS(&texture.resource))))
+		{
+			throw std::runtime_error("Error creating a transient texture");
+		}
+
+		const auto& name = mCompiler.ResourceName(resource);
+		SetName(texture.resource.Get(), std::wstring(name.begin(), name.end()).c_str());
+
+		mResources[resource] = texture.resource.Get();
+		mTextures.push_back(std::move(texture));
+
+		return mTextures.back().state;
+	}
+
+	void CDX12RenderGraph::ResizeHeap(uint64_t size, uint64_t alignment)
+	{
+		// The textures of the old heap go with it
+		for (auto& texture : mTextures) Retire(texture.resource);
+		mTextures.clear();
+
+		if (mHeap) Retire(mHeap);
+		mHeap = nullptr;
+
+		alignment = std::max<uint64_t>(alignment, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+
+		const CD3DX12_HEAP_DESC desc(ROUND_UP(size, alignment), D3D12_HEAP_TYPE_DEFAULT, alignment, D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES);
+		if (FAILED(mEngine->mDevice->CreateHeap(&desc, IID_PPV_ARGS(&mHeap))))
+		{
+			throw std::runtime_error("Error creating the transient heap");
+		}
+		SetName(mHeap.Get(), L"TransientHeap");
+
+		mHeapSize = desc.SizeInBytes;
+	}
+
+	void CDX12RenderGraph::Retire(ComPtr<ID3D12Pageable> object)
+	{
+		// The command lists being recorded are covered by the next signal
+		mRetired.push_back({ std::move(object), mEngine->mFenceValue + 1 });
+	}
+
+	void CDX12RenderGraph::RecordBarriers(const std::vector<SRenderGraphBarrier>& barriers) const
+	{
+		if (barriers.empty()) return;
+
+		std::vector<D3D12_RESOURCE_BARRIER> batch;
+		batch.reserve(barriers.size());
+
+		for (const auto& barrier : barriers)
+		{
+			if (barrier.type == SRenderGraphBarrier::EType::Aliasing)
+			{
+				const auto before = barrier.before == CDX12RenderGraphCompiler::InvalidIndex ? nullptr : mResources[barrier.before];
+				batch.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(before, mResources[barrier.resource]));
+			}
+			else
+			{
+				batch.push_back(CD3DX12_RESOURCE_BARRIER::Transition(
+					mResources[barrier.resource],
+					static_cast<D3D12_RESOURCE_STATES>(barrier.stateBefore),
+					static_cast<D3D12_RESOURCE_STATES>(barrier.stateAfter)));
+			}
+		}
+
+		mEngine->mCurrRecordingCommandList->ResourceBarrier(static_cast<UINT>(batch.size()), batch.data());
+	}
+}
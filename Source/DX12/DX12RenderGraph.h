@@ -0,0 +1,132 @@
+//--------------------------------------------------------------------------------------
+// Render graph
+//--------------------------------------------------------------------------------------
+// The passes of a frame are declared with the resources they read and write, and the
+// graph records the barriers: CDX12RenderGraphCompiler culls the passes nobody needs,
+// merges the barriers before a pass into one ResourceBarrier call and places the transient
+// textures, the render targets and depth buffers only used inside the frame, in one heap
+// where the ones never alive at the same time share memory.
+// Every pass left is a job of the command recorder, so the passes are recorded in parallel
+// and submitted in the order they were added. The passes must not record barriers of the
+// graph resources themselves. The transient textures are placed resources kept from a frame
+// to the next as long as the layout does not change; their content is undefined at the start
+// of the first pass using them, which gets them discarded and has to clear or overwrite them.
+// Imported resources keep their state in the variable given to Import, so code outside the
+// graph still finds them in the right state.
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "DX12Common.h"
+#include "DX12RenderGraphCompiler.h"
+
+namespace DX12
+{
+	class CDX12CommandRecorder;
+	class CDX12Engine;
+	class CDX12Resource;
+
+	class CDX12RenderGraph
+	{
+	public:
+
+		using ExecuteFunction = std::function<void()>;
+
+		CDX12RenderGraph() = delete;
+		CDX12RenderGraph(const CDX12RenderGraph&) = delete;
+		CDX12RenderGraph(const CDX12RenderGraph&&) = delete;
+		CDX12RenderGraph& operator=(const CDX12RenderGraph&) = delete;
+		CDX12RenderGraph& operator=(const CDX12RenderGraph&&) = delete;
+
+		explicit CDX12RenderGraph(CDX12Engine* engine);
+
+		// Start declaring the passes of a new frame, releases the heaps and textures the GPU is done with
+		void BeginFrame();
+
+		// The state is read now and written by Compile with the state the graph leaves the resource in
+		uint32_t Import(const std::string& name, ID3D12Resource* resource, D3D12_RESOURCE_STATES& state);
+
+		// Exported resources are used after the graph, they are left in the final state
+		uint32_t Import(const std::string& name, ID3D12Resource* resource, D3D12_RESOURCE_STATES& state, D3D12_RESOURCE_STATES finalState);
+
+		uint32_t Import(const std::string& name, CDX12Resource* resource);
+		uint32_t Import(const std::string& name, CDX12Resource* resource, D3D12_RESOURCE_STATES finalState);
+
+		// A render target or depth buffer only used by the passes of this frame
+		// Will throw a std::logic_error exception for other textures
+		uint32_t CreateTexture(const std::string& name, const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue = nullptr);
+
+		// Passes with side effects are never culled
+		uint32_t AddPass(const std::string& name, ExecuteFunction execute, bool sideEffects = false);
+
+		void Read(uint32_t pass, uint32_t resource, D3D12_RESOURCE_STATES state) { mCompiler.Read(pass, resource, state); }
+		void Write(uint32_t pass, uint32_t resource, D3D12_RESOURCE_STATES state) { mCompiler.Write(pass, resource, state); }
+
+		// Cull the passes, place the transient textures and work out the barriers
+		// Will throw a std::runtime_error exception if the heap or a texture can't be created
+		void Compile();
+
+		// Valid after Compile, nullptr for the transient textures no pass left uses. The views of the
+		// transient textures have to be written every frame, between Compile and Execute
+		ID3D12Resource* Resource(uint32_t resource) const { return mResources[resource]; }
+
+		// Add the passes left to the recorder and record them, then record the final barriers into the list of the calling thread
+		void Execute(CDX12CommandRecorder* recorder);
+
+		const SRenderGraphStats& Stats() const { return mCompiler.Stats(); }
+
+		const CDX12RenderGraphCompiler& Compiler() const { return mCompiler; }
+
+	private:
+
+		// Placed textures of the transient heap, kept while the frames use them
+		struct STexture
+		{
+			D3D12_RESOURCE_DESC    desc = {};
+			uint64_t               offset = 0;
+			ComPtr<ID3D12Resource> resource;
+			D3D12_RESOURCE_STATES  state = D3D12_RESOURCE_STATE_COMMON;
+			bool                   used  = false;
+		};
+
+		// Released once the GPU is done with the frames that used them
+		struct SRetired
+		{
+			ComPtr<ID3D12Pageable> object;
+			uint64_t               fenceValue = 0;
+		};
+
+		struct STransient
+		{
+			D3D12_RESOURCE_DESC desc = {};
+			D3D12_CLEAR_VALUE   clearValue = {};
+			bool                hasClearValue = false;
+		};
+
+		// Returns the state the texture is in
+		RenderGraphState Place(uint32_t resource, uint64_t offset);
+
+		void ResizeHeap(uint64_t size, uint64_t alignment);
+
+		void Retire(ComPtr<ID3D12Pageable> object);
+
+		void RecordBarriers(const std::vector<SRenderGraphBarrier>& barriers) const;
+
+		CDX12Engine*             mEngine;
+		CDX12RenderGraphCompiler mCompiler;
+
+		// Per graph resource
+		std::vector<ID3D12Resource*>        mResources;
+		std::vector<D3D12_RESOURCE_STATES*> mStates;      // Of the imported resources
+		std::vector<STransient>             mTransients;  // Of the transient textures, by graph resource
+		std::vector<ExecuteFunction>        mExecute;     // Per pass
+
+		ComPtr<ID3D12Heap>    mHeap;
+		uint64_t              mHeapSize = 0;
+		std::vector<STexture> mTextures;
+		std::vector<SRetired> mRetired;
+	};
+}
@@ -0,0 +1,496 @@
+#include "DX12RenderGraphCompiler.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace DX12
+{
+	void CDX12RenderGraphCompiler::Reset()
+	{
+		mPasses.clear();
+		mResources.clear();
+		mFinalBarriers.clear();
+		mHeapSize = 0;
+		mHeapAlignment = 1;
+		mStats = {};
+	}
+
+	uint32_t CDX12RenderGraphCompiler::AddImported(const std::string& name, RenderGraphState initialState, bool exported, RenderGraphState finalState)
+	{
+		SResource resource;
+		resource.name = name;
+		resource.exported = exported;
+		resource.initialState = initialState;
+		resource.finalState = finalState;
+
+		mResources.push_back(std::move(resource));
+		return static_cast<uint32_t>(mResources.size() - 1);
+	}
+
+	uint32_t CDX12RenderGraphCompiler::AddTransient(const std::string& name, uint64_t size, uint64_t alignment)
+	{
+		if (size == 0) throw std::logic_error("Empty transient resource");
+		if (alignment == 0 || (alignment & (alignment - 1)) != 0) throw std::logic_error("The alignment is not a power of 2");
+
+		SResource resource;
+		resource.name = name;
+		resource.transient = true;
+		resource.size = size;
+		resource.alignment = alignment;
+
+		mResources.push_back(std::move(resource));
+		return static_cast<uint32_t>(mResources.size() - 1);
+	}
+
+	uint32_t CDX12RenderGraphCompiler::AddPass(const std::string& name, bool sideEffects)
+	{
+		SPass pass;
+		pass.name = name;
+		pass.sideEffects = sideEffects;
+
+		mPasses.push_back(std::move(pass));
+		return static_cast<uint32_t>(mPasses.size() - 1);
+	}
+
+	void CDX12RenderGraphCompiler::Read(uint32_t pass, uint32_t resource, RenderGraphState state)
+	{
+		Access(pass, resource, state, false);
+	}
+
+	void CDX12RenderGraphCompiler::Write(uint32_t pass, uint32_t resource, RenderGraphState state)
+	{
+		Access(pass, resource, state, true);
+	}
+
+	void CDX12RenderGraphCompiler::Access(uint32_t pass, uint32_t resource, RenderGraphState state, bool write)
+	{
+		if (pass >= mPasses.size()) throw std::logic_error("Invalid render graph pass");
+		if (resource >= mResources.size()) throw std::logic_error("Invalid render graph resource");
+
+		auto& accesses = mPasses[pass].accesses;
+
+		const auto it = std::find_if(accesses.begin(), accesses.end(), [&](const SAccess& access) { return access.resource == resource; });
+		if (it != accesses.end())
+		{
+			it->state |= state;
+			it->write |= write;
+			return;
+		}
+
+		accesses.push_back({ resource, state, write });
+	}
+
+	void CDX12RenderGraphCompiler::Compile(const PlaceFunction& place)
+	{
+		for (auto& pass : mPasses)
+		{
+			pass.culled = false;
+			pass.barriers.clear();
+			pass.activated.clear();
+		}
+
+		for (auto& resource : mResources)
+		{
+			resource.firstPass = InvalidIndex;
+			resource.lastPass = InvalidIndex;
+			resource.offset = InvalidOffset;
+		}
+
+		mFinalBarriers.clear();
+		mStats = {};
+
+		Cull();
+		ComputeLifetimes();
+		PlaceTransients();
+		ScheduleBarriers(place);
+	}
+
+	void CDX12RenderGraphCompiler::Cull()
+	{
+		// Passes are kept by the resources they write, resources by the passes left that read them
+		std::vector<uint32_t> passReferences(mPasses.size(), 0);
+		std::vector<uint32_t> resourceReferences(mResources.size(), 0);
+		std::vector<std::vector<uint32_t>> writers(mResources.size());
+
+		for (uint32_t p = 0; p < mPasses.size(); ++p)
+		{
+			for (const auto& access : mPasses[p].accesses)
+			{
+				if (access.write)
+				{
+					++passReferences[p];
+					writers[access.resource].push_back(p);
+				}
+				else
+				{
+					++resourceReferences[access.resource];
+				}
+			}
+		}
+
+		std::vector<uint32_t> unused;
+		for (uint32_t r = 0; r < mResources.size(); ++r)
+		{
+			if (mResources[r].exported) ++resourceReferences[r];
+			if (resourceReferences[r] == 0) unused.push_back(r);
+		}
+
+		const auto cull = [&](uint32_t p)
+		{
+			mPasses[p].culled = true;
+			for (const auto& access : mPasses[p].accesses)
+			{
+				if (!access.write && --resourceReferences[access.resource] == 0) unused.push_back(access.resource);
+			}
+		};
+
+		// Passes that write nothing only matter for their side effects
+		for (uint32_t p = 0; p < mPasses.size(); ++p)
+		{
+			if (passReferences[p] == 0 && !mPasses[p].sideEffects) cull(p);
+		}
+
+		while (!unused.empty())
+		{
+			const auto r = unused.back();
+			unused.pop_back();
+
+			for (const auto p : writers[r])
+			{
+				if (mPasses[p].culled || mPasses[p].sideEffects) continue;
+				if (--passReferences[p] == 0) cull(p);
+			}
+		}
+
+		mStats.passes = static_cast<uint32_t>(mPasses.size());
+		mStats.culledPasses = static_cast<uint32_t>(std::count_if(mPasses.begin(), mPasses.end(), [](const SPass& pass) { return pass.culled; }));
+	}
+
+	void CDX12RenderGraphCompiler::ComputeLifetimes()
+	{
+		for (uint32_t p = 0; p < mPasses.size(); ++p)
+		{
+			if (mPasses[p].culled) continue;
+
+			for (const auto& access : mPasses[p].accesses)
+			{
+				auto& resource = mResources[access.resource];
+
+				if (resource.firstPass == InvalidIndex)
+				{
+					if (resource.transient && !access.write)
+					{
+						throw std::logic_error("Transient resource " + resource.name + " read before it is written");
+					}
+
+					resource.firstPass = p;
+					resource.firstState = access.state;
+				}
+
+				resource.lastPass = p;
+			}
+		}
+	}
+
+	void CDX12RenderGraphCompiler::PlaceTransients()
+	{
+		std::vector<uint32_t> order;
+		for (uint32_t r = 0; r < mResources.size(); ++r)
+		{
+			const auto& resource = mResources[r];
+			if (!resource.transient || resource.firstPass == InvalidIndex) continue;
+
+			order.push_back(r);
+			mStats.transientBytes += resource.size;
+			mHeapAlignment = std::max(mHeapAlignment, resource.alignment);
+		}
+
+		mStats.transients = static_cast<uint32_t>(order.size());
+
+		// Largest first, they are the hardest to fit in the gaps
+		std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return mResources[a].size > mResources[b].size; });
+
+		mHeapSize = 0;
+
+		std::vector<uint32_t> placed;
+		std::vector<uint32_t> alive;
+		for (const auto r : order)
+		{
+			auto& resource = mResources[r];
+
+			// The memory of the ones alive at the same time can't be shared
+			alive.clear();
+			for (const auto other : placed)
+			{
+				const auto& o = mResources[other];
+				if (o.firstPass <= resource.lastPass && resource.firstPass <= o.lastPass) alive.push_back(other);
+			}
+			std::sort(alive.begin(), alive.end(), [this](uint32_t a, uint32_t b) { return mResources[a].offset < mResources[b].offset; });
+
+			// Lowest gap big enough
+			uint64_t offset = 0;
+			for (const auto other : alive)
+			{
+				const auto& o = mResources[other];
+
+				const auto aligned = (offset + resource.alignment - 1) & ~(resource.alignment - 1);
+				if (aligned + resource.size <= o.offset) break;
+
+				offset = std::max(offset, o.offset + o.size);
+			}
+
+			resource.offset = (offset + resource.alignment - 1) & ~(resource.alignment - 1);
+			mHeapSize = std::max(mHeapSize, resource.offset + resource.size);
+
+			placed.push_back(r);
+		}
+
+		mStats.heapSize = mHeapSize;
+	}
+
+	void CDX12RenderGraphCompiler::ScheduleBarriers(const PlaceFunction& place)
+	{
+		std::vector<RenderGraphState> current(mResources.size());
+		std::vector<bool>             currentIsRead(mResources.size(), false);
+
+		for (uint32_t r = 0; r < mResources.size(); ++r)
+		{
+			auto& resource = mResources[r];
+			if (resource.transient && resource.offset != InvalidOffset)
+			{
+				resource.initialState = place ? place(r, resource.offset) : resource.firstState;
+			}
+			current[r] = resource.initialState;
+		}
+
+		// The aliasing barriers go first in a batch, the transitions of the new resource come after them
+		std::vector<std::vector<SRenderGraphBarrier>> aliasing(mPasses.size());
+		std::vector<std::vector<SRenderGraphBarrier>> transitions(mPasses.size());
+
+		const auto transition = [&](uint32_t pass, uint32_t r, RenderGraphState state, bool read)
+		{
+			if (state == current[r]) return;
+
+			// A read state already included in the current read states
+			if (read && currentIsRead[r] && state != 0 && (current[r] & state) == state) return;
+
+			SRenderGraphBarrier barrier;
+			barrier.type = SRenderGraphBarrier::EType::Transition;
+			barrier.resource = r;
+			barrier.stateBefore = current[r];
+			barrier.stateAfter = state;
+			transitions[pass].push_back(barrier);
+
+			current[r] = state;
+			currentIsRead[r] = read;
+		};
+
+		// Accesses of each resource, in pass order
+		std::vector<std::vector<std::pair<uint32_t, SAccess>>> accesses(mResources.size());
+		for (uint32_t p = 0; p < mPasses.size(); ++p)
+		{
+			if (mPasses[p].culled) continue;
+			for (const auto& access : mPasses[p].accesses) accesses[access.resource].emplace_back(p, access);
+		}
+
+		for (uint32_t r = 0; r < mResources.size(); ++r)
+		{
+			auto& resource = mResources[r];
+
+			if (resource.transient && resource.offset != InvalidOffset)
+			{
+				// The last one to use the memory before, if any in this frame
+				auto before = InvalidIndex;
+				for (uint32_t other = 0; other < mResources.size(); ++other)
+				{
+					const auto& o = mResources[other];
+					if (!o.transient || o.offset == InvalidOffset || o.lastPass >= resource.firstPass || !Overlap(resource, o)) continue;
+
+					if (before == InvalidIndex || o.lastPass > mResources[before].lastPass) before = other;
+				}
+
+				SRenderGraphBarrier barrier;
+				barrier.type = SRenderGraphBarrier::EType::Aliasing;
+				barrier.resource = r;
+				barrier.before = before;
+				aliasing[resource.firstPass].push_back(barrier);
+
+				mPasses[resource.firstPass].activated.push_back(r);
+			}
+
+			const auto& list = accesses[r];
+			for (size_t i = 0; i < list.size();)
+			{
+				const auto pass = list[i].first;
+
+				if (list[i].second.write)
+				{
+					transition(pass, r, list[i].second.state, false);
+					++i;
+					continue;
+				}
+
+				// One transition to every state of the reads in a row
+				RenderGraphState state = 0;
+				auto j = i;
+				for (; j < list.size() && !list[j].second.write; ++j) state |= list[j].second.state;
+
+				transition(pass, r, state, true);
+				i = j;
+			}
+
+			if (resource.exported && current[r] != resource.finalState)
+			{
+				SRenderGraphBarrier barrier;
+				barrier.type = SRenderGraphBarrier::EType::Transition;
+				barrier.resource = r;
+				barrier.stateBefore = current[r];
+				barrier.stateAfter = resource.finalState;
+				mFinalBarriers.push_back(barrier);
+
+				current[r] = resource.finalState;
+			}
+
+			resource.endState = current[r];
+		}
+
+		for (uint32_t p = 0; p < mPasses.size(); ++p)
+		{
+			auto& barriers = mPasses[p].barriers;
+			barriers = std::move(aliasing[p]);
+			barriers.insert(barriers.end(), transitions[p].begin(), transitions[p].end());
+
+			for (const auto& barrier : barriers)
+			{
+				if (barrier.type == SRenderGraphBarrier::EType::Aliasing) ++mStats.aliasing;
+				else ++mStats.transitions;
+			}
+
+			if (!barriers.empty()) ++mStats.batches;
+		}
+
+		mStats.transitions += static_cast<uint32_t>(mFinalBarriers.size());
+		if (!mFinalBarriers.empty()) ++mStats.batches;
+	}
+
+	bool CDX12RenderGraphCompiler::Overlap(const SResource& a, const SResource& b)
+	{
+		return a.offset < b.offset + b.size && b.offset < a.offset + a.size;
+	}
+
+	void CDX12RenderGraphCompiler::Validate() const
+	{
+		// Placement
+		for (uint32_t r = 0; r < mResources.size(); ++r)
+		{
+			const auto& resource = mResources[r];
+			if (!resource.transient || resource.firstPass == InvalidIndex) continue;
+
+			if (resource.offset == InvalidOffset) throw std::logic_error("Transient resource used but not placed");
+			if (resource.offset & (resource.alignment - 1)) throw std::logic_error("Transient resource not aligned");
+			if (resource.offset + resource.size > mHeapSize) throw std::logic_error("Transient resource outside the heap");
+
+			for (uint32_t other = r + 1; other < mResources.size(); ++other)
+			{
+				const auto& o = mResources[other];
+				if (!o.transient || o.firstPass == InvalidIndex) continue;
+
+				const auto alive = o.firstPass <= resource.lastPass && resource.firstPass <= o.lastPass;
+				if (alive && Overlap(resource, o)) throw std::logic_error("Transient resources alive at the same time share memory");
+			}
+		}
+
+		// Culling: what the passes left read must not come from a culled pass
+		std::vector<bool> writtenByCulled(mResources.size(), false);
+		for (const auto& pass : mPasses)
+		{
+			if (!pass.culled) continue;
+
+			if (!pass.barriers.empty() || !pass.activated.empty()) throw std::logic_error("Culled pass with barriers");
+
+			for (const auto& access : pass.accesses)
+			{
+				if (!access.write) continue;
+				if (mResources[access.resource].exported) throw std::logic_error("Culled pass writes an exported resource");
+				writtenByCulled[access.resource] = true;
+			}
+		}
+
+		for (const auto& pass : mPasses)
+		{
+			if (pass.culled) continue;
+			for (const auto& access : pass.accesses)
+			{
+				if (!access.write && writtenByCulled[access.resource]) throw std::logic_error("Pass reads a resource written by a culled pass");
+			}
+		}
+
+		// Replay the barriers and check every access finds its resource in the right state
+		std::vector<RenderGraphState> current(mResources.size());
+		std::vector<uint32_t>         activations(mResources.size(), 0);
+		for (uint32_t r = 0; r < mResources.size(); ++r) current[r] = mResources[r].initialState;
+
+		const auto apply = [&](const SRenderGraphBarrier& barrier, uint32_t pass)
+		{
+			if (barrier.resource >= mResources.size()) throw std::logic_error("Barrier of an invalid resource");
+
+			if (barrier.type == SRenderGraphBarrier::EType::Aliasing)
+			{
+				const auto& resource = mResources[barrier.resource];
+				if (!resource.transient || resource.firstPass != pass) throw std::logic_error("Aliasing barrier outside the first use of a transient");
+				if (barrier.before != InvalidIndex && mResources[barrier.before].lastPass >= pass) throw std::logic_error("Aliasing barrier takes the memory of a resource still alive");
+				++activations[barrier.resource];
+				return;
+			}
+
+			if (barrier.stateBefore != current[barrier.resource]) throw std::logic_error("Barrier from the wrong state");
+			if (barrier.stateBefore == barrier.stateAfter) throw std::logic_error("Barrier to the same state");
+			current[barrier.resource] = barrier.stateAfter;
+		};
+
+		for (uint32_t p = 0; p < mPasses.size(); ++p)
+		{
+			const auto& pass = mPasses[p];
+			if (pass.culled) continue;
+
+			// Merged: one transition per resource in the batch of a pass, the reads of a pass share it
+			std::vector<bool> transitioned(mResources.size(), false);
+			for (const auto& barrier : pass.barriers)
+			{
+				if (barrier.type != SRenderGraphBarrier::EType::Transition) continue;
+				if (transitioned[barrier.resource]) throw std::logic_error("Resource transitioned twice before pass " + pass.name);
+				transitioned[barrier.resource] = true;
+			}
+
+			// Discarded: the transients first used by the pass, and only those, are activated before it
+			for (uint32_t r = 0; r < mResources.size(); ++r)
+			{
+				const auto first = mResources[r].transient && mResources[r].firstPass == p;
+				const auto activated = std::count(pass.activated.begin(), pass.activated.end(), r);
+				if (activated != (first ? 1 : 0)) throw std::logic_error("Transient " + mResources[r].name + " not activated on its first use");
+			}
+
+			for (const auto& barrier : pass.barriers) apply(barrier, p);
+
+			for (const auto& access : pass.accesses)
+			{
+				const auto state = current[access.resource];
+				const auto ok = access.write || access.state == 0 ? state == access.state : (state & access.state) == access.state;
+				if (!ok) throw std::logic_error("Pass " + pass.name + " uses " + mResources[access.resource].name + " in the wrong state");
+			}
+		}
+
+		for (const auto& barrier : mFinalBarriers) apply(barrier, InvalidIndex);
+
+		for (uint32_t r = 0; r < mResources.size(); ++r)
+		{
+			const auto& resource = mResources[r];
+
+			if (resource.exported && current[r] != resource.finalState) throw std::logic_error("Exported resource not in its final state");
+			if (current[r] != resource.endState) throw std::logic_error("Wrong end state");
+
+			const auto used = resource.transient && resource.firstPass != InvalidIndex;
+			if (activations[r] != (used ? 1u : 0u)) throw std::logic_error("Transient resource not activated once");
+		}
+	}
+}
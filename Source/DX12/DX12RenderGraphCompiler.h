@@ -0,0 +1,186 @@
+//--------------------------------------------------------------------------------------
+// Render graph compiler
+//--------------------------------------------------------------------------------------
+// The bookkeeping of CDX12RenderGraph, kept apart from D3D12 so it can be driven (and
+// tested) without a device. States are opaque bit masks (D3D12_RESOURCE_STATES for the
+// DX12 graph), 0 being the common state.
+// Passes declare the resources they read and write. Compile culls the passes whose writes
+// nobody reads, works out when each transient resource is first and last used, places the
+// transients in one heap so that the ones never alive at the same time share memory, and
+// gathers every barrier needed before a pass into one batch. Passes run in the order they
+// were added. Consecutive reads of a resource are merged into one transition to all their
+// states. Consecutive writes in the same state get no barrier, so UAV writes are not supported.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace DX12
+{
+	using RenderGraphState = uint32_t;
+
+	struct SRenderGraphBarrier
+	{
+		enum class EType : uint32_t
+		{
+			Transition,
+			Aliasing // Makes resource the one using its memory, before is the previous user or InvalidIndex if unknown
+		};
+
+		EType            type     = EType::Transition;
+		uint32_t         resource = 0;
+		uint32_t         before   = 0xFFFFFFFF;
+		RenderGraphState stateBefore = 0;
+		RenderGraphState stateAfter  = 0;
+	};
+
+	struct SRenderGraphStats
+	{
+		uint32_t passes         = 0;
+		uint32_t culledPasses   = 0;
+		uint32_t transitions    = 0;
+		uint32_t aliasing       = 0;
+		uint32_t batches        = 0; // ResourceBarrier calls
+		uint32_t transients     = 0; // Used by the passes left
+		uint64_t transientBytes = 0; // What the transients would take without aliasing
+		uint64_t heapSize       = 0; // What they take
+	};
+
+	class CDX12RenderGraphCompiler
+	{
+	public:
+
+		static constexpr uint32_t InvalidIndex  = 0xFFFFFFFF;
+		static constexpr uint64_t InvalidOffset = 0xFFFFFFFFFFFFFFFF;
+
+		// Called by Compile for every transient used, with the offset picked for it
+		// Returns the state the resource is in at the start of the frame
+		using PlaceFunction = std::function<RenderGraphState(uint32_t resource, uint64_t offset)>;
+
+		CDX12RenderGraphCompiler() = default;
+		CDX12RenderGraphCompiler(const CDX12RenderGraphCompiler&) = delete;
+		CDX12RenderGraphCompiler(const CDX12RenderGraphCompiler&&) = delete;
+		CDX12RenderGraphCompiler& operator=(const CDX12RenderGraphCompiler&) = delete;
+		CDX12RenderGraphCompiler& operator=(const CDX12RenderGraphCompiler&&) = delete;
+
+		// Forget the passes and the resources of the last frame
+		void Reset();
+
+		// A resource that lives outside the graph. Exported ones are used after the graph, which keeps
+		// the passes writing them and leaves them in the final state
+		uint32_t AddImported(const std::string& name, RenderGraphState initialState, bool exported = false, RenderGraphState finalState = 0);
+
+		// A resource only used by the passes of the frame, the alignment has to be a power of 2
+		// Will throw a std::logic_error exception on invalid arguments
+		uint32_t AddTransient(const std::string& name, uint64_t size, uint64_t alignment);
+
+		// Passes with side effects are never culled
+		uint32_t AddPass(const std::string& name, bool sideEffects = false);
+
+		// Several accesses of a pass to one resource are combined
+		// Will throw a std::logic_error exception on invalid indices
+		void Read(uint32_t pass, uint32_t resource, RenderGraphState state);
+		void Write(uint32_t pass, uint32_t resource, RenderGraphState state);
+
+		// Without a place function the transients start in the state of their first use
+		// Will throw a std::logic_error exception if a transient is read before it is written
+		void Compile(const PlaceFunction& place = nullptr);
+
+		//--------------------------
+		// Results of Compile
+		//--------------------------
+
+		uint32_t           NumPasses() const { return static_cast<uint32_t>(mPasses.size()); }
+		uint32_t           NumResources() const { return static_cast<uint32_t>(mResources.size()); }
+		const std::string& PassName(uint32_t pass) const { return mPasses[pass].name; }
+		const std::string& ResourceName(uint32_t resource) const { return mResources[resource].name; }
+		bool               Transient(uint32_t resource) const { return mResources[resource].transient; }
+
+		bool Culled(uint32_t pass) const { return mPasses[pass].culled; }
+
+		// To record before the pass
+		const std::vector<SRenderGraphBarrier>& Barriers(uint32_t pass) const { return mPasses[pass].barriers; }
+
+		// To record after the last pass, they move the exported resources to their final state
+		const std::vector<SRenderGraphBarrier>& FinalBarriers() const { return mFinalBarriers; }
+
+		// Transients whose memory is taken over before the pass, their content is undefined
+		const std::vector<uint32_t>& Activated(uint32_t pass) const { return mPasses[pass].activated; }
+
+		// Offset in the transient heap, InvalidOffset for the transients no pass left uses
+		uint64_t Offset(uint32_t resource) const { return mResources[resource].offset; }
+
+		RenderGraphState FirstState(uint32_t resource) const { return mResources[resource].firstState; }
+
+		// The state the resource is left in after the final barriers
+		RenderGraphState EndState(uint32_t resource) const { return mResources[resource].endState; }
+
+		uint64_t HeapSize() const { return mHeapSize; }
+
+		uint64_t HeapAlignment() const { return mHeapAlignment; }
+
+		const SRenderGraphStats& Stats() const { return mStats; }
+
+		// Check the lifetimes, the placement and the barriers of the last Compile are consistent
+		// Throws a std::logic_error exception if not
+		void Validate() const;
+
+	private:
+
+		struct SAccess
+		{
+			uint32_t         resource = 0;
+			RenderGraphState state    = 0;
+			bool             write    = false;
+		};
+
+		struct SPass
+		{
+			std::string          name;
+			bool                 sideEffects = false;
+			std::vector<SAccess> accesses;
+
+			bool                             culled = false;
+			std::vector<SRenderGraphBarrier> barriers;
+			std::vector<uint32_t>            activated;
+		};
+
+		struct SResource
+		{
+			std::string      name;
+			bool             transient = false;
+			bool             exported  = false;
+			uint64_t         size      = 0;
+			uint64_t         alignment = 1;
+			RenderGraphState initialState = 0;
+			RenderGraphState finalState   = 0;
+
+			uint32_t         firstPass  = InvalidIndex; // Among the passes left
+			uint32_t         lastPass   = InvalidIndex;
+			uint64_t         offset     = InvalidOffset;
+			RenderGraphState firstState = 0;
+			RenderGraphState endState   = 0;
+		};
+
+		void Access(uint32_t pass, uint32_t resource, RenderGraphState state, bool write);
+
+		void Cull();
+		void ComputeLifetimes();
+		void PlaceTransients();
+		void ScheduleBarriers(const PlaceFunction& place);
+
+		static bool Overlap(const SResource& a, const SResource& b);
+
+		std::vector<SPass>     mPasses;
+		std::vector<SResource> mResources;
+
+		std::vector<SRenderGraphBarrier> mFinalBarriers;
+
+		uint64_t          mHeapSize      = 0;
+		uint64_t          mHeapAlignment = 1;
+		SRenderGraphStats mStats;
+	};
+}
@@ -0,0 +1,277 @@
+#include "DX12ResourceAllocator.h"
+
+#include <algorithm>
+
+#include "DX12Engine.h"
+
+namespace DX12
+{
+	namespace
+	{
+		// {9B1C4E3A-6C2F-4F58-A3B4-2E5D7C8F1A60}
+		const GUID AllocationOwnerGuid = { 0x9b1c4e3a, 0x6c2f, 0x4f58, { 0xa3, 0xb4, 0x2e, 0x5d, 0x7c, 0x8f, 0x1a, 0x60 } };
+
+		// Attached to the resources (or buffer ranges), gives the memory back when the last reference is released
+		class CAllocationOwner final : public IUnknown
+		{
+		public:
+
+			CAllocationOwner(std::weak_ptr<CDX12ResourceAllocator> allocator, const SGpuAllocation& allocation, ComPtr<IUnknown> memory) :
+				mAllocator(std::move(allocator)),
+				mAllocation(allocation),
+				mMemory(std::move(memory))
+			{
+			}
+
+			HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+			{
+				if (!object) return E_POINTER;
+
+				if (riid == __uuidof(IUnknown))
+				{
+					*object = static_cast<IUnknown*>(this);
+					AddRef();
+					return S_OK;
+				}
+
+				*object = nullptr;
+				return E_NOINTERFACE;
+			}
+
+			ULONG STDMETHODCALLTYPE AddRef() override
+			{
+				return static_cast<ULONG>(InterlockedIncrement(&mReferences));
+			}
+
+			ULONG STDMETHODCALLTYPE Release() override
+			{
+				const auto references = static_cast<ULONG>(InterlockedDecrement(&mReferences));
+				if (references == 0)
+				{
+					// The allocator may be gone already, its heaps are then released with the last owners
+					if (const auto allocator = mAllocator.lock()) allocator->Free(mAllocation);
+					delete this;
+				}
+				return references;
+			}
+
+		private:
+
+			LONG                                  mReferences = 1;
+			std::weak_ptr<CDX12ResourceAllocator> mAllocator;
+			SGpuAllocation                        mAllocation;
+			ComPtr<IUnknown>                      mMemory; // Heap or buffer the allocation is in
+		};
+
+		EGpuHeapType HeapType(D3D12_HEAP_TYPE type)
+		{
+			switch (type)
+			{
+			case D3D12_HEAP_TYPE_DEFAULT:  return EGpuHeapType::Default;
+			case D3D12_HEAP_TYPE_UPLOAD:   return EGpuHeapType::Upload;
+			case D3D12_HEAP_TYPE_READBACK: return EGpuHeapType::Readback;
+			default: throw std::runtime_error("Custom heaps are not supported by the resource allocator");
+			}
+		}
+
+		D3D12_HEAP_TYPE HeapType(EGpuHeapType type)
+		{
+			switch (type)
+			{
+			case EGpuHeapType::Upload:   return D3D12_HEAP_TYPE_UPLOAD;
+			case EGpuHeapType::Readback: return D3D12_HEAP_TYPE_READBACK;
+			default:                     return D3D12_HEAP_TYPE_DEFAULT;
+			}
+		}
+	}
+
+	CDX12ResourceAllocator::CDX12ResourceAllocator(CDX12Engine* engine, uint64_t heapSize) :
+		mEngine(engine),
+		mAllocator(this, heapSize)
+	{
+	}
+
+	ComPtr<ID3D12Resource> CDX12ResourceAllocator::CreateResource(D3D12_HEAP_TYPE          heapType,
+	                                                              D3D12_RESOURCE_DESC      desc,
+	                                                              D3D12_RESOURCE_STATES    initialState,
+	                                                              const D3D12_CLEAR_VALUE* clearValue)
+	{
+		const auto device = mEngine->mDevice.Get();
+
+		auto category = EGpuResourceCategory::Texture;
+		if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+			category = EGpuResourceCategory::Buffer;
+		else if (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+			category = EGpuResourceCategory::RenderTarget;
+
+		// Only render targets and depth buffers take a clear value, the textures created like them don't need one
+		if (category != EGpuResourceCategory::RenderTarget) clearValue = nullptr;
+
+		// Small textures can be placed at 4KB instead of 64KB if the device agrees
+		D3D12_RESOURCE_ALLOCATION_INFO info = {};
+		if (category == EGpuResourceCategory::Texture && desc.SampleDesc.Count <= 1)
+		{
+			desc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+			info = device->GetResourceAllocationInfo(0, 1, &desc);
+		}
+		if (info.Alignment != D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT)
+		{
+			desc.Alignment = 0;
+			info = device->GetResourceAllocationInfo(0, 1, &desc);
+		}
+
+		if (info.SizeInBytes == UINT64_MAX) throw std::runtime_error("Invalid resource description");
+
+		const auto allocation = mAllocator.Allocate(HeapType(heapType), category, info.SizeInBytes, info.Alignment);
+		const auto heap = static_cast<SHeap*>(allocation.heap);
+
+		ComPtr<ID3D12Resource> resource;
+		if (FAILED(device->CreatePlacedResource(heap->heap.Get(), allocation.offset, &desc, initialState, clearValue, IID_PPV_ARGS(&resource))))
+		{
+			mAllocator.Free(allocation);
+			throw std::runtime_error("Error creating a placed resource");
+		}
+
+		ComPtr<IUnknown> owner;
+		owner.Attach(new CAllocationOwner(weak_from_this(), allocation, heap->heap));
+		ThrowIfFailed(resource->SetPrivateDataInterface(AllocationOwnerGuid, owner.Get()));
+
+		{
+			std::unique_lock l(mMutex);
+			mResources.push_back(resource);
+		}
+
+		return resource;
+	}
+
+	ComPtr<ID3D12Resource> CDX12ResourceAllocator::CreateBuffer(D3D12_HEAP_TYPE       heapType,
+	                                                            uint64_t              size,
+	                                                            D3D12_RESOURCE_STATES initialState,
+	                                                            D3D12_RESOURCE_FLAGS  flags)
+	{
+		return CreateResource(heapType, CD3DX12_RESOURCE_DESC::Buffer(size, flags), initialState);
+	}
+
+	SDX12BufferRange CDX12ResourceAllocator::AllocateConstants(uint64_t size)
+	{
+		const auto allocation = mAllocator.Allocate(EGpuHeapType::Upload,
+		                                            EGpuResourceCategory::SubBuffer,
+		                                            ROUND_UP(size, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT),
+		                                            D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+		const auto heap = static_cast<SHeap*>(allocation.heap);
+
+		SDX12BufferRange range;
+		range.resource = heap->buffer.Get();
+		range.offset = allocation.offset;
+		range.size = allocation.size;
+		range.cpu = heap->cpu + allocation.offset;
+		range.gpu = heap->buffer->GetGPUVirtualAddress() + allocation.offset;
+		range.owner.Attach(new CAllocationOwner(weak_from_this(), allocation, heap->buffer));
+
+		return range;
+	}
+
+	void CDX12ResourceAllocator::ProcessDeferredFrees()
+	{
+		const auto completedValue = mEngine->mFence->GetCompletedValue();
+
+		// Released once the lock is, the owners of the placed resources call Free
+		std::vector<SRetired> released;
+		{
+			std::unique_lock l(mMutex);
+
+			for (auto& resource : mResources)
+			{
+				// Only this reference left: the last frames that used it may still be in flight
+				resource->AddRef();
+				if (resource->Release() == 1) RetireLocked(std::move(resource));
+			}
+			mResources.erase(std::remove(mResources.begin(), mResources.end(), nullptr), mResources.end());
+
+			const auto end = std::partition(mRetired.begin(), mRetired.end(), [&](const SRetired& retired) { return retired.fenceValue > completedValue; });
+			released.assign(std::make_move_iterator(end), std::make_move_iterator(mRetired.end()));
+			mRetired.erase(end, mRetired.end());
+		}
+		released.clear();
+
+		mAllocator.ProcessDeferredFrees();
+	}
+
+	void CDX12ResourceAllocator::Retire(ComPtr<ID3D12Pageable> object)
+	{
+		if (!object) return;
+
+		std::unique_lock l(mMutex);
+		RetireLocked(std::move(object));
+	}
+
+	void CDX12ResourceAllocator::RetireLocked(ComPtr<ID3D12Pageable> object)
+	{
+		// The command lists being recorded are covered by the next signal
+		mRetired.push_back({ std::move(object), mEngine->mFenceValue + 1 });
+	}
+
+	void CDX12ResourceAllocator::Free(const SGpuAllocation& allocation)
+	{
+		// The command lists being recorded are covered by the next signal
+		mAllocator.Free(allocation, mEngine->mFenceValue + 1);
+	}
+
+	void* CDX12ResourceAllocator::CreateHeap(EGpuHeapType type, EGpuResourceCategory category, uint64_t size)
+	{
+		const auto device = mEngine->mDevice.Get();
+		const auto properties = CD3DX12_HEAP_PROPERTIES(HeapType(type));
+
+		auto heap = std::make_unique<SHeap>();
+
+		if (category == EGpuResourceCategory::SubBuffer)
+		{
+			// A single buffer the ranges are taken from, CPU visible ones stay mapped
+			const auto buffer = CD3DX12_RESOURCE_DESC::Buffer(size);
+			const auto state = type == EGpuHeapType::Upload   ? D3D12_RESOURCE_STATE_GENERIC_READ :
+			                   type == EGpuHeapType::Readback ? D3D12_RESOURCE_STATE_COPY_DEST : D3D12_RESOURCE_STATE_COMMON;
+
+			ThrowIfFailed(device->CreateCommittedResource(
+				&properties,
+				D3D12_HEAP_FLAG_NONE,
+				&buffer,
+				state,
+				nullptr,
+				IID_PPV_ARGS(&heap->buffer)));
+			SetName(heap->buffer.Get(), L"SubBufferHeap");
+
+			if (type != EGpuHeapType::Default)
+			{
+				const CD3DX12_RANGE readRange(0, 0);
+				ThrowIfFailed(heap->buffer->Map(0, &readRange, reinterpret_cast<void**>(&heap->cpu)));
+			}
+		}
+		else
+		{
+			D3D12_HEAP_DESC desc = {};
+			desc.Properties = properties;
+			desc.Alignment = category == EGpuResourceCategory::RenderTarget ? D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+			desc.SizeInBytes = ROUND_UP(size, desc.Alignment);
+			desc.Flags = category == EGpuResourceCategory::Buffer  ? D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS :
+			             category == EGpuResourceCategory::Texture ? D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES : D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+
+			if (FAILED(device->CreateHeap(&desc, IID_PPV_ARGS(&heap->heap))))
+			{
+				throw std::runtime_error("Error creating a resource heap");
+			}
+			SetName(heap->heap.Get(), L"ResourceHeap");
+		}
+
+		return heap.release();
+	}
+
+	void CDX12ResourceAllocator::DestroyHeap(void* heap)
+	{
+		delete static_cast<SHeap*>(heap);
+	}
+
+	uint64_t CDX12ResourceAllocator::CompletedFenceValue()
+	{
+		return mEngine->mFence->GetCompletedValue();
+	}
+}
@@ -0,0 +1,119 @@
+//--------------------------------------------------------------------------------------
+// Placed resources sub-allocated from shared heaps
+//--------------------------------------------------------------------------------------
+// The D3D12 side of CDX12HeapAllocator: heaps are ID3D12Heaps (or persistently mapped
+// buffers for the constant buffer ranges) and resources are placed in them. The callers
+// still get a plain ComPtr<ID3D12Resource>: an owner object is attached to the resource as
+// private data, and when the resource is destroyed the owner gives the memory back to the
+// allocator, once the frame fence passes the work that may still use it.
+// The allocator keeps a reference to every placed resource too. When it is the last one left
+// the resource is retired: kept until the frame fence passes the work recorded with it, so
+// the callers can drop or replace a resource the frames in flight still use. Anything else
+// that has to outlive those frames can be given to Retire.
+// Owners only keep a weak reference to the allocator and a reference to their heap, so
+// resources released after the engine (e.g. by the object manager) are still safe.
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "DX12Common.h"
+#include "DX12HeapAllocator.h"
+
+namespace DX12
+{
+	class CDX12Engine;
+
+	// Range of a shared upload buffer, released when the owner is
+	struct SDX12BufferRange
+	{
+		ID3D12Resource*           resource = nullptr;
+		uint64_t                  offset   = 0;
+		uint64_t                  size     = 0;
+		uint8_t*                  cpu      = nullptr;
+		D3D12_GPU_VIRTUAL_ADDRESS gpu      = 0;
+		ComPtr<IUnknown>          owner;
+	};
+
+	class CDX12ResourceAllocator final : public IGpuHeapSource, public std::enable_shared_from_this<CDX12ResourceAllocator>
+	{
+	public:
+
+		CDX12ResourceAllocator() = delete;
+		CDX12ResourceAllocator(const CDX12ResourceAllocator&) = delete;
+		CDX12ResourceAllocator(const CDX12ResourceAllocator&&) = delete;
+		CDX12ResourceAllocator& operator=(const CDX12ResourceAllocator&) = delete;
+		CDX12ResourceAllocator& operator=(const CDX12ResourceAllocator&&) = delete;
+
+		explicit CDX12ResourceAllocator(CDX12Engine* engine, uint64_t heapSize = CDX12HeapAllocator::DefaultHeapSize);
+
+		~CDX12ResourceAllocator() override = default;
+
+		// Will throw a std::runtime_error exception on failure
+		ComPtr<ID3D12Resource> CreateResource(D3D12_HEAP_TYPE            heapType,
+		                                      D3D12_RESOURCE_DESC        desc,
+		                                      D3D12_RESOURCE_STATES      initialState,
+		                                      const D3D12_CLEAR_VALUE*   clearValue = nullptr);
+
+		ComPtr<ID3D12Resource> CreateBuffer(D3D12_HEAP_TYPE       heapType,
+		                                    uint64_t              size,
+		                                    D3D12_RESOURCE_STATES initialState,
+		                                    D3D12_RESOURCE_FLAGS  flags = D3D12_RESOURCE_FLAG_NONE);
+
+		// Persistently mapped upload memory for a constant buffer, aligned to 256 bytes
+		SDX12BufferRange AllocateConstants(uint64_t size);
+
+		// Retires the resources nobody else refers to anymore, releases the retired objects and frees the memory
+		// the GPU is done with
+		void ProcessDeferredFrees();
+
+		// Keeps the object until the work submitted so far and the command lists being recorded are done
+		void Retire(ComPtr<ID3D12Pageable> object);
+
+		SGpuHeapStats Stats() const { return mAllocator.Stats(); }
+
+		CDX12HeapAllocator& Allocator() { return mAllocator; }
+
+		// Called by the owners, frees after the work submitted so far and the command lists being recorded
+		void Free(const SGpuAllocation& allocation);
+
+		//--------------------------
+		// IGpuHeapSource
+		//--------------------------
+
+		void* CreateHeap(EGpuHeapType type, EGpuResourceCategory category, uint64_t size) override;
+
+		void DestroyHeap(void* heap) override;
+
+		uint64_t CompletedFenceValue() override;
+
+	private:
+
+		// One of the two, depending on the category
+		struct SHeap
+		{
+			ComPtr<ID3D12Heap>     heap;
+			ComPtr<ID3D12Resource> buffer;
+			uint8_t*               cpu = nullptr;
+		};
+
+		// The mutex has to be locked
+		void RetireLocked(ComPtr<ID3D12Pageable> object);
+
+		struct SRetired
+		{
+			ComPtr<ID3D12Pageable> object;
+			uint64_t               fenceValue = 0;
+		};
+
+		CDX12Engine*       mEngine;
+		CDX12HeapAllocator mAllocator;
+
+		// The placed resources, created and released on any thread
+		std::mutex                          mMutex;
+		std::vector<ComPtr<ID3D12Resource>> mResources;
+		std::vector<SRetired>               mRetired;
+	};
+}
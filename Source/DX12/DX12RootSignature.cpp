@@ -3,6 +3,7 @@
 #include "CommonStates.h"
 
 #include "DX12Engine.h"
+#include "DX12PipelineTable.h"
 
 namespace DX12
 {
@@ -42,6 +43,8 @@ namespace DX12
 			rootSignatureBlob->GetBufferSize(), IID_PPV_ARGS(&mRootSignature)));
 
 		NAME_D3D12_OBJECT(mRootSignature);
+
+		mHash = HashBytes(rootSignatureBlob->GetBufferPointer(), rootSignatureBlob->GetBufferSize());
 	}
 
 	ID3D12RootSignature* CDX12RootSignature::Get()
@@ -59,33 +62,28 @@ namespace DX12
 			D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
 			D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
 
-		constexpr auto numTextures = 8;
+		// Every texture of the heap with the material records (see DX12MaterialTable.h), ambient and shadow maps, instance records
+		constexpr auto numTextures = 5;
 		constexpr auto numConstantBuffers = 6;
 
 		// constant root parameters that are used by the vertex shader.
 		CD3DX12_DESCRIPTOR_RANGE1 ranges[numTextures + numConstantBuffers] = {};
 		CD3DX12_ROOT_PARAMETER1   rootParameters[numTextures + numConstantBuffers] = {};
 
-		ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
-		ranges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 1, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 		ranges[2].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 2, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 		ranges[3].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 3, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 		ranges[4].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 4, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 		ranges[5].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 5, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 
-		ranges[ 6].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
-		ranges[ 7].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
-		ranges[ 8].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 2, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
-		ranges[ 9].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 3, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
-		ranges[10].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 4, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
-		ranges[11].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 5, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
-		ranges[12].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 6, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
-		ranges[13].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 7, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
+		// The whole heap in space 1: views are never rewritten while the frames are in flight, the slots not written yet are never read
+		ranges[6].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 1, D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE | D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE, 0);
+		ranges[8].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 6, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
+		ranges[9].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 7, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 
 		// Create root parameters
 		// CB
-		rootParameters[0].InitAsDescriptorTable(1, &ranges[0]);
-		rootParameters[1].InitAsDescriptorTable(1, &ranges[1]);
+		rootParameters[0].InitAsConstants(1, 0); // Per draw, the index of the instance record
+		rootParameters[1].InitAsConstantBufferView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE); // Per view, from the upload allocator
 		rootParameters[2].InitAsDescriptorTable(1, &ranges[2]);
 		rootParameters[3].InitAsDescriptorTable(1, &ranges[3]);
 		rootParameters[4].InitAsDescriptorTable(1, &ranges[4]);
@@ -93,13 +91,10 @@ namespace DX12
 
 		// SRV
 		rootParameters[6].InitAsDescriptorTable(1, &ranges[6], D3D12_SHADER_VISIBILITY_PIXEL);
-		rootParameters[7].InitAsDescriptorTable(1, &ranges[7], D3D12_SHADER_VISIBILITY_PIXEL);
+		rootParameters[7].InitAsShaderResourceView(8, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE, D3D12_SHADER_VISIBILITY_PIXEL); // Material records, one buffer per frame
 		rootParameters[8].InitAsDescriptorTable(1, &ranges[8], D3D12_SHADER_VISIBILITY_PIXEL);
 		rootParameters[9].InitAsDescriptorTable(1, &ranges[9], D3D12_SHADER_VISIBILITY_PIXEL);
-		rootParameters[10].InitAsDescriptorTable(1, &ranges[10], D3D12_SHADER_VISIBILITY_PIXEL);
-		rootParameters[11].InitAsDescriptorTable(1, &ranges[11], D3D12_SHADER_VISIBILITY_PIXEL);
-		rootParameters[12].InitAsDescriptorTable(1, &ranges[12], D3D12_SHADER_VISIBILITY_PIXEL);
-		rootParameters[13].InitAsDescriptorTable(1, &ranges[13], D3D12_SHADER_VISIBILITY_PIXEL);
+		rootParameters[10].InitAsShaderResourceView(9, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE); // Instance records, one buffer per frame
 
 
 		D3D12_STATIC_SAMPLER_DESC samplers[] =
@@ -134,8 +129,6 @@ namespace DX12
 
 		// Create descriptor ranges
 
-		ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
-		ranges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 1, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 		ranges[2].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 2, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 		ranges[3].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 3, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 		ranges[4].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 4, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
@@ -145,8 +138,8 @@ namespace DX12
 
 		// Create root parameters
 		// CB
-		rootParameters[0].InitAsDescriptorTable(1, &ranges[0]);
-		rootParameters[1].InitAsDescriptorTable(1, &ranges[1]);
+		rootParameters[0].InitAsConstantBufferView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE); // Per model, from the upload allocator
+		rootParameters[1].InitAsConstantBufferView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE); // Per view, from the upload allocator
 		rootParameters[2].InitAsDescriptorTable(1, &ranges[2]);
 		rootParameters[3].InitAsDescriptorTable(1, &ranges[3]);
 		rootParameters[4].InitAsDescriptorTable(1, &ranges[4]);
@@ -183,8 +176,6 @@ namespace DX12
 
 		// Create descriptor ranges
 
-		ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0);
-		ranges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 1);
 		ranges[2].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 2);
 		ranges[3].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 3);
 		ranges[4].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 4);
@@ -194,8 +185,8 @@ namespace DX12
 
 		// Create root parameters
 		// CB
-		rootParameters[0].InitAsDescriptorTable(1, &ranges[0]);
-		rootParameters[1].InitAsDescriptorTable(1, &ranges[1]);
+		rootParameters[0].InitAsConstantBufferView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE); // Per model, from the upload allocator
+		rootParameters[1].InitAsConstantBufferView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE); // Per view, from the upload allocator
 		rootParameters[2].InitAsDescriptorTable(1, &ranges[2]);
 		rootParameters[3].InitAsDescriptorTable(1, &ranges[3]);
 		rootParameters[4].InitAsDescriptorTable(1, &ranges[4]);
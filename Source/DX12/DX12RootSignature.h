@@ -18,11 +18,15 @@ namespace DX12
 
 		ID3D12RootSignature* Get();
 
+		// Of the serialised root signature, the same from a run to the next
+		uint64_t Hash() const { return mHash; }
+
 
 	private:
 
 		CDX12Engine* mEngine;
 		ComPtr<ID3D12RootSignature> mRootSignature;
+		uint64_t mHash = 0;
 
 	};
 
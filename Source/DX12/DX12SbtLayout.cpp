@@ -0,0 +1,128 @@
+#include "DX12SbtLayout.h"
+
+#include <stdexcept>
+
+namespace DX12
+{
+	namespace
+	{
+		uint64_t AlignUp(uint64_t value, uint64_t alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+	}
+
+	CDX12SbtLayout::CDX12SbtLayout(uint32_t rayGenArgs, uint32_t missRecords, uint32_t missArgs, uint32_t rayTypes, uint32_t hitArgs) :
+		mRayTypes(rayTypes)
+	{
+		if (rayTypes == 0) throw std::logic_error("Shader binding table without ray types");
+
+		mRayGen.stride = Stride(rayGenArgs);
+		mRayGen.size = mRayGen.stride;
+
+		mMiss.offset = AlignUp(mRayGen.offset + mRayGen.size, TableAlignment);
+		mMiss.stride = Stride(missArgs);
+		mMiss.size = static_cast<uint64_t>(missRecords) * mMiss.stride;
+
+		mHitOffset = AlignUp(mMiss.offset + mMiss.size, TableAlignment);
+		mHitStride = Stride(hitArgs);
+	}
+
+	uint32_t CDX12SbtLayout::Stride(uint32_t args)
+	{
+		return static_cast<uint32_t>(AlignUp(IdentifierSize + args, RecordAlignment));
+	}
+
+	uint32_t CDX12SbtLayout::Allocate(uint32_t geometries)
+	{
+		if (geometries == 0) throw std::logic_error("Hit records for an instance without geometries");
+
+		const auto count = geometries * mRayTypes;
+
+		// The first free range big enough, what is left of it stays free
+		for (auto it = mFree.begin(); it != mFree.end(); ++it)
+		{
+			if (it->second < count) continue;
+
+			const auto [first, free] = *it;
+			mFree.erase(it);
+			if (free > count) mFree[first + count] = free - count;
+
+			mRanges[first] = count;
+			return first;
+		}
+
+		const auto first = mHitRecords;
+		mHitRecords += count;
+		mRanges[first] = count;
+		return first;
+	}
+
+	void CDX12SbtLayout::Free(uint32_t first)
+	{
+		const auto range = mRanges.find(first);
+		if (range == mRanges.end()) throw std::logic_error("Freeing hit records that were not allocated");
+
+		auto count = range->second;
+		mRanges.erase(range);
+
+		// Merge with the free ranges right after and right before
+		if (const auto next = mFree.find(first + count); next != mFree.end())
+		{
+			count += next->second;
+			mFree.erase(next);
+		}
+
+		if (auto previous = mFree.lower_bound(first); previous != mFree.begin())
+		{
+			--previous;
+			if (previous->first + previous->second == first)
+			{
+				first = previous->first;
+				count += previous->second;
+				mFree.erase(previous);
+			}
+		}
+
+		// A free range at the end shrinks the section instead
+		if (first + count == mHitRecords) mHitRecords = first;
+		else mFree[first] = count;
+	}
+
+	uint32_t CDX12SbtLayout::FreeHitRecords() const
+	{
+		uint32_t count = 0;
+		for (const auto& [first, free] : mFree) count += free;
+		return count;
+	}
+
+	void CDX12SbtLayout::Validate() const
+	{
+		if (mRayGen.stride % RecordAlignment || mMiss.stride % RecordAlignment || mHitStride % RecordAlignment) throw std::logic_error("Misaligned shader record stride");
+		if (mMiss.offset % TableAlignment || mHitOffset % TableAlignment) throw std::logic_error("Misaligned shader table section");
+		if (mMiss.offset < mRayGen.offset + mRayGen.size || mHitOffset < mMiss.offset + mMiss.size) throw std::logic_error("Overlapping shader table sections");
+
+		// Walking the allocated and free ranges in order has to cover every record once
+		std::map<uint32_t, std::pair<uint32_t, bool>> ranges;
+		for (const auto& [first, count] : mRanges) ranges[first] = { count, false };
+		for (const auto& [first, count] : mFree)
+		{
+			if (!ranges.emplace(first, std::make_pair(count, true)).second) throw std::logic_error("Hit records both free and allocated");
+		}
+
+		uint32_t next = 0;
+		auto previousFree = false;
+		for (const auto& [first, range] : ranges)
+		{
+			const auto [count, free] = range;
+			if (first != next || count == 0) throw std::logic_error("Hit record ranges overlap or leave a gap");
+			if (free && previousFree) throw std::logic_error("Free hit record ranges not merged");
+			if (count % mRayTypes) throw std::logic_error("Hit record range not a whole number of geometries");
+
+			next = first + count;
+			previousFree = free;
+		}
+
+		if (next != mHitRecords || previousFree) throw std::logic_error("Wrong end of the hit records");
+	}
+}
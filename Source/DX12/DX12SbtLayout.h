@@ -0,0 +1,93 @@
+//--------------------------------------------------------------------------------------
+// Shader binding table layout
+//--------------------------------------------------------------------------------------
+// Where the records of the shader binding table go. The table has a section for the ray
+// generation record, one for the miss records and one for the hit records. The records
+// of a section all have the same stride, which is the shader identifier plus the largest
+// local root arguments of the section, rounded up to the record alignment.
+// Each geometry of an instance has a hit record per ray type, one after the other, so a
+// ray finds its record at
+//   first record of the instance + geometry index * ray types + ray type
+// which is what TraceRay computes from InstanceContributionToHitGroupIndex (the first
+// record), MultiplierForGeometryContributionToHitGroupIndex (the ray types) and
+// RayContributionToHitGroupIndex (the ray type).
+// The hit records of an instance are a range of the hit section. A removed instance gives
+// its range back, merged with the free ranges next to it, and the next instances take
+// the first free range they fit in before the section grows.
+// Nothing here depends on D3D12, CDX12ShaderTable writes the records.
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+namespace DX12
+{
+	struct SSbtSection
+	{
+		uint64_t offset = 0; // From the start of the table
+		uint64_t size   = 0;
+		uint32_t stride = 0;
+	};
+
+	class CDX12SbtLayout
+	{
+	public:
+
+		static constexpr uint32_t IdentifierSize  = 32; // D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES
+		static constexpr uint32_t RecordAlignment = 32; // D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT
+		static constexpr uint32_t TableAlignment  = 64; // D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT
+
+		CDX12SbtLayout() = delete;
+		CDX12SbtLayout(const CDX12SbtLayout&) = delete;
+		CDX12SbtLayout(const CDX12SbtLayout&&) = delete;
+		CDX12SbtLayout& operator=(const CDX12SbtLayout&) = delete;
+		CDX12SbtLayout& operator=(const CDX12SbtLayout&&) = delete;
+
+		// The sizes in bytes of the local root arguments of each kind of record
+		CDX12SbtLayout(uint32_t rayGenArgs, uint32_t missRecords, uint32_t missArgs, uint32_t rayTypes, uint32_t hitArgs);
+
+		// The stride of records with local root arguments of this size
+		static uint32_t Stride(uint32_t args);
+
+		// Returns the first of the hit records of an instance with this many geometries.
+		// Will throw a std::logic_error exception for an instance without geometries
+		uint32_t Allocate(uint32_t geometries);
+
+		// Will throw a std::logic_error exception if first is not the first record of an instance
+		void Free(uint32_t first);
+
+		uint32_t HitRecord(uint32_t first, uint32_t geometry, uint32_t rayType) const { return first + geometry * mRayTypes + rayType; }
+
+		uint64_t HitRecordOffset(uint32_t record) const { return mHitOffset + static_cast<uint64_t>(record) * mHitStride; }
+
+		SSbtSection RayGen() const { return mRayGen; }
+		SSbtSection Miss() const { return mMiss; }
+
+		// Up to the last record in use, free ranges in between included
+		SSbtSection Hit() const { return { mHitOffset, static_cast<uint64_t>(mHitRecords) * mHitStride, mHitStride }; }
+
+		// The size of a table with room for this many hit records
+		uint64_t Size(uint32_t hitRecords) const { return HitRecordOffset(hitRecords); }
+
+		uint32_t RayTypes() const { return mRayTypes; }
+		uint32_t HitRecords() const { return mHitRecords; }
+		uint32_t FreeHitRecords() const;
+
+		// Will throw a std::logic_error exception if the ranges overlap or leave records unaccounted for
+		void Validate() const;
+
+	private:
+
+		uint32_t mRayTypes;
+
+		SSbtSection mRayGen;
+		SSbtSection mMiss;
+		uint64_t    mHitOffset;
+		uint32_t    mHitStride;
+
+		std::map<uint32_t, uint32_t> mRanges; // First record to count, of the instances
+		std::map<uint32_t, uint32_t> mFree;   // First record to count, never touching each other or the end
+		uint32_t                     mHitRecords = 0;
+	};
+}
@@ -1,9 +1,16 @@
 #include "DX12Scene.h"
 
+#include <algorithm>
+
 #include "DX12AmbientMap.h"
+#include "DX12CommandRecorder.h"
 #include "DX12DescriptorHeap.h"
 #include "DX12Engine.h"
+#include "DX12InstanceTable.h"
+#include "DX12MaterialTable.h"
+#include "DX12RenderGraph.h"
 #include "DX12Texture.h"
+#include "DX12UploadAllocator.h"
 #include "../Window.h"
 #include "../../Common/Camera.h"
 #include "../../Common/CGameObjectManager.h"
@@ -11,6 +18,7 @@
 #include "Objects/DX12Light.h"
 
 #include "DXR/DXR.h"
+#include "Objects/DX12PointLight.h"
 #include "Objects/DX12SpotLight.h"
 
 namespace DX12
@@ -40,7 +48,7 @@ namespace DX12
 			desc.NumDescriptors = 10;
 
 			mDSVDescriptorHeap = std::make_unique<CDX12DescriptorHeap>(mEngine, desc);
-			mDSVDescriptorHeap->mDescriptorHeap->SetName(L"DSVDescriptorHeap");
+			mDSVDescriptorHeap->SetName(L"DSVDescriptorHeap");
 		}
 
 		// Create scene texture
@@ -64,9 +72,9 @@ namespace DX12
 			mSceneTexture->mResource->SetName(L"SceneTex");
 		}
 
-		//Creating the depth texture
+		// The depth texture is a transient texture of the render graph, only its view is kept
 		{
-			const CD3DX12_RESOURCE_DESC depth_texture(
+			mDepthStencilDesc = CD3DX12_RESOURCE_DESC(
 				D3D12_RESOURCE_DIMENSION_TEXTURE2D,
 				0,
 				mViewportX,
@@ -81,11 +89,7 @@ namespace DX12
 				D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE
 			);
 
-			for (auto i = 0u; i < CDX12Engine::mNumFrames; i++)
-			{
-				mDepthStencils[i] = std::make_unique<CDX12DepthStencil>(mEngine, depth_texture, mEngine->mSRVDescriptorHeap.get(), mDSVDescriptorHeap.get());
-				mDepthStencils[i]->mResource->SetName(L"DepthStencil");
-			}
+			mDsvHandle = mDSVDescriptorHeap->Add();
 		}
 
 	}
@@ -93,84 +97,136 @@ namespace DX12
 
 	void CDX12Scene::RenderScene(float& frameTime)
 	{
+		auto graph = mEngine->mRenderGraph.get();
+		auto objm = mEngine->GetObjManager();
 
-		auto commandList = mEngine->GetCommandList();
+		PrepareFrame();
 
-		mEngine->mCurrRecordingCommandList = commandList;
+		// The scene texture and the spot light shadow maps are shown by the gui after the graph
+		const auto sceneTexture = graph->Import("SceneTexture", mSceneTexture.get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 
-		// Render from lights
+		const auto depthClearValue = CD3DX12_CLEAR_VALUE(DXGI_FORMAT_D32_FLOAT, 1.0f, 0);
+		const auto depthStencil = graph->CreateTexture("DepthStencil", mDepthStencilDesc, &depthClearValue);
+
+		// Render from lights, a pass for every spot light and for every face of the point lights
+		mShadowMaps.clear();
+
+		std::vector<uint32_t> spotShadowMaps;
+		for (const auto& l : objm->mSpotLights)
 		{
-			PIXBeginEvent(commandList, 0, L"Shadow maps Rendering");
+			auto light = dynamic_cast<CDX12SpotLight*>(l);
 
-			auto objm = mEngine->GetObjManager();
+			const auto shadowMap = graph->Import("SpotLightShadowMap", light->mShadowMapResource.Get(), light->mShadowMapState, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+			const auto pass = graph->AddPass("SpotLightShadowMap", [light] { light->RenderFromThis(); });
+			graph->Write(pass, shadowMap, D3D12_RESOURCE_STATE_DEPTH_WRITE);
 
-			for (const auto& l : objm->mSpotLights)
-			{
-				mShadowMaps.push_back(l->RenderFromThis());
-			}
+			spotShadowMaps.push_back(shadowMap);
+			mShadowMaps.push_back(light->GetSRV());
+		}
 
-			for (const auto& l : objm->mPointLights)
+		// Nothing samples the point light shadow maps yet, so the graph culls these passes
+		for (const auto& l : objm->mPointLights)
+		{
+			auto light = dynamic_cast<CDX12PointLight*>(l);
+			for (int face = 0; face < 6; ++face)
 			{
-				mShadowMaps.push_back(l->RenderFromThis());
+				const auto shadowMap = graph->Import("PointLightShadowMap", light->mShadowMaps[face].get());
+				const auto pass = graph->AddPass("PointLightShadowMap", [light, face] { light->RenderFace(face); });
+				graph->Write(pass, shadowMap, D3D12_RESOURCE_STATE_DEPTH_WRITE);
 			}
+			mShadowMaps.push_back(light->GetSRV());
+		}
+
+		for (const auto& l : objm->mDirLights)
+		{
+			mShadowMaps.push_back(l->RenderFromThis());
+		}
+
+		// The passes drawing lit objects sample the shadow maps of the spot lights
+		const auto readLighting = [graph, &spotShadowMaps](uint32_t pass)
+		{
+			for (const auto shadowMap : spotShadowMaps) graph->Read(pass, shadowMap, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		};
+
+		// Render the ambient map, a pass per face. Its depth buffer shares memory with the one of the scene
+		auto ambientMap = CDX12RenderGraphCompiler::InvalidIndex;
+		auto ambientDepth = CDX12RenderGraphCompiler::InvalidIndex;
+		if (mAmbientMap && mAmbientMap->mEnable)
+		{
+			ambientMap = graph->Import("AmbientMap", mAmbientMap->mResource.Get(), mAmbientMap->mState);
+			ambientDepth = graph->CreateTexture("AmbientMapDepth", mAmbientMap->mDepthBufferDesc, &depthClearValue);
 
-			for (const auto& l : objm->mDirLights)
+			for (int face = 0; face < 6; ++face)
 			{
-				mShadowMaps.push_back(l->RenderFromThis());
+				const auto pass = graph->AddPass("AmbientMapFace", [this, face] { mAmbientMap->RenderFace(face, { 0.0f, 0.0f, 0.0f }); });
+				graph->Write(pass, ambientMap, D3D12_RESOURCE_STATE_RENDER_TARGET);
+				graph->Write(pass, ambientDepth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+				readLighting(pass);
 			}
-
-			PIXEndEvent(commandList);
 		}
 
-		// Render the ambient map
-		auto m = MatrixIdentity();
-		if (mAmbientMap) mAmbientMap->RenderFromThis(&m);
-
-		// Set back the current recording command list
-		mEngine->mCurrRecordingCommandList = commandList;
+		// Render scene to texture: the clear and the sky first, then the objects split between several passes
+		const auto perFrameConstants = CameraConstants(mCamera.get());
 
-		// Render scene to texture
+		const auto renderingPass = graph->AddPass("Rendering", [this, perFrameConstants]
 		{
 			const FLOAT clearColor[] = { 0.4f,0.6f,0.9f,1.0f };
 
+			SetSceneRenderTarget();
+
 			const auto rtv = mSceneTexture->mRtvHeap->Get(mSceneTexture->mRTVHandle).mCpu;
-			const auto dsv = mDSVDescriptorHeap->Get(mEngine->mCurrentBackBufferIndex).mCpu;
+			const auto dsv = mDSVDescriptorHeap->Get(mDsvHandle).mCpu;
+			mEngine->mCurrRecordingCommandList->ClearRenderTargetView(rtv, clearColor, 0, nullptr);
+			mEngine->mCurrRecordingCommandList->ClearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+
+			RenderSky(perFrameConstants);
+		});
+		graph->Write(renderingPass, sceneTexture, D3D12_RESOURCE_STATE_RENDER_TARGET);
+		graph->Write(renderingPass, depthStencil, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+		const auto numObjects = objm->NumRenderables();
+		const auto numPasses = std::clamp<size_t>(numObjects / MinObjectsPerList, 1, mEngine->mCommandRecorder->ThreadCount());
+		for (size_t i = 0; i < numPasses; ++i)
+		{
+			const auto begin = numObjects * i / numPasses;
+			const auto end = numObjects * (i + 1) / numPasses;
 
-			mSceneTexture->Barrier(D3D12_RESOURCE_STATE_RENDER_TARGET);
-			mDepthStencils[mEngine->mCurrentBackBufferIndex]->Barrier(D3D12_RESOURCE_STATE_DEPTH_WRITE);
+			const auto pass = graph->AddPass("RenderingObjects", [this, objm, perFrameConstants, begin, end]
+			{
+				SetSceneRenderTarget();
+				BeginObjects(perFrameConstants);
+				objm->RenderObjects(begin, end);
+			});
+			graph->Write(pass, sceneTexture, D3D12_RESOURCE_STATE_RENDER_TARGET);
+			graph->Write(pass, depthStencil, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+			if (ambientMap != CDX12RenderGraphCompiler::InvalidIndex) graph->Read(pass, ambientMap, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+			readLighting(pass);
+		}
 
-			const auto vp = CD3DX12_VIEWPORT(0.0f, 0.0f, static_cast<FLOAT>(mViewportX), static_cast<FLOAT>(mViewportY));
-			const auto sr = CD3DX12_RECT(0, 0, mViewportX, mViewportY);
+		graph->Compile();
 
-			{
-				PIXBeginEvent(commandList, 0, "Rendering");
+		// The transient depth buffers may be new textures
+		mEngine->mDevice->CreateDepthStencilView(graph->Resource(depthStencil), nullptr, mDSVDescriptorHeap->Get(mDsvHandle).mCpu);
+		if (ambientDepth != CDX12RenderGraphCompiler::InvalidIndex) mAmbientMap->SetDepthBuffer(graph->Resource(ambientDepth));
 
-				// Set the viewport
-				commandList->RSSetViewports(1, &vp);
-				commandList->RSSetScissorRects(1, &sr);
-				commandList->OMSetRenderTargets(1, &rtv, FALSE, &dsv);
-				commandList->ClearRenderTargetView(rtv, clearColor, 0, nullptr);
-				commandList->ClearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+		// The scene texture goes back to pixel shader resource in the main command list, submitted after the passes
+		graph->Execute(mEngine->mCommandRecorder.get());
+	}
 
-				// Render the models from the camera pov
-				RenderSceneFromCamera(mCamera.get());
+	void CDX12Scene::RenderSceneFromCamera(CCamera* camera)
+	{
+		const auto perFrameConstants = CameraConstants(camera);
 
-				PIXEndEvent(commandList);
-			}
+		RenderSky(perFrameConstants);
 
-			mSceneTexture->Barrier(D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-			mDepthStencils[mEngine->mCurrentBackBufferIndex]->Barrier(D3D12_RESOURCE_STATE_DEPTH_READ);
-		}
+		BeginObjects(perFrameConstants);
+
+		mEngine->GetObjManager()->RenderAllObjects();
 	}
 
-	void CDX12Scene::RenderSceneFromCamera(CCamera* camera)
+	void CDX12Scene::PrepareFrame()
 	{
-		// Set camera matrices in the constant buffer and send over to GPU
 		auto& perFrameConstants = mEngine->mPerFrameConstants[mEngine->mCurrentBackBufferIndex];
-		perFrameConstants.cameraMatrix = camera->WorldMatrix();
-		perFrameConstants.viewMatrix = camera->ViewMatrix();
-		perFrameConstants.projectionMatrix = camera->ProjectionMatrix();
-		perFrameConstants.viewProjectionMatrix = camera->ViewProjectionMatrix();
 		perFrameConstants.ambientColour = gAmbientColour;
 		perFrameConstants.parallaxMinSamples = 5;
 		perFrameConstants.parallaxMaxSamples = 20;
@@ -178,23 +234,62 @@ namespace DX12
 		mEngine->UpdateLightsBuffers();
 		mEngine->CopyBuffers();
 
-		mEngine->SetSkyPSO();
-		mEngine->mSRVDescriptorHeap->Set();
-		mEngine->SetConstantBuffers();
+		// The sky follows the camera
+		if (const auto sky = mEngine->GetObjManager()->mSky) sky->SetPosition(mCamera->Position());
+	}
+
+	D3D12_GPU_VIRTUAL_ADDRESS CDX12Scene::CameraConstants(CCamera* camera) const
+	{
+		// Set camera matrices in the constant buffer and send over to GPU
+		auto perFrameConstants = mEngine->mPerFrameConstants[mEngine->mCurrentBackBufferIndex];
+		perFrameConstants.cameraMatrix = camera->WorldMatrix();
+		perFrameConstants.viewMatrix = camera->ViewMatrix();
+		perFrameConstants.projectionMatrix = camera->ProjectionMatrix();
+		perFrameConstants.viewProjectionMatrix = camera->ViewProjectionMatrix();
+
+		return mEngine->mUploadAllocator->Copy(perFrameConstants);
+	}
+
+	void CDX12Scene::SetSceneRenderTarget() const
+	{
+		const auto rtv = mSceneTexture->mRtvHeap->Get(mSceneTexture->mRTVHandle).mCpu;
+		const auto dsv = mDSVDescriptorHeap->Get(mDsvHandle).mCpu;
 
+		const auto vp = CD3DX12_VIEWPORT(0.0f, 0.0f, static_cast<FLOAT>(mViewportX), static_cast<FLOAT>(mViewportY));
+		const auto sr = CD3DX12_RECT(0, 0, mViewportX, mViewportY);
+
+		// Set the viewport
+		mEngine->mCurrRecordingCommandList->RSSetViewports(1, &vp);
+		mEngine->mCurrRecordingCommandList->RSSetScissorRects(1, &sr);
+		mEngine->mCurrRecordingCommandList->OMSetRenderTargets(1, &rtv, FALSE, &dsv);
+	}
+
+	void CDX12Scene::RenderSky(D3D12_GPU_VIRTUAL_ADDRESS perFrameConstants) const
+	{
 		auto sky = mEngine->GetObjManager()->mSky;
+		if (!sky) return;
+
+		mEngine->SetSkyPSO();
+		mEngine->SetConstantBuffers(perFrameConstants);
+
 		sky->Render();
+	}
 
+	void CDX12Scene::BeginObjects(D3D12_GPU_VIRTUAL_ADDRESS perFrameConstants) const
+	{
 		mEngine->SetPBRPSO();
-		mEngine->mSRVDescriptorHeap->Set();
-		mEngine->SetConstantBuffers();
+		mEngine->SetConstantBuffers(perFrameConstants);
+
+		// The maps and the matrices of every object, the draws only pass the index of their instance
+		mEngine->mMaterialTable->Set(6, 7);
+		mEngine->mInstanceTable->Set(10);
 
 		// Set ambient map
 		if (mAmbientMap->mEnable)
 		{
 			// Convert back from void* to handle*
 			auto handle = mEngine->mSRVDescriptorHeap->Get(mAmbientMap->mSrvHandle).mGpu;
-			mEngine->mCurrRecordingCommandList->SetGraphicsRootDescriptorTable(12, handle);
+			mEngine->mCurrRecordingCommandList->SetGraphicsRootDescriptorTable(8, handle);
 		}
 
 		// Set the shadow maps
@@ -202,12 +297,8 @@ namespace DX12
 		{
 			auto d = dynamic_cast<CDX12SpotLight*>(l);
 			auto handle = mEngine->mSRVDescriptorHeap->Get(d->mSrvHandle).mGpu;
-			mEngine->mCurrRecordingCommandList->SetGraphicsRootDescriptorTable(13, handle);
+			mEngine->mCurrRecordingCommandList->SetGraphicsRootDescriptorTable(9, handle);
 		}
-
-		mEngine->GetObjManager()->RenderAllObjects();
-
-		mShadowMaps.clear();
 	}
 
 	ImTextureID CDX12Scene::GetTextureSRV()
@@ -231,11 +322,6 @@ namespace DX12
 		mEngine->mCommandAllocators[mEngine->mCurrentBackBufferIndex]->Reset();
 		mEngine->mCurrRecordingCommandList->Reset(mEngine->mCommandAllocators[mEngine->mCurrentBackBufferIndex].Get(), nullptr);
 
-		for (auto& mDepthStencil : mDepthStencils)
-		{
-			mDepthStencil = nullptr;
-		}
-
 		mSceneTexture = nullptr;
 		mDSVDescriptorHeap = nullptr;
 
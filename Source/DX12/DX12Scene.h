@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "../Common/CScene.h"
+#include "DX12Common.h"
 
 namespace DX12
 {
@@ -10,7 +11,6 @@ namespace DX12
 	class CDX12RenderTarget;
 	class CDX12Engine;
 	class CDX12AmbientMap;
-	class CDX12DepthStencil;
 	class CDX12GameObject;
 
 	class CDX12Scene : public CScene
@@ -40,11 +40,12 @@ namespace DX12
 		// Scene Render and Update
 		//--------------------------------------------------------------------------------------
 
-		// Returns the generated scene texture
+		// Declares the shadow maps, the ambient map and the scene as passes of the render graph, recorded on the recording threads
 		void RenderScene(float& frameTime) override;
 
 		ImTextureID GetTextureSRV() override;
 
+		// Records the sky and the objects into the list of the calling thread
 		void RenderSceneFromCamera(CCamera* camera) override;
 
 
@@ -63,7 +64,8 @@ namespace DX12
 
 		std::unique_ptr<CDX12DescriptorHeap> mDSVDescriptorHeap;
 		std::unique_ptr<CDX12RenderTarget> mSceneTexture;
-		std::unique_ptr<CDX12DepthStencil> mDepthStencils[3];
+		uint32_t                             mDsvHandle;
+		D3D12_RESOURCE_DESC                  mDepthStencilDesc;
 
 		std::unique_ptr<CDX12AmbientMap>     mAmbientMap;
 
@@ -76,5 +78,24 @@ namespace DX12
 
 		std::vector<ImTextureID> mShadowMaps;
 
+		// Below this many objects per pass another recording thread is not worth it
+		static constexpr size_t MinObjectsPerList = 16;
+
+		//--------------------------------------------------------------------------------------
+		// Recording helpers
+		//--------------------------------------------------------------------------------------
+
+		// Write what the recording threads read, before they start
+		void PrepareFrame();
+
+		// The frame constants with the matrices of the camera, copied to the upload allocator
+		D3D12_GPU_VIRTUAL_ADDRESS CameraConstants(CCamera* camera) const;
+
+		void SetSceneRenderTarget() const;
+		void RenderSky(D3D12_GPU_VIRTUAL_ADDRESS perFrameConstants) const;
+
+		// Set the PBR pipeline and everything the objects share
+		void BeginObjects(D3D12_GPU_VIRTUAL_ADDRESS perFrameConstants) const;
+
 	};
 }
\ No newline at end of file
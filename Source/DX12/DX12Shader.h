@@ -1,22 +1,24 @@
 #pragma once
 
 #include "DX12Engine.h"
+#include "DX12ShaderCache.h"
 
 namespace DX12
 {
-
-
-	IDxcBlob* CompileShader(LPCWSTR fileName, std::vector<LPCWSTR>& args);
-
-
 	class CDX12Shader
 	{
 	public:
 
-		CDX12Shader(CDX12Engine* engine, const std::string& absolutePath);
+		// Starts loading or compiling the shader on the shader cache of the engine
+		CDX12Shader(CDX12Engine* engine, const std::string& absolutePath, const SShaderDesc& desc);
+
+		// Waits for the shader the first time
+		// Will throw a std::runtime_error exception if the shader does not compile
+		IDxcBlob* Blob();
 
 		CDX12Engine* mEngine;
 		std::string mPath;
+		SShaderDesc mDesc;
 		ComPtr<IDxcBlob> mShaderBlob;
 	};
 
@@ -0,0 +1,397 @@
+#include "DX12ShaderCache.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <regex>
+#include <sstream>
+
+namespace DX12
+{
+	namespace
+	{
+		// Bump when the arguments below or the layout of the cache files change
+		constexpr auto CacheVersion = "1 -Zi -WX";
+
+		// What a cache file starts with: the hash of the inputs, then the DXIL container
+		constexpr size_t HeaderSize = sizeof(uint64_t);
+
+		uint64_t Hash(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+		{
+			// FNV-1a
+			const auto bytes = static_cast<const uint8_t*>(data);
+			for (size_t i = 0; i < size; ++i)
+			{
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		}
+
+		uint64_t Hash(const std::string& string, uint64_t hash = 14695981039346656037ull)
+		{
+			// The size keeps "ab" + "c" apart from "a" + "bc"
+			const auto size = static_cast<uint64_t>(string.size());
+			return Hash(string.data(), string.size(), Hash(&size, sizeof(size), hash));
+		}
+
+		std::wstring Widen(const std::string& string)
+		{
+			return std::wstring(string.begin(), string.end());
+		}
+
+		bool ReadFile(const std::filesystem::path& file, std::string& content)
+		{
+			std::ifstream stream(file, std::ios::binary);
+			if (!stream.good()) return false;
+
+			content.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+			return true;
+		}
+
+		int filter(unsigned int code, struct _EXCEPTION_POINTERS* pExceptionInfo) {
+			static char scratch[32];
+			// report all errors with fputs to prevent any allocation
+			if (code == EXCEPTION_ACCESS_VIOLATION) {
+				// use pExceptionInfo to document and report error
+				fputs("access violation. Attempted to ", stderr);
+				if (pExceptionInfo->ExceptionRecord->ExceptionInformation[0])
+					fputs("write", stderr);
+				else
+					fputs("read", stderr);
+				fputs(" from address ", stderr);
+				sprintf_s(scratch, _countof(scratch), "0x%p\n",
+					(void*)pExceptionInfo->ExceptionRecord->ExceptionInformation[1]);
+				fputs(scratch, stderr);
+				return EXCEPTION_EXECUTE_HANDLER;
+			}
+			if (code == EXCEPTION_STACK_OVERFLOW) {
+				// use pExceptionInfo to document and report error
+				fputs("stack overflow\n", stderr);
+				return EXCEPTION_EXECUTE_HANDLER;
+			}
+			fputs("Unrecoverable Error ", stderr);
+			sprintf_s(scratch, _countof(scratch), "0x%08x\n", code);
+			fputs(scratch, stderr);
+			return EXCEPTION_CONTINUE_SEARCH;
+		}
+
+		HRESULT DxcCompile(IDxcCompiler3 * pCompiler, DxcBuffer * pSource, LPCWSTR pszArgs[],
+			int argCt, IDxcIncludeHandler * pIncludeHandler, IDxcResult * *pResults) {
+
+			__try {
+				return pCompiler->Compile(
+					pSource,                // Source buffer.
+					pszArgs,                // Array of pointers to arguments.
+					argCt,                  // Number of arguments.
+					pIncludeHandler,        // User-provided interface to handle #include directives (optional).
+					IID_PPV_ARGS(pResults) // Compiler output status, buffer, and errors.
+				);
+			}
+			__except (filter(GetExceptionCode(), GetExceptionInformation())) {
+				// UNRECOVERABLE ERROR!
+				// At this point, state could be extremely corrupt. Terminate the process
+				return E_FAIL;
+			}
+		}
+	}
+
+	CDX12ShaderCache::CDX12ShaderCache(const std::string& shaderFolder, unsigned int numThreads) :
+		mShaderFolder(std::filesystem::path(shaderFolder).lexically_normal()),
+		mCacheFolder(mShaderFolder / "Cache"),
+		mLastPoll(std::chrono::steady_clock::now()),
+		mPool(numThreads)
+	{
+		// Without the folder every shader is compiled every time, which still works
+		std::error_code error;
+		std::filesystem::create_directories(mCacheFolder, error);
+	}
+
+	void CDX12ShaderCache::Request(const SShaderDesc& desc)
+	{
+		std::lock_guard lock(mMutex);
+
+		auto& entry = mEntries[Key(desc)];
+		if (entry.compiled.valid()) return;
+
+		entry.desc = desc;
+		entry.compiled = mPool.submit([this, desc] { return Load(desc, false); }).share();
+	}
+
+	ComPtr<IDxcBlob> CDX12ShaderCache::Get(const SShaderDesc& desc)
+	{
+		Request(desc);
+
+		std::shared_future<SCompiled> compiled;
+		{
+			std::lock_guard lock(mMutex);
+			compiled = mEntries[Key(desc)].compiled;
+		}
+
+		return compiled.get().blob;
+	}
+
+	bool CDX12ShaderCache::Poll()
+	{
+		const auto now = std::chrono::steady_clock::now();
+		if (now - mLastPoll < std::chrono::milliseconds(500)) return false;
+		mLastPoll = now;
+
+		const auto ready = [](const std::shared_future<SCompiled>& future)
+		{
+			return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		};
+
+		const auto changed = [](const std::vector<SFileTime>& files)
+		{
+			for (const auto& file : files)
+			{
+				std::error_code error;
+				const auto time = std::filesystem::last_write_time(file.path, error);
+				if (error || time != file.time) return true;
+			}
+			return false;
+		};
+
+		auto reloaded = false;
+
+		std::lock_guard lock(mMutex);
+
+		for (auto& [key, entry] : mEntries)
+		{
+			if (entry.recompiling.valid())
+			{
+				if (!ready(entry.recompiling)) continue;
+
+				// A failed recompilation keeps the blob, and waits for the files to change again
+				const auto& result = entry.recompiling.get();
+				entry.files = result.files;
+				if (result.blob)
+				{
+					entry.compiled = entry.recompiling;
+					reloaded = true;
+				}
+				entry.recompiling = {};
+				continue;
+			}
+
+			if (!ready(entry.compiled)) continue;
+
+			if (entry.files.empty())
+			{
+				// The first compilation failed, Get has thrown already
+				try { entry.files = entry.compiled.get().files; }
+				catch (...) { continue; }
+			}
+
+			if (changed(entry.files))
+			{
+				entry.recompiling = mPool.submit([this, desc = entry.desc] { return Load(desc, true); }).share();
+			}
+		}
+
+		return reloaded;
+	}
+
+	SShaderCacheStats CDX12ShaderCache::Stats() const
+	{
+		SShaderCacheStats stats;
+		stats.hits     = mHits;
+		stats.compiles = mCompiles;
+		stats.failures = mFailures;
+		stats.reloads  = mReloads;
+		return stats;
+	}
+
+	CDX12ShaderCache::SCompiled CDX12ShaderCache::Load(const SShaderDesc& desc, bool reload)
+	{
+		SCompiled compiled;
+
+		try
+		{
+			const auto file = Resolve(desc.file);
+
+			std::string sources;
+			ReadSources(file, sources, compiled.files);
+
+			auto hash = Hash(CacheVersion);
+			hash = Hash(Key(desc), hash);
+			hash = Hash(sources, hash);
+
+			// One file per shader and defines, overwritten when the sources change
+			char keyHash[9];
+			sprintf_s(keyHash, "%08x", static_cast<uint32_t>(Hash(Key(desc))));
+
+			auto name = file.stem().string();
+			if (!desc.entry.empty()) name += "_" + desc.entry;
+			name += "_" + desc.target + "_" + keyHash;
+
+			const auto cacheFile = mCacheFolder / (name + ".dxil");
+
+			std::string cached;
+			if (ReadFile(cacheFile, cached) &&
+				cached.size() > HeaderSize + 4 &&
+				std::memcmp(cached.data(), &hash, HeaderSize) == 0 &&
+				std::memcmp(cached.data() + HeaderSize, "DXBC", 4) == 0)
+			{
+				ComPtr<IDxcUtils> utils;
+				ThrowIfFailed(DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(utils.GetAddressOf())));
+
+				ComPtr<IDxcBlobEncoding> blob;
+				ThrowIfFailed(utils->CreateBlob(cached.data() + HeaderSize, static_cast<UINT32>(cached.size() - HeaderSize), 0, blob.GetAddressOf()));
+
+				compiled.blob = blob;
+				++mHits;
+			}
+			else
+			{
+				std::string errors;
+				compiled.blob = Compile(desc, file, mCacheFolder / (name + ".pdb"), errors);
+				if (!compiled.blob) throw std::runtime_error("Error compiling " + file.string() + "\n" + errors);
+
+				++mCompiles;
+
+				// Written aside and renamed, so a crash or another instance never leaves half a file
+				const auto temporary = mCacheFolder / (name + ".tmp");
+				{
+					std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+					stream.write(reinterpret_cast<const char*>(&hash), HeaderSize);
+					stream.write(static_cast<const char*>(compiled.blob->GetBufferPointer()), compiled.blob->GetBufferSize());
+				}
+
+				std::error_code error;
+				std::filesystem::rename(temporary, cacheFile, error);
+			}
+
+			if (reload) ++mReloads;
+		}
+		catch (const std::exception& e)
+		{
+			++mFailures;
+
+			if (!reload) throw;
+
+			OutputDebugStringA(e.what());
+			compiled.blob = nullptr;
+		}
+
+		return compiled;
+	}
+
+	void CDX12ShaderCache::ReadSources(const std::filesystem::path& file, std::string& source, std::vector<SFileTime>& files) const
+	{
+		for (const auto& read : files)
+		{
+			if (read.path == file) return;
+		}
+
+		// The time before the content, a save in between is then seen by the next Poll
+		std::error_code error;
+		files.push_back({ file, std::filesystem::last_write_time(file, error) });
+
+		std::string content;
+		if (!ReadFile(file, content)) throw std::runtime_error("Cannot find shader file " + file.string());
+
+		source += content;
+
+		static const std::regex include(R"(^[ \t]*#[ \t]*include[ \t]*["<]([^">]+)[">])");
+
+		std::string line;
+		std::istringstream stream(content);
+		while (std::getline(stream, line))
+		{
+			std::smatch match;
+			if (!std::regex_search(line, match, include)) continue;
+
+			// Next to the file first, then in the shader folder given to DXC with -I
+			auto included = (file.parent_path() / match[1].str()).lexically_normal();
+			if (!std::filesystem::exists(included, error)) included = (mShaderFolder / match[1].str()).lexically_normal();
+
+			if (std::filesystem::exists(included, error)) ReadSources(included, source, files);
+		}
+	}
+
+	ComPtr<IDxcBlob> CDX12ShaderCache::Compile(const SShaderDesc& desc, const std::filesystem::path& file, const std::filesystem::path& pdb, std::string& errors) const
+	{
+		ComPtr<IDxcUtils> pUtils;
+		ComPtr<IDxcCompiler3> pCompiler;
+		ComPtr<IDxcIncludeHandler> dxcIncludeHandler;
+
+		// One of each per compilation, the compiler is not thread safe
+		ThrowIfFailed(DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(pUtils.GetAddressOf())));
+		ThrowIfFailed(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(pCompiler.GetAddressOf())));
+		ThrowIfFailed(pUtils->CreateDefaultIncludeHandler(dxcIncludeHandler.GetAddressOf()));
+
+		std::string sShader;
+		if (!ReadFile(file, sShader)) throw std::runtime_error("Cannot find shader file " + file.string());
+
+		DxcBuffer sourceBuffer;
+		sourceBuffer.Ptr = sShader.data();
+		sourceBuffer.Size = sShader.size();
+		sourceBuffer.Encoding = DXC_CP_UTF8;
+
+		// The PDB is saved next to the cached blob, where PIX is pointed to by the path in the blob
+
+		std::vector<std::wstring> arguments;
+		if (!desc.entry.empty())
+		{
+			arguments.push_back(L"-E");
+			arguments.push_back(Widen(desc.entry));
+		}
+		arguments.push_back(L"-T");
+		arguments.push_back(Widen(desc.target));
+		arguments.push_back(L"-I");
+		arguments.push_back(file.parent_path().wstring());
+		for (const auto& define : desc.defines)
+		{
+			arguments.push_back(L"-D");
+			arguments.push_back(Widen(define));
+		}
+		arguments.push_back(L"-Fd");
+		arguments.push_back(pdb.wstring());
+		arguments.push_back(DXC_ARG_DEBUG); //-Zi
+		arguments.push_back(DXC_ARG_WARNINGS_ARE_ERRORS); //-WX
+
+		std::vector<LPCWSTR> args;
+		for (const auto& argument : arguments) args.push_back(argument.c_str());
+
+		// Compile
+		ComPtr<IDxcResult> pResult;
+		ThrowIfFailed(DxcCompile(pCompiler.Get(), &sourceBuffer, args.data(), static_cast<int>(args.size()), dxcIncludeHandler.Get(), pResult.GetAddressOf()));
+
+		// IDxcCompiler3::Compile always returns an error buffer, its length is zero if there are no warnings or errors
+		ComPtr<IDxcBlobUtf8> pErrors = nullptr;
+		if (SUCCEEDED(pResult->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&pErrors), nullptr)) && pErrors != nullptr && pErrors->GetStringLength() != 0)
+		{
+			errors = pErrors->GetStringPointer();
+			OutputDebugStringA(pErrors->GetStringPointer());
+		}
+
+		HRESULT hrStatus;
+		if (FAILED(pResult->GetStatus(&hrStatus)) || FAILED(hrStatus)) return nullptr;
+
+		ComPtr<IDxcBlob> pPDB = nullptr;
+		if (SUCCEEDED(pResult->GetOutput(DXC_OUT_PDB, IID_PPV_ARGS(pPDB.GetAddressOf()), nullptr)) && pPDB)
+		{
+			std::ofstream stream(pdb, std::ios::binary | std::ios::trunc);
+			stream.write(static_cast<const char*>(pPDB->GetBufferPointer()), pPDB->GetBufferSize());
+		}
+
+		ComPtr<IDxcBlob> pBlob;
+		ThrowIfFailed(pResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(pBlob.GetAddressOf()), nullptr));
+		return pBlob;
+	}
+
+	std::filesystem::path CDX12ShaderCache::Resolve(const std::string& file) const
+	{
+		const std::filesystem::path path(file);
+		return (path.is_absolute() ? path : mShaderFolder / path).lexically_normal();
+	}
+
+	std::string CDX12ShaderCache::Key(const SShaderDesc& desc)
+	{
+		auto key = desc.file + "|" + desc.entry + "|" + desc.target;
+		for (const auto& define : desc.defines) key += "|" + define;
+		return key;
+	}
+}
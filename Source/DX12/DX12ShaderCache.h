@@ -0,0 +1,126 @@
+//--------------------------------------------------------------------------------------
+// Shader cache
+//--------------------------------------------------------------------------------------
+// Compiles the shaders with DXC on a thread pool and keeps the DXIL on disk, in a Cache
+// folder next to the shaders. A blob is named after a hash of everything that goes into it:
+// the source, the files it includes (followed recursively), the entry point, the target,
+// the defines and the compiler arguments, so an edit to Common.hlsli misses the cache of
+// every shader including it and nothing else. Cached blobs load without creating a compiler.
+// Request starts a shader and returns straight away, so all the shaders of the engine are
+// loaded or compiled at the same time and the first Get waits only for its own.
+// Poll looks for shaders whose files changed since they were compiled, recompiles them in
+// the background and reports when they are ready; a shader that no longer compiles keeps
+// its last blob and prints the errors to the debug output.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <dxcapi.h>
+#include <thread_pool.hpp>
+
+#include "DX12Common.h"
+
+namespace DX12
+{
+	struct SShaderDesc
+	{
+		std::string              file;    // Relative to the shader folder, or an absolute path
+		std::string              entry;   // Empty for libraries
+		std::string              target;  // vs_6_1, ps_6_1, lib_6_3...
+		std::vector<std::string> defines; // NAME or NAME=VALUE
+	};
+
+	struct SShaderCacheStats
+	{
+		uint32_t hits     = 0; // Loaded from the disk
+		uint32_t compiles = 0;
+		uint32_t failures = 0;
+		uint32_t reloads  = 0; // Recompiled because their files changed
+	};
+
+	class CDX12ShaderCache
+	{
+	public:
+
+		CDX12ShaderCache() = delete;
+		CDX12ShaderCache(const CDX12ShaderCache&) = delete;
+		CDX12ShaderCache(const CDX12ShaderCache&&) = delete;
+		CDX12ShaderCache& operator=(const CDX12ShaderCache&) = delete;
+		CDX12ShaderCache& operator=(const CDX12ShaderCache&&) = delete;
+
+		// 0 threads uses one per hardware thread
+		explicit CDX12ShaderCache(const std::string& shaderFolder, unsigned int numThreads = 0);
+
+		// Start loading or compiling the shader, nothing is done twice for the same description
+		void Request(const SShaderDesc& desc);
+
+		// Request the shader and wait for it
+		// Will throw a std::runtime_error exception if the shader does not compile
+		ComPtr<IDxcBlob> Get(const SShaderDesc& desc);
+
+		// Check (at most twice a second) whether the files of the shaders changed, and recompile the ones that did.
+		// Returns true when recompiled shaders are ready, Get returns the new blobs from then on
+		bool Poll();
+
+		SShaderCacheStats Stats() const;
+
+	private:
+
+		struct SFileTime
+		{
+			std::filesystem::path           path;
+			std::filesystem::file_time_type time;
+		};
+
+		struct SCompiled
+		{
+			ComPtr<IDxcBlob>       blob; // Null if a recompilation failed
+			std::vector<SFileTime> files; // The source and its includes
+		};
+
+		struct SEntry
+		{
+			SShaderDesc                   desc;
+			std::shared_future<SCompiled> compiled;
+			std::shared_future<SCompiled> recompiling;
+			std::vector<SFileTime>        files; // Of the last compilation, read by Poll
+		};
+
+		// Runs on the pool. Throws a std::runtime_error exception on failure, unless it is a reload
+		SCompiled Load(const SShaderDesc& desc, bool reload);
+
+		// Read the file and the files it includes, appending their content to source
+		void ReadSources(const std::filesystem::path& file, std::string& source, std::vector<SFileTime>& files) const;
+
+		// Returns null and the errors if the shader does not compile
+		ComPtr<IDxcBlob> Compile(const SShaderDesc& desc, const std::filesystem::path& file, const std::filesystem::path& pdb, std::string& errors) const;
+
+		std::filesystem::path Resolve(const std::string& file) const;
+
+		static std::string Key(const SShaderDesc& desc);
+
+		std::filesystem::path mShaderFolder;
+		std::filesystem::path mCacheFolder;
+
+		mutable std::mutex                      mMutex;
+		std::unordered_map<std::string, SEntry> mEntries;
+
+		std::chrono::steady_clock::time_point mLastPoll;
+
+		std::atomic<uint32_t> mHits     = 0;
+		std::atomic<uint32_t> mCompiles = 0;
+		std::atomic<uint32_t> mFailures = 0;
+		std::atomic<uint32_t> mReloads  = 0;
+
+		// Last, so the workers stop before the rest goes
+		thread_pool mPool;
+	};
+}
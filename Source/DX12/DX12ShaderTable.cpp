@@ -0,0 +1,227 @@
+#include "DX12ShaderTable.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "CDX12Material.h"
+#include "DX12ConstantBuffer.h"
+#include "DX12DescriptorHeap.h"
+#include "DX12Engine.h"
+#include "DX12Mesh.h"
+#include "DX12ResourceAllocator.h"
+#include "DX12Tlas.h"
+#include "Objects/DX12GameObject.h"
+
+namespace DX12
+{
+	static_assert(CDX12SbtLayout::IdentifierSize == D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+	static_assert(CDX12SbtLayout::RecordAlignment == D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT);
+	static_assert(CDX12SbtLayout::TableAlignment == D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT);
+
+	namespace
+	{
+		// The local root arguments, in the order of the root signatures
+		constexpr uint32_t RayGenArgs = sizeof(uint64_t);     // Output, top level structure and camera table
+		constexpr uint32_t HitArgs    = 6 * sizeof(uint64_t); // Lights, material, top level structure, vertices, indices, textures table
+
+		void WriteRecord(uint8_t* record, const void* identifier, std::initializer_list<uint64_t> args)
+		{
+			if (!identifier) throw std::runtime_error("Shader identifier missing from the raytracing pipeline");
+
+			std::memcpy(record, identifier, D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+			std::memcpy(record + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES, args.begin(), args.size() * sizeof(uint64_t));
+		}
+	}
+
+	CDX12ShaderTable::CDX12ShaderTable(CDX12Engine* engine, uint32_t capacity) :
+		mEngine(engine),
+		mCapacity(std::max(capacity, 1u)),
+		mLayout(RayGenArgs, 2, 0, RayTypes, HitArgs),
+		mStaging(CDX12Engine::mNumFrames)
+	{
+	}
+
+	void CDX12ShaderTable::Sync(const std::deque<CGameObject*>& objects)
+	{
+		++mSyncs;
+
+		for (const auto object : objects)
+		{
+			const auto o = dynamic_cast<CDX12GameObject*>(object);
+			if (!o || !o->Mesh()) continue;
+
+			auto& entry = mObjects[object];
+			entry.synced = mSyncs;
+
+			if (entry.mesh == o->Mesh()) continue;
+
+			// A new object, or one with another number of sub-meshes
+			if (entry.mesh) mLayout.Free(entry.first);
+
+			entry.mesh = o->Mesh();
+			entry.first = mLayout.Allocate(static_cast<uint32_t>(entry.mesh->mSubMeshes.size()));
+		}
+
+		for (auto it = mObjects.begin(); it != mObjects.end();)
+		{
+			if (it->second.synced == mSyncs)
+			{
+				++it;
+				continue;
+			}
+
+			mLayout.Free(it->second.first);
+			it = mObjects.erase(it);
+		}
+
+#if defined(_DEBUG)
+		mLayout.Validate();
+#endif
+	}
+
+	uint32_t CDX12ShaderTable::HitGroup(CGameObject* object) const
+	{
+		const auto found = mObjects.find(object);
+		if (found == mObjects.end()) throw std::logic_error("Hit group of an object without hit records");
+
+		return found->second.first;
+	}
+
+	void CDX12ShaderTable::Update(ID3D12GraphicsCommandList4* commandList)
+	{
+		const auto props = mEngine->mRaytracingStateObjectProps.Get();
+		const auto heap = mEngine->mSRVDescriptorHeap.get();
+
+		const auto size = mLayout.Size(mLayout.HitRecords());
+		mNext.assign(size, 0);
+
+		// The ray generation table starts with the output, followed by the top level structure and the camera
+		WriteRecord(mNext.data() + mLayout.RayGen().offset, props->GetShaderIdentifier(L"RayGen"), { heap->Get(mEngine->mOutputSrvIndex).mGpu.ptr });
+
+		WriteRecord(mNext.data() + mLayout.Miss().offset, props->GetShaderIdentifier(L"Miss"), {});
+		WriteRecord(mNext.data() + mLayout.Miss().offset + mLayout.Miss().stride, props->GetShaderIdentifier(L"ShadowMiss"), {});
+
+		const auto hitGroup = props->GetShaderIdentifier(L"HitGroup");
+		const auto shadowHitGroup = props->GetShaderIdentifier(L"ShadowHitGroup");
+		const auto lights = mEngine->mRTLights->GetGPUVirtualAddress();
+		const auto tlas = mEngine->mTlas->Resource()->GetGPUVirtualAddress();
+
+		for (const auto& [object, entry] : mObjects)
+		{
+			const auto material = dynamic_cast<CDX12GameObject*>(object)->Material();
+
+			for (uint32_t geometry = 0; geometry < entry.mesh->mSubMeshes.size(); ++geometry)
+			{
+				const auto& subMesh = entry.mesh->mSubMeshes[geometry];
+
+				WriteRecord(mNext.data() + mLayout.HitRecordOffset(mLayout.HitRecord(entry.first, geometry, 0)), hitGroup,
+					{
+						lights,
+						material->mMaterialCB->GpuAddress(),
+						tlas,
+						subMesh.geometry.VertexAddress(),
+						subMesh.geometry.IndexAddress(),
+						material->TextureTable().ptr,
+					});
+
+				WriteRecord(mNext.data() + mLayout.HitRecordOffset(mLayout.HitRecord(entry.first, geometry, 1)), shadowHitGroup, {});
+			}
+		}
+
+		// A new table has none of the records
+		if (Reserve(size)) mRecords.clear();
+
+		// The runs of records that changed, compared in steps of the record alignment
+		std::vector<std::pair<uint64_t, uint64_t>> runs;
+		for (uint64_t offset = 0; offset < size; offset += CDX12SbtLayout::RecordAlignment)
+		{
+			const auto changed = offset + CDX12SbtLayout::RecordAlignment > mRecords.size() ||
+				std::memcmp(mNext.data() + offset, mRecords.data() + offset, CDX12SbtLayout::RecordAlignment) != 0;
+			if (!changed) continue;
+
+			if (!runs.empty() && runs.back().second == offset) runs.back().second += CDX12SbtLayout::RecordAlignment;
+			else runs.emplace_back(offset, offset + CDX12SbtLayout::RecordAlignment);
+		}
+
+		mCopiedBytes = 0;
+		mCopies = static_cast<uint32_t>(runs.size());
+
+		if (!runs.empty())
+		{
+			const auto toCopy = CD3DX12_RESOURCE_BARRIER::Transition(mTable.Get(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST);
+			commandList->ResourceBarrier(1, &toCopy);
+
+			// The staging buffer of the frame is not read by the frames in flight
+			const auto& staging = mStaging[mEngine->mCurrentBackBufferIndex];
+
+			for (const auto& [begin, end] : runs)
+			{
+				std::memcpy(staging.cpu + begin, mNext.data() + begin, end - begin);
+				commandList->CopyBufferRegion(mTable.Get(), begin, staging.buffer.Get(), begin, end - begin);
+
+				mCopiedBytes += end - begin;
+			}
+
+			const auto toRead = CD3DX12_RESOURCE_BARRIER::Transition(mTable.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+			commandList->ResourceBarrier(1, &toRead);
+		}
+
+		mRecords.swap(mNext);
+	}
+
+	void CDX12ShaderTable::SetTables(D3D12_DISPATCH_RAYS_DESC& desc) const
+	{
+		const auto address = mTable->GetGPUVirtualAddress();
+
+		desc.RayGenerationShaderRecord.StartAddress = address + mLayout.RayGen().offset;
+		desc.RayGenerationShaderRecord.SizeInBytes = mLayout.RayGen().size;
+
+		desc.MissShaderTable.StartAddress = address + mLayout.Miss().offset;
+		desc.MissShaderTable.SizeInBytes = mLayout.Miss().size;
+		desc.MissShaderTable.StrideInBytes = mLayout.Miss().stride;
+
+		desc.HitGroupTable.StartAddress = address + mLayout.Hit().offset;
+		desc.HitGroupTable.SizeInBytes = mLayout.Hit().size;
+		desc.HitGroupTable.StrideInBytes = mLayout.Hit().stride;
+	}
+
+	SShaderTableStats CDX12ShaderTable::Stats() const
+	{
+		SShaderTableStats stats;
+		stats.objects = static_cast<uint32_t>(mObjects.size());
+		stats.hitRecords = mLayout.HitRecords();
+		stats.freeRecords = mLayout.FreeHitRecords();
+		stats.tableBytes = mTable ? mTable->GetDesc().Width : 0;
+		stats.copiedBytes = mCopiedBytes;
+		stats.copies = mCopies;
+		return stats;
+	}
+
+	bool CDX12ShaderTable::Reserve(uint64_t size)
+	{
+		if (mTable && size <= mTable->GetDesc().Width) return false;
+
+		while (mLayout.Size(mCapacity) < size) mCapacity *= 2;
+
+		// The old table is freed once the frames using it are done
+		const auto tableSize = mLayout.Size(mCapacity);
+		mTable = mEngine->mResourceAllocator->CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, tableSize, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+		NAME_D3D12_OBJECT(mTable);
+
+		for (uint32_t i = 0; i < mStaging.size(); ++i)
+		{
+			auto& staging = mStaging[i];
+			staging.buffer = mEngine->mResourceAllocator->CreateBuffer(D3D12_HEAP_TYPE_UPLOAD, tableSize, D3D12_RESOURCE_STATE_GENERIC_READ);
+			SetNameIndexed(staging.buffer.Get(), L"ShaderTableStaging", i);
+
+			// Upload buffers can stay mapped
+			const D3D12_RANGE readRange = { 0, 0 };
+			void* data = nullptr;
+			ThrowIfFailed(staging.buffer->Map(0, &readRange, &data));
+			staging.cpu = static_cast<uint8_t*>(data);
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,105 @@
+//--------------------------------------------------------------------------------------
+// Shader binding table
+//--------------------------------------------------------------------------------------
+// A hit record per ray type for every sub-mesh of every object, laid out by CDX12SbtLayout:
+// the primary ray record has the vertex and index buffers of its sub-mesh and the material
+// of its object, the shadow ray record has no arguments. The first record of an object is
+// the InstanceContributionToHitGroupIndex of its top level instance.
+// The table lives in a default heap buffer. Every frame all the records are written again
+// on the CPU, which costs little, and compared with what was written the frame before:
+// only the records that differ (new objects, new materials, a top level structure that
+// moved...) are copied from the frame's upload memory into the table, on the command list,
+// so the frames in flight keep reading what they were recorded with.
+
+#pragma once
+
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include "DX12Common.h"
+#include "DX12SbtLayout.h"
+
+class CGameObject;
+
+namespace DX12
+{
+	class CDX12Engine;
+	class CDX12Mesh;
+
+	struct SShaderTableStats
+	{
+		uint32_t objects     = 0;
+		uint32_t hitRecords  = 0;
+		uint32_t freeRecords = 0;
+		uint64_t tableBytes  = 0; // Of the buffer, with room to grow
+		uint64_t copiedBytes = 0; // In the last update
+		uint32_t copies      = 0; // In the last update
+	};
+
+	class CDX12ShaderTable
+	{
+	public:
+
+		// Primary and shadow rays, the RayContributionToHitGroupIndex of TraceRay
+		static constexpr uint32_t RayTypes = 2;
+
+		CDX12ShaderTable() = delete;
+		CDX12ShaderTable(const CDX12ShaderTable&) = delete;
+		CDX12ShaderTable(const CDX12ShaderTable&&) = delete;
+		CDX12ShaderTable& operator=(const CDX12ShaderTable&) = delete;
+		CDX12ShaderTable& operator=(const CDX12ShaderTable&&) = delete;
+
+		explicit CDX12ShaderTable(CDX12Engine* engine, uint32_t capacity = 256);
+
+		// Gives the hit records to the new objects and takes them back from the ones that are gone
+		void Sync(const std::deque<CGameObject*>& objects);
+
+		// The first hit record of the object. Will throw a std::logic_error exception if it was not synced
+		uint32_t HitGroup(CGameObject* object) const;
+
+		// Writes the records and copies the ones that changed to the table. The pipeline state object has to exist
+		void Update(ID3D12GraphicsCommandList4* commandList);
+
+		// Sets the ray generation, miss and hit tables of the dispatch
+		void SetTables(D3D12_DISPATCH_RAYS_DESC& desc) const;
+
+		const CDX12SbtLayout& Layout() const { return mLayout; }
+
+		SShaderTableStats Stats() const;
+
+	private:
+
+		struct SObject
+		{
+			CDX12Mesh* mesh   = nullptr; // The object can load another mesh
+			uint32_t   first  = 0;
+			uint64_t   synced = 0;
+		};
+
+		// Grows the table if the records do not fit, returns true if it did
+		bool Reserve(uint64_t size);
+
+		CDX12Engine*   mEngine;
+		uint32_t       mCapacity; // Hit records
+		CDX12SbtLayout mLayout;
+
+		std::unordered_map<CGameObject*, SObject> mObjects;
+		uint64_t                                  mSyncs = 0;
+
+		// Mapped upload buffers the changed records are copied from, one per frame in flight
+		struct SStaging
+		{
+			ComPtr<ID3D12Resource> buffer;
+			uint8_t*               cpu = nullptr;
+		};
+
+		ComPtr<ID3D12Resource> mTable;
+		std::vector<SStaging>  mStaging;
+		std::vector<uint8_t>   mRecords; // What the table has
+		std::vector<uint8_t>   mNext;    // Written this frame
+
+		uint64_t mCopiedBytes = 0;
+		uint32_t mCopies      = 0;
+	};
+}
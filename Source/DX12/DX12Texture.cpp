@@ -3,11 +3,16 @@
 #include "DX12ConstantBuffer.h"
 #include "DX12DescriptorHeap.h"
 #include "DX12Engine.h"
-#include "ResourceUploadBatch.h"
+#include "DX12ResourceAllocator.h"
+#include "DX12TextureStreamer.h"
+#include "DX12UploadQueue.h"
+#include "DirectXTex.h"
+#include "../Common/AssetCache.h"
+#include "../Common/MaterialMaps.h"
+#include "../Utility/HelperFunctions.h"
+#include "../Utility/LoadProfiler.h"
 
-#include "../DirectXTK12/Inc/DDSTextureLoader.h"
 #include "../DirectXTK12/Inc/DirectXHelpers.h"
-#include "../DirectXTK12/Inc/WICTextureLoader.h"
 
 namespace DX12
 {
@@ -43,12 +48,12 @@ namespace DX12
 		mSrvHeap = srvHeap;
 	}
 
-	CDX12Texture::CDX12Texture(CDX12Engine* engine, std::string& filename, CDX12DescriptorHeap* srvHeap) : CDX12Resource(engine)
+	CDX12Texture::CDX12Texture(CDX12Engine* engine, std::string& filename, CDX12DescriptorHeap* srvHeap, uint32_t placeholder) : CDX12Resource(engine)
 	{
 		mSrvHandle = srvHeap->Add();
 		mSrvHeap = srvHeap;
 
-		LoadTexture(filename);
+		LoadTexture(filename, placeholder);
 
 		mDesc = mResource->GetDesc();
 
@@ -56,6 +61,62 @@ namespace DX12
 		mTextureRes = { mDesc.Width,mDesc.Height };
 	}
 
+	CDX12Texture::CDX12Texture(CDX12Engine* engine, const SOrmMaps& maps, CDX12DescriptorHeap* srvHeap) : CDX12Resource(engine)
+	{
+		mSrvHandle = srvHeap->Add();
+		mSrvHeap = srvHeap;
+
+		const auto cooked = maps.packed.empty() ? CookedOrmName(maps) : CookedTextureName(maps.packed);
+
+		if (!cooked.empty())
+		{
+			Load(cooked, OrmDefault);
+		}
+		else
+		{
+			// Packed on the scene loader's worker threads, anything else is packed here
+			const auto fileName = OrmFileName(maps);
+
+			CLoadScope scope("Texture Upload", "texture", fileName);
+
+			Upload(*CAssetCache::Instance().Orm(maps), fileName, OrmDefault);
+		}
+
+		mDesc = mResource->GetDesc();
+
+		// Needed for raytracing
+		mTextureRes = { mDesc.Width,mDesc.Height };
+	}
+
+	CDX12Texture::CDX12Texture(CDX12Engine* engine, uint32_t colour, CDX12DescriptorHeap* srvHeap) : CDX12Resource(engine)
+	{
+		mSrvHandle = srvHeap->Add();
+		mSrvHeap = srvHeap;
+
+		const uint8_t texel[4] =
+		{
+			static_cast<uint8_t>(colour >> 24),
+			static_cast<uint8_t>(colour >> 16),
+			static_cast<uint8_t>(colour >> 8),
+			static_cast<uint8_t>(colour),
+		};
+
+		D3D12_SUBRESOURCE_DATA data = {};
+		data.pData = texel;
+		data.RowPitch = sizeof(texel);
+		data.SlicePitch = sizeof(texel);
+
+		mDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1, 1, 1);
+		mTextureRes = { 1, 1 };
+
+		// Without a completion callback the frames wait for the copy, so the descriptor can be used at once
+		mResource = mEngine->mUploadQueue->CreateTexture(mDesc, &data, 1, L"Placeholder");
+		mCurrentResourceState = D3D12_RESOURCE_STATE_COMMON;
+
+		DirectX::CreateShaderResourceView(mEngine->mDevice.Get(), mResource.Get(), mSrvHeap->Get(mSrvHandle).mCpu);
+		mSrvHeap->Commit(mSrvHandle);
+	}
+
 	CDX12Texture::CDX12Texture(CDX12Engine* engine, D3D12_RESOURCE_DESC desc, CDX12DescriptorHeap* srvHeap) : CDX12Resource(engine)
 	{
 		mSrvHandle = srvHeap->Add();
@@ -66,6 +127,8 @@ namespace DX12
 
 	CDX12Texture::~CDX12Texture()
 	{
+		if (mStreamed) mEngine->mTextureStreamer->Remove(this);
+
 		if (mSrvHeap && mSrvHandle) mSrvHeap->Remove(mSrvHandle);
 	}
 
@@ -84,60 +147,112 @@ namespace DX12
 		return mSrvHeap->Get(mSrvHandle);
 	}
 
-	void CDX12Texture::LoadTexture(std::string& filename)
+	void CDX12Texture::OnViewChanged(std::function<void()> callback)
 	{
-		filename = mEngine->GetMediaFolder() + filename;
+		mUpload->onViewChanged.push_back(std::move(callback));
+	}
 
-		const auto device = mEngine->mDevice.Get();
+	void CDX12Texture::Replace(ComPtr<ID3D12Resource> resource)
+	{
+		// The old resource is freed once the frames in flight are done with it
+		mResource = std::move(resource);
+		mCurrentResourceState = D3D12_RESOURCE_STATE_COMMON;
 
-		DirectX::ResourceUploadBatch resourceUpload(device);
+		mDesc = mResource->GetDesc();
+		mTextureRes = { mDesc.Width, mDesc.Height };
 
-		resourceUpload.Begin();
+		// The frames in flight may still read the old view: the new one goes to a new slot and the old slot
+		// is given back once the frame fence passes them
+		const auto previous = mSrvHandle;
+		mSrvHandle = mSrvHeap->Add();
 
-		ComPtr<ID3D12Resource> textureResource;
+		DirectX::CreateShaderResourceView(mEngine->mDevice.Get(), mResource.Get(), mSrvHeap->Get(mSrvHandle).mCpu);
+		mSrvHeap->Commit(mSrvHandle);
 
-		const auto resourceFlags = D3D12_RESOURCE_FLAG_NONE;
+		mSrvHeap->Remove(previous);
 
-		const bool isSrgb = 0;
-		//filename.find("Albedo") != std::string::npos;
+		mUpload->ready = true;
+		for (const auto& callback : mUpload->onViewChanged) callback();
+	}
 
-		auto ddsFlags = (isSrgb ? DirectX::DDS_LOADER_FORCE_SRGB : DirectX::DDS_LOADER_DEFAULT) | DirectX::DDS_LOADER_MIP_AUTOGEN;
-		auto wicFlags = (isSrgb ? DirectX::WIC_LOADER_FORCE_SRGB : DirectX::WIC_LOADER_DEFAULT) | DirectX::WIC_LOADER_MIP_AUTOGEN;
+	void CDX12Texture::LoadTexture(std::string& filename, uint32_t placeholder)
+	{
+		filename = mEngine->GetMediaFolder() + filename;
 
-		// DDS files need a different function from other files
-		std::string dds = ".dds"; // So check the filename extension (case insensitive)
-		if (filename.size() >= 4 && std::equal(dds.rbegin(),
-			dds.rend(),
-			filename.rbegin(),
-			[](unsigned char a, unsigned char b)
-			{
-				return std::tolower(a) == std::tolower(b);
-			}))
+		// The DDS file of the texture cooker if there is one, with its mips and block compressed
+		Load(CookedTextureName(filename), placeholder);
+	}
+
+	void CDX12Texture::Load(const std::string& file, uint32_t placeholder)
+	{
+		// Cooked DDS files with their mip chain start with their smallest mips, the streamer loads the others when needed
+		if (mEngine->mTextureStreamer && mEngine->mTextureStreamer->Add(this, file))
 		{
-			if (FAILED(DirectX::CreateDDSTextureFromFileEx(
-				device, resourceUpload, std::wstring(filename.begin(), filename.end()).c_str(), 0, resourceFlags, ddsFlags, textureResource.GetAddressOf())))
-			{
-				throw std::runtime_error("Failed to load image: " + filename);
-			}
+			mStreamed = true;
+			return;
 		}
-		else
+
+		CLoadScope scope("Texture Upload", "texture", file);
+
+		// The scene loader decodes the image and its mips on a worker thread, anything else is decoded here
+		Upload(*CAssetCache::Instance().Texture(file), file, placeholder);
+	}
+
+	void CDX12Texture::Upload(const DirectX::ScratchImage& image, const std::string& name, uint32_t placeholder)
+	{
+		const auto device = mEngine->mDevice.Get();
+
+		const auto& metadata = image.GetMetadata();
+
+		// Same description as DirectX::CreateTexture, but placed in the engine's resource heaps
+		const auto desc = CD3DX12_RESOURCE_DESC(
+			static_cast<D3D12_RESOURCE_DIMENSION>(metadata.dimension),
+			0,
+			metadata.width,
+			static_cast<UINT>(metadata.height),
+			static_cast<UINT16>(metadata.dimension == DirectX::TEX_DIMENSION_TEXTURE3D ? metadata.depth : metadata.arraySize),
+			static_cast<UINT16>(metadata.mipLevels),
+			metadata.format,
+			1,
+			0,
+			D3D12_TEXTURE_LAYOUT_UNKNOWN,
+			D3D12_RESOURCE_FLAG_NONE);
+
+		std::vector<D3D12_SUBRESOURCE_DATA> subresources;
+
+		if (FAILED(DirectX::PrepareUpload(device, image.GetImages(), image.GetImageCount(), metadata, subresources)))
 		{
-			if (FAILED(DirectX::CreateWICTextureFromFileEx(
-				device, resourceUpload, std::wstring(filename.begin(), filename.end()).c_str(), 0, resourceFlags, wicFlags, textureResource.GetAddressOf())))
-			{
-				throw std::runtime_error("Failed to load image: " + filename);
-			}
+			throw std::runtime_error("Failed to load image: " + name);
 		}
 
-		DirectX::CreateShaderResourceView(device, textureResource.Get(), mSrvHeap->Get(mSrvHandle).mCpu);
+		const auto count = static_cast<UINT>(subresources.size());
 
-		const auto uploadResourceFinished = resourceUpload.End(mEngine->mCommandQueue.Get());
+		// The copy queue leaves the texture in the common state, promoted when the shaders read it
+		mCurrentResourceState = D3D12_RESOURCE_STATE_COMMON;
 
-		uploadResourceFinished.wait();
+		if (metadata.IsCubemap() || metadata.dimension != DirectX::TEX_DIMENSION_TEXTURE2D)
+		{
+			// No placeholder of that shape, the frames wait for the copy like for a buffer
+			mResource = mEngine->mUploadQueue->CreateTexture(desc, subresources.data(), count);
 
-		mResource = textureResource;
+			DirectX::CreateShaderResourceView(device, mResource.Get(), mSrvHeap->Get(mSrvHandle).mCpu, metadata.IsCubemap());
+			mSrvHeap->Commit(mSrvHandle);
+			return;
+		}
 
-		device->Release();
+		device->CopyDescriptorsSimple(1, mSrvHeap->Get(mSrvHandle).mCpu, mEngine->Placeholder(placeholder)->GetHandle().mCpu, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		mSrvHeap->Commit(mSrvHandle);
+
+		mUpload->ready = false;
+
+		// Run by ProcessCompletions, on the thread that creates the textures, once the copy queue is done with the batch
+		const std::weak_ptr<SUpload> upload = mUpload;
+		mResource = mEngine->mUploadQueue->CreateTexture(desc, subresources.data(), count, nullptr, [this, upload]()
+		{
+			if (upload.expired()) return;
+
+			Replace(mResource);
+		});
 	}
 
 	void CDX12Texture::CreateTexture(D3D12_RESOURCE_DESC desc)
@@ -146,16 +261,9 @@ namespace DX12
 
 		const auto clearValue = CD3DX12_CLEAR_VALUE(desc.Format, clearColor);
 
-		const auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-
 		const auto device = mEngine->mDevice.Get();
 
-		device->CreateCommittedResource(&heapProperties,
-			D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES,
-			&desc,
-			D3D12_RESOURCE_STATE_COMMON,
-			&clearValue,
-			IID_PPV_ARGS(mResource.GetAddressOf()));
+		mResource = mEngine->mResourceAllocator->CreateResource(D3D12_HEAP_TYPE_DEFAULT, desc, D3D12_RESOURCE_STATE_COMMON, &clearValue);
 
 
 		mCurrentResourceState = D3D12_RESOURCE_STATE_COMMON;
@@ -164,6 +272,7 @@ namespace DX12
 			mResource.Get(),
 			mSrvHeap->Get(mSrvHandle).mCpu,
 			desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D);
+		mSrvHeap->Commit(mSrvHandle);
 
 		device->Release();
 	}
@@ -171,16 +280,9 @@ namespace DX12
 
 	void CDX12Texture::CreateTexture(D3D12_RESOURCE_DESC desc, D3D12_CLEAR_VALUE clearValue)
 	{
-		const auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-
 		const auto device = mEngine->mDevice.Get();
 
-		device->CreateCommittedResource(&heapProperties,
-			D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES,
-			&desc,
-			D3D12_RESOURCE_STATE_COMMON,
-			&clearValue,
-			IID_PPV_ARGS(mResource.GetAddressOf()));
+		mResource = mEngine->mResourceAllocator->CreateResource(D3D12_HEAP_TYPE_DEFAULT, desc, D3D12_RESOURCE_STATE_COMMON, &clearValue);
 
 
 		mCurrentResourceState = D3D12_RESOURCE_STATE_COMMON;
@@ -189,6 +291,7 @@ namespace DX12
 			mResource.Get(),
 			mSrvHeap->Get(mSrvHandle).mCpu,
 			desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D);
+		mSrvHeap->Commit(mSrvHandle);
 
 		device->Release();
 	}
@@ -246,16 +349,9 @@ namespace DX12
 		clearValue.DepthStencil.Depth = 1.0f;
 		clearValue.DepthStencil.Stencil = 0;
 
-		const auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-
 		const auto device = mEngine->mDevice.Get();
 
-		device->CreateCommittedResource(&heapProperties,
-			D3D12_HEAP_FLAG_NONE,
-			&desc,
-			D3D12_RESOURCE_STATE_COMMON,
-			&clearValue,
-			IID_PPV_ARGS(mResource.GetAddressOf()));
+		mResource = mEngine->mResourceAllocator->CreateResource(D3D12_HEAP_TYPE_DEFAULT, desc, D3D12_RESOURCE_STATE_COMMON, &clearValue);
 
 		device->CreateDepthStencilView(mResource.Get(), nullptr, mDsvHeap->Get(mDsvHandle).mCpu);
 
@@ -1,7 +1,15 @@
 #pragma once
 
+#include <functional>
+#include <memory>
+#include <vector>
+
 #include "DX12Common.h"
 
+namespace DirectX { class ScratchImage; }
+
+struct SOrmMaps;
+
 namespace DX12
 {
 	class CDX12ConstantBuffer;
@@ -31,6 +39,12 @@ namespace DX12
 	{
 	public:
 
+		// Colours of the one texel textures shown while a file is being copied, RGBA with red in the high byte
+		static constexpr uint32_t PlaceholderGrey       = 0x808080FF;
+		static constexpr uint32_t PlaceholderWhite      = 0xFFFFFFFF;
+		static constexpr uint32_t PlaceholderBlack      = 0x000000FF;
+		static constexpr uint32_t PlaceholderFlatNormal = 0x8080FFFF;
+
 		~CDX12Texture() override;
 
 		CDX12Texture(CDX12Engine* engine, const ComPtr<ID3D12Resource>& res);
@@ -51,7 +65,15 @@ namespace DX12
 		// Leave the resource uninitialized (use carefully)
 		CDX12Texture(CDX12Engine* engine, CDX12DescriptorHeap* srvHeap);
 
-		CDX12Texture(CDX12Engine* engine, std::string& filename, CDX12DescriptorHeap* srvHeap);
+		// The descriptor shows the engine's placeholder of that colour until the copy of the file is done
+		CDX12Texture(CDX12Engine* engine, std::string& filename, CDX12DescriptorHeap* srvHeap, uint32_t placeholder = PlaceholderGrey);
+
+		// The AO, roughness and metalness maps packed in one texture (full paths), from the cooked file if it is current
+		// The placeholder is OrmDefault, the values the shaders use without the maps
+		CDX12Texture(CDX12Engine* engine, const SOrmMaps& maps, CDX12DescriptorHeap* srvHeap);
+
+		// A one texel texture of the colour, used by the frames as soon as it is created
+		CDX12Texture(CDX12Engine* engine, uint32_t colour, CDX12DescriptorHeap* srvHeap);
 
 		CDX12Texture(CDX12Engine* engine, D3D12_RESOURCE_DESC desc, CDX12DescriptorHeap* srvHeap);
 
@@ -59,9 +81,40 @@ namespace DX12
 
 		SHandle GetHandle();
 
+		// False while the descriptor still shows the placeholder
+		bool Ready() const { return mUpload->ready; }
+
+		// Called every time the texture gets a new view: the copy of the file is done, streamed mips came in...
+		// mSrvHandle is another index then, copies of the descriptor (e.g. in a descriptor table) have to be made again
+		void OnViewChanged(std::function<void()> callback);
+
+		// Use another resource (e.g. with other mips of the same image) with a view in a new slot of the heap
+		// The old slot is freed once the frames in flight are done with it
+		void Replace(ComPtr<ID3D12Resource> resource);
+
+		// The mips of the texture are chosen by the engine's texture streamer
+		bool Streamed() const { return mStreamed; }
+
 	protected:
 
-		void LoadTexture(std::string& filename);
+		// Shared with the completion of the copy, which may come after the texture is gone
+		struct SUpload
+		{
+			bool                               ready = true;
+			std::vector<std::function<void()>> onViewChanged;
+		};
+
+		std::shared_ptr<SUpload> mUpload = std::make_shared<SUpload>();
+
+		bool mStreamed = false;
+
+		void LoadTexture(std::string& filename, uint32_t placeholder);
+
+		// Streams the file if it can, otherwise uploads it from the asset cache
+		void Load(const std::string& file, uint32_t placeholder);
+
+		// Creates the texture with the copy of the image, name is only used for the errors
+		void Upload(const DirectX::ScratchImage& image, const std::string& name, uint32_t placeholder);
 		void CreateTexture(D3D12_RESOURCE_DESC desc);
 		void CreateTexture(D3D12_RESOURCE_DESC desc, D3D12_CLEAR_VALUE clearValue);
 	};
@@ -0,0 +1,245 @@
+#include "DX12TextureStreamer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+#include "CDX12Material.h"
+#include "DX12Engine.h"
+#include "DX12Mesh.h"
+#include "DX12Texture.h"
+#include "DX12UploadQueue.h"
+#include "Objects/DX12GameObject.h"
+#include "../Common/AssetCache.h"
+#include "../Common/Camera.h"
+#include "../Utility/LoadProfiler.h"
+
+namespace DX12
+{
+	CDX12TextureStreamer::CDX12TextureStreamer(CDX12Engine* engine, uint64_t budget, unsigned int numThreads) :
+		mEngine(engine),
+		mResidency(budget),
+		mPool(numThreads)
+	{
+	}
+
+	CDX12TextureStreamer::~CDX12TextureStreamer()
+	{
+		mPool.wait_for_tasks();
+	}
+
+	bool CDX12TextureStreamer::Add(CDX12Texture* texture, const std::string& fileName)
+	{
+		if (!HasExtension(fileName, ".dds")) return false;
+
+		CLoadScope scope("Texture Stream Tail", "texture", fileName);
+
+		std::ifstream file(fileName, std::ios::binary);
+		if (!file) return false;
+
+		std::vector<uint8_t> header(DdsHeaderSize + DdsHeaderDx10Size);
+		file.read(reinterpret_cast<char*>(header.data()), header.size());
+		header.resize(static_cast<size_t>(file.gcount()));
+
+		DirectX::TexMetadata metadata;
+		if (header.size() < DdsHeaderSize || FAILED(DirectX::GetMetadataFromDDSMemory(header.data(), header.size(), DirectX::DDS_FLAGS_NONE, metadata))) return false;
+
+		// One image with its mips, the only layout where the mips from one on are the end of the file
+		if (metadata.dimension != DirectX::TEX_DIMENSION_TEXTURE2D || metadata.arraySize != 1 || metadata.IsCubemap() || metadata.mipLevels < 2) return false;
+
+		const auto mips = static_cast<uint32_t>(metadata.mipLevels);
+
+		SStreamed streamed;
+		streamed.texture = texture;
+		streamed.fileName = fileName;
+		streamed.metadata = metadata;
+
+		std::vector<uint64_t> mipBytes;
+		for (uint32_t mip = 0; mip < mips; ++mip)
+		{
+			size_t rowPitch, slicePitch;
+			if (FAILED(DirectX::ComputePitch(metadata.format, MipExtent(metadata.width, mip), MipExtent(metadata.height, mip), rowPitch, slicePitch))) return false;
+
+			mipBytes.push_back(slicePitch);
+		}
+		streamed.mipOffsets = MipOffsets(DdsDataOffset(header.data()), mipBytes);
+
+		// Formats converted on load, or anything else in the file, would not be where the mips are expected
+		if (streamed.mipOffsets.back() != std::filesystem::file_size(fileName)) return false;
+
+		const auto tail = TailMip(metadata.width, metadata.height, mips, TailSize);
+
+		// Any mip up to the tail can become the largest one
+		if (DirectX::IsCompressed(metadata.format) && !WholeBlocks(metadata.width, metadata.height, tail)) return false;
+
+		const auto id = mResidency.Add(std::move(mipBytes), tail);
+		streamed.serial = ++mSerial;
+		mTextures[id] = std::move(streamed);
+		mIds[texture] = id;
+
+		// The tail is small, the frames wait for its copy and the view is written at once
+		try
+		{
+			const auto& s = mTextures[id];
+			Upload(id, tail, ReadMips(fileName, s.mipOffsets[tail], s.mipOffsets.back() - s.mipOffsets[tail]));
+		}
+		catch (...)
+		{
+			// The constructor of the texture throws, its destructor will not remove it
+			Remove(texture);
+			throw;
+		}
+
+		return true;
+	}
+
+	void CDX12TextureStreamer::Remove(CDX12Texture* texture)
+	{
+		const auto found = mIds.find(texture);
+		if (found == mIds.end()) return;
+
+		// The reads and copies in flight see that the serial changed
+		mResidency.Remove(found->second);
+		mTextures.erase(found->second);
+		mIds.erase(found);
+	}
+
+	void CDX12TextureStreamer::Update(CCamera* camera, const std::deque<CGameObject*>& objects, float viewportWidth)
+	{
+		if (camera && !mIds.empty())
+		{
+			const auto eye = camera->Position();
+
+			for (const auto object : objects)
+			{
+				const auto o = dynamic_cast<CDX12GameObject*>(object);
+				if (!o || !*o->Enabled() || !o->Mesh() || !o->Material()) continue;
+
+				const auto scale = o->Scale();
+				const auto radius = o->Mesh()->mBoundingRadius * std::max({ scale.x, scale.y, scale.z });
+				const auto pixels = ProjectedPixels(radius, Length(o->Position() - eye), camera->FOV(), viewportWidth);
+
+				const auto material = o->Material();
+				for (const auto map : { material->mAlbedo.get(), material->mNormal.get(), material->mDisplacement.get(), material->mOrm.get() })
+				{
+					if (!map) continue;
+
+					const auto found = mIds.find(map);
+					if (found == mIds.end()) continue;
+
+					const auto& metadata = mTextures[found->second].metadata;
+					mResidency.Request(found->second, MipForScreenSize(static_cast<uint32_t>(metadata.width), static_cast<uint32_t>(metadata.mipLevels), pixels, mBias));
+				}
+			}
+		}
+
+		Stream(mResidency.Update());
+
+#if defined(_DEBUG)
+		mResidency.Validate();
+#endif
+	}
+
+	std::vector<uint8_t> CDX12TextureStreamer::ReadMips(const std::string& fileName, size_t offset, size_t size)
+	{
+		std::ifstream file(fileName, std::ios::binary);
+		if (!file) throw std::runtime_error("Error opening the streamed texture " + fileName);
+
+		std::vector<uint8_t> data(size);
+		file.seekg(static_cast<std::streamoff>(offset));
+		file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(size));
+
+		if (!file) throw std::runtime_error("Error reading the mips of the streamed texture " + fileName);
+
+		return data;
+	}
+
+	void CDX12TextureStreamer::Upload(uint32_t texture, uint32_t mip, const std::vector<uint8_t>& data)
+	{
+		const auto& streamed = mTextures.at(texture);
+		const auto& metadata = streamed.metadata;
+		const auto  mips = static_cast<uint32_t>(metadata.mipLevels);
+
+		std::vector<D3D12_SUBRESOURCE_DATA> subresources;
+		for (auto i = mip; i < mips; ++i)
+		{
+			size_t rowPitch, slicePitch;
+			ThrowIfFailed(DirectX::ComputePitch(metadata.format, MipExtent(metadata.width, i), MipExtent(metadata.height, i), rowPitch, slicePitch));
+
+			D3D12_SUBRESOURCE_DATA subresource = {};
+			subresource.pData = data.data() + (streamed.mipOffsets[i] - streamed.mipOffsets[mip]);
+			subresource.RowPitch = static_cast<LONG_PTR>(rowPitch);
+			subresource.SlicePitch = static_cast<LONG_PTR>(slicePitch);
+			subresources.push_back(subresource);
+		}
+
+		const auto desc = CD3DX12_RESOURCE_DESC::Tex2D(metadata.format, MipExtent(metadata.width, mip), static_cast<UINT>(MipExtent(metadata.height, mip)), 1, static_cast<UINT16>(mips - mip));
+
+		const auto queue = mEngine->mUploadQueue.get();
+		const auto count = static_cast<UINT>(subresources.size());
+
+		// The tail, when the texture is added
+		if (!mResidency.Streaming(texture))
+		{
+			streamed.texture->Replace(queue->CreateTexture(desc, subresources.data(), count, L"StreamedTexture"));
+			return;
+		}
+
+		// The texture keeps its old mips until the copies are done, the new ones are only known to the callback meanwhile
+		const auto serial = streamed.serial;
+		const auto resource = std::make_shared<ComPtr<ID3D12Resource>>();
+		*resource = queue->CreateTexture(desc, subresources.data(), count, L"StreamedTexture", [this, texture, serial, resource]()
+		{
+			const auto found = mTextures.find(texture);
+			if (found == mTextures.end() || found->second.serial != serial) return;
+
+			found->second.texture->Replace(*resource);
+			mResidency.Loaded(texture);
+		});
+	}
+
+	void CDX12TextureStreamer::Stream(const std::vector<SMipChange>& changes)
+	{
+		// The reads that are done, in whatever order they finish
+		for (auto read = mReads.begin(); read != mReads.end();)
+		{
+			if (read->data.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				++read;
+				continue;
+			}
+
+			const auto found = mTextures.find(read->texture);
+			const auto live = found != mTextures.end() && found->second.serial == read->serial;
+
+			try
+			{
+				const auto data = read->data.get();
+				if (live) Upload(read->texture, read->mip, data);
+			}
+			catch (const std::exception& e)
+			{
+				// The texture keeps the mips it has
+				OutputDebugStringA(e.what());
+				if (live) mResidency.Cancelled(read->texture);
+			}
+
+			read = mReads.erase(read);
+		}
+
+		for (const auto& change : changes)
+		{
+			const auto& streamed = mTextures.at(change.texture);
+			const auto  offset = streamed.mipOffsets[change.mip];
+			const auto  size = streamed.mipOffsets.back() - offset;
+
+			SRead read;
+			read.texture = change.texture;
+			read.serial = streamed.serial;
+			read.mip = change.mip;
+			read.data = mPool.submit([fileName = streamed.fileName, offset, size] { return ReadMips(fileName, offset, size); });
+			mReads.push_back(std::move(read));
+		}
+	}
+}
@@ -0,0 +1,113 @@
+//--------------------------------------------------------------------------------------
+// Texture mip streaming
+//--------------------------------------------------------------------------------------
+// Keeps only the mips the objects need in video memory, within a budget, for the textures
+// cooked to DDS files with their whole mip chain (2D, one array slice). A streamed texture
+// is created with its smallest mips only; every frame its objects request the mips their
+// size on the screen needs (from the camera and the bounding radius of their mesh), and
+// CDX12MipResidency chooses which textures get larger or smaller mips.
+// The mips of a DDS file are stored from the largest to the smallest, so the mips from a
+// given one on are the end of the file: a change reads that range on a thread pool, then
+// a texture with just those mips is created and filled on the copy queue. Once the copies
+// are done the view of the texture is replaced, and the old resource freed after the frames
+// in flight, so the shaders never read a texture that is being streamed.
+
+#pragma once
+
+#include <deque>
+#include <future>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <thread_pool.hpp>
+
+#include "DX12Common.h"
+#include "DX12MipResidency.h"
+#include "DirectXTex.h"
+
+class CCamera;
+class CGameObject;
+
+namespace DX12
+{
+	class CDX12Engine;
+	class CDX12Texture;
+
+	class CDX12TextureStreamer
+	{
+	public:
+
+		static constexpr uint64_t DefaultBudget = 512ull * 1024 * 1024;
+
+		// Textures start with the mips up to this size, and never have fewer
+		static constexpr uint32_t TailSize = 64;
+
+		CDX12TextureStreamer() = delete;
+		CDX12TextureStreamer(const CDX12TextureStreamer&) = delete;
+		CDX12TextureStreamer(const CDX12TextureStreamer&&) = delete;
+		CDX12TextureStreamer& operator=(const CDX12TextureStreamer&) = delete;
+		CDX12TextureStreamer& operator=(const CDX12TextureStreamer&&) = delete;
+
+		explicit CDX12TextureStreamer(CDX12Engine* engine, uint64_t budget = DefaultBudget, unsigned int numThreads = 2);
+
+		// Waits for the reads in flight
+		~CDX12TextureStreamer();
+
+		// Creates the resource of the texture with the smallest mips of the file and writes its view
+		// Returns false if the file cannot be streamed, the texture is then left untouched
+		bool Add(CDX12Texture* texture, const std::string& fileName);
+
+		void Remove(CDX12Texture* texture);
+
+		// Requests the mips of the objects' textures from their size on the screen, starts the reads of the
+		// changes and the copies of the reads that are done
+		void Update(CCamera* camera, const std::deque<CGameObject*>& objects, float viewportWidth);
+
+		// Larger values give smaller mips, in mip levels
+		float mBias = 0.0f;
+
+		void     SetBudget(uint64_t bytes) { mResidency.SetBudget(bytes); }
+		uint64_t Budget() const { return mResidency.Budget(); }
+
+		SMipResidencyStats Stats() const { return mResidency.Stats(); }
+
+	private:
+
+		struct SStreamed
+		{
+			CDX12Texture*        texture = nullptr;
+			std::string          fileName;
+			DirectX::TexMetadata metadata;
+			std::vector<size_t>  mipOffsets; // In the file, with the size of the file at the end
+			uint64_t             serial = 0;  // Tells a texture from the one that had its ID before it
+		};
+
+		struct SRead
+		{
+			uint32_t                          texture = 0;
+			uint64_t                          serial  = 0;
+			uint32_t                          mip     = 0;
+			std::future<std::vector<uint8_t>> data;
+		};
+
+		// Reads the mips from mip on
+		static std::vector<uint8_t> ReadMips(const std::string& fileName, size_t offset, size_t size);
+
+		// Queues the copies of the mips from mip on to a new resource, which replaces the one of the texture when they are done
+		void Upload(uint32_t texture, uint32_t mip, const std::vector<uint8_t>& data);
+
+		// Starts the reads of the changes and the uploads of the reads that are done
+		void Stream(const std::vector<SMipChange>& changes);
+
+		CDX12Engine*      mEngine;
+		CDX12MipResidency mResidency;
+
+		std::unordered_map<uint32_t, SStreamed>       mTextures;
+		std::unordered_map<CDX12Texture*, uint32_t>   mIds;
+		uint64_t                                      mSerial = 0;
+
+		std::vector<SRead> mReads;
+		thread_pool        mPool;
+	};
+}
@@ -0,0 +1,201 @@
+#include "DX12Tlas.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "DX12BlasCache.h"
+#include "DX12Engine.h"
+#include "DX12Mesh.h"
+#include "DX12ResourceAllocator.h"
+#include "DX12ShaderTable.h"
+#include "DX12UploadAllocator.h"
+#include "Objects/DX12GameObject.h"
+
+namespace DX12
+{
+	CDX12Tlas::CDX12Tlas(CDX12Engine* engine, uint32_t capacity) :
+		mEngine(engine),
+		mCapacity(std::max(capacity, 1u))
+	{
+	}
+
+	bool CDX12Tlas::Sync(const std::deque<CGameObject*>& objects)
+	{
+		++mSyncs;
+
+		for (const auto object : objects)
+		{
+			const auto o = dynamic_cast<CDX12GameObject*>(object);
+			if (!o || !o->Mesh()) continue;
+
+			auto& entry = mObjects[object];
+			entry.synced = mSyncs;
+
+			// A new object, or one that loaded another mesh
+			if (entry.mesh != o->Mesh())
+			{
+				if (entry.instance != CDX12TlasInstances::InvalidInstance) mInstances.Remove(entry.instance);
+
+				entry.mesh = o->Mesh();
+				entry.blas = mEngine->mBlasCache->Request(entry.mesh);
+				entry.instance = CDX12TlasInstances::InvalidInstance;
+			}
+			else if (entry.instance != CDX12TlasInstances::InvalidInstance)
+			{
+				mInstances.SetTransform(entry.instance, o->WorldMatrix());
+			}
+		}
+
+		// The objects that were not in the list are gone
+		for (auto it = mObjects.begin(); it != mObjects.end();)
+		{
+			if (it->second.synced == mSyncs)
+			{
+				++it;
+				continue;
+			}
+
+			if (it->second.instance != CDX12TlasInstances::InvalidInstance) mInstances.Remove(it->second.instance);
+			it = mObjects.erase(it);
+		}
+
+		AddBuilt();
+
+#if defined(_DEBUG)
+		mInstances.Validate();
+#endif
+
+		// Update adds the objects waiting for their bottom level structure if it is built this frame
+		auto slots = static_cast<uint32_t>(mInstances.Slots().size());
+		for (const auto& [object, entry] : mObjects)
+		{
+			if (entry.instance == CDX12TlasInstances::InvalidInstance) ++slots;
+		}
+
+		const auto resized = Reserve(slots);
+		mRebuild |= resized;
+		return resized;
+	}
+
+	void CDX12Tlas::Update(ID3D12GraphicsCommandList4* commandList)
+	{
+		auto blasCache = mEngine->mBlasCache.get();
+
+		// The compacted sizes are read back once the frame that built the structures is done
+		if (blasCache->Compacting() && mEngine->mFence->GetCompletedValue() >= mBlasFence)
+		{
+			blasCache->Compact(commandList);
+			mInstances.Invalidate();
+		}
+
+		if (blasCache->Pending() && !blasCache->Compacting())
+		{
+			blasCache->Build(commandList);
+			mBlasFence = mEngine->mFenceValue + 1;
+
+			AddBuilt();
+		}
+
+		// The frames in flight trace against the buffers, only Sync can move them
+		const auto& slots = mInstances.Slots();
+		if (!mResult || slots.size() > mCapacity) throw std::logic_error("Top level structure updated with more instances than synced");
+
+		const auto build = mRebuild ? ETlasBuild::Rebuild : mInstances.NextBuild();
+		mRebuild = false;
+		if (build == ETlasBuild::None)
+		{
+			mInstances.Built(build);
+			return;
+		}
+
+		// Every slot is written, the free ones as inactive instances
+		const auto descs = mEngine->mUploadAllocator->Allocate(std::max<size_t>(slots.size(), 1) * sizeof(D3D12_RAYTRACING_INSTANCE_DESC),
+			D3D12_RAYTRACING_INSTANCE_DESCS_BYTE_ALIGNMENT);
+		const auto instanceDescs = static_cast<D3D12_RAYTRACING_INSTANCE_DESC*>(descs.cpu);
+		std::memset(instanceDescs, 0, descs.size);
+
+		for (uint32_t i = 0; i < slots.size(); ++i)
+		{
+			if (slots[i].blas == CDX12TlasInstances::InvalidBlas) continue;
+
+			auto& desc = instanceDescs[i];
+
+			// The instance description is a row major 3x4, the engine matrices have the translation in the last row
+			auto transform = slots[i].transform;
+			transform.Transpose();
+			std::memcpy(desc.Transform, &transform, sizeof(desc.Transform));
+
+			desc.InstanceID = i;
+			desc.InstanceMask = 0xFF;
+			desc.InstanceContributionToHitGroupIndex = slots[i].hitGroup;
+			desc.Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
+			desc.AccelerationStructure = blasCache->Resource(slots[i].blas)->GetGPUVirtualAddress();
+		}
+
+		D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC desc = {};
+		desc.Inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
+		desc.Inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+		desc.Inputs.NumDescs = static_cast<UINT>(slots.size());
+		desc.Inputs.InstanceDescs = descs.gpu;
+		desc.Inputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
+		desc.DestAccelerationStructureData = mResult->GetGPUVirtualAddress();
+		desc.ScratchAccelerationStructureData = mScratch->GetGPUVirtualAddress();
+
+		// A refit reads the last structure and writes over it
+		if (build == ETlasBuild::Refit)
+		{
+			desc.Inputs.Flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
+			desc.SourceAccelerationStructureData = mResult->GetGPUVirtualAddress();
+		}
+
+		commandList->BuildRaytracingAccelerationStructure(&desc, 0, nullptr);
+
+		const auto barrier = CD3DX12_RESOURCE_BARRIER::UAV(mResult.Get());
+		commandList->ResourceBarrier(1, &barrier);
+
+		mInstances.Built(build);
+	}
+
+	void CDX12Tlas::AddBuilt()
+	{
+		for (auto& [object, entry] : mObjects)
+		{
+			if (entry.instance != CDX12TlasInstances::InvalidInstance || !mEngine->mBlasCache->Resource(entry.blas)) continue;
+
+			entry.instance = mInstances.Add(entry.blas, object->WorldMatrix(), mEngine->mShaderTable->HitGroup(object));
+		}
+	}
+
+	bool CDX12Tlas::Reserve(uint32_t slots)
+	{
+		if (mResult && slots <= mCapacity) return false;
+
+		while (mCapacity < slots) mCapacity *= 2;
+
+		D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs = {};
+		inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
+		inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+		inputs.NumDescs = mCapacity;
+		inputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
+
+		D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO info = {};
+		mEngine->mDevice->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &info);
+
+		const auto resultSize = ROUND_UP(info.ResultDataMaxSizeInBytes, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
+		const auto scratchSize = ROUND_UP(std::max(info.ScratchDataSizeInBytes, info.UpdateScratchDataSizeInBytes), D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
+
+		// The frames in flight may still trace against the old buffers, they are kept until the frame fence passes them
+		mEngine->mResourceAllocator->Retire(std::move(mResult));
+		mEngine->mResourceAllocator->Retire(std::move(mScratch));
+
+		mResult = mEngine->mResourceAllocator->CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, resultSize,
+			D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+		mScratch = mEngine->mResourceAllocator->CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, scratchSize,
+			D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+		NAME_D3D12_OBJECT(mResult);
+		NAME_D3D12_OBJECT(mScratch);
+
+		return true;
+	}
+}
@@ -0,0 +1,84 @@
+//--------------------------------------------------------------------------------------
+// Top level acceleration structure
+//--------------------------------------------------------------------------------------
+// Keeps an instance for every game object with a mesh. Sync is called every frame with
+// the objects of the scene: new objects get an instance (once the bottom level structure
+// of their mesh is built), the ones that are gone lose theirs and the others only pass on
+// their world matrix. An instance points at the hit records CDX12ShaderTable gave to its
+// object, so the shader table has to be synced first. Update then records what CDX12TlasInstances asks for: nothing, a
+// refit in place or a full rebuild.
+// The bottom level structures of meshes loaded at runtime are built in the frame that
+// needs them, and compacted in a later frame once the GPU went past it, which asks for a
+// rebuild as the instances point at the new buffers.
+// The instance descriptions are written in the upload memory of the frame, and the result
+// and scratch buffers are sized for a number of slots that doubles when they run out. Sync
+// sizes them for every instance the frame can add, so they never move while it is recorded.
+
+#pragma once
+
+#include <deque>
+#include <unordered_map>
+
+#include "DX12Common.h"
+#include "DX12TlasInstances.h"
+
+class CGameObject;
+
+namespace DX12
+{
+	class CDX12Engine;
+	class CDX12Mesh;
+
+	class CDX12Tlas
+	{
+	public:
+
+		CDX12Tlas() = delete;
+		CDX12Tlas(const CDX12Tlas&) = delete;
+		CDX12Tlas(const CDX12Tlas&&) = delete;
+		CDX12Tlas& operator=(const CDX12Tlas&) = delete;
+		CDX12Tlas& operator=(const CDX12Tlas&&) = delete;
+
+		explicit CDX12Tlas(CDX12Engine* engine, uint32_t capacity = 64);
+
+		// Adds, removes and moves the instances to match the objects, and grows the buffers if they would not fit
+		// Returns true if the structure moved to a new buffer, so its view has to be written again
+		bool Sync(const std::deque<CGameObject*>& objects);
+
+		// Records the bottom level builds and compactions that are due, then the top level build if anything changed
+		void Update(ID3D12GraphicsCommandList4* commandList);
+
+		ID3D12Resource* Resource() const { return mResult.Get(); }
+
+		const CDX12TlasInstances& Instances() const { return mInstances; }
+
+	private:
+
+		struct SObject
+		{
+			CDX12Mesh* mesh     = nullptr; // The object can load another mesh
+			uint32_t   blas     = CDX12TlasInstances::InvalidBlas;
+			uint32_t   instance = CDX12TlasInstances::InvalidInstance; // Until the bottom level structure is built
+			uint64_t   synced   = 0;
+		};
+
+		// Adds the instances waiting for their bottom level structure, if it is there now
+		void AddBuilt();
+
+		// Grows the buffers if the slots do not fit, returns true if they did not
+		bool Reserve(uint32_t slots);
+
+		CDX12Engine* mEngine;
+		uint32_t     mCapacity;
+
+		CDX12TlasInstances                        mInstances;
+		std::unordered_map<CGameObject*, SObject> mObjects;
+		uint64_t                                  mSyncs = 0;
+
+		uint64_t mBlasFence = 0;     // Of the frame that built the structures waiting for compaction
+		bool     mRebuild   = false; // The buffers moved since the last build
+
+		ComPtr<ID3D12Resource> mResult;
+		ComPtr<ID3D12Resource> mScratch;
+	};
+}
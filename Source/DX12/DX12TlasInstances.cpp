@@ -0,0 +1,148 @@
+#include "DX12TlasInstances.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace DX12
+{
+	namespace
+	{
+		CVector3 Position(const CMatrix4x4& m)
+		{
+			return { m.e30, m.e31, m.e32 };
+		}
+	}
+
+	CDX12TlasInstances::CDX12TlasInstances(uint32_t maxRefits, float maxDistance) :
+		mMaxRefits(maxRefits),
+		mMaxDistance(maxDistance)
+	{
+	}
+
+	uint32_t CDX12TlasInstances::Add(uint32_t blas, const CMatrix4x4& transform, uint32_t hitGroup)
+	{
+		if (blas == InvalidBlas) throw std::logic_error("Top level instance without a bottom level structure");
+
+		uint32_t instance;
+		if (!mFree.empty())
+		{
+			instance = mFree.back();
+			mFree.pop_back();
+		}
+		else
+		{
+			instance = static_cast<uint32_t>(mSlots.size());
+			mSlots.emplace_back();
+			mBuiltPositions.emplace_back();
+		}
+
+		auto& slot = mSlots[instance];
+		slot.blas = blas;
+		slot.transform = transform;
+		slot.hitGroup = hitGroup;
+		slot.dirty = false;
+
+		// An inactive instance cannot become active in a refit
+		mRebuild = true;
+		return instance;
+	}
+
+	void CDX12TlasInstances::Remove(uint32_t instance)
+	{
+		if (!Live(instance)) throw std::logic_error("Removing a top level instance that does not exist");
+
+		auto& slot = mSlots[instance];
+		if (slot.dirty) --mDirty;
+		slot = {};
+
+		mFree.push_back(instance);
+		mRebuild = true;
+	}
+
+	void CDX12TlasInstances::SetTransform(uint32_t instance, const CMatrix4x4& transform)
+	{
+		if (!Live(instance)) throw std::logic_error("Moving a top level instance that does not exist");
+
+		auto& slot = mSlots[instance];
+		if (std::memcmp(&slot.transform, &transform, sizeof(CMatrix4x4)) == 0) return;
+
+		slot.transform = transform;
+		if (!slot.dirty)
+		{
+			slot.dirty = true;
+			++mDirty;
+		}
+
+		if (!mMovedTooFar && Distance(instance) > mMaxDistance) mMovedTooFar = true;
+	}
+
+	ETlasBuild CDX12TlasInstances::NextBuild() const
+	{
+		if (mRebuild || mMovedTooFar) return ETlasBuild::Rebuild;
+		if (mDirty == 0) return ETlasBuild::None;
+
+		return mRefits >= mMaxRefits ? ETlasBuild::Rebuild : ETlasBuild::Refit;
+	}
+
+	void CDX12TlasInstances::Built(ETlasBuild build)
+	{
+		switch (build)
+		{
+		case ETlasBuild::None:
+			++mStats.skipped;
+			return;
+
+		case ETlasBuild::Refit:
+			if (mRebuild) throw std::logic_error("Refitting a top level structure that has to be rebuilt");
+			++mRefits;
+			++mStats.refits;
+			break;
+
+		case ETlasBuild::Rebuild:
+			for (uint32_t i = 0; i < mSlots.size(); ++i) mBuiltPositions[i] = Position(mSlots[i].transform);
+			mRefits = 0;
+			mRebuild = false;
+			mMovedTooFar = false;
+			++mStats.rebuilds;
+			break;
+		}
+
+		for (auto& slot : mSlots) slot.dirty = false;
+		mDirty = 0;
+	}
+
+	STlasStats CDX12TlasInstances::Stats() const
+	{
+		auto stats = mStats;
+		stats.slots = static_cast<uint32_t>(mSlots.size());
+		stats.instances = stats.slots - static_cast<uint32_t>(mFree.size());
+		return stats;
+	}
+
+	void CDX12TlasInstances::Validate() const
+	{
+		if (mBuiltPositions.size() != mSlots.size()) throw std::logic_error("Top level slot without a built position");
+
+		std::vector<bool> free(mSlots.size(), false);
+		for (const auto instance : mFree)
+		{
+			if (instance >= mSlots.size() || free[instance]) throw std::logic_error("Wrong top level free list");
+			if (mSlots[instance].blas != InvalidBlas) throw std::logic_error("Live top level instance in the free list");
+			free[instance] = true;
+		}
+
+		uint32_t dirty = 0;
+		for (uint32_t i = 0; i < mSlots.size(); ++i)
+		{
+			if (!free[i] && mSlots[i].blas == InvalidBlas) throw std::logic_error("Free top level slot missing from the free list");
+			if (mSlots[i].dirty) ++dirty;
+		}
+
+		if (dirty != mDirty) throw std::logic_error("Wrong count of dirty top level instances");
+	}
+
+	float CDX12TlasInstances::Distance(uint32_t instance) const
+	{
+		return Length(Position(mSlots[instance].transform) - mBuiltPositions[instance]);
+	}
+}
@@ -0,0 +1,113 @@
+//--------------------------------------------------------------------------------------
+// Top level acceleration structure instance bookkeeping
+//--------------------------------------------------------------------------------------
+// The instances of the top level structure live in slots, and the slot is the instance ID:
+// it stays the same for the life of the instance, and a removed instance leaves its slot
+// to a free list that the next insertion takes from. Free slots are written as inactive
+// instances, so the number of instances only changes when the slots run out.
+// A transform change only marks its instance dirty. The next build is then chosen from
+// what changed since the last one:
+//  - nothing: no build at all
+//  - only transforms: a refit of the last structure, which is cheap but keeps its tree
+//  - an instance added or removed, a bottom level structure replaced, or the refits
+//    degraded the tree too much: a full rebuild
+// A refit keeps the boxes of the tree built for the old positions, so it degrades with
+// the distance the instances move; the structure is rebuilt after a number of refits or
+// once an instance got too far from where it was at the last rebuild.
+// Nothing here depends on D3D12, CDX12Tlas writes the instances and records the builds.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../Math/CMatrix4x4.h"
+
+namespace DX12
+{
+	enum class ETlasBuild
+	{
+		None,
+		Refit,
+		Rebuild,
+	};
+
+	struct STlasInstance
+	{
+		uint32_t   blas = 0xFFFFFFFF; // Handle of the bottom level structure, InvalidBlas for a free slot
+		CMatrix4x4 transform;
+		uint32_t   hitGroup = 0; // First hit record in the shader binding table
+		bool       dirty = false;
+	};
+
+	struct STlasStats
+	{
+		uint32_t instances = 0;
+		uint32_t slots     = 0;
+		uint32_t rebuilds  = 0;
+		uint32_t refits    = 0;
+		uint32_t skipped   = 0; // Builds with nothing changed
+	};
+
+	class CDX12TlasInstances
+	{
+	public:
+
+		static constexpr uint32_t InvalidInstance = 0xFFFFFFFF;
+		static constexpr uint32_t InvalidBlas = 0xFFFFFFFF;
+
+		CDX12TlasInstances(const CDX12TlasInstances&) = delete;
+		CDX12TlasInstances(const CDX12TlasInstances&&) = delete;
+		CDX12TlasInstances& operator=(const CDX12TlasInstances&) = delete;
+		CDX12TlasInstances& operator=(const CDX12TlasInstances&&) = delete;
+
+		// The structure is rebuilt after maxRefits refits in a row, or once an instance moved
+		// further than maxDistance from its position at the last rebuild
+		explicit CDX12TlasInstances(uint32_t maxRefits = 120, float maxDistance = 10.0f);
+
+		// Returns the ID of the new instance, the slot of the last removed one if any
+		uint32_t Add(uint32_t blas, const CMatrix4x4& transform, uint32_t hitGroup = 0);
+
+		// Will throw a std::logic_error exception if the instance does not exist
+		void Remove(uint32_t instance);
+
+		// Marks the instance dirty if the transform is not the same
+		void SetTransform(uint32_t instance, const CMatrix4x4& transform);
+
+		// The bottom level structures moved (e.g. compacted), the instances have to be written again
+		void Invalidate() { mRebuild = true; }
+
+		// The build that brings the structure up to date
+		ETlasBuild NextBuild() const;
+
+		// The build was recorded, the instances are clean again
+		void Built(ETlasBuild build);
+
+		bool Live(uint32_t instance) const { return instance < mSlots.size() && mSlots[instance].blas != InvalidBlas; }
+
+		const std::vector<STlasInstance>& Slots() const { return mSlots; }
+
+		STlasStats Stats() const;
+
+		// Will throw a std::logic_error exception if the free list and the slots disagree
+		void Validate() const;
+
+	private:
+
+		float Distance(uint32_t instance) const;
+
+		uint32_t mMaxRefits;
+		float    mMaxDistance;
+
+		std::vector<STlasInstance> mSlots;
+		std::vector<CVector3>      mBuiltPositions; // At the last rebuild, by slot
+		std::vector<uint32_t>      mFree;
+
+		uint32_t mDirty   = 0;
+		uint32_t mRefits  = 0; // Since the last rebuild
+		bool     mRebuild = true;
+		bool     mMovedTooFar = false;
+
+		STlasStats mStats;
+	};
+}
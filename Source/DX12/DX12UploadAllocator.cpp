@@ -0,0 +1,99 @@
+#include "DX12UploadAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace DX12
+{
+	CDX12UploadAllocator::CDX12UploadAllocator(IUploadHeap* heap, uint32_t numFrames, size_t pageSize) :
+		mHeap(heap),
+		mPageSize(pageSize)
+	{
+		if (!heap || numFrames == 0 || pageSize == 0) throw std::invalid_argument("Invalid upload allocator settings");
+
+		mFrames.resize(numFrames);
+		for (auto& frame : mFrames) frame.pages.push_back(mHeap->CreatePage(mPageSize));
+	}
+
+	void CDX12UploadAllocator::BeginFrame(uint32_t frameIndex)
+	{
+		std::unique_lock l(mMutex);
+
+		auto& frame = mFrames.at(frameIndex);
+
+		if (frame.open)
+		{
+			if (frameIndex == mCurrentFrame) return;
+
+			// Nothing was submitted with a fence since these allocations, there is nothing to wait for
+			throw std::logic_error("Upload frame reused before EndFrame");
+		}
+
+		if (mHeap->CompletedFenceValue() < frame.fenceValue) mHeap->WaitForFenceValue(frame.fenceValue);
+
+		frame.page = 0;
+		frame.offset = 0;
+		frame.bytes = 0;
+
+		mCurrentFrame = frameIndex;
+	}
+
+	void CDX12UploadAllocator::EndFrame(uint64_t fenceValue)
+	{
+		std::unique_lock l(mMutex);
+
+		// The queue runs in order, so the fence also covers frames left open by earlier work
+		for (auto& frame : mFrames)
+		{
+			if (!frame.open) continue;
+
+			frame.fenceValue = fenceValue;
+			frame.open = false;
+		}
+	}
+
+	SUploadAllocation CDX12UploadAllocator::Allocate(size_t size, size_t alignment)
+	{
+		if (alignment == 0 || (alignment & (alignment - 1))) throw std::logic_error("Upload alignment must be a power of 2");
+
+		std::unique_lock l(mMutex);
+
+		auto& frame = mFrames[mCurrentFrame];
+
+		auto begin = (frame.offset + alignment - 1) & ~(alignment - 1);
+
+		// Move to the next page, creating it the first time the frame needs it
+		while (begin + size > frame.pages[frame.page].size)
+		{
+			++frame.page;
+			if (frame.page == frame.pages.size()) frame.pages.push_back(mHeap->CreatePage(std::max(mPageSize, size)));
+
+			frame.offset = 0;
+			begin = 0;
+		}
+
+		const auto& page = frame.pages[frame.page];
+
+		frame.bytes += begin + size - frame.offset;
+		frame.offset = begin + size;
+		frame.open = true;
+
+		return { page.cpu + begin, page.gpu + begin, size };
+	}
+
+	size_t CDX12UploadAllocator::FrameBytes() const
+	{
+		std::unique_lock l(mMutex);
+		return mFrames[mCurrentFrame].bytes;
+	}
+
+	size_t CDX12UploadAllocator::Capacity() const
+	{
+		std::unique_lock l(mMutex);
+
+		size_t capacity = 0;
+		for (const auto& frame : mFrames)
+			for (const auto& page : frame.pages) capacity += page.size;
+		return capacity;
+	}
+}
@@ -0,0 +1,116 @@
+//--------------------------------------------------------------------------------------
+// Per frame linear allocator for upload memory
+//--------------------------------------------------------------------------------------
+// Constant data that changes every draw (model constants etc.) is written once into
+// persistently mapped upload memory and bound by GPU virtual address, instead of mapping
+// a constant buffer for every copy. Every frame in flight owns its pages and allocations
+// are a bump of an offset. A frame is only rewound once the fence signalled at its end
+// has completed, so the GPU never reads overwritten data.
+// The allocator only knows about memory and fence values through IUploadHeap, so it does
+// not depend on D3D12 and can be driven by a fake heap.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace DX12
+{
+	// Mapped memory the allocator sub-allocates from
+	struct SUploadPage
+	{
+		uint8_t* cpu  = nullptr;
+		uint64_t gpu  = 0;   // D3D12_GPU_VIRTUAL_ADDRESS
+		size_t   size = 0;
+	};
+
+	// Where the pages come from and how the allocator knows the GPU is done with them
+	class IUploadHeap
+	{
+	public:
+		virtual ~IUploadHeap() = default;
+
+		// The page has to stay mapped until the heap is destroyed
+		virtual SUploadPage CreatePage(size_t size) = 0;
+
+		virtual uint64_t CompletedFenceValue() = 0;
+
+		virtual void WaitForFenceValue(uint64_t fenceValue) = 0;
+	};
+
+	struct SUploadAllocation
+	{
+		void*    cpu  = nullptr;
+		uint64_t gpu  = 0;
+		size_t   size = 0;
+	};
+
+	class CDX12UploadAllocator
+	{
+	public:
+
+		// D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT
+		static constexpr size_t ConstantBufferAlignment = 256;
+
+		CDX12UploadAllocator() = delete;
+		CDX12UploadAllocator(const CDX12UploadAllocator&) = delete;
+		CDX12UploadAllocator(const CDX12UploadAllocator&&) = delete;
+		CDX12UploadAllocator& operator=(const CDX12UploadAllocator&) = delete;
+		CDX12UploadAllocator& operator=(const CDX12UploadAllocator&&) = delete;
+
+		// Every frame starts with one page of pageSize bytes and grows by more pages if it runs out
+		CDX12UploadAllocator(IUploadHeap* heap, uint32_t numFrames, size_t pageSize = 1024 * 1024);
+
+		// Start allocating for the given frame, waits for the GPU if it still uses the frame's memory.
+		// Beginning the frame that is already open keeps allocating after what is there
+		void BeginFrame(uint32_t frameIndex);
+
+		// The fence value signalled after all the work using the memory allocated so far.
+		// Allocations made outside of BeginFrame/EndFrame (e.g. while loading) are covered too
+		void EndFrame(uint64_t fenceValue);
+
+		// Will throw a std::logic_error exception if the alignment is not a power of 2
+		SUploadAllocation Allocate(size_t size, size_t alignment = ConstantBufferAlignment);
+
+		// Copy to a new constant buffer sized allocation, returns its GPU virtual address
+		template <typename T>
+		uint64_t Copy(const T& data)
+		{
+			const auto allocation = Allocate(sizeof(T));
+			memcpy(allocation.cpu, &data, sizeof(T));
+			return allocation.gpu;
+		}
+
+		// Bytes allocated in the current frame, including the alignment padding
+		size_t FrameBytes() const;
+
+		// Bytes of all the pages of all the frames
+		size_t Capacity() const;
+
+		uint32_t CurrentFrame() const { return mCurrentFrame; }
+
+	private:
+
+		struct SFrame
+		{
+			std::vector<SUploadPage> pages;
+			size_t                   page   = 0; // Page being allocated from
+			size_t                   offset = 0; // In the current page
+			size_t                   bytes  = 0;
+
+			uint64_t fenceValue = 0;    // Signalled when the GPU is done with the frame
+			bool     open       = false; // Has allocations not covered by a fence yet
+		};
+
+		IUploadHeap* mHeap;
+		size_t       mPageSize;
+
+		std::vector<SFrame> mFrames;
+		uint32_t            mCurrentFrame = 0;
+
+		// Allocations can come from several recording threads
+		mutable std::mutex mMutex;
+	};
+}
@@ -0,0 +1,47 @@
+#include "DX12UploadHeap.h"
+
+#include "DX12Engine.h"
+#include "DX12ResourceAllocator.h"
+
+namespace DX12
+{
+	CDX12UploadHeap::CDX12UploadHeap(CDX12Engine* engine) :
+		mEngine(engine)
+	{
+	}
+
+	CDX12UploadHeap::~CDX12UploadHeap()
+	{
+		for (const auto& page : mPages) page->Unmap(0, nullptr);
+	}
+
+	SUploadPage CDX12UploadHeap::CreatePage(size_t size)
+	{
+		const auto width = ROUND_UP(size, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+		const auto resource = mEngine->mResourceAllocator->CreateBuffer(D3D12_HEAP_TYPE_UPLOAD, width, D3D12_RESOURCE_STATE_GENERIC_READ);
+
+		SetNameIndexed(resource.Get(), L"UploadPage", static_cast<UINT>(mPages.size()));
+
+		// Write only from the CPU, kept mapped for the lifetime of the heap
+		SUploadPage page;
+		const CD3DX12_RANGE readRange(0, 0);
+		ThrowIfFailed(resource->Map(0, &readRange, reinterpret_cast<void**>(&page.cpu)));
+
+		page.gpu = resource->GetGPUVirtualAddress();
+		page.size = width;
+
+		mPages.push_back(resource);
+
+		return page;
+	}
+
+	uint64_t CDX12UploadHeap::CompletedFenceValue()
+	{
+		return mEngine->mFence->GetCompletedValue();
+	}
+
+	void CDX12UploadHeap::WaitForFenceValue(uint64_t fenceValue)
+	{
+		mEngine->WaitForFenceValue(mEngine->mFence, fenceValue, mEngine->mFenceEvent);
+	}
+}
@@ -0,0 +1,43 @@
+//--------------------------------------------------------------------------------------
+// Upload heap buffers for the upload allocator
+//--------------------------------------------------------------------------------------
+// Every page is a committed buffer on the upload heap, mapped once when it is created and
+// unmapped when the heap is destroyed. Fence values are the ones of the engine frame fence.
+
+#pragma once
+
+#include "DX12Common.h"
+#include "DX12UploadAllocator.h"
+
+namespace DX12
+{
+	class CDX12Engine;
+
+	class CDX12UploadHeap final : public IUploadHeap
+	{
+	public:
+
+		CDX12UploadHeap() = delete;
+		CDX12UploadHeap(const CDX12UploadHeap&) = delete;
+		CDX12UploadHeap(const CDX12UploadHeap&&) = delete;
+		CDX12UploadHeap& operator=(const CDX12UploadHeap&) = delete;
+		CDX12UploadHeap& operator=(const CDX12UploadHeap&&) = delete;
+
+		explicit CDX12UploadHeap(CDX12Engine* engine);
+
+		~CDX12UploadHeap() override;
+
+		// Will throw a std::runtime_error exception on failure
+		SUploadPage CreatePage(size_t size) override;
+
+		uint64_t CompletedFenceValue() override;
+
+		void WaitForFenceValue(uint64_t fenceValue) override;
+
+	private:
+
+		CDX12Engine* mEngine;
+
+		std::vector<ComPtr<ID3D12Resource>> mPages;
+	};
+}
@@ -0,0 +1,328 @@
+#include "DX12UploadQueue.h"
+
+#include <cstring>
+
+#include "DX12Engine.h"
+#include "DX12ResourceAllocator.h"
+
+namespace DX12
+{
+	CDX12UploadQueue::CDX12UploadQueue(CDX12Engine* engine, size_t ringSize) :
+		mEngine(engine),
+		mRingSize(ROUND_UP(ringSize, CopyAlignment))
+	{
+		const auto device = mEngine->mDevice.Get();
+
+		D3D12_COMMAND_QUEUE_DESC desc = {};
+		desc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+		desc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
+		desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+		desc.NodeMask = 0;
+
+		if (FAILED(device->CreateCommandQueue(&desc, IID_PPV_ARGS(&mQueue))))
+		{
+			throw std::runtime_error("Error creating the upload copy queue");
+		}
+		NAME_D3D12_OBJECT(mQueue);
+
+		// Created closed, it is reset with a free allocator every time a batch starts
+		ThrowIfFailed(device->CreateCommandList1(0, D3D12_COMMAND_LIST_TYPE_COPY, D3D12_COMMAND_LIST_FLAG_NONE, IID_PPV_ARGS(&mCommandList)));
+		NAME_D3D12_OBJECT(mCommandList);
+
+		ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mFence)));
+		NAME_D3D12_OBJECT(mFence);
+
+		mFenceEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
+		if (!mFenceEvent)
+		{
+			throw std::runtime_error("Error creating the upload fence event");
+		}
+
+		// Staging ring, write only from the CPU and kept mapped for the lifetime of the queue
+		mRing = mEngine->mResourceAllocator->CreateBuffer(D3D12_HEAP_TYPE_UPLOAD, mRingSize, D3D12_RESOURCE_STATE_GENERIC_READ);
+		NAME_D3D12_OBJECT(mRing);
+
+		const CD3DX12_RANGE readRange(0, 0);
+		ThrowIfFailed(mRing->Map(0, &readRange, reinterpret_cast<void**>(&mRingData)));
+	}
+
+	CDX12UploadQueue::~CDX12UploadQueue()
+	{
+		// The callbacks of the last batches are not run, whatever they refer to may already be gone
+		{
+			std::unique_lock l(mMutex);
+			WaitForFenceValue(SubmitLocked());
+		}
+
+		mRing->Unmap(0, nullptr);
+		::CloseHandle(mFenceEvent);
+	}
+
+	ComPtr<ID3D12Resource> CDX12UploadQueue::CreateBuffer(const void* data, size_t size, const wchar_t* name, std::function<void()> onComplete)
+	{
+		const auto resource = mEngine->mResourceAllocator->CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, size, D3D12_RESOURCE_STATE_COMMON);
+
+		if (name) SetName(resource.Get(), name);
+
+		Copy(resource.Get(), 0, data, size, std::move(onComplete));
+
+		return resource;
+	}
+
+	void CDX12UploadQueue::Copy(ID3D12Resource* destination, size_t destinationOffset, const void* data, size_t size, std::function<void()> onComplete)
+	{
+		std::vector<std::function<void()>> completed;
+		{
+			std::unique_lock l(mMutex);
+
+			const auto staging = StageLocked(size, CopyAlignment, completed);
+
+			std::memcpy(staging.data, data, size);
+			mCommandList->CopyBufferRegion(destination, destinationOffset, staging.buffer, staging.offset, size);
+
+			mPending.resources.emplace_back(destination);
+			if (onComplete) mPending.callbacks.push_back(std::move(onComplete));
+			++mPending.copies;
+			mPending.waited = true;
+		}
+
+		for (const auto& callback : completed) callback();
+	}
+
+	ComPtr<ID3D12Resource> CDX12UploadQueue::CreateTexture(const D3D12_RESOURCE_DESC& desc, const D3D12_SUBRESOURCE_DATA* subresources, UINT count,
+	                                                       const wchar_t* name, std::function<void()> onComplete)
+	{
+		const auto resource = mEngine->mResourceAllocator->CreateResource(D3D12_HEAP_TYPE_DEFAULT, desc, D3D12_RESOURCE_STATE_COMMON);
+
+		if (name) SetName(resource.Get(), name);
+
+		// The layout of every subresource in the staging memory, rows padded to the pitch alignment
+		std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> footprints(count);
+		std::vector<UINT>                               rows(count);
+		std::vector<UINT64>                             rowSizes(count);
+		UINT64                                          size = 0;
+		mEngine->mDevice->GetCopyableFootprints(&desc, 0, count, 0, footprints.data(), rows.data(), rowSizes.data(), &size);
+
+		std::vector<std::function<void()>> completed;
+		{
+			std::unique_lock l(mMutex);
+
+			const auto staging = StageLocked(static_cast<size_t>(size), TextureAlignment, completed);
+
+			for (UINT i = 0; i < count; ++i)
+			{
+				auto footprint = footprints[i];
+
+				const D3D12_MEMCPY_DEST destination =
+				{
+					staging.data + footprint.Offset,
+					footprint.Footprint.RowPitch,
+					static_cast<SIZE_T>(footprint.Footprint.RowPitch) * rows[i]
+				};
+				MemcpySubresource(&destination, &subresources[i], static_cast<SIZE_T>(rowSizes[i]), rows[i], footprint.Footprint.Depth);
+
+				footprint.Offset += staging.offset;
+				const CD3DX12_TEXTURE_COPY_LOCATION dst(resource.Get(), i);
+				const CD3DX12_TEXTURE_COPY_LOCATION src(staging.buffer, footprint);
+				mCommandList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+			}
+
+			mPending.resources.push_back(resource);
+			mPending.copies += count;
+
+			// Whoever gets told about the completion shows something else meanwhile
+			if (onComplete) mPending.callbacks.push_back(std::move(onComplete));
+			else mPending.waited = true;
+		}
+
+		for (const auto& callback : completed) callback();
+
+		return resource;
+	}
+
+	uint64_t CDX12UploadQueue::Submit()
+	{
+		std::unique_lock l(mMutex);
+		return SubmitLocked();
+	}
+
+	void CDX12UploadQueue::WaitOnQueue(ID3D12CommandQueue* queue)
+	{
+		std::unique_lock l(mMutex);
+
+		// Nothing to wait for if the copies are already done, the common case once loading is over
+		SubmitLocked();
+		if (!IsComplete(mWaitValue))
+		{
+			ThrowIfFailed(queue->Wait(mFence.Get(), mWaitValue));
+		}
+	}
+
+	void CDX12UploadQueue::Flush()
+	{
+		std::vector<std::function<void()>> completed;
+		{
+			std::unique_lock l(mMutex);
+			WaitForFenceValue(SubmitLocked());
+			RetireLocked(completed);
+		}
+
+		for (const auto& callback : completed) callback();
+	}
+
+	void CDX12UploadQueue::ProcessCompletions()
+	{
+		std::vector<std::function<void()>> completed;
+		{
+			std::unique_lock l(mMutex);
+			RetireLocked(completed);
+		}
+
+		for (const auto& callback : completed) callback();
+	}
+
+	size_t CDX12UploadQueue::RingBytesInUse() const
+	{
+		std::unique_lock l(mMutex);
+		return mRingUsed;
+	}
+
+	size_t CDX12UploadQueue::PendingCopies() const
+	{
+		std::unique_lock l(mMutex);
+
+		auto copies = mPending.copies;
+		for (const auto& batch : mInFlight) copies += batch.copies;
+		return copies;
+	}
+
+	void CDX12UploadQueue::BeginBatch()
+	{
+		if (mBatchOpen) return;
+
+		if (mFreeAllocators.empty())
+		{
+			ComPtr<ID3D12CommandAllocator> allocator;
+			ThrowIfFailed(mEngine->mDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&allocator)));
+			mPending.allocator = allocator;
+		}
+		else
+		{
+			mPending.allocator = std::move(mFreeAllocators.back());
+			mFreeAllocators.pop_back();
+		}
+
+		ThrowIfFailed(mCommandList->Reset(mPending.allocator.Get(), nullptr));
+		mBatchOpen = true;
+	}
+
+	bool CDX12UploadQueue::AllocateStaging(size_t size, size_t alignment, size_t& offset)
+	{
+		// An empty ring starts over from the beginning to get the most contiguous space
+		if (mRingUsed == 0) mRingHead = 0;
+
+		// Bytes skipped for the alignment, or at the end of the ring when wrapping, count as used by the batch
+		auto begin = ROUND_UP(mRingHead, alignment);
+		size_t consumed;
+		if (begin + size <= mRingSize)
+		{
+			consumed = begin + size - mRingHead;
+		}
+		else
+		{
+			begin = 0;
+			consumed = mRingSize - mRingHead + size;
+		}
+
+		if (consumed > mRingSize - mRingUsed) return false;
+
+		offset = begin;
+		mRingHead = (begin + size) % mRingSize;
+		mRingUsed += consumed;
+		mPending.ringBytes += consumed;
+		return true;
+	}
+
+	CDX12UploadQueue::SStaging CDX12UploadQueue::StageLocked(size_t size, size_t alignment, std::vector<std::function<void()>>& callbacks)
+	{
+		BeginBatch();
+
+		SStaging staging;
+
+		if (size > mRingSize)
+		{
+			// Too big for the ring, staged in a buffer of its own released with the batch
+			const auto buffer = mEngine->mResourceAllocator->CreateBuffer(D3D12_HEAP_TYPE_UPLOAD, size, D3D12_RESOURCE_STATE_GENERIC_READ);
+			SetName(buffer.Get(), L"UploadStaging");
+
+			// Upload memory is only written by the CPU, it can stay mapped until the buffer is released
+			void*               data;
+			const CD3DX12_RANGE readRange(0, 0);
+			ThrowIfFailed(buffer->Map(0, &readRange, &data));
+
+			staging.buffer = buffer.Get();
+			staging.data = static_cast<uint8_t*>(data);
+			mPending.resources.push_back(buffer);
+			return staging;
+		}
+
+		while (!AllocateStaging(size, alignment, staging.offset))
+		{
+			// The ring is full, send what is pending and wait for the oldest batch to give its memory back
+			SubmitLocked();
+			WaitForFenceValue(mInFlight.front().fenceValue);
+			RetireLocked(callbacks);
+			BeginBatch();
+		}
+
+		staging.buffer = mRing.Get();
+		staging.data = mRingData + staging.offset;
+		return staging;
+	}
+
+	uint64_t CDX12UploadQueue::SubmitLocked()
+	{
+		if (!mBatchOpen) return mFenceValue;
+
+		ThrowIfFailed(mCommandList->Close());
+
+		ID3D12CommandList* const commandLists[] = { mCommandList.Get() };
+		mQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
+		ThrowIfFailed(mQueue->Signal(mFence.Get(), ++mFenceValue));
+
+		mPending.fenceValue = mFenceValue;
+		if (mPending.waited) mWaitValue = mFenceValue;
+		mInFlight.push_back(std::move(mPending));
+		mPending = {};
+		mBatchOpen = false;
+
+		return mFenceValue;
+	}
+
+	void CDX12UploadQueue::RetireLocked(std::vector<std::function<void()>>& callbacks)
+	{
+		const auto completedValue = mFence->GetCompletedValue();
+		while (!mInFlight.empty() && mInFlight.front().fenceValue <= completedValue)
+		{
+			auto& batch = mInFlight.front();
+
+			// Batches finish in submission order, so the ring memory is given back from its tail
+			mRingUsed -= batch.ringBytes;
+
+			ThrowIfFailed(batch.allocator->Reset());
+			mFreeAllocators.push_back(std::move(batch.allocator));
+
+			for (auto& callback : batch.callbacks) callbacks.push_back(std::move(callback));
+
+			mInFlight.pop_front();
+		}
+	}
+
+	void CDX12UploadQueue::WaitForFenceValue(uint64_t fenceValue) const
+	{
+		if (mFence->GetCompletedValue() >= fenceValue) return;
+
+		ThrowIfFailed(mFence->SetEventOnCompletion(fenceValue, mFenceEvent));
+		::WaitForSingleObject(mFenceEvent, INFINITE);
+	}
+}
@@ -0,0 +1,151 @@
+//--------------------------------------------------------------------------------------
+// Copy queue upload service
+//--------------------------------------------------------------------------------------
+// Fills default heap buffers and textures from the CPU without stalling the direct queue. The data is
+// written into a persistently mapped staging ring buffer and the copies are recorded into
+// a batch on a dedicated copy queue, submitted all at once when Submit is called (or when
+// the ring runs out of space). Every batch is tracked by the value of the copy fence it
+// signals: the staging memory, the destination resources and the command allocator of a
+// batch are only released once the copy queue has gone past it, and the completion
+// callbacks of the batch run from ProcessCompletions at that point.
+// Queues reading the uploaded buffers have to wait for the copies on the GPU first, see
+// WaitOnQueue. Buffers are created in the common state: they are promoted to whatever read
+// state they are used with and decay back at the end of every ExecuteCommandLists, so no
+// barrier is needed on either queue. Textures are created in the common state as well and
+// are only read as shader resources, which they can be promoted to.
+// A texture with a completion callback is not waited for by WaitOnQueue: its owner shows a
+// placeholder until the callback tells it the copy is done, so the textures of a whole scene
+// go through the ring in a few batches while the frames keep going.
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <mutex>
+
+#include "DX12Common.h"
+
+namespace DX12
+{
+	class CDX12Engine;
+
+	class CDX12UploadQueue
+	{
+	public:
+
+		static constexpr size_t DefaultRingSize  = 32 * 1024 * 1024;
+		static constexpr size_t CopyAlignment    = 16;
+		static constexpr size_t TextureAlignment = D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT;
+
+		CDX12UploadQueue() = delete;
+		CDX12UploadQueue(const CDX12UploadQueue&) = delete;
+		CDX12UploadQueue(const CDX12UploadQueue&&) = delete;
+		CDX12UploadQueue& operator=(const CDX12UploadQueue&) = delete;
+		CDX12UploadQueue& operator=(const CDX12UploadQueue&&) = delete;
+
+		// Will throw a std::runtime_error exception on failure
+		explicit CDX12UploadQueue(CDX12Engine* engine, size_t ringSize = DefaultRingSize);
+
+		// Waits for every submitted copy
+		~CDX12UploadQueue();
+
+		// Create a buffer on the default heap and queue the copy of its content
+		// The buffer can be used by any queue that has waited for the copies (WaitOnQueue)
+		ComPtr<ID3D12Resource> CreateBuffer(const void* data, size_t size, const wchar_t* name = nullptr,
+		                                    std::function<void()> onComplete = nullptr);
+
+		// Queue a copy into an existing buffer, the destination must be in the common state and not in use on the GPU
+		void Copy(ID3D12Resource* destination, size_t destinationOffset, const void* data, size_t size,
+		          std::function<void()> onComplete = nullptr);
+
+		// Create a texture on the default heap and queue the copies of its subresources, all staged together
+		// Without a completion callback the frames wait for the copies like for a buffer (WaitOnQueue)
+		ComPtr<ID3D12Resource> CreateTexture(const D3D12_RESOURCE_DESC& desc, const D3D12_SUBRESOURCE_DATA* subresources, UINT count,
+		                                     const wchar_t* name = nullptr, std::function<void()> onComplete = nullptr);
+
+		// Submit the pending copies, returns the fence value that signals their completion (0 if nothing was ever submitted)
+		uint64_t Submit();
+
+		// Submit the pending copies and make a queue wait on the GPU for the ones it needs (all but the textures
+		// with a completion callback) before any work submitted to it afterwards
+		void WaitOnQueue(ID3D12CommandQueue* queue);
+
+		// Submit the pending copies and wait for them on the CPU
+		void Flush();
+
+		// Release the batches the copy queue is done with and run their callbacks
+		void ProcessCompletions();
+
+		bool IsComplete(uint64_t fenceValue) const { return mFence->GetCompletedValue() >= fenceValue; }
+
+		//--------------------------
+		// Stats
+		//--------------------------
+
+		size_t RingSize() const { return mRingSize; }
+		size_t RingBytesInUse() const;
+
+		size_t PendingCopies() const;
+
+	private:
+
+		// Copies recorded into one command list and submitted together
+		struct SBatch
+		{
+			uint64_t                            fenceValue = 0;
+			size_t                              ringBytes  = 0; // Staging ring bytes used, including the padding
+			ComPtr<ID3D12CommandAllocator>      allocator;
+			std::vector<ComPtr<ID3D12Resource>> resources;      // Destinations and oversized staging buffers, kept alive until the copy is done
+			std::vector<std::function<void()>>  callbacks;
+			size_t                              copies = 0;
+			bool                                waited = false; // Has copies WaitOnQueue has to wait for
+		};
+
+		// Where the data of a copy is written
+		struct SStaging
+		{
+			ID3D12Resource* buffer = nullptr;
+			size_t          offset = 0;
+			uint8_t*        data   = nullptr;
+		};
+
+		// Start the pending batch if there is none, the mutex has to be locked
+		void BeginBatch();
+
+		// Reserve staging memory in the ring for the pending batch, returns false if the ring is full
+		bool AllocateStaging(size_t size, size_t alignment, size_t& offset);
+
+		// Staging memory for a copy of the pending batch, from the ring or, if too big for it, a buffer of its own
+		// Waits for the oldest batches if the ring is full, their callbacks are moved out to be run without the lock
+		SStaging StageLocked(size_t size, size_t alignment, std::vector<std::function<void()>>& callbacks);
+
+		uint64_t SubmitLocked();
+
+		// Release the completed batches, their callbacks are moved out to be run without the lock
+		void RetireLocked(std::vector<std::function<void()>>& callbacks);
+
+		void WaitForFenceValue(uint64_t fenceValue) const;
+
+		CDX12Engine* mEngine;
+
+		ComPtr<ID3D12CommandQueue>         mQueue;
+		ComPtr<ID3D12GraphicsCommandList>  mCommandList;
+		ComPtr<ID3D12Fence>                mFence;
+		HANDLE                             mFenceEvent = nullptr;
+		uint64_t                           mFenceValue = 0; // Last value signalled
+		uint64_t                           mWaitValue  = 0; // Of the last batch with copies WaitOnQueue has to wait for
+
+		ComPtr<ID3D12Resource> mRing;
+		uint8_t*               mRingData = nullptr;
+		size_t                 mRingSize = 0;
+		size_t                 mRingHead = 0; // Next free byte
+		size_t                 mRingUsed = 0; // Bytes of the submitted and pending batches, freed in submission order
+
+		bool                                      mBatchOpen = false;
+		SBatch                                    mPending;
+		std::deque<SBatch>                        mInFlight;
+		std::vector<ComPtr<ID3D12CommandAllocator>> mFreeAllocators;
+
+		mutable std::mutex mMutex;
+	};
+}
@@ -6,6 +6,7 @@
 
 #include "../DX12Common.h"
 #include "../DX12Engine.h"
+#include "../DX12ResourceAllocator.h"
 
 namespace DX12
 {
@@ -38,6 +39,14 @@ namespace DX12
 			return pBuffer;
 		}
 
+		// Same buffer placed in the engine's resource heaps
+		inline ComPtr<ID3D12Resource> CreateBuffer(CDX12Engine* engine, uint64_t size,
+			D3D12_RESOURCE_FLAGS flags, D3D12_RESOURCE_STATES initState,
+			const D3D12_HEAP_PROPERTIES& heapProps)
+		{
+			return engine->mResourceAllocator->CreateBuffer(heapProps.Type, size, initState, flags);
+		}
+
 
 		// Specifies a heap used for uploading. This heap type has CPU access optimized
 		// for uploading to the GPU.
@@ -61,24 +70,8 @@ namespace DX12
 
 	ComPtr<ID3D12RootSignature> CreateShadowSignature(ID3D12Device* device);
 
-	/// Create the acceleration structure of an instance
-	///
-	/// \param vVertexBuffers : pair of buffer and vertex count
-	///	\param vIndexBuffers : pair of buffer and index count
-	/// \return AccelerationStructureBuffers for TLAS
-	AccelerationStructureBuffers CreateBottomLevelAS(
-		CDX12Engine * engine,
-		std::vector<std::pair<ComPtr<ID3D12Resource>, uint32_t>> vVertexBuffers,
-		uint32_t vertexSize,
-		std::vector<std::pair<ComPtr<ID3D12Resource>, uint32_t>> vIndexBuffers
-		);
-
-	/// Create the main acceleration structure that holds
-	/// all instances of the scene
-	/// \param instances : pair of BLAS and transform
-	void CreateTopLevelAS(std::vector<std::pair<ComPtr<ID3D12Resource>, CMatrix4x4*>>& instances, CDX12Engine* engine, bool updateOnly = false);
-
-	/// Create all acceleration structures, bottom and top
+	/// Create all acceleration structures, bottom (compacted, one per mesh file) and top
+	/// (one instance per object, kept up to date by RaytracingFrame)
 	void CreateAccelerationStructures(CDX12Engine* engine);
 	
 }
@@ -1,8 +1,6 @@
 #include "CDX12Sky.h"
 
 #include "../DX12Engine.h"
-#include "../DX12Scene.h"
-#include "../../Common/Camera.h"
 
 namespace DX12
 {
@@ -11,22 +9,14 @@ namespace DX12
 		//if the model is not enable do not render it
 		if (!mEnabled) return;
 
-		SetPosition(mEngine->GetScene()->GetCamera()->Position());
+		// Follows the camera, moved by the scene before the recording starts
 		mMaterial->RenderMaterial();
 
-		auto& cb = mMesh->ModelConstants();
-		cb.hasAoMap = mMaterial->mAo ? 1 : 0;
-		cb.hasNormalMap = mMaterial->mNormal ? 1 : 0;
-		cb.hasMetallnessMap = mMaterial->mMetalness ? 1 : 0;
-		cb.hasRoughnessMap = mMaterial->mRoughness ? 1 : 0;
-		cb.hasDisplacementMap = mMaterial->mDisplacement ? 1 : 0;
-		cb.roughness = mRoughness;
-		cb.metalness = mMetalness;
-		cb.parallaxDepth = mParallaxDepth;
-		cb.useCustomValues = 0;
+		// The sky pipeline has a table for its texture, it does not read the material table
+		const auto cb = mMesh->ModelConstants();
 
 		// Render the mesh
-		mMesh->Render(mWorldMatrices);
+		mMesh->Render(mWorldMatrices, cb);
 	}
 	
 }
@@ -4,6 +4,7 @@
 #include "../../Utility/HelperFunctions.h"
 
 #include "../DX12Engine.h"
+#include "../DX12InstanceTable.h"
 
 #include "../DX12PipelineObject.h"
 #include "../Source/Utility/Input.h"
@@ -226,26 +227,15 @@ namespace DX12
 		//if the model is not enable do not render it
 		if (!mEnabled) return;
 
-		// Set the pipeline state object
+		// The matrices, maps and parameters are in the instance and material tables, bound once for all the objects
 		if (!basicGeometry)
 		{
-			// Render the material
-			mMaterial->RenderMaterial();
-
-			auto& cb = mMesh->ModelConstants();
-			cb.hasAoMap = mMaterial->mAo ? 1 : 0;
-			cb.hasNormalMap = mMaterial->mNormal ? 1 : 0;
-			cb.hasMetallnessMap = mMaterial->mMetalness ? 1 : 0;
-			cb.hasRoughnessMap = mMaterial->mRoughness ? 1 : 0;
-			cb.hasDisplacementMap = mMaterial->mDisplacement ? 1 : 0;
-			cb.roughness = mRoughness;
-			cb.metalness = mMetalness;
-			cb.parallaxDepth = mParallaxDepth;
-			cb.useCustomValues = 0;
+			mMesh->RenderInstances(mEngine->mInstanceTable->Index(this));
+			return;
 		}
 
 		// Render the mesh
-		mMesh->Render(mWorldMatrices);
+		mMesh->Render(mWorldMatrices, mMesh->ModelConstants());
 	}
 
 	void CDX12GameObject::RenderToAmbientMap()
@@ -11,7 +11,7 @@
 #include "../CDX12Material.h"
 #include "../DX12Mesh.h"
 
-enum KeyCode;
+enum KeyCode : int;
 
 namespace DX12
 {
@@ -79,7 +79,7 @@ namespace DX12
 		std::unique_ptr<CDX12Mesh> mMesh;
 
 		// The material
-		// It will hold all the textures and send them to the shader with RenderMaterial()
+		// It will hold all the textures, the shaders find them through the material table
 		std::unique_ptr<CDX12Material> mMaterial;
 		
 	};
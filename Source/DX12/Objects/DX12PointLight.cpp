@@ -5,6 +5,7 @@
 #include "../DX12DescriptorHeap.h"
 #include "../DX12PipelineObject.h"
 #include "../DX12Texture.h"
+#include "../DX12UploadAllocator.h"
 #include "../../Common/CGameObjectManager.h"
 
 namespace DX12
@@ -66,51 +67,51 @@ namespace DX12
 
 	void* CDX12PointLight::RenderFromThis()
 	{
-
-		// Store original rotation
-		const auto originalOrientation = Rotation();
-
-
 		for (int i = 0; i < 6; ++i)
 		{
-			CVector3 rot = mSides[i];
-
-			CDX12GameObject::SetRotation(rot * PI);
-
 			mShadowMaps[i]->Barrier(D3D12_RESOURCE_STATE_DEPTH_WRITE);
+			RenderFace(i);
+			mShadowMaps[i]->Barrier(D3D12_RESOURCE_STATE_GENERIC_READ);
+		}
+
+		return (void*)mShadowMaps[0]->mSrvHeap->Get(mShadowMaps[0]->mSrvHandle).mGpu.ptr;
+	}
 
-			auto dsv = mShadowMaps[i]->mDsvHeap->Get(mShadowMaps[i]->mDsvHandle).mCpu;
+	void CDX12PointLight::RenderFace(int face)
+	{
+		auto commandList = mEngine->mCurrRecordingCommandList;
 
-			mEngine->SetDepthOnlyPSO();
-			mEngine->mSRVDescriptorHeap->Set();
+		// The light is not rotated to look down the face, the other faces may be recorded at the same time
+		const auto rotation = CVector3(mSides[face]) * PI;
+		const auto faceMatrix =
+			MatrixScaling(Scale()) *
+			MatrixRotationZ(rotation.z) * MatrixRotationX(rotation.x) * MatrixRotationY(rotation.y) *
+			MatrixTranslation(Position());
 
-			mEngine->mCurrRecordingCommandList->RSSetViewports(1, &mVp);
-			mEngine->mCurrRecordingCommandList->RSSetScissorRects(1, &mScissorsRect);
-			mEngine->mCurrRecordingCommandList->OMSetRenderTargets(0, nullptr, false, &dsv);
-			mEngine->mCurrRecordingCommandList->ClearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH, 1.f, 0, 0, nullptr);
+		auto dsv = mShadowMaps[face]->mDsvHeap->Get(mShadowMaps[face]->mDsvHandle).mCpu;
 
-			auto j = mEngine->mCurrentBackBufferIndex;
+		mEngine->SetDepthOnlyPSO();
+		mEngine->mSRVDescriptorHeap->Set();
 
-			mEngine->mPerFrameConstants[j].viewMatrix = InverseAffine(WorldMatrix());
-			mEngine->mPerFrameConstants[j].projectionMatrix = MakeProjectionMatrix(1.0f, ToRadians(90));
-			mEngine->mPerFrameConstants[j].viewProjectionMatrix = mEngine->mPerFrameConstants[j].viewMatrix * mEngine->mPerFrameConstants[j].projectionMatrix;
+		commandList->RSSetViewports(1, &mVp);
+		commandList->RSSetScissorRects(1, &mScissorsRect);
+		commandList->OMSetRenderTargets(0, nullptr, false, &dsv);
+		commandList->ClearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH, 1.f, 0, 0, nullptr);
 
-			mEngine->mPerFrameConstantBuffer[j]->Copy(mEngine->mPerFrameConstants);
+		auto perFrameConstants = mEngine->mPerFrameConstants[mEngine->mCurrentBackBufferIndex];
+		perFrameConstants.viewMatrix = InverseAffine(faceMatrix);
+		perFrameConstants.projectionMatrix = MakeProjectionMatrix(1.0f, ToRadians(90));
+		perFrameConstants.viewProjectionMatrix = perFrameConstants.viewMatrix * perFrameConstants.projectionMatrix;
 
-			for (const auto& o : mEngine->GetObjManager()->mObjects)
-			{
-				o->Render(true);
-			}
+		commandList->SetGraphicsRootConstantBufferView(1, mEngine->mUploadAllocator->Copy(perFrameConstants));
 
-			mShadowMaps[i]->Barrier(D3D12_RESOURCE_STATE_GENERIC_READ);
+		for (const auto& o : mEngine->GetObjManager()->mObjects)
+		{
+			o->Render(true);
 		}
 
-		SetRotation(originalOrientation);
-
 		// unbind the shadow map form render target
-		mEngine->mCurrRecordingCommandList->OMSetRenderTargets(0, nullptr, false, nullptr);
-
-		return (void*)mShadowMaps[0]->mSrvHeap->Get(mShadowMaps[0]->mSrvHandle).mGpu.ptr;
+		commandList->OMSetRenderTargets(0, nullptr, false, nullptr);
 	}
 
 
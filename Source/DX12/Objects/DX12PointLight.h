@@ -24,6 +24,10 @@ namespace DX12
 		
 			void  InitTextures();
 			void* RenderFromThis() override;
+
+			// Records one face of the shadow cube into the list of the calling thread, the faces can be recorded in parallel
+			// The shadow map of the face has to be in the depth write state
+			void  RenderFace(int face);
 			void* GetSRV() override;
 			void  SetShadowMapSize(int size) override;
 
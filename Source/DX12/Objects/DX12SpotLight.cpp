@@ -4,6 +4,8 @@
 
 #include "../DX12DescriptorHeap.h"
 #include "../DX12PipelineObject.h"
+#include "../DX12ResourceAllocator.h"
+#include "../DX12UploadAllocator.h"
 #include "../../Common/CGameObjectManager.h"
 
 namespace DX12
@@ -24,14 +26,6 @@ namespace DX12
 		CSpotLight(colour, strength, shadowMapSize, coneAngle)
 	{
 		InitTextures();
-
-		for (auto& commandAllocator : mCommandAllocators)
-		{
-			ThrowIfFailed(mEngine->mDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT,IID_PPV_ARGS(commandAllocator.GetAddressOf())))
-		}
-
-		ThrowIfFailed(mEngine->mDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, mCommandAllocators[0].Get(), nullptr ,IID_PPV_ARGS(mCommandList.GetAddressOf())));
-		mCommandList->Close();
 	}
 
 	void CDX12SpotLight::SetConeAngle(float value) { mConeAngle = value; }
@@ -56,8 +50,6 @@ namespace DX12
 		mDsvHandle = mDSVDescHeap->Add();
 		mSrvHandle = mEngine->mSRVDescriptorHeap->Add();
 
-		auto heap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-
 		// Create the texture resource
 
 		D3D12_RESOURCE_DESC texDesc;
@@ -79,13 +71,8 @@ namespace DX12
 		optClear.DepthStencil.Depth = 1.0f;
 		optClear.DepthStencil.Stencil = 0;
 
-		ThrowIfFailed(mEngine->mDevice->CreateCommittedResource(
-			&heap,
-			D3D12_HEAP_FLAG_NONE,
-			&texDesc,
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			&optClear,
-			IID_PPV_ARGS(mShadowMapResource.GetAddressOf())));
+		mShadowMapResource = mEngine->mResourceAllocator->CreateResource(D3D12_HEAP_TYPE_DEFAULT, texDesc, D3D12_RESOURCE_STATE_GENERIC_READ, &optClear);
+		mShadowMapState = D3D12_RESOURCE_STATE_GENERIC_READ;
 
 
 		// Create SRV to resource so we can sample the shadow map in a shader program.
@@ -98,6 +85,7 @@ namespace DX12
 		srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
 		srvDesc.Texture2D.PlaneSlice = 0;
 		mEngine->mDevice->CreateShaderResourceView(mShadowMapResource.Get(), &srvDesc, mSrvHeap->Get(mSrvHandle).mCpu);
+		mSrvHeap->Commit(mSrvHandle);
 
 
 		// Create DSV to resource so we can render to the shadow map.
@@ -106,21 +94,13 @@ namespace DX12
 		dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
 		dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
 		dsvDesc.Texture2D.MipSlice = 0;
-		mEngine->mDevice->CreateDepthStencilView(mShadowMapResource.Get(), &dsvDesc, mSrvHeap->Get(mDsvHandle).mCpu);
+		mEngine->mDevice->CreateDepthStencilView(mShadowMapResource.Get(), &dsvDesc, mDSVDescHeap->Get(mDsvHandle).mCpu);
 	}
 
 	void* CDX12SpotLight::RenderFromThis()
 	{
-		mEngine->mCurrRecordingCommandList = mCommandList.Get();
 		auto commandList = mEngine->mCurrRecordingCommandList;
 
-		mCommandAllocators[mEngine->mCurrentBackBufferIndex]->Reset();
-		mCommandList->Reset(mCommandAllocators[mEngine->mCurrentBackBufferIndex].Get(), nullptr);
-
-		auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(mShadowMapResource.Get(), D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_DEPTH_WRITE);
-		commandList->ResourceBarrier(1, &barrier);
-
-		mEngine->mCurrSetPso = nullptr;
 		mEngine->SetDepthOnlyPSO();
 		mEngine->mSRVDescriptorHeap->Set();
 
@@ -131,34 +111,19 @@ namespace DX12
 		commandList->ClearDepthStencilView(handle.mCpu, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.f, 0, 0, nullptr);
 		commandList->OMSetRenderTargets(0, nullptr, false, &handle.mCpu);
 
-		auto i = mEngine->mCurrentBackBufferIndex;
+		// The view of this light, in the upload memory so the lights recorded at the same time don't overwrite each other
+		auto perFrameConstants = mEngine->mPerFrameConstants[mEngine->mCurrentBackBufferIndex];
+		perFrameConstants.viewMatrix = InverseAffine(WorldMatrix());
+		perFrameConstants.projectionMatrix = MakeProjectionMatrix(1.0f, ToRadians(mConeAngle));
+		perFrameConstants.viewProjectionMatrix = perFrameConstants.viewMatrix * perFrameConstants.projectionMatrix;
 
-		mEngine->mPerFrameConstants[i].viewMatrix = InverseAffine(WorldMatrix());
-		mEngine->mPerFrameConstants[i].projectionMatrix = MakeProjectionMatrix(1.0f, ToRadians(mConeAngle));
-		mEngine->mPerFrameConstants[i].viewProjectionMatrix = mEngine->mPerFrameConstants[i].viewMatrix * mEngine->mPerFrameConstants[i].projectionMatrix;
-
-		mEngine->mPerFrameConstantBuffer[i]->Copy(mEngine->mPerFrameConstants);
+		commandList->SetGraphicsRootConstantBufferView(1, mEngine->mUploadAllocator->Copy(perFrameConstants));
 
 		for (const auto& o : mEngine->GetObjManager()->mObjects)
 		{
-			mEngine->mPerFrameConstantBuffer[i]->Set(1);
 			o->Render(true);
 		}
 
-		barrier = CD3DX12_RESOURCE_BARRIER::Transition(mShadowMapResource.Get(), D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_GENERIC_READ);
-		commandList->ResourceBarrier(1, &barrier);
-
-		// Execute the commandList
-		ThrowIfFailed(commandList->Close());
-
-		ID3D12CommandList* const commandLists[] = { commandList };
-		mEngine->mCommandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
-
-		mEngine->mCurrSetPso = nullptr;
-		mEngine->mCurrRecordingCommandList = mEngine->GetCommandList();
-
-		mEngine->WaitForGpu();
-
 		//TODO::
 		return (void*)mSrvHeap->Get(mSrvHandle).mGpu.ptr;
 	}
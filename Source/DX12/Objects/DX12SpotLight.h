@@ -26,6 +26,7 @@ namespace DX12
 						   const int&         shadowMapSize = 2048,
 						   const float&       coneAngle     = 90.f);
 			
+			// Records the shadow map into the list of the calling thread, in the depth write state
 			void* RenderFromThis() override;
 			void* GetSRV() override;
 			void SetConeAngle(float value) override;
@@ -33,20 +34,17 @@ namespace DX12
 
 			uint32_t mSrvHandle;
 
+			ComPtr<ID3D12Resource> mShadowMapResource;
+			D3D12_RESOURCE_STATES  mShadowMapState = D3D12_RESOURCE_STATE_GENERIC_READ;
+
 	private:
 			void InitTextures();
 
 			std::unique_ptr<CDX12DescriptorHeap> mDSVDescHeap;
 			CDX12DescriptorHeap* mSrvHeap;
 
-			ComPtr<ID3D12Resource> mShadowMapResource;
-
 			uint32_t mDsvHandle;
 
-
-			ComPtr<ID3D12GraphicsCommandList4> mCommandList;
-			ComPtr<ID3D12CommandAllocator> mCommandAllocators[3];
-
 			CD3DX12_VIEWPORT mVp;
 			RECT mScissorsRect;
 
@@ -1,10 +1,10 @@
 #pragma once
 
-#include <wrl.h>
 #include <string>
 #include <memory>
 
 #include "Math/CVector3.h"
+#include "Utility/Platform.h"
 #include "Utility/Timer.h"
 
 // Forward declarations
@@ -20,6 +20,7 @@ class CLight;
 class CGameObject;
 class CScene;
 class CWindow;
+struct SMeshImportSettings;
 
 class IEngine
 {
@@ -106,6 +107,9 @@ public:
 		CVector3           rotation = { 0,0,0 },
 		float              scale = 1) = 0;
 
+	// How this backend wants assimp to import meshes, used to decode them ahead of time
+	virtual SMeshImportSettings MeshImportSettings() const = 0;
+
 	//*******************************
 	//**** Setters / Getters
 
@@ -1,17 +1,50 @@
 #pragma once
 
+#include <stdexcept>
+
 #include "Engine.h"
+#ifdef _WIN32
 #include "DX11/DX11Engine.h"
 #include "DX12/DX12Engine.h"
+#endif
+#include "Null/NullEngine.h"
+#include "Software/SoftEngine.h"
 
 // Factory function that creates the correct engine
 
 enum EApiType
 {
 	EDX11,
-	EDX12
+	EDX12,
+	ENull,    // No window or device, for headless runs
+	ESoftware // No window or device, rendered on the CPU
 };
 
+// The backends without a window, the only ones built on platforms other than Windows
+// Will throw a std::logic_error exception for the backends that need a window
+inline std::unique_ptr<IEngine> NewEngine(EApiType type, const std::string& mediaFolder)
+{
+	switch (type)
+	{
+	case ENull:
+		return std::make_unique<Null::CNullEngine>(mediaFolder);
+	case ESoftware:
+		return std::make_unique<Software::CSoftEngine>(mediaFolder);
+	default:
+		throw std::logic_error("This backend needs a window");
+	}
+}
+
+#ifdef _WIN32
+// Same media folder as the windowed backends, next to the executable
+inline std::string ExeMediaFolder(HINSTANCE hInstance)
+{
+	CHAR path[MAX_PATH];
+	GetModuleFileNameA(hInstance, path, MAX_PATH);
+	const auto exePath = std::string(path);
+	return exePath.substr(0, exePath.find_last_of("\\/")) + "/Media/";
+}
+
 inline std::unique_ptr<IEngine> NewEngine(EApiType type, HINSTANCE hInstance, int nCmdShow)
 {
 	try
@@ -22,6 +55,9 @@ inline std::unique_ptr<IEngine> NewEngine(EApiType type, HINSTANCE hInstance, in
 			return std::make_unique<DX11::CDX11Engine>(hInstance, nCmdShow);
 		case EDX12:
 			return std::make_unique<DX12::CDX12Engine>(hInstance, nCmdShow);
+		case ENull:
+		case ESoftware:
+			return NewEngine(type, ExeMediaFolder(hInstance));
 		default:
 			return nullptr;
 		}
@@ -30,4 +66,5 @@ inline std::unique_ptr<IEngine> NewEngine(EApiType type, HINSTANCE hInstance, in
 	{
 		throw std::runtime_error(e.what());
 	}
-}
\ No newline at end of file
+}
+#endif
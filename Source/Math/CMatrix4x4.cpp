@@ -259,9 +259,10 @@ CMatrix4x4 Inverse(const CMatrix4x4& m)
 {
 	DirectX::XMMATRIX dxm(&m.e00);
 	DirectX::XMVECTOR det;
-	auto im = XMMatrixInverse(&det, dxm);
+	DirectX::XMFLOAT4X4 im;
+	XMStoreFloat4x4(&im, XMMatrixInverse(&det, dxm));
 	CMatrix4x4 out;
-	out.SetValues(&im.r->m128_f32[0]);
+	out.SetValues(&im.m[0][0]);
 	return out;
 }
 
@@ -9,7 +9,7 @@
 
 
 // Surprisingly, pi is not *officially* defined anywhere in C++
-const float PI = 3.14159265359f;
+constexpr float PI = 3.14159265359f;
 
 // Test if a float value is approximately 0
 // Epsilon value is the range around zero that is considered equal to zero
@@ -0,0 +1,183 @@
+#include "NullEngine.h"
+
+#include <algorithm>
+
+#include "NullMesh.h"
+#include "NullScene.h"
+#include "Objects/NullGameObject.h"
+#include "Objects/NullLights.h"
+#include "../Common/AssetCache.h"
+#include "../Common/CGameObjectManager.h"
+#include "../Common/CGui.h"
+#include "../Window.h"
+
+namespace Null
+{
+	CNullEngine::CNullEngine(std::string mediaFolder, UINT width, UINT height) :
+		mWidth(width),
+		mHeight(height)
+	{
+		mMediaFolder = std::move(mediaFolder);
+		std::replace(mMediaFolder.begin(), mMediaFolder.end(), '\\', '/');
+
+		if (!mMediaFolder.empty() && mMediaFolder.back() != '/') mMediaFolder.push_back('/');
+
+		mObjManager = std::make_unique<CGameObjectManager>(this);
+
+		mTimer.Start();
+	}
+
+	CNullEngine::~CNullEngine()
+	{
+		mScene = nullptr;
+	}
+
+	bool CNullEngine::Update()
+	{
+		if (!mScene) return false;
+
+		auto frameTime = mFixedFrameTime > 0 ? mFixedFrameTime : mTimer.GetLapTime();
+
+		mDrawCommands.clear();
+
+		mScene->RenderScene(frameTime);
+
+		mScene->UpdateScene(frameTime);
+
+		FinalizeFrame();
+
+		return true;
+	}
+
+	void CNullEngine::Resize(UINT x, UINT y)
+	{
+		mWidth = x;
+		mHeight = y;
+
+		if (mScene) mScene->Resize(x, y);
+	}
+
+	void CNullEngine::FinalizeFrame()
+	{
+		++mFrameCount;
+	}
+
+	void CNullEngine::CreateScene(std::string fileName)
+	{
+		mScene = std::make_unique<CNullScene>(this, fileName);
+		mScene->Resize(mWidth, mHeight);
+	}
+
+	CGameObject* CNullEngine::CreateObject(const std::string& mesh,
+	                                       const std::string& name,
+	                                       const std::string& diffuseMap,
+	                                       CVector3           position,
+	                                       CVector3           rotation,
+	                                       float              scale)
+	{
+		auto obj = new CNullGameObject(this, mesh, name, diffuseMap, position, rotation, scale);
+		mObjManager->AddObject(obj);
+		return obj;
+	}
+
+	CSky* CNullEngine::CreateSky(const std::string& mesh,
+	                             const std::string& name,
+	                             const std::string& diffuseMap,
+	                             CVector3           position,
+	                             CVector3           rotation,
+	                             float              scale)
+	{
+		auto s = new CNullSky(this, mesh, name, diffuseMap, position, rotation, scale);
+		mObjManager->AddSky(s);
+		return s;
+	}
+
+	CPlant* CNullEngine::CreatePlant(const std::string& id,
+	                                 const std::string& name,
+	                                 CVector3           position,
+	                                 CVector3           rotation,
+	                                 float              scale)
+	{
+		auto p = new CNullPlant(this, id, name, position, rotation, scale);
+		mObjManager->AddPlant(p);
+		return p;
+	}
+
+	CGameObject* CNullEngine::CreateObject(const std::string& dirPath,
+	                                       const std::string& name,
+	                                       CVector3           position,
+	                                       CVector3           rotation,
+	                                       float              scale)
+	{
+		auto o = new CNullGameObject(this, dirPath, name, position, rotation, scale);
+		mObjManager->AddObject(o);
+		return o;
+	}
+
+	CLight* CNullEngine::CreateLight(const std::string& mesh,
+	                                 const std::string& name,
+	                                 const std::string& diffuseMap,
+	                                 const CVector3&    colour,
+	                                 const float&       strength,
+	                                 CVector3           position,
+	                                 CVector3           rotation,
+	                                 float              scale)
+	{
+		auto l = new CNullLight(this, mesh, name, diffuseMap, colour, strength, position, rotation, scale);
+		mObjManager->AddLight(l);
+		return l;
+	}
+
+	CSpotLight* CNullEngine::CreateSpotLight(const std::string& mesh,
+	                                         const std::string& name,
+	                                         const std::string& diffuseMap,
+	                                         const CVector3&    colour,
+	                                         const float&       strength,
+	                                         CVector3           position,
+	                                         CVector3           rotation,
+	                                         float              scale)
+	{
+		auto s = new CNullSpotLight(this, mesh, name, diffuseMap, colour, strength, position, rotation, scale);
+		mObjManager->AddSpotLight(s);
+		return s;
+	}
+
+	CDirectionalLight* CNullEngine::CreateDirectionalLight(const std::string& mesh,
+	                                                       const std::string& name,
+	                                                       const std::string& diffuseMap,
+	                                                       const CVector3&    colour,
+	                                                       const float&       strength,
+	                                                       CVector3           position,
+	                                                       CVector3           rotation,
+	                                                       float              scale)
+	{
+		auto d = new CNullDirectionalLight(this, mesh, name, diffuseMap, colour, strength, position, rotation, scale);
+		mObjManager->AddDirLight(d);
+		return d;
+	}
+
+	CPointLight* CNullEngine::CreatePointLight(const std::string& mesh,
+	                                           const std::string& name,
+	                                           const std::string& diffuseMap,
+	                                           const CVector3&    colour,
+	                                           const float&       strength,
+	                                           CVector3           position,
+	                                           CVector3           rotation,
+	                                           float              scale)
+	{
+		auto p = new CNullPointLight(this, mesh, name, diffuseMap, colour, strength, position, rotation, scale);
+		mObjManager->AddPointLight(p);
+		return p;
+	}
+
+	SMeshImportSettings CNullEngine::MeshImportSettings() const
+	{
+		return CNullMesh::ImportSettings();
+	}
+
+	void CNullEngine::RecordDraw(const SNullDrawCommand& command)
+	{
+		mDrawCommands.push_back(command);
+		mDrawCommands.back().pass = mPass;
+	}
+}
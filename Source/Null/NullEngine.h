@@ -0,0 +1,176 @@
+//--------------------------------------------------------------------------------------
+// Null backend
+//--------------------------------------------------------------------------------------
+// IEngine without a window or a device. Objects are imported and placed like in the other
+// backends but rendering only appends draw commands to an in-memory log, so the CPU side
+// of a frame (scene loading, updates, object management) can be run and measured headless.
+
+#pragma once
+
+#include <vector>
+
+#include "../Engine.h"
+#include "../Math/CMatrix4x4.h"
+
+namespace Null
+{
+	class CNullMesh;
+
+	enum class ENullPass
+	{
+		Depth,
+		Scene
+	};
+
+	// What a backend would have sent to the GPU for one sub-mesh
+	struct SNullDrawCommand
+	{
+		CGameObject*       object = nullptr;
+		const CNullMesh*   mesh = nullptr;
+		ENullPass          pass = ENullPass::Scene;
+		unsigned int       subMesh = 0;
+		unsigned int       numIndices = 0;
+		CMatrix4x4         worldMatrix;
+		bool               basicGeometry = false;
+	};
+
+	class CNullEngine : public IEngine
+	{
+	public:
+
+		CNullEngine() = delete;
+		CNullEngine(const CNullEngine&) = delete;
+		CNullEngine(const CNullEngine&&) = delete;
+		CNullEngine& operator=(const CNullEngine&) = delete;
+		CNullEngine& operator=(const CNullEngine&&) = delete;
+
+		// The media folder is where the scene assets are, with or without the trailing slash
+		CNullEngine(std::string mediaFolder, UINT width = 1920, UINT height = 1080);
+
+		~CNullEngine() override;
+
+		// Runs a single frame and returns, unlike the other backends that loop until the window closes
+		bool Update() override;
+
+		void Resize(UINT x, UINT y) override;
+
+		void FinalizeFrame() override;
+
+		void CreateScene(std::string fileName = "") override;
+
+		CGameObject* CreateObject(
+			const std::string& mesh,
+			const std::string& name,
+			const std::string& diffuseMap,
+			CVector3           position = { 0,0,0 },
+			CVector3           rotation = { 0,0,0 },
+			float              scale    = 1) override;
+
+		CSky* CreateSky(
+			const std::string& mesh,
+			const std::string& name,
+			const std::string& diffuseMap,
+			CVector3           position = { 0,0,0 },
+			CVector3           rotation = { 0,0,0 },
+			float              scale    = 1) override;
+
+		CPlant* CreatePlant(
+			const std::string& id,
+			const std::string& name,
+			CVector3           position = { 0,0,0 },
+			CVector3           rotation = { 0,0,0 },
+			float              scale    = 1) override;
+
+		CGameObject* CreateObject(
+			const std::string& dirPath,
+			const std::string& name,
+			CVector3           position = { 0,0,0 },
+			CVector3           rotation = { 0,0,0 },
+			float              scale    = 1) override;
+
+		CLight* CreateLight(
+			const std::string& mesh,
+			const std::string& name,
+			const std::string& diffuseMap,
+			const CVector3&    colour,
+			const float&       strength,
+			CVector3           position = { 0,0,0 },
+			CVector3           rotation = { 0,0,0 },
+			float              scale    = 1) override;
+
+		CSpotLight* CreateSpotLight(
+			const std::string& mesh,
+			const std::string& name,
+			const std::string& diffuseMap,
+			const CVector3&    colour,
+			const float&       strength,
+			CVector3           position = { 0,0,0 },
+			CVector3           rotation = { 0,0,0 },
+			float              scale    = 1) override;
+
+		CDirectionalLight* CreateDirectionalLight(
+			const std::string& mesh,
+			const std::string& name,
+			const std::string& diffuseMap,
+			const CVector3&    colour,
+			const float&       strength,
+			CVector3           position = { 0,0,0 },
+			CVector3           rotation = { 0,0,0 },
+			float              scale    = 1) override;
+
+		CPointLight* CreatePointLight(
+			const std::string& mesh,
+			const std::string& name,
+			const std::string& diffuseMap,
+			const CVector3&    colour,
+			const float&       strength,
+			CVector3           position = { 0,0,0 },
+			CVector3           rotation = { 0,0,0 },
+			float              scale    = 1) override;
+
+		SMeshImportSettings MeshImportSettings() const override;
+
+		//--------------------------
+		// Command log
+		//--------------------------
+
+		void RecordDraw(const SNullDrawCommand& command);
+
+		// Everything drawn since the last frame started. Objects and meshes are referenced
+		// by pointer, the log is only valid as long as the scene is not changed
+		const std::vector<SNullDrawCommand>& DrawCommands() const { return mDrawCommands; }
+
+		void ClearDrawCommands() { mDrawCommands.clear(); }
+
+		// Pass the following draws are recorded in
+		void SetPass(ENullPass pass) { mPass = pass; }
+
+		//--------------------------
+		// Setters / Getters
+		//--------------------------
+
+		// Frame time used by Update, 0 uses the real time since the last frame
+		void SetFixedFrameTime(float frameTime) { mFixedFrameTime = frameTime; }
+
+		uint64_t FrameCount() const { return mFrameCount; }
+
+		// Whether the meshes keep their vertices and indices on the CPU (off by default, only the sizes and bounds are kept)
+		bool KeepGeometry() const { return mKeepGeometry; }
+
+	protected:
+
+		bool mKeepGeometry = false;
+
+	private:
+
+		std::vector<SNullDrawCommand> mDrawCommands;
+
+		ENullPass mPass = ENullPass::Scene;
+
+		UINT mWidth;
+		UINT mHeight;
+
+		float    mFixedFrameTime = 0;
+		uint64_t mFrameCount = 0;
+	};
+}
@@ -0,0 +1,251 @@
+#include "NullMesh.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include "NullEngine.h"
+#include "../Common/AssetCache.h"
+#include "../Utility/LoadProfiler.h"
+
+namespace Null
+{
+	namespace
+	{
+		void Grow(CVector3& boundsMin, CVector3& boundsMax, const CVector3& point)
+		{
+			boundsMin = { std::min(boundsMin.x, point.x), std::min(boundsMin.y, point.y), std::min(boundsMin.z, point.z) };
+			boundsMax = { std::max(boundsMax.x, point.x), std::max(boundsMax.y, point.y), std::max(boundsMax.z, point.z) };
+		}
+	}
+
+	SMeshImportSettings CNullMesh::ImportSettings()
+	{
+		// Same flags as CDX12Mesh::ImportSettings(), the importer and the null objects must agree on the topology
+		unsigned int assimpFlags = aiProcess_MakeLeftHanded |
+			aiProcess_GenSmoothNormals |
+			aiProcess_FixInfacingNormals |
+			aiProcess_GenUVCoords |
+			aiProcess_TransformUVCoords |
+			aiProcess_FlipUVs |
+			aiProcess_FlipWindingOrder |
+			aiProcess_Triangulate |
+			aiProcess_JoinIdenticalVertices |
+			aiProcess_ImproveCacheLocality |
+			aiProcess_SortByPType |
+			aiProcess_FindInvalidData |
+			aiProcess_OptimizeMeshes |
+			aiProcess_FindInstances |
+			aiProcess_FindDegenerates |
+			aiProcess_RemoveRedundantMaterials |
+			aiProcess_Debone |
+			aiProcess_SplitByBoneCount |
+			aiProcess_LimitBoneWeights |
+			aiProcess_RemoveComponent |
+			aiProcess_CalcTangentSpace;
+
+		auto removeComponents = aiComponent_LIGHTS | aiComponent_CAMERAS | aiComponent_COLORS |
+			aiComponent_ANIMATIONS;
+
+		return { assimpFlags, removeComponents };
+	}
+
+	CNullMesh::CNullMesh(const CNullMesh& other) : CNullMesh(other.mEngine, other.mFileName, other.hasTangents) {}
+
+	CNullMesh::CNullMesh(CNullEngine* engine,
+		std::string fileName,
+		bool requireTangents)
+	{
+		mEngine = engine;
+
+		fileName = mEngine->GetMediaFolder() + fileName;
+
+		mFileName = fileName;
+
+		hasTangents = requireTangents;
+
+		CLoadScope importScope("Mesh Import", "mesh", fileName);
+		const auto importer = CAssetCache::Instance().Mesh(fileName, ImportSettings());
+		const auto scene = importer->GetScene();
+		importScope.End();
+
+		mNodes.resize(CountNodes(scene->mRootNode));
+		ReadNodes(scene->mRootNode, 0, 0);
+
+		// Keep the sizes and bounds only, there is nothing to upload the vertices to
+		mSubMeshes.resize(scene->mNumMeshes);
+		for (unsigned int m = 0; m < scene->mNumMeshes; ++m)
+		{
+			const auto assimpMesh = scene->mMeshes[m];
+			auto&      subMesh = mSubMeshes[m];
+
+			subMesh.name = assimpMesh->mName.C_Str();
+
+			if (!assimpMesh->HasPositions())
+				throw std::runtime_error("No position data for sub-mesh " + subMesh.name + " in " + fileName);
+
+			if (!assimpMesh->HasNormals())
+				throw std::runtime_error("No normal data for sub-mesh " + subMesh.name + " in " + fileName);
+
+			if (hasTangents && !assimpMesh->HasTangentsAndBitangents())
+				throw std::runtime_error("No tangent data for sub-mesh " + subMesh.name + " in " + fileName);
+
+			if (!assimpMesh->HasFaces())
+				throw std::runtime_error("No face data in " + subMesh.name + " in " + fileName);
+
+			subMesh.numVertices = assimpMesh->mNumVertices;
+			subMesh.numIndices = assimpMesh->mNumFaces * 3;
+
+			constexpr auto maxFloat = std::numeric_limits<float>::max();
+
+			subMesh.boundsMin = { maxFloat, maxFloat, maxFloat };
+			subMesh.boundsMax = { -maxFloat, -maxFloat, -maxFloat };
+
+			for (unsigned int v = 0; v < assimpMesh->mNumVertices; ++v)
+			{
+				const auto& p = assimpMesh->mVertices[v];
+				Grow(subMesh.boundsMin, subMesh.boundsMax, { p.x, p.y, p.z });
+			}
+
+			if (mEngine->KeepGeometry())
+			{
+				subMesh.positions.assign(reinterpret_cast<CVector3*>(assimpMesh->mVertices), reinterpret_cast<CVector3*>(assimpMesh->mVertices) + assimpMesh->mNumVertices);
+				subMesh.normals.assign(reinterpret_cast<CVector3*>(assimpMesh->mNormals), reinterpret_cast<CVector3*>(assimpMesh->mNormals) + assimpMesh->mNumVertices);
+
+				if (assimpMesh->HasTangentsAndBitangents())
+					subMesh.tangents.assign(reinterpret_cast<CVector3*>(assimpMesh->mTangents), reinterpret_cast<CVector3*>(assimpMesh->mTangents) + assimpMesh->mNumVertices);
+
+				if (assimpMesh->GetNumUVChannels() > 0 && assimpMesh->HasTextureCoords(0))
+				{
+					subMesh.uvs.resize(assimpMesh->mNumVertices);
+					for (unsigned int v = 0; v < assimpMesh->mNumVertices; ++v)
+						subMesh.uvs[v] = { assimpMesh->mTextureCoords[0][v].x, assimpMesh->mTextureCoords[0][v].y };
+				}
+
+				subMesh.indices.resize(subMesh.numIndices);
+				auto index = subMesh.indices.data();
+				for (unsigned int face = 0; face < assimpMesh->mNumFaces; ++face)
+				{
+					*index++ = assimpMesh->mFaces[face].mIndices[0];
+					*index++ = assimpMesh->mFaces[face].mIndices[1];
+					*index++ = assimpMesh->mFaces[face].mIndices[2];
+				}
+			}
+		}
+	}
+
+	void CNullMesh::Render(CGameObject* object, std::vector<CMatrix4x4>& modelMatrices, bool basicGeometry) const
+	{
+		const auto absoluteMatrices = AbsoluteMatrices(modelMatrices);
+
+		for (unsigned int nodeIndex = 0; nodeIndex < mNodes.size(); ++nodeIndex)
+		{
+			for (const auto& subMeshIndex : mNodes[nodeIndex].subMeshes)
+			{
+				SNullDrawCommand command;
+				command.object = object;
+				command.mesh = this;
+				command.subMesh = subMeshIndex;
+				command.numIndices = mSubMeshes[subMeshIndex].numIndices;
+				command.worldMatrix = absoluteMatrices[nodeIndex];
+				command.basicGeometry = basicGeometry;
+
+				mEngine->RecordDraw(command);
+			}
+		}
+	}
+
+	void CNullMesh::Bounds(const std::vector<CMatrix4x4>& modelMatrices, CVector3& boundsMin, CVector3& boundsMax) const
+	{
+		constexpr auto maxFloat = std::numeric_limits<float>::max();
+
+		boundsMin = { maxFloat, maxFloat, maxFloat };
+		boundsMax = { -maxFloat, -maxFloat, -maxFloat };
+
+		const auto absoluteMatrices = AbsoluteMatrices(modelMatrices);
+
+		for (unsigned int nodeIndex = 0; nodeIndex < mNodes.size(); ++nodeIndex)
+		{
+			for (const auto& subMeshIndex : mNodes[nodeIndex].subMeshes)
+			{
+				const auto& subMesh = mSubMeshes[subMeshIndex];
+
+				// Transform the 8 corners of the local box, gives a conservative box in world space
+				for (int corner = 0; corner < 8; ++corner)
+				{
+					const CVector3 local = {
+						corner & 1 ? subMesh.boundsMax.x : subMesh.boundsMin.x,
+						corner & 2 ? subMesh.boundsMax.y : subMesh.boundsMin.y,
+						corner & 4 ? subMesh.boundsMax.z : subMesh.boundsMin.z };
+
+					Grow(boundsMin, boundsMax, CVector3(CVector4(local, 1.0f) * absoluteMatrices[nodeIndex]));
+				}
+			}
+		}
+	}
+
+	unsigned int CNullMesh::NumVertices() const
+	{
+		unsigned int count = 0;
+		for (const auto& subMesh : mSubMeshes) count += subMesh.numVertices;
+		return count;
+	}
+
+	unsigned int CNullMesh::NumIndices() const
+	{
+		unsigned int count = 0;
+		for (const auto& subMesh : mSubMeshes) count += subMesh.numIndices;
+		return count;
+	}
+
+	std::vector<CMatrix4x4> CNullMesh::AbsoluteMatrices(const std::vector<CMatrix4x4>& modelMatrices) const
+	{
+		std::vector<CMatrix4x4> absoluteMatrices(modelMatrices.size());
+		absoluteMatrices[0] = modelMatrices[0]; // First matrix for a model is the root matrix, already in world space
+		for (unsigned int nodeIndex = 1; nodeIndex < mNodes.size(); ++nodeIndex)
+		{
+			absoluteMatrices[nodeIndex] = modelMatrices[nodeIndex] * absoluteMatrices[mNodes[nodeIndex].parentIndex];
+		}
+		return absoluteMatrices;
+	}
+
+	unsigned CNullMesh::CountNodes(aiNode* assimpNode)
+	{
+		unsigned int count = 1;
+		for (unsigned int child = 0; child < assimpNode->mNumChildren; ++child)
+			count += CountNodes(assimpNode->mChildren[child]);
+		return count;
+	}
+
+	unsigned int CNullMesh::ReadNodes(aiNode* assimpNode, unsigned int nodeIndex, unsigned int parentIndex)
+	{
+		auto& node = mNodes[nodeIndex];
+		node.parentIndex = parentIndex;
+		const auto thisIndex = nodeIndex;
+		++nodeIndex;
+
+		node.name = assimpNode->mName.C_Str();
+
+		node.defaultMatrix.SetValues(&assimpNode->mTransformation.a1);
+		node.defaultMatrix.Transpose(); // Assimp stores matrices differently to this app
+
+		node.subMeshes.resize(assimpNode->mNumMeshes);
+		for (unsigned int i = 0; i < assimpNode->mNumMeshes; ++i)
+		{
+			node.subMeshes[i] = assimpNode->mMeshes[i];
+		}
+
+		node.childNodes.resize(assimpNode->mNumChildren);
+		for (unsigned int i = 0; i < assimpNode->mNumChildren; ++i)
+		{
+			node.childNodes[i] = nodeIndex;
+			nodeIndex = ReadNodes(assimpNode->mChildren[i], nodeIndex, thisIndex);
+		}
+
+		return nodeIndex;
+	}
+}
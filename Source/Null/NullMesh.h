@@ -0,0 +1,103 @@
+//--------------------------------------------------------------------------------------
+// Class encapsulating a mesh without any GPU resource
+//--------------------------------------------------------------------------------------
+// Imports the mesh with assimp like the other backends but only keeps what the CPU side
+// of the frame needs: the node hierarchy, the sub-mesh sizes and the bounds.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "../Math/CMatrix4x4.h"
+#include "../Math/CVector2.h"
+#include "../Math/CVector3.h"
+
+struct aiNode;
+struct SMeshImportSettings;
+class CGameObject;
+
+namespace Null
+{
+	class CNullEngine;
+
+	class CNullMesh
+	{
+	public:
+
+		struct SubMesh
+		{
+			std::string  name;
+			unsigned int numVertices = 0;
+			unsigned int numIndices  = 0;
+			CVector3     boundsMin   = { 0,0,0 }; // Relative to the node the sub-mesh belongs to
+			CVector3     boundsMax   = { 0,0,0 };
+
+			// Only filled if the engine keeps the geometry
+			std::vector<CVector3>     positions;
+			std::vector<CVector3>     normals;
+			std::vector<CVector3>     tangents; // Empty if assimp could not compute them
+			std::vector<CVector2>     uvs;
+			std::vector<unsigned int> indices;
+		};
+
+		// Same meaning as the node of the other backends' meshes
+		struct Node
+		{
+			std::string  name;
+			CMatrix4x4   defaultMatrix; // Relative to parent
+			unsigned int parentIndex;   // Root node refers to itself (0)
+
+			std::vector<unsigned int> childNodes;
+			std::vector<unsigned int> subMeshes;
+		};
+
+		CNullMesh() = delete;
+		CNullMesh(const CNullMesh&&) = delete;
+		CNullMesh& operator=(const CNullMesh&) = delete;
+		CNullMesh& operator=(const CNullMesh&&) = delete;
+
+		// Will throw a std::runtime_error exception on failure, same as the other backends
+		CNullMesh(CNullEngine* engine, std::string fileName, bool requireTangents = false);
+
+		CNullMesh(const CNullMesh&);
+
+		// Same settings as the DX12 meshes, so scenes decode the same way in both
+		static SMeshImportSettings ImportSettings();
+
+		unsigned int NumberNodes() const { return static_cast<unsigned int>(mNodes.size()); }
+
+		CMatrix4x4 GetNodeDefaultMatrix(unsigned int node) const { return mNodes[node].defaultMatrix; }
+
+		// Record a draw command for every sub-mesh instead of drawing it
+		void Render(CGameObject* object, std::vector<CMatrix4x4>& modelMatrices, bool basicGeometry) const;
+
+		// World space bounding box of the mesh placed with the given matrices
+		void Bounds(const std::vector<CMatrix4x4>& modelMatrices, CVector3& boundsMin, CVector3& boundsMax) const;
+
+		std::string MeshFileName() const { return mFileName; }
+
+		unsigned int NumVertices() const;
+		unsigned int NumIndices() const;
+
+		const std::vector<SubMesh>& SubMeshes() const { return mSubMeshes; }
+		const std::vector<Node>&    Nodes() const { return mNodes; }
+
+	private:
+
+		// Same as the other backends, parents are always before their children
+		std::vector<CMatrix4x4> AbsoluteMatrices(const std::vector<CMatrix4x4>& modelMatrices) const;
+
+		unsigned int CountNodes(aiNode* assimpNode);
+
+		unsigned int ReadNodes(aiNode* assimpNode, unsigned int nodeIndex, unsigned int parentIndex);
+
+		CNullEngine* mEngine;
+
+		std::string mFileName;
+		bool        hasTangents;
+
+		std::vector<SubMesh> mSubMeshes;
+		std::vector<Node>    mNodes;
+	};
+}
@@ -0,0 +1,63 @@
+#include "NullScene.h"
+
+#include "NullEngine.h"
+#include "../Common/CGameObjectManager.h"
+#include "../Common/CLight.h"
+
+namespace Null
+{
+	CNullScene::CNullScene(CNullEngine* engine, std::string fileName) :
+		CScene(engine, fileName)
+	{
+		mEngine = engine;
+	}
+
+	void CNullScene::RenderScene(float& frameTime)
+	{
+		const auto objManager = mEngine->GetObjManager();
+
+		// Same order as the DX11 scene, shadow maps first
+		for (const auto& it : objManager->mSpotLights)
+			if (*it->Enabled()) it->RenderFromThis();
+
+		for (const auto& it : objManager->mDirLights)
+			if (*it->Enabled()) it->RenderFromThis();
+
+		for (const auto& it : objManager->mPointLights)
+			if (*it->Enabled()) it->RenderFromThis();
+
+		RenderSceneFromCamera(mCamera.get());
+
+		RenderToDepthMap();
+
+		PostProcessingPass();
+	}
+
+	void CNullScene::RenderSceneFromCamera(CCamera* camera)
+	{
+		// Keep the camera matrices up to date like the other scenes do when filling the frame constants
+		camera->ViewProjectionMatrix();
+
+		mEngine->SetPass(ENullPass::Scene);
+		mEngine->GetObjManager()->RenderAllObjects();
+	}
+
+	void CNullScene::UpdateScene(float& frameTime)
+	{
+		mEngine->GetObjManager()->UpdateObjects(frameTime);
+	}
+
+	ImTextureID CNullScene::GetTextureSRV() { return nullptr; }
+
+	void CNullScene::Resize(UINT newX, UINT newY)
+	{
+		mCamera->SetAspectRatio(float(newX) / float(newY));
+
+		mViewportX = newX;
+		mViewportY = newY;
+	}
+
+	void CNullScene::PostProcessingPass() {}
+	void CNullScene::RenderToDepthMap() {}
+	void CNullScene::DisplayPostProcessingEffects() {}
+}
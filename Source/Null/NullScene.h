@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../Common/CScene.h"
+
+namespace Null
+{
+	class CNullEngine;
+
+	// Runs the same per frame work as the other scenes, draws end up in the engine command log
+	class CNullScene : public CScene
+	{
+	public:
+
+		CNullScene() = delete;
+		CNullScene(const CNullScene&) = delete;
+		CNullScene(const CNullScene&&) = delete;
+		CNullScene& operator=(const CNullScene&) = delete;
+		CNullScene& operator=(const CNullScene&&) = delete;
+
+		CNullScene(CNullEngine* engine, std::string fileName);
+
+		~CNullScene() override = default;
+
+		//--------------------------------------------------------------------------------------
+		// Scene Render and Update
+		//--------------------------------------------------------------------------------------
+
+		// Shadow passes of the enabled lights, then the objects from the scene camera
+		void RenderScene(float& frameTime) override;
+
+		void RenderSceneFromCamera(CCamera* camera) override;
+
+		// No input and no window title to update
+		void UpdateScene(float& frameTime) override;
+
+		ImTextureID GetTextureSRV() override;
+
+		void Resize(UINT newX, UINT newY) override;
+		void PostProcessingPass() override;
+		void RenderToDepthMap() override;
+		void DisplayPostProcessingEffects() override;
+
+	private:
+
+		CNullEngine* mEngine = nullptr;
+	};
+}
@@ -0,0 +1,191 @@
+#include "NullGameObject.h"
+
+#include <stdexcept>
+
+#include "../NullEngine.h"
+#include "../../Utility/HelperFunctions.h"
+
+namespace Null
+{
+	CNullGameObject::CNullGameObject(CNullGameObject& obj)
+		:CNullGameObject(obj.mEngine, obj.MeshFileNames(), obj.Name(), obj.Position(), obj.Rotation(), obj.Scale().x)
+	{
+	}
+
+	CNullGameObject::CNullGameObject(CNullEngine* engine,
+		const std::string& mesh,
+		const std::string& name,
+		const std::string& diffuseMap,
+		CVector3           position,
+		CVector3           rotation,
+		float              scale)
+	{
+		mEngine = engine;
+		mRoughness = 0.5f;
+		mMetalness = 0.0f;
+
+		mEnabled = true;
+
+		if (mesh.empty()) throw std::runtime_error("Error Loading Object");
+
+		mName = name;
+
+		mTextureFiles = { diffuseMap };
+
+		try
+		{
+			mMesh = std::make_unique<CNullMesh>(mEngine, mesh);
+			mMeshFiles.push_back(mesh);
+			mLODs.push_back(mMeshFiles);
+
+			// Set default matrices from mesh
+			mWorldMatrices.resize(mMesh->NumberNodes());
+			for (auto i = 0; i < mWorldMatrices.size(); ++i) mWorldMatrices[i] = mMesh->GetNodeDefaultMatrix(i);
+		}
+		catch (const std::exception& e) { throw std::runtime_error(e.what()); }
+
+		//geometry loaded, set its position...
+		SetPosition(position);
+		SetRotation(rotation);
+		SetScale(scale);
+	}
+
+	CNullGameObject::CNullGameObject(CNullEngine* engine,
+		std::string        id,
+		const std::string& name,
+		CVector3           position,
+		CVector3           rotation,
+		float              scale)
+	{
+		mEngine = engine;
+
+		mName = name;
+
+		mEnabled = true;
+
+		mParallaxDepth = 0.f;
+		mRoughness = 0.5f;
+		mMetalness = 0.0f;
+
+		//search for files with the same id
+		std::vector<std::string> files;
+
+		auto folder = engine->GetMediaFolder() + id;
+
+		//	If the id has a dot, this means it has an extention, so we are dealing with a file
+		if (id.find_last_of('.') == std::string::npos)
+		{
+			GetFilesInFolder(mEngine, folder, files);
+		}
+		else if (const auto slashPos = id.find_last_of('/'); slashPos != std::string::npos)
+		{
+			folder = engine->GetMediaFolder() + id.substr(0, slashPos) + '/';
+
+			GetFilesInFolder(mEngine, folder, files);
+		}
+		else
+		{
+			id = id.substr(0, id.find_first_of('_'));
+
+			GetFilesWithID(engine->GetMediaFolder(), files, id);
+		}
+
+		for (const auto& st : files)
+		{
+			if (st.find(".fbx") != std::string::npos) mMeshFiles.push_back(st);
+			else if (st.find(".x") != std::string::npos)  mMeshFiles.push_back(st);
+			else if (st.find(".png") != std::string::npos) mTextureFiles.push_back(st);
+			else if (st.find(".dds") != std::string::npos) mTextureFiles.push_back(st);
+			else if (st.find(".jpg") != std::string::npos) mTextureFiles.push_back(st);
+		}
+
+		if (mMeshFiles.empty()) { throw std::runtime_error("No mesh found in " + name); }
+
+		// Same LOD / variation grouping as the other backends
+		if (mMeshFiles.size() > 1)
+		{
+			int                      counter = 0;
+			std::vector<std::string> vec;
+			for (const auto& mesh : mMeshFiles)
+			{
+				std::string currFind = "LOD";
+				currFind += (counter + '0');
+
+				if (mesh.find(currFind) != std::string::npos)
+				{
+					vec.push_back(mesh);
+				}
+				else
+				{
+					mLODs.push_back(move(vec));
+					vec.push_back(mesh);
+					counter++;
+				}
+			}
+		}
+		else
+		{
+			mLODs.push_back(mMeshFiles);
+		}
+
+		try
+		{
+			mMesh = std::make_unique<CNullMesh>(mEngine, mMeshFiles.front(), true);
+
+			mWorldMatrices.resize(mMesh->NumberNodes());
+			for (auto i = 0; i < mWorldMatrices.size(); ++i) mWorldMatrices[i] = mMesh->GetNodeDefaultMatrix(i);
+		}
+		catch (std::exception& e) { throw std::runtime_error(e.what()); }
+
+		// geometry loaded, set its position...
+		SetPosition(position);
+		SetRotation(rotation);
+		SetScale(scale);
+	}
+
+	CNullMesh* CNullGameObject::Mesh() const { return mMesh.get(); }
+
+	void CNullGameObject::Bounds(CVector3& boundsMin, CVector3& boundsMax) const
+	{
+		mMesh->Bounds(mWorldMatrices, boundsMin, boundsMax);
+	}
+
+	void CNullGameObject::LoadNewMesh(std::string newMesh)
+	{
+		try
+		{
+			auto mesh = std::make_unique<CNullMesh>(mEngine, newMesh, IsPbr());
+
+			const auto prevPos = Position();
+			const auto prevScale = Scale();
+			const auto prevRotation = Rotation();
+
+			mMesh = std::move(mesh);
+
+			// Recalculate matrix based on mesh
+			mWorldMatrices.resize(mMesh->NumberNodes());
+			for (auto i = 0; i < mWorldMatrices.size(); ++i) mWorldMatrices[i] = mMesh->GetNodeDefaultMatrix(i);
+
+			SetPosition(prevPos);
+			SetScale(prevScale);
+			SetRotation(prevRotation);
+		}
+		catch (const std::exception& e) { throw std::runtime_error(e.what()); }
+	}
+
+	void CNullGameObject::Render(bool basicGeometry)
+	{
+		//if the model is not enable do not render it
+		if (!mEnabled) return;
+
+		mMesh->Render(this, mWorldMatrices, basicGeometry);
+	}
+
+	void CNullGameObject::RenderToAmbientMap()
+	{
+	}
+
+	void CNullPlant::Render(bool basicGeometry) { CNullGameObject::Render(basicGeometry); }
+
+	void CNullSky::Render(bool basicGeometry) { CNullGameObject::Render(basicGeometry); }
+}
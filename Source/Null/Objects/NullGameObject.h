@@ -0,0 +1,88 @@
+//--------------------------------------------------------------------------------------
+// Game object of the null backend
+//--------------------------------------------------------------------------------------
+// Same construction as the other backends (simple mesh + diffuse map, or "smart" ID lookup)
+// but it keeps only the transforms, bounds and the names of its assets.
+
+#pragma once
+
+#include <memory>
+
+#include "../../Common/CGameObject.h"
+#include "../NullMesh.h"
+
+namespace Null
+{
+	class CNullEngine;
+
+	class CNullGameObject : virtual public CGameObject
+	{
+	public:
+		~CNullGameObject() override = default;
+
+		//-------------------------------------
+		// Construction / Usage
+		//-------------------------------------
+
+		CNullGameObject(CNullGameObject&);
+
+		// Simple object constructor
+		CNullGameObject(CNullEngine* engine,
+			const std::string& mesh,
+			const std::string& name,
+			const std::string& diffuseMap,
+			CVector3           position = { 0,0,0 },
+			CVector3           rotation = { 0,0,0 },
+			float              scale = 1);
+
+		// "Smart" Constructor, same ID formats as the DX12 game object
+		CNullGameObject(CNullEngine* engine,
+			std::string        id,
+			const std::string& name,
+			CVector3           position = { 0,0,0 },
+			CVector3           rotation = { 0,0,0 },
+			float              scale = 1);
+
+		CNullMesh* Mesh() const;
+
+		const std::vector<std::string>& TextureFiles() const { return mTextureFiles; }
+
+		// World space bounding box
+		void Bounds(CVector3& boundsMin, CVector3& boundsMax) const;
+
+		void LoadNewMesh(std::string newMesh) override;
+
+		// Record the draws of the mesh in the engine command log
+		void Render(bool basicGeometry = false) override;
+
+		void RenderToAmbientMap() override;
+
+	protected:
+
+		CNullEngine* mEngine;
+
+		std::unique_ptr<CNullMesh> mMesh;
+	};
+
+	class CNullPlant : public virtual CNullGameObject, public virtual CPlant
+	{
+		public:
+			CNullPlant(CNullEngine* engine, const std::string& id, const std::string& name, const CVector3& position, const CVector3& rotation, float scale)
+				: CNullGameObject(engine, id, name, position, rotation, scale)
+			{
+			}
+
+			void Render(bool basicGeometry) override;
+	};
+
+	class CNullSky : public virtual CNullGameObject, public virtual CSky
+	{
+		public:
+			CNullSky(CNullEngine* engine, const std::string& mesh, const std::string& name, const std::string& diffuseMap, const CVector3& position, const CVector3& rotation, float scale)
+				: CNullGameObject(engine, mesh, name, diffuseMap, position, rotation, scale)
+			{
+			}
+
+			void Render(bool basicGeometry = false) override;
+	};
+}
@@ -0,0 +1,131 @@
+#include "NullLights.h"
+
+#include "../NullEngine.h"
+#include "../../Common/CGameObjectManager.h"
+
+namespace Null
+{
+	namespace
+	{
+		// What the shadow map passes of the other backends draw
+		void RecordDepthPass(CNullEngine* engine)
+		{
+			engine->SetPass(ENullPass::Depth);
+
+			for (const auto& o : engine->GetObjManager()->mObjects)
+			{
+				o->Render(true);
+			}
+
+			engine->SetPass(ENullPass::Scene);
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Light
+	//--------------------------------------------------------------------------------------
+
+	CNullLight::CNullLight(CNullEngine* engine,
+		const std::string& mesh,
+		const std::string& name,
+		const std::string& diffuse,
+		CVector3           colour,
+		float              strength,
+		CVector3           position,
+		CVector3           rotation,
+		float              scale) :
+		CNullGameObject(engine, mesh, name, diffuse, position, rotation, scale),
+		CLight(colour, strength)
+	{
+		mStrength = strength;
+		mColour = colour;
+	}
+
+	void CNullLight::Render(bool basicGeometry) { CNullGameObject::Render(basicGeometry); }
+
+	//--------------------------------------------------------------------------------------
+	// Spot light
+	//--------------------------------------------------------------------------------------
+
+	CNullSpotLight::CNullSpotLight(CNullEngine* engine,
+		const std::string& mesh,
+		const std::string& name,
+		const std::string& diffuse,
+		const CVector3& colour,
+		float strength,
+		const CVector3& position,
+		const CVector3& rotation,
+		float scale,
+		const int& shadowMapSize,
+		const float& coneAngle) :
+		CNullGameObject(engine, mesh, name, diffuse, position, rotation, scale),
+		CSpotLight(colour, strength, shadowMapSize, coneAngle)
+	{
+	}
+
+	void* CNullSpotLight::RenderFromThis()
+	{
+		RecordDepthPass(mEngine);
+		return nullptr;
+	}
+
+	void* CNullSpotLight::GetSRV() { return nullptr; }
+	void CNullSpotLight::SetConeAngle(float value) { mConeAngle = value; }
+	void CNullSpotLight::SetShadowMapsSize(int value) { mShadowMapSize = value; }
+
+	//--------------------------------------------------------------------------------------
+	// Directional light
+	//--------------------------------------------------------------------------------------
+
+	CNullDirectionalLight::CNullDirectionalLight(CNullEngine* engine,
+		const std::string& mesh,
+		const std::string& name,
+		const std::string& diffuse,
+		const CVector3& colour,
+		float strength,
+		const CVector3& position,
+		const CVector3& rotation,
+		float scale) :
+		CNullGameObject(engine, mesh, name, diffuse, position, rotation, scale),
+		CDirectionalLight(colour, strength)
+	{
+	}
+
+	void CNullDirectionalLight::SetShadowMapSize(int s) { mShadowMapSize = s; }
+
+	void* CNullDirectionalLight::RenderFromThis()
+	{
+		RecordDepthPass(mEngine);
+		return nullptr;
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Point light
+	//--------------------------------------------------------------------------------------
+
+	CNullPointLight::CNullPointLight(CNullEngine* engine,
+		const std::string& mesh,
+		const std::string& name,
+		const std::string& diffuse,
+		const CVector3& colour,
+		float strength,
+		const CVector3& position,
+		const CVector3& rotation,
+		float scale,
+		const int& shadowMapSize) :
+		CNullGameObject(engine, mesh, name, diffuse, position, rotation, scale),
+		CPointLight(colour, strength, shadowMapSize)
+	{
+	}
+
+	void CNullPointLight::SetShadowMapSize(int size) { mShadowMapSize = size; }
+
+	void* CNullPointLight::GetSRV() { return nullptr; }
+
+	void* CNullPointLight::RenderFromThis()
+	{
+		// One pass per cube face
+		for (int i = 0; i < 6; ++i) RecordDepthPass(mEngine);
+		return nullptr;
+	}
+}
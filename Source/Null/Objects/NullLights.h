@@ -0,0 +1,82 @@
+#pragma once
+
+#include "NullGameObject.h"
+#include "../../Common/CLight.h"
+
+namespace Null
+{
+	class CNullLight : virtual public CNullGameObject, virtual public CLight
+	{
+		public:
+			CNullLight(CNullEngine*       engine,
+					   const std::string& mesh,
+					   const std::string& name,
+					   const std::string& diffuse,
+					   CVector3           colour   = { 1.f,1.f,.7f },
+					   float              strength = 1.f,
+					   CVector3           position = { 0.f,0.f,0.f },
+					   CVector3           rotation = { 0.f,0.f,0.f },
+					   float              scale    = 1.f);
+
+			void Render(bool basicGeometry = false) override;
+	};
+
+	// The shadow casting lights record a depth pass of every object instead of rendering a shadow map
+
+	class CNullSpotLight : public CNullGameObject, public CSpotLight
+	{
+		public:
+			CNullSpotLight(CNullEngine*       engine,
+						   const std::string& mesh,
+						   const std::string& name,
+						   const std::string& diffuse,
+						   const CVector3&    colour,
+						   float              strength,
+						   const CVector3&    position,
+						   const CVector3&    rotation,
+						   float              scale,
+						   const int&         shadowMapSize = 2048,
+						   const float&       coneAngle     = 90.f);
+
+			void* RenderFromThis() override;
+			void* GetSRV() override;
+			void SetConeAngle(float value) override;
+			void SetShadowMapsSize(int value) override;
+	};
+
+	class CNullDirectionalLight : public CNullGameObject, public CDirectionalLight
+	{
+		public:
+			CNullDirectionalLight(CNullEngine*       engine,
+								  const std::string& mesh,
+								  const std::string& name,
+								  const std::string& diffuse,
+								  const CVector3&    colour,
+								  float              strength,
+								  const CVector3&    position,
+								  const CVector3&    rotation,
+								  float              scale);
+
+			void SetShadowMapSize(int s) override;
+			void* RenderFromThis() override;
+	};
+
+	class CNullPointLight : public CNullGameObject, public CPointLight
+	{
+		public:
+			CNullPointLight(CNullEngine*       engine,
+							const std::string& mesh,
+							const std::string& name,
+							const std::string& diffuse,
+							const CVector3&    colour,
+							float              strength,
+							const CVector3&    position,
+							const CVector3&    rotation,
+							float              scale,
+							const int&         shadowMapSize = 2048);
+
+			void SetShadowMapSize(int size) override;
+			void* GetSRV() override;
+			void* RenderFromThis() override;
+	};
+}
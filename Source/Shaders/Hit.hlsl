@@ -54,9 +54,7 @@ cbuffer TextureCoordinates : register(b1)
     int2 gAlbedoDims;
     int2 gNormalDims;
     int2 gDisplacementDims;
-    int2 gRoughnessDims;
-    int2 gMetalnessDims;
-    int2 gAODims;
+    int2 gOrmDims;
 }
 
 // Raytracing acceleration structure, accessed as a SRV
@@ -68,9 +66,7 @@ StructuredBuffer<int> indices : register(t2);
 Texture2D<float4> AlbedoMap : register(t3);
 Texture2D<float4> NormalMap : register(t4);
 Texture2D<float4> DisplacementMap : register(t5);
-Texture2D<float4> RoughnessMap : register(t6);
-Texture2D<float4> MetalnessMap : register(t7);
-Texture2D<float4> AOMap : register(t8);
+Texture2D<float4> OrmMap : register(t6); // AO, roughness and metalness in r, g and b
 
 // Retrieve hit world position.
 float3 HitWorldPosition()
@@ -209,7 +205,8 @@ float ShootShadowRay(float3 lightDir)
     ShadowHitInfo shadowPayload;
     shadowPayload.isHit = false;
 
-    TraceRay(SceneBVH, RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH, 0xFF, 1, 0, 1, rayDesc, shadowPayload);
+    // The shadow hit record is the second of the two of each geometry
+    TraceRay(SceneBVH, RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH, 0xFF, 1, 2, 1, rayDesc, shadowPayload);
 
     return shadowPayload.isHit ? 0.3f : 1.0f;
 }
@@ -250,7 +247,7 @@ void ClosestHit(inout HitInfo payload, Attributes attrib)
 
     HitInfo IBLPayload;
 
-    TraceRay(SceneBVH, RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH, 0xFF, 0, 0, 0, ray, IBLPayload);
+    TraceRay(SceneBVH, RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH, 0xFF, 0, 2, 0, ray, IBLPayload);
 
     int2 coord = floor(uv * gAlbedoDims);
 
@@ -271,9 +268,11 @@ void ClosestHit(inout HitInfo payload, Attributes attrib)
     // Sample textures using the converted UV (if any)
     
     float3 albedo = AlbedoMap.Load(int3(coord, 0)).rgb;
-    float roughness = RoughnessMap.Load(int3(coord, 0)).r;
-    float metalness = MetalnessMap.Load(int3(coord, 0)).r;
-    float ao = gMetalnessDims.x ? 1.0f : AOMap.Load(int3(coord, 0)).r;
+    // Without the maps, the values the ORM texture has for the missing ones
+    float3 orm = gOrmDims.x ? OrmMap.Load(int3(coord * gOrmDims / max(gAlbedoDims, 1), 0)).rgb : float3(1.0f, 0.5f, 0.0f);
+    float ao = orm.r;
+    float roughness = orm.g;
+    float metalness = orm.b;
 
     // Precalculate stuff
     float3 specularColour = lerp(float3(0.04f, 0.04f, 0.04f), albedo, metalness);
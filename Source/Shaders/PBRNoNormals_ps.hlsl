@@ -15,9 +15,7 @@
 // Note that textures are often called maps (because texture mapping describes wrapping a texture round a mesh).
 // Get used to people using the word "texture" and "map" interchangably.
 Texture2D DiffuseSpecularMap : register(t0); // Textures here can contain a diffuse map (main colour) in their rgb channels and a specular map (shininess) in the a channel
-Texture2D AOMap : register(t1); // Ambient Occlusion Map, precalculated by the artist, holds the amount of occlusion for each texel
-Texture2D RoughnessMap : register(t4); // Roughness map, holds how the material is shiny or rough, this will modify the specular light
-Texture2D MetalnessMap : register(t5); // Metalness Map, tipically holds 0 or 1, rarely inbetween.
+Texture2D OrmMap : register(t1); // Ambient occlusion, roughness and metalness maps packed in r, g and b
 
 SamplerState TexSampler : register(s0); // A sampler is a filter for a texture like bilinear, trilinear or anisotropic - this is the sampler used for the texture above
 
@@ -125,17 +123,12 @@ float4 main(LightingPixelShaderInput input) : SV_Target
     if (!opacity)
         discard;
    
-    float ao = 1;
-    if(gHasAoMap) 
-        ao = AOMap.Sample(TexSampler, input.uv).r;
-    
-    float metalness = 0;
-    if (gHasMetallnessMap)
-        metalness = MetalnessMap.Sample(TexSampler, input.uv).r;
-    
-    float roughness = gRoughness;
-    if (gHasRoughnessMap)
-        roughness = RoughnessMap.Sample(TexSampler, input.uv).r;
+    // One sample for the three maps
+    const float3 orm = OrmMap.Sample(TexSampler, input.uv).rgb;
+
+    const float ao = gHasAoMap ? orm.r : 1.0f;
+    const float metalness = gHasMetallnessMap ? orm.b : 0.0f;
+    const float roughness = gHasRoughnessMap ? orm.g : gRoughness;
     
     // Direction from pixel to camera
     const float3 cameraDirection = normalize(gCameraPosition - input.worldPosition);
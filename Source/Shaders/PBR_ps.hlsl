@@ -12,11 +12,9 @@
 // Here we allow the shader access to a texture that has been loaded from the C++ side and stored in GPU memory (the words map and texture are used interchangeably)
 
 Texture2D AlbedoMap : register(t0); // Diffuse map (main colour) in rgb and specular map (shininess level) in alpha - C++ must load this into slot 0
-Texture2D AOMap : register(t1); // Ambient Occlusion Map, precalculated by the artist, holds the amount of occlusion for each texel
+Texture2D OrmMap : register(t1); // Ambient occlusion, roughness and metalness maps packed in r, g and b
 Texture2D DisplacementMap : register(t2); // Displacement map / Height map, different from the normal map.
 Texture2D NormalHeightMap : register(t3); // Normal map in rgb, holds the normals for every texel 
-Texture2D RoughnessMap : register(t4); // Roughness map, holds how the material is shiny or rough, this will modify the specular light
-Texture2D MetalnessMap : register(t5); // Metalness Map, tipically holds 0 or 1, rarely inbetween.
                                     
 TextureCube IBLMap : register(t6);
 
@@ -27,6 +25,13 @@ SamplerState PointClamp : register(s1); // Aampler for the shadow maps
 
 static const float PI = 3.14159265359f;
 
+// The cooked normal maps (BC5) only store x and y, z is rebuilt from them. Works the same for the maps that store z
+float3 UnpackNormal(const float2 xy)
+{
+    const float2 n = xy * 2.0f - 1.0f;
+    return float3(n, sqrt(saturate(1.0f - dot(n, n))));
+}
+
 float3 CalculateLight(const float3 lightPos, const float lightIntensity, const float3 colour, float3 diffuse, float3 specular, float3 n, float3 v, float3 worldPos, float roughness, float3 albedo)
 {
 	const float nDotV = max(dot(n, v), 0.001f);
@@ -248,7 +253,7 @@ float4 main(NormalMappingPixelShaderInput input) : SV_Target
 	// values are stored in the range 0->1, whereas the x, y & z components should be in the range -1->1. So some scaling is needed
     
     // Get normal from normal map, convert from tangent space to world space
-    float3 tangentSpaceN       = normalize(NormalHeightMap.Sample(TexSampler, offsetTexCoord).xyz * 2.0f - 1.0f);
+    float3 tangentSpaceN       = normalize(UnpackNormal(NormalHeightMap.Sample(TexSampler, offsetTexCoord).rg));
     tangentSpaceN.y            = -tangentSpaceN.y; // All the normal maps have Y up, but to make a LHS with Z outwards and X rightwards, then Y should be down
 	const float3 textureNormal = mul(tangentSpaceN, tangentMatrix);
     
@@ -262,9 +267,10 @@ float4 main(NormalMappingPixelShaderInput input) : SV_Target
 
     //Sample the albedo
     const float3 albedo = AlbedoMap.Sample(TexSampler, input.uv).rgb;
-    const float roughness = lerp(gRoughness, RoughnessMap.Sample(TexSampler, input.uv).r, gHasRoughnessMap);
-    const float ao = lerp(1.0f, AOMap.Sample(TexSampler, input.uv).r, gHasAoMap);
-    const float metalness = lerp(gMetalness, MetalnessMap.Sample(TexSampler, input.uv).r, gHasMetallnessMap);
+    const float3 orm = OrmMap.Sample(TexSampler, input.uv).rgb;
+    const float roughness = lerp(gRoughness, orm.g, gHasRoughnessMap);
+    const float ao = lerp(1.0f, orm.r, gHasAoMap);
+    const float metalness = lerp(gMetalness, orm.b, gHasMetallnessMap);
     
 	///////////////////////
     // Global illumination
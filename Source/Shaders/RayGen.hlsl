@@ -60,7 +60,7 @@ void RayGen()
     RAY_FLAG_CULL_BACK_FACING_TRIANGLES, //  RayFlags
     0xFF,                                //  InstanceInclusionMask
     0,                                   //  RayContributionToHitGroupIndex
-    0,                                   //  MultiplierForGeometryContributionToHitGroupIndex
+    2,                                   //  MultiplierForGeometryContributionToHitGroupIndex (the ray types, a hit record each per geometry)
     0,                                   //  MissShaderIndex
     ray,                                 //  Ray
     payload                              //  Payload
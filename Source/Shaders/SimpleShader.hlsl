@@ -119,26 +119,23 @@ struct sPointLight
 
 static const int MAX_LIGHTS = 64;
 
-cbuffer PerModelConstants : register(b0) // The b1 gives this constant buffer the number 1 - used in the C++ code
+// The draws only pass the index of their record in gInstances, as a root constant
+cbuffer PerDrawConstants : register(b0)
 {
-float4x4 gWorldMatrix;
-
-float3 gObjectColour; // Used for tinting light models
-float  gParallaxDepth; // Used in the pixel shader to control how much the polygons are bumpy
+uint gInstanceIndex;
+}
 
-float gUseCustomVaues;
-float gHasAoMap;
-float gHasRoughnessMap;
-float gHasAmbientMap;
-float gHasMetallnessMap;
-float gHasNormalMap;
-float gHasDisplacementMap;
+// A node of an object. Matches SInstanceRecord in DX12InstanceTable.h
+struct SInstance
+{
+	row_major float3x4 worldMatrix; // Translation in the last column
+	uint               material;    // The record in gMaterials
+	uint               flags;
+};
 
-float gRoughness;
-float gMetalness;
+static const uint InstanceTangents = 1 << 0; // The mesh has tangents, the normal map can be used
 
-float padding[35];
-}
+StructuredBuffer<SInstance> gInstances : register(t9);
 
 
 cbuffer PerFrameConstants : register(b1) // The b0 gives this constant buffer the number 0 - used in the C++ code
@@ -200,13 +197,15 @@ NormalMappingPixelShaderInput VSMain(TangentVertex input)
 	// Multiply by the world matrix passed from C++ to transform the model vertex position into world space. 
 	// In a similar way use the view matrix to transform the vertex from world space into view space (camera's point of view)
 	// and then use the projection matrix to transform the vertex to 2D projection space (project onto the 2D screen)
-	const float4 worldPosition = mul(gWorldMatrix, float4(input.position, 1));
+	const float3x4 worldMatrix = gInstances[gInstanceIndex].worldMatrix;
+
+	const float4 worldPosition = float4(mul(worldMatrix, float4(input.position, 1)), 1);
 	const float4 viewPosition  = mul(gViewMatrix, worldPosition);
 
 	result.projectedPosition = mul(gProjectionMatrix, viewPosition);
 	result.uv                = input.uv;
 
-	result.worldNormal = mul(gWorldMatrix, float4(input.normal, 0)).xyz;
+	result.worldNormal = mul(worldMatrix, float4(input.normal, 0));
 
 	result.worldPosition = worldPosition.xyz;
 	result.worldTangent  = input.tangent;
@@ -230,12 +229,30 @@ NormalMappingPixelShaderInput VSMain(TangentVertex input)
 SamplerState TexSampler : register(s0); // A sampler is a filter for a texture like bilinear, trilinear or anisotropic
 SamplerState PointClamp : register(s1); // Sampler for the shadowMaps
 
-Texture2D   AlbedoMap : register(t0);
-Texture2D   RoughnessMap : register(t1);
-Texture2D   AoMap : register(t2);
-Texture2D   DisplacementMap : register(t3);
-Texture2D   NormalMap : register(t4);
-Texture2D   MetalnessMap : register(t5);
+// Bindless materials: every texture of the descriptor heap, picked by the indices in the material of the draw
+// Matches SMaterialRecord in DX12MaterialTable.h
+struct SMaterial
+{
+	uint  albedo;
+	uint  normal;
+	uint  displacement;
+	uint  orm; // AO, roughness and metalness in r, g and b
+	uint  flags;
+	float roughness;
+	float metalness;
+	float parallaxDepth;
+};
+
+static const uint HasAlbedo       = 1 << 0;
+static const uint HasNormal       = 1 << 1;
+static const uint HasDisplacement = 1 << 2;
+static const uint HasAo           = 1 << 3;
+static const uint HasRoughness    = 1 << 4;
+static const uint HasMetalness    = 1 << 5;
+
+Texture2D                  gTextures[] : register(t0, space1);
+StructuredBuffer<SMaterial> gMaterials : register(t8);
+
 TextureCube IBLMap : register(t6);
 Texture2D   ShadowMap : register(t7);
 
@@ -245,6 +262,13 @@ Texture2D   ShadowMap : register(t7);
 
 static const float PI = 3.14159265359f;
 
+// The cooked normal maps (BC5) only store x and y, z is rebuilt from them. Works the same for the maps that store z
+float3 UnpackNormal(const float2 xy)
+{
+    const float2 n = xy * 2.0f - 1.0f;
+    return float3(n, sqrt(saturate(1.0f - dot(n, n))));
+}
+
 
 float3 CalculateLight(const float3 lightPos,
                       const float  lightIntensity,
@@ -308,7 +332,8 @@ float3 CalculateLight(const float3 lightPos,
 
 // Normal mapping - sample normal map at given position and UV for a surface of given normal and tangent.
 // Optionally uses parallax mapping, in which case UV is updated
-float3 SampleNormal(float3       position,
+float3 SampleNormal(SMaterial    material,
+                    float3       position,
                     float3       normal,
                     float3       tangent,
                     inout float2 UV,
@@ -327,7 +352,7 @@ float3 SampleNormal(float3       position,
 
 		// Get camera direction in model space
 		const float3   cameraDir      = normalize(cameraPosition - position);
-		const float3x3 invWorldMatrix = transpose((float3x3)gWorldMatrix);
+		const float3x3 invWorldMatrix = transpose((float3x3)gInstances[gInstanceIndex].worldMatrix);
 		const float3   cameraModelDir = normalize(mul(cameraDir, invWorldMatrix));
 
 		// Calculate direction to offset UVs (x and y of camera direction in tangent space)
@@ -335,21 +360,23 @@ float3 SampleNormal(float3       position,
 		const float2   textureOffsetDir = mul(cameraModelDir, tangentMatrix).xy;
 
 		// Offset UVs in that direction to account for depth (using height map and some geometry)
-		const float texDepth = gParallaxDepth * (DisplacementMap.Sample(TexSampler, UV).r - 0.5f);
+		const float texDepth = material.parallaxDepth * (gTextures[material.displacement].Sample(TexSampler, UV).r - 0.5f);
 		UV += texDepth * textureOffsetDir;
 	}
 
 	// Extract normal from map and shift to -1 to 1 range
-	float3 textureNormal = 2.0f * NormalMap.Sample(TexSampler, UV).rgb - 1.0f;
+	float3 textureNormal = UnpackNormal(gTextures[material.normal].Sample(TexSampler, UV).rg);
 	textureNormal.y      = -textureNormal.y;
 
 	// Convert normal from tangent space to world space
-	return normalize(mul(mul(textureNormal, invTangentMatrix), (float3x3)gWorldMatrix));
+	return normalize(mul(mul(textureNormal, invTangentMatrix), (float3x3)gInstances[gInstanceIndex].worldMatrix));
 }
 
 
-float2 ParallaxMapping(float2 UV, float3 v)
+float2 ParallaxMapping(SMaterial material, float2 UV, float3 v)
 {
+	Texture2D displacementMap = gTextures[material.displacement];
+
 	//------------------------------
 	// Common linear search for parallax occlusion mapping and relief mapping
 
@@ -367,12 +394,12 @@ float2 ParallaxMapping(float2 UV, float3 v)
 	// For each step along the ray direction, find the amount to move the UVs and the amount to descend in the height layer
 	float  rayHeight  = 1.0f; // Current height of ray, 0->1 in the height map layer. Start at the top of the layer
 	float  heightStep = 1.0f / numSamples; // Amount the ray descends for each step
-	float2 uvStep     = (gParallaxDepth * v.xy / v.z) / numSamples; // Ray UV offset for each step. Can also remove the / v.z here
+	float2 uvStep     = (material.parallaxDepth * v.xy / v.z) / numSamples; // Ray UV offset for each step. Can also remove the / v.z here
 	// to add limiting, which will reduce artefacts at glancing angles
 	// but will also reduce the depth at those angles
 
 	// Sample height map at intial UVs (top of layer)
-	float surfaceHeight     = DisplacementMap.Sample(TexSampler, UV).r;
+	float surfaceHeight     = displacementMap.Sample(TexSampler, UV).r;
 	float prevSurfaceHeight = surfaceHeight;
 
 	float2 dx = ddx(UV);
@@ -387,7 +414,7 @@ float2 ParallaxMapping(float2 UV, float3 v)
 
 		// Sample height map again
 		prevSurfaceHeight = surfaceHeight;
-		surfaceHeight     = DisplacementMap.SampleGrad(TexSampler, UV, dx, dy).r;
+		surfaceHeight     = displacementMap.SampleGrad(TexSampler, UV, dx, dy).r;
 	}
 
 	//------------------------------
@@ -426,7 +453,7 @@ float2 ParallaxMapping(float2 UV, float3 v)
 		UV += dir * uvStep;
 
 		// Sample height map again
-		surfaceHeight = DisplacementMap.SampleGrad(TexSampler, UV, dx, dy).r;
+		surfaceHeight = displacementMap.SampleGrad(TexSampler, UV, dx, dy).r;
 	}
 
 	return UV;
@@ -441,6 +468,9 @@ float4 PSMain(NormalMappingPixelShaderInput input) : SV_TARGET
 
 	// Will use the model normal/tangent to calculate matrix for tangent space. The normals for each pixel are *interpolated* from the
 	// vertex normals/tangents. This means they will not be length 1, so they need to be renormalised (same as per-pixel lighting issue)
+	const SInstance instance = gInstances[gInstanceIndex];
+	const SMaterial material = gMaterials[instance.material];
+
 	float3 n            = normalize(input.worldNormal);
 	float3 worldTangent = normalize(input.worldTangent);
 
@@ -464,16 +494,16 @@ float4 PSMain(NormalMappingPixelShaderInput input) : SV_TARGET
 	const float3 tangentSpaceV = mul(v, transpose(tangentMatrix));
 
 	// Calculate the offset uv coordinate for the lighting calculations
-	if (gHasDisplacementMap)
-		input.uv = ParallaxMapping(input.uv, tangentSpaceV);
+	if (material.flags & HasDisplacement)
+		input.uv = ParallaxMapping(material, input.uv, tangentSpaceV);
 
 	// Get the texture normal from the normal map. The r,g,b pixel values actually store x,y,z components of a normal. However, r,g,b
 	// values are stored in the range 0->1, whereas the x, y & z components should be in the range -1->1. So some scaling is needed
 
-	if(gHasNormalMap)
+	if((material.flags & HasNormal) && (instance.flags & InstanceTangents))
     {
 		// Get normal from normal map, convert from tangent space to world space
-        float3 tangentSpaceN = normalize(NormalMap.Sample(TexSampler, input.uv).xyz * 2.0f - 1.0f);
+        float3 tangentSpaceN = normalize(UnpackNormal(gTextures[material.normal].Sample(TexSampler, input.uv).rg));
         tangentSpaceN.y = -tangentSpaceN.y; // All the normal maps have Y up, but to make a LHS with Z outwards and X rightwards, then Y should be down
         n = mul(tangentSpaceN, tangentMatrix);
     }
@@ -482,15 +512,23 @@ float4 PSMain(NormalMappingPixelShaderInput input) : SV_TARGET
 	///////////////////////
 	// Texture Sampling
 
+	// The maps that are missing are not sampled, their index is not a texture
+	float4 albedoMap = float4(1, 1, 1, 1);
+	if (material.flags & HasAlbedo)
+		albedoMap = gTextures[material.albedo].Sample(TexSampler, input.uv);
+
 	// Check for the opacity 
-	if (!AlbedoMap.Sample(TexSampler, input.uv).a)
+	if (!albedoMap.a)
 		discard;
 
-	//Sample the albedo
-	const float3 albedo    = AlbedoMap.Sample(TexSampler, input.uv).rgb;
-	const float  roughness = lerp(gRoughness, RoughnessMap.Sample(TexSampler, input.uv).r, gHasRoughnessMap && !gUseCustomVaues);
-	const float  ao        = lerp(1.0f, AoMap.Sample(TexSampler, input.uv).r, gHasAoMap);
-	const float  metalness = lerp(gMetalness, MetalnessMap.Sample(TexSampler, input.uv).r, gHasMetallnessMap && !gUseCustomVaues);
+	float3 orm = float3(1.0f, 0.5f, 0.0f);
+	if (material.flags & (HasAo | HasRoughness | HasMetalness))
+		orm = gTextures[material.orm].Sample(TexSampler, input.uv).rgb;
+
+	const float3 albedo    = albedoMap.rgb;
+	const float  roughness = material.flags & HasRoughness ? orm.g : material.roughness;
+	const float  ao        = material.flags & HasAo ? orm.r : 1.0f;
+	const float  metalness = material.flags & HasMetalness ? orm.b : material.metalness;
 
 	///////////////////////
 	// Global illumination
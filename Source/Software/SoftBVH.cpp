@@ -0,0 +1,682 @@
+#include "SoftBVH.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include "../Math/CVector4.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define SOFT_SSE2 1
+#include <emmintrin.h>
+#else
+#define SOFT_SSE2 0
+#endif
+
+namespace Software
+{
+	namespace
+	{
+		constexpr unsigned int NumBins      = 12;
+		constexpr unsigned int MaxLeafSize  = 16; // Leaves can be bigger than the requested size if splitting does not pay off
+		constexpr unsigned int MaxDepth     = 60; // Bounds the traversal stack
+		constexpr unsigned int StackSize    = 64;
+
+		constexpr float MaxFloat = std::numeric_limits<float>::max();
+
+		struct SBox
+		{
+			CVector3 min = { MaxFloat, MaxFloat, MaxFloat };
+			CVector3 max = { -MaxFloat, -MaxFloat, -MaxFloat };
+
+			void Grow(const CVector3& p)
+			{
+				min = { std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z) };
+				max = { std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z) };
+			}
+
+			void Grow(const SBox& b)
+			{
+				Grow(b.min);
+				Grow(b.max);
+			}
+
+			float Area() const
+			{
+				if (min.x > max.x) return 0;
+				const auto e = max - min;
+				return e.x * e.y + e.y * e.z + e.z * e.x;
+			}
+		};
+
+		float Axis(const CVector3& v, int axis)
+		{
+			return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+		}
+
+		// Binned SAH build over the bounds of the primitives. order receives the primitive of every leaf slot
+		void BuildNodes(const std::vector<SBox>& boxes, unsigned int leafSize, std::vector<SSoftBVHNode>& nodes, std::vector<unsigned int>& order)
+		{
+			const auto count = static_cast<unsigned int>(boxes.size());
+
+			order.resize(count);
+			std::iota(order.begin(), order.end(), 0u);
+
+			std::vector<CVector3> centres(count);
+			for (unsigned int i = 0; i < count; ++i) centres[i] = (boxes[i].min + boxes[i].max) * 0.5f;
+
+			auto setBounds = [&](SSoftBVHNode& node)
+			{
+				SBox box;
+				for (unsigned int i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i) box.Grow(boxes[order[i]]);
+				node.boundsMin = box.min;
+				node.boundsMax = box.max;
+			};
+
+			nodes.clear();
+			nodes.reserve(size_t(std::max(count, 1u)) * 2);
+			nodes.push_back({ {}, 0, {}, count });
+			setBounds(nodes.back());
+
+			struct SEntry { unsigned int node, depth; };
+			std::vector<SEntry> stack{ { 0, 0 } };
+
+			while (!stack.empty())
+			{
+				const auto [index, depth] = stack.back();
+				stack.pop_back();
+
+				const auto node = nodes[index];
+				if (node.count <= leafSize || depth >= MaxDepth) continue;
+
+				const auto first = node.leftOrFirst;
+				const auto last = first + node.count;
+
+				SBox centreBox;
+				for (auto i = first; i < last; ++i) centreBox.Grow(centres[order[i]]);
+
+				int   bestAxis = -1;
+				auto  bestSplit = 0u;
+				float bestCost = MaxFloat;
+
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					const float axisMin = Axis(centreBox.min, axis);
+					const float extent = Axis(centreBox.max, axis) - axisMin;
+					if (extent <= 0) continue;
+
+					const float scale = NumBins / extent;
+
+					SBox         bins[NumBins];
+					unsigned int binCounts[NumBins] = {};
+
+					for (auto i = first; i < last; ++i)
+					{
+						const auto p = order[i];
+						const auto b = std::min(NumBins - 1, static_cast<unsigned int>((Axis(centres[p], axis) - axisMin) * scale));
+						++binCounts[b];
+						bins[b].Grow(boxes[p]);
+					}
+
+					float        leftArea[NumBins - 1];
+					unsigned int leftCount[NumBins - 1];
+					SBox         left;
+					unsigned int leftSum = 0;
+					for (unsigned int b = 0; b < NumBins - 1; ++b)
+					{
+						leftSum += binCounts[b];
+						if (binCounts[b]) left.Grow(bins[b]);
+						leftArea[b] = left.Area();
+						leftCount[b] = leftSum;
+					}
+
+					SBox         right;
+					unsigned int rightSum = 0;
+					for (unsigned int b = NumBins - 1; b > 0; --b)
+					{
+						rightSum += binCounts[b];
+						if (binCounts[b]) right.Grow(bins[b]);
+
+						const float cost = leftCount[b - 1] * leftArea[b - 1] + rightSum * right.Area();
+						if (cost < bestCost)
+						{
+							bestCost = cost;
+							bestAxis = axis;
+							bestSplit = b;
+						}
+					}
+				}
+
+				SBox nodeBox;
+				nodeBox.min = node.boundsMin;
+				nodeBox.max = node.boundsMax;
+				const float leafCost = node.count * nodeBox.Area();
+
+				if (bestAxis >= 0 && bestCost >= leafCost && node.count <= MaxLeafSize) continue;
+
+				unsigned int mid = first;
+
+				if (bestAxis >= 0)
+				{
+					const float axisMin = Axis(centreBox.min, bestAxis);
+					const float scale = NumBins / (Axis(centreBox.max, bestAxis) - axisMin);
+
+					mid = static_cast<unsigned int>(std::partition(order.begin() + first, order.begin() + last, [&](unsigned int p)
+						{
+							return std::min(NumBins - 1, static_cast<unsigned int>((Axis(centres[p], bestAxis) - axisMin) * scale)) < bestSplit;
+						}) - order.begin());
+				}
+
+				// All the centres in the same place, split in the middle
+				if (mid == first || mid == last) mid = first + node.count / 2;
+
+				const auto leftIndex = static_cast<unsigned int>(nodes.size());
+				nodes.push_back({ {}, first, {}, mid - first });
+				setBounds(nodes.back());
+				nodes.push_back({ {}, mid, {}, last - mid });
+				setBounds(nodes.back());
+
+				nodes[index].leftOrFirst = leftIndex;
+				nodes[index].count = 0;
+
+				stack.push_back({ leftIndex, depth + 1 });
+				stack.push_back({ leftIndex + 1, depth + 1 });
+			}
+		}
+
+		bool HitsBox(const CVector3& o, const CVector3& invD, float tMin, float tMax, const SSoftBVHNode& node, float& tNear)
+		{
+			const float tx1 = (node.boundsMin.x - o.x) * invD.x, tx2 = (node.boundsMax.x - o.x) * invD.x;
+			const float ty1 = (node.boundsMin.y - o.y) * invD.y, ty2 = (node.boundsMax.y - o.y) * invD.y;
+			const float tz1 = (node.boundsMin.z - o.z) * invD.z, tz2 = (node.boundsMax.z - o.z) * invD.z;
+
+			tNear = std::max({ std::min(tx1, tx2), std::min(ty1, ty2), std::min(tz1, tz2) });
+			const float tFar = std::min({ std::max(tx1, tx2), std::max(ty1, ty2), std::max(tz1, tz2) });
+
+			return tFar >= std::max(tNear, tMin) && tNear <= tMax;
+		}
+
+		// Front to back traversal, leaf(first, count) returns true to end the search
+		template <class F>
+		void Traverse(const std::vector<SSoftBVHNode>& nodes, const CVector3& o, const CVector3& d, float tMin, const float& tMax, F&& leaf)
+		{
+			const CVector3 invD = { 1.0f / d.x, 1.0f / d.y, 1.0f / d.z };
+
+			unsigned int stack[StackSize];
+			unsigned int stackSize = 0;
+
+			float tNear;
+			if (!HitsBox(o, invD, tMin, tMax, nodes[0], tNear)) return;
+
+			unsigned int index = 0;
+
+			while (true)
+			{
+				const auto& node = nodes[index];
+
+				if (node.count)
+				{
+					if (leaf(node.leftOrFirst, node.count)) return;
+				}
+				else
+				{
+					float      tLeft, tRight;
+					const bool hitLeft = HitsBox(o, invD, tMin, tMax, nodes[node.leftOrFirst], tLeft);
+					const bool hitRight = HitsBox(o, invD, tMin, tMax, nodes[node.leftOrFirst + 1], tRight);
+
+					if (hitLeft && hitRight)
+					{
+						const bool leftFirst = tLeft <= tRight;
+						stack[stackSize++] = leftFirst ? node.leftOrFirst + 1 : node.leftOrFirst;
+						index = leftFirst ? node.leftOrFirst : node.leftOrFirst + 1;
+						continue;
+					}
+
+					if (hitLeft || hitRight)
+					{
+						index = hitLeft ? node.leftOrFirst : node.leftOrFirst + 1;
+						continue;
+					}
+				}
+
+				if (!stackSize) return;
+				index = stack[--stackSize];
+			}
+		}
+
+		//--------------------------------------------------------------------------------------
+		// 4 wide helpers for the packets, comparisons return lane bit masks
+		//--------------------------------------------------------------------------------------
+
+#if SOFT_SSE2
+		struct F4 { __m128 v; };
+
+		F4 Load4(const float* p) { return { _mm_loadu_ps(p) }; }
+		F4 Set4(float f) { return { _mm_set1_ps(f) }; }
+		void Store4(float* p, F4 a) { _mm_storeu_ps(p, a.v); }
+
+		F4 operator+(F4 a, F4 b) { return { _mm_add_ps(a.v, b.v) }; }
+		F4 operator-(F4 a, F4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+		F4 operator*(F4 a, F4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+		F4 operator/(F4 a, F4 b) { return { _mm_div_ps(a.v, b.v) }; }
+		F4 Min4(F4 a, F4 b) { return { _mm_min_ps(a.v, b.v) }; }
+		F4 Max4(F4 a, F4 b) { return { _mm_max_ps(a.v, b.v) }; }
+
+		int Ge(F4 a, F4 b) { return _mm_movemask_ps(_mm_cmpge_ps(a.v, b.v)); }
+		int Gt(F4 a, F4 b) { return _mm_movemask_ps(_mm_cmpgt_ps(a.v, b.v)); }
+		int Le(F4 a, F4 b) { return _mm_movemask_ps(_mm_cmple_ps(a.v, b.v)); }
+		int Lt(F4 a, F4 b) { return _mm_movemask_ps(_mm_cmplt_ps(a.v, b.v)); }
+#else
+		struct F4 { float v[4]; };
+
+		template <class Op>
+		F4 Apply(F4 a, F4 b, Op op) { return { op(a.v[0], b.v[0]), op(a.v[1], b.v[1]), op(a.v[2], b.v[2]), op(a.v[3], b.v[3]) }; }
+
+		template <class Op>
+		int Compare(F4 a, F4 b, Op op) { return int(op(a.v[0], b.v[0])) | int(op(a.v[1], b.v[1])) << 1 | int(op(a.v[2], b.v[2])) << 2 | int(op(a.v[3], b.v[3])) << 3; }
+
+		F4 Load4(const float* p) { return { p[0], p[1], p[2], p[3] }; }
+		F4 Set4(float f) { return { f, f, f, f }; }
+		void Store4(float* p, F4 a) { std::copy(a.v, a.v + 4, p); }
+
+		F4 operator+(F4 a, F4 b) { return Apply(a, b, [](float x, float y) { return x + y; }); }
+		F4 operator-(F4 a, F4 b) { return Apply(a, b, [](float x, float y) { return x - y; }); }
+		F4 operator*(F4 a, F4 b) { return Apply(a, b, [](float x, float y) { return x * y; }); }
+		F4 operator/(F4 a, F4 b) { return Apply(a, b, [](float x, float y) { return x / y; }); }
+		F4 Min4(F4 a, F4 b) { return Apply(a, b, [](float x, float y) { return std::min(x, y); }); }
+		F4 Max4(F4 a, F4 b) { return Apply(a, b, [](float x, float y) { return std::max(x, y); }); }
+
+		int Ge(F4 a, F4 b) { return Compare(a, b, [](float x, float y) { return x >= y; }); }
+		int Gt(F4 a, F4 b) { return Compare(a, b, [](float x, float y) { return x > y; }); }
+		int Le(F4 a, F4 b) { return Compare(a, b, [](float x, float y) { return x <= y; }); }
+		int Lt(F4 a, F4 b) { return Compare(a, b, [](float x, float y) { return x < y; }); }
+#endif
+
+		struct SPacket4
+		{
+			F4 ox, oy, oz;
+			F4 dx, dy, dz;
+			F4 invDx, invDy, invDz;
+			F4 tMin;
+
+			explicit SPacket4(const SSoftRayPacket& p) :
+				ox(Load4(p.ox)), oy(Load4(p.oy)), oz(Load4(p.oz)),
+				dx(Load4(p.dx)), dy(Load4(p.dy)), dz(Load4(p.dz)),
+				invDx(Set4(1) / dx), invDy(Set4(1) / dy), invDz(Set4(1) / dz),
+				tMin(Load4(p.tMin))
+			{
+			}
+		};
+
+		// Lanes of the active mask that hit the box, and the nearest entry distance of those lanes
+		int PacketHitsBox(const SPacket4& p, const F4& tMax, const SSoftBVHNode& node, int active, float& nearest)
+		{
+			const F4 tx1 = (Set4(node.boundsMin.x) - p.ox) * p.invDx, tx2 = (Set4(node.boundsMax.x) - p.ox) * p.invDx;
+			const F4 ty1 = (Set4(node.boundsMin.y) - p.oy) * p.invDy, ty2 = (Set4(node.boundsMax.y) - p.oy) * p.invDy;
+			const F4 tz1 = (Set4(node.boundsMin.z) - p.oz) * p.invDz, tz2 = (Set4(node.boundsMax.z) - p.oz) * p.invDz;
+
+			const F4 tNear = Max4(Max4(Min4(tx1, tx2), Min4(ty1, ty2)), Min4(tz1, tz2));
+			const F4 tFar = Min4(Min4(Max4(tx1, tx2), Max4(ty1, ty2)), Max4(tz1, tz2));
+
+			const int mask = Ge(tFar, Max4(tNear, p.tMin)) & Le(tNear, tMax) & active;
+
+			if (mask)
+			{
+				float t[4];
+				Store4(t, tNear);
+				nearest = MaxFloat;
+				for (int lane = 0; lane < 4; ++lane)
+					if (mask & (1 << lane)) nearest = std::min(nearest, t[lane]);
+			}
+
+			return mask;
+		}
+
+		// Front to back traversal for packets, leaf(first, count, mask) tests the lanes in mask
+		template <class F>
+		void TraversePacket(const std::vector<SSoftBVHNode>& nodes, SSoftRayPacket& packet, F&& leaf)
+		{
+			const SPacket4 p(packet);
+
+			struct SEntry { unsigned int node; int mask; };
+			SEntry       stack[StackSize];
+			unsigned int stackSize = 0;
+
+			float nearest;
+			int   mask = PacketHitsBox(p, Load4(packet.tMax), nodes[0], packet.active, nearest);
+			if (!mask) return;
+
+			unsigned int index = 0;
+
+			while (true)
+			{
+				const auto& node = nodes[index];
+
+				// Lanes may have finished or hit something closer since the node was pushed
+				mask &= packet.active;
+
+				if (mask)
+				{
+					if (node.count)
+					{
+						leaf(node.leftOrFirst, node.count, mask);
+					}
+					else
+					{
+						const F4 tMax = Load4(packet.tMax);
+
+						float     tLeft = 0, tRight = 0;
+						const int maskLeft = PacketHitsBox(p, tMax, nodes[node.leftOrFirst], mask, tLeft);
+						const int maskRight = PacketHitsBox(p, tMax, nodes[node.leftOrFirst + 1], mask, tRight);
+
+						if (maskLeft && maskRight)
+						{
+							const bool leftFirst = tLeft <= tRight;
+							stack[stackSize++] = leftFirst ? SEntry{ node.leftOrFirst + 1, maskRight } : SEntry{ node.leftOrFirst, maskLeft };
+							index = leftFirst ? node.leftOrFirst : node.leftOrFirst + 1;
+							mask = leftFirst ? maskLeft : maskRight;
+							continue;
+						}
+
+						if (maskLeft || maskRight)
+						{
+							index = maskLeft ? node.leftOrFirst : node.leftOrFirst + 1;
+							mask = maskLeft ? maskLeft : maskRight;
+							continue;
+						}
+					}
+				}
+
+				if (!stackSize) return;
+				--stackSize;
+				index = stack[stackSize].node;
+				mask = stack[stackSize].mask;
+			}
+		}
+
+		SSoftRay TransformRay(const SSoftRay& ray, const CMatrix4x4& m)
+		{
+			SSoftRay r = ray;
+			r.origin = CVector3(CVector4(ray.origin, 1) * m);
+			r.direction = CVector3(CVector4(ray.direction, 0) * m);
+			return r;
+		}
+	}
+
+	void SSoftRayPacket::Set(int lane, const SSoftRay& ray)
+	{
+		ox[lane] = ray.origin.x;
+		oy[lane] = ray.origin.y;
+		oz[lane] = ray.origin.z;
+		dx[lane] = ray.direction.x;
+		dy[lane] = ray.direction.y;
+		dz[lane] = ray.direction.z;
+		tMin[lane] = ray.tMin;
+		tMax[lane] = ray.tMax;
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Bottom level
+	//--------------------------------------------------------------------------------------
+
+	CSoftBVH::CSoftBVH(std::vector<SGeometry> geometries) :
+		mGeometries(std::move(geometries))
+	{
+		std::vector<STriangle> triangles;
+		std::vector<SBox>      boxes;
+
+		for (unsigned int g = 0; g < mGeometries.size(); ++g)
+		{
+			const auto& positions = *mGeometries[g].positions;
+			const auto& indices = *mGeometries[g].indices;
+
+			for (unsigned int i = 0; i + 2 < indices.size(); i += 3)
+			{
+				const auto& a = positions[indices[i]];
+				const auto& b = positions[indices[i + 1]];
+				const auto& c = positions[indices[i + 2]];
+
+				triangles.push_back({ a, b - a, c - a, g, i / 3 });
+
+				SBox box;
+				box.Grow(a);
+				box.Grow(b);
+				box.Grow(c);
+				boxes.push_back(box);
+			}
+		}
+
+		std::vector<unsigned int> order;
+		BuildNodes(boxes, 4, mNodes, order);
+
+		mTriangles.resize(triangles.size());
+		for (size_t i = 0; i < order.size(); ++i) mTriangles[i] = triangles[order[i]];
+	}
+
+	bool CSoftBVH::Intersect(const SSoftRay& ray, unsigned int flags, SSoftHit& hit) const
+	{
+		const auto& o = ray.origin;
+		const auto& d = ray.direction;
+		const bool  cull = flags & SoftRayFlagCullBackFacing;
+
+		float tMax = ray.tMax;
+		bool  found = false;
+
+		Traverse(mNodes, o, d, ray.tMin, tMax, [&](unsigned int first, unsigned int count)
+			{
+				for (auto i = first; i < first + count; ++i)
+				{
+					const auto& tri = mTriangles[i];
+
+					// Moller-Trumbore, det > 0 for the clockwise (front) faces
+					const auto  pvec = Cross(d, tri.e2);
+					const float det = Dot(tri.e1, pvec);
+					if (cull ? det <= 0 : det == 0) continue;
+
+					const float invDet = 1.0f / det;
+					const auto  tvec = o - tri.v0;
+					const float u = Dot(tvec, pvec) * invDet;
+					if (u < 0 || u > 1) continue;
+
+					const auto  qvec = Cross(tvec, tri.e1);
+					const float v = Dot(d, qvec) * invDet;
+					if (v < 0 || u + v > 1) continue;
+
+					const float t = Dot(tri.e2, qvec) * invDet;
+					if (t < ray.tMin || t >= tMax) continue;
+
+					tMax = t;
+					found = true;
+					hit.t = t;
+					hit.bary = { u, v };
+					hit.geometry = tri.geometry;
+					hit.primitive = tri.primitive;
+
+					if (flags & SoftRayFlagAcceptFirstHit) return true;
+				}
+				return false;
+			});
+
+		return found;
+	}
+
+	void CSoftBVH::Intersect(SSoftRayPacket& packet, unsigned int flags) const
+	{
+		const bool cull = flags & SoftRayFlagCullBackFacing;
+
+		TraversePacket(mNodes, packet, [&](unsigned int first, unsigned int count, int mask)
+			{
+				const F4 ox = Load4(packet.ox), oy = Load4(packet.oy), oz = Load4(packet.oz);
+				const F4 dx = Load4(packet.dx), dy = Load4(packet.dy), dz = Load4(packet.dz);
+				const F4 tMin = Load4(packet.tMin);
+				const F4 zero = Set4(0), one = Set4(1);
+
+				for (auto i = first; i < first + count && mask; ++i)
+				{
+					const auto& tri = mTriangles[i];
+
+					const F4 e1x = Set4(tri.e1.x), e1y = Set4(tri.e1.y), e1z = Set4(tri.e1.z);
+					const F4 e2x = Set4(tri.e2.x), e2y = Set4(tri.e2.y), e2z = Set4(tri.e2.z);
+
+					const F4 px = dy * e2z - dz * e2y;
+					const F4 py = dz * e2x - dx * e2z;
+					const F4 pz = dx * e2y - dy * e2x;
+
+					const F4 det = e1x * px + e1y * py + e1z * pz;
+
+					int valid = mask & (cull ? Gt(det, zero) : (Gt(det, zero) | Lt(det, zero)));
+					if (!valid) continue;
+
+					const F4 invDet = one / det;
+
+					const F4 tx = ox - Set4(tri.v0.x), ty = oy - Set4(tri.v0.y), tz = oz - Set4(tri.v0.z);
+
+					const F4 u = (tx * px + ty * py + tz * pz) * invDet;
+					valid &= Ge(u, zero) & Le(u, one);
+					if (!valid) continue;
+
+					const F4 qx = ty * e1z - tz * e1y;
+					const F4 qy = tz * e1x - tx * e1z;
+					const F4 qz = tx * e1y - ty * e1x;
+
+					const F4 v = (dx * qx + dy * qy + dz * qz) * invDet;
+					valid &= Ge(v, zero) & Le(u + v, one);
+					if (!valid) continue;
+
+					const F4 t = (e2x * qx + e2y * qy + e2z * qz) * invDet;
+					valid &= Ge(t, tMin) & Lt(t, Load4(packet.tMax));
+					if (!valid) continue;
+
+					float ts[4], us[4], vs[4];
+					Store4(ts, t);
+					Store4(us, u);
+					Store4(vs, v);
+
+					for (int lane = 0; lane < 4; ++lane)
+					{
+						if (!(valid & (1 << lane))) continue;
+
+						packet.tMax[lane] = ts[lane];
+						packet.hits[lane].t = ts[lane];
+						packet.hits[lane].bary = { us[lane], vs[lane] };
+						packet.hits[lane].geometry = tri.geometry;
+						packet.hits[lane].primitive = tri.primitive;
+					}
+
+					packet.hit |= valid;
+
+					if (flags & SoftRayFlagAcceptFirstHit)
+					{
+						packet.active &= ~valid;
+						mask &= ~valid;
+					}
+				}
+			});
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Top level
+	//--------------------------------------------------------------------------------------
+
+	void CSoftTLAS::Build(const std::vector<SInstance>& instances)
+	{
+		mInstances.clear();
+		mInstances.reserve(instances.size());
+
+		std::vector<SBox> boxes;
+		boxes.reserve(instances.size());
+
+		for (const auto& instance : instances)
+		{
+			mInstances.push_back({ instance.blas, instance.worldMatrix, InverseAffine(instance.worldMatrix) });
+
+			// World bounds of the mesh bounds
+			SBox        box;
+			const auto& bMin = instance.blas->BoundsMin();
+			const auto& bMax = instance.blas->BoundsMax();
+			for (int corner = 0; corner < 8; ++corner)
+			{
+				const CVector3 p = { corner & 1 ? bMax.x : bMin.x, corner & 2 ? bMax.y : bMin.y, corner & 4 ? bMax.z : bMin.z };
+				box.Grow(CVector3(CVector4(p, 1) * instance.worldMatrix));
+			}
+			boxes.push_back(box);
+		}
+
+		BuildNodes(boxes, 1, mNodes, mOrder);
+	}
+
+	bool CSoftTLAS::Intersect(const SSoftRay& ray, unsigned int flags, SSoftHit& hit) const
+	{
+		if (mInstances.empty()) return false;
+
+		float tMax = ray.tMax;
+		bool  found = false;
+
+		Traverse(mNodes, ray.origin, ray.direction, ray.tMin, tMax, [&](unsigned int first, unsigned int count)
+			{
+				for (auto i = first; i < first + count; ++i)
+				{
+					const auto  instance = mOrder[i];
+					const auto& placed = mInstances[instance];
+
+					// The transform is affine so the distances along the ray are the same in mesh space
+					auto local = TransformRay(ray, placed.inverseMatrix);
+					local.tMax = tMax;
+
+					if (placed.blas->Intersect(local, flags, hit))
+					{
+						tMax = hit.t;
+						hit.instance = instance;
+						found = true;
+
+						if (flags & SoftRayFlagAcceptFirstHit) return true;
+					}
+				}
+				return false;
+			});
+
+		return found;
+	}
+
+	void CSoftTLAS::Intersect(SSoftRayPacket& packet, unsigned int flags) const
+	{
+		if (mInstances.empty()) return;
+
+		TraversePacket(mNodes, packet, [&](unsigned int first, unsigned int count, int mask)
+			{
+				for (auto i = first; i < first + count; ++i)
+				{
+					const auto  instance = mOrder[i];
+					const auto& placed = mInstances[instance];
+
+					SSoftRayPacket local;
+					local.active = mask & packet.active;
+					for (int lane = 0; lane < 4; ++lane)
+					{
+						SSoftRay ray;
+						ray.origin = { packet.ox[lane], packet.oy[lane], packet.oz[lane] };
+						ray.direction = { packet.dx[lane], packet.dy[lane], packet.dz[lane] };
+						ray.tMin = packet.tMin[lane];
+						ray.tMax = packet.tMax[lane];
+						local.Set(lane, TransformRay(ray, placed.inverseMatrix));
+					}
+
+					placed.blas->Intersect(local, flags);
+
+					for (int lane = 0; lane < 4; ++lane)
+					{
+						if (!(local.hit & (1 << lane))) continue;
+
+						packet.tMax[lane] = local.tMax[lane];
+						packet.hits[lane] = local.hits[lane];
+						packet.hits[lane].instance = instance;
+					}
+
+					packet.hit |= local.hit;
+
+					if (flags & SoftRayFlagAcceptFirstHit) packet.active &= ~local.hit;
+				}
+			});
+	}
+}
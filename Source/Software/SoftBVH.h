@@ -0,0 +1,156 @@
+//--------------------------------------------------------------------------------------
+// Bounding volume hierarchies for the CPU ray tracer
+//--------------------------------------------------------------------------------------
+// Same split as the DXR acceleration structures: a bottom level BVH per mesh, built once
+// over the mesh space triangles, and a top level BVH over the placed instances, rebuilt
+// whenever the instances move. Both are binned SAH builds, flattened with the children of
+// a node next to each other.
+// Rays follow the DXR conventions: front faces are clockwise seen from the ray origin, the
+// barycentrics are the weights of the second and third vertex, and the direction does not
+// need to be normalised.
+
+#pragma once
+
+#include <vector>
+
+#include "../Math/CMatrix4x4.h"
+#include "../Math/CVector2.h"
+#include "../Math/CVector3.h"
+
+namespace Software
+{
+	enum ESoftRayFlags : unsigned int
+	{
+		SoftRayFlagNone           = 0,
+		SoftRayFlagCullBackFacing = 1 << 0, // RAY_FLAG_CULL_BACK_FACING_TRIANGLES
+		SoftRayFlagAcceptFirstHit = 1 << 1, // RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH
+	};
+
+	struct SSoftRay
+	{
+		CVector3 origin    = { 0,0,0 };
+		CVector3 direction = { 0,0,1 };
+		float    tMin      = 0;
+		float    tMax      = 10000;
+	};
+
+	struct SSoftHit
+	{
+		float        t        = 0;
+		CVector2     bary     = { 0,0 };
+		unsigned int geometry = 0; // Sub-mesh of the bottom level BVH
+		unsigned int primitive = 0; // Triangle of the sub-mesh
+		unsigned int instance = 0; // Only set by the top level BVH
+	};
+
+	// 4 rays traced together, structure of arrays so the tests run 4 wide
+	struct SSoftRayPacket
+	{
+		float ox[4], oy[4], oz[4];
+		float dx[4], dy[4], dz[4];
+		float tMin[4], tMax[4];
+
+		int active = 0xF; // Lanes in use, tMax shrinks as the lanes hit
+		int hit    = 0;   // Lanes that hit something
+
+		SSoftHit hits[4];
+
+		void Set(int lane, const SSoftRay& ray);
+	};
+
+	struct SSoftBVHNode
+	{
+		CVector3     boundsMin;
+		unsigned int leftOrFirst; // First child if an inner node, first primitive if a leaf
+		CVector3     boundsMax;
+		unsigned int count;       // 0 for inner nodes
+	};
+
+	// Bottom level
+	class CSoftBVH
+	{
+	public:
+
+		// Vertex data of a sub-mesh, referenced and not copied so it has to outlive the BVH
+		struct SGeometry
+		{
+			const std::vector<CVector3>*     positions = nullptr;
+			const std::vector<CVector3>*     normals   = nullptr;
+			const std::vector<CVector3>*     tangents  = nullptr; // Optional
+			const std::vector<CVector2>*     uvs       = nullptr; // Optional
+			const std::vector<unsigned int>* indices   = nullptr;
+		};
+
+		CSoftBVH() = delete;
+		CSoftBVH(const CSoftBVH&) = delete;
+		CSoftBVH(const CSoftBVH&&) = delete;
+		CSoftBVH& operator=(const CSoftBVH&) = delete;
+		CSoftBVH& operator=(const CSoftBVH&&) = delete;
+
+		explicit CSoftBVH(std::vector<SGeometry> geometries);
+
+		// Closest hit (or any hit with SoftRayFlagAcceptFirstHit) before ray.tMax, the hit is only written if there is one
+		bool Intersect(const SSoftRay& ray, unsigned int flags, SSoftHit& hit) const;
+
+		// Packet version, updates tMax, hit and hits of the lanes that hit
+		void Intersect(SSoftRayPacket& packet, unsigned int flags) const;
+
+		const SGeometry& Geometry(unsigned int index) const { return mGeometries[index]; }
+		size_t           NumGeometries() const { return mGeometries.size(); }
+
+		const CVector3& BoundsMin() const { return mNodes.front().boundsMin; }
+		const CVector3& BoundsMax() const { return mNodes.front().boundsMax; }
+
+		size_t NumTriangles() const { return mTriangles.size(); }
+
+	private:
+
+		// Precomputed for the Moller-Trumbore test, in BVH leaf order
+		struct STriangle
+		{
+			CVector3     v0, e1, e2;
+			unsigned int geometry;
+			unsigned int primitive;
+		};
+
+		std::vector<SGeometry>    mGeometries;
+		std::vector<STriangle>    mTriangles;
+		std::vector<SSoftBVHNode> mNodes;
+	};
+
+	// Top level
+	class CSoftTLAS
+	{
+	public:
+
+		struct SInstance
+		{
+			const CSoftBVH* blas = nullptr;
+			CMatrix4x4      worldMatrix;
+		};
+
+		// Rebuild over the given instances, the hit instance index is the index in this vector
+		void Build(const std::vector<SInstance>& instances);
+
+		bool Intersect(const SSoftRay& ray, unsigned int flags, SSoftHit& hit) const;
+
+		void Intersect(SSoftRayPacket& packet, unsigned int flags) const;
+
+		const CMatrix4x4& WorldMatrix(unsigned int instance) const { return mInstances[instance].worldMatrix; }
+
+		bool Empty() const { return mInstances.empty(); }
+
+	private:
+
+		struct SPlacedInstance
+		{
+			const CSoftBVH* blas;
+			CMatrix4x4      worldMatrix;
+			CMatrix4x4      inverseMatrix;
+		};
+
+		std::vector<SPlacedInstance> mInstances;
+		std::vector<unsigned int>    mOrder; // Instance of every leaf slot
+		std::vector<SSoftBVHNode>    mNodes;
+	};
+}
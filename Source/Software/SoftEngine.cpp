@@ -0,0 +1,365 @@
+#include "SoftEngine.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "DirectXTex.h"
+
+#include "../Null/NullMesh.h"
+#include "../Null/Objects/NullGameObject.h"
+#include "../Common/AssetCache.h"
+#include "../Common/Camera.h"
+#include "../Common/CGameObjectManager.h"
+#include "../Common/CLight.h"
+#include "../Common/CScene.h"
+#include "../Math/MathHelpers.h"
+
+namespace Software
+{
+	CSoftEngine::CSoftEngine(std::string mediaFolder, UINT width, UINT height, unsigned int numThreads) :
+		CNullEngine(std::move(mediaFolder), width, height)
+	{
+		// The rasterizer needs the vertices, not only the bounds
+		mKeepGeometry = true;
+
+		mRasterizer = std::make_unique<CSoftRasterizer>(width, height, numThreads);
+		mRayTracer = std::make_unique<CSoftRayTracer>(width, height, numThreads);
+	}
+
+	CSoftEngine::~CSoftEngine()
+	{
+		// Objects go before the textures and the renderers
+		mScene = nullptr;
+	}
+
+	void CSoftEngine::Resize(UINT x, UINT y)
+	{
+		CNullEngine::Resize(x, y);
+		mRasterizer->Resize(x, y);
+		mRayTracer->Resize(x, y);
+	}
+
+	void CSoftEngine::FinalizeFrame()
+	{
+		if (mScene && mScene->GetCamera())
+		{
+			if (mRenderMode == ESoftRenderMode::Raster)
+			{
+				BuildFrame();
+				mRasterizer->Render(mFrame);
+			}
+			else
+			{
+				const auto camera = mScene->GetCamera();
+
+				BuildTraceScene();
+				mRayTracer->SetScene(mTraceScene);
+				mRayTracer->Render(camera->WorldMatrix(), camera->ProjectionMatrix());
+			}
+		}
+
+		CNullEngine::FinalizeFrame();
+	}
+
+	void CSoftEngine::WriteImage(const std::string& fileName) const
+	{
+		Image().Write(fileName);
+	}
+
+	CSoftImage CSoftEngine::Image() const
+	{
+		return mRenderMode == ESoftRenderMode::Raster ? mRasterizer->Image() : mRayTracer->Image();
+	}
+
+	void CSoftEngine::BuildFrame()
+	{
+		const auto camera = mScene->GetCamera();
+
+		mFrame.viewProjectionMatrix = camera->ViewProjectionMatrix();
+		mFrame.cameraPosition = camera->Position();
+		mFrame.ambientColour = mScene->GetAmbientColour();
+
+		const auto& background = mScene->GetBackgroundCol();
+		mFrame.backgroundColour = { background.r, background.g, background.b };
+
+		// Lights, same values as the DX12 light buffers
+		mFrame.lights.clear();
+
+		for (const auto light : mObjManager->mLights)
+		{
+			if (!*light->Enabled()) continue;
+
+			SSoftLight l;
+			l.type = ESoftLightType::Point;
+			l.position = light->Position();
+			l.colour = light->GetColour();
+			l.intensity = light->GetStrength();
+			mFrame.lights.push_back(l);
+		}
+
+		for (const auto light : mObjManager->mSpotLights)
+		{
+			if (!*light->Enabled()) continue;
+
+			SSoftLight l;
+			l.type = ESoftLightType::Spot;
+			l.position = light->Position();
+			l.colour = light->GetColour();
+			l.intensity = light->GetStrength();
+			l.facing = Normalise(light->WorldMatrix().GetRow(2));
+			l.cosHalfAngle = std::cos(ToRadians(light->GetConeAngle() / 2));
+			mFrame.lights.push_back(l);
+		}
+
+		for (const auto light : mObjManager->mDirLights)
+		{
+			if (!*light->Enabled()) continue;
+
+			SSoftLight l;
+			l.type = ESoftLightType::Directional;
+			l.colour = light->GetColour();
+			l.intensity = light->GetStrength();
+			l.facing = light->Position();
+			mFrame.lights.push_back(l);
+		}
+
+		for (const auto light : mObjManager->mPointLights)
+		{
+			if (!*light->Enabled()) continue;
+
+			SSoftLight l;
+			l.type = ESoftLightType::Point;
+			l.position = light->Position();
+			l.colour = light->GetColour();
+			l.intensity = light->GetStrength();
+			mFrame.lights.push_back(l);
+		}
+
+		// Draws of the scene pass, the depth passes are only used for the shadows
+		mFrame.draws.clear();
+		mFrame.materials.clear();
+		mFrameMaterials.clear();
+
+		for (const auto& command : DrawCommands())
+		{
+			if (command.pass != Null::ENullPass::Scene) continue;
+
+			const auto& subMesh = command.mesh->SubMeshes()[command.subMesh];
+			if (subMesh.indices.empty()) continue;
+
+			auto [material, added] = mFrameMaterials.try_emplace(command.object, static_cast<unsigned int>(mFrame.materials.size()));
+			if (added) mFrame.materials.push_back(ObjectMaterial(command.object));
+
+			SSoftDraw draw;
+			draw.positions = &subMesh.positions;
+			draw.normals = &subMesh.normals;
+			draw.uvs = subMesh.uvs.empty() ? nullptr : &subMesh.uvs;
+			draw.indices = &subMesh.indices;
+			draw.worldMatrix = command.worldMatrix;
+			draw.material = material->second;
+			mFrame.draws.push_back(draw);
+		}
+	}
+
+	SSoftMaterial CSoftEngine::ObjectMaterial(CGameObject* object)
+	{
+		SSoftMaterial material;
+		material.roughness = object->Roughness();
+		material.metalness = object->Metalness();
+
+		// Same map selection as CDX12Material, a single texture is the albedo
+		if (const auto nullObject = dynamic_cast<Null::CNullGameObject*>(object))
+		{
+			const auto& textures = nullObject->TextureFiles();
+
+			if (textures.size() == 1)
+			{
+				material.albedo = Texture(textures.front());
+			}
+			else
+			{
+				for (const auto& texture : textures)
+				{
+					if (texture.find("Albedo") != std::string::npos)
+					{
+						material.albedo = Texture(texture);
+						break;
+					}
+				}
+			}
+		}
+
+		if (dynamic_cast<CSky*>(object))
+		{
+			// Seen from the inside
+			material.shading = ESoftShading::Unlit;
+			material.cullBack = false;
+		}
+		else if (const auto light = dynamic_cast<CLight*>(object))
+		{
+			material.shading = ESoftShading::Unlit;
+			material.tint = light->GetColour();
+		}
+		else if (dynamic_cast<CPlant*>(object))
+		{
+			material.cullBack = false;
+		}
+
+		return material;
+	}
+
+	void CSoftEngine::BuildTraceScene()
+	{
+		mTraceScene.instances.clear();
+		mTraceScene.materials.clear();
+
+		// Same instances as the DX12 top level acceleration structure: one per object, the whole
+		// mesh placed with the object world matrix (the node matrices are not used)
+		std::unordered_set<const Null::CNullMesh*> usedMeshes;
+
+		for (const auto object : mObjManager->mObjects)
+		{
+			const auto nullObject = dynamic_cast<Null::CNullGameObject*>(object);
+			if (!nullObject || !nullObject->Mesh()) continue;
+
+			const auto blas = MeshBVH(nullObject->Mesh());
+			usedMeshes.insert(nullObject->Mesh());
+			if (!blas->NumTriangles()) continue;
+
+			SSoftTraceInstance instance;
+			instance.blas = blas;
+			instance.worldMatrix = object->WorldMatrix();
+			instance.material = static_cast<unsigned int>(mTraceScene.materials.size());
+			mTraceScene.instances.push_back(instance);
+			mTraceScene.materials.push_back(ObjectTraceMaterial(object));
+		}
+
+		for (auto it = mMeshBVHs.begin(); it != mMeshBVHs.end();)
+		{
+			if (usedMeshes.count(it->first)) ++it;
+			else it = mMeshBVHs.erase(it);
+		}
+
+		// Only the first light is used by the hit shader
+		mTraceScene.light = {};
+
+		if (!mObjManager->mLights.empty())
+		{
+			const auto light = mObjManager->mLights.front();
+			mTraceScene.light.position = light->Position();
+			mTraceScene.light.colour = light->GetColour();
+			mTraceScene.light.intensity = *light->Enabled() ? light->GetStrength() : 0;
+		}
+	}
+
+	const CSoftBVH* CSoftEngine::MeshBVH(const Null::CNullMesh* mesh)
+	{
+		const auto& subMeshes = mesh->SubMeshes();
+
+		// A new mesh can reuse the address of a deleted one, the BVH is only kept if it still points to this mesh data
+		if (const auto it = mMeshBVHs.find(mesh); it != mMeshBVHs.end())
+		{
+			bool same = true;
+			for (unsigned int i = 0; i < subMeshes.size() && same; ++i)
+			{
+				same = i < it->second->NumGeometries() &&
+				       it->second->Geometry(i).positions == &subMeshes[i].positions &&
+				       it->second->Geometry(i).indices == &subMeshes[i].indices;
+			}
+
+			if (same && it->second->NumGeometries() == subMeshes.size()) return it->second.get();
+		}
+
+		std::vector<CSoftBVH::SGeometry> geometries;
+		for (const auto& subMesh : subMeshes)
+		{
+			CSoftBVH::SGeometry geometry;
+			geometry.positions = &subMesh.positions;
+			geometry.normals = &subMesh.normals;
+			geometry.tangents = subMesh.tangents.empty() ? nullptr : &subMesh.tangents;
+			geometry.uvs = subMesh.uvs.empty() ? nullptr : &subMesh.uvs;
+			geometry.indices = &subMesh.indices;
+			geometries.push_back(geometry);
+		}
+
+		auto& blas = mMeshBVHs[mesh];
+		blas = std::make_unique<CSoftBVH>(std::move(geometries));
+		return blas.get();
+	}
+
+	SSoftTraceMaterial CSoftEngine::ObjectTraceMaterial(CGameObject* object)
+	{
+		SSoftTraceMaterial material;
+
+		const auto nullObject = dynamic_cast<Null::CNullGameObject*>(object);
+		if (!nullObject) return material;
+
+		const auto& textures = nullObject->TextureFiles();
+
+		if (textures.size() == 1)
+		{
+			material.albedo = Texture(textures.front());
+			return material;
+		}
+
+		for (const auto& texture : textures)
+		{
+			if (texture.find("Albedo") != std::string::npos)
+				material.albedo = Texture(texture);
+			else if (texture.find("Roughness") != std::string::npos)
+				material.roughness = Texture(texture);
+			else if (texture.find("AO") != std::string::npos)
+				material.ao = Texture(texture);
+			else if (texture.find("Displacement") != std::string::npos)
+				material.displacement = Texture(texture);
+			else if (texture.find("Normal") != std::string::npos)
+				material.normal = Texture(texture);
+			else if (texture.find("Metalness") != std::string::npos)
+				material.metalness = Texture(texture);
+		}
+
+		return material;
+	}
+
+	const SSoftTexture* CSoftEngine::Texture(const std::string& fileName)
+	{
+		if (const auto it = mTextures.find(fileName); it != mTextures.end()) return it->second.get();
+
+		auto& texture = mTextures[fileName];
+
+		try
+		{
+			const auto image = CAssetCache::Instance().Texture(mMediaFolder + fileName);
+			const auto source = image->GetImage(0, 0, 0);
+
+			// Top mip only, converted to RGBA8
+			DirectX::ScratchImage converted;
+			auto                  hr = S_OK;
+
+			if (DirectX::IsCompressed(source->format))
+				hr = DirectX::Decompress(*source, DXGI_FORMAT_R8G8B8A8_UNORM, converted);
+			else if (source->format != DXGI_FORMAT_R8G8B8A8_UNORM)
+				hr = DirectX::Convert(*source, DXGI_FORMAT_R8G8B8A8_UNORM, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, converted);
+
+			if (FAILED(hr)) throw std::runtime_error("Could not convert " + fileName);
+
+			const auto rgba = converted.GetImageCount() ? converted.GetImage(0, 0, 0) : source;
+
+			texture = std::make_unique<SSoftTexture>();
+			texture->width = static_cast<unsigned int>(rgba->width);
+			texture->height = static_cast<unsigned int>(rgba->height);
+			texture->texels.resize(rgba->width * rgba->height);
+
+			for (size_t y = 0; y < rgba->height; ++y)
+				memcpy(&texture->texels[y * rgba->width], rgba->pixels + y * rgba->rowPitch, rgba->width * sizeof(uint32_t));
+		}
+		catch (const std::exception&)
+		{
+			// Drawn untextured, same as a missing map on the GPU backends
+			texture = nullptr;
+		}
+
+		return texture.get();
+	}
+}
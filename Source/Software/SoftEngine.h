@@ -0,0 +1,95 @@
+//--------------------------------------------------------------------------------------
+// Software backend
+//--------------------------------------------------------------------------------------
+// The null backend with a CPU rasterizer behind it: scenes load from the same XML files,
+// every frame the scene pass of the draw log is rasterized and the result can be written
+// to an image, to compare the frames against golden images without a GPU.
+// Shading is a simplified PBR_ps.hlsl: albedo maps only, flat ambient instead of the IBL
+// cube map and no shadows.
+// In ray tracing mode the frame is rendered by the CPU reference of the DXR pipeline instead,
+// over the same objects and meshes the DX12 engine puts in its acceleration structures.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "SoftRasterizer.h"
+#include "SoftRayTracer.h"
+#include "../Null/NullEngine.h"
+
+namespace Software
+{
+	enum class ESoftRenderMode
+	{
+		Raster,  // Scene pass of the draw log, like the raster path of the GPU backends
+		RayTrace // Like the DXR path of the DX12 backend
+	};
+
+	class CSoftEngine final : public Null::CNullEngine
+	{
+	public:
+
+		CSoftEngine() = delete;
+		CSoftEngine(const CSoftEngine&) = delete;
+		CSoftEngine(const CSoftEngine&&) = delete;
+		CSoftEngine& operator=(const CSoftEngine&) = delete;
+		CSoftEngine& operator=(const CSoftEngine&&) = delete;
+
+		// 0 threads uses one per hardware thread
+		CSoftEngine(std::string mediaFolder, UINT width = 1920, UINT height = 1080, unsigned int numThreads = 0);
+
+		~CSoftEngine() override;
+
+		void Resize(UINT x, UINT y) override;
+
+		// Render the frame with the current render mode
+		void FinalizeFrame() override;
+
+		// Will throw a std::runtime_error exception on failure
+		void WriteImage(const std::string& fileName) const;
+
+		CSoftImage Image() const;
+
+		const SSoftStats& Stats() const { return mRasterizer->Stats(); }
+
+		void            SetRenderMode(ESoftRenderMode mode) { mRenderMode = mode; }
+		ESoftRenderMode RenderMode() const { return mRenderMode; }
+
+		// Holds the scene of the last ray traced frame, so it can also be used for baking
+		CSoftRayTracer& RayTracer() { return *mRayTracer; }
+
+	private:
+
+		void BuildFrame();
+
+		void BuildTraceScene();
+
+		// Bottom level BVH of a mesh, built on first use
+		const CSoftBVH* MeshBVH(const Null::CNullMesh* mesh);
+
+		SSoftMaterial ObjectMaterial(CGameObject* object);
+
+		// Maps picked by file name like CDX12Material
+		SSoftTraceMaterial ObjectTraceMaterial(CGameObject* object);
+
+		// Decoded on first use and kept for the lifetime of the engine, nullptr if the file can't be loaded
+		const SSoftTexture* Texture(const std::string& fileName);
+
+		ESoftRenderMode mRenderMode = ESoftRenderMode::Raster;
+
+		std::unique_ptr<CSoftRasterizer> mRasterizer;
+		std::unique_ptr<CSoftRayTracer>  mRayTracer;
+
+		// Reused every frame
+		SSoftFrame                                    mFrame;
+		std::unordered_map<CGameObject*, unsigned int> mFrameMaterials;
+		SSoftTraceScene                               mTraceScene;
+
+		// Dropped when the mesh is no longer used by any object
+		std::unordered_map<const Null::CNullMesh*, std::unique_ptr<CSoftBVH>> mMeshBVHs;
+
+		std::unordered_map<std::string, std::unique_ptr<SSoftTexture>> mTextures;
+	};
+}
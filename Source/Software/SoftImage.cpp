@@ -0,0 +1,93 @@
+#include "SoftImage.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+
+namespace Software
+{
+	CSoftImage::CSoftImage(unsigned int width, unsigned int height) :
+		mWidth(width),
+		mHeight(height),
+		mPixels(size_t(width) * height * 3, 0)
+	{
+	}
+
+	void CSoftImage::Write(const std::string& fileName) const
+	{
+		std::ofstream file(fileName, std::ios::binary);
+		if (!file) throw std::runtime_error("Could not create image " + fileName);
+
+		file << "P6\n" << mWidth << " " << mHeight << "\n255\n";
+		file.write(reinterpret_cast<const char*>(mPixels.data()), std::streamsize(mPixels.size()));
+
+		if (!file) throw std::runtime_error("Could not write image " + fileName);
+	}
+
+	CSoftImage CSoftImage::Read(const std::string& fileName)
+	{
+		std::ifstream file(fileName, std::ios::binary);
+		if (!file) throw std::runtime_error("Could not open image " + fileName);
+
+		// Header values are separated by white space and may have comments in between
+		auto readValue = [&file]()
+		{
+			std::string token;
+			while (file >> token)
+			{
+				if (token[0] != '#') return token;
+				std::getline(file, token);
+			}
+			return std::string();
+		};
+
+		const auto magic = readValue();
+		const auto width = std::atoi(readValue().c_str());
+		const auto height = std::atoi(readValue().c_str());
+		const auto maxValue = std::atoi(readValue().c_str());
+
+		if (magic != "P6" || width <= 0 || height <= 0 || maxValue != 255)
+			throw std::runtime_error("Unsupported image format " + fileName);
+
+		// Single white space before the pixel data
+		file.get();
+
+		CSoftImage image(width, height);
+		file.read(reinterpret_cast<char*>(image.mPixels.data()), std::streamsize(image.mPixels.size()));
+
+		if (!file) throw std::runtime_error("Image truncated " + fileName);
+
+		return image;
+	}
+
+	SImageDifference CSoftImage::Compare(const CSoftImage& a, const CSoftImage& b, unsigned int tolerance)
+	{
+		SImageDifference result;
+
+		if (a.mWidth != b.mWidth || a.mHeight != b.mHeight) return result;
+
+		result.sameSize = true;
+
+		if (a.mPixels.empty()) return result;
+
+		double total = 0;
+		for (size_t p = 0; p < a.mPixels.size(); p += 3)
+		{
+			unsigned int pixelMax = 0;
+			for (size_t c = 0; c < 3; ++c)
+			{
+				const auto difference = unsigned(std::abs(int(a.mPixels[p + c]) - int(b.mPixels[p + c])));
+				pixelMax = std::max(pixelMax, difference);
+				total += difference;
+			}
+
+			result.maxDifference = std::max(result.maxDifference, pixelMax);
+			if (pixelMax > tolerance) ++result.pixelsOver;
+		}
+
+		result.meanDifference = total / double(a.mPixels.size());
+
+		return result;
+	}
+}
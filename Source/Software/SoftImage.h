@@ -0,0 +1,54 @@
+//--------------------------------------------------------------------------------------
+// 8 bit RGB image written by the software backend
+//--------------------------------------------------------------------------------------
+// Stored and written as binary PPM (P6), which every image tool can open and which needs
+// no external library, so frames can be compared against golden images in headless runs.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Software
+{
+	struct SImageDifference
+	{
+		bool         sameSize       = false;
+		unsigned int maxDifference  = 0;    // Largest channel difference, 0-255
+		double       meanDifference = 0;    // Average channel difference, 0-255
+		size_t       pixelsOver     = 0;    // Pixels with a channel difference over the tolerance
+	};
+
+	class CSoftImage
+	{
+	public:
+
+		CSoftImage() = default;
+		CSoftImage(unsigned int width, unsigned int height);
+
+		unsigned int Width() const { return mWidth; }
+		unsigned int Height() const { return mHeight; }
+
+		uint8_t*       Pixel(unsigned int x, unsigned int y) { return &mPixels[(size_t(y) * mWidth + x) * 3]; }
+		const uint8_t* Pixel(unsigned int x, unsigned int y) const { return &mPixels[(size_t(y) * mWidth + x) * 3]; }
+
+		const std::vector<uint8_t>& Pixels() const { return mPixels; }
+
+		// Will throw a std::runtime_error exception on failure
+		void Write(const std::string& fileName) const;
+
+		// Will throw a std::runtime_error exception on failure or if the file is not a binary 8 bit PPM
+		static CSoftImage Read(const std::string& fileName);
+
+		// Compare two images channel by channel, a golden image test passes if pixelsOver is 0
+		static SImageDifference Compare(const CSoftImage& a, const CSoftImage& b, unsigned int tolerance = 2);
+
+	private:
+
+		unsigned int mWidth  = 0;
+		unsigned int mHeight = 0;
+
+		std::vector<uint8_t> mPixels;
+	};
+}
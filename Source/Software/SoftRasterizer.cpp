@@ -0,0 +1,526 @@
+#include "SoftRasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define SOFT_SSE2 1
+#include <emmintrin.h>
+#else
+#define SOFT_SSE2 0
+#endif
+
+namespace Software
+{
+	namespace
+	{
+		constexpr float ShaderPI = 3.14159265359f;
+
+		struct SClipVertex
+		{
+			CVector4 clip;
+			CVector3 world;
+			CVector3 normal;
+			CVector2 uv;
+		};
+
+		SClipVertex Lerp(const SClipVertex& a, const SClipVertex& b, float t)
+		{
+			SClipVertex v;
+			v.clip = { a.clip.x + (b.clip.x - a.clip.x) * t,
+			           a.clip.y + (b.clip.y - a.clip.y) * t,
+			           a.clip.z + (b.clip.z - a.clip.z) * t,
+			           a.clip.w + (b.clip.w - a.clip.w) * t };
+			v.world = a.world + (b.world - a.world) * t;
+			v.normal = a.normal + (b.normal - a.normal) * t;
+			v.uv = a.uv + (b.uv - a.uv) * t;
+			return v;
+		}
+
+		CVector3 Lerp(const CVector3& a, const CVector3& b, float t)
+		{
+			return a + (b - a) * t;
+		}
+
+		float Saturate(float v)
+		{
+			return std::min(std::max(v, 0.0f), 1.0f);
+		}
+
+		// Punctual light equation of PBR_ps.hlsl for a normalised light vector
+		CVector3 PunctualLight(const CVector3& l,
+			float           li,
+			const CVector3& lc,
+			const CVector3& specular,
+			const CVector3& n,
+			const CVector3& v,
+			float           roughness,
+			const CVector3& albedo)
+		{
+			const float nDotV = std::max(Dot(n, v), 0.001f);
+
+			const CVector3 h = Normalise(l + v);
+
+			const float nDotL = std::max(Dot(n, l), 0.001f);
+			const float nDotH = std::max(Dot(n, h), 0.001f);
+			const float vDotH = std::max(Dot(v, h), 0.001f);
+
+			const CVector3 lambert = albedo / ShaderPI;
+
+			const CVector3 F = specular + (CVector3(1, 1, 1) - specular) * std::pow(std::max(1.0f - vDotH, 0.0f), 5.0f);
+
+			const float alpha = std::max(roughness * roughness, 2.0e-3f);
+			const float alpha2 = alpha * alpha;
+			const float dn = nDotH * nDotH * (alpha2 - 1.0f) + 1.0f;
+			const float D = alpha2 / (ShaderPI * dn * dn);
+
+			float k = roughness + 1.0f;
+			k = k * k / 8.0f;
+			const float G = nDotV / (nDotV * (1.0f - k) + k) * (nDotL / (nDotL * (1.0f - k) + k));
+
+			const CVector3 brdf = lambert + F * (G * D / (4.0f * nDotL * nDotV));
+
+			return lc * brdf * (ShaderPI * li * nDotL);
+		}
+
+		// CalculateLight of PBR_ps.hlsl, it returns the accumulated diffuse plus this light and the shader adds
+		// that to the accumulated diffuse again. Kept as is so the images match the GPU ones
+		CVector3 CalculateLight(const SSoftLight& light,
+			const CVector3&   diffuse,
+			const CVector3&   specular,
+			const CVector3&   n,
+			const CVector3&   v,
+			const CVector3&   worldPos,
+			float             roughness,
+			const CVector3&   albedo)
+		{
+			auto        l = light.position - worldPos;
+			const float rdist = 1.0f / Length(l);
+			l = l * rdist;
+
+			return diffuse + PunctualLight(l, light.intensity * rdist * rdist, light.colour, specular, n, v, roughness, albedo);
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Texture
+	//--------------------------------------------------------------------------------------
+
+	CVector4 SSoftTexture::Sample(const CVector2& uv) const
+	{
+		if (texels.empty()) return { 1,1,1,1 };
+
+		// Texel centres are at half coordinates
+		const float u = (uv.x - std::floor(uv.x)) * float(width) - 0.5f;
+		const float v = (uv.y - std::floor(uv.y)) * float(height) - 0.5f;
+
+		const float fu = std::floor(u);
+		const float fv = std::floor(v);
+		const float tu = u - fu;
+		const float tv = v - fv;
+
+		const int w = int(width);
+		const int h = int(height);
+
+		const int x0 = (int(fu) % w + w) % w;
+		const int y0 = (int(fv) % h + h) % h;
+		const int x1 = (x0 + 1) % w;
+		const int y1 = (y0 + 1) % h;
+
+		const uint32_t t[4] = { texels[size_t(y0) * width + x0], texels[size_t(y0) * width + x1],
+		                        texels[size_t(y1) * width + x0], texels[size_t(y1) * width + x1] };
+		const float weight[4] = { (1 - tu) * (1 - tv), tu * (1 - tv), (1 - tu) * tv, tu * tv };
+
+		float c[4] = { 0,0,0,0 };
+		for (int i = 0; i < 4; ++i)
+			for (int channel = 0; channel < 4; ++channel)
+				c[channel] += weight[i] * float((t[i] >> (channel * 8)) & 0xFF);
+
+		return { c[0] / 255.0f, c[1] / 255.0f, c[2] / 255.0f, c[3] / 255.0f };
+	}
+
+	CVector4 SSoftTexture::Load(int x, int y) const
+	{
+		if (x < 0 || y < 0 || x >= int(width) || y >= int(height)) return { 0,0,0,0 };
+
+		const auto t = texels[size_t(y) * width + x];
+
+		return { float(t & 0xFF) / 255.0f, float((t >> 8) & 0xFF) / 255.0f, float((t >> 16) & 0xFF) / 255.0f, float(t >> 24) / 255.0f };
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Rasterizer
+	//--------------------------------------------------------------------------------------
+
+	CSoftRasterizer::CSoftRasterizer(unsigned int width, unsigned int height, unsigned int numThreads) :
+		mPool(numThreads)
+	{
+		Resize(width, height);
+	}
+
+	void CSoftRasterizer::Resize(unsigned int width, unsigned int height)
+	{
+		mWidth = std::max(width, 1u);
+		mHeight = std::max(height, 1u);
+
+		mColour.assign(size_t(mWidth) * mHeight, { 0,0,0 });
+		mDepth.assign(size_t(mWidth) * mHeight, 1.0f);
+
+		const auto tilesX = (mWidth + TileSize - 1) / TileSize;
+		const auto tilesY = (mHeight + TileSize - 1) / TileSize;
+
+		mTiles.clear();
+		mTiles.resize(size_t(tilesX) * tilesY);
+
+		for (unsigned int y = 0; y < tilesY; ++y)
+		{
+			for (unsigned int x = 0; x < tilesX; ++x)
+			{
+				auto& tile = mTiles[size_t(y) * tilesX + x];
+				tile.minX = int(x * TileSize);
+				tile.minY = int(y * TileSize);
+				tile.maxX = int(std::min((x + 1) * TileSize, mWidth)) - 1;
+				tile.maxY = int(std::min((y + 1) * TileSize, mHeight)) - 1;
+			}
+		}
+	}
+
+	template <class F>
+	void CSoftRasterizer::ParallelFor(size_t count, F&& job)
+	{
+		for (size_t i = 0; i < count; ++i)
+			mPool.push_task([&job, i] { job(i); });
+
+		mPool.wait_for_tasks();
+	}
+
+	void CSoftRasterizer::Render(const SSoftFrame& frame)
+	{
+		mStats = {};
+
+		// Geometry
+		mDrawTriangles.resize(frame.draws.size());
+		ParallelFor(frame.draws.size(), [&](size_t i)
+			{
+				mDrawTriangles[i].clear();
+				SetupDraw(frame, frame.draws[i], mDrawTriangles[i]);
+			});
+
+		// Binning, serial so every tile list is in submission order
+		for (auto& tile : mTiles)
+		{
+			tile.triangles.clear();
+			tile.pixelsShaded = 0;
+		}
+
+		const int tilesX = int((mWidth + TileSize - 1) / TileSize);
+
+		for (const auto& triangles : mDrawTriangles)
+		{
+			mStats.triangles += triangles.size();
+
+			for (const auto& triangle : triangles)
+			{
+				for (int ty = triangle.minY / int(TileSize); ty <= triangle.maxY / int(TileSize); ++ty)
+				{
+					for (int tx = triangle.minX / int(TileSize); tx <= triangle.maxX / int(TileSize); ++tx)
+					{
+						mTiles[size_t(ty) * tilesX + tx].triangles.push_back(&triangle);
+						++mStats.binnedEntries;
+					}
+				}
+			}
+		}
+
+		// Raster
+		ParallelFor(mTiles.size(), [&](size_t i) { RasterTile(frame, mTiles[i]); });
+
+		for (const auto& tile : mTiles) mStats.pixelsShaded += tile.pixelsShaded;
+	}
+
+	void CSoftRasterizer::SetupDraw(const SSoftFrame& frame, const SSoftDraw& draw, std::vector<STriangle>& triangles) const
+	{
+		const auto& positions = *draw.positions;
+		const auto& normals = *draw.normals;
+		const auto& indices = *draw.indices;
+		const auto& material = frame.materials[draw.material];
+
+		// Vertex shader
+		std::vector<SClipVertex> vertices(positions.size());
+		for (size_t v = 0; v < positions.size(); ++v)
+		{
+			const auto world = CVector4(positions[v], 1) * draw.worldMatrix;
+
+			vertices[v].world = CVector3(world);
+			vertices[v].clip = world * frame.viewProjectionMatrix;
+			vertices[v].normal = CVector3(CVector4(normals[v], 0) * draw.worldMatrix);
+			vertices[v].uv = draw.uvs ? (*draw.uvs)[v] : CVector2(0, 0);
+		}
+
+		const float width = float(mWidth);
+		const float height = float(mHeight);
+
+		auto addTriangle = [&](const SClipVertex* v0, const SClipVertex* v1, const SClipVertex* v2)
+		{
+			STriangle t;
+
+			const SClipVertex* v[3] = { v0, v1, v2 };
+			for (int i = 0; i < 3; ++i)
+			{
+				if (v[i]->clip.w <= 1e-6f) return;
+
+				t.invW[i] = 1.0f / v[i]->clip.w;
+				t.x[i] = (v[i]->clip.x * t.invW[i] * 0.5f + 0.5f) * width;
+				t.y[i] = (0.5f - v[i]->clip.y * t.invW[i] * 0.5f) * height;
+				t.z[i] = v[i]->clip.z * t.invW[i];
+			}
+
+			// Twice the signed area, positive for the clockwise (front facing) triangles
+			float area = (t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) - (t.y[1] - t.y[0]) * (t.x[2] - t.x[0]);
+
+			if (area == 0 || (material.cullBack && area < 0)) return;
+
+			// Back faces that are not culled are flipped so the raster only deals with one winding
+			if (area < 0)
+			{
+				std::swap(v[1], v[2]);
+				std::swap(t.x[1], t.x[2]);
+				std::swap(t.y[1], t.y[2]);
+				std::swap(t.z[1], t.z[2]);
+				std::swap(t.invW[1], t.invW[2]);
+				area = -area;
+			}
+
+			const float minX = std::min({ t.x[0], t.x[1], t.x[2] });
+			const float maxX = std::max({ t.x[0], t.x[1], t.x[2] });
+			const float minY = std::min({ t.y[0], t.y[1], t.y[2] });
+			const float maxY = std::max({ t.y[0], t.y[1], t.y[2] });
+
+			if (maxX < 0 || maxY < 0 || minX >= width || minY >= height) return;
+
+			t.minX = int(std::max(minX, 0.0f));
+			t.minY = int(std::max(minY, 0.0f));
+			t.maxX = int(std::min(maxX, width - 1));
+			t.maxY = int(std::min(maxY, height - 1));
+
+			for (int i = 0; i < 3; ++i)
+			{
+				t.world[i] = v[i]->world * t.invW[i];
+				t.normal[i] = v[i]->normal * t.invW[i];
+				t.uv[i] = v[i]->uv * t.invW[i];
+			}
+
+			t.invArea = 1.0f / area;
+			t.material = draw.material;
+
+			triangles.push_back(t);
+		};
+
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			const SClipVertex* in[3] = { &vertices[indices[i]], &vertices[indices[i + 1]], &vertices[indices[i + 2]] };
+
+			if (in[0]->clip.z >= 0 && in[1]->clip.z >= 0 && in[2]->clip.z >= 0)
+			{
+				addTriangle(in[0], in[1], in[2]);
+				continue;
+			}
+
+			// Clip against the near plane (z = 0 in D3D clip space), a triangle becomes at most a quad
+			SClipVertex out[4];
+			int         count = 0;
+			for (int e = 0; e < 3; ++e)
+			{
+				const auto& a = *in[e];
+				const auto& b = *in[(e + 1) % 3];
+
+				if (a.clip.z >= 0) out[count++] = a;
+				if ((a.clip.z >= 0) != (b.clip.z >= 0)) out[count++] = Lerp(a, b, a.clip.z / (a.clip.z - b.clip.z));
+			}
+
+			for (int k = 1; k + 1 < count; ++k) addTriangle(&out[0], &out[k], &out[k + 1]);
+		}
+	}
+
+	void CSoftRasterizer::RasterTile(const SSoftFrame& frame, STile& tile)
+	{
+		const CVector3 background = frame.backgroundColour;
+
+		for (int y = tile.minY; y <= tile.maxY; ++y)
+		{
+			const size_t row = size_t(y) * mWidth;
+			std::fill(mColour.begin() + row + tile.minX, mColour.begin() + row + tile.maxX + 1, background);
+			std::fill(mDepth.begin() + row + tile.minX, mDepth.begin() + row + tile.maxX + 1, 1.0f);
+		}
+
+		for (const auto triangle : tile.triangles) RasterTriangle(frame, *triangle, tile);
+	}
+
+	void CSoftRasterizer::RasterTriangle(const SSoftFrame& frame, const STriangle& t, STile& tile)
+	{
+		const int minX = std::max(t.minX, tile.minX);
+		const int maxX = std::min(t.maxX, tile.maxX);
+		const int minY = std::max(t.minY, tile.minY);
+		const int maxY = std::min(t.maxY, tile.maxY);
+
+		if (minX > maxX || minY > maxY) return;
+
+		// Edge i is opposite vertex i: e(x, y) = a * x + b * y + c, positive inside.
+		// Pixels exactly on an edge belong to the triangle only if it is a top or a left edge
+		float a[3], b[3], c[3];
+		bool  topLeft[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			const int j = (i + 1) % 3;
+			const int k = (i + 2) % 3;
+
+			a[i] = t.y[j] - t.y[k];
+			b[i] = t.x[k] - t.x[j];
+			c[i] = -(a[i] * t.x[j] + b[i] * t.y[j]);
+
+			topLeft[i] = a[i] > 0 || (a[i] == 0 && b[i] > 0);
+		}
+
+		for (int y = minY; y <= maxY; ++y)
+		{
+			const float py = float(y) + 0.5f;
+
+			const float rowE[3] = { b[0] * py + c[0], b[1] * py + c[1], b[2] * py + c[2] };
+
+			// 4 pixels at a time
+			for (int x = minX; x <= maxX; x += 4)
+			{
+				const float px = float(x) + 0.5f;
+
+				float e[3][4];
+				int   mask = 0;
+
+#if SOFT_SSE2
+				const __m128 lanePx = _mm_add_ps(_mm_set1_ps(px), _mm_setr_ps(0, 1, 2, 3));
+				const __m128 zero = _mm_setzero_ps();
+
+				__m128 inside = _mm_cmplt_ps(lanePx, _mm_set1_ps(float(maxX + 1)));
+
+				for (int i = 0; i < 3; ++i)
+				{
+					const __m128 edge = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[i]), lanePx), _mm_set1_ps(rowE[i]));
+					inside = _mm_and_ps(inside, topLeft[i] ? _mm_cmpge_ps(edge, zero) : _mm_cmpgt_ps(edge, zero));
+					_mm_storeu_ps(e[i], edge);
+				}
+
+				mask = _mm_movemask_ps(inside);
+#else
+				for (int lane = 0; lane < 4; ++lane)
+				{
+					bool in = x + lane <= maxX;
+					for (int i = 0; i < 3; ++i)
+					{
+						e[i][lane] = a[i] * (px + float(lane)) + rowE[i];
+						in = in && (topLeft[i] ? e[i][lane] >= 0 : e[i][lane] > 0);
+					}
+					mask |= int(in) << lane;
+				}
+#endif
+
+				if (!mask) continue;
+
+				for (int lane = 0; lane < 4; ++lane)
+				{
+					if (!(mask & (1 << lane))) continue;
+
+					const float b0 = e[0][lane] * t.invArea;
+					const float b1 = e[1][lane] * t.invArea;
+					const float b2 = e[2][lane] * t.invArea;
+
+					// Depth is linear in screen space, same less test as the GPU pipelines
+					const float z = b0 * t.z[0] + b1 * t.z[1] + b2 * t.z[2];
+
+					const size_t pixel = size_t(y) * mWidth + x + lane;
+					if (z > 1 || z >= mDepth[pixel]) continue;
+
+					CVector3 colour;
+					if (!ShadePixel(frame, t, b0, b1, b2, colour)) continue;
+
+					mDepth[pixel] = z;
+					mColour[pixel] = colour;
+					++tile.pixelsShaded;
+				}
+			}
+		}
+	}
+
+	bool CSoftRasterizer::ShadePixel(const SSoftFrame& frame, const STriangle& t, float b0, float b1, float b2, CVector3& colour) const
+	{
+		const auto& material = frame.materials[t.material];
+
+		// Perspective correct interpolation
+		const float w = 1.0f / (b0 * t.invW[0] + b1 * t.invW[1] + b2 * t.invW[2]);
+
+		const CVector2 uv = (t.uv[0] * b0 + t.uv[1] * b1 + t.uv[2] * b2) * w;
+
+		const auto sample = material.albedo ? material.albedo->Sample(uv) : CVector4(1, 1, 1, 1);
+
+		if (material.alphaTest && sample.w == 0) return false;
+
+		const CVector3 albedo = CVector3(sample.x, sample.y, sample.z) * material.tint;
+
+		if (material.shading == ESoftShading::Unlit)
+		{
+			colour = albedo;
+			return true;
+		}
+
+		const CVector3 worldPos = (t.world[0] * b0 + t.world[1] * b1 + t.world[2] * b2) * w;
+		const CVector3 n = Normalise((t.normal[0] * b0 + t.normal[1] * b1 + t.normal[2] * b2) * w);
+		const CVector3 v = Normalise(frame.cameraPosition - worldPos);
+
+		const float roughness = material.roughness;
+		const CVector3 specular = Lerp(CVector3(0.04f, 0.04f, 0.04f), albedo, material.metalness);
+
+		// Flat ambient instead of the IBL cube map
+		CVector3 diffuse = albedo * frame.ambientColour;
+
+		// No shadow maps, every light is fully visible
+		for (const auto& light : frame.lights)
+		{
+			switch (light.type)
+			{
+			case ESoftLightType::Point:
+				diffuse = diffuse + CalculateLight(light, diffuse, specular, n, v, worldPos, roughness, albedo);
+				break;
+
+			case ESoftLightType::Spot:
+				if (Dot(light.facing * -1.0f, Normalise(light.position - worldPos)) > light.cosHalfAngle)
+					diffuse = diffuse + CalculateLight(light, diffuse, specular, n, v, worldPos, roughness, albedo);
+				break;
+
+			case ESoftLightType::Directional:
+				// Not attenuated
+				diffuse = diffuse + PunctualLight(Normalise(light.facing), light.intensity, light.colour, specular, n, v, roughness, albedo);
+				break;
+			}
+		}
+
+		colour = diffuse;
+		return true;
+	}
+
+	CSoftImage CSoftRasterizer::Image() const
+	{
+		CSoftImage image(mWidth, mHeight);
+
+		for (unsigned int y = 0; y < mHeight; ++y)
+		{
+			for (unsigned int x = 0; x < mWidth; ++x)
+			{
+				const auto& c = mColour[size_t(y) * mWidth + x];
+				auto        p = image.Pixel(x, y);
+				p[0] = uint8_t(Saturate(c.x) * 255.0f + 0.5f);
+				p[1] = uint8_t(Saturate(c.y) * 255.0f + 0.5f);
+				p[2] = uint8_t(Saturate(c.z) * 255.0f + 0.5f);
+			}
+		}
+
+		return image;
+	}
+}
@@ -0,0 +1,185 @@
+//--------------------------------------------------------------------------------------
+// Multithreaded tile based software rasterizer
+//--------------------------------------------------------------------------------------
+// Renders a list of indexed triangle draws into a colour and a depth buffer on the CPU.
+// A frame runs in three steps:
+//  - Geometry (parallel per draw): transform the vertices, clip against the near plane and set up the triangles
+//  - Binning (serial): add every triangle, in submission order, to the tiles its bounds touch
+//  - Raster (parallel per tile): walk the tile list with 4 wide edge functions, depth test and shade
+// Every tile owns its pixels so the raster step needs no locking, and since the tile lists keep
+// the submission order the image is the same whatever the number of threads.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <thread_pool.hpp>
+
+#include "SoftImage.h"
+#include "../Math/CMatrix4x4.h"
+#include "../Math/CVector2.h"
+#include "../Math/CVector3.h"
+#include "../Math/CVector4.h"
+
+namespace Software
+{
+	// RGBA8 texture, sampled bilinearly with wrapping like the engine default sampler
+	struct SSoftTexture
+	{
+		unsigned int width  = 0;
+		unsigned int height = 0;
+
+		std::vector<uint32_t> texels; // 0xAABBGGRR
+
+		CVector4 Sample(const CVector2& uv) const;
+
+		// Texel fetch like Texture2D::Load, 0 outside of the texture or if nothing is loaded
+		CVector4 Load(int x, int y) const;
+	};
+
+	enum class ESoftShading
+	{
+		Lit,  // Simplified PBR_ps.hlsl
+		Unlit // Albedo * tint, for the sky and the light models
+	};
+
+	struct SSoftMaterial
+	{
+		const SSoftTexture* albedo    = nullptr; // White if null
+		CVector3            tint      = { 1,1,1 };
+		float               roughness = 1;
+		float               metalness = 0;
+		ESoftShading        shading   = ESoftShading::Lit;
+		bool                cullBack  = true;
+		bool                alphaTest = true;    // Discard the texels with alpha 0 like PBR_ps.hlsl
+	};
+
+	enum class ESoftLightType
+	{
+		Point,
+		Spot,
+		Directional
+	};
+
+	// Same values the DX12 engine puts in the light buffers
+	struct SSoftLight
+	{
+		ESoftLightType type         = ESoftLightType::Point;
+		CVector3       position     = { 0,0,0 };
+		CVector3       colour       = { 1,1,1 };
+		CVector3       facing       = { 0,0,1 }; // Spot and directional lights
+		float          intensity    = 0;
+		float          cosHalfAngle = 0;         // Spot lights
+	};
+
+	struct SSoftDraw
+	{
+		const std::vector<CVector3>*     positions = nullptr;
+		const std::vector<CVector3>*     normals   = nullptr;
+		const std::vector<CVector2>*     uvs       = nullptr; // Optional
+		const std::vector<unsigned int>* indices   = nullptr;
+
+		CMatrix4x4   worldMatrix;
+		unsigned int material = 0; // Index in SSoftFrame::materials
+	};
+
+	struct SSoftFrame
+	{
+		CMatrix4x4 viewProjectionMatrix;
+		CVector3   cameraPosition   = { 0,0,0 };
+		CVector3   ambientColour    = { 0,0,0 };
+		CVector3   backgroundColour = { 0,0,0 };
+
+		std::vector<SSoftLight>    lights;
+		std::vector<SSoftMaterial> materials;
+		std::vector<SSoftDraw>     draws;
+	};
+
+	struct SSoftStats
+	{
+		size_t triangles     = 0; // After clipping and culling
+		size_t binnedEntries = 0; // Triangle references in all the tile lists
+		size_t pixelsShaded  = 0;
+	};
+
+	class CSoftRasterizer
+	{
+	public:
+
+		static constexpr unsigned int TileSize = 64;
+
+		CSoftRasterizer() = delete;
+		CSoftRasterizer(const CSoftRasterizer&) = delete;
+		CSoftRasterizer(const CSoftRasterizer&&) = delete;
+		CSoftRasterizer& operator=(const CSoftRasterizer&) = delete;
+		CSoftRasterizer& operator=(const CSoftRasterizer&&) = delete;
+
+		// 0 threads uses one per hardware thread
+		CSoftRasterizer(unsigned int width, unsigned int height, unsigned int numThreads = 0);
+
+		void Resize(unsigned int width, unsigned int height);
+
+		// Clear the buffers and render the frame
+		void Render(const SSoftFrame& frame);
+
+		// Colour buffer of the last frame, saturated to 8 bits per channel
+		CSoftImage Image() const;
+
+		const std::vector<float>& Depth() const { return mDepth; }
+
+		const SSoftStats& Stats() const { return mStats; }
+
+		unsigned int Width() const { return mWidth; }
+		unsigned int Height() const { return mHeight; }
+		unsigned int ThreadCount() const { return mPool.get_thread_count(); }
+
+	private:
+
+		// Screen space triangle, the attributes are premultiplied by 1/w for the perspective correct interpolation
+		struct STriangle
+		{
+			float    x[3], y[3], z[3], invW[3];
+			CVector3 world[3];
+			CVector3 normal[3];
+			CVector2 uv[3];
+
+			float        invArea;
+			int          minX, minY, maxX, maxY;
+			unsigned int material;
+		};
+
+		struct STile
+		{
+			int minX, minY, maxX, maxY;
+
+			std::vector<const STriangle*> triangles;
+			size_t                        pixelsShaded = 0;
+		};
+
+		void SetupDraw(const SSoftFrame& frame, const SSoftDraw& draw, std::vector<STriangle>& triangles) const;
+
+		void RasterTile(const SSoftFrame& frame, STile& tile);
+
+		void RasterTriangle(const SSoftFrame& frame, const STriangle& triangle, STile& tile);
+
+		// Returns false if the pixel is discarded
+		bool ShadePixel(const SSoftFrame& frame, const STriangle& triangle, float b0, float b1, float b2, CVector3& colour) const;
+
+		template <class F>
+		void ParallelFor(size_t count, F&& job);
+
+		unsigned int mWidth  = 0;
+		unsigned int mHeight = 0;
+
+		std::vector<CVector3> mColour;
+		std::vector<float>    mDepth;
+
+		std::vector<std::vector<STriangle>> mDrawTriangles;
+		std::vector<STile>                  mTiles;
+
+		SSoftStats mStats;
+
+		thread_pool mPool;
+	};
+}
@@ -0,0 +1,466 @@
+#include "SoftRayTracer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace Software
+{
+	namespace
+	{
+		constexpr float ShaderPI = 3.14159265359f;
+
+		// int2 of the shaders, texture coordinates in texels
+		struct SCoord
+		{
+			int x, y;
+		};
+
+		// float to int conversion of HLSL (truncation), kept in range so it is defined in C++
+		int ToInt(float f)
+		{
+			if (!(f == f)) return 0;
+			return static_cast<int>(std::min(std::max(f, -1.0e9f), 1.0e9f));
+		}
+
+		int Dims(const SSoftTexture* texture)
+		{
+			return texture ? static_cast<int>(texture->width) : 0;
+		}
+
+		CVector4 Load(const SSoftTexture* texture, SCoord coord)
+		{
+			return texture ? texture->Load(coord.x, coord.y) : CVector4{ 0,0,0,0 };
+		}
+
+		float Saturate(float v)
+		{
+			return std::min(std::max(v, 0.0f), 1.0f);
+		}
+
+		float Sign(float v)
+		{
+			return v > 0 ? 1.0f : v < 0 ? -1.0f : 0.0f;
+		}
+
+		CVector3 Lerp(const CVector3& a, const CVector3& b, float t)
+		{
+			return a + (b - a) * t;
+		}
+
+		CVector3 Reflect(const CVector3& i, const CVector3& n)
+		{
+			return i - n * (2 * Dot(i, n));
+		}
+
+		// ParallaxMapping of Hit.hlsl, on integer texel coordinates. The linear search reads the normal map like the shader does
+		SCoord ParallaxMapping(SCoord uv, const CVector3& v, const SSoftTexture* displacementMap, const SSoftTexture* normalMap)
+		{
+			const float minSamples = 5.0f;
+			const float maxSamples = 20.0f;
+			const float numSamples = maxSamples + (minSamples - maxSamples) * std::abs(v.z);
+
+			float rayHeight = 1.0f;
+			float heightStep = 1.0f / numSamples;
+			float uvStepX = (0.6f * v.x / v.z) / numSamples;
+			float uvStepY = (0.6f * v.y / v.z) / numSamples;
+
+			float surfaceHeight = Load(displacementMap, uv).x;
+			float prevSurfaceHeight = surfaceHeight;
+
+			while (rayHeight > surfaceHeight)
+			{
+				rayHeight -= heightStep;
+				uv = { ToInt(uv.x - uvStepX), ToInt(uv.y - uvStepY) };
+
+				prevSurfaceHeight = surfaceHeight;
+				surfaceHeight = Load(normalMap, uv).x;
+			}
+
+			const float currDiff = surfaceHeight - rayHeight;
+			const float prevDiff = (rayHeight + heightStep) - prevSurfaceHeight;
+			const float weight = currDiff / (currDiff + prevDiff);
+
+			uv = { ToInt(uv.x + uvStepX * weight), ToInt(uv.y + uvStepY * weight) };
+			rayHeight += heightStep * weight;
+
+			const int binarySearchSamples = 5;
+			for (int i = 0; i < binarySearchSamples; ++i)
+			{
+				heightStep *= 0.5f;
+				uvStepX *= 0.5f;
+				uvStepY *= 0.5f;
+
+				const float dir = Sign(surfaceHeight - rayHeight);
+				rayHeight += dir * heightStep;
+				uv = { ToInt(uv.x + dir * uvStepX), ToInt(uv.y + dir * uvStepY) };
+
+				surfaceHeight = Load(displacementMap, uv).x;
+			}
+
+			return uv;
+		}
+
+		// Van der Corput sequence in base 2, second coordinate of the Hammersley points
+		float RadicalInverse(uint32_t bits)
+		{
+			bits = (bits << 16u) | (bits >> 16u);
+			bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+			bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+			bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+			bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+			return float(bits) * 2.3283064365386963e-10f;
+		}
+	}
+
+	CSoftRayTracer::CSoftRayTracer(unsigned int width, unsigned int height, unsigned int numThreads) :
+		mScheduler(numThreads)
+	{
+		Resize(width, height);
+	}
+
+	void CSoftRayTracer::Resize(unsigned int width, unsigned int height)
+	{
+		mWidth = width;
+		mHeight = height;
+		mColour.assign(size_t(width) * height, { 0,0,0 });
+	}
+
+	void CSoftRayTracer::SetScene(const SSoftTraceScene& scene)
+	{
+		std::vector<CSoftTLAS::SInstance> instances;
+		instances.reserve(scene.instances.size());
+
+		for (const auto& instance : scene.instances)
+		{
+			if (!instance.blas || instance.material >= scene.materials.size()) throw std::runtime_error("Invalid ray tracing instance");
+
+			instances.push_back({ instance.blas, instance.worldMatrix });
+		}
+
+		mScene = scene;
+		mTLAS.Build(instances);
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Frame
+	//--------------------------------------------------------------------------------------
+
+	void CSoftRayTracer::Render(const CMatrix4x4& cameraMatrix, const CMatrix4x4& projectionMatrix)
+	{
+		const size_t tilesX = (mWidth + TileSize - 1) / TileSize;
+		const size_t tilesY = (mHeight + TileSize - 1) / TileSize;
+
+		mTileStats.assign(tilesX * tilesY, {});
+
+		// Only the scale of the projection matters for the direction of the primary rays
+		const float invE00 = 1.0f / projectionMatrix.e00;
+		const float invE11 = 1.0f / projectionMatrix.e11;
+
+		mScheduler.Run(tilesX * tilesY, [&](size_t tile) { RenderTile(tile, cameraMatrix, invE00, invE11); });
+
+		mStats = {};
+		mStats.steals = mScheduler.Steals();
+		for (const auto& tile : mTileStats)
+		{
+			mStats.primaryRays += tile.primaryRays;
+			mStats.secondaryRays += tile.secondaryRays;
+			mStats.shadowRays += tile.shadowRays;
+		}
+	}
+
+	void CSoftRayTracer::RenderTile(size_t tile, const CMatrix4x4& cameraMatrix, float invE00, float invE11)
+	{
+		const auto tilesX = (mWidth + TileSize - 1) / TileSize;
+		const auto tileX = static_cast<unsigned int>(tile % tilesX) * TileSize;
+		const auto tileY = static_cast<unsigned int>(tile / tilesX) * TileSize;
+
+		auto& stats = mTileStats[tile];
+
+		// Same ray as RayGen.hlsl: through the centre of the pixel, on the far plane of the inverse projection
+		const CVector3 origin = CVector3(CVector4(0, 0, 0, 1) * cameraMatrix);
+
+		auto primaryRay = [&](unsigned int x, unsigned int y)
+		{
+			const float dx = ((x + 0.5f) / mWidth) * 2.0f - 1.0f;
+			const float dy = ((y + 0.5f) / mHeight) * 2.0f - 1.0f;
+
+			SSoftRay ray;
+			ray.origin = origin;
+			ray.direction = CVector3(CVector4(dx * invE00, -dy * invE11, 1, 0) * cameraMatrix);
+			ray.tMin = 0;
+			ray.tMax = mSettings.primaryTMax;
+			return ray;
+		};
+
+		for (unsigned int y = tileY; y < std::min(tileY + TileSize, mHeight); y += 2)
+		{
+			for (unsigned int x = tileX; x < std::min(tileX + TileSize, mWidth); x += 2)
+			{
+				// 2x2 pixels per packet, lanes outside of the image are disabled
+				SSoftRayPacket packet;
+				SSoftRay       rays[4];
+				int            lanes = 0;
+
+				for (int lane = 0; lane < 4; ++lane)
+				{
+					const auto px = x + (lane & 1);
+					const auto py = y + (lane >> 1);
+
+					rays[lane] = primaryRay(std::min(px, mWidth - 1), std::min(py, mHeight - 1));
+					packet.Set(lane, rays[lane]);
+
+					if (px < mWidth && py < mHeight) lanes |= 1 << lane;
+				}
+
+				packet.active = lanes;
+				mTLAS.Intersect(packet, SoftRayFlagCullBackFacing);
+
+				for (int lane = 0; lane < 4; ++lane)
+				{
+					if (!(lanes & (1 << lane))) continue;
+
+					const auto px = x + (lane & 1);
+					const auto py = y + (lane >> 1);
+
+					const float missRamp = float(py) / float(mHeight);
+
+					mColour[size_t(py) * mWidth + px] = packet.hit & (1 << lane)
+						                                    ? ClosestHit(rays[lane], packet.hits[lane], 1, missRamp, stats)
+						                                    : Miss(missRamp);
+					++stats.primaryRays;
+				}
+			}
+		}
+	}
+
+	CSoftImage CSoftRayTracer::Image() const
+	{
+		CSoftImage image(mWidth, mHeight);
+
+		for (unsigned int y = 0; y < mHeight; ++y)
+		{
+			for (unsigned int x = 0; x < mWidth; ++x)
+			{
+				const auto& c = mColour[size_t(y) * mWidth + x];
+				auto        p = image.Pixel(x, y);
+				p[0] = uint8_t(Saturate(c.x) * 255.0f + 0.5f);
+				p[1] = uint8_t(Saturate(c.y) * 255.0f + 0.5f);
+				p[2] = uint8_t(Saturate(c.z) * 255.0f + 0.5f);
+			}
+		}
+
+		return image;
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Shaders
+	//--------------------------------------------------------------------------------------
+
+	CVector3 CSoftRayTracer::TraceRadiance(const SSoftRay& ray, unsigned int flags, unsigned int depth, float missRamp, STileStats& stats) const
+	{
+		SSoftHit hit;
+		if (mTLAS.Intersect(ray, flags, hit)) return ClosestHit(ray, hit, depth, missRamp, stats);
+
+		return Miss(missRamp);
+	}
+
+	CVector3 CSoftRayTracer::Miss(float missRamp)
+	{
+		return { 0.0f, 0.2f, 0.7f - 0.3f * missRamp };
+	}
+
+	CVector3 CSoftRayTracer::ClosestHit(const SSoftRay& ray, const SSoftHit& hit, unsigned int depth, float missRamp, STileStats& stats) const
+	{
+		const auto& instance = mScene.instances[hit.instance];
+		const auto& material = mScene.materials[instance.material];
+		const auto& geometry = instance.blas->Geometry(hit.geometry);
+		const auto& indices = *geometry.indices;
+
+		const unsigned int i0 = indices[hit.primitive * 3];
+		const unsigned int i1 = indices[hit.primitive * 3 + 1];
+		const unsigned int i2 = indices[hit.primitive * 3 + 2];
+
+		const float b0 = 1.0f - hit.bary.x - hit.bary.y;
+		const float b1 = hit.bary.x;
+		const float b2 = hit.bary.y;
+
+		auto interpolate = [&](const std::vector<CVector3>* attribute) -> CVector3
+		{
+			if (!attribute || attribute->empty()) return { 0,0,0 };
+			return (*attribute)[i0] * b0 + (*attribute)[i1] * b1 + (*attribute)[i2] * b2;
+		};
+
+		CVector2 uv = { 0,0 };
+		if (geometry.uvs && !geometry.uvs->empty())
+			uv = (*geometry.uvs)[i0] * b0 + (*geometry.uvs)[i1] * b1 + (*geometry.uvs)[i2] * b2;
+
+		// The tangent is left in mesh space, like the shader
+		const auto worldTangent = interpolate(geometry.tangents);
+
+		const auto n = Normalise(CVector3(CVector4(interpolate(geometry.normals), 0) * instance.worldMatrix));
+		const auto v = Normalise(ray.direction * -1.0f);
+
+		const auto hitPosition = ray.origin + ray.direction * hit.t;
+
+		// Reflection ray for the image based lighting. Past the recursion depth the GPU would fail the
+		// dispatch, the reference stops and uses the miss colour instead
+		CVector3 ibl = Miss(missRamp);
+		if (depth < mSettings.maxRecursionDepth)
+		{
+			SSoftRay iblRay;
+			iblRay.origin = hitPosition;
+			iblRay.direction = Reflect(v * -1.0f, n);
+			iblRay.tMin = mSettings.secondaryTMin;
+			iblRay.tMax = mSettings.secondaryTMax;
+
+			++stats.secondaryRays;
+			ibl = TraceRadiance(iblRay, SoftRayFlagNone, depth + 1, missRamp, stats);
+		}
+
+		const int albedoWidth = Dims(material.albedo);
+		const int albedoHeight = material.albedo ? static_cast<int>(material.albedo->height) : 0;
+
+		SCoord coord = { ToInt(std::floor(uv.x * albedoWidth)), ToInt(std::floor(uv.y * albedoHeight)) };
+
+		// Parallax mapping only if there are both the normal map and the displacement map
+		if (Dims(material.displacement) && Dims(material.normal))
+		{
+			const auto     worldBitangent = Normalise(Cross(n, Normalise(worldTangent)));
+			const CVector3 tangentSpaceV = { Dot(v, worldTangent), Dot(v, worldBitangent), Dot(v, n) };
+
+			coord = ParallaxMapping(coord, tangentSpaceV, material.displacement, material.normal);
+		}
+
+		const auto  albedo = CVector3(Load(material.albedo, coord));
+		const float roughness = Load(material.roughness, coord).x;
+		const float metalness = Load(material.metalness, coord).x;
+
+		// As in the shader, the AO map is only read when there is no metalness map
+		const float ao = Dims(material.metalness) ? 1.0f : Load(material.ao, coord).x;
+
+		const auto  specularColour = Lerp({ 0.04f, 0.04f, 0.04f }, albedo, metalness);
+		const float nDotV = std::max(Dot(n, v), 0.001f);
+		const auto  fresnel = specularColour + (CVector3{ 1,1,1 } - specularColour) * std::pow(std::max(1.0f - nDotV, 0.0f), 5.0f);
+
+		auto colour = albedo * ibl * ao + fresnel * ibl * (1 - roughness);
+
+		// First light only, an empty light buffer adds nothing
+		const auto& light = mScene.light;
+		if (light.intensity != 0)
+		{
+			auto        l = light.position - hitPosition;
+			const float rdist = 1.0f / Length(l);
+			l = l * rdist;
+
+			const float li = light.intensity * rdist * rdist;
+
+			float shadow = 1.0f;
+			if (depth < mSettings.maxRecursionDepth)
+			{
+				SSoftRay shadowRay;
+				shadowRay.origin = hitPosition;
+				shadowRay.direction = l;
+				shadowRay.tMin = mSettings.secondaryTMin;
+				shadowRay.tMax = mSettings.secondaryTMax;
+
+				++stats.shadowRays;
+				shadow = Occluded(shadowRay) ? 0.3f : 1.0f;
+			}
+
+			const auto h = Normalise(l + v);
+
+			const float nDotL = std::max(Dot(n, l), 0.001f);
+			const float nDotH = std::max(Dot(n, h), 0.001f);
+			const float vDotH = std::max(Dot(v, h), 0.001f);
+
+			const auto lambert = albedo / ShaderPI;
+
+			const auto F = specularColour + (CVector3{ 1,1,1 } - specularColour) * std::pow(std::max(1.0f - vDotH, 0.0f), 5.0f);
+
+			const float alpha = std::max(roughness * roughness, 2.0e-3f);
+			const float alpha2 = alpha * alpha;
+			const float nDotH2 = nDotH * nDotH;
+			const float dn = nDotH2 * (alpha2 - 1.0f) + 1.0f;
+			const float D = alpha2 / (ShaderPI * dn * dn);
+
+			float k = roughness + 1.0f;
+			k = k * k / 8.0f;
+			const float gV = nDotV / (nDotV * (1.0f - k) + k);
+			const float gL = nDotL / (nDotL * (1.0f - k) + k);
+			const float G = gV * gL;
+
+			const auto brdf = F * lambert + F * (G * D / (4.0f * nDotL * nDotV));
+
+			colour += light.colour * brdf * (ShaderPI * li * nDotL * shadow);
+		}
+
+		return colour;
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Tracing
+	//--------------------------------------------------------------------------------------
+
+	bool CSoftRayTracer::Trace(const SSoftRay& ray, unsigned int flags, SSoftHit& hit) const
+	{
+		return mTLAS.Intersect(ray, flags, hit);
+	}
+
+	bool CSoftRayTracer::Occluded(const SSoftRay& ray) const
+	{
+		SSoftHit hit;
+		return mTLAS.Intersect(ray, SoftRayFlagAcceptFirstHit, hit);
+	}
+
+	CVector3 CSoftRayTracer::Radiance(const SSoftRay& ray, float missRamp) const
+	{
+		STileStats stats;
+		return TraceRadiance(ray, SoftRayFlagCullBackFacing, 1, missRamp, stats);
+	}
+
+	float CSoftRayTracer::AmbientOcclusion(const CVector3& position, const CVector3& normal, unsigned int numSamples, float maxDistance) const
+	{
+		if (numSamples == 0) return 1;
+
+		// Frame around the normal
+		const auto n = Normalise(normal);
+		const auto t = Normalise(Cross(std::abs(n.x) > 0.9f ? CVector3{ 0,1,0 } : CVector3{ 1,0,0 }, n));
+		const auto b = Cross(n, t);
+
+		unsigned int occluded = 0;
+
+		// Cosine weighted Hammersley directions, 4 at a time
+		for (unsigned int first = 0; first < numSamples; first += 4)
+		{
+			SSoftRayPacket packet;
+			packet.active = 0;
+
+			for (unsigned int lane = 0; lane < 4; ++lane)
+			{
+				const auto  i = std::min(first + lane, numSamples - 1);
+				const float u1 = (i + 0.5f) / numSamples;
+				const float u2 = RadicalInverse(i);
+
+				const float r = std::sqrt(u1);
+				const float phi = 2.0f * ShaderPI * u2;
+
+				SSoftRay ray;
+				ray.origin = position;
+				ray.direction = t * (r * std::cos(phi)) + b * (r * std::sin(phi)) + n * std::sqrt(1.0f - u1);
+				ray.tMin = mSettings.secondaryTMin;
+				ray.tMax = maxDistance;
+				packet.Set(lane, ray);
+
+				if (first + lane < numSamples) packet.active |= 1 << lane;
+			}
+
+			mTLAS.Intersect(packet, SoftRayFlagAcceptFirstHit);
+
+			for (int lane = 0; lane < 4; ++lane)
+				if (packet.hit & (1 << lane)) ++occluded;
+		}
+
+		return 1.0f - float(occluded) / float(numSamples);
+	}
+}
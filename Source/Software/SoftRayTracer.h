@@ -0,0 +1,156 @@
+//--------------------------------------------------------------------------------------
+// CPU ray tracer, reference for the DXR path
+//--------------------------------------------------------------------------------------
+// Traces the same rays as RayGen.hlsl and shades them like Hit.hlsl, ShadowRay.hlsl and
+// Miss.hlsl, so the output of the DXR pipeline can be checked on machines without a
+// raytracing capable GPU. The scene is a top level BVH over instances of per mesh bottom
+// level BVHs, like the DXR acceleration structures.
+// Primary rays are traced in 2x2 packets, tiles are spread over the threads by a work
+// stealing scheduler, and every pixel only depends on the scene so the image is the same
+// whatever the number of threads.
+// Once a scene is set the tracing functions can be used on their own, e.g. to bake ambient
+// occlusion or light probes offline.
+
+#pragma once
+
+#include <vector>
+
+#include "SoftBVH.h"
+#include "SoftImage.h"
+#include "SoftRasterizer.h"
+#include "SoftTileScheduler.h"
+
+namespace Software
+{
+	// Maps of Hit.hlsl, a missing map reads as 0 like an unbound texture
+	struct SSoftTraceMaterial
+	{
+		const SSoftTexture* albedo       = nullptr;
+		const SSoftTexture* normal       = nullptr;
+		const SSoftTexture* displacement = nullptr;
+		const SSoftTexture* roughness    = nullptr;
+		const SSoftTexture* metalness    = nullptr;
+		const SSoftTexture* ao           = nullptr;
+	};
+
+	struct SSoftTraceInstance
+	{
+		const CSoftBVH* blas = nullptr;
+		CMatrix4x4      worldMatrix;
+		unsigned int    material = 0; // Index in SSoftTraceScene::materials
+	};
+
+	struct SSoftTraceScene
+	{
+		std::vector<SSoftTraceInstance> instances;
+		std::vector<SSoftTraceMaterial> materials;
+
+		// Hit.hlsl only uses the first light of the buffer, intensity 0 if there is none
+		SSoftLight light;
+	};
+
+	struct SSoftTraceSettings
+	{
+		unsigned int maxRecursionDepth = 2;      // Same as the DXR pipeline
+		float        secondaryTMin     = 0.001f; // Offset of the reflection and shadow rays from the surface
+		float        primaryTMax       = 100000;
+		float        secondaryTMax     = 10000;
+	};
+
+	struct SSoftTraceStats
+	{
+		size_t primaryRays   = 0;
+		size_t secondaryRays = 0; // Reflection rays
+		size_t shadowRays    = 0;
+		size_t steals        = 0; // Tiles moved between threads by the scheduler
+	};
+
+	class CSoftRayTracer
+	{
+	public:
+
+		static constexpr unsigned int TileSize = 16;
+
+		CSoftRayTracer() = delete;
+		CSoftRayTracer(const CSoftRayTracer&) = delete;
+		CSoftRayTracer(const CSoftRayTracer&&) = delete;
+		CSoftRayTracer& operator=(const CSoftRayTracer&) = delete;
+		CSoftRayTracer& operator=(const CSoftRayTracer&&) = delete;
+
+		// 0 threads uses one per hardware thread
+		CSoftRayTracer(unsigned int width, unsigned int height, unsigned int numThreads = 0);
+
+		void Resize(unsigned int width, unsigned int height);
+
+		// Rebuild the top level BVH, the scene is copied but the BVHs and textures it points to have to stay alive
+		void SetScene(const SSoftTraceScene& scene);
+
+		// Render the scene seen from a camera, the matrices are the camera world and projection matrices
+		void Render(const CMatrix4x4& cameraMatrix, const CMatrix4x4& projectionMatrix);
+
+		// Colour buffer of the last frame, saturated to 8 bits per channel
+		CSoftImage Image() const;
+
+		const std::vector<CVector3>& Colour() const { return mColour; }
+
+		//--------------------------
+		// Tracing
+		//--------------------------
+
+		// Closest hit in the scene
+		bool Trace(const SSoftRay& ray, unsigned int flags, SSoftHit& hit) const;
+
+		// Any hit in the scene
+		bool Occluded(const SSoftRay& ray) const;
+
+		// Colour of a ray shaded like a primary ray of RayGen.hlsl, missRamp is the vertical position used by the miss shader (0-1)
+		CVector3 Radiance(const SSoftRay& ray, float missRamp = 0) const;
+
+		// Fraction of the cosine weighted hemisphere around the normal that is not occluded within maxDistance
+		float AmbientOcclusion(const CVector3& position, const CVector3& normal, unsigned int numSamples = 64, float maxDistance = 10) const;
+
+		//--------------------------
+		// Setters / Getters
+		//--------------------------
+
+		SSoftTraceSettings& Settings() { return mSettings; }
+
+		const SSoftTraceStats& Stats() const { return mStats; }
+
+		unsigned int Width() const { return mWidth; }
+		unsigned int Height() const { return mHeight; }
+		unsigned int ThreadCount() const { return mScheduler.ThreadCount(); }
+
+	private:
+
+		// Rays traced while rendering a tile, summed after the frame
+		struct STileStats
+		{
+			size_t primaryRays   = 0;
+			size_t secondaryRays = 0;
+			size_t shadowRays    = 0;
+		};
+
+		void RenderTile(size_t tile, const CMatrix4x4& cameraMatrix, float invE00, float invE11);
+
+		// TraceRay with the hit group 0 and the miss shader 0
+		CVector3 TraceRadiance(const SSoftRay& ray, unsigned int flags, unsigned int depth, float missRamp, STileStats& stats) const;
+
+		CVector3 ClosestHit(const SSoftRay& ray, const SSoftHit& hit, unsigned int depth, float missRamp, STileStats& stats) const;
+
+		static CVector3 Miss(float missRamp);
+
+		unsigned int mWidth  = 0;
+		unsigned int mHeight = 0;
+
+		std::vector<CVector3>   mColour;
+		std::vector<STileStats> mTileStats;
+
+		SSoftTraceScene    mScene;
+		CSoftTLAS          mTLAS;
+		SSoftTraceSettings mSettings;
+		SSoftTraceStats    mStats;
+
+		CSoftTileScheduler mScheduler;
+	};
+}
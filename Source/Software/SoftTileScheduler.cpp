@@ -0,0 +1,89 @@
+#include "SoftTileScheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+namespace Software
+{
+	namespace
+	{
+		// A range is packed in one word so it can be updated with a single compare and swap
+		uint64_t Pack(uint32_t begin, uint32_t end) { return uint64_t(begin) << 32 | end; }
+		uint32_t Begin(uint64_t range) { return static_cast<uint32_t>(range >> 32); }
+		uint32_t End(uint64_t range) { return static_cast<uint32_t>(range); }
+	}
+
+	CSoftTileScheduler::CSoftTileScheduler(unsigned int numThreads) :
+		mPool(numThreads)
+	{
+	}
+
+	void CSoftTileScheduler::Run(size_t count, const std::function<void(size_t)>& job)
+	{
+		mSteals = 0;
+
+		if (count == 0) return;
+
+		if (count > UINT32_MAX) throw std::runtime_error("Too many items to schedule");
+
+		const auto numWorkers = static_cast<unsigned int>(std::min<size_t>(mPool.get_thread_count(), count));
+
+		const auto ranges = std::make_unique<std::atomic<uint64_t>[]>(numWorkers);
+		for (unsigned int w = 0; w < numWorkers; ++w)
+		{
+			ranges[w] = Pack(static_cast<uint32_t>(count * w / numWorkers), static_cast<uint32_t>(count * (w + 1) / numWorkers));
+		}
+
+		std::atomic<size_t> steals = 0;
+
+		for (unsigned int w = 0; w < numWorkers; ++w)
+		{
+			mPool.push_task([&, w]
+				{
+					auto& own = ranges[w];
+
+					while (true)
+					{
+						// Own range, from the front
+						auto range = own.load();
+						if (Begin(range) < End(range))
+						{
+							if (own.compare_exchange_weak(range, Pack(Begin(range) + 1, End(range)))) job(Begin(range));
+							continue;
+						}
+
+						// Steal the back half of the first worker that still has something
+						bool stolen = false;
+						for (unsigned int i = 1; i < numWorkers && !stolen; ++i)
+						{
+							auto& victim = ranges[(w + i) % numWorkers];
+
+							auto victimRange = victim.load();
+							while (Begin(victimRange) < End(victimRange))
+							{
+								const auto mid = Begin(victimRange) + (End(victimRange) - Begin(victimRange)) / 2;
+								if (victim.compare_exchange_weak(victimRange, Pack(Begin(victimRange), mid)))
+								{
+									// Only this worker refills its own range, thieves only ever shrink it
+									own.store(Pack(mid, End(victimRange)));
+									steals += End(victimRange) - mid;
+									stolen = true;
+									break;
+								}
+							}
+						}
+
+						// Items taken by other thieves in the meantime are finished by them
+						if (!stolen) return;
+					}
+				});
+		}
+
+		mPool.wait_for_tasks();
+
+		mSteals = steals;
+	}
+}
@@ -0,0 +1,46 @@
+//--------------------------------------------------------------------------------------
+// Work stealing scheduler for the CPU renderers
+//--------------------------------------------------------------------------------------
+// Splits a range of work items (tiles) evenly between the workers, then every worker takes
+// items from the front of its own range and, once it runs dry, steals the back half of the
+// range of another worker. The cost of a tile varies a lot when tracing rays (sky against
+// geometry, secondary rays), so this keeps all the threads busy until the end of the frame
+// without the per item locking of a shared queue.
+
+#pragma once
+
+#include <functional>
+
+#include <thread_pool.hpp>
+
+namespace Software
+{
+	class CSoftTileScheduler
+	{
+	public:
+
+		CSoftTileScheduler() = delete;
+		CSoftTileScheduler(const CSoftTileScheduler&) = delete;
+		CSoftTileScheduler(const CSoftTileScheduler&&) = delete;
+		CSoftTileScheduler& operator=(const CSoftTileScheduler&) = delete;
+		CSoftTileScheduler& operator=(const CSoftTileScheduler&&) = delete;
+
+		// 0 threads uses one per hardware thread
+		explicit CSoftTileScheduler(unsigned int numThreads = 0);
+
+		// Calls job(item) once for every item in [0, count) and returns when all of them are done.
+		// The order is not defined, the job must only write to what belongs to its item
+		void Run(size_t count, const std::function<void(size_t)>& job);
+
+		unsigned int ThreadCount() const { return mPool.get_thread_count(); }
+
+		// Items taken from another worker's range in the last Run
+		size_t Steals() const { return mSteals; }
+
+	private:
+
+		thread_pool mPool;
+
+		size_t mSteals = 0;
+	};
+}
@@ -1,8 +1,60 @@
 #pragma once
+#include <algorithm>
+#include <cctype>
 #include <filesystem>
 #include <stdexcept>
+#include <string>
 #include <system_error>
 
+// The images the texture cooker turns into DDS files
+inline bool IsTextureSource(const std::filesystem::path& file)
+{
+	auto extension = file.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+	return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp";
+}
+
+// The DDS file the texture cooker writes next to a source
+inline std::filesystem::path CookedTexturePath(const std::filesystem::path& source)
+{
+	return std::filesystem::path(source).replace_extension(".dds");
+}
+
+// The cooked DDS file of a texture if there is one at least as recent as the source, the file itself otherwise
+inline std::string CookedTextureName(const std::string& fileName)
+{
+	const std::filesystem::path source(fileName);
+	if (!IsTextureSource(source)) return fileName;
+
+	const auto cooked = CookedTexturePath(source);
+
+	std::error_code ec;
+	const auto cookedTime = std::filesystem::last_write_time(cooked, ec);
+	if (ec) return fileName;
+
+	const auto sourceTime = std::filesystem::last_write_time(source, ec);
+	if (ec || cookedTime < sourceTime) return fileName;
+
+	return cooked.string();
+}
+
+// A DDS file written by the cooker, the listings keep its source only and the loaders pick it from there
+inline bool IsCookedTexture(const std::filesystem::path& file)
+{
+	auto extension = file.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	if (extension != ".dds") return false;
+
+	std::error_code ec;
+	for (const auto source : { ".png", ".jpg", ".jpeg", ".tga", ".bmp" })
+	{
+		if (std::filesystem::exists(std::filesystem::path(file).replace_extension(source), ec)) return true;
+	}
+
+	return false;
+}
+
 inline void GetFilesWithID(const std::string& dirPath, std::vector<std::string>& fileNames,const std::string& id)
 {
 	//iterate through the directory
@@ -16,7 +68,7 @@ inline void GetFilesWithID(const std::string& dirPath, std::vector<std::string>&
 		{
 			auto filename = iter->path().filename().string();
 
-			if (filename.find(id) != std::string::npos)
+			if (filename.find(id) != std::string::npos && !IsCookedTexture(iter->path()))
 			{
 				fileNames.push_back(iter->path().filename().string());
 				iter.disable_recursion_pending();
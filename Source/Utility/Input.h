@@ -20,7 +20,7 @@ enum KeyState
 };
 
 // Key and button codes
-enum KeyCode
+enum KeyCode : int
 {
   Mouse_LButton  = 0x01,  // Left mouse button
   Mouse_RButton  = 0x02,  // Right mouse button
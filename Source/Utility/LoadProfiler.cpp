@@ -0,0 +1,326 @@
+#include "LoadProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <Psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+	thread_local std::string gCurrentEntity;
+
+	std::string Escape(const std::string& str)
+	{
+		std::string escaped;
+		escaped.reserve(str.size());
+
+		for (const auto c : str)
+		{
+			switch (c)
+			{
+			case '"':  escaped += "\\\""; break;
+			case '\\': escaped += "\\\\"; break;
+			case '\n': escaped += "\\n";  break;
+			case '\t': escaped += "\\t";  break;
+			default:
+				if (static_cast<unsigned char>(c) >= 0x20) escaped += c;
+			}
+		}
+
+		return escaped;
+	}
+
+	double ToMs(uint64_t us) { return static_cast<double>(us) / 1000.0; }
+
+	// Keeps the order things were first seen in, reports read better that way
+	template <typename T>
+	T& FindOrAdd(std::vector<std::pair<std::string, T>>& items, const std::string& key)
+	{
+		const auto it = std::find_if(items.begin(), items.end(), [&](const auto& item) { return item.first == key; });
+		if (it != items.end()) return it->second;
+		items.emplace_back(key, T{});
+		return items.back().second;
+	}
+
+	void WriteMsMap(std::ostringstream& out, const std::vector<std::pair<std::string, uint64_t>>& items)
+	{
+		out << "{";
+		for (size_t i = 0; i < items.size(); ++i)
+		{
+			out << (i ? ", " : "") << "\"" << Escape(items[i].first) << "\": " << ToMs(items[i].second);
+		}
+		out << "}";
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// Session
+//--------------------------------------------------------------------------------------
+
+CLoadProfiler& CLoadProfiler::Instance()
+{
+	static CLoadProfiler profiler;
+	return profiler;
+}
+
+void CLoadProfiler::BeginSession(const std::string& name)
+{
+	std::unique_lock l(mMutex);
+
+	mSessionName = name;
+	mEvents.clear();
+	mBytesRead.clear();
+	mSessionDuration = 0;
+	mPeakMemory = 0;
+	mSessionStart = Clock::now();
+	mRecording = true;
+}
+
+void CLoadProfiler::EndSession()
+{
+	std::string outputPath;
+	{
+		std::unique_lock l(mMutex);
+
+		if (!mRecording) return;
+
+		mRecording = false;
+		mSessionDuration = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - mSessionStart).count();
+		mPeakMemory = PeakMemory();
+
+		outputPath = mOutputPath;
+	}
+
+	if (!outputPath.empty()) WriteReports(outputPath);
+}
+
+void CLoadProfiler::SetOutputPath(const std::string& basePath)
+{
+	std::unique_lock l(mMutex);
+	mOutputPath = basePath;
+}
+
+//--------------------------------------------------------------------------------------
+// Recording
+//--------------------------------------------------------------------------------------
+
+uint64_t CLoadProfiler::Now() const
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - mSessionStart).count();
+}
+
+void CLoadProfiler::AddEvent(SLoadEvent event)
+{
+	if (!mRecording) return;
+
+	std::unique_lock l(mMutex);
+	mEvents.push_back(std::move(event));
+}
+
+void CLoadProfiler::AddBytesRead(const std::string& fileName, uint64_t bytes)
+{
+	if (!mRecording) return;
+
+	std::unique_lock l(mMutex);
+	mBytesRead[fileName] += bytes;
+}
+
+uint64_t CLoadProfiler::BytesRead() const
+{
+	std::unique_lock l(mMutex);
+
+	uint64_t total = 0;
+	for (const auto& [file, bytes] : mBytesRead) total += bytes;
+	return total;
+}
+
+uint64_t CLoadProfiler::PeakMemory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters = {};
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return counters.PeakWorkingSetSize;
+	return 0;
+#else
+	rusage usage = {};
+	if (getrusage(RUSAGE_SELF, &usage) == 0) return static_cast<uint64_t>(usage.ru_maxrss) * 1024; // Reported in KB
+	return 0;
+#endif
+}
+
+uint32_t CLoadProfiler::ThreadIndex()
+{
+	static std::atomic<uint32_t> nextIndex = 0;
+	thread_local const uint32_t index = nextIndex++;
+	return index;
+}
+
+//--------------------------------------------------------------------------------------
+// Reports
+//--------------------------------------------------------------------------------------
+
+std::string CLoadProfiler::JsonReport() const
+{
+	std::unique_lock l(mMutex);
+
+	struct SStage { uint64_t count = 0; uint64_t total = 0; uint64_t max = 0; };
+
+	using MsMap = std::vector<std::pair<std::string, uint64_t>>;
+
+	std::vector<std::pair<std::string, SStage>> stages;
+	std::vector<std::pair<std::string, MsMap>>  entities;
+	std::vector<std::pair<std::string, MsMap>>  assets;
+	std::vector<uint32_t>                       threads;
+
+	for (const auto& event : mEvents)
+	{
+		auto& stage = FindOrAdd(stages, event.name);
+		stage.count++;
+		stage.total += event.duration;
+		stage.max = std::max(stage.max, event.duration);
+
+		if (!event.entity.empty()) FindOrAdd(FindOrAdd(entities, event.entity), event.name) += event.duration;
+
+		if (!event.detail.empty()) FindOrAdd(FindOrAdd(assets, event.detail), event.name) += event.duration;
+
+		if (std::find(threads.begin(), threads.end(), event.thread) == threads.end()) threads.push_back(event.thread);
+	}
+
+	uint64_t bytesRead = 0;
+	for (const auto& [file, bytes] : mBytesRead) bytesRead += bytes;
+
+	std::ostringstream out;
+
+	out << "{\n";
+	out << "  \"session\": \"" << Escape(mSessionName) << "\",\n";
+	out << "  \"total_ms\": " << ToMs(mSessionDuration) << ",\n";
+	out << "  \"bytes_read\": " << bytesRead << ",\n";
+	out << "  \"peak_memory_bytes\": " << mPeakMemory << ",\n";
+	out << "  \"threads\": " << threads.size() << ",\n";
+
+	out << "  \"stages\": [\n";
+	for (size_t i = 0; i < stages.size(); ++i)
+	{
+		const auto& [name, stage] = stages[i];
+		out << "    { \"name\": \"" << Escape(name) << "\", \"count\": " << stage.count
+			<< ", \"total_ms\": " << ToMs(stage.total) << ", \"max_ms\": " << ToMs(stage.max) << " }"
+			<< (i + 1 < stages.size() ? ",\n" : "\n");
+	}
+	out << "  ],\n";
+
+	// Entity totals only count the per entity scopes, the nested ones are already part of them
+	out << "  \"entities\": [\n";
+	for (size_t i = 0; i < entities.size(); ++i)
+	{
+		const auto& [name, entityStages] = entities[i];
+
+		uint64_t total = 0;
+		for (const auto& event : mEvents)
+			if (event.entity == name && event.category == "entity") total += event.duration;
+
+		out << "    { \"name\": \"" << Escape(name) << "\", \"total_ms\": " << ToMs(total) << ", \"stages\": ";
+		WriteMsMap(out, entityStages);
+		out << " }" << (i + 1 < entities.size() ? ",\n" : "\n");
+	}
+	out << "  ],\n";
+
+	out << "  \"assets\": [\n";
+	for (size_t i = 0; i < assets.size(); ++i)
+	{
+		const auto& [file, assetStages] = assets[i];
+
+		const auto bytes = mBytesRead.find(file);
+
+		out << "    { \"file\": \"" << Escape(file) << "\", \"bytes\": " << (bytes != mBytesRead.end() ? bytes->second : 0) << ", \"stages\": ";
+		WriteMsMap(out, assetStages);
+		out << " }" << (i + 1 < assets.size() ? ",\n" : "\n");
+	}
+	out << "  ]\n";
+	out << "}\n";
+
+	return out.str();
+}
+
+std::string CLoadProfiler::ChromeTrace() const
+{
+	std::unique_lock l(mMutex);
+
+	std::ostringstream out;
+
+	out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+	out << "  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"" << Escape(mSessionName) << "\"}}";
+
+	for (const auto& event : mEvents)
+	{
+		out << ",\n  {\"name\": \"" << Escape(event.name) << "\", \"cat\": \"" << Escape(event.category)
+			<< "\", \"ph\": \"X\", \"ts\": " << event.start << ", \"dur\": " << event.duration
+			<< ", \"pid\": 1, \"tid\": " << event.thread
+			<< ", \"args\": {\"entity\": \"" << Escape(event.entity) << "\", \"file\": \"" << Escape(event.detail) << "\"}}";
+	}
+
+	out << "\n]}\n";
+
+	return out.str();
+}
+
+bool CLoadProfiler::WriteReports(const std::string& basePath) const
+{
+	std::ofstream json(basePath + ".json");
+	json << JsonReport();
+
+	std::ofstream trace(basePath + ".trace.json");
+	trace << ChromeTrace();
+
+	return json.good() && trace.good();
+}
+
+//--------------------------------------------------------------------------------------
+// Scopes
+//--------------------------------------------------------------------------------------
+
+CLoadScope::CLoadScope(const char* name, const char* category, std::string detail) :
+	mName(name),
+	mCategory(category),
+	mDetail(std::move(detail)),
+	mStart(0),
+	mActive(CLoadProfiler::Instance().Recording())
+{
+	if (mActive) mStart = CLoadProfiler::Instance().Now();
+}
+
+CLoadScope::~CLoadScope()
+{
+	End();
+}
+
+void CLoadScope::End()
+{
+	if (!mActive) return;
+
+	mActive = false;
+
+	auto& profiler = CLoadProfiler::Instance();
+
+	profiler.AddEvent({ mName, mCategory, gCurrentEntity, std::move(mDetail), mStart, profiler.Now() - mStart, CLoadProfiler::ThreadIndex() });
+}
+
+CLoadEntityScope::CLoadEntityScope(const std::string& entity) :
+	mPrevious(gCurrentEntity)
+{
+	gCurrentEntity = entity;
+}
+
+CLoadEntityScope::~CLoadEntityScope()
+{
+	gCurrentEntity = mPrevious;
+}
+
+const std::string& CLoadEntityScope::Current()
+{
+	return gCurrentEntity;
+}
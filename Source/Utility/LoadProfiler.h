@@ -0,0 +1,146 @@
+//--------------------------------------------------------------------------------------
+// Load profiler
+//--------------------------------------------------------------------------------------
+// Records timed scopes while a scene is loading and writes a JSON report (per stage,
+// per entity and per asset timings, bytes read, peak memory) and a Chrome trace
+// (chrome://tracing or ui.perfetto.dev).
+// Plain C++, no dependency on a window or a device so it runs in headless builds.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct SLoadEvent
+{
+	std::string name;
+	std::string category;
+	std::string entity;   // Entity being loaded when the event was recorded, can be empty
+	std::string detail;   // Usually the file the event worked on
+	uint64_t    start;    // Microseconds since the session began
+	uint64_t    duration; // Microseconds
+	uint32_t    thread;
+};
+
+class CLoadProfiler
+{
+public:
+
+	CLoadProfiler(const CLoadProfiler&) = delete;
+	CLoadProfiler(const CLoadProfiler&&) = delete;
+	CLoadProfiler& operator=(const CLoadProfiler&) = delete;
+	CLoadProfiler& operator=(const CLoadProfiler&&) = delete;
+
+	static CLoadProfiler& Instance();
+
+	// Discard the previous session and start recording
+	void BeginSession(const std::string& name);
+
+	// Stop recording, writes <path>.json and <path>.trace.json if an output path is set
+	void EndSession();
+
+	bool Recording() const { return mRecording; }
+
+	// Base path (without extension) of the reports, empty to disable writing them
+	void SetOutputPath(const std::string& basePath);
+
+	//--------------------------------------------------------------------------------------
+	// Recording, all thread safe
+	//--------------------------------------------------------------------------------------
+
+	// Microseconds since the session began
+	uint64_t Now() const;
+
+	void AddEvent(SLoadEvent event);
+
+	void AddBytesRead(const std::string& fileName, uint64_t bytes);
+
+	//--------------------------------------------------------------------------------------
+	// Reports
+	//--------------------------------------------------------------------------------------
+
+	std::string JsonReport() const;
+
+	std::string ChromeTrace() const;
+
+	bool WriteReports(const std::string& basePath) const;
+
+	uint64_t BytesRead() const;
+
+	// Peak resident memory of the process, in bytes
+	static uint64_t PeakMemory();
+
+	static uint32_t ThreadIndex();
+
+private:
+
+	CLoadProfiler() = default;
+
+	using Clock = std::chrono::steady_clock;
+
+	mutable std::mutex mMutex;
+
+	std::atomic<bool> mRecording = false;
+	std::string       mSessionName;
+	std::string       mOutputPath;
+	Clock::time_point mSessionStart;
+	uint64_t          mSessionDuration = 0;
+	uint64_t          mPeakMemory = 0;
+
+	std::vector<SLoadEvent>                   mEvents;
+	std::unordered_map<std::string, uint64_t> mBytesRead;
+};
+
+
+// Times the enclosing scope, does nothing if the profiler is not recording
+class CLoadScope
+{
+public:
+
+	CLoadScope(const char* name, const char* category, std::string detail = "");
+
+	CLoadScope(const CLoadScope&) = delete;
+	CLoadScope(const CLoadScope&&) = delete;
+	CLoadScope& operator=(const CLoadScope&) = delete;
+	CLoadScope& operator=(const CLoadScope&&) = delete;
+
+	~CLoadScope();
+
+	// Record the event now rather than at the end of the scope
+	void End();
+
+private:
+
+	const char* mName;
+	const char* mCategory;
+	std::string mDetail;
+	uint64_t    mStart;
+	bool        mActive;
+};
+
+
+// Attributes the events recorded on this thread to an entity while in scope
+class CLoadEntityScope
+{
+public:
+
+	explicit CLoadEntityScope(const std::string& entity);
+
+	CLoadEntityScope(const CLoadEntityScope&) = delete;
+	CLoadEntityScope(const CLoadEntityScope&&) = delete;
+	CLoadEntityScope& operator=(const CLoadEntityScope&) = delete;
+	CLoadEntityScope& operator=(const CLoadEntityScope&&) = delete;
+
+	~CLoadEntityScope();
+
+	static const std::string& Current();
+
+private:
+
+	std::string mPrevious;
+};
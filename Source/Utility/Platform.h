@@ -0,0 +1,14 @@
+//--------------------------------------------------------------------------------------
+// Platform types
+//--------------------------------------------------------------------------------------
+// The engine interface and the scene use the Windows integer types. The windowed backends
+// get them (and ComPtr) from the Windows headers, the headless backends built on other
+// platforms only need the types.
+
+#pragma once
+
+#ifdef _WIN32
+#include <wrl.h>
+#else
+using UINT = unsigned int;
+#endif
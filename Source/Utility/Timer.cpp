@@ -4,7 +4,43 @@
 
 
 #include "Timer.h"
+
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include <chrono>
+
+namespace
+{
+	// The steady clock in place of the Windows counters, in nanoseconds and milliseconds
+	struct LARGE_INTEGER
+	{
+		int64_t QuadPart;
+	};
+
+	int64_t Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	bool QueryPerformanceFrequency(LARGE_INTEGER* frequency)
+	{
+		frequency->QuadPart = 1000000000;
+		return true;
+	}
+
+	bool QueryPerformanceCounter(LARGE_INTEGER* counter)
+	{
+		counter->QuadPart = Now();
+		return true;
+	}
+
+	uint32_t timeGetTime()
+	{
+		return static_cast<uint32_t>(Now() / 1000000);
+	}
+}
+#endif
 
 // Constructor //
 
@@ -1,6 +1,8 @@
 
 #include "Window.h"
+#ifdef _WIN32
 #include <intsafe.h>
+#endif
 #include <stdexcept>
 
 
@@ -20,14 +22,18 @@ void CWindow::SetWindowSize(UINT x, UINT y)
 	mWindowWidth = x;
 }
 
-HWND CWindow::GetHandle()
+CWindow::~CWindow()
 {
-	return mHWnd;
+#ifdef _WIN32
+	DestroyWindow(mHWnd);
+#endif
 }
 
-CWindow::~CWindow()
+// Only the windowed backends create windows, the headless ones are built without the Windows headers
+#ifdef _WIN32
+HWND CWindow::GetHandle()
 {
-	DestroyWindow(mHWnd);
+	return mHWnd;
 }
 
 extern LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
@@ -89,3 +95,4 @@ CWindow::CWindow(HINSTANCE hInstance, int nCmdShow)
 	UpdateWindow(mHWnd);
 }
 
+#endif
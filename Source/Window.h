@@ -6,7 +6,9 @@ class CWindow
 {
 public:
 
+#ifdef _WIN32
 	CWindow(HINSTANCE hInstance, int nCmdShow);
+#endif
 
 	UINT GetWindowWidth();
 
@@ -15,7 +17,9 @@ public:
 	// only for internal use, this will not resize the window, it will only change internal values
 	void SetWindowSize(UINT x, UINT y);
 
+#ifdef _WIN32
 	HWND GetHandle();
+#endif
 
 	~CWindow();
 
@@ -24,6 +28,8 @@ private:
 	UINT mWindowWidth = 1920;
 	UINT mWindowHeight = 1080;
 
+#ifdef _WIN32
 	HWND mHWnd;
+#endif
 
 };
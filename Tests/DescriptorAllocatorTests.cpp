@@ -0,0 +1,207 @@
+#include "TestHarness.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "../Source/DX12/DX12DescriptorAllocator.h"
+
+using namespace DX12;
+
+TEST(TablesAreContiguousInOnePage)
+{
+	std::vector<uint32_t> pages;
+	CDX12DescriptorAllocator allocator(64, 0, [&](uint32_t page) { pages.push_back(page); });
+	CHECK(pages.empty());
+
+	const auto a = allocator.Allocate(40);
+	CHECK_EQ(a, 0u);
+	CHECK_EQ(pages.size(), 1u);
+
+	// Does not fit in what is left of page 0
+	const auto b = allocator.Allocate(40);
+	CHECK_EQ(b, 64u);
+	CHECK_EQ(pages.size(), 2u);
+	CHECK_EQ(pages[1], 1u);
+
+	// First fit, back in page 0
+	const auto c = allocator.Allocate(24);
+	CHECK_EQ(c, 40u);
+
+	const auto stats = allocator.Stats();
+	CHECK_EQ(stats.pages, 2u);
+	CHECK_EQ(stats.capacity, 128u);
+	CHECK_EQ(stats.allocated, 104u);
+
+	allocator.Validate();
+
+	CHECK_THROWS(allocator.Allocate(0), std::logic_error);
+	CHECK_THROWS(allocator.Allocate(65), std::logic_error);
+	CHECK_THROWS(CDX12DescriptorAllocator(0, 0), std::logic_error);
+}
+
+TEST(FreedRangesMerge)
+{
+	CDX12DescriptorAllocator allocator(64, 1);
+
+	const auto a = allocator.Allocate(16);
+	const auto b = allocator.Allocate(16);
+	const auto c = allocator.Allocate(16);
+	const auto d = allocator.Allocate(16);
+	CHECK_EQ(allocator.Allocate(2), CDX12DescriptorAllocator::InvalidIndex);
+
+	allocator.Free(a, 16);
+	allocator.Free(c, 16);
+	allocator.Validate();
+	CHECK_EQ(allocator.Allocate(32), CDX12DescriptorAllocator::InvalidIndex);
+
+	// b joins a and c into one range
+	allocator.Free(b, 16);
+	allocator.Validate();
+	CHECK_EQ(allocator.Allocate(48), a);
+
+	allocator.Free(a, 48);
+	allocator.Free(d, 16);
+	allocator.Validate();
+	CHECK_EQ(allocator.Stats().allocated, 0u);
+	CHECK_EQ(allocator.Allocate(64), 0u);
+
+	CHECK_THROWS(allocator.Free(60, 8), std::logic_error);
+	CHECK_THROWS(allocator.Free(64, 2), std::logic_error);
+}
+
+TEST(DoubleFreesAreCaught)
+{
+	CDX12DescriptorAllocator allocator(64, 1);
+
+	const auto a = allocator.Allocate(8);
+	allocator.Free(a, 8);
+	CHECK_THROWS(allocator.Free(a + 2, 2), std::logic_error);
+}
+
+TEST(SingleDescriptorsGoThroughTheThreadCache)
+{
+	CDX12DescriptorAllocator allocator(64, 1);
+
+	// The first one fills half the cache, lowest indices first
+	const auto a = allocator.Allocate();
+	const auto b = allocator.Allocate();
+	CHECK_EQ(a, 0u);
+	CHECK_EQ(b, 1u);
+
+	auto stats = allocator.Stats();
+	CHECK_EQ(stats.allocated, 2u);
+	CHECK_EQ(stats.cached, CDX12DescriptorAllocator::ThreadCacheSize / 2 - 2);
+
+	// Frees go back to the cache, and are handed out again first
+	allocator.Free(a);
+	CHECK_EQ(allocator.Stats().cached, CDX12DescriptorAllocator::ThreadCacheSize / 2 - 1);
+	CHECK_EQ(allocator.Allocate(), a);
+
+	allocator.Validate();
+
+	allocator.FlushThreadCaches();
+	stats = allocator.Stats();
+	CHECK_EQ(stats.cached, 0u);
+	CHECK_EQ(stats.allocated, 2u);
+	allocator.Validate();
+}
+
+TEST(FullPagesTakeBackOtherThreadsCaches)
+{
+	CDX12DescriptorAllocator allocator(16, 1);
+
+	// Another thread takes one descriptor, its cache keeps the rest of its refill
+	uint32_t other = CDX12DescriptorAllocator::InvalidIndex;
+	std::thread([&] { other = allocator.Allocate(); }).join();
+	CHECK(other != CDX12DescriptorAllocator::InvalidIndex);
+
+	// This thread can still get every other descriptor of the page
+	std::vector<uint32_t> indices;
+	for (;;)
+	{
+		const auto index = allocator.Allocate();
+		if (index == CDX12DescriptorAllocator::InvalidIndex) break;
+		indices.push_back(index);
+	}
+
+	CHECK_EQ(indices.size(), 15u);
+	CHECK(std::find(indices.begin(), indices.end(), other) == indices.end());
+	allocator.Validate();
+}
+
+TEST(DeferredFreesWaitForTheFence)
+{
+	CDX12DescriptorAllocator allocator(16, 1);
+
+	const auto a = allocator.Allocate(8);
+	const auto b = allocator.Allocate(8);
+
+	allocator.Free(b, 8, 2);
+	allocator.Free(a, 8, 1);
+	CHECK_EQ(allocator.Stats().pendingFree, 16u);
+	CHECK_EQ(allocator.Stats().allocated, 16u);
+	allocator.Validate();
+
+	// Still in use, not handed out again
+	allocator.ProcessDeferredFrees(0);
+	CHECK_EQ(allocator.Allocate(8), CDX12DescriptorAllocator::InvalidIndex);
+
+	allocator.ProcessDeferredFrees(1);
+	CHECK_EQ(allocator.Stats().pendingFree, 8u);
+	CHECK_EQ(allocator.Allocate(8), a);
+
+	allocator.ProcessDeferredFrees(5);
+	CHECK_EQ(allocator.Stats().pendingFree, 0u);
+	CHECK_EQ(allocator.Allocate(8), b);
+	allocator.Validate();
+
+	CHECK_THROWS(allocator.Free(16, 1, 3), std::logic_error);
+	CHECK_THROWS(allocator.Free(a, 0, 3), std::logic_error);
+}
+
+TEST(RingRetiresFramesInOrder)
+{
+	CDX12DescriptorRing ring(16);
+
+	CHECK_EQ(ring.Allocate(6), 0u);
+	CHECK_EQ(ring.Allocate(4), 6u);
+	ring.EndFrame(1);
+
+	CHECK_EQ(ring.Allocate(4), 10u);
+	ring.EndFrame(2);
+	CHECK_EQ(ring.Used(), 14u);
+
+	// 2 left at the end and nothing retired
+	CHECK_EQ(ring.Allocate(4), CDX12DescriptorRing::InvalidIndex);
+
+	ring.Retire(0);
+	CHECK_EQ(ring.Used(), 14u);
+	ring.Retire(1);
+	CHECK_EQ(ring.Used(), 4u);
+
+	// Wraps, the 2 skipped at the end count as used by the frame
+	CHECK_EQ(ring.Allocate(4), 0u);
+	CHECK_EQ(ring.Used(), 10u);
+	ring.EndFrame(3);
+
+	// Does not reach into frame 2's descriptors
+	CHECK_EQ(ring.Allocate(8), CDX12DescriptorRing::InvalidIndex);
+	CHECK_EQ(ring.Allocate(6), 4u);
+	ring.EndFrame(4);
+
+	ring.Retire(4);
+	CHECK_EQ(ring.Used(), 0u);
+
+	// An empty ring starts over
+	CHECK_EQ(ring.Allocate(16), 0u);
+
+	// Nothing allocated, no frame recorded
+	ring.EndFrame(5);
+	ring.EndFrame(6);
+	ring.Retire(6);
+	CHECK_EQ(ring.Used(), 0u);
+
+	CHECK_EQ(ring.Allocate(0), CDX12DescriptorRing::InvalidIndex);
+	CHECK_EQ(ring.Allocate(17), CDX12DescriptorRing::InvalidIndex);
+	CHECK_THROWS(CDX12DescriptorRing(0), std::logic_error);
+}
@@ -0,0 +1,187 @@
+#include "TestHarness.h"
+
+#include "../Source/DX12/DX12FramePacer.h"
+
+using namespace DX12;
+
+namespace
+{
+	// Milliseconds, the timings are floats
+	constexpr double Tolerance = 1e-3;
+
+	CSimulatedFrameClock& SimulatedClock(CDX12FramePacer& pacer)
+	{
+		return static_cast<CSimulatedFrameClock&>(pacer.Clock());
+	}
+
+	CDX12FramePacer ThroughputPacer(uint32_t maxFramesInFlight)
+	{
+		return CDX12FramePacer(maxFramesInFlight, std::make_unique<CThroughputPacing>(), std::make_unique<CSimulatedFrameClock>());
+	}
+}
+
+TEST(WaitsForTheFenceOfTheOldestFrameOverTheLimit)
+{
+	auto pacer = ThroughputPacer(2);
+	CHECK_EQ(pacer.FenceToWait(), 0u);
+
+	pacer.BeginFrame();
+	pacer.Submit(1);
+	CHECK_EQ(pacer.FenceToWait(), 0u);
+
+	pacer.BeginFrame();
+	pacer.Submit(2);
+	CHECK_EQ(pacer.FramesInFlight(), 2u);
+	CHECK_EQ(pacer.FenceToWait(), 1u);
+
+	pacer.Completed(1);
+	CHECK_EQ(pacer.FramesInFlight(), 1u);
+	CHECK_EQ(pacer.FenceToWait(), 0u);
+
+	// One frame in flight at most, the next waits for the last one
+	pacer.SetMaxFramesInFlight(1);
+	CHECK_EQ(pacer.FenceToWait(), 2u);
+
+	pacer.SetMaxFramesInFlight(0);
+	CHECK_EQ(pacer.MaxFramesInFlight(), 1u);
+
+	// Several frames done at once
+	pacer.SetMaxFramesInFlight(3);
+	pacer.BeginFrame();
+	pacer.Submit(5);
+	pacer.BeginFrame();
+	pacer.Submit(6);
+	CHECK_EQ(pacer.FenceToWait(), 2u);
+	pacer.Completed(5);
+	CHECK_EQ(pacer.FramesInFlight(), 1u);
+	pacer.Validate();
+}
+
+TEST(TimingsFollowTheClock)
+{
+	auto pacer = ThroughputPacer(2);
+	auto& clock = SimulatedClock(pacer);
+
+	pacer.BeginWait();
+	clock.Advance(0.002);
+	pacer.BeginFrame();
+	clock.Advance(0.005);
+	pacer.Submit(1);
+	clock.Advance(0.001);
+	pacer.Presented();
+	clock.Advance(0.010);
+	pacer.Completed(1);
+
+	auto last = pacer.Last();
+	CHECK_NEAR(last.wait, 2.0, Tolerance);
+	CHECK_NEAR(last.sleep, 0.0, Tolerance);
+	CHECK_NEAR(last.cpu, 5.0, Tolerance);
+	CHECK_NEAR(last.present, 1.0, Tolerance);
+	CHECK_NEAR(last.gpu, 11.0, Tolerance);
+	CHECK_NEAR(last.latency, 16.0, Tolerance);
+
+	// Submitted while the GPU was idle, the GPU time starts at the submission
+	pacer.BeginFrame();
+	clock.Advance(0.003);
+	pacer.Submit(2);
+	clock.Advance(0.004);
+	pacer.Completed(2);
+
+	last = pacer.Last();
+	CHECK_NEAR(last.wait, 0.0, Tolerance);
+	CHECK_NEAR(last.present, 0.0, Tolerance);
+	CHECK_NEAR(last.gpu, 4.0, Tolerance);
+	CHECK_NEAR(last.latency, 7.0, Tolerance);
+
+	const auto average = pacer.Average();
+	CHECK_NEAR(average.cpu, 4.0, Tolerance);
+	CHECK_NEAR(average.gpu, 7.5, Tolerance);
+	CHECK_NEAR(average.latency, 11.5, Tolerance);
+}
+
+TEST(GpuTimeStartsWhenThePreviousFrameIsDone)
+{
+	auto pacer = ThroughputPacer(2);
+	auto& clock = SimulatedClock(pacer);
+
+	pacer.BeginFrame();
+	clock.Advance(0.001);
+	pacer.Submit(1);
+	pacer.BeginFrame();
+	clock.Advance(0.001);
+	pacer.Submit(2);
+
+	clock.Advance(0.008);
+	pacer.Completed(1);
+	CHECK_NEAR(pacer.Last().gpu, 9.0, Tolerance);
+
+	// Queued behind frame 1, so its GPU time starts when frame 1 is done
+	clock.Advance(0.006);
+	pacer.Completed(2);
+	CHECK_NEAR(pacer.Last().gpu, 6.0, Tolerance);
+}
+
+TEST(LowLatencyStartsAsTheGpuRunsOut)
+{
+	const CLowLatencyPacing policy(0.001);
+
+	SFramePacingState state;
+	state.now = 1.0;
+	state.cpuTime = 0.004;
+	state.gpuIdle = 1.010;
+	CHECK_NEAR(policy.StartTime(state), 1.005, 1e-9);
+
+	// Already late
+	state.gpuIdle = 1.003;
+	CHECK_NEAR(policy.StartTime(state), 1.0, 1e-9);
+
+	CHECK_NEAR(CThroughputPacing().StartTime(state), 1.0, 1e-9);
+}
+
+TEST(LowLatencyPacerSleeps)
+{
+	CDX12FramePacer pacer(2, std::make_unique<CLowLatencyPacing>(0.001), std::make_unique<CSimulatedFrameClock>());
+	auto& clock = SimulatedClock(pacer);
+
+	// A frame of 4 ms of CPU and 8 ms of GPU for the averages, nothing in flight so no sleep
+	pacer.BeginFrame();
+	CHECK_NEAR(clock.Now(), 0.0, 1e-9);
+	clock.Advance(0.004);
+	pacer.Submit(1);
+	clock.Advance(0.008);
+	pacer.Completed(1);
+
+	pacer.BeginFrame();
+	CHECK_NEAR(clock.Now(), 0.012, 1e-9);
+	clock.Advance(0.004);
+	pacer.Submit(2);
+
+	// The GPU is busy until 0.016 + 0.008, the frame needs 4 ms of CPU and the margin is 1 ms
+	pacer.BeginWait();
+	pacer.BeginFrame();
+	CHECK_NEAR(clock.Now(), 0.019, 1e-9);
+	clock.Advance(0.004);
+	pacer.Submit(3);
+
+	clock.Advance(0.010);
+	pacer.Completed(3);
+	CHECK_NEAR(pacer.Last().sleep, 3.0, Tolerance);
+	pacer.Validate();
+}
+
+TEST(RejectsMisuse)
+{
+	auto pacer = ThroughputPacer(2);
+
+	CHECK_THROWS(pacer.Submit(1), std::logic_error);
+
+	pacer.BeginFrame();
+	CHECK_THROWS(pacer.BeginFrame(), std::logic_error);
+	pacer.Submit(3);
+
+	pacer.BeginFrame();
+	CHECK_THROWS(pacer.Submit(3), std::logic_error);
+	CHECK_THROWS(pacer.SetPolicy(nullptr), std::logic_error);
+	CHECK_THROWS(CDX12FramePacer(2, nullptr), std::logic_error);
+	CHECK_THROWS(CDX12FramePacer(2, std::make_unique<CThroughputPacing>(), nullptr), std::logic_error);
+}
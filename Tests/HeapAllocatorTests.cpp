@@ -0,0 +1,302 @@
+#include "TestHarness.h"
+
+#include <map>
+#include <random>
+
+#include "../Source/DX12/DX12HeapAllocator.h"
+
+using namespace DX12;
+
+namespace
+{
+	// Heaps are numbers, the fence is moved by the test
+	class CFakeHeapSource : public IGpuHeapSource
+	{
+	public:
+
+		void* CreateHeap(EGpuHeapType, EGpuResourceCategory, uint64_t size) override
+		{
+			const auto heap = reinterpret_cast<void*>(++mNextHeap);
+			mHeaps[heap] = size;
+			return heap;
+		}
+
+		void DestroyHeap(void* heap) override
+		{
+			CHECK(mHeaps.erase(heap) == 1);
+		}
+
+		uint64_t CompletedFenceValue() override { return mCompleted; }
+
+		std::map<void*, uint64_t> mHeaps;
+		uint64_t                  mCompleted = 0;
+
+	private:
+
+		uintptr_t mNextHeap = 0;
+	};
+
+	constexpr auto Default = EGpuHeapType::Default;
+	constexpr auto Buffer  = EGpuResourceCategory::Buffer;
+	constexpr auto Texture = EGpuResourceCategory::Texture;
+}
+
+TEST(TLSFAllocatesAlignedBlocks)
+{
+	CTLSFAllocator tlsf(1 << 20, 256);
+	CHECK_EQ(tlsf.Size(), 1u << 20);
+	CHECK_EQ(tlsf.LargestFreeBlock(), 1u << 20);
+
+	const auto a = tlsf.Allocate(100, 256);
+	const auto b = tlsf.Allocate(1000, 4096);
+	const auto c = tlsf.Allocate(65536, 65536);
+	CHECK(a != CTLSFAllocator::InvalidBlock && b != CTLSFAllocator::InvalidBlock && c != CTLSFAllocator::InvalidBlock);
+
+	// Sizes are rounded to the granularity
+	CHECK_EQ(tlsf.BlockSize(a), 256u);
+	CHECK_EQ(tlsf.BlockSize(b), 1024u);
+	CHECK_EQ(tlsf.Offset(b) % 4096, 0u);
+	CHECK_EQ(tlsf.Offset(c) % 65536, 0u);
+	CHECK_EQ(tlsf.Alignment(c), 65536u);
+	CHECK_EQ(tlsf.UsedBytes(), 256u + 1024u + 65536u);
+	CHECK_EQ(tlsf.NumAllocations(), 3u);
+
+	std::vector<uint32_t> blocks;
+	tlsf.Allocations(blocks);
+	CHECK_EQ(blocks.size(), 3u);
+	for (size_t i = 1; i < blocks.size(); ++i) CHECK(tlsf.Offset(blocks[i - 1]) + tlsf.BlockSize(blocks[i - 1]) <= tlsf.Offset(blocks[i]));
+
+	tlsf.Validate();
+
+	CHECK_THROWS(tlsf.Allocate(16, 3), std::logic_error);
+	CHECK_THROWS(CTLSFAllocator(1024, 3), std::logic_error);
+	CHECK_THROWS(CTLSFAllocator(0, 256), std::logic_error);
+}
+
+TEST(TLSFFailsWhenFull)
+{
+	CTLSFAllocator tlsf(4096, 256);
+
+	const auto all = tlsf.Allocate(4096, 256);
+	CHECK(all != CTLSFAllocator::InvalidBlock);
+	CHECK_EQ(tlsf.LargestFreeBlock(), 0u);
+	CHECK_EQ(tlsf.Allocate(256, 256), CTLSFAllocator::InvalidBlock);
+
+	tlsf.Free(all);
+	CHECK(tlsf.Empty());
+	CHECK_EQ(tlsf.Allocate(8192, 256), CTLSFAllocator::InvalidBlock);
+}
+
+TEST(TLSFMergesFreedNeighbours)
+{
+	CTLSFAllocator tlsf(4096, 256);
+
+	uint32_t blocks[16];
+	for (auto& block : blocks) block = tlsf.Allocate(256, 256);
+	CHECK_EQ(tlsf.LargestFreeBlock(), 0u);
+
+	// Every other block, nothing merges
+	for (uint32_t i = 0; i < 16; i += 2) tlsf.Free(blocks[i]);
+	tlsf.Validate();
+	CHECK_EQ(tlsf.LargestFreeBlock(), 256u);
+	CHECK_EQ(tlsf.Allocate(512, 256), CTLSFAllocator::InvalidBlock);
+
+	// Freeing 1 joins 0, 1 and 2
+	tlsf.Free(blocks[1]);
+	tlsf.Validate();
+	CHECK_EQ(tlsf.LargestFreeBlock(), 768u);
+
+	const auto merged = tlsf.Allocate(768, 256);
+	CHECK_EQ(tlsf.Offset(merged), 0u);
+	tlsf.Free(merged);
+
+	for (uint32_t i = 3; i < 16; i += 2) tlsf.Free(blocks[i]);
+	tlsf.Validate();
+	CHECK(tlsf.Empty());
+	CHECK_EQ(tlsf.LargestFreeBlock(), 4096u);
+}
+
+TEST(TLSFStaysConsistentUnderRandomUse)
+{
+	CTLSFAllocator tlsf(16 << 20, 256);
+	std::mt19937 random(1234);
+	std::vector<uint32_t> live;
+
+	for (int i = 0; i < 5000; ++i)
+	{
+		if (live.empty() || random() % 3)
+		{
+			const uint64_t size = 1 + random() % (256 * 1024);
+			const uint64_t alignment = 256ull << (random() % 8);
+			const auto block = tlsf.Allocate(size, alignment);
+			if (block == CTLSFAllocator::InvalidBlock) continue;
+
+			CHECK_EQ(tlsf.Offset(block) % alignment, 0u);
+			CHECK(tlsf.BlockSize(block) >= size);
+			live.push_back(block);
+		}
+		else
+		{
+			const auto index = random() % live.size();
+			tlsf.Free(live[index]);
+			live[index] = live.back();
+			live.pop_back();
+		}
+
+		if (i % 100 == 0) tlsf.Validate();
+	}
+
+	for (const auto block : live) tlsf.Free(block);
+	tlsf.Validate();
+	CHECK_EQ(tlsf.LargestFreeBlock(), tlsf.Size());
+}
+
+TEST(PoolsShareHeapsPerCategory)
+{
+	CFakeHeapSource source;
+	{
+		CDX12HeapAllocator allocator(&source, 1 << 20);
+
+		const auto a = allocator.Allocate(Default, Buffer, 4096, 256);
+		const auto b = allocator.Allocate(Default, Buffer, 4096, 256);
+		const auto t = allocator.Allocate(Default, Texture, 4096, 65536);
+
+		CHECK_EQ(a.heap, b.heap);
+		CHECK(a.heap != t.heap);
+		CHECK(a.offset != b.offset);
+		CHECK_EQ(t.offset % 65536, 0u);
+		CHECK_EQ(source.mHeaps.size(), 2u);
+
+		// Past half a heap, a heap of its own
+		const auto big = allocator.Allocate(Default, Buffer, 600 * 1024, 256);
+		CHECK(big.heap != a.heap);
+		CHECK_EQ(source.mHeaps[big.heap], 600u * 1024);
+
+		auto stats = allocator.Stats(Default, Buffer);
+		CHECK_EQ(stats.heaps, 2u);
+		CHECK_EQ(stats.dedicatedHeaps, 1u);
+		CHECK_EQ(stats.allocations, 3u);
+
+		// The dedicated heap goes with its allocation
+		allocator.Free(big);
+		CHECK_EQ(source.mHeaps.size(), 2u);
+
+		// A full shared heap makes another one
+		std::vector<SGpuAllocation> fill;
+		for (int i = 0; i < 4; ++i) fill.push_back(allocator.Allocate(Default, Buffer, 300 * 1024, 256));
+		CHECK_EQ(fill[2].heap, a.heap);
+		CHECK(fill[3].heap != a.heap);
+		CHECK_EQ(allocator.Stats(Default, Buffer).heaps, 2u);
+
+		// The last empty shared heap of a pool is kept
+		allocator.Free(a);
+		allocator.Free(b);
+		for (const auto& allocation : fill) allocator.Free(allocation);
+		CHECK_EQ(allocator.Stats(Default, Buffer).heaps, 1u);
+		CHECK_EQ(allocator.Stats(Default, Buffer).usedBytes, 0u);
+
+		allocator.Validate();
+		CHECK_THROWS(allocator.Allocate(Default, Buffer, 256, 3), std::logic_error);
+	}
+
+	// The destructor destroys what is left
+	CHECK(source.mHeaps.empty());
+}
+
+TEST(DeferredFreesWaitForTheFence)
+{
+	CFakeHeapSource source;
+	CDX12HeapAllocator allocator(&source, 1 << 20);
+
+	const auto a = allocator.Allocate(Default, Buffer, 4096, 256);
+	const auto b = allocator.Allocate(Default, Buffer, 4096, 256);
+
+	// Not in fence order, as when frees come from several threads
+	allocator.Free(b, 3);
+	allocator.Free(a, 2);
+	CHECK_EQ(allocator.Stats().pendingFreeBytes, 8192u);
+
+	source.mCompleted = 1;
+	allocator.ProcessDeferredFrees();
+	CHECK_EQ(allocator.Stats().allocations, 2u);
+
+	// Still in use by the GPU, not handed out again
+	const auto c = allocator.Allocate(Default, Buffer, 4096, 256);
+	CHECK(c.offset != a.offset && c.offset != b.offset);
+
+	source.mCompleted = 2;
+	allocator.ProcessDeferredFrees();
+	CHECK_EQ(allocator.Stats().allocations, 2u);
+	CHECK_EQ(allocator.Stats().pendingFreeBytes, 4096u);
+
+	source.mCompleted = 3;
+	allocator.ProcessDeferredFrees();
+	CHECK_EQ(allocator.Stats().allocations, 1u);
+	CHECK_EQ(allocator.Stats().pendingFreeBytes, 0u);
+
+	allocator.Validate();
+}
+
+TEST(DefragmentEmptiesTheLeastUsedHeap)
+{
+	CFakeHeapSource source;
+	CDX12HeapAllocator allocator(&source, 1 << 20);
+
+	// A full heap and a half full one, then most of the first one freed
+	std::vector<SGpuAllocation> allocations;
+	for (int i = 0; i < 6; ++i) allocations.push_back(allocator.Allocate(Default, Buffer, 256 * 1024, 256, reinterpret_cast<void*>(uintptr_t(i + 1))));
+	CHECK_EQ(allocations[3].heap, allocations[0].heap);
+	CHECK_EQ(allocations[4].heap, allocations[5].heap);
+	CHECK(allocations[4].heap != allocations[0].heap);
+
+	for (int i = 0; i < 3; ++i) allocator.Free(allocations[i]);
+
+	uint32_t calls = 0;
+	const auto moved = allocator.Defragment(Default, Buffer, ~0ull, 7, [&](const SGpuAllocation& from, const SGpuAllocation& to, void* userData)
+	{
+		CHECK_EQ(from.heap, allocations[3].heap);
+		CHECK_EQ(to.heap, allocations[4].heap);
+		CHECK_EQ(from.size, to.size);
+		CHECK_EQ(userData, reinterpret_cast<void*>(uintptr_t(4)));
+		++calls;
+		return true;
+	});
+
+	// The least used heap had one allocation left, it moves to the other one
+	CHECK_EQ(calls, 1u);
+	CHECK_EQ(moved, 256u * 1024);
+	CHECK_EQ(allocator.Stats(Default, Buffer).pendingFreeBytes, moved);
+	CHECK_EQ(allocator.Stats(Default, Buffer).allocations, 4u);
+
+	// The old place is freed after the copies; the emptied heap is the one empty heap kept
+	source.mCompleted = 7;
+	allocator.ProcessDeferredFrees();
+	CHECK_EQ(allocator.Stats(Default, Buffer).pendingFreeBytes, 0u);
+	CHECK_EQ(allocator.Stats(Default, Buffer).allocations, 3u);
+	CHECK_EQ(allocator.Stats(Default, Buffer).heaps, 2u);
+	allocator.Validate();
+
+	// Nothing to move between a heap and an empty one
+	CHECK_EQ(allocator.Defragment(Default, Buffer, ~0ull, 8, [](const SGpuAllocation&, const SGpuAllocation&, void*) { return true; }), 0u);
+
+}
+
+TEST(DefragmentKeepsRefusedMoves)
+{
+	CFakeHeapSource source;
+	CDX12HeapAllocator allocator(&source, 1 << 20);
+
+	std::vector<SGpuAllocation> allocations;
+	for (int i = 0; i < 5; ++i) allocations.push_back(allocator.Allocate(Default, Buffer, 256 * 1024, 256));
+	allocator.Free(allocations[0]);
+
+	// The new place is freed at once, the allocation stays where it is
+	const auto moved = allocator.Defragment(Default, Buffer, ~0ull, 1, [](const SGpuAllocation&, const SGpuAllocation&, void*) { return false; });
+	CHECK_EQ(moved, 0u);
+
+	const auto stats = allocator.Stats(Default, Buffer);
+	CHECK_EQ(stats.allocations, 4u);
+	CHECK_EQ(stats.pendingFreeBytes, 0u);
+	CHECK_EQ(stats.heaps, 2u);
+	allocator.Validate();
+}
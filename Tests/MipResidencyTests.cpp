@@ -0,0 +1,256 @@
+#include "TestHarness.h"
+
+#include "../Source/DX12/DX12MipResidency.h"
+
+using namespace DX12;
+
+namespace
+{
+	// The header of a DDS file, with or without the DX10 four CC
+	std::vector<uint8_t> DdsHeader(bool dx10)
+	{
+		std::vector<uint8_t> header(DdsHeaderSize + DdsHeaderDx10Size, 0);
+		header[80] = dx10 ? 0x4 : 0x40; // DDPF_FOURCC, else DDPF_RGB
+		if (dx10)
+		{
+			header[84] = 'D';
+			header[85] = 'X';
+			header[86] = '1';
+			header[87] = '0';
+		}
+		return header;
+	}
+
+	// 64, 16, 4 and 1 bytes, the smallest two are the tail
+	std::vector<uint64_t> SmallTexture()
+	{
+		return { 64, 16, 4, 1 };
+	}
+}
+
+TEST(MipsStartAfterTheHeaders)
+{
+	CHECK_EQ(DdsDataOffset(DdsHeader(false).data()), 128u);
+	CHECK_EQ(DdsDataOffset(DdsHeader(true).data()), 148u);
+
+	// A four CC other than DX10, like DXT1, has no extra header
+	auto dxt1 = DdsHeader(true);
+	dxt1[86] = 'T';
+	dxt1[87] = '1';
+	CHECK_EQ(DdsDataOffset(dxt1.data()), 128u);
+
+	// The DX10 four CC only counts with the four CC flag
+	auto flagless = DdsHeader(true);
+	flagless[80] = 0;
+	CHECK_EQ(DdsDataOffset(flagless.data()), 128u);
+}
+
+TEST(MipRangesAreTheEndOfTheFile)
+{
+	// A 256x128 RGBA8 texture with its whole chain
+	std::vector<uint64_t> mipBytes;
+	for (uint32_t mip = 0; mip < 9; ++mip) mipBytes.push_back(MipExtent(256, mip) * MipExtent(128, mip) * 4);
+
+	const auto offsets = MipOffsets(148, mipBytes);
+	CHECK_EQ(offsets.size(), 10u);
+	CHECK_EQ(offsets[0], 148u);
+	CHECK_EQ(offsets[1], 148u + 256 * 128 * 4);
+	CHECK_EQ(offsets[8], offsets[9] - 4);
+
+	// The mips from one on are one read to the end of the file
+	uint64_t total = 0;
+	for (const auto bytes : mipBytes) total += bytes;
+	CHECK_EQ(offsets.back(), 148u + total);
+
+	CHECK_EQ(MipExtent(256, 0), 256u);
+	CHECK_EQ(MipExtent(256, 8), 1u);
+	CHECK_EQ(MipExtent(128, 8), 1u);
+	CHECK_EQ(MipExtent(5, 1), 2u);
+}
+
+TEST(TailHoldsTheMipsUpToTheTailSize)
+{
+	// 1024x512: 1024, 512, 256, 128, 64 (largest of the tail), ... down to 1
+	CHECK_EQ(TailMip(1024, 512, 11, 64), 4u);
+
+	// The larger side counts
+	CHECK_EQ(TailMip(512, 1024, 11, 64), 4u);
+
+	// Everything fits in the tail
+	CHECK_EQ(TailMip(64, 64, 7, 64), 0u);
+
+	// At least the smallest mip, even if it is bigger than the tail size
+	CHECK_EQ(TailMip(1024, 1024, 2, 64), 1u);
+	CHECK_EQ(TailMip(1024, 1024, 1, 64), 0u);
+}
+
+TEST(BlockCompressedMipsNeedWholeBlocks)
+{
+	CHECK(WholeBlocks(256, 256, 6));
+	CHECK(!WholeBlocks(256, 256, 7));
+	CHECK(!WholeBlocks(100, 64, 1));
+	CHECK(WholeBlocks(100, 64, 0));
+}
+
+TEST(StreamsInWithinTheBudget)
+{
+	CDX12MipResidency residency(1000);
+
+	const auto texture = residency.Add(SmallTexture(), 2);
+	CHECK_EQ(residency.Resident(texture), 2u);
+	CHECK_EQ(residency.Stats().committed, 5u);
+
+	residency.Request(texture, 1);
+	residency.Request(texture, 0);
+	const auto changes = residency.Update();
+	CHECK_EQ(changes.size(), 1u);
+	CHECK_EQ(changes[0].texture, texture);
+	CHECK_EQ(changes[0].mip, 0u);
+
+	// Counted with the larger mips while in flight
+	CHECK(residency.Streaming(texture));
+	CHECK_EQ(residency.Resident(texture), 2u);
+	CHECK_EQ(residency.Stats().committed, 85u);
+
+	residency.Loaded(texture);
+	CHECK(!residency.Streaming(texture));
+	CHECK_EQ(residency.Resident(texture), 0u);
+	CHECK_EQ(residency.Stats().streamedIn, 1u);
+
+	// Unseen, but nothing needs the memory
+	CHECK(residency.Update().empty());
+	residency.Validate();
+
+	// Requests never go below the tail
+	residency.Request(texture, 3);
+	CHECK(residency.Update().empty());
+
+	CHECK_THROWS(residency.Loaded(texture), std::logic_error);
+	CHECK_THROWS(residency.Add(SmallTexture(), 4), std::logic_error);
+}
+
+TEST(EvictsTheLeastRecentlySeen)
+{
+	CDX12MipResidency residency(100);
+
+	const auto a = residency.Add(SmallTexture(), 2);
+	const auto b = residency.Add(SmallTexture(), 2);
+
+	residency.Request(a, 0);
+	CHECK_EQ(residency.Update().size(), 1u);
+	residency.Loaded(a);
+	CHECK_EQ(residency.Stats().committed, 90u);
+
+	// b does not fit until a goes back to its tail, which takes a frame
+	residency.Request(b, 0);
+	auto changes = residency.Update();
+	CHECK_EQ(changes.size(), 1u);
+	CHECK_EQ(changes[0].texture, a);
+	CHECK_EQ(changes[0].mip, 2u);
+	CHECK_EQ(residency.Stats().denied, 1u);
+	CHECK_EQ(residency.Stats().evicted, 1u);
+
+	// The evicted mips count until they are gone
+	CHECK_EQ(residency.Stats().committed, 90u);
+	residency.Loaded(a);
+	CHECK_EQ(residency.Stats().committed, 10u);
+
+	residency.Request(b, 0);
+	changes = residency.Update();
+	CHECK_EQ(changes.size(), 1u);
+	CHECK_EQ(changes[0].texture, b);
+	CHECK_EQ(changes[0].mip, 0u);
+	CHECK_EQ(residency.Stats().denied, 0u);
+	residency.Validate();
+}
+
+TEST(TakesTheLargestMipsThatFit)
+{
+	CDX12MipResidency residency(30);
+
+	const auto texture = residency.Add(SmallTexture(), 2);
+	residency.Request(texture, 0);
+
+	const auto changes = residency.Update();
+	CHECK_EQ(changes.size(), 1u);
+	CHECK_EQ(changes[0].mip, 1u);
+	CHECK_EQ(residency.Stats().denied, 1u);
+	CHECK_EQ(residency.Stats().committed, 21u);
+}
+
+TEST(CancelledChangesLeaveTheTextureAsItWas)
+{
+	CDX12MipResidency residency(1000);
+
+	const auto texture = residency.Add(SmallTexture(), 2);
+	residency.Request(texture, 0);
+	residency.Update();
+
+	residency.Cancelled(texture);
+	CHECK(!residency.Streaming(texture));
+	CHECK_EQ(residency.Resident(texture), 2u);
+	CHECK_EQ(residency.Stats().committed, 5u);
+
+	CHECK_THROWS(residency.Cancelled(texture), std::logic_error);
+	residency.Validate();
+}
+
+TEST(LimitsTheChangesPerUpdate)
+{
+	CDX12MipResidency residency(1000, 2);
+
+	std::vector<uint32_t> textures;
+	for (int i = 0; i < 3; ++i) textures.push_back(residency.Add(SmallTexture(), 2));
+
+	// The one missing the most mips first
+	residency.Request(textures[0], 1);
+	residency.Request(textures[1], 0);
+	residency.Request(textures[2], 1);
+
+	auto changes = residency.Update();
+	CHECK_EQ(changes.size(), 2u);
+	CHECK_EQ(changes[0].texture, textures[1]);
+	CHECK_EQ(residency.Stats().streaming, 2u);
+
+	// The last one is started with the next update
+	for (const auto texture : textures) residency.Request(texture, texture == textures[1] ? 0 : 1);
+	changes = residency.Update();
+	CHECK_EQ(changes.size(), 1u);
+	CHECK(!residency.Streaming(changes[0].texture) || changes[0].mip == 1);
+	residency.Validate();
+}
+
+TEST(RemovedSlotsAreReused)
+{
+	CDX12MipResidency residency(1000);
+
+	const auto a = residency.Add(SmallTexture(), 2);
+	const auto b = residency.Add(SmallTexture(), 2);
+	residency.Remove(a);
+	CHECK(!residency.Live(a));
+	CHECK_EQ(residency.Stats().textures, 1u);
+	CHECK_EQ(residency.Stats().committed, 5u);
+
+	CHECK_EQ(residency.Add({ 4, 1 }, 1), a);
+	CHECK_EQ(residency.Stats().committed, 6u);
+	residency.Validate();
+
+	CHECK_THROWS(residency.Remove(b + 1), std::logic_error);
+	CHECK_THROWS(residency.Request(b + 1, 0), std::logic_error);
+}
+
+TEST(MipsFollowTheScreenSize)
+{
+	// One texel per pixel
+	CHECK_EQ(MipForScreenSize(1024, 11, 1024.0f), 0u);
+	CHECK_EQ(MipForScreenSize(1024, 11, 256.0f), 2u);
+	CHECK_EQ(MipForScreenSize(1024, 11, 4096.0f), 0u);
+	CHECK_EQ(MipForScreenSize(1024, 11, 256.0f, 1.0f), 3u);
+
+	// Off the screen, or smaller than the smallest mip
+	CHECK_EQ(MipForScreenSize(1024, 11, 0.0f), 10u);
+	CHECK_EQ(MipForScreenSize(1024, 11, 0.01f), 10u);
+
+	CHECK(ProjectedPixels(1.0f, 0.5f, 1.0f, 1000.0f) > 1e30f);
+	CHECK(ProjectedPixels(1.0f, 10.0f, 1.0f, 1000.0f) > ProjectedPixels(1.0f, 20.0f, 1.0f, 1000.0f));
+}
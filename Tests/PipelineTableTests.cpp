@@ -0,0 +1,189 @@
+#include "TestHarness.h"
+
+#include <cstring>
+
+#include "../Source/DX12/DX12PipelineTable.h"
+
+using namespace DX12;
+
+namespace
+{
+	const uint8_t VertexShader[] = { 1, 2, 3, 4 };
+	const uint8_t PixelShader[]  = { 5, 6, 7 };
+	const uint8_t OtherShader[]  = { 5, 6, 8 };
+
+	const D3D12_INPUT_ELEMENT_DESC Position[] = { { "Position", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 } };
+
+	// An opaque pipeline drawing to one target with depth, what the state D3D12 ignores holds is garbage
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC OpaqueDesc()
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc;
+		std::memset(&desc, 0xCD, sizeof(desc));
+
+		desc.pRootSignature = nullptr;
+		desc.VS = { VertexShader, sizeof(VertexShader) };
+		desc.PS = { PixelShader, sizeof(PixelShader) };
+		desc.DS = desc.HS = desc.GS = {};
+		desc.StreamOutput = {};
+		desc.CachedPSO = {};
+
+		desc.BlendState.AlphaToCoverageEnable = false;
+		desc.BlendState.IndependentBlendEnable = false;
+		desc.BlendState.RenderTarget[0].BlendEnable = false;
+		desc.BlendState.RenderTarget[0].LogicOpEnable = false;
+		desc.BlendState.RenderTarget[0].RenderTargetWriteMask = 0xF;
+		desc.SampleMask = 0xFFFFFFFF;
+
+		desc.RasterizerState = { D3D12_FILL_MODE_SOLID, D3D12_CULL_MODE_BACK, false, 0, 0.0f, 0.0f, true, false, false, 0, D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF };
+
+		desc.DepthStencilState.DepthEnable = true;
+		desc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+		desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+		desc.DepthStencilState.StencilEnable = false;
+
+		desc.InputLayout = { Position, 1 };
+		desc.IBStripCutValue = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_DISABLED;
+		desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+		desc.NumRenderTargets = 1;
+		desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+		desc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+		desc.SampleDesc = { 1, 0 };
+		desc.NodeMask = 0;
+		desc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+		return desc;
+	}
+}
+
+TEST(IgnoredStateDoesNotChangeTheDescription)
+{
+	const CDX12PipelineDesc a(OpaqueDesc(), 42);
+
+	// Different garbage where D3D12 does not look, another copy of the shader, another case for the semantic
+	auto desc = OpaqueDesc();
+	std::memset(&desc.RTVFormats[1], 0x11, 7 * sizeof(DXGI_FORMAT));
+	desc.BlendState.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA;
+	desc.BlendState.RenderTarget[3].BlendEnable = true;
+	desc.DepthStencilState.FrontFace.StencilFunc = D3D12_COMPARISON_FUNC_LESS;
+
+	const uint8_t vertexShader[] = { 1, 2, 3, 4 };
+	desc.VS = { vertexShader, sizeof(vertexShader) };
+
+	const D3D12_INPUT_ELEMENT_DESC position[] = { { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 } };
+	desc.InputLayout = { position, 1 };
+
+	const CDX12PipelineDesc b(desc, 42);
+	CHECK(a == b);
+	CHECK_EQ(a.Hash(), b.Hash());
+
+	// The description owns what it points to
+	const auto out = b.Desc();
+	CHECK(out.VS.pShaderBytecode != vertexShader);
+	CHECK_EQ(out.VS.BytecodeLength, sizeof(vertexShader));
+	CHECK_EQ(std::string(out.InputLayout.pInputElementDescs[0].SemanticName), std::string("POSITION"));
+	CHECK(out.InputLayout.pInputElementDescs != position);
+
+	// Copies share it
+	const auto copy = b;
+	CHECK_EQ(copy.Desc().InputLayout.pInputElementDescs, out.InputLayout.pInputElementDescs);
+}
+
+TEST(RelevantStateChangesTheDescription)
+{
+	const CDX12PipelineDesc a(OpaqueDesc(), 42);
+
+	auto desc = OpaqueDesc();
+	desc.PS = { OtherShader, sizeof(OtherShader) };
+	CHECK(a != CDX12PipelineDesc(desc, 42));
+
+	CHECK(a != CDX12PipelineDesc(OpaqueDesc(), 43));
+
+	desc = OpaqueDesc();
+	desc.BlendState.RenderTarget[0].BlendEnable = true;
+	desc.BlendState.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA;
+	desc.BlendState.RenderTarget[0].DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
+	desc.BlendState.RenderTarget[0].BlendOp = D3D12_BLEND_OP_ADD;
+	CHECK(a != CDX12PipelineDesc(desc, 42));
+
+	desc = OpaqueDesc();
+	desc.NumRenderTargets = 2;
+	desc.RTVFormats[1] = DXGI_FORMAT_R8G8B8A8_UNORM;
+	CHECK(a != CDX12PipelineDesc(desc, 42));
+
+	desc = OpaqueDesc();
+	desc.StreamOutput.NumEntries = 1;
+	CHECK_THROWS(CDX12PipelineDesc(desc, 42), std::logic_error);
+}
+
+TEST(EqualDescriptionsShareAHandle)
+{
+	CDX12PipelineTable table;
+	bool added = false;
+
+	const CDX12PipelineDesc a(OpaqueDesc(), 42);
+	const auto first = table.Add(a, CDX12PipelineTable::InvalidHandle, added);
+	CHECK(added);
+	CHECK_EQ(first, 0u);
+	CHECK(table.State(first) == EPipelineState::Pending);
+
+	// The fallback of a description already there is ignored
+	const auto again = table.Add(CDX12PipelineDesc(OpaqueDesc(), 42), 7, added);
+	CHECK(!added);
+	CHECK_EQ(again, first);
+
+	auto desc = OpaqueDesc();
+	desc.PS = { OtherShader, sizeof(OtherShader) };
+	const auto other = table.Add(CDX12PipelineDesc(desc, 42), first, added);
+	CHECK(added);
+	CHECK_EQ(other, 1u);
+
+	const auto stats = table.Stats();
+	CHECK_EQ(stats.requests, 3u);
+	CHECK_EQ(stats.pipelines, 2u);
+	CHECK_EQ(stats.collisions, 0u);
+
+	// Stable names, different per pipeline
+	CHECK(table.Name(first) == table.Name(first));
+	CHECK(table.Name(first) != table.Name(other));
+
+	table.Validate();
+
+	CHECK_THROWS(table.Add(CDX12PipelineDesc(OpaqueDesc(), 44), 5, added), std::logic_error);
+}
+
+TEST(FallbackChainResolvesToTheFirstReady)
+{
+	CDX12PipelineTable table;
+	bool added = false;
+
+	auto desc = OpaqueDesc();
+	const auto base = table.Add(CDX12PipelineDesc(desc, 1), CDX12PipelineTable::InvalidHandle, added);
+	const auto middle = table.Add(CDX12PipelineDesc(desc, 2), base, added);
+	const auto top = table.Add(CDX12PipelineDesc(desc, 3), middle, added);
+	CHECK_EQ(table.Fallback(top), middle);
+
+	// Nothing ready yet
+	CHECK_EQ(table.Resolve(top), CDX12PipelineTable::InvalidHandle);
+
+	table.SetState(base, EPipelineState::Ready);
+	CHECK_EQ(table.Resolve(top), base);
+	CHECK_EQ(table.Resolve(middle), base);
+
+	// A failed pipeline keeps using its fallback
+	table.SetState(middle, EPipelineState::Failed);
+	CHECK_EQ(table.Resolve(top), base);
+
+	table.SetState(top, EPipelineState::Ready);
+	CHECK_EQ(table.Resolve(top), top);
+	CHECK_EQ(table.Resolve(middle), base);
+
+	CHECK_EQ(table.Resolve(CDX12PipelineTable::InvalidHandle), CDX12PipelineTable::InvalidHandle);
+
+	table.Validate();
+}
+
+TEST(HashIsStable)
+{
+	// FNV-1a of "a", the same on every run and every platform
+	CHECK_EQ(HashBytes("a", 1), 0xAF63DC4C8601EC8Cull);
+	CHECK_EQ(HashBytes(nullptr, 0), 14695981039346656037ull);
+}
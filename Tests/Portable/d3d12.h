@@ -0,0 +1,240 @@
+//--------------------------------------------------------------------------------------
+// D3D12 description structures for the tests built without the Windows SDK
+//--------------------------------------------------------------------------------------
+// The device-free parts that take D3D12 descriptions (CDX12PipelineTable) only read plain
+// structures and enumerations. The D3D12 headers of the SDK pull in windows.h, so off
+// Windows the tests are built against this subset instead: the same names, members, member
+// order and values as d3d12.h 1.606.4, nothing COM. Only used by Tests/CMakeLists.txt, on
+// Windows the tests use the real headers.
+
+#pragma once
+
+#if defined(_WIN32)
+#error "Use the D3D12 headers of the SDK on Windows"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+
+typedef int          BOOL;
+typedef int          INT;
+typedef unsigned int UINT;
+typedef float        FLOAT;
+typedef uint8_t      UINT8;
+typedef size_t       SIZE_T;
+typedef const char*  LPCSTR;
+
+enum DXGI_FORMAT
+{
+	DXGI_FORMAT_UNKNOWN         = 0,
+	DXGI_FORMAT_R32G32B32_FLOAT = 6,
+	DXGI_FORMAT_R32G32_FLOAT    = 16,
+	DXGI_FORMAT_R8G8B8A8_UNORM  = 28,
+	DXGI_FORMAT_D32_FLOAT       = 40
+};
+
+struct DXGI_SAMPLE_DESC
+{
+	UINT Count;
+	UINT Quality;
+};
+
+#define D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT ( 8 )
+#define D3D12_DEFAULT_STENCIL_READ_MASK        ( 0xff )
+#define D3D12_DEFAULT_STENCIL_WRITE_MASK       ( 0xff )
+
+enum D3D12_BLEND
+{
+	D3D12_BLEND_ZERO          = 1,
+	D3D12_BLEND_ONE           = 2,
+	D3D12_BLEND_SRC_ALPHA     = 5,
+	D3D12_BLEND_INV_SRC_ALPHA = 6
+};
+
+enum D3D12_BLEND_OP
+{
+	D3D12_BLEND_OP_ADD = 1
+};
+
+enum D3D12_LOGIC_OP
+{
+	D3D12_LOGIC_OP_CLEAR = 0,
+	D3D12_LOGIC_OP_NOOP  = 4
+};
+
+enum D3D12_COMPARISON_FUNC
+{
+	D3D12_COMPARISON_FUNC_LESS   = 2,
+	D3D12_COMPARISON_FUNC_ALWAYS = 8
+};
+
+enum D3D12_DEPTH_WRITE_MASK
+{
+	D3D12_DEPTH_WRITE_MASK_ZERO = 0,
+	D3D12_DEPTH_WRITE_MASK_ALL  = 1
+};
+
+enum D3D12_STENCIL_OP
+{
+	D3D12_STENCIL_OP_KEEP    = 1,
+	D3D12_STENCIL_OP_REPLACE = 3
+};
+
+enum D3D12_FILL_MODE
+{
+	D3D12_FILL_MODE_SOLID = 3
+};
+
+enum D3D12_CULL_MODE
+{
+	D3D12_CULL_MODE_NONE = 1,
+	D3D12_CULL_MODE_BACK = 3
+};
+
+enum D3D12_CONSERVATIVE_RASTERIZATION_MODE
+{
+	D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF = 0
+};
+
+enum D3D12_INPUT_CLASSIFICATION
+{
+	D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA = 0
+};
+
+enum D3D12_INDEX_BUFFER_STRIP_CUT_VALUE
+{
+	D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_DISABLED = 0
+};
+
+enum D3D12_PRIMITIVE_TOPOLOGY_TYPE
+{
+	D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE = 3
+};
+
+enum D3D12_PIPELINE_STATE_FLAGS
+{
+	D3D12_PIPELINE_STATE_FLAG_NONE = 0
+};
+
+struct D3D12_SHADER_BYTECODE
+{
+	const void* pShaderBytecode;
+	SIZE_T      BytecodeLength;
+};
+
+struct D3D12_SO_DECLARATION_ENTRY;
+
+struct D3D12_STREAM_OUTPUT_DESC
+{
+	const D3D12_SO_DECLARATION_ENTRY* pSODeclaration;
+	UINT                              NumEntries;
+	const UINT*                       pBufferStrides;
+	UINT                              NumStrides;
+	UINT                              RasterizedStream;
+};
+
+struct D3D12_RENDER_TARGET_BLEND_DESC
+{
+	BOOL           BlendEnable;
+	BOOL           LogicOpEnable;
+	D3D12_BLEND    SrcBlend;
+	D3D12_BLEND    DestBlend;
+	D3D12_BLEND_OP BlendOp;
+	D3D12_BLEND    SrcBlendAlpha;
+	D3D12_BLEND    DestBlendAlpha;
+	D3D12_BLEND_OP BlendOpAlpha;
+	D3D12_LOGIC_OP LogicOp;
+	UINT8          RenderTargetWriteMask;
+};
+
+struct D3D12_BLEND_DESC
+{
+	BOOL                           AlphaToCoverageEnable;
+	BOOL                           IndependentBlendEnable;
+	D3D12_RENDER_TARGET_BLEND_DESC RenderTarget[8];
+};
+
+struct D3D12_RASTERIZER_DESC
+{
+	D3D12_FILL_MODE                       FillMode;
+	D3D12_CULL_MODE                       CullMode;
+	BOOL                                  FrontCounterClockwise;
+	INT                                   DepthBias;
+	FLOAT                                 DepthBiasClamp;
+	FLOAT                                 SlopeScaledDepthBias;
+	BOOL                                  DepthClipEnable;
+	BOOL                                  MultisampleEnable;
+	BOOL                                  AntialiasedLineEnable;
+	UINT                                  ForcedSampleCount;
+	D3D12_CONSERVATIVE_RASTERIZATION_MODE ConservativeRaster;
+};
+
+struct D3D12_DEPTH_STENCILOP_DESC
+{
+	D3D12_STENCIL_OP      StencilFailOp;
+	D3D12_STENCIL_OP      StencilDepthFailOp;
+	D3D12_STENCIL_OP      StencilPassOp;
+	D3D12_COMPARISON_FUNC StencilFunc;
+};
+
+struct D3D12_DEPTH_STENCIL_DESC
+{
+	BOOL                       DepthEnable;
+	D3D12_DEPTH_WRITE_MASK     DepthWriteMask;
+	D3D12_COMPARISON_FUNC      DepthFunc;
+	BOOL                       StencilEnable;
+	UINT8                      StencilReadMask;
+	UINT8                      StencilWriteMask;
+	D3D12_DEPTH_STENCILOP_DESC FrontFace;
+	D3D12_DEPTH_STENCILOP_DESC BackFace;
+};
+
+struct D3D12_INPUT_ELEMENT_DESC
+{
+	LPCSTR                     SemanticName;
+	UINT                       SemanticIndex;
+	DXGI_FORMAT                Format;
+	UINT                       InputSlot;
+	UINT                       AlignedByteOffset;
+	D3D12_INPUT_CLASSIFICATION InputSlotClass;
+	UINT                       InstanceDataStepRate;
+};
+
+struct D3D12_INPUT_LAYOUT_DESC
+{
+	const D3D12_INPUT_ELEMENT_DESC* pInputElementDescs;
+	UINT                            NumElements;
+};
+
+struct D3D12_CACHED_PIPELINE_STATE
+{
+	const void* pCachedBlob;
+	SIZE_T      CachedBlobSizeInBytes;
+};
+
+struct ID3D12RootSignature;
+
+struct D3D12_GRAPHICS_PIPELINE_STATE_DESC
+{
+	ID3D12RootSignature*               pRootSignature;
+	D3D12_SHADER_BYTECODE              VS;
+	D3D12_SHADER_BYTECODE              PS;
+	D3D12_SHADER_BYTECODE              DS;
+	D3D12_SHADER_BYTECODE              HS;
+	D3D12_SHADER_BYTECODE              GS;
+	D3D12_STREAM_OUTPUT_DESC           StreamOutput;
+	D3D12_BLEND_DESC                   BlendState;
+	UINT                               SampleMask;
+	D3D12_RASTERIZER_DESC              RasterizerState;
+	D3D12_DEPTH_STENCIL_DESC           DepthStencilState;
+	D3D12_INPUT_LAYOUT_DESC            InputLayout;
+	D3D12_INDEX_BUFFER_STRIP_CUT_VALUE IBStripCutValue;
+	D3D12_PRIMITIVE_TOPOLOGY_TYPE      PrimitiveTopologyType;
+	UINT                               NumRenderTargets;
+	DXGI_FORMAT                        RTVFormats[8];
+	DXGI_FORMAT                        DSVFormat;
+	DXGI_SAMPLE_DESC                   SampleDesc;
+	UINT                               NodeMask;
+	D3D12_CACHED_PIPELINE_STATE        CachedPSO;
+	D3D12_PIPELINE_STATE_FLAGS         Flags;
+};
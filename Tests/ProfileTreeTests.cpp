@@ -0,0 +1,169 @@
+#include "TestHarness.h"
+
+#include <sstream>
+
+#include "../Source/DX12/DX12ProfileTree.h"
+
+using namespace DX12;
+
+namespace
+{
+	// Ticks are microseconds
+	constexpr uint64_t Frequency = 1000000;
+	constexpr double   Tolerance = 1e-4;
+
+	constexpr uint32_t None = CDX12ProfileTree::InvalidScope;
+
+	SProfileScope Scope(const std::string& name, uint32_t parent = None)
+	{
+		SProfileScope scope;
+		scope.name = name;
+		scope.parent = parent;
+		return scope;
+	}
+
+	uint32_t Find(const CDX12ProfileTree& tree, const std::string& name, uint32_t parent)
+	{
+		for (const auto child : tree.Nodes()[parent].children)
+		{
+			if (tree.Nodes()[child].name == name) return child;
+		}
+		throw Tests::CFailure(__FILE__, __LINE__, "No node " + name);
+	}
+
+	size_t Count(const std::string& text, const std::string& pattern)
+	{
+		size_t count = 0;
+		for (auto at = text.find(pattern); at != std::string::npos; at = text.find(pattern, at + 1)) ++count;
+		return count;
+	}
+}
+
+TEST(TimestampsAreReadInQueryPairs)
+{
+	std::vector<SProfileScope> scopes = { Scope("A"), Scope("B", 0) };
+	const uint64_t timestamps[] = { 10, 20, 12, 18 };
+
+	ReadTimestamps(scopes, timestamps);
+	CHECK_EQ(scopes[0].begin, 10u);
+	CHECK_EQ(scopes[0].end, 20u);
+	CHECK_EQ(scopes[1].begin, 12u);
+	CHECK_EQ(scopes[1].end, 18u);
+}
+
+TEST(ScopesWithTheSameNameAndParentAreOneNode)
+{
+	std::vector<SProfileScope> scopes = { Scope("Shadows"), Scope("Face", 0), Scope("Face", 0), Scope("Opaque"), Scope("Empty") };
+	const uint64_t timestamps[] = { 1000, 3000, 1000, 1500, 1500, 2200, 3000, 8000, 9000, 9000 };
+	ReadTimestamps(scopes, timestamps);
+
+	CDX12ProfileTree tree;
+	tree.AddFrame(scopes, Frequency);
+	tree.Validate();
+
+	const auto& nodes = tree.Nodes();
+	CHECK_EQ(nodes.size(), 5u);
+	CHECK_EQ(tree.Frames(), 1u);
+
+	const auto shadows = Find(tree, "Shadows", CDX12ProfileTree::Root);
+	const auto face = Find(tree, "Face", shadows);
+	const auto opaque = Find(tree, "Opaque", CDX12ProfileTree::Root);
+	const auto empty = Find(tree, "Empty", CDX12ProfileTree::Root);
+
+	CHECK_EQ(nodes[face].calls, 2u);
+	CHECK_NEAR(nodes[face].last, 1.2, Tolerance);
+	CHECK_NEAR(nodes[shadows].last, 2.0, Tolerance);
+	CHECK_NEAR(nodes[opaque].last, 5.0, Tolerance);
+
+	// A scope without time is counted, and does not stretch the frame
+	CHECK_EQ(nodes[empty].calls, 1u);
+	CHECK_NEAR(nodes[empty].last, 0.0, Tolerance);
+
+	// The frame goes from the first timestamp to the last
+	CHECK_EQ(nodes[CDX12ProfileTree::Root].calls, 1u);
+	CHECK_NEAR(nodes[CDX12ProfileTree::Root].last, 7.0, Tolerance);
+}
+
+TEST(StatisticsRollOverTheHistory)
+{
+	CDX12ProfileTree tree;
+
+	std::vector<SProfileScope> frame = { Scope("Shadows"), Scope("Opaque") };
+	const uint64_t first[] = { 0, 2000, 2000, 3000 };
+	ReadTimestamps(frame, first);
+	tree.AddFrame(frame, Frequency);
+
+	// Shadows not drawn in the second frame
+	std::vector<SProfileScope> second = { Scope("Opaque") };
+	const uint64_t secondTimes[] = { 0, 3000 };
+	ReadTimestamps(second, secondTimes);
+	tree.AddFrame(second, Frequency);
+
+	const auto shadows = Find(tree, "Shadows", CDX12ProfileTree::Root);
+	const auto opaque = Find(tree, "Opaque", CDX12ProfileTree::Root);
+	const auto& nodes = tree.Nodes();
+
+	CHECK_EQ(nodes[shadows].calls, 0u);
+	CHECK_NEAR(nodes[shadows].last, 0.0, Tolerance);
+	CHECK_NEAR(nodes[shadows].average, 1.0, Tolerance);
+	CHECK_NEAR(nodes[shadows].minimum, 0.0, Tolerance);
+	CHECK_NEAR(nodes[shadows].maximum, 2.0, Tolerance);
+	CHECK_NEAR(nodes[opaque].average, 2.0, Tolerance);
+
+	// A node added late took no time in the frames before
+	std::vector<SProfileScope> third = { Scope("Opaque"), Scope("Post") };
+	const uint64_t thirdTimes[] = { 0, 1000, 1000, 4000 };
+	ReadTimestamps(third, thirdTimes);
+	tree.AddFrame(third, Frequency);
+
+	const auto post = Find(tree, "Post", CDX12ProfileTree::Root);
+	CHECK_NEAR(tree.Nodes()[post].average, 1.0, Tolerance);
+	CHECK_NEAR(tree.Nodes()[post].minimum, 0.0, Tolerance);
+
+	// Once the history is full only the last frames count
+	for (uint32_t i = 0; i < CDX12ProfileTree::HistorySize; ++i) tree.AddFrame(second, Frequency);
+
+	CHECK_NEAR(tree.Nodes()[opaque].average, 3.0, Tolerance);
+	CHECK_NEAR(tree.Nodes()[opaque].minimum, 3.0, Tolerance);
+	CHECK_NEAR(tree.Nodes()[shadows].maximum, 0.0, Tolerance);
+	CHECK_EQ(tree.Frames(), CDX12ProfileTree::HistorySize + 3);
+	tree.Validate();
+}
+
+TEST(ChromeTraceKeepsTheLastFrames)
+{
+	CDX12ProfileTree tree;
+
+	std::vector<SProfileScope> scopes = { Scope("Pass \"A\""), Scope("Idle") };
+	for (uint64_t frame = 0; frame < CDX12ProfileTree::TraceFrames + 2; ++frame)
+	{
+		const uint64_t timestamps[] = { frame * 10000, frame * 10000 + 4000, 0, 0 };
+		ReadTimestamps(scopes, timestamps);
+		tree.AddFrame(scopes, Frequency);
+	}
+	tree.Validate();
+
+	std::ostringstream stream;
+	tree.WriteChromeTrace(stream);
+	const auto trace = stream.str();
+
+	// A frame event and a scope event per frame kept, the scopes without time left out
+	CHECK_EQ(Count(trace, "\"ph\":\"X\""), 2u * CDX12ProfileTree::TraceFrames);
+	CHECK_EQ(Count(trace, "\"name\":\"Frame\""), static_cast<size_t>(CDX12ProfileTree::TraceFrames));
+	CHECK_EQ(Count(trace, "\"name\":\"Pass \\\"A\\\"\""), static_cast<size_t>(CDX12ProfileTree::TraceFrames));
+	CHECK_EQ(Count(trace, "Idle"), 0u);
+
+	// Microseconds from the oldest frame kept, which is frame 2
+	CHECK(trace.find("\"ts\":0.000,\"dur\":4000.000,\"args\":{\"frame\":2}") != std::string::npos);
+	CHECK(trace.find("\"ts\":70000.000,\"dur\":4000.000,\"args\":{\"frame\":9}") != std::string::npos);
+	CHECK(trace.find("\"frame\":1}") == std::string::npos);
+}
+
+TEST(RejectsInvalidFrames)
+{
+	CDX12ProfileTree tree;
+
+	CHECK_THROWS(tree.AddFrame({ Scope("A") }, 0), std::logic_error);
+	CHECK_THROWS(tree.AddFrame({ Scope("A", 1), Scope("B") }, Frequency), std::logic_error);
+	CHECK_THROWS(tree.AddFrame({ Scope("A", 0) }, Frequency), std::logic_error);
+}
@@ -0,0 +1,234 @@
+#include "TestHarness.h"
+
+#include <algorithm>
+
+#include "../Source/DX12/DX12RenderGraphCompiler.h"
+
+using namespace DX12;
+
+namespace
+{
+	// States as the DX12 graph would use them, only the bits matter
+	constexpr RenderGraphState Common  = 0;
+	constexpr RenderGraphState Target  = 0x1;
+	constexpr RenderGraphState Shader  = 0x2;
+	constexpr RenderGraphState Copy    = 0x4;
+	constexpr RenderGraphState Present = 0x8;
+
+	using EType = SRenderGraphBarrier::EType;
+
+	std::vector<SRenderGraphBarrier> BarriersOf(const CDX12RenderGraphCompiler& c, uint32_t pass, uint32_t resource, EType type)
+	{
+		std::vector<SRenderGraphBarrier> barriers;
+		for (const auto& b : c.Barriers(pass))
+		{
+			if (b.resource == resource && b.type == type) barriers.push_back(b);
+		}
+		return barriers;
+	}
+}
+
+TEST(CullsPassesNobodyReads)
+{
+	CDX12RenderGraphCompiler c;
+	const auto out = c.AddImported("out", Common, true, Present);
+	const auto t = c.AddTransient("t", 1024, 256);
+	const auto u = c.AddTransient("u", 1024, 256);
+
+	// dead writes t, which feeds deadReader that only writes u, nobody reads u
+	const auto dead = c.AddPass("dead");
+	c.Write(dead, t, Target);
+	const auto deadReader = c.AddPass("deadReader");
+	c.Read(deadReader, t, Shader);
+	c.Write(deadReader, u, Target);
+
+	const auto kept = c.AddPass("kept");
+	c.Write(kept, out, Target);
+
+	const auto effects = c.AddPass("effects", true);
+
+	c.Compile();
+	c.Validate();
+
+	CHECK(c.Culled(dead));
+	CHECK(c.Culled(deadReader));
+	CHECK(!c.Culled(kept));
+	CHECK(!c.Culled(effects));
+	CHECK(c.Barriers(dead).empty());
+
+	// The transients of the culled passes take no memory
+	CHECK_EQ(c.Offset(t), CDX12RenderGraphCompiler::InvalidOffset);
+	CHECK_EQ(c.Offset(u), CDX12RenderGraphCompiler::InvalidOffset);
+	CHECK_EQ(c.HeapSize(), 0u);
+	CHECK_EQ(c.Stats().culledPasses, 2u);
+
+	// The exported resource ends in its final state
+	CHECK_EQ(c.FinalBarriers().size(), 1u);
+	CHECK_EQ(c.FinalBarriers()[0].stateBefore, Target);
+	CHECK_EQ(c.FinalBarriers()[0].stateAfter, Present);
+	CHECK_EQ(c.EndState(out), Present);
+}
+
+TEST(MergesConsecutiveReads)
+{
+	CDX12RenderGraphCompiler c;
+	const auto out = c.AddImported("out", Target, true, Target);
+	const auto t = c.AddTransient("t", 1024, 256);
+
+	const auto w = c.AddPass("w");
+	c.Write(w, t, Target);
+	const auto r1 = c.AddPass("r1");
+	c.Read(r1, t, Shader);
+	c.Write(r1, out, Target);
+	const auto r2 = c.AddPass("r2");
+	c.Read(r2, t, Copy);
+	c.Write(r2, out, Target);
+	const auto w2 = c.AddPass("w2");
+	c.Write(w2, t, Target);
+	const auto r3 = c.AddPass("r3");
+	c.Read(r3, t, Shader);
+	c.Write(r3, out, Target);
+
+	c.Compile();
+	c.Validate();
+
+	// The two reads get one transition to both their states
+	const auto merged = BarriersOf(c, r1, t, EType::Transition);
+	CHECK_EQ(merged.size(), 1u);
+	CHECK_EQ(merged[0].stateBefore, Target);
+	CHECK_EQ(merged[0].stateAfter, Shader | Copy);
+	CHECK(BarriersOf(c, r2, t, EType::Transition).empty());
+
+	// The write ends the run of reads
+	const auto split = BarriersOf(c, w2, t, EType::Transition);
+	CHECK_EQ(split.size(), 1u);
+	CHECK_EQ(split[0].stateBefore, Shader | Copy);
+	CHECK_EQ(split[0].stateAfter, Target);
+
+	const auto last = BarriersOf(c, r3, t, EType::Transition);
+	CHECK_EQ(last.size(), 1u);
+	CHECK_EQ(last[0].stateAfter, Shader);
+
+	// No barrier for the imported resource that stays in its state
+	CHECK(BarriersOf(c, r1, out, EType::Transition).empty());
+	CHECK(c.FinalBarriers().empty());
+}
+
+TEST(OverlappingLifetimesDoNotShareMemory)
+{
+	CDX12RenderGraphCompiler c;
+	const auto out = c.AddImported("out", Target, true, Target);
+	const auto a = c.AddTransient("a", 4096, 256);
+	const auto b = c.AddTransient("b", 2048, 1024);
+
+	const auto pa = c.AddPass("pa");
+	c.Write(pa, a, Target);
+	const auto pb = c.AddPass("pb");
+	c.Write(pb, b, Target);
+	const auto both = c.AddPass("both");
+	c.Read(both, a, Shader);
+	c.Read(both, b, Shader);
+	c.Write(both, out, Target);
+
+	c.Compile();
+	c.Validate();
+
+	CHECK(c.Offset(a) != c.Offset(b));
+	CHECK_EQ(c.Offset(b) % 1024, 0u);
+	CHECK(c.HeapSize() >= 4096u + 2048u);
+	CHECK_EQ(c.Stats().transientBytes, 4096u + 2048u);
+
+	// Both are new memory, each activated by its first pass and nowhere else
+	CHECK_EQ(c.Activated(pa).size(), 1u);
+	CHECK_EQ(c.Activated(pa)[0], a);
+	CHECK_EQ(c.Activated(pb).size(), 1u);
+	CHECK_EQ(c.Activated(pb)[0], b);
+	CHECK(c.Activated(both).empty());
+}
+
+TEST(DisjointLifetimesAlias)
+{
+	CDX12RenderGraphCompiler c;
+	const auto out = c.AddImported("out", Target, true, Target);
+	const auto a = c.AddTransient("a", 4096, 256);
+	const auto b = c.AddTransient("b", 4096, 256);
+
+	const auto pa = c.AddPass("pa");
+	c.Write(pa, a, Target);
+	const auto ra = c.AddPass("ra");
+	c.Read(ra, a, Shader);
+	c.Write(ra, out, Target);
+	const auto pb = c.AddPass("pb");
+	c.Write(pb, b, Target);
+	const auto rb = c.AddPass("rb");
+	c.Read(rb, b, Shader);
+	c.Write(rb, out, Target);
+
+	c.Compile();
+	c.Validate();
+
+	CHECK_EQ(c.Offset(a), c.Offset(b));
+	CHECK_EQ(c.HeapSize(), 4096u);
+	CHECK_EQ(c.Stats().transientBytes, 8192u);
+
+	// b takes over the memory of a before its first pass, after a's last one
+	const auto aliasing = BarriersOf(c, pb, b, EType::Aliasing);
+	CHECK_EQ(aliasing.size(), 1u);
+	CHECK_EQ(aliasing[0].before, a);
+	CHECK(BarriersOf(c, ra, b, EType::Aliasing).empty());
+	CHECK(BarriersOf(c, rb, b, EType::Aliasing).empty());
+
+	// Discarded on first use only
+	CHECK_EQ(c.Activated(pa).size(), 1u);
+	CHECK_EQ(c.Activated(pa)[0], a);
+	CHECK_EQ(c.Activated(pb).size(), 1u);
+	CHECK_EQ(c.Activated(pb)[0], b);
+	CHECK(c.Activated(ra).empty());
+	CHECK(c.Activated(rb).empty());
+}
+
+TEST(PlaceFunctionSetsTheInitialState)
+{
+	CDX12RenderGraphCompiler c;
+	const auto out = c.AddImported("out", Target, true, Target);
+	const auto t = c.AddTransient("t", 1024, 256);
+
+	const auto w = c.AddPass("w");
+	c.Write(w, t, Target);
+	const auto r = c.AddPass("r");
+	c.Read(r, t, Shader);
+	c.Write(r, out, Target);
+
+	std::vector<uint64_t> placed;
+	c.Compile([&](uint32_t resource, uint64_t offset)
+	{
+		CHECK_EQ(resource, t);
+		placed.push_back(offset);
+		return Copy;
+	});
+	c.Validate();
+
+	CHECK_EQ(placed.size(), 1u);
+	CHECK_EQ(placed[0], c.Offset(t));
+
+	// The transient is moved from the state the place function gave to the one of its first use
+	const auto first = BarriersOf(c, w, t, EType::Transition);
+	CHECK_EQ(first.size(), 1u);
+	CHECK_EQ(first[0].stateBefore, Copy);
+	CHECK_EQ(first[0].stateAfter, Target);
+}
+
+TEST(RejectsInvalidGraphs)
+{
+	CDX12RenderGraphCompiler c;
+	CHECK_THROWS(c.AddTransient("unaligned", 1024, 3), std::logic_error);
+
+	const auto t = c.AddTransient("t", 1024, 256);
+	const auto p = c.AddPass("p", true);
+	CHECK_THROWS(c.Read(p + 1, t, Shader), std::logic_error);
+	CHECK_THROWS(c.Read(p, t + 1, Shader), std::logic_error);
+
+	// Read before anything writes it
+	c.Read(p, t, Shader);
+	CHECK_THROWS(c.Compile(), std::logic_error);
+}
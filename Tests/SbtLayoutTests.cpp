@@ -0,0 +1,124 @@
+#include "TestHarness.h"
+
+#include "../Source/DX12/DX12SbtLayout.h"
+
+using namespace DX12;
+
+TEST(SectionsAreAlignedAndStrided)
+{
+	// 8 bytes of ray generation arguments, 2 miss records without, 2 ray types with 40 bytes of hit arguments
+	CDX12SbtLayout layout(8, 2, 0, 2, 40);
+
+	CHECK_EQ(CDX12SbtLayout::Stride(0), 32u);
+	CHECK_EQ(CDX12SbtLayout::Stride(1), 64u);
+	CHECK_EQ(CDX12SbtLayout::Stride(32), 64u);
+
+	const auto rayGen = layout.RayGen();
+	CHECK_EQ(rayGen.offset, 0u);
+	CHECK_EQ(rayGen.stride, 64u);
+	CHECK_EQ(rayGen.size, 64u);
+
+	const auto miss = layout.Miss();
+	CHECK_EQ(miss.offset, 64u);
+	CHECK_EQ(miss.stride, 32u);
+	CHECK_EQ(miss.size, 64u);
+
+	// 32 + 40 bytes rounded up to 96, starting on the next table alignment
+	const auto hit = layout.Hit();
+	CHECK_EQ(hit.offset, 128u);
+	CHECK_EQ(hit.stride, 96u);
+	CHECK_EQ(hit.size, 0u);
+
+	CHECK_EQ(layout.HitRecordOffset(3), 128u + 3 * 96u);
+	CHECK_EQ(layout.Size(10), 128u + 10 * 96u);
+
+	layout.Validate();
+
+	// An odd miss section pushes the hit section to the next table alignment
+	CDX12SbtLayout odd(0, 3, 0, 1, 0);
+	CHECK_EQ(odd.Miss().offset, 64u);
+	CHECK_EQ(odd.Hit().offset, 192u);
+	odd.Validate();
+
+	CHECK_THROWS(CDX12SbtLayout(0, 1, 0, 0, 0), std::logic_error);
+}
+
+TEST(HitRecordsFollowTheHitGroupIndex)
+{
+	CDX12SbtLayout layout(0, 2, 0, 2, 0);
+
+	const auto a = layout.Allocate(3);
+	const auto b = layout.Allocate(1);
+	CHECK_EQ(a, 0u);
+	CHECK_EQ(b, 6u);
+	CHECK_EQ(layout.HitRecords(), 8u);
+	CHECK_EQ(layout.Hit().size, 8u * layout.Hit().stride);
+
+	// instance + geometry * ray types + ray type
+	CHECK_EQ(layout.HitRecord(a, 0, 0), 0u);
+	CHECK_EQ(layout.HitRecord(a, 0, 1), 1u);
+	CHECK_EQ(layout.HitRecord(a, 2, 1), 5u);
+	CHECK_EQ(layout.HitRecord(b, 0, 1), 7u);
+
+	CHECK_THROWS(layout.Allocate(0), std::logic_error);
+	layout.Validate();
+}
+
+TEST(FreedRangesAreReusedAndMerged)
+{
+	CDX12SbtLayout layout(0, 1, 0, 1, 0);
+
+	const auto a = layout.Allocate(2);
+	const auto b = layout.Allocate(2);
+	const auto c = layout.Allocate(2);
+	CHECK_EQ(layout.Allocate(2), 6u);
+	CHECK_EQ(layout.HitRecords(), 8u);
+
+	layout.Free(a);
+	layout.Free(c);
+	CHECK_EQ(layout.FreeHitRecords(), 4u);
+	layout.Validate();
+
+	// First fit, what is left stays free
+	const auto e = layout.Allocate(1);
+	CHECK_EQ(e, a);
+	CHECK_EQ(layout.FreeHitRecords(), 3u);
+
+	// Does not fit in a free range, the section grows
+	const auto f = layout.Allocate(3);
+	CHECK_EQ(f, 8u);
+	CHECK_EQ(layout.HitRecords(), 11u);
+
+	// b joins the free ranges on both sides
+	layout.Free(b);
+	CHECK_EQ(layout.FreeHitRecords(), 5u);
+	layout.Validate();
+	CHECK_EQ(layout.Allocate(5), 1u);
+
+	CHECK_THROWS(layout.Free(2), std::logic_error);
+	CHECK_THROWS(layout.Free(b), std::logic_error);
+}
+
+TEST(FreeingTheEndShrinksTheSection)
+{
+	CDX12SbtLayout layout(0, 1, 0, 2, 0);
+
+	const auto a = layout.Allocate(1);
+	const auto b = layout.Allocate(1);
+	const auto c = layout.Allocate(1);
+	CHECK_EQ(layout.HitRecords(), 6u);
+
+	layout.Free(b);
+	CHECK_EQ(layout.FreeHitRecords(), 2u);
+
+	// c and the free range before it are given back to the end
+	layout.Free(c);
+	CHECK_EQ(layout.HitRecords(), 2u);
+	CHECK_EQ(layout.FreeHitRecords(), 0u);
+	layout.Validate();
+
+	layout.Free(a);
+	CHECK_EQ(layout.HitRecords(), 0u);
+	CHECK_EQ(layout.Hit().size, 0u);
+	layout.Validate();
+}
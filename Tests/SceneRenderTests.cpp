@@ -0,0 +1,279 @@
+//--------------------------------------------------------------------------------------
+// Golden image tests of the sample scenes
+//--------------------------------------------------------------------------------------
+// Renders every Scene*.xml of a folder with the software backend and compares the frames
+// against the reference images (Tests/References/<scene>.ppm), channel by channel within a
+// tolerance. The time each scene takes to load and render is reported, and can be held
+// to a budget to catch performance regressions.
+// --update writes the references instead of comparing with them. Scenes without a
+// reference are skipped, and the whole run is skipped (exit code 77, which CTest reports
+// as skipped) when the media folder is missing or nothing could be compared.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../Source/Software/SoftEngine.h"
+#include "../Source/Window.h"
+
+// The engine members are destroyed here, they need to be complete
+#include "../Source/Common/CGameObjectManager.h"
+#include "../Source/Common/CGui.h"
+#include "../Source/Common/CScene.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr int SkipCode = 77;
+
+	struct SArguments
+	{
+		// Relative to the root of the repository
+		fs::path     scenes     = ".";
+		fs::path     media      = "Media";
+		fs::path     references = "Tests/References";
+		fs::path     output     = "SceneRenderOutput"; // Frames that did not match
+		std::vector<std::string> names;                // Scene*.xml in scenes if empty
+
+		unsigned int width         = 640;
+		unsigned int height        = 360;
+		unsigned int frames        = 1;
+		unsigned int tolerance     = 8;     // Largest channel difference of a matching pixel
+		double       maxPixelsOver = 0.001; // Share of the pixels allowed over the tolerance
+		double       maxFrameMs    = 0;     // 0 for no budget
+		bool         rayTrace      = false;
+		bool         update        = false;
+	};
+
+	void PrintUsage()
+	{
+		std::printf(
+			"Usage: SceneRenderTests [options] [scene.xml ...]\n"
+			"  --scenes <folder>       Folder with the Scene*.xml files, the current folder by default\n"
+			"  --media <folder>        Media folder of the scenes\n"
+			"  --references <folder>   Reference images\n"
+			"  --output <folder>       Where the frames that do not match are written\n"
+			"  --size <width>x<height> Size of the frames, 640x360 by default\n"
+			"  --frames <n>            Frames rendered before the image is taken, 1 by default\n"
+			"  --tolerance <0-255>     Largest channel difference of a matching pixel, 8 by default\n"
+			"  --max-pixels <share>    Share of the pixels allowed over the tolerance, 0.001 by default\n"
+			"  --max-frame-ms <ms>     Fail the scenes slower than this per frame\n"
+			"  --raytrace              Render with the CPU ray tracer, the references get a .rt suffix\n"
+			"  --update                Write the references instead of comparing\n");
+	}
+
+	// Will throw a std::invalid_argument exception on unknown or incomplete arguments
+	SArguments ParseArguments(int argc, char* argv[])
+	{
+		SArguments arguments;
+
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string option = argv[i];
+
+			if (option == "--raytrace") { arguments.rayTrace = true; continue; }
+			if (option == "--update")   { arguments.update = true; continue; }
+
+			if (option.rfind("--", 0) != 0)
+			{
+				arguments.names.push_back(option);
+				continue;
+			}
+
+			if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + option);
+
+			const std::string value = argv[++i];
+
+			if (option == "--scenes")            arguments.scenes = value;
+			else if (option == "--media")        arguments.media = value;
+			else if (option == "--references")   arguments.references = value;
+			else if (option == "--output")       arguments.output = value;
+			else if (option == "--frames")       arguments.frames = static_cast<unsigned int>(std::stoul(value));
+			else if (option == "--tolerance")    arguments.tolerance = static_cast<unsigned int>(std::stoul(value));
+			else if (option == "--max-pixels")   arguments.maxPixelsOver = std::stod(value);
+			else if (option == "--max-frame-ms") arguments.maxFrameMs = std::stod(value);
+			else if (option == "--size")
+			{
+				const auto x = value.find('x');
+				if (x == std::string::npos) throw std::invalid_argument("Size must be <width>x<height>");
+
+				arguments.width = static_cast<unsigned int>(std::stoul(value.substr(0, x)));
+				arguments.height = static_cast<unsigned int>(std::stoul(value.substr(x + 1)));
+			}
+			else
+			{
+				throw std::invalid_argument("Unknown option " + option);
+			}
+		}
+
+		if (arguments.frames == 0) throw std::invalid_argument("At least one frame has to run");
+
+		return arguments;
+	}
+
+	std::vector<fs::path> SceneFiles(const SArguments& arguments)
+	{
+		std::vector<fs::path> scenes;
+
+		for (const auto& name : arguments.names) scenes.push_back(arguments.scenes / name);
+
+		if (scenes.empty())
+		{
+			for (const auto& entry : fs::directory_iterator(arguments.scenes))
+			{
+				const auto name = entry.path().filename().string();
+				if (entry.is_regular_file() && name.rfind("Scene", 0) == 0 && entry.path().extension() == ".xml") scenes.push_back(entry.path());
+			}
+
+			std::sort(scenes.begin(), scenes.end());
+		}
+
+		return scenes;
+	}
+
+	struct SRender
+	{
+		Software::CSoftImage image;
+		double               loadMs  = 0;
+		double               frameMs = 0;
+	};
+
+	SRender Render(const fs::path& scene, const SArguments& arguments)
+	{
+		Software::CSoftEngine engine(arguments.media.string(), arguments.width, arguments.height);
+		engine.SetFixedFrameTime(1.0f / 60.0f);
+
+		if (arguments.rayTrace) engine.SetRenderMode(Software::ESoftRenderMode::RayTrace);
+
+		const auto loadStart = std::chrono::steady_clock::now();
+
+		engine.CreateScene(scene.string());
+
+		const auto frameStart = std::chrono::steady_clock::now();
+
+		for (unsigned int i = 0; i < arguments.frames; ++i) engine.Update();
+
+		const auto end = std::chrono::steady_clock::now();
+
+		SRender render;
+		render.image = engine.Image();
+		render.loadMs = std::chrono::duration<double, std::milli>(frameStart - loadStart).count();
+		render.frameMs = std::chrono::duration<double, std::milli>(end - frameStart).count() / arguments.frames;
+		return render;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	SArguments arguments;
+
+	try
+	{
+		arguments = ParseArguments(argc, argv);
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf(stderr, "%s\n", e.what());
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	if (!fs::is_directory(arguments.media))
+	{
+		std::printf("The media folder %s is missing, nothing to render\n", arguments.media.string().c_str());
+		return SkipCode;
+	}
+
+	int compared = 0;
+	int failed = 0;
+
+	for (const auto& scene : SceneFiles(arguments))
+	{
+		const auto name = scene.stem().string();
+		const auto reference = arguments.references / (name + (arguments.rayTrace ? ".rt.ppm" : ".ppm"));
+
+		if (!arguments.update && !fs::exists(reference))
+		{
+			std::printf("[skip] %s: no reference\n", name.c_str());
+			continue;
+		}
+
+		try
+		{
+			const auto render = Render(scene, arguments);
+
+			std::printf("       %s: load %.1f ms, %.2f ms per frame\n", name.c_str(), render.loadMs, render.frameMs);
+
+			if (arguments.update)
+			{
+				fs::create_directories(arguments.references);
+				render.image.Write(reference.string());
+				std::printf("[ ok ] %s: wrote %s\n", name.c_str(), reference.string().c_str());
+				continue;
+			}
+
+			++compared;
+
+			const auto difference = Software::CSoftImage::Compare(render.image, Software::CSoftImage::Read(reference.string()), arguments.tolerance);
+
+			const auto pixels = static_cast<double>(arguments.width) * arguments.height;
+			const auto matches = difference.sameSize && difference.pixelsOver <= arguments.maxPixelsOver * pixels;
+			const auto inBudget = arguments.maxFrameMs <= 0 || render.frameMs <= arguments.maxFrameMs;
+
+			if (matches && inBudget)
+			{
+				std::printf("[ ok ] %s: max difference %u, mean %.3f\n", name.c_str(), difference.maxDifference, difference.meanDifference);
+				continue;
+			}
+
+			++failed;
+
+			if (!difference.sameSize)
+			{
+				std::printf("[fail] %s: the reference has a different size\n", name.c_str());
+			}
+			else if (!matches)
+			{
+				std::printf("[fail] %s: %zu pixels over the tolerance, max difference %u, mean %.3f\n",
+					name.c_str(), difference.pixelsOver, difference.maxDifference, difference.meanDifference);
+			}
+
+			if (!inBudget)
+			{
+				std::printf("[fail] %s: %.2f ms per frame, the budget is %.2f ms\n", name.c_str(), render.frameMs, arguments.maxFrameMs);
+			}
+
+			if (!matches)
+			{
+				fs::create_directories(arguments.output);
+				const auto actual = arguments.output / reference.filename();
+				render.image.Write(actual.string());
+				std::printf("       %s: frame written to %s\n", name.c_str(), actual.string().c_str());
+			}
+		}
+		catch (const std::exception& e)
+		{
+			++compared;
+			++failed;
+			std::printf("[fail] %s: %s\n", name.c_str(), e.what());
+		}
+	}
+
+	if (arguments.update) return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+
+	if (compared == 0)
+	{
+		std::printf("No scene had a reference to compare with\n");
+		return SkipCode;
+	}
+
+	std::printf("%d of %d scenes failed\n", failed, compared);
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+//--------------------------------------------------------------------------------------
+// Test harness
+//--------------------------------------------------------------------------------------
+// The smallest thing that runs the tests of the device-free parts of the engine: TEST
+// registers a function, the CHECK macros throw on failure and TestMain.cpp runs every
+// test of the executable, printing the failures. An executable returns 1 if a test failed.
+// Each executable is a test of CTest, see Tests/CMakeLists.txt.
+
+#pragma once
+
+#include <cmath>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace Tests
+{
+	struct STest
+	{
+		const char*           name;
+		std::function<void()> function;
+	};
+
+	inline std::vector<STest>& Registry()
+	{
+		static std::vector<STest> tests;
+		return tests;
+	}
+
+	struct SRegister
+	{
+		SRegister(const char* name, std::function<void()> function) { Registry().push_back({ name, std::move(function) }); }
+	};
+
+	class CFailure : public std::runtime_error
+	{
+	public:
+		CFailure(const char* file, int line, const std::string& what) :
+			std::runtime_error(std::string(file) + "(" + std::to_string(line) + "): " + what)
+		{
+		}
+	};
+
+	template <typename A, typename B>
+	void CheckEqual(const A& a, const B& b, const char* expression, const char* file, int line)
+	{
+		if (a == b) return;
+
+		std::ostringstream s;
+		s << expression << " is " << a << ", expected " << b;
+		throw CFailure(file, line, s.str());
+	}
+
+	template <typename A, typename B>
+	void CheckNear(const A& a, const B& b, double tolerance, const char* expression, const char* file, int line)
+	{
+		if (std::abs(static_cast<double>(a) - static_cast<double>(b)) <= tolerance) return;
+
+		std::ostringstream s;
+		s << expression << " is " << a << ", expected " << b << " within " << tolerance;
+		throw CFailure(file, line, s.str());
+	}
+}
+
+#define TEST_CONCAT_INNER(a, b) a##b
+#define TEST_CONCAT(a, b) TEST_CONCAT_INNER(a, b)
+
+#define TEST(name) \
+	static void name(); \
+	static Tests::SRegister TEST_CONCAT(gRegister, name)(#name, name); \
+	static void name()
+
+#define CHECK(condition) \
+	do { if (!(condition)) throw Tests::CFailure(__FILE__, __LINE__, #condition); } while (false)
+
+#define CHECK_EQ(a, b) Tests::CheckEqual((a), (b), #a, __FILE__, __LINE__)
+
+#define CHECK_NEAR(a, b, tolerance) Tests::CheckNear((a), (b), (tolerance), #a, __FILE__, __LINE__)
+
+#define CHECK_THROWS(expression, exception) \
+	do \
+	{ \
+		bool thrown = false; \
+		try { expression; } catch (const exception&) { thrown = true; } \
+		if (!thrown) throw Tests::CFailure(__FILE__, __LINE__, #expression " did not throw " #exception); \
+	} while (false)
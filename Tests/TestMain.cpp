@@ -0,0 +1,26 @@
+#include "TestHarness.h"
+
+#include <cstdio>
+#include <exception>
+
+int main()
+{
+	int failed = 0;
+
+	for (const auto& test : Tests::Registry())
+	{
+		try
+		{
+			test.function();
+			std::printf("[ ok ] %s\n", test.name);
+		}
+		catch (const std::exception& e)
+		{
+			std::printf("[fail] %s\n       %s\n", test.name, e.what());
+			++failed;
+		}
+	}
+
+	std::printf("%d of %d tests failed\n", failed, static_cast<int>(Tests::Registry().size()));
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,170 @@
+#include "TestHarness.h"
+
+#include <memory>
+
+#include "../Source/DX12/DX12UploadAllocator.h"
+
+using namespace DX12;
+
+namespace
+{
+	// Pages in CPU memory with made up GPU addresses, the fence is moved by the test
+	class CFakeUploadHeap : public IUploadHeap
+	{
+	public:
+
+		SUploadPage CreatePage(size_t size) override
+		{
+			mPages.push_back(std::make_unique<uint8_t[]>(size));
+			const auto gpu = mNextAddress;
+			mNextAddress += 0x100000000ull;
+			return { mPages.back().get(), gpu, size };
+		}
+
+		uint64_t CompletedFenceValue() override { return mCompleted; }
+
+		void WaitForFenceValue(uint64_t fenceValue) override
+		{
+			mWaits.push_back(fenceValue);
+			mCompleted = fenceValue;
+		}
+
+		uint64_t              mCompleted = 0;
+		std::vector<uint64_t> mWaits;
+
+		size_t Pages() const { return mPages.size(); }
+
+	private:
+
+		std::vector<std::unique_ptr<uint8_t[]>> mPages;
+		uint64_t                                mNextAddress = 0x100000000ull;
+	};
+}
+
+TEST(AllocationsAreAlignedBumps)
+{
+	CFakeUploadHeap heap;
+	CDX12UploadAllocator allocator(&heap, 2, 4096);
+	CHECK_EQ(heap.Pages(), 2u);
+	CHECK_EQ(allocator.Capacity(), 8192u);
+
+	allocator.BeginFrame(0);
+
+	const auto a = allocator.Allocate(100);
+	const auto b = allocator.Allocate(16, 16);
+	const auto c = allocator.Allocate(4);
+
+	CHECK_EQ(a.gpu % CDX12UploadAllocator::ConstantBufferAlignment, 0u);
+	CHECK_EQ(b.gpu - a.gpu, 112u);
+	CHECK_EQ(c.gpu - a.gpu, 256u);
+	CHECK_EQ(static_cast<uint8_t*>(c.cpu) - static_cast<uint8_t*>(a.cpu), 256);
+
+	// The padding counts
+	CHECK_EQ(allocator.FrameBytes(), 260u);
+
+	const uint32_t value = 0xDEADBEEF;
+	const auto address = allocator.Copy(value);
+	CHECK_EQ(address - a.gpu, 512u);
+	CHECK_EQ(*static_cast<uint32_t*>(static_cast<void*>(static_cast<uint8_t*>(a.cpu) + 512)), value);
+
+	CHECK_THROWS(allocator.Allocate(4, 3), std::logic_error);
+	CHECK_THROWS(allocator.Allocate(4, 0), std::logic_error);
+}
+
+TEST(FramesGrowByPages)
+{
+	CFakeUploadHeap heap;
+	CDX12UploadAllocator allocator(&heap, 2, 1024);
+
+	allocator.BeginFrame(0);
+	const auto first = allocator.Allocate(768);
+	const auto second = allocator.Allocate(512);
+
+	// Does not fit after the first, starts a new page
+	CHECK_EQ(heap.Pages(), 3u);
+	CHECK((second.gpu >> 32) != (first.gpu >> 32));
+
+	// Larger than a page, gets a page of its own size
+	const auto large = allocator.Allocate(4000);
+	CHECK_EQ(heap.Pages(), 4u);
+	CHECK_EQ(large.size, 4000u);
+	CHECK_EQ(allocator.Capacity(), 1024u * 3 + 4000u);
+
+	allocator.EndFrame(1);
+
+	// The pages are kept, the frame starts over from its first page
+	heap.mCompleted = 1;
+	allocator.BeginFrame(0);
+	CHECK_EQ(allocator.FrameBytes(), 0u);
+	CHECK_EQ(allocator.Allocate(16).gpu, first.gpu);
+	allocator.Allocate(768);
+	allocator.Allocate(3000);
+	CHECK_EQ(heap.Pages(), 4u);
+}
+
+TEST(FramesWaitForTheirFence)
+{
+	CFakeUploadHeap heap;
+	CDX12UploadAllocator allocator(&heap, 2, 1024);
+
+	allocator.BeginFrame(0);
+	const auto a = allocator.Allocate(64);
+	allocator.EndFrame(1);
+
+	allocator.BeginFrame(1);
+	const auto b = allocator.Allocate(64);
+	allocator.EndFrame(2);
+	CHECK(heap.mWaits.empty());
+	CHECK(a.gpu != b.gpu);
+
+	// Frame 0 is done, no wait
+	heap.mCompleted = 1;
+	allocator.BeginFrame(0);
+	CHECK(heap.mWaits.empty());
+	CHECK_EQ(allocator.Allocate(64).gpu, a.gpu);
+	allocator.EndFrame(3);
+
+	// Frame 1 is still in flight
+	allocator.BeginFrame(1);
+	CHECK_EQ(heap.mWaits.size(), 1u);
+	CHECK_EQ(heap.mWaits[0], 2u);
+	CHECK_EQ(allocator.Allocate(64).gpu, b.gpu);
+}
+
+TEST(OpenFramesAreCoveredByTheNextFence)
+{
+	CFakeUploadHeap heap;
+	CDX12UploadAllocator allocator(&heap, 2, 1024);
+
+	// Allocations while loading, before any frame began
+	allocator.Allocate(64);
+
+	// Beginning the open frame again keeps allocating after what is there
+	allocator.BeginFrame(0);
+	CHECK_EQ(allocator.FrameBytes(), 64u);
+
+	// Going back to it from another frame before a fence covers it is an error
+	allocator.BeginFrame(1);
+	allocator.Allocate(64);
+	CHECK_THROWS(allocator.BeginFrame(0), std::logic_error);
+
+	// One fence covers both open frames
+	allocator.EndFrame(5);
+
+	heap.mCompleted = 4;
+	allocator.BeginFrame(0);
+	CHECK_EQ(heap.mWaits.size(), 1u);
+	CHECK_EQ(heap.mWaits[0], 5u);
+	allocator.EndFrame(6);
+
+	allocator.BeginFrame(1);
+	CHECK_EQ(heap.mWaits.size(), 1u);
+}
+
+TEST(RejectsInvalidSettings)
+{
+	CFakeUploadHeap heap;
+	CHECK_THROWS(CDX12UploadAllocator(nullptr, 2), std::invalid_argument);
+	CHECK_THROWS(CDX12UploadAllocator(&heap, 0), std::invalid_argument);
+	CHECK_THROWS(CDX12UploadAllocator(&heap, 2, 0), std::invalid_argument);
+}